@@ -28,6 +28,8 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <stddef.h>
+
 #include "uart.h"
 #include "bootlogic.h"
 #include "machine.h"
@@ -36,38 +38,186 @@
 
 #define BOOT_PAGE_START 0
 #define BOOT_PAGE_NR 30
+/* Number of attempts to program a page before giving up */
+#define BOOT_PAGE_RETRIES 3
+/* Number of passes over the boot pages before giving up */
+#define BOOT_UPDATE_PASSES 3
+
+/* The progress of the update is recorded in the page following the new
+ * bootloader, which is overwritten by the rest of the flashing afterwards.
+ * It holds a magic, the identifier of the new bootloader, and one word per
+ * boot page, programmed once the page is verified. If the update is
+ * interrupted, running it again skips the pages already verified. */
+#define PROGRESS_PAGE (ARC_START_PAGE + BOOT_PAGE_NR)
+#define PROGRESS_MAGIC 0x44505542 /* "BUPD" */
+#define PROGRESS_PAGE_DONE(page) (0x4e4f4400 | (page)) /* "DON" */
+
+struct progress {
+	uint32_t magic;
+	uint32_t id;
+	uint32_t page_done[BOOT_PAGE_NR];
+};
+
+#define PAGE_ADDR(page) \
+	((uint32_t *)((page) * EMBEDDED_FLASH_BLOCK_SIZE + BASE_FLASH_ADDR))
+
+/* CRC of each page of the new bootloader */
+static uint32_t staged_crc[BOOT_PAGE_NR];
 
 void soc_reboot(void)
 {
 	SCSS_REG_VAL(SCSS_RSTC) = RSTC_WARM_RESET;
 }
 
+static void uart_put_uint(unsigned int val)
+{
+	char buf[11];
+	char *p = &buf[sizeof(buf) - 1];
 
-void main(void)
+	*p = '\0';
+	do {
+		*--p = '0' + val % 10;
+		val /= 10;
+	} while (val);
+	uart_puts(p);
+}
+
+/* CRC-32 (IEEE 802.3), computed 4 bits at a time to keep the table small */
+static uint32_t crc32(uint32_t crc, const uint8_t *buf, uint32_t len)
+{
+	static const uint32_t crc32_nibble[16] = {
+		0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac,
+		0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+		0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c,
+		0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c
+	};
+
+	crc = ~crc;
+	while (len--) {
+		crc ^= *buf++;
+		crc = (crc >> 4) ^ crc32_nibble[crc & 0xf];
+		crc = (crc >> 4) ^ crc32_nibble[crc & 0xf];
+	}
+	return ~crc;
+}
+
+static uint32_t page_crc(unsigned int page)
+{
+	return crc32(0, (const uint8_t *)PAGE_ADDR(page),
+		     EMBEDDED_FLASH_BLOCK_SIZE);
+}
+
+/* Erase and program one page, then check its CRC. Return 0 on success */
+static int update_page(unsigned int page, unsigned int staged_page)
 {
 	unsigned int retlen;
-	uint32_t data_new_bl = ARC_START_PAGE;
-	int count = 0;
+	int retry;
+
+	for (retry = 0; retry < BOOT_PAGE_RETRIES; retry++) {
+		soc_flash_block_erase(page, 1);
+		soc_flash_write(page * EMBEDDED_FLASH_BLOCK_SIZE,
+				EMBEDDED_FLASH_BLOCK_SIZE / 4, &retlen,
+				PAGE_ADDR(staged_page));
+		if (page_crc(page) == staged_crc[page - BOOT_PAGE_START])
+			return 0;
+	}
+	return -1;
+}
+
+/* Start recording the progress of the update of the bootloader identified
+ * by id, unless it was already started */
+static void start_progress(uint32_t id)
+{
+	const struct progress *progress =
+		(const struct progress *)PAGE_ADDR(PROGRESS_PAGE);
+	uint32_t header[2] = { PROGRESS_MAGIC, id };
+	unsigned int retlen;
+
+	if (progress->magic == PROGRESS_MAGIC && progress->id == id)
+		return;
+	soc_flash_block_erase(PROGRESS_PAGE, 1);
+	soc_flash_write(PROGRESS_PAGE * EMBEDDED_FLASH_BLOCK_SIZE, 2, &retlen,
+			header);
+}
+
+static void set_page_done(unsigned int index)
+{
+	uint32_t done = PROGRESS_PAGE_DONE(index);
+	unsigned int retlen;
+
+	soc_flash_write(PROGRESS_PAGE * EMBEDDED_FLASH_BLOCK_SIZE +
+			offsetof(struct progress, page_done[index]),
+			1, &retlen, &done);
+}
+
+/* Copy the new bootloader on the boot pages. Only the pages which differ
+ * from the new bootloader are erased and programmed.
+ * Return the number of pages which failed verification */
+static int copy_boot_pages(void)
+{
+	const struct progress *progress =
+		(const struct progress *)PAGE_ADDR(PROGRESS_PAGE);
+	int count;
+	int nb_updated = 0;
+	int nb_failed = 0;
+
+	for (count = 0; count < BOOT_PAGE_NR; count++)
+		staged_crc[count] = page_crc(ARC_START_PAGE + count);
+	start_progress(crc32(0, (const uint8_t *)staged_crc,
+			     sizeof(staged_crc)));
+
+	for (count = 0; count < BOOT_PAGE_NR; count++) {
+		unsigned int page = BOOT_PAGE_START + count;
+
+		if (progress->page_done[count] == PROGRESS_PAGE_DONE(count)) {
+			uart_puts("-");
+			continue;
+		}
+		if (page_crc(page) == staged_crc[count]) {
+			uart_puts("=");
+		} else if (update_page(page, ARC_START_PAGE + count) == 0) {
+			nb_updated++;
+			uart_puts(".");
+		} else {
+			nb_failed++;
+			uart_puts("!");
+			continue;
+		}
+		set_page_done(count);
+	}
+	uart_puts("\r\nCopy Done: ");
+	uart_put_uint(nb_updated);
+	uart_puts(" of ");
+	uart_put_uint(BOOT_PAGE_NR);
+	uart_puts(" pages updated\r\n");
+	if (nb_failed) {
+		uart_put_uint(nb_failed);
+		uart_puts(" pages failed verification\r\n");
+	}
+	return nb_failed;
+}
+
+void main(void)
+{
+	int pass;
 
 	soc_init();
 	uart_init(1, COM2_BASE_ADRS, 115200);
 	uart_puts("UART app updater\r\n");
 	uart_puts("Copying image on Bootloader Partition\r\n");
 
-	soc_flash_block_erase(BOOT_PAGE_START, BOOT_PAGE_NR);
-
-	/* Perform actual copy using soc_flash driver */
-	for (count = BOOT_PAGE_START; count < BOOT_PAGE_NR; count++) {
-		soc_flash_write(
-			(BOOT_PAGE_START + count) * EMBEDDED_FLASH_BLOCK_SIZE,
-			EMBEDDED_FLASH_BLOCK_SIZE / 4,
-			&retlen,
-			(uint32_t *)((data_new_bl +
-				      count) * EMBEDDED_FLASH_BLOCK_SIZE +
-				     BASE_FLASH_ADDR));
-		uart_puts(".");
+	for (pass = 0; pass < BOOT_UPDATE_PASSES; pass++)
+		if (copy_boot_pages() == 0)
+			break;
+
+	if (pass == BOOT_UPDATE_PASSES) {
+		/* Rebooting would start a bootloader which failed verification:
+		 * stay in the updater so that the board can still be reflashed
+		 * through JTAG */
+		uart_puts("Bootloader update failed, not rebooting\r\n");
+		while (1) ;
 	}
-	uart_puts("Copy Done. \r\n");
+
 	uart_puts("Rebooting... \r\n");
 	set_boot_target(TARGET_FLASHING);
 	soc_reboot();
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __DRV2605_SEQ_H__
+#define __DRV2605_SEQ_H__
+
+#include <stdint.h>
+
+#include "drivers/haptic.h"
+
+/*
+ * DRV2605 waveform sequencer.
+ *
+ * The DRV2605 plays up to eight library effects and waits in a row from its
+ * WAVEQ1 to WAVEQ8 registers once GO is set. Since GO follows WAVEQ8, one
+ * burst write of the nine registers uploads a sequence and starts it.
+ */
+
+#define DRV2605_SEQ_SLOTS       8
+
+/* A slot with this bit set waits (slot & 0x7F) * 10 ms */
+#define DRV2605_SEQ_WAIT        0x80
+#define DRV2605_SEQ_WAIT_MAX    0x7F
+#define DRV2605_SEQ_WAIT_UNIT   10
+
+struct drv2605_seq {
+	uint8_t slot[DRV2605_SEQ_SLOTS]; /* WAVEQ1 to WAVEQ8, 0 terminated */
+	uint8_t nb;                      /* slots used */
+	uint16_t duration;               /* ms before the next sequence */
+};
+
+/*
+ * Expected duration of a library effect, in ms.
+ */
+uint16_t drv2605_wave_duration(uint8_t effect);
+
+/*
+ * Compile the next part of a special effect pattern into a sequence.
+ *
+ * step is the pattern step to start from (even steps are effects, odd
+ * steps are off times, as in drv2605_info_t) and is updated to the first
+ * step not in the sequence. Off times are waits in the sequencer when there
+ * are slots left for the next effect; otherwise the sequence ends and the
+ * off time is part of its duration. A sequence with no slot means the
+ * pattern is over.
+ *
+ * Returns 0, or -1 if an effect of the pattern is not a library effect.
+ */
+int drv2605_seq_special(struct drv2605_seq *seq,
+			const vibration_special_effect_t *p, uint8_t *step);
+
+#endif /* __DRV2605_SEQ_H__ */
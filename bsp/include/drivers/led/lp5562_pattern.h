@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __LP5562_PATTERN_H__
+#define __LP5562_PATTERN_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "drivers/led/led.h"
+
+/*
+ * LP5562 pattern compiler.
+ *
+ * Turns a led_s pattern into the programs of the three LP5562 engines, and
+ * computes how long the engines take to run them. It has no dependency on
+ * the bus or the OS, so that programs can be checked off target.
+ *
+ * Programs are in host byte order; they must be byte swapped before being
+ * written to the engines program memory.
+ */
+
+#define LP5562_NB_ENGINES      3
+#define LP5562_NB_INSTRUCTIONS 16
+
+/* LP5562 engines clock */
+#define LP5562_CLOCK 32768
+
+struct lp5562_program {
+	uint16_t eng[LP5562_NB_ENGINES][LP5562_NB_INSTRUCTIONS];
+	uint16_t duration;      /* ms, one repetition with the last off time */
+	uint16_t last_duration; /* ms, last repetition without last off time */
+	bool looping;           /* engines repeat the pattern on their own */
+};
+
+/*
+ * Compile a blink pattern of nb_color colors.
+ *
+ * When loop is set and the engines program memory allows it (one or two
+ * colors), the engines branch back to the start instead of ending, and
+ * prog->looping is set.
+ *
+ * Returns 0, or -1 if the pattern has no on time.
+ */
+int lp5562_compile_blink(struct lp5562_program *prog, const led_s *p,
+			 uint8_t nb_color, bool loop);
+
+#ifdef CONFIG_LED_WAVE_SUPPORT
+/*
+ * Compile a wave pattern of nb_color colors (one or two).
+ *
+ * The off time of each color is included in the engines program, so when
+ * loop is set the engines always repeat the pattern on their own.
+ *
+ * Returns 0, or -1 if the pattern has no on time.
+ */
+int lp5562_compile_wave(struct lp5562_program *prog, const led_s *p,
+			uint8_t nb_color, bool loop);
+#endif
+
+/*
+ * Compute the time the engines take to run a program once, until all of
+ * them reach an END instruction, by executing it instruction by instruction.
+ *
+ * Returns the run time in LP5562_CLOCK ticks, or 0 if the program never
+ * ends (looping program or engines waiting for each other forever).
+ */
+uint32_t lp5562_program_run_time(const struct lp5562_program *prog);
+
+#endif /* __LP5562_PATTERN_H__ */
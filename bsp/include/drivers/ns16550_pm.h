@@ -31,6 +31,7 @@
 #ifndef _NS16550_PM_H_
 #define _NS16550_PM_H_
 
+#include <stdbool.h>
 #include <uart.h> /* defined by the OS */
 
 /**
@@ -64,6 +65,7 @@ struct ns16550_pm_device {
 	uint8_t vector;                     /*!< UART ISR vector */
 	uint32_t uart_int_mask;             /*!< Interrupt Routing Mask Register */
 	void (*uart_rx_callback)(void);     /*!< UART Rx registered callback */
+	void (*uart_tx_callback)(bool irq); /*!< UART Tx FIFO empty callback */
 	struct device *zephyr_device;       /*!< OS Device */
 };
 
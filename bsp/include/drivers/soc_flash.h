@@ -83,6 +83,23 @@ DRIVER_API_RC soc_flash_write(uint32_t address, unsigned int len,
 			      unsigned int *retlen,
 			      uint32_t *data);
 
+/**
+ *  Write buffer into flash memory from a panic handler
+ *
+ *  Same as soc_flash_write without taking the driver lock, which may be held
+ *  by the interrupted task. Only call it with interrupts locked.
+ *
+ *  @param  address         Address (in bytes) where to write (4 bytes aligned)
+ *  @param  len             Number of dword (32bits) to write
+ *  @param  retlen          Pointer where to return the number of written dwords (32bits)
+ *  @param  data            Data to write
+ *
+ *  @return  DRV_RC_OK on success else DRIVER_API_RC error code
+ */
+DRIVER_API_RC soc_flash_panic_write(uint32_t address, unsigned int len,
+				    unsigned int *retlen,
+				    uint32_t *data);
+
 /**
  *  Erase blocks of flash memory
  *
@@ -163,6 +163,25 @@ struct adc_info_t {
  */
 DRIVER_API_RC ss_adc_read(uint8_t channel_id, uint16_t *result_value);
 
+/** Maximum number of channels of @ref ss_adc_read_multi */
+#define ADC_SCAN_MAX_CHANNELS      (4)
+
+/** Read several ADC channels in a single hardware sequence
+ *
+ *  Each channel is converted a few times in a row and the samples are
+ *  averaged, which is less accurate than @ref ss_adc_read but needs a single
+ *  power up of the converter for all the channels.
+ *
+ *  @param  channel_ids     ADC channels
+ *  @param  nb_channels     Number of channels [1..ADC_SCAN_MAX_CHANNELS]
+ *  @param  result_values   Buffer of nb_channels values where to return the
+ *                          values, in the order of channel_ids
+ *  @return : Status of the ADC read
+ *
+ */
+DRIVER_API_RC ss_adc_read_multi(const uint8_t *channel_ids,
+				uint8_t nb_channels, uint16_t *result_values);
+
 /** @} */
 
 #endif  /* SS_ADC_H_ */
@@ -124,7 +124,7 @@ int acm_read(int idx, uint8_t *buffer, int len, void (*xfer_done)(int,
  * write data to an acm channel
  * callback is called when the transfer completes.
  * The first parameter of the callback is the actual number of bytes
- * transfered.
+ * transfered, or -1 if the transfer failed.
  *
  * @param  idx the index of the ACM interface to use
  * @param  buffer the data buffer to write
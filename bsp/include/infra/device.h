@@ -65,8 +65,23 @@ struct __packed __aligned(4) td_device
 	struct driver *driver;          /*!< Driver used for device */
 	PM_POWERSTATE powerstate : 8;   /*!< Powerstate of device */
 	uint8_t id;                     /*!< ID of device */
+	uint8_t pm_flags;               /*!< Power management flags (DEVICE_PM_xxx) */
 };
 
+/**
+ * Device is not resumed by resume_devices().
+ *
+ * The driver resumes it with device_resume_on_demand() before accessing the
+ * hardware, so that a device left unused during a sleep cycle costs neither
+ * a resume nor a suspend callback. Set by the driver init callback.
+ */
+#define DEVICE_PM_LAZY_RESUME (1 << 0)
+
+/**
+ * Device is being resumed by device_resume_on_demand().
+ */
+#define DEVICE_PM_RESUMING (1 << 1)
+
 /**
  * Common API for all device drivers.
  */
@@ -98,6 +113,79 @@ int suspend_devices(PM_POWERSTATE state);
  */
 void resume_devices(void);
 
+/**
+ * Resume a device flagged with DEVICE_PM_LAZY_RESUME if it is suspended.
+ *
+ * Bus drivers call it for the bus device when a child device issues a
+ * request, which makes a bus follow the usage of its children.
+ * The resume callback is called with interrupts enabled. A call made while
+ * the device is being resumed from another context does not wait for it:
+ * the caller must hand its work over to that context, checking
+ * DEVICE_PM_RESUMING under irq lock, as the SBA driver queues its requests.
+ *
+ * @param dev device to resume
+ *
+ * @return 0 if the device can be used, -EBUSY if it is being resumed from
+ * another context.
+ *
+ * @attention It will panic if the resume callback fails.
+ */
+int device_resume_on_demand(struct td_device *dev);
+
+/**
+ * Suspend an array of devices, in reverse order.
+ *
+ * If a suspend callback fails for something else than shutdown, the devices
+ * of the array already suspended are resumed.
+ *
+ * @param devices array of devices, buses first then their children
+ * @param count   size of the array
+ * @param state   suspend type
+ *
+ * @return 0 if success else -1.
+ */
+int suspend_device_array(struct td_device **devices, uint32_t count,
+			 PM_POWERSTATE state);
+
+/**
+ * Resume an array of devices, in order.
+ *
+ * Devices flagged with DEVICE_PM_LAZY_RESUME are left suspended.
+ *
+ * @param devices array of devices, buses first then their children
+ * @param count   size of the array
+ *
+ * @attention It will panic if a resume callback fails.
+ */
+void resume_device_array(struct td_device **devices, uint32_t count);
+
+#ifdef CONFIG_DEVICE_PM_STATS
+/**
+ * Device suspend/resume statistics.
+ *
+ * Durations are in 32kHz clock ticks.
+ */
+struct device_pm_stats {
+	uint32_t suspend_count; /*!< Number of suspend callbacks */
+	uint32_t resume_count;  /*!< Number of resume callbacks */
+	uint32_t lazy_count;    /*!< Resumes avoided by DEVICE_PM_LAZY_RESUME */
+	uint32_t suspend_total; /*!< Cumulated suspend callback time */
+	uint32_t resume_total;  /*!< Cumulated resume callback time */
+	uint16_t suspend_max;   /*!< Longest suspend callback */
+	uint16_t resume_max;    /*!< Longest resume callback */
+};
+
+/**
+ * Get the suspend/resume statistics of a device.
+ *
+ * @param id    device ID, lower than CONFIG_DEVICE_PM_STATS_NB
+ * @param stats statistics to fill
+ *
+ * @return 0 if success, -EINVAL if the device ID is not tracked.
+ */
+int device_pm_get_stats(uint8_t id, struct device_pm_stats *stats);
+#endif
+
 /**
  * Adds all devices to power management infrastructure and init them.
  *
@@ -42,8 +42,8 @@
 /**
  * Provide the final low level function used to output logs on a backend.
  *
- * Implementation of a log_backend need to provide valid functions for these 2
- * callbacks.
+ * Implementation of a log_backend need to provide valid functions for the
+ * first 2 callbacks.
  */
 struct log_backend {
 	/**
@@ -57,6 +57,12 @@ struct log_backend {
 	 * Returns the current backend status.
 	 */
 	bool (*is_backend_ready)(void);
+	/**
+	 * Write out the data buffered by the backend, if any.
+	 * Called each time the logger has no more message to output.
+	 * Optional, may be NULL.
+	 */
+	void (*flush)(void);
 };
 
 /** @} */
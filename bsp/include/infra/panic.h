@@ -54,6 +54,9 @@
 /** Panic dump has not already been processed. */
 #define PANIC_DATA_FLAG_FRAME_BLE_AVAILABLE (1 << 1)
 
+/* Arch of a record holding system events instead of a core dump */
+#define PANIC_DATA_ARCH_EVENTS 0xe5
+
 /** Declare RAM panic data. */
 #define DECLARE_PANIC_DATA(arch) \
 	struct arch ## _panic_data { \
@@ -65,13 +65,30 @@
  * @{
  */
 
+/**
+ * Wakelock hold statistics.
+ *
+ * Durations are in 32kHz clock ticks.
+ */
+struct pm_wakelock_stats {
+	uint32_t count; /*!< Number of times the wakelock was released */
+	uint32_t max;   /*!< Longest hold */
+	uint64_t total; /*!< Cumulated hold time */
+};
+
 /**
  * Wakelock managing structure.
  *
  */
 struct pm_wakelock {
 	list_t list;     /*!< Internal list management member */
+	struct pm_wakelock *prev; /*!< Previous wakelock in the acquired list */
 	unsigned int lock; /*!< Lock to avoid acquiring a lock several times */
+#ifdef CONFIG_PM_WAKELOCK_STATS
+	const void *owner; /*!< Return address of the pm_wakelock_init caller */
+	uint32_t acquired_at; /*!< 32kHz timestamp of the last acquire */
+	struct pm_wakelock_stats stats; /*!< Hold statistics since init */
+#endif
 };
 
 /**
@@ -108,6 +125,43 @@ int pm_wakelock_acquire(struct pm_wakelock *wl);
  */
 int pm_wakelock_release(struct pm_wakelock *wl);
 
+#ifdef CONFIG_PM_WAKELOCK_STATS
+/**
+ * Wakelock statistics table entry.
+ */
+struct pm_wakelock_top {
+	const struct pm_wakelock *wl; /*!< Wakelock address */
+	const void *owner;            /*!< Return address of the init caller */
+	struct pm_wakelock_stats stats; /*!< Hold statistics of this wakelock */
+};
+
+/**
+ * Get the wakelocks with the longest cumulated hold time.
+ *
+ * The statistics are kept for the CONFIG_PM_WAKELOCK_STATS_NB wakelocks
+ * with the longest cumulated hold time. The entry of a wakelock is dropped
+ * by pm_wakelock_init and by pm_wakelock_stats_remove.
+ *
+ * @param top Array to fill, sorted by decreasing cumulated hold time
+ * @param nb  Number of entries of the array
+ *
+ * @return number of entries filled
+ */
+int pm_wakelock_get_top(struct pm_wakelock_top *top, int nb);
+
+/**
+ * Remove a wakelock from the statistics table.
+ *
+ * To be called when the memory of a released wakelock is freed, for instance
+ * when a wakelock on the stack goes out of scope. pm_wakelock_init also
+ * removes the wakelock, so the entry of a freed wakelock that was not
+ * removed cannot be inherited by a new one at the same address.
+ *
+ * @param wl Wakelock to remove
+ */
+void pm_wakelock_stats_remove(const struct pm_wakelock *wl);
+#endif
+
 /**
  * Check if wakelock list is empty.
  *
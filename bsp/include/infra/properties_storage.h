@@ -68,8 +68,21 @@ typedef enum {
 /** Maximum size for the value of a property in byte */
 #define PROPERTIES_STORAGE_MAX_VALUE_LEN 512
 
-/** Maximum number of properties that can be stored in the store  */
+#ifndef PROPERTIES_STORAGE_MAX_NB_PROPERTIES
+/** Maximum number of properties that can be stored in the store, must be a
+ * power of 2 */
 #define PROPERTIES_STORAGE_MAX_NB_PROPERTIES 32
+#endif
+
+/** Maximum number of properties set in one batch */
+#define PROPERTIES_STORAGE_MAX_BATCH_ITEMS 8
+
+/** One property of a batch, see @ref properties_storage_set_batch */
+typedef struct {
+	uint32_t key;           /*!< Key of the property */
+	const uint8_t *buf;     /*!< New value to store */
+	uint16_t len;           /*!< Length of buf in bytes */
+} properties_storage_item_t;
 
 /**
  * Initialize the property storage.
@@ -108,6 +121,32 @@ properties_storage_status_t properties_storage_set(
 	uint32_t key, const uint8_t *buf, uint16_t len,
 	bool factory_reset_persistent);
 
+/**
+ * Set the values of several properties atomically.
+ *
+ * Properties which didn't previously exist are created. After a reset, either
+ * all the new values or none of them are found in the store.
+ * The values are written in a single sequence of flash writes followed by a
+ * commit record, which is cheaper than setting the properties one by one.
+ * This function blocks until completion.
+ *
+ * @param items Properties to set
+ * @param nb_items Number of items, at most PROPERTIES_STORAGE_MAX_BATCH_ITEMS
+ * @param factory_reset_persistent Set to true to store the properties in the
+ * reset persistent partition.
+ *
+ * @return
+ *  - PROPERTIES_STORAGE_INVALID_ARG:  Invalid number of items, invalid key, or
+ *                                     invalid len (upper than
+ *                                     PROPERTIES_STORAGE_MAX_VALUE_LEN)
+ *  - PROPERTIES_STORAGE_BOUNDS_ERROR: The batch doesn't fit in a flash block,
+ *                                     or store is full
+ *  - PROPERTIES_STORAGE_SUCCESS:      Store succeed
+ */
+properties_storage_status_t properties_storage_set_batch(
+	const properties_storage_item_t *items, uint8_t nb_items,
+	bool factory_reset_persistent);
+
 /**
  * Get the value for a property.
  *
@@ -160,6 +199,27 @@ properties_storage_status_t properties_storage_get_info(
  */
 properties_storage_status_t properties_storage_delete(uint32_t key);
 
+#ifdef CONFIG_QUARK_DRIVER_TESTS
+/**
+ * Simulate a power cut after nb_writes flash writes: the following flash
+ * accesses are dropped until properties_storage_init() is called.
+ *
+ * Only available for unit tests.
+ *
+ * @param nb_writes Number of flash writes still performed
+ */
+void properties_storage_test_cut_power(uint32_t nb_writes);
+
+/**
+ * Get the number of flash writes since the last properties_storage_init().
+ *
+ * Only available for unit tests.
+ *
+ * @return Number of flash writes
+ */
+uint32_t properties_storage_test_nb_writes(void);
+#endif
+
 /** @} */
 
 #endif /* __PROPERTIES_STORAGE_H */
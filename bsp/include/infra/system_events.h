@@ -33,11 +33,12 @@
 
 #include <stdint.h>
 #include "infra/boot.h"
+#include "util/event_journal.h"
 
 
 /**
  * @defgroup infra_system_events System Events
- * Implement a circular buffer of system events.
+ * Implement a flash journal of system events.
  *
  * <table>
  * <tr><th><b>Include file</b><td><tt> \#include "infra/system_events.h"</tt>
@@ -46,10 +47,14 @@
  * </table>
  *
  * System events are events generated by the system on important events.
- * They are stored in a circular buffer until they are forwarded over BLE
- * or retrieved from DFU.
+ * They are stored in a journal in SPI flash until they are forwarded over
+ * BLE or retrieved from DFU.
  *
- * For more information on circular buffer see @ref cbuffer.
+ * Events are staged in RAM and programmed a flash page at a time: when the
+ * page is full, CONFIG_SYSTEM_EVENTS_FLUSH_DELAY ms after the first staged
+ * event, on shutdown and before a readout.
+ *
+ * For more information on the journal see @ref event_journal.
  *
  * @ingroup infra
  * @{
@@ -219,12 +224,52 @@ void system_event_push(struct system_event *evt);
  * Pop a system event
  *
  * This function retrieves the first available system event in the buffer.
+ * Reading several events is cheaper with @ref system_events_iter_init.
  *
  * @return struct system_event an allocated pointer to the retrieved system
  *                             event. NULL if no event in the buffer.
  */
 struct system_event *system_event_pop(void);
 
+/**
+ * Program the system events staged in RAM to flash.
+ */
+void system_events_flush(void);
+
+/**
+ * Save the system events staged in RAM next to the panic dumps, to be
+ * programmed to flash on the next boot.
+ *
+ * Called by the panic handler with interrupts locked, when the SPI flash
+ * cannot be used.
+ */
+void system_events_panic(void);
+
+/**
+ * Start reading the system events not consumed yet, oldest first.
+ *
+ * The staged events are programmed to flash first.
+ *
+ * @param iter Read cursor to initialize
+ */
+void system_events_iter_init(struct event_journal_iter *iter);
+
+/**
+ * Get the next system event of a readout.
+ *
+ * @param iter Read cursor
+ * @return pointer to the event in the cursor buffer, valid until the next
+ *         call. NULL once all events have been read.
+ */
+struct system_event *system_events_iter_next(struct event_journal_iter *iter);
+
+/**
+ * Mark the events returned by a readout as consumed.
+ *
+ * @param iter Read cursor
+ */
+void system_events_consume(struct event_journal_iter *iter);
+
 /**
  * Fill the header part of a system event
  *
@@ -31,11 +31,32 @@
 #ifndef __LOG_BACKEND_FLASH_H
 #define __LOG_BACKEND_FLASH_H
 
+#include <stdint.h>
 #include <infra/log_backend.h>
 
 /** The FLASH log backend */
 extern struct log_backend log_backend_flash;
 
+/**
+ * Find the write position in the log area of the flash.
+ *
+ * The flash log backend does not output anything before this call.
+ */
 void log_backend_flash_init(void);
 
+/** Counters of the flash log backend, since boot */
+struct log_backend_flash_stats {
+	uint32_t records;       /*!< log lines written */
+	uint32_t bytes;         /*!< text bytes written */
+	uint32_t programs;      /*!< flash program operations */
+	uint32_t erases;        /*!< flash sectors erased */
+};
+
+/**
+ * Get the counters of the flash log backend.
+ *
+ * @param stats the counters to fill
+ */
+void log_backend_flash_get_stats(struct log_backend_flash_stats *stats);
+
 #endif /* __LOG_BACKEND_FLASH_H */
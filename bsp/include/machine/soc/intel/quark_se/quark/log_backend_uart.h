@@ -36,4 +36,47 @@
 /** The UART log backend */
 extern struct log_backend log_backend_uart;
 
+/** Counters of the interrupt-driven UART log backend, since boot */
+struct log_backend_uart_stats {
+	uint32_t lines;         /*!< lines logged */
+	uint32_t bytes;         /*!< bytes logged */
+	uint32_t tx_irqs;       /*!< TX FIFO refills */
+	uint32_t dropped_lines; /*!< lines dropped because the ring was full */
+	uint32_t dropped_bytes; /*!< bytes of the dropped lines */
+	uint16_t high_water;    /*!< maximum number of bytes in the ring */
+	uint16_t pending;       /*!< bytes currently in the ring */
+};
+
+/**
+ * Send the pending logs and switch to polled output.
+ *
+ * To be called on panic, with interrupts locked.
+ */
+void log_backend_uart_panic(void);
+
+/**
+ * Initialize the UART log backend.
+ *
+ * To be called once the wakelocks are initialized. The logs queued before
+ * are sent in polled mode.
+ */
+void log_backend_uart_init(void);
+
+/**
+ * Refill the UART TX FIFO from the log ring buffer.
+ *
+ * Called from the UART interrupt handler when the TX FIFO is empty, and by
+ * the driver once the UART is resumed.
+ *
+ * @param irq true if called on a TX interrupt
+ */
+void log_backend_uart_tx_isr(bool irq);
+
+/**
+ * Get the counters of the interrupt-driven UART log backend.
+ *
+ * @param stats the counters to fill
+ */
+void log_backend_uart_get_stats(struct log_backend_uart_stats *stats);
+
 #endif /* __LOG_BACKEND_UART_H */
@@ -38,4 +38,22 @@ extern struct log_backend log_backend_usb;
 
 void release_usb_backend_xfer(void);
 
+/** Counters of the USB log backend, since boot */
+struct log_backend_usb_stats {
+	uint32_t lines;         /*!< lines queued */
+	uint32_t bytes_queued;  /*!< bytes of the queued lines */
+	uint32_t bytes_sent;    /*!< bytes acknowledged by the host */
+	uint32_t xfers;         /*!< bulk transfers started */
+	uint32_t xfer_errors;   /*!< bulk transfers which could not start */
+	uint32_t dropped_lines; /*!< lines dropped because the buffers were full */
+	uint32_t dropped_bytes; /*!< bytes of the dropped lines and failed transfers */
+};
+
+/**
+ * Get the counters of the USB log backend.
+ *
+ * @param stats the counters to fill
+ */
+void log_backend_usb_get_stats(struct log_backend_usb_stats *stats);
+
 #endif /* __LOG_BACKEND_USB_H */
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __CUNIT_BENCH_H__
+#define __CUNIT_BENCH_H__
+
+#include <stdint.h>
+
+#include "util/cunit_test.h"
+
+/**
+ * @defgroup cunit_bench Micro benchmarks
+ * Timing of short operations on top of the unit tests framework.
+ *
+ * A benchmark body runs the measured operation n times. The framework
+ * warms it up, picks n so that a sample lasts at least
+ * CU_BENCH_SAMPLE_TICKS, and takes samples until the fastest one has not
+ * improved for CU_BENCH_STABLE samples. The minimum, median and maximum
+ * time per operation are printed on one line:
+ *
+ *     CU_BENCH <name> <unit> iter=<n> samples=<s> min=<x> med=<y> max=<z>
+ *
+ * The unit is the CPU cycle on x86 (TSC) and on ARC (timer 0), the
+ * nanosecond on other Linux hosts.
+ * @ingroup infra
+ * @{
+ */
+
+/* Least duration of a sample, in counter ticks */
+#define CU_BENCH_SAMPLE_TICKS   20000
+/* Number of samples taken, at least and at most */
+#define CU_BENCH_MIN_SAMPLES    7
+#define CU_BENCH_MAX_SAMPLES    31
+/* Samples without a 1% faster one before the timing is stable */
+#define CU_BENCH_STABLE         5
+/* Largest number of operations in a sample */
+#define CU_BENCH_MAX_ITER       65536
+
+/**
+ * Benchmark body: runs the measured operation n times.
+ */
+typedef void (*cu_bench_body_t)(uint32_t n, void *priv);
+
+struct cu_bench_result {
+	uint32_t iter;          /*!< operations per sample */
+	uint32_t samples;       /*!< samples taken */
+	uint32_t min;           /*!< fastest operation, in counter ticks */
+	uint32_t median;
+	uint32_t max;
+};
+
+/**
+ * Read the benchmark counter.
+ *
+ * @return counter ticks, wrapping on 32 bits
+ */
+uint32_t cu_bench_counter(void);
+
+/**
+ * Unit of the benchmark counter: "cycles" or "ns".
+ */
+const char *cu_bench_unit(void);
+
+/**
+ * Time a benchmark body and print its result.
+ *
+ * @param name short name printed in the result line
+ * @param body function running the operation
+ * @param priv parameter of body
+ * @param res filled with the result, may be NULL
+ */
+void cu_bench_run(const char *name, cu_bench_body_t body, void *priv,
+		  struct cu_bench_result *res);
+
+/* Time one operation, body being a cu_bench_body_t */
+#define CU_BENCH(name, body, priv) \
+	cu_bench_run(name, body, priv, NULL)
+
+/* Run a suite of benchmarks, reported as a test */
+#define CU_RUN_BENCH(bench) \
+	do { \
+		cu_print("BENCH UNIT %s\n", cu_bench_unit()); \
+		CU_RUN_TEST(bench); \
+	} while (0)
+
+/** @} */
+
+#endif /* __CUNIT_BENCH_H__ */
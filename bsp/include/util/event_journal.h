@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __EVENT_JOURNAL_H__
+#define __EVENT_JOURNAL_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @defgroup event_journal Event journal
+ * Append-only journal of fixed size records in a ring of flash sectors.
+ *
+ * Records are staged in a RAM copy of the current flash page and packed in
+ * frames, each one holding the sequence number of its first record, the
+ * number of records and a CRC16. A page is programmed once it is full or
+ * on event_journal_flush(), so a burst of records costs one program per
+ * page instead of one per record.
+ *
+ * Records are read back with an iterator that loads one page at a time and
+ * returns pointers in its own buffer. Consuming the records read only
+ * stages a small acknowledge frame, the records stay in flash until their
+ * sector is recycled.
+ *
+ * The journal is not thread safe, callers must serialize the accesses.
+ * @ingroup infra
+ * @{
+ */
+
+/** Size of a flash page, frames never span two pages */
+#define EVENT_JOURNAL_PAGE_SIZE 256
+
+/**
+ * Flash accessors used by the journal.
+ *
+ * Offsets are relative to the start of the journal area.
+ */
+struct event_journal_ops {
+	/** Read from the area, return 0 on success */
+	int (*read)(void *priv, uint32_t offset, uint8_t *buf, uint32_t len);
+	/** Program bytes of a single page, return 0 on success */
+	int (*write)(void *priv, uint32_t offset, const uint8_t *buf,
+		     uint32_t len);
+	/** Erase one sector of the area, return 0 on success */
+	int (*erase)(void *priv, uint32_t sector);
+	void *priv;
+};
+
+/** Counters of a journal, since event_journal_init */
+struct event_journal_stats {
+	uint32_t appended;      /*!< records appended */
+	uint32_t programs;      /*!< flash program operations */
+	uint32_t erases;        /*!< flash sectors erased */
+	uint32_t reads;         /*!< flash read operations */
+	uint32_t errors;        /*!< failed flash operations */
+};
+
+/** Journal state, fields are private to event_journal.c */
+struct event_journal {
+	const struct event_journal_ops *ops;
+	uint32_t sector_size;
+	uint16_t nb_sectors;
+	uint16_t elt_size;
+	uint32_t sector_seq;    /* sequence number of the head sector */
+	uint32_t next_seq;      /* sequence number of the next record */
+	uint32_t read_seq;      /* first record not consumed */
+	uint32_t page_addr;     /* offset of the page in the buffer */
+	uint16_t page_fill;     /* bytes of the page written in the buffer */
+	uint16_t programmed;    /* bytes of the page already in flash */
+	int16_t frame;          /* offset of the open frame, -1 if none */
+	struct event_journal_stats stats;
+	uint8_t page[EVENT_JOURNAL_PAGE_SIZE];
+};
+
+/** Read cursor, fields are private to event_journal.c */
+struct event_journal_iter {
+	struct event_journal *journal;
+	uint32_t sector_seq;    /* sequence number of the sector read */
+	uint32_t addr;          /* offset of the page in the buffer */
+	uint32_t seq;           /* sequence number of the next record of frame */
+	uint32_t next_seq;      /* first record not returned yet */
+	/** Records missing since the start, overwritten or corrupted */
+	uint32_t lost;
+	uint16_t pos;           /* offset of the next frame or record */
+	uint8_t left;           /* records left in the current frame */
+	bool done;
+	uint8_t buf[EVENT_JOURNAL_PAGE_SIZE];
+};
+
+/**
+ * Mount a journal, or format the area if it holds no journal.
+ *
+ * @param journal     journal to initialize
+ * @param ops         flash accessors, must stay valid while the journal is used
+ * @param sector_size size of an erase sector, multiple of the page size
+ * @param nb_sectors  number of sectors of the area, at least 2
+ * @param elt_size    size of a record
+ *
+ * @return 0, or -1 on invalid geometry or flash error
+ */
+int event_journal_init(struct event_journal *journal,
+		       const struct event_journal_ops *ops,
+		       uint32_t sector_size, uint16_t nb_sectors,
+		       uint16_t elt_size);
+
+/**
+ * Append a record.
+ *
+ * The record is copied in the page buffer, the page is programmed if it
+ * cannot hold another record.
+ *
+ * @return 0, or -1 if the flash could not be written
+ */
+int event_journal_append(struct event_journal *journal, const void *elt);
+
+/**
+ * Program the records and acknowledges staged in RAM.
+ *
+ * @return 0, or -1 if the flash could not be written
+ */
+int event_journal_flush(struct event_journal *journal);
+
+/**
+ * Get the records and acknowledges staged in RAM without programming them,
+ * for a caller which cannot access the flash, such as a panic handler.
+ *
+ * The open frame is closed. The bytes are to be given back to
+ * event_journal_restore() once the journal is mounted again.
+ *
+ * @param journal journal
+ * @param offset  set to the offset of the staged bytes in the area
+ * @param buf     set to the staged bytes, valid until the next journal call
+ *
+ * @return number of staged bytes, 0 if everything is in flash
+ */
+uint16_t event_journal_staged(struct event_journal *journal, uint32_t *offset,
+			      const uint8_t **buf);
+
+/**
+ * Program bytes returned by event_journal_staged() before a reset, then
+ * mount the journal again.
+ *
+ * Nothing is programmed unless the flash at offset is still erased, as when
+ * the staged bytes were lost.
+ *
+ * @return 0, or -1 if the bytes were not programmed
+ */
+int event_journal_restore(struct event_journal *journal, uint32_t offset,
+			  const uint8_t *buf, uint16_t len);
+
+/** Return true if some records or acknowledges are not in flash yet */
+static inline bool event_journal_pending(const struct event_journal *journal)
+{
+	return journal->page_fill > journal->programmed;
+}
+
+/** Return the number of records appended and not consumed yet */
+static inline uint32_t event_journal_unread(const struct event_journal *journal)
+{
+	return journal->next_seq - journal->read_seq;
+}
+
+/**
+ * Mark the records up to seq (excluded) as consumed.
+ *
+ * The acknowledge is staged like a record and programmed on the next flush.
+ */
+void event_journal_consume(struct event_journal *journal, uint32_t seq);
+
+/**
+ * Start reading the records not consumed yet, oldest first.
+ *
+ * Only the records in flash are returned: flush the journal before.
+ */
+void event_journal_iter_init(struct event_journal *journal,
+			     struct event_journal_iter *iter);
+
+/**
+ * Get the next record.
+ *
+ * @param iter read cursor
+ * @param seq  if not NULL, set to the sequence number of the record
+ *
+ * @return pointer to the record in the cursor buffer, valid until the next
+ *         call, or NULL once all records have been returned
+ */
+const void *event_journal_iter_next(struct event_journal_iter *iter,
+				    uint32_t *seq);
+
+/** @} */
+
+#endif /* __EVENT_JOURNAL_H__ */
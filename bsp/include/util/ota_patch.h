@@ -0,0 +1,234 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __OTA_PATCH_H__
+#define __OTA_PATCH_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "util/compiler.h"
+
+/**
+ * @defgroup ota_patch OTA chunk patch applier
+ * Streaming applier for the chunked packages generated by
+ * tools/scripts/build_utils/bsdiff_chunk.py.
+ *
+ * The package is a sequence of chunks, each one made of an
+ * @ref ota_chunk_header followed by an LZG stream holding either the new
+ * content of the chunk (OTA_CHUNK_TYPE_COMPRESSED) or a minibsdiff patch
+ * against the same chunk of the installed image
+ * (OTA_CHUNK_TYPE_COMPRESSED_PATCH). Chunks identical in both images are
+ * omitted from the package and copied from the installed image.
+ *
+ * The package is fed in arbitrary pieces as it is received, and each chunk
+ * is written to flash as soon as it is complete. A chunk whose destination
+ * already holds the expected content is skipped, so an update interrupted by
+ * a power loss can be restarted from the beginning of the package, or from
+ * the input offset reported by the last ota_patch_ops::chunk_done call.
+ *
+ * The only RAM used is the ota_patch_ctx structure and the work buffer given
+ * to ota_patch_init: one chunk for the new content, the rest for the decoded
+ * patch.
+ * @ingroup infra
+ * @{
+ */
+
+/** "C!K$" read as a little endian word */
+#define OTA_CHUNK_HEADER_MAGIC          0x244b2143
+#define OTA_CHUNK_HEADER_VERSION        1
+
+#define OTA_CHUNK_TYPE_KEEP             1
+#define OTA_CHUNK_TYPE_COMPRESSED       2
+#define OTA_CHUNK_TYPE_COMPRESSED_PATCH 3
+
+/** Default chunk size used by bsdiff_chunk.py */
+#define OTA_CHUNK_SIZE                  4096
+
+/** Chunk header, as generated by bsdiff_chunk.py */
+struct ota_chunk_header {
+	uint32_t magic;
+	uint8_t version;
+	uint8_t type;
+	int16_t id;
+	/** Size of the LZG payload following the header */
+	int32_t size;
+	/** CRC32 of the header, computed with this field set to 0 */
+	uint32_t crc;
+	uint32_t from_len;
+	uint32_t from_crc;
+	uint32_t to_len;
+	uint32_t to_crc;
+} __packed;
+
+enum ota_patch_status {
+	OTA_PATCH_OK = 0,
+	/** Invalid chunk header, or chunks out of order */
+	OTA_PATCH_ERR_HEADER = -1,
+	/** Installed chunk does not match the one the patch was built from */
+	OTA_PATCH_ERR_FROM_CRC = -2,
+	/** Corrupted LZG stream or bsdiff patch */
+	OTA_PATCH_ERR_DECODE = -3,
+	/** Rebuilt chunk does not match the expected CRC */
+	OTA_PATCH_ERR_TO_CRC = -4,
+	/** Work buffer too small for this chunk */
+	OTA_PATCH_ERR_NO_MEM = -5,
+	/** Flash access failed */
+	OTA_PATCH_ERR_FLASH = -6,
+	/** Package ended in the middle of a chunk */
+	OTA_PATCH_ERR_TRUNCATED = -7,
+};
+
+/**
+ * Flash accessors used by the applier.
+ *
+ * Offsets are relative to the start of the image. read_old and read_new
+ * may point to the same storage when the image is patched in place, in
+ * which case a power loss while a chunk is written cannot be recovered.
+ */
+struct ota_patch_ops {
+	/** Read from the installed image, return 0 on success */
+	int (*read_old)(void *priv, uint32_t offset, uint8_t *buf, uint32_t len);
+	/** Read from the image being built, return 0 on success */
+	int (*read_new)(void *priv, uint32_t offset, uint8_t *buf, uint32_t len);
+	/** Erase and write a whole chunk of the new image, return 0 on success */
+	int (*write_new)(void *priv, uint32_t offset, const uint8_t *buf,
+			 uint32_t len);
+	/**
+	 * Optional, called once a chunk is in flash with the number of input
+	 * bytes consumed so far, to be stored by the caller to resume the
+	 * transfer after a reset.
+	 */
+	void (*chunk_done)(void *priv, uint32_t in_offset, int16_t id);
+	void *priv;
+	/** True when old and new image share the same storage */
+	bool in_place;
+};
+
+/** LZG decoder state, private to ota_patch.c */
+struct ota_lzg {
+	uint8_t *dst;
+	uint32_t dst_size;
+	uint32_t dst_pos;
+	uint32_t decoded_size;
+	uint32_t encoded_size;
+	uint32_t encoded_pos;
+	uint32_t checksum;
+	uint16_t sum_a;
+	uint16_t sum_b;
+	uint8_t hdr[16];
+	uint8_t marker[4];
+	uint8_t sym[4];
+	uint8_t sym_len;
+	uint8_t method;
+};
+
+/** Applier context, fields are private to ota_patch.c */
+struct ota_patch_ctx {
+	const struct ota_patch_ops *ops;
+	uint8_t *out_buf;
+	uint8_t *patch_buf;
+	uint32_t patch_buf_size;
+	uint32_t chunk_size;
+	uint32_t in_offset;
+	uint32_t payload_left;
+	int32_t next_id;
+	int status;
+	uint8_t state;
+	uint8_t hdr_len;
+	struct ota_chunk_header hdr;
+	struct ota_lzg lzg;
+	/** Chunks rebuilt from the package */
+	uint16_t nb_applied;
+	/** Chunks already up to date in flash */
+	uint16_t nb_skipped;
+	/** Chunks copied from the installed image */
+	uint16_t nb_kept;
+};
+
+/**
+ * Initialize an applier context.
+ *
+ * @param ctx        context to initialize
+ * @param ops        flash accessors, must stay valid until the end of the update
+ * @param work       work buffer
+ * @param work_size  size of the work buffer, at least chunk_size plus the
+ *                   largest decoded patch of the package
+ * @param chunk_size chunk size the package was generated with
+ *
+ * @return OTA_PATCH_OK or OTA_PATCH_ERR_NO_MEM
+ */
+int ota_patch_init(struct ota_patch_ctx *ctx, const struct ota_patch_ops *ops,
+		   uint8_t *work, uint32_t work_size, uint32_t chunk_size);
+
+/**
+ * Resume an update from the progress reported by ota_patch_ops::chunk_done.
+ *
+ * The package must then be fed from in_offset.
+ *
+ * @param ctx        context freshly initialized with ota_patch_init
+ * @param in_offset  in_offset of the last chunk_done call
+ * @param id         id of the last chunk_done call
+ */
+void ota_patch_resume(struct ota_patch_ctx *ctx, uint32_t in_offset,
+		      int16_t id);
+
+/**
+ * Feed the next bytes of the package.
+ *
+ * @return OTA_PATCH_OK, or the first error met, which is then returned by
+ *         all further calls
+ */
+int ota_patch_feed(struct ota_patch_ctx *ctx, const uint8_t *data,
+		   uint32_t len);
+
+/**
+ * Complete the update once the whole package has been fed.
+ *
+ * Chunks following the last one of the package are copied from the
+ * installed image.
+ *
+ * @param ctx        applier context
+ * @param image_len  size of the new image
+ *
+ * @return OTA_PATCH_OK or an error
+ */
+int ota_patch_finish(struct ota_patch_ctx *ctx, uint32_t image_len);
+
+/**
+ * Standard CRC32 (as computed by binascii.crc32).
+ *
+ * @param crc  0, or the value returned for the previous buffer
+ */
+uint32_t ota_crc32(uint32_t crc, const uint8_t *buf, uint32_t len);
+
+/** @} */
+
+#endif /* __OTA_PATCH_H__ */
@@ -82,6 +82,9 @@
 #define DUMP_NO             8
 #define FINE_RATIO          8
 #define FINE_SAMPLE_DLY     14
+/* Conversions per channel in a multi-channel scan, to fit in the FIFO */
+#define SCAN_SAMPLES        (IO_ADC0_FS / ADC_SCAN_MAX_CHANNELS)
+#define SCAN_DUMP_NO        2
 
 const ss_adc_cfg_data_t fine_config = {
 	.in_mode = SINGLED_ENDED,
@@ -172,44 +175,45 @@ static void ss_adc_disable(struct td_device *dev)
 	irq_unlock(saved);
 }
 
-static DRIVER_API_RC ss_adc_set_seq(struct td_device *dev, uint8_t channel_id)
+/* Build a sequence of nb_samples conversions of each channel */
+static DRIVER_API_RC ss_adc_set_seq(struct td_device *dev,
+				    const uint8_t *channel_ids,
+				    uint8_t nb_channels, uint8_t nb_samples)
 {
 	struct adc_info_t *info = dev->priv;
 	uint32_t ctrl = 0, reg_val = 0;
-	uint32_t i = 0, num_iters = 0;
+	uint32_t i = 0;
+	uint8_t channel;
 
 	ss_adc_enable(dev);
-	assert(REPEAT_TIME > 0);
+	assert(nb_channels > 0 && nb_samples > 0);
 
 	/* Setup sequence table */
-	info->seq_size = REPEAT_TIME;
+	info->seq_size = nb_channels * nb_samples;
+	assert(info->seq_size <= IO_ADC0_FS);
 
 	reg_val = READ_ARC_REG(info->reg_base + ADC_SET);
 	reg_val &= ADC_SEQ_SIZE_SET_MASK;
-	reg_val |= (((REPEAT_TIME - 1) & SIX_BITS_SET) << SEQ_ENTRIES_POS);
+	reg_val |= (((info->seq_size - 1) & SIX_BITS_SET) << SEQ_ENTRIES_POS);
 	reg_val &= ADC_FTL_SET_MASK;
 	reg_val |= ((info->seq_size - 1) << THRESHOLD_POS);
 	WRITE_ARC_REG(reg_val, info->reg_base + ADC_SET);
 
-	num_iters = REPEAT_TIME / 2;
-	if (num_iters > 0) {
-		reg_val =
-			((FINE_SAMPLE_DLY &
-			  ELEVEN_BITS_SET) << SEQ_DELAY_ODD_POS);
-		reg_val |= ((channel_id & FIVE_BITS_SET) << SEQ_MUX_ODD_POS);
-		reg_val |=
-			((FINE_SAMPLE_DLY &
-			  ELEVEN_BITS_SET) << SEQ_DELAY_EVEN_POS);
-		reg_val |= (channel_id & FIVE_BITS_SET);
-		for (i = 0; i < num_iters; i++)
-			WRITE_ARC_REG(reg_val, info->reg_base + ADC_SEQ);
-	}
-
-	if (0 != (REPEAT_TIME % 2)) {
+	/* Each write of ADC_SEQ sets two consecutive entries */
+	for (i = 0; i < info->seq_size; i += 2) {
+		channel = channel_ids[i / nb_samples];
 		reg_val =
 			((FINE_SAMPLE_DLY &
 			  ELEVEN_BITS_SET) << SEQ_DELAY_EVEN_POS);
-		reg_val |= (channel_id & FIVE_BITS_SET);
+		reg_val |= (channel & FIVE_BITS_SET);
+		if (i + 1 < info->seq_size) {
+			channel = channel_ids[(i + 1) / nb_samples];
+			reg_val |=
+				((FINE_SAMPLE_DLY &
+				  ELEVEN_BITS_SET) << SEQ_DELAY_ODD_POS);
+			reg_val |=
+				((channel & FIVE_BITS_SET) << SEQ_MUX_ODD_POS);
+		}
 		WRITE_ARC_REG(reg_val, info->reg_base + ADC_SEQ);
 	}
 
@@ -319,21 +323,29 @@ static int ss_adc_resume(struct td_device *dev)
 	return 0;
 }
 
-DRIVER_API_RC ss_adc_read(uint8_t channel_id, uint16_t *result_value)
+/*
+ * Run one sequence of nb_samples conversions per channel and return for each
+ * channel the average of its non null samples, the first dump_samples ones
+ * being discarded while the input settles.
+ */
+static DRIVER_API_RC ss_adc_scan(const uint8_t *channel_ids,
+				 uint8_t nb_channels, uint8_t nb_samples,
+				 uint8_t dump_samples, uint16_t *result_values)
 {
 	struct td_device *adc_dev = &pf_device_ss_adc;
 	struct adc_info_t *info = adc_dev->priv;
-	uint32_t data[REPEAT_TIME] = { 0 };
+	uint32_t data[IO_ADC0_FS] = { 0 };
 	DRIVER_API_RC ret = DRV_RC_OK;
 	uint32_t start_point;
-	int count = 0;
-	uint32_t temp_value = 0;
 	uint32_t reg_get_sample = 0;
+	uint32_t temp_value;
+	int count;
+	int i, j;
 
 	mutex_lock(info->adc_in_use, OS_WAIT_FOREVER);
 
 	ss_adc_set_config(adc_dev);
-	ss_adc_set_seq(adc_dev, channel_id);
+	ss_adc_set_seq(adc_dev, channel_ids, nb_channels, nb_samples);
 
 	start_point = get_uptime_ms();
 	reg_get_sample =
@@ -341,7 +353,7 @@ DRIVER_API_RC ss_adc_read(uint8_t channel_id, uint16_t *result_value)
 	while (1) {
 		uint32_t reg_val = READ_ARC_REG(info->reg_base + ADC_INTSTAT);
 		if (reg_val & ADC_INT_DATA_A) {
-			for (int i = 0; i < REPEAT_TIME; i++) {
+			for (i = 0; i < info->seq_size; i++) {
 				/* read sample */
 				WRITE_ARC_REG(reg_get_sample,
 					      info->reg_base + ADC_SET);
@@ -363,19 +375,37 @@ DRIVER_API_RC ss_adc_read(uint8_t channel_id, uint16_t *result_value)
 	}
 	ss_adc_disable(adc_dev);
 
-	for (int i = DUMP_NO; i < REPEAT_TIME; i++) {
-		if (data[i] != 0) {
-			temp_value += data[i];
-			count++;
+	for (j = 0; j < nb_channels; j++) {
+		temp_value = 0;
+		count = 0;
+		for (i = dump_samples; i < nb_samples; i++) {
+			if (data[j * nb_samples + i] != 0) {
+				temp_value += data[j * nb_samples + i];
+				count++;
+			}
 		}
+		result_values[j] = count ? temp_value / count : 0;
 	}
-
-	*result_value = temp_value / count;
 fail:
 	mutex_unlock(info->adc_in_use);
 	return ret;
 }
 
+DRIVER_API_RC ss_adc_read(uint8_t channel_id, uint16_t *result_value)
+{
+	return ss_adc_scan(&channel_id, 1, REPEAT_TIME, DUMP_NO, result_value);
+}
+
+DRIVER_API_RC ss_adc_read_multi(const uint8_t *channel_ids,
+				uint8_t nb_channels, uint16_t *result_values)
+{
+	if (nb_channels == 0 || nb_channels > ADC_SCAN_MAX_CHANNELS)
+		return DRV_RC_INVALID_CONFIG;
+
+	return ss_adc_scan(channel_ids, nb_channels, SCAN_SAMPLES, SCAN_DUMP_NO,
+			   result_values);
+}
+
 struct driver ss_adc_driver = {
 	.init = ss_adc_init,
 	.suspend = ss_adc_suspend,
@@ -1 +1,2 @@
 obj-$(CONFIG_FAT_FS) += diskio.o
+obj-$(CONFIG_FAT_FS) += fat_ftl.o
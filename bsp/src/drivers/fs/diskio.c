@@ -41,12 +41,8 @@
 #include <fs/fat/ffconf.h>
 #include <drivers/spi_flash.h>
 #include "machine.h"
-
-static uint32_t fs_flash_size = 0;
-static uint32_t fs_flash_page_size = 0;
-static uint32_t fs_flash_sector_size = 0;
-static uint32_t fs_flash_block_size = 0;
-static uint32_t fs_flash_large_block_size = 0;
+#include "util/misc.h"
+#include "fat_ftl.h"
 
 
 /*-----------------------------------------------------------------------*/
@@ -88,27 +84,19 @@ DSTATUS disk_initialize(
 	BYTE pdrv                               /* Physical drive number to identify the drive */
 	)
 {
-#if 0
-	/*
-	 * These values were pulled from spi_flash_defs.h and are kept here for
-	 * reference purposes.
-	 */
-	fs_flash_size = 0x1000000;              // memory size in bytes
-	fs_flash_page_size 0x100;               // page size in bytes
-	fs_flash_sector_size = 0x1000;          // sector size in bytes
-	fs_flash_block32k_size = 0x8000;        // block size in bytes
-	fs_flash_block_size = 0x10000;          // block size in bytes
-#endif
-
 	DSTATUS stat = STA_NOINIT;
 
-	/* Pull the IOCTL values from the SPI now and store them */
-	spi_flash_ioctl(NULL, &fs_flash_size, STORAGE_SIZE);
-	spi_flash_ioctl(NULL, &fs_flash_page_size, STORAGE_PAGE_SIZE);
-	fs_flash_sector_size = _MAX_SS;         // from ffconf.h
-	spi_flash_ioctl(NULL, &fs_flash_block_size, STORAGE_BLOCK_SIZE);
-	spi_flash_ioctl(NULL, &fs_flash_large_block_size,
-			STORAGE_LARGE_BLOCK_SIZE);
+	if (pdrv != 0) {
+		return STA_NOINIT;
+	}
+
+	/* The FTL sectors are the FatFs sectors */
+	BUILD_BUG_ON(_MAX_SS != FTL_SECTOR_SIZE);
+
+	/* Rebuild the logical to physical block map of the volume */
+	if (fat_ftl_init() != DRV_RC_OK) {
+		return stat;
+	}
 
 	stat &= ~STA_NOINIT;
 	return stat;
@@ -128,11 +116,8 @@ DRESULT disk_read(
 	)
 {
 	DRIVER_API_RC ret;
-	unsigned int retlen;
 	uint8_t *data = (uint8_t *)buff;
 	uint8_t status = 0;
-	uint32_t byte_count = 0;
-	uint32_t byte_sector = 0;
 	struct td_device *spi;
 
 	if (pdrv != 0 || count == 0 || buff == 0) {
@@ -152,10 +137,7 @@ DRESULT disk_read(
 		return RES_WRPRT;
 	}
 
-	byte_count = fs_flash_sector_size * count;
-	byte_sector = fs_flash_sector_size * sector;
-
-	ret = spi_flash_read_byte(spi, byte_sector, byte_count, &retlen, data);
+	ret = fat_ftl_read(data, sector, count);
 
 	if (ret != DRV_RC_OK) {
 		return RES_ERROR;
@@ -179,11 +161,8 @@ DRESULT disk_write(
 	)
 {
 	DRIVER_API_RC ret;
-	unsigned int retlen;
-	uint8_t *data = (uint8_t *)buff;
+	const uint8_t *data = (const uint8_t *)buff;
 	uint8_t status = 0;
-	uint32_t byte_count = 0;
-	uint32_t byte_sector = 0;
 
 	struct td_device *spi = (struct td_device *)&pf_sba_device_flash_spi0;
 
@@ -201,23 +180,14 @@ DRESULT disk_write(
 		return RES_WRPRT;
 	}
 
-	/* Erase before write */
-	ret = spi_flash_sector_erase(spi, sector, count);
+	/* Sectors are cached and written out of place by the FTL */
+	ret = fat_ftl_write(data, sector, count);
 
 	if (ret != DRV_RC_OK) {
 		return RES_ERROR;
 	}
 
-	byte_count = fs_flash_sector_size * count;
-	byte_sector = fs_flash_sector_size * sector;
-
-	ret = spi_flash_write_byte(spi, byte_sector, byte_count, &retlen, data);
-
-	if (ret != DRV_RC_OK) {
-		return RES_ERROR;
-	}
-
-	return ret;
+	return RES_OK;
 }
 #endif
 
@@ -237,21 +207,26 @@ DRESULT disk_ioctl(
 
 	switch (cmd) {
 	case CTRL_SYNC:
-		/* Wait for end of internal write process of the drive */
+		/* Write the cached blocks to flash */
+		if (fat_ftl_sync() != DRV_RC_OK) {
+			ret = RES_ERROR;
+		}
 		break;
 	case GET_SECTOR_COUNT:
-		/* Should be 4096 */
-		*(DWORD *)buff = fs_flash_size / fs_flash_sector_size;
+		*(DWORD *)buff = fat_ftl_sector_count();
 		break;
 	case GET_SECTOR_SIZE:
 		/* Should be 512 although the flash supports 4096 */
-		*(DWORD *)buff = fs_flash_sector_size;
+		*(DWORD *)buff = FTL_SECTOR_SIZE;
 		break;
 	case GET_BLOCK_SIZE:
-		/* BLOCK_SIZE is in unit of sectors */
-		*(DWORD *)buff = fs_flash_block_size / fs_flash_sector_size;
+		/* BLOCK_SIZE is in unit of sectors: f_mkfs() aligns the data
+		 * area on it, so that a cluster is stored in one FTL block */
+		*(DWORD *)buff = FTL_SECTORS_PER_BLOCK;
 		break;
 	case CTRL_TRIM:
+		/* Freed blocks stay mapped: unmapping them would need a
+		 * persistent record in the FTL area */
 		break;
 	default:
 		ret = RES_PARERR;
@@ -0,0 +1,577 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include "drivers/spi_flash.h"
+#include "machine.h"
+#include "util/misc.h"
+#include "fat_ftl.h"
+
+/*
+ * Layout of the FAT_FS_FTL area:
+ *
+ *   | meta 0 | meta 1 | block 0 | block 1 | ... | block FTL_NB_PEB - 1 |
+ *
+ * A meta sector holds a snapshot of the block map, written header last,
+ * followed by a log of records appended once a block has been programmed:
+ *
+ *   | header | leb_map | erase_count | record | record | ... | 0xff ... |
+ *
+ * The record of a block commits it. When the log is full, the map is
+ * written as a new snapshot to the other meta sector, so each meta sector
+ * is erased once every 2 * FTL_LOG_SIZE block writes.
+ */
+
+#define FTL_MAGIC               0x324c5446 /* "FTL2" */
+
+#define FTL_START_BLOCK         CONFIG_FAT_FS_FTL_START_BLOCK
+#define FTL_NB_META             2
+#define FTL_NB_PEB              (CONFIG_FAT_FS_FTL_NB_BLOCKS - FTL_NB_META)
+/* Physical blocks kept free so that a block can always be rewritten */
+#define FTL_NB_SPARE            MAX(2, FTL_NB_PEB / 32)
+#define FTL_NB_LEB              (FTL_NB_PEB - FTL_NB_SPARE)
+#define FTL_NB_CACHE            CONFIG_FAT_FS_FTL_CACHE_BLOCKS
+
+#define FTL_UNMAPPED            0xffff
+
+#define META_ADDR(meta)         ((FTL_START_BLOCK + (meta)) * FTL_ERASE_SIZE)
+#define PEB_ADDR(peb) \
+	((FTL_START_BLOCK + FTL_NB_META + (peb)) * FTL_ERASE_SIZE)
+
+struct ftl_meta_header {
+	uint32_t magic;
+	uint32_t seq;
+	uint16_t nb_peb;
+	uint16_t tables_crc;    /* CRC of leb_map and erase_count */
+	uint16_t pad;
+	uint16_t crc;           /* CRC of the fields above */
+};
+
+struct ftl_log_record {
+	uint16_t leb;
+	uint16_t peb;
+	uint16_t erase_count;
+	/* Detects records torn by a power loss */
+	uint16_t crc;
+};
+
+#define FTL_TABLES_OFFSET       sizeof(struct ftl_meta_header)
+#define FTL_ERASE_COUNT_OFFSET  (FTL_TABLES_OFFSET + FTL_NB_LEB * 2)
+#define FTL_LOG_OFFSET \
+	((FTL_ERASE_COUNT_OFFSET + FTL_NB_PEB * 2 + 7) & ~7)
+#define FTL_LOG_SIZE \
+	((FTL_ERASE_SIZE - FTL_LOG_OFFSET) / sizeof(struct ftl_log_record))
+/* Records read at once when replaying the log */
+#define FTL_LOG_CHUNK           32
+
+struct ftl_cache_block {
+	uint16_t leb;
+	bool dirty;
+	uint32_t last_use;
+	uint8_t data[FTL_ERASE_SIZE];
+};
+
+static uint16_t leb_map[FTL_NB_LEB];
+static uint16_t erase_count[FTL_NB_PEB];
+static uint32_t peb_used[(FTL_NB_PEB + 31) / 32];
+static uint8_t meta_cur;        /* Meta sector of the current snapshot */
+static uint32_t meta_seq;       /* Sequence number of the current snapshot */
+static uint16_t log_next;       /* Next free record of the log */
+static uint16_t alloc_cursor;
+static uint32_t use_counter;
+static struct ftl_cache_block cache[FTL_NB_CACHE];
+static struct fat_ftl_stats stats;
+
+#define FTL_SPI ((struct td_device *)&pf_sba_device_flash_spi0)
+
+static uint16_t ftl_crc16(uint16_t crc, const uint8_t *buf, uint32_t len)
+{
+	int i;
+
+	while (len--) {
+		crc ^= (uint16_t)*buf++ << 8;
+		for (i = 0; i < 8; i++)
+			crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+	}
+	return crc;
+}
+
+static uint16_t tables_crc(void)
+{
+	uint16_t crc;
+
+	crc = ftl_crc16(0xffff, (const uint8_t *)leb_map, sizeof(leb_map));
+	return ftl_crc16(crc, (const uint8_t *)erase_count,
+			 sizeof(erase_count));
+}
+
+static bool peb_is_used(uint16_t peb)
+{
+	return peb_used[peb / 32] & (1u << (peb % 32));
+}
+
+static void peb_set_used(uint16_t peb, bool used)
+{
+	if (used)
+		peb_used[peb / 32] |= 1u << (peb % 32);
+	else
+		peb_used[peb / 32] &= ~(1u << (peb % 32));
+}
+
+static void map_block(uint16_t leb, uint16_t peb)
+{
+	if (leb_map[leb] != FTL_UNMAPPED)
+		peb_set_used(leb_map[leb], false);
+	leb_map[leb] = peb;
+	if (peb != FTL_UNMAPPED)
+		peb_set_used(peb, true);
+}
+
+static bool header_valid(const struct ftl_meta_header *hdr)
+{
+	return hdr->magic == FTL_MAGIC && hdr->nb_peb == FTL_NB_PEB &&
+	       hdr->crc == ftl_crc16(0xffff, (const uint8_t *)hdr,
+				     offsetof(struct ftl_meta_header, crc));
+}
+
+static bool record_valid(const struct ftl_log_record *rec)
+{
+	return rec->leb < FTL_NB_LEB && rec->peb < FTL_NB_PEB &&
+	       rec->crc == ftl_crc16(0xffff, (const uint8_t *)rec,
+				     offsetof(struct ftl_log_record, crc));
+}
+
+/* Write the block map to the other meta sector, header last */
+static DRIVER_API_RC write_snapshot(void)
+{
+	struct ftl_meta_header hdr;
+	uint8_t meta = !meta_cur;
+	unsigned int retlen;
+	DRIVER_API_RC ret;
+
+	ret = spi_flash_sector_erase(FTL_SPI, FTL_START_BLOCK + meta, 1);
+	stats.erases++;
+	if (ret != DRV_RC_OK)
+		return ret;
+
+	ret = spi_flash_write_byte(FTL_SPI, META_ADDR(meta) + FTL_TABLES_OFFSET,
+				   sizeof(leb_map), &retlen,
+				   (uint8_t *)leb_map);
+	if (ret != DRV_RC_OK)
+		return ret;
+	ret = spi_flash_write_byte(FTL_SPI,
+				   META_ADDR(meta) + FTL_ERASE_COUNT_OFFSET,
+				   sizeof(erase_count), &retlen,
+				   (uint8_t *)erase_count);
+	if (ret != DRV_RC_OK)
+		return ret;
+
+	hdr.magic = FTL_MAGIC;
+	hdr.seq = meta_seq + 1;
+	hdr.nb_peb = FTL_NB_PEB;
+	hdr.tables_crc = tables_crc();
+	hdr.pad = 0xffff;
+	hdr.crc = ftl_crc16(0xffff, (const uint8_t *)&hdr,
+			    offsetof(struct ftl_meta_header, crc));
+	ret = spi_flash_write_byte(FTL_SPI, META_ADDR(meta), sizeof(hdr),
+				   &retlen, (uint8_t *)&hdr);
+	if (ret != DRV_RC_OK)
+		return ret;
+
+	meta_cur = meta;
+	meta_seq = hdr.seq;
+	log_next = 0;
+	stats.snapshots++;
+	return DRV_RC_OK;
+}
+
+/*
+ * Commit a new copy of a block, already programmed: append its record to
+ * the log, or write a snapshot of the updated map if the log is full.
+ */
+static DRIVER_API_RC commit_block(uint16_t leb, uint16_t peb)
+{
+	struct ftl_log_record rec;
+	uint16_t old = leb_map[leb];
+	unsigned int retlen;
+	DRIVER_API_RC ret;
+
+	map_block(leb, peb);
+	if (log_next < FTL_LOG_SIZE) {
+		rec.leb = leb;
+		rec.peb = peb;
+		rec.erase_count = erase_count[peb];
+		rec.crc = ftl_crc16(0xffff, (const uint8_t *)&rec,
+				    offsetof(struct ftl_log_record, crc));
+		ret = spi_flash_write_byte(FTL_SPI, META_ADDR(meta_cur) +
+					   FTL_LOG_OFFSET +
+					   log_next * sizeof(rec),
+					   sizeof(rec), &retlen,
+					   (uint8_t *)&rec);
+		if (ret == DRV_RC_OK)
+			log_next++;
+	} else {
+		ret = write_snapshot();
+	}
+	if (ret != DRV_RC_OK)
+		map_block(leb, old);
+	return ret;
+}
+
+/* Pick the least erased free physical block */
+static int alloc_peb(void)
+{
+	int best = -1;
+	uint16_t peb;
+	uint16_t i;
+
+	for (i = 0; i < FTL_NB_PEB; i++) {
+		peb = (alloc_cursor + i) % FTL_NB_PEB;
+		if (peb_is_used(peb))
+			continue;
+		if (best < 0 || erase_count[peb] < erase_count[best])
+			best = peb;
+	}
+	if (best >= 0)
+		alloc_cursor = (best + 1) % FTL_NB_PEB;
+	return best;
+}
+
+static DRIVER_API_RC flush_block(struct ftl_cache_block *c)
+{
+	unsigned int retlen;
+	DRIVER_API_RC ret;
+	int peb;
+
+	if (!c->dirty)
+		return DRV_RC_OK;
+
+	peb = alloc_peb();
+	if (peb < 0)
+		return DRV_RC_OUT_OF_MEM;
+
+	ret = spi_flash_sector_erase(FTL_SPI, FTL_START_BLOCK + FTL_NB_META +
+				     peb, 1);
+	stats.erases++;
+	if (erase_count[peb] < UINT16_MAX)
+		erase_count[peb]++;
+	if (ret != DRV_RC_OK)
+		return ret;
+
+	ret = spi_flash_write_byte(FTL_SPI, PEB_ADDR(peb), FTL_ERASE_SIZE,
+				   &retlen, c->data);
+	if (ret != DRV_RC_OK)
+		return ret;
+
+	ret = commit_block(c->leb, peb);
+	if (ret != DRV_RC_OK)
+		return ret;
+
+	c->dirty = false;
+	stats.blocks_written++;
+	return DRV_RC_OK;
+}
+
+static struct ftl_cache_block *find_cached(uint16_t leb)
+{
+	int i;
+
+	for (i = 0; i < FTL_NB_CACHE; i++)
+		if (cache[i].leb == leb)
+			return &cache[i];
+	return NULL;
+}
+
+/*
+ * Get the cache entry of a block, evicting the least recently used one if
+ * needed. The block content is not read if the caller overwrites all of it.
+ */
+static struct ftl_cache_block *get_cached(uint16_t leb, bool overwrite,
+					  DRIVER_API_RC *ret)
+{
+	struct ftl_cache_block *c = find_cached(leb);
+	unsigned int retlen;
+	int i;
+
+	*ret = DRV_RC_OK;
+	if (!c) {
+		c = &cache[0];
+		for (i = 1; i < FTL_NB_CACHE; i++)
+			if (cache[i].last_use < c->last_use)
+				c = &cache[i];
+		*ret = flush_block(c);
+		if (*ret != DRV_RC_OK)
+			return NULL;
+
+		c->leb = leb;
+		if (overwrite || leb_map[leb] == FTL_UNMAPPED) {
+			memset(c->data, 0xff, FTL_ERASE_SIZE);
+		} else {
+			stats.cache_misses++;
+			*ret = spi_flash_read_byte(FTL_SPI,
+						   PEB_ADDR(leb_map[leb]),
+						   FTL_ERASE_SIZE, &retlen,
+						   c->data);
+			if (*ret != DRV_RC_OK) {
+				c->leb = FTL_UNMAPPED;
+				return NULL;
+			}
+		}
+	}
+	c->last_use = ++use_counter;
+	return c;
+}
+
+/* Load the snapshot of a meta sector, false if it is not valid */
+static bool load_snapshot(uint8_t meta, const struct ftl_meta_header *hdr)
+{
+	unsigned int retlen;
+	uint16_t leb;
+	uint16_t peb;
+
+	if (spi_flash_read_byte(FTL_SPI, META_ADDR(meta) + FTL_TABLES_OFFSET,
+				sizeof(leb_map), &retlen,
+				(uint8_t *)leb_map) != DRV_RC_OK ||
+	    spi_flash_read_byte(FTL_SPI,
+				META_ADDR(meta) + FTL_ERASE_COUNT_OFFSET,
+				sizeof(erase_count), &retlen,
+				(uint8_t *)erase_count) != DRV_RC_OK ||
+	    tables_crc() != hdr->tables_crc)
+		return false;
+
+	memset(peb_used, 0, sizeof(peb_used));
+	for (leb = 0; leb < FTL_NB_LEB; leb++) {
+		peb = leb_map[leb];
+		if (peb == FTL_UNMAPPED)
+			continue;
+		if (peb >= FTL_NB_PEB || peb_is_used(peb))
+			return false;
+		peb_set_used(peb, true);
+	}
+	meta_cur = meta;
+	meta_seq = hdr->seq;
+	return true;
+}
+
+/*
+ * Replay the log of the current snapshot. Returns true if it ends with a
+ * record torn by a power loss: the log can not be appended to anymore.
+ */
+static bool replay_log(void)
+{
+	struct ftl_log_record recs[FTL_LOG_CHUNK];
+	const uint8_t *b;
+	unsigned int retlen;
+	uint16_t n;
+	uint16_t i;
+
+	for (log_next = 0; log_next < FTL_LOG_SIZE; log_next += n) {
+		n = MIN(FTL_LOG_CHUNK, FTL_LOG_SIZE - log_next);
+		if (spi_flash_read_byte(FTL_SPI, META_ADDR(meta_cur) +
+					FTL_LOG_OFFSET +
+					log_next * sizeof(recs[0]),
+					n * sizeof(recs[0]), &retlen,
+					(uint8_t *)recs) != DRV_RC_OK)
+			return true;
+
+		for (i = 0; i < n; i++) {
+			if (record_valid(&recs[i])) {
+				map_block(recs[i].leb, recs[i].peb);
+				erase_count[recs[i].peb] =
+					recs[i].erase_count;
+				continue;
+			}
+			log_next += i;
+			/* The end of the log is left erased */
+			for (b = (const uint8_t *)&recs[i];
+			     b < (const uint8_t *)&recs[n]; b++)
+				if (*b != 0xff)
+					return true;
+			return false;
+		}
+	}
+	return false;
+}
+
+DRIVER_API_RC fat_ftl_init(void)
+{
+	struct ftl_meta_header hdr[FTL_NB_META];
+	uint32_t sector_size = 0;
+	unsigned int retlen;
+	bool loaded = false;
+	DRIVER_API_RC ret;
+	uint8_t meta;
+	int i;
+
+	/* The map snapshot and a minimum log must fit in a meta sector */
+	BUILD_BUG_ON(FTL_LOG_OFFSET + 32 * sizeof(struct ftl_log_record) >
+		     FTL_ERASE_SIZE);
+
+	spi_flash_ioctl(NULL, &sector_size, STORAGE_SECTOR_SIZE);
+	if (sector_size != FTL_ERASE_SIZE)
+		return DRV_RC_INVALID_CONFIG;
+
+	memset(&stats, 0, sizeof(stats));
+	for (i = 0; i < FTL_NB_CACHE; i++) {
+		cache[i].leb = FTL_UNMAPPED;
+		cache[i].dirty = false;
+		cache[i].last_use = 0;
+	}
+	use_counter = 0;
+
+	for (meta = 0; meta < FTL_NB_META; meta++) {
+		ret = spi_flash_read_byte(FTL_SPI, META_ADDR(meta),
+					  sizeof(hdr[meta]), &retlen,
+					  (uint8_t *)&hdr[meta]);
+		if (ret != DRV_RC_OK)
+			return ret;
+	}
+
+	/* Newest valid snapshot first, the other one if its tables are bad */
+	meta = header_valid(&hdr[1]) && (!header_valid(&hdr[0]) ||
+					 (int32_t)(hdr[1].seq - hdr[0].seq) > 0);
+	for (i = 0; i < FTL_NB_META && !loaded; i++, meta = !meta)
+		loaded = header_valid(&hdr[meta]) &&
+			 load_snapshot(meta, &hdr[meta]);
+
+	if (!loaded) {
+		/* Unformatted area: start from an empty volume */
+		memset(leb_map, 0xff, sizeof(leb_map));
+		memset(peb_used, 0, sizeof(peb_used));
+		memset(erase_count, 0, sizeof(erase_count));
+		meta_cur = 1;
+		meta_seq = 0;
+		ret = write_snapshot();
+	} else if (replay_log()) {
+		/* Move the map away from the torn record */
+		ret = write_snapshot();
+	} else {
+		ret = DRV_RC_OK;
+	}
+	alloc_cursor = (meta_seq * 7 + log_next) % FTL_NB_PEB;
+	return ret;
+}
+
+uint32_t fat_ftl_sector_count(void)
+{
+	return FTL_NB_LEB * FTL_SECTORS_PER_BLOCK;
+}
+
+DRIVER_API_RC fat_ftl_read(uint8_t *buf, uint32_t sector, uint32_t count)
+{
+	struct ftl_cache_block *c;
+	unsigned int retlen;
+	DRIVER_API_RC ret;
+	uint32_t offset;
+	uint32_t n;
+	uint16_t leb;
+
+	if (sector + count > fat_ftl_sector_count())
+		return DRV_RC_OUT_OF_MEM;
+
+	while (count) {
+		leb = sector / FTL_SECTORS_PER_BLOCK;
+		offset = (sector % FTL_SECTORS_PER_BLOCK) * FTL_SECTOR_SIZE;
+		n = MIN(count, FTL_SECTORS_PER_BLOCK -
+			sector % FTL_SECTORS_PER_BLOCK);
+
+		/* Reads do not fill the cache, only writes do */
+		c = find_cached(leb);
+		if (c) {
+			memcpy(buf, &c->data[offset], n * FTL_SECTOR_SIZE);
+		} else if (leb_map[leb] == FTL_UNMAPPED) {
+			memset(buf, 0xff, n * FTL_SECTOR_SIZE);
+		} else {
+			ret = spi_flash_read_byte(FTL_SPI,
+						  PEB_ADDR(leb_map[leb]) +
+						  offset,
+						  n * FTL_SECTOR_SIZE, &retlen,
+						  buf);
+			if (ret != DRV_RC_OK)
+				return ret;
+		}
+		buf += n * FTL_SECTOR_SIZE;
+		sector += n;
+		count -= n;
+	}
+	return DRV_RC_OK;
+}
+
+DRIVER_API_RC fat_ftl_write(const uint8_t *buf, uint32_t sector,
+			    uint32_t count)
+{
+	struct ftl_cache_block *c;
+	DRIVER_API_RC ret;
+	uint32_t offset;
+	uint32_t n;
+	uint16_t leb;
+
+	if (sector + count > fat_ftl_sector_count())
+		return DRV_RC_OUT_OF_MEM;
+
+	stats.sectors_written += count;
+	while (count) {
+		leb = sector / FTL_SECTORS_PER_BLOCK;
+		offset = (sector % FTL_SECTORS_PER_BLOCK) * FTL_SECTOR_SIZE;
+		n = MIN(count, FTL_SECTORS_PER_BLOCK -
+			sector % FTL_SECTORS_PER_BLOCK);
+
+		c = get_cached(leb, n == FTL_SECTORS_PER_BLOCK, &ret);
+		if (!c)
+			return ret;
+		memcpy(&c->data[offset], buf, n * FTL_SECTOR_SIZE);
+		c->dirty = true;
+
+		buf += n * FTL_SECTOR_SIZE;
+		sector += n;
+		count -= n;
+	}
+	return DRV_RC_OK;
+}
+
+DRIVER_API_RC fat_ftl_sync(void)
+{
+	DRIVER_API_RC ret;
+	int i;
+
+	for (i = 0; i < FTL_NB_CACHE; i++) {
+		ret = flush_block(&cache[i]);
+		if (ret != DRV_RC_OK)
+			return ret;
+	}
+	return DRV_RC_OK;
+}
+
+const struct fat_ftl_stats *fat_ftl_get_stats(void)
+{
+	return &stats;
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __FAT_FTL_H__
+#define __FAT_FTL_H__
+
+#include <stdint.h>
+
+#include "drivers/data_type.h"
+
+/*
+ * Flash translation layer between the FatFs disk I/O glue and the SPI flash.
+ *
+ * The volume is made of logical erase blocks, each one holding
+ * FTL_SECTORS_PER_BLOCK FatFs sectors, stored in any free 4 kB physical
+ * sector of the FAT_FS_FTL area. A modified block is written to the least
+ * erased free physical sector, then its previous copy is released, so
+ * rewriting the FAT spreads over the whole area and a power loss during a
+ * write always leaves the previous copy valid.
+ *
+ * The block map is kept in the first two sectors of the area: a snapshot
+ * of the map, followed by a log of the blocks written since the snapshot.
+ * A block is a whole flash sector, reported to FatFs as its block size, so
+ * that a 4 kB cluster of an aligned volume is a single block.
+ *
+ * Writes go to a write-back cache of whole blocks, flushed when a block is
+ * evicted or on fat_ftl_sync().
+ */
+
+#define FTL_SECTOR_SIZE         512
+#define FTL_ERASE_SIZE          4096
+#define FTL_SECTORS_PER_BLOCK   (FTL_ERASE_SIZE / FTL_SECTOR_SIZE)
+
+struct fat_ftl_stats {
+	uint32_t sectors_written;       /* Sectors written by FatFs */
+	uint32_t blocks_written;        /* Blocks written to flash */
+	uint32_t erases;                /* Flash sectors erased */
+	uint32_t snapshots;             /* Block map snapshots written */
+	uint32_t cache_misses;          /* Blocks read from flash into the cache */
+};
+
+/**
+ * Mount the FTL area: load the block map snapshot and replay its log.
+ */
+DRIVER_API_RC fat_ftl_init(void);
+
+/**
+ * Number of FatFs sectors of the volume.
+ */
+uint32_t fat_ftl_sector_count(void);
+
+DRIVER_API_RC fat_ftl_read(uint8_t *buf, uint32_t sector, uint32_t count);
+
+DRIVER_API_RC fat_ftl_write(const uint8_t *buf, uint32_t sector,
+			    uint32_t count);
+
+/**
+ * Write all the modified blocks of the cache to flash.
+ */
+DRIVER_API_RC fat_ftl_sync(void);
+
+const struct fat_ftl_stats *fat_ftl_get_stats(void);
+
+#endif /* __FAT_FTL_H__ */
@@ -445,6 +445,7 @@ static void soc_gpio_ISR_proc(struct td_device *dev)
 	struct gpio_port *port = (struct gpio_port *)dev->priv;
 	struct gpio_info_struct *gpio_dev =
 		(struct gpio_info_struct *)port->config;
+	uint32_t levels;
 
 	// Save interrupt status
 	uint32_t status = GPIO_REG(gpio_dev, SOC_GPIO_INTSTATUS);
@@ -452,21 +453,19 @@ static void soc_gpio_ISR_proc(struct td_device *dev)
 	// Clear interrupt flag (write 1 to clear)
 	GPIO_REG(gpio_dev, SOC_GPIO_PORTA_EOI) = status;
 
-	for (i = 0; i < gpio_dev->no_bits; i++) {
-		if ((status & (1 << i))) {
-			if (gpio_dev->gpio_cb[i]) {
-				(gpio_dev->gpio_cb[i])(
-					!!(GPIO_REG(gpio_dev,
-						    SOC_GPIO_EXT_PORTA) &
-					   (1 << i)),
-					gpio_dev->gpio_cb_arg[i]);
-			} else {
-				assert(dev->powerstate == PM_NOT_INIT);
-				pr_info(LOG_MODULE_DRV,
-					"spurious isr: %d on %d", i,
-					dev->id);
-				soc_gpio_mask_interrupt(dev, i);
-			}
+	// Sample all the lines once, and only visit the pending ones
+	levels = GPIO_REG(gpio_dev, SOC_GPIO_EXT_PORTA);
+	while (status) {
+		i = __builtin_ctz(status);
+		status &= status - 1;
+		if (gpio_dev->gpio_cb[i]) {
+			(gpio_dev->gpio_cb[i])(!!(levels & (1u << i)),
+					       gpio_dev->gpio_cb_arg[i]);
+		} else {
+			assert(dev->powerstate == PM_NOT_INIT);
+			pr_info(LOG_MODULE_DRV, "spurious isr: %d on %d", i,
+				dev->id);
+			soc_gpio_mask_interrupt(dev, i);
 		}
 	}
 }
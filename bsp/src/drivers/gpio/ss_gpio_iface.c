@@ -420,7 +420,7 @@ const struct gpio_driver gpio_device_driver_ss = {
 static void ss_gpio_ISR_proc(void *param)
 {
 	unsigned int triggered_bit;
-	uint32_t shifted_bit;
+	uint32_t toggle, levels;
 	struct td_device *dev = (struct td_device *)param;
 	struct gpio_port *port = (struct gpio_port *)dev->priv;
 	struct gpio_info_struct *gpio_dev =
@@ -432,26 +432,21 @@ static void ss_gpio_ISR_proc(void *param)
 	// Clear interrupt flag (write 1 to clear)
 	WRITE_ARC_REG(status, gpio_dev->reg_base + PORTA_EOI);
 
-	for (triggered_bit = 0;
-	     triggered_bit < gpio_dev->no_bits;
-	     triggered_bit++) {
-		shifted_bit = (1 << triggered_bit);
-		if (status & shifted_bit) {
-			if (gpio_dev->pm_context.int_bothedge & shifted_bit) {
-				//toggling polarity
-				WRITE_ARC_REG((READ_ARC_REG(
-						       gpio_dev->reg_base
-						       + INT_POLARITY)) ^
-					      shifted_bit,
-					      gpio_dev->reg_base + INT_POLARITY);
-			}
-			if (gpio_dev->gpio_cb[triggered_bit]) {
-				(gpio_dev->gpio_cb[triggered_bit])(
-					!!(READ_ARC_REG(gpio_dev->reg_base +
-							EXT_PORTA) &
-					   (1 << triggered_bit)),
-					gpio_dev->gpio_cb_arg[triggered_bit]);
-			}
+	// Toggle the polarity of all the double edge lines at once
+	toggle = status & gpio_dev->pm_context.int_bothedge;
+	if (toggle)
+		WRITE_ARC_REG(READ_ARC_REG(gpio_dev->reg_base + INT_POLARITY) ^
+			      toggle, gpio_dev->reg_base + INT_POLARITY);
+
+	// Sample all the lines once, and only visit the pending ones
+	levels = READ_ARC_REG(gpio_dev->reg_base + EXT_PORTA);
+	while (status) {
+		triggered_bit = __builtin_ctz(status);
+		status &= status - 1;
+		if (gpio_dev->gpio_cb[triggered_bit]) {
+			(gpio_dev->gpio_cb[triggered_bit])(
+				!!(levels & (1u << triggered_bit)),
+				gpio_dev->gpio_cb_arg[triggered_bit]);
 		}
 	}
 }
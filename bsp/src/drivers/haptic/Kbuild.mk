@@ -1,2 +1,3 @@
 obj-$(CONFIG_DRV2605) += drv2605.o
+obj-$(CONFIG_DRV2605) += drv2605_seq.o
 obj-$(CONFIG_DRV2605_TCMD) += drv2605_tcmd.o
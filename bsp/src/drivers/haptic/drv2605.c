@@ -28,11 +28,15 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <string.h>
+
 #include "os/os.h"
 #include "infra/log.h"
 #include "infra/panic.h"
 #include "drivers/serial_bus_access.h"
 #include "infra/pm.h"
+#include "drivers/drv2605_seq.h"
+#include "util/assert.h"
 #include "drv2605.h"
 #include "drv2605_regs.h"
 
@@ -43,12 +47,17 @@
 /* According DRV2605 datasheet, maximum calibration time is 1200 ms */
 #define MAX_CALIBRATION_TIME_MS    1200
 
+/* Longest burst: waveform sequence and GO */
+#define BURST_MAX_LEN    (DRV2605_SEQ_SLOTS + 1)
+
+/* Delay between two checks of the end of a sequence */
+#define SEQ_END_POLL_MS    10
+
 /******************************************/
 /************* LOCAL FUNCTIONS ************/
 /******************************************/
 
 static void timer_step_callback(drv2605_info_t *vibr);
-static void program_one_wave(uint8_t wave, drv2605_info_t *vibr);
 static void vibr_reset(drv2605_info_t *vibr);
 static int8_t vibr_pattern_program_special(drv2605_info_t *vibr);
 static int8_t vibr_pattern_program_square_x2(drv2605_info_t *vibr);
@@ -68,46 +77,69 @@ static void wait_i2c_complete(drv2605_info_t *vibr)
 }
 
 /**
- * Function to read in DRV2605 register
- * @param  reg register to read
- * @param  err pointer to read status
+ * Function to read consecutive DRV2605 registers in one I2C transaction
+ * (the register address is auto-incremented)
+ * @param  reg first register to read
+ * @param  val buffer for the registers values
+ * @param  len number of registers to read
  * @param  vibr haptic device private info
- * @return register value
+ * @return read status
  */
-static int8_t drv260x_read_reg(uint8_t reg, DRIVER_API_RC *err,
-			       drv2605_info_t *vibr)
+static DRIVER_API_RC drv260x_read_regs(uint8_t reg, uint8_t *val, uint8_t len,
+				       drv2605_info_t *vibr)
 {
 	uint8_t trx_buff = reg;
-	uint8_t rx_buff = 0;
-
-	*err = DRV_RC_FAIL;
 
 	vibr->trx_request->tx_buff = &trx_buff;
-	vibr->trx_request->rx_buff = &rx_buff;
+	vibr->trx_request->rx_buff = val;
+	vibr->trx_request->rx_len = len;
 	if (sba_exec_request(vibr->trx_request) == DRV_RC_OK) {
 		/* Wait for transfert to complete */
 		wait_i2c_complete(vibr);
 		if (vibr->trx_request->status == 0)
-			*err = DRV_RC_OK;
+			return DRV_RC_OK;
 	}
+	return DRV_RC_FAIL;
+}
+
+/**
+ * Function to read in DRV2605 register
+ * @param  reg register to read
+ * @param  err pointer to read status
+ * @param  vibr haptic device private info
+ * @return register value
+ */
+static int8_t drv260x_read_reg(uint8_t reg, DRIVER_API_RC *err,
+			       drv2605_info_t *vibr)
+{
+	uint8_t rx_buff = 0;
+
+	*err = drv260x_read_regs(reg, &rx_buff, 1, vibr);
 
 	return rx_buff;
 }
 
 /**
- * Function to write in DRV2605 register
- * @param  reg register to write
- * @param  val value to write
+ * Function to write consecutive DRV2605 registers in one I2C transaction
+ * (the register address is auto-incremented)
+ * @param  reg first register to write
+ * @param  val values to write
+ * @param  len number of registers to write
  * @param  vibr haptic device private info
  * @return write status
  */
-static DRIVER_API_RC drv260x_write_reg(uint8_t reg, uint8_t val,
-				       drv2605_info_t *vibr)
+static DRIVER_API_RC drv260x_write_regs(uint8_t reg, const uint8_t *val,
+					uint8_t len, drv2605_info_t *vibr)
 {
 	DRIVER_API_RC rc = DRV_RC_FAIL;
-	uint8_t tx_buff[1][2] = { { reg, val } };
+	uint8_t tx_buff[BURST_MAX_LEN + 1];
 
-	vibr->tx_request->tx_buff = tx_buff[0];
+	assert(len <= BURST_MAX_LEN);
+	tx_buff[0] = reg;
+	memcpy(&tx_buff[1], val, len);
+
+	vibr->tx_request->tx_buff = tx_buff;
+	vibr->tx_request->tx_len = len + 1;
 	rc = sba_exec_request(vibr->tx_request);
 	if (rc == DRV_RC_OK) {
 		/* Wait for write to complete */
@@ -118,6 +150,19 @@ static DRIVER_API_RC drv260x_write_reg(uint8_t reg, uint8_t val,
 	return rc;
 }
 
+/**
+ * Function to write in DRV2605 register
+ * @param  reg register to write
+ * @param  val value to write
+ * @param  vibr haptic device private info
+ * @return write status
+ */
+static DRIVER_API_RC drv260x_write_reg(uint8_t reg, uint8_t val,
+				       drv2605_info_t *vibr)
+{
+	return drv260x_write_regs(reg, &val, 1, vibr);
+}
+
 /**
  * I2C callback function.
  * This function is called when an i2c communication is complete
@@ -168,36 +213,25 @@ static void init_requests_i2c(drv2605_info_t *vibr)
 static DRIVER_API_RC config_drv2605(drv2605_info_t *vibr, vibration_type type)
 {
 	DRIVER_API_RC rc = DRV_RC_OK;
-	uint8_t read_val;
 	uint8_t ctrl_3_val;
 	uint8_t ctrl_2_val;
 	uint8_t rated_voltage_val;
-
-	/* out of stand by + internal trig => MODE_REG = 0 */
-	rc = drv260x_write_reg(MODE_REG, 0, vibr);
+	/* MODE_REG: out of stand by + internal trig => 0
+	 * RTPIN_REG: set by the square patterns => 0
+	 * LIBRARY_SELECTION_REG: lib 4 : wave duration is about 140ms */
+	const uint8_t mode[] = { 0, 0, CURRENT_LIBRARY };
+	/* No over drive, sustain pos, sustain neg nor break => 0 */
+	const uint8_t time_offsets[] = { 0, 0, 0, 0 };
+	/* FEEDBACK_REG to CONTROL3_REG */
+	uint8_t ctrl[4];
+
+	/* Consecutive registers are written in one burst */
+	rc = drv260x_write_regs(MODE_REG, mode, sizeof(mode), vibr);
 
 	/* set mode */
-	/* No over drive => OVERDRIVE_REG = 0 */
-	if (rc == DRV_RC_OK)
-		rc = drv260x_write_reg(OVERDRIVE_REG, 0, vibr);
-	/* No sustain pos => SUSTAIN_POS_REG = 0 */
-	if (rc == DRV_RC_OK)
-		rc = drv260x_write_reg(SUSTAIN_POS_REG, 0, vibr);
-	/* No sustain neg => SUSTAIN_NEG_REG = 0 */
-	if (rc == DRV_RC_OK)
-		rc = drv260x_write_reg(SUSTAIN_NEG_REG, 0, vibr);
-	/* No BREAK => BREAK_REG = 0 */
 	if (rc == DRV_RC_OK)
-		rc = drv260x_write_reg(BREAK_REG, 0, vibr);
-	/* no LRA => FEEDBACK_REG & 0x7F */
-	if (rc == DRV_RC_OK) {
-		read_val = (uint8_t)drv260x_read_reg(FEEDBACK_REG, &rc, vibr);
-		rc = drv260x_write_reg(FEEDBACK_REG, read_val & 0x7F, vibr);
-	}
-	/* lib 4 : wave duration is about 140ms */
-	if (rc == DRV_RC_OK)
-		rc = drv260x_write_reg(LIBRARY_SELECTION_REG, CURRENT_LIBRARY,
-				       vibr);
+		rc = drv260x_write_regs(OVERDRIVE_REG, time_offsets,
+					sizeof(time_offsets), vibr);
 
 	if (type == VIBRATION_SPECIAL_EFFECTS) {
 		/* Use default value */
@@ -213,30 +247,22 @@ static DRIVER_API_RC config_drv2605(drv2605_info_t *vibr, vibration_type type)
 		rated_voltage_val = RATED_VOLTAGE_STRONGER;
 	}
 	/* Write register */
-	if (rc == DRV_RC_OK)
-		rc = drv260x_write_reg(CONTROL3_REG, ctrl_3_val, vibr);
-	if (rc == DRV_RC_OK)
-		rc = drv260x_write_reg(CONTROL2_REG, ctrl_2_val, vibr);
 	if (rc == DRV_RC_OK)
 		rc = drv260x_write_reg(RATED_VOLTAGE_REG, rated_voltage_val,
 				       vibr);
+	/* no LRA => FEEDBACK_REG & 0x7F, CONTROL1_REG unchanged */
+	if (rc == DRV_RC_OK)
+		rc = drv260x_read_regs(FEEDBACK_REG, ctrl, 2, vibr);
+	if (rc == DRV_RC_OK) {
+		ctrl[0] &= 0x7F;
+		ctrl[2] = ctrl_2_val;
+		ctrl[3] = ctrl_3_val;
+		rc = drv260x_write_regs(FEEDBACK_REG, ctrl, sizeof(ctrl), vibr);
+	}
 
 	return rc;
 }
 
-/**
- * This function initialise one wave register
- * @param  wave vibration wave id to play (1 < id < 127)
- * @param vibr haptic device private info
- * @return none
- */
-static void program_one_wave(uint8_t wave, drv2605_info_t *vibr)
-{
-	/* launch the wave */
-	drv260x_write_reg(WAVEQ1_REG, wave, vibr);
-	drv260x_write_reg(WAVEQ2_REG, 0, vibr);
-}
-
 /**
  * Timer callback function
  * This function is called each time a pattern duration is over
@@ -259,13 +285,8 @@ static void timer_step_callback(drv2605_info_t *vibr)
 		break;
 
 	case VIBRATION_SPECIAL_EFFECTS:
-		/* Increase pattern step to perform next special effect step */
-		vibr->pattern_step++;
-		/* Check if the pattern is finished */
-		if (vibr->pattern_step <= SPECIAL_EFFECT_5)
-			err_code = vibr_pattern_program_special(vibr);
-		else
-			vibr->type = VIBRATION_NONE;
+		/* Play the next sequence of the pattern, if any */
+		err_code = vibr_pattern_program_special(vibr);
 		break;
 
 	case VIBRATION_SQUARE_X2:
@@ -305,27 +326,11 @@ static void timer_step_callback(drv2605_info_t *vibr)
 	pm_wakelock_release(&vibr->wakelock);
 }
 
-/**
- * return library wave duration for specified library effect
- * refer to http://www.ti.com/lit/ds/symlink/drv2605.pdf
- * paragraph 11.2
- *
- * @param id the effect index
- * @return the duration of the special effect defaults to 50ms
- */
-int wave_duration(uint8_t id)
-{
-	int ret = 50;
-
-	switch (id) {
-	case 16: ret = 1000; break;
-	case 15: ret = 750; break;
-	}
-	return ret;
-}
-
 /**
  * Set the driver to perform a special effect pattern.
+ * The effects and off times are played by the DRV2605 waveform sequencer,
+ * eight slots at a time: the step timer only runs at the end of each
+ * sequence.
  * @param  vibr haptic device private info
  * @return pattern execution status
  */
@@ -333,59 +338,48 @@ static int8_t vibr_pattern_program_special(drv2605_info_t *vibr)
 {
 	OS_ERR_TYPE localErr = E_OS_OK;
 	int8_t err_code = DRV_RC_OK;
-
-	uint16_t tab_pattern[] = {
-		vibr->pattern->special_effect.effect_1,
-		vibr->pattern->special_effect.duration_off_1,
-		vibr->pattern->special_effect.effect_2,
-		vibr->pattern->special_effect.duration_off_2,
-		vibr->pattern->special_effect.effect_3,
-		vibr->pattern->special_effect.duration_off_3,
-		vibr->pattern->special_effect.effect_4,
-		vibr->pattern->special_effect.duration_off_4,
-		vibr->pattern->special_effect.effect_5
-	};
-
-	if (vibr->pattern_step > SPECIAL_EFFECT_5)
-		return DRV_RC_FAIL;
-
-	if (vibr->pattern_step % 2) {
-		/* odd patern step: wait for a duration off */
-		if (tab_pattern[vibr->pattern_step] > 0) {
-			timer_start(vibr->t_step,
-				    tab_pattern[vibr->pattern_step],
-				    &localErr);
-		} else {
+	DRIVER_API_RC rc;
+	struct drv2605_seq seq;
+	uint8_t regs[BURST_MAX_LEN];
+	uint8_t go;
+
+	if (vibr->pattern_step) {
+		/* Wait for the end of the previous sequence */
+		go = drv260x_read_reg(GO_REG, &rc, vibr);
+		if (rc != DRV_RC_OK) {
 			vibr->type = VIBRATION_NONE;
-			return DRV_RC_OK;
+			return rc;
 		}
-	} else {
-		/* even pattern step: start wave */
-		if (tab_pattern[vibr->pattern_step] >= FIRST_LIBRARY_WAVE_NUM
-		    && tab_pattern[vibr->pattern_step] <=
-		    LAST_LIBRARY_WAVE_NUM) {
-			program_one_wave(tab_pattern[vibr->pattern_step], vibr);
-			/* launch the wave */
-			err_code = drv260x_write_reg(GO_REG, 1, vibr);
-			if (err_code != DRV_RC_OK) {
-				vibr->type = VIBRATION_NONE;
-				return err_code;
-			}
-			/* Wait for wave duration */
-			timer_start(vibr->t_step,
-				    wave_duration(
-					    tab_pattern[vibr->pattern_step]),
-				    &localErr);
-		} else if (tab_pattern[vibr->pattern_step] == 0) {
-			/* If effect is 0 => pattern is stopped */
-			vibr->type = VIBRATION_NONE;
-			return DRV_RC_OK;
-		} else {
-			/* Invalid effect effect => pattern is stopped */
-			vibr->type = VIBRATION_NONE;
-			return (int8_t)DRV_RC_INVALID_OPERATION;
+		if (go & 0x01) {
+			timer_start(vibr->t_step, SEQ_END_POLL_MS, &localErr);
+			return localErr == E_OS_OK ? DRV_RC_OK : DRV_RC_FAIL;
 		}
 	}
+
+	if (drv2605_seq_special(&seq, &vibr->pattern->special_effect,
+				&vibr->pattern_step)) {
+		/* Invalid effect => pattern is stopped */
+		vibr->type = VIBRATION_NONE;
+		return (int8_t)DRV_RC_INVALID_OPERATION;
+	}
+
+	if (!seq.nb) {
+		/* Pattern is over */
+		vibr->type = VIBRATION_NONE;
+		return DRV_RC_OK;
+	}
+
+	/* Upload the sequence and launch it: GO_REG follows WAVEQ8_REG */
+	memcpy(regs, seq.slot, DRV2605_SEQ_SLOTS);
+	regs[GO_REG - WAVEQ1_REG] = 1;
+	err_code = drv260x_write_regs(WAVEQ1_REG, regs, sizeof(regs), vibr);
+	if (err_code != DRV_RC_OK) {
+		vibr->type = VIBRATION_NONE;
+		return err_code;
+	}
+
+	/* Wait for the sequence duration, and the off time after it */
+	timer_start(vibr->t_step, seq.duration, &localErr);
 	if (localErr != E_OS_OK)
 		err_code = DRV_RC_FAIL;
 
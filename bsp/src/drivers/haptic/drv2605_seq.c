@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+
+#include "drivers/drv2605_seq.h"
+#include "util/misc.h"
+#include "drv2605_regs.h"
+
+/* Pattern over, nothing more to compile */
+#define STEP_END (SPECIAL_EFFECT_5 + 1)
+
+/**
+ * return library wave duration for specified library effect
+ * refer to http://www.ti.com/lit/ds/symlink/drv2605.pdf
+ * paragraph 11.2
+ *
+ * @param effect the effect index
+ * @return the duration of the special effect defaults to 50ms
+ */
+uint16_t drv2605_wave_duration(uint8_t effect)
+{
+	switch (effect) {
+	case 16: return 1000;
+	case 15: return 750;
+	}
+	return 50;
+}
+
+int drv2605_seq_special(struct drv2605_seq *seq,
+			const vibration_special_effect_t *p, uint8_t *step)
+{
+	const uint16_t steps[STEP_END] = {
+		p->effect_1, p->duration_off_1,
+		p->effect_2, p->duration_off_2,
+		p->effect_3, p->duration_off_3,
+		p->effect_4, p->duration_off_4,
+		p->effect_5
+	};
+	uint16_t units;
+	uint8_t i, n;
+
+	memset(seq, 0, sizeof(*seq));
+
+	/* Check the effects up to the end of the pattern */
+	for (i = *step + (*step % 2); i < STEP_END && steps[i]; i += 2)
+		if (steps[i] > LAST_LIBRARY_WAVE_NUM)
+			return -1;
+
+	while (*step < STEP_END) {
+		if (!(*step % 2)) {
+			/* Effect, 0 ends the pattern */
+			if (!steps[*step]) {
+				*step = STEP_END;
+				break;
+			}
+			if (seq->nb == DRV2605_SEQ_SLOTS)
+				break;
+			seq->slot[seq->nb++] = steps[*step];
+			seq->duration += drv2605_wave_duration(steps[*step]);
+			(*step)++;
+			continue;
+		}
+
+		/* Off time: 0, or no next effect, ends the pattern */
+		if (!steps[*step] || !steps[*step + 1]) {
+			seq->duration += steps[*step];
+			*step = STEP_END;
+			break;
+		}
+		units = (steps[*step] + DRV2605_SEQ_WAIT_UNIT / 2) /
+			DRV2605_SEQ_WAIT_UNIT;
+		n = (units + DRV2605_SEQ_WAIT_MAX - 1) / DRV2605_SEQ_WAIT_MAX;
+		(*step)++;
+		if (seq->nb + n >= DRV2605_SEQ_SLOTS) {
+			/* No slot left for the next effect: wait on the CPU */
+			seq->duration += steps[*step - 1];
+			break;
+		}
+		seq->duration += units * DRV2605_SEQ_WAIT_UNIT;
+		while (units) {
+			n = MIN(units, DRV2605_SEQ_WAIT_MAX);
+			seq->slot[seq->nb++] = DRV2605_SEQ_WAIT | n;
+			units -= n;
+		}
+	}
+	return 0;
+}
@@ -1,4 +1,5 @@
 obj-$(CONFIG_SOC_LED) += soc_led.o
 obj-$(CONFIG_LP5562_LED) += lp5562.o
 obj-$(CONFIG_LP5562_LED) += lp5562_led.o
+obj-$(CONFIG_LP5562_LED) += lp5562_pattern.o
 obj-$(CONFIG_LED) += led_tcmd.o
@@ -0,0 +1,494 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+
+#include "drivers/led/lp5562_pattern.h"
+#include "util/misc.h"
+
+/* lp5562 instruction define tool */
+#define RAMP_UP_SIGN     (0 << 7)
+#define RAMP_DOWN_SIGN   (1 << 7)
+#define SHIFT_STEP_TIME(x) (x << 8)
+#define _15_6_MS_CYCLE_TIME (1 << 14)
+#define _0_49_MS_CYCLE_TIME 0 /* (0 << 14) */
+#define SHIFT_LOOP_COUNT(x) (x << 7)
+
+/* basic lp5562 instruction */
+#define RAMP_WAIT   0x0000
+#define SET_PWM     0x4000
+#define GO_TO_START 0x0000
+#define BRANCH      0xA000
+/* END: Set end status bit and set PWM value to 0 */
+#define END         0xD800
+#define TRIGGER     0xE000
+
+/* lp5562 insctruction */
+#define RAMP(w, x, y, z)   (RAMP_WAIT | w | SHIFT_STEP_TIME(x) | (y) | (z)) /* w=sign, x= steptime, y=increment, z=cycle_time*/
+#define RAMP_UP(x, y, z)   (RAMP_WAIT | RAMP_UP_SIGN | SHIFT_STEP_TIME(x) | \
+			    (y) | (z))                                                 /* x= steptime, y=increment, z=cycle_time*/
+#define RAMP_DOWN(x, y, z) (RAMP_WAIT | RAMP_DOWN_SIGN | SHIFT_STEP_TIME(x) | \
+			    (y) | (z))                                                   /* x= steptime, y=increment, z=cycle_time */
+#define WAIT(x, y)     (RAMP_WAIT | SHIFT_STEP_TIME(x) | (y) | RAMP_DOWN_SIGN) /* wait x * 0.49 or 15.6ms (depending of y) */
+
+#define SET_PWM_TO(x)  (SET_PWM | (x))
+#define BRANCH_TO(x, y)      (BRANCH | SHIFT_LOOP_COUNT(y) | (x)) /* x: PC, y: iteration number */
+#define SET_TRIGGER(x, y, z) (TRIGGER | ((x) << 1) | ((y) << 2) | ((z) << 3)) /* x: eng1, y: eng2, z: eng3*/
+#define WAIT_TRIGGER(x, y, z) (TRIGGER | ((x) << 7) | ((y) << 8) | ((z) << 9)) /* x: eng1, y: eng2, z: eng3*/
+
+#define NB_ENGINES           LP5562_NB_ENGINES
+#define NB_MAX_INSTRUCTIONS  LP5562_NB_INSTRUCTIONS
+
+/* Color index*/
+static const uint8_t colorIndex[3][3] = {
+	{ 0, 6, 12 },
+	{ 0, 6, 10 },
+	{ 0, 4, 10 }
+};
+
+/* End index*/
+static const uint8_t endIndex[3][3] = {
+	{ 5, 9, 15 },
+	{ 3, 9, 15 },
+	{ 3, 9, 13 }
+};
+
+/* Time index*/
+#define T1_ON_INDEX   1
+#define T1_OFF_INDEX  3
+#define T2_ON_INDEX   5
+#define T2_OFF_INDEX  9
+#define T3_ON_INDEX   11
+
+/* Indentation script makes this driver hard to read... */
+/* *INDENT-OFF* */
+
+/* The patterns used in this driver are generic.
+ * The configurable instructions must:
+ * - all set instructions are configured to 0
+ * - all ramp instructions have a null step time, with slow clock bit set
+ * - all branch instructions have a null loop count
+ */
+
+static const uint16_t pattern_blink_eng[NB_ENGINES][NB_MAX_INSTRUCTIONS]={{
+/* engine blue LED*/
+		SET_PWM_TO(0),         /* 0 */
+		WAIT(0, 0),            /* 1 */
+		BRANCH_TO(1, 0),       /* 2 */
+		SET_TRIGGER(0, 1, 1),  /* 3 */
+		SET_PWM_TO(0),         /* 4 */
+		WAIT_TRIGGER(0, 1, 0), /* 5 */
+		SET_PWM_TO(0),         /* 6 */
+		WAIT_TRIGGER(0, 0, 1), /* 7 */
+		SET_PWM_TO(0),         /* 8 */
+		WAIT(0, 0),            /* 9 */
+		BRANCH_TO(9, 0),       /* 10 */
+		SET_TRIGGER(0, 1, 1),  /* 11 */
+		SET_PWM_TO(0),         /* 12 */
+		WAIT_TRIGGER(0, 1, 0), /* 13 */
+		SET_PWM_TO(0),         /* 14 */
+		END,                   /* 15 */
+	},
+/* engine green LED*/
+	{
+		SET_PWM_TO(0),                  /* 0 */
+		WAIT_TRIGGER(1, 0, 0),          /* 1 */
+		SET_PWM_TO(0),                  /* 2 */
+		WAIT(0, 0),                     /* 3 */
+		BRANCH_TO(3, 0),                /* 4 */
+		SET_TRIGGER(1, 0, 1),           /* 5 */
+		SET_PWM_TO(0),                  /* 6 */
+		WAIT_TRIGGER(0, 0, 1),          /* 7 */
+		SET_PWM_TO(0),                  /* 8 */
+		WAIT_TRIGGER(1, 0, 0),          /* 9 */
+		SET_PWM_TO(0),                  /* 10 */
+		WAIT(0, 0),                     /* 11 */
+		BRANCH_TO(11, 0),               /* 12 */
+		SET_TRIGGER(1, 0, 1),           /* 13 */
+		SET_PWM_TO(0),                  /* 14 */
+		END                             /* 15 */
+	},
+/* engine red LED*/
+	{
+		SET_PWM_TO(0),         /* 0 */
+		WAIT_TRIGGER(1, 0, 0), /* 1 */
+		SET_PWM_TO(0),         /* 2 */
+		WAIT_TRIGGER(0, 1, 0), /* 3 */
+		SET_PWM_TO(0),         /* 4 */
+		WAIT(0, 0),            /* 5 */
+		BRANCH_TO(5, 0),       /* 6 */
+		SET_TRIGGER(1, 1, 0),  /* 7 */
+		SET_PWM_TO(0),         /* 8 */
+		WAIT_TRIGGER(1, 0, 0), /* 9 */
+		SET_PWM_TO(0),         /* 10 */
+		WAIT_TRIGGER(0, 1, 0), /* 11 */
+		SET_PWM_TO(0),         /* 12 */
+		END,                   /* 13 */
+		END,                   /* 14 */
+		END,                   /* 15 */
+	}
+};
+
+/*Ramp instruction config*/
+#define BASE_CLOCK LP5562_CLOCK
+#define FAST_CLOCK 2048
+#define SLOW_CLOCK 64
+#define FAST_CLOCK_DIV (BASE_CLOCK/FAST_CLOCK)
+#define SLOW_CLOCK_DIV (BASE_CLOCK/SLOW_CLOCK)
+#define MS_TO_TICK(delay) ((delay)*((BASE_CLOCK+500/2)/1000))
+#define LOOP_TICK 16 /* Clock cycles wasted for a branching */
+#define WAIT_MAX_CMD 63 /* Command on 7 bits */
+#define FAST_CLOCK_MAX_DELAY_MS (WAIT_MAX_CMD*1000/FAST_CLOCK)
+#define SLOW_CLOCK_MAX_DELAY_MS (WAIT_MAX_CMD*1000/SLOW_CLOCK)
+
+static void update_pattern_duration(struct lp5562_program *prog, const led_s *p, uint8_t nbColor)
+{
+	/* Update colors and duration */
+	prog->duration = 0;
+	for(uint8_t i = 0; i < (nbColor); i++) {
+		prog->duration += (p->duration[i].duration_on +
+				   p->duration[i].duration_off);
+	}
+
+	/* delete last t_off duration for the last repetition */
+	prog->last_duration =
+		prog->duration - p->duration[nbColor - 1].duration_off;
+}
+
+static void update_loop_cmd(uint16_t *cmd, uint8_t loop)
+{
+	if (loop == 0) {
+		/* If no loop needed, replace it with a set 0 command
+		 * This case should never happened */
+		cmd[0] = SET_PWM_TO(0);
+	} else {
+		cmd[0] |= BRANCH_TO(0, loop);
+	}
+}
+
+static void update_wait_generic(uint16_t *cmd, uint16_t delay, uint8_t loop)
+{
+	if (delay <= FAST_CLOCK_MAX_DELAY_MS*(1+loop)) {
+		/* Short delay, switch to fast clock */
+		cmd[0] = WAIT((MS_TO_TICK(delay/(1+loop))-LOOP_TICK+FAST_CLOCK_DIV/2)/(FAST_CLOCK_DIV), _0_49_MS_CYCLE_TIME);
+	} else {
+		/* Long delay, switch to slow clock */
+		cmd[0] = WAIT((MS_TO_TICK(delay/(1+loop))-LOOP_TICK+SLOW_CLOCK_DIV/2)/(SLOW_CLOCK_DIV), _15_6_MS_CYCLE_TIME);
+	}
+}
+
+static void update_wait_loop_cmd(uint16_t *cmd, uint16_t delay)
+{
+	/* We always want at least one loop
+	 * because we don't have a nop command */
+	uint8_t loop = 1;
+
+	/* If one wait loop is not enough, loop again */
+	if (delay > SLOW_CLOCK_MAX_DELAY_MS*(1+loop)) {
+		loop = (delay+SLOW_CLOCK_MAX_DELAY_MS-1)/SLOW_CLOCK_MAX_DELAY_MS-1;
+	}
+	/* Update wait command */
+	update_wait_generic(&cmd[0], delay, loop);
+	/* Update loop command */
+	update_loop_cmd(&cmd[1], loop);
+}
+
+int lp5562_compile_blink(struct lp5562_program *prog, const led_s *p,
+			 uint8_t nbColor, bool loop)
+{
+	uint16_t (*pattern)[NB_MAX_INSTRUCTIONS] = prog->eng;
+	int i;
+
+	memcpy(pattern, pattern_blink_eng, sizeof(pattern_blink_eng));
+
+	/* Update colors */
+	for(i = 0; i < (nbColor); i++) {
+		pattern[0][colorIndex[0][i]] = SET_PWM_TO(p->rgb[i].b);
+		pattern[1][colorIndex[1][i]] = SET_PWM_TO(p->rgb[i].g);
+		pattern[2][colorIndex[2][i]] = SET_PWM_TO(p->rgb[i].r);
+	}
+
+	update_pattern_duration(prog, p, nbColor);
+
+	/* Update Wait and loop */
+	update_wait_loop_cmd(&pattern[0][T1_ON_INDEX], p->duration[0].duration_on);
+	update_wait_loop_cmd(&pattern[1][T1_OFF_INDEX], p->duration[0].duration_off);
+	update_wait_loop_cmd(&pattern[2][T2_ON_INDEX], p->duration[1].duration_on);
+	update_wait_loop_cmd(&pattern[0][T2_OFF_INDEX], p->duration[1].duration_off);
+	update_wait_loop_cmd(&pattern[1][T3_ON_INDEX], p->duration[2].duration_on);
+
+	/* The third color has no off time slot: only one or two colors
+	 * patterns can loop in the engines, right after the last off time */
+	prog->looping = loop && nbColor < 3;
+
+	/* Update END*/
+	for(i = 0; i < NB_ENGINES; i++) {
+		if (prog->looping)
+			pattern[i][colorIndex[i][nbColor]] = BRANCH_TO(0, 0);
+		else
+			pattern[i][endIndex[i][nbColor - 1]] = END;
+	}
+
+	return prog->last_duration ? 0 : -1;
+}
+
+#ifdef CONFIG_LED_WAVE_SUPPORT
+/* Adjust ramp instruction to make them last the nearest duration possible,
+ * even if we lost color accuracy */
+static void adjust_and_fill_ramp(uint16_t data[][NB_MAX_INSTRUCTIONS], uint8_t nbColor)
+{
+	uint8_t i, j;
+	uint16_t ramp_duration_steptime;
+	uint16_t ramp_duration_ms;
+	uint32_t increment;
+	uint16_t minimum;
+
+	for(i = 0; i < nbColor; i++)
+	{
+		minimum = 0xFFFF;
+		for(j = 0; j < NB_ENGINES; j++)
+		{
+			/* check if it's not a simple delay or a "goto" sync instruction */
+			if(data[j][i*7] == BRANCH_TO(i*7+6, 0) ||
+			   data[j][i*7+2] == BRANCH_TO(i*7 + 7, 0)) {continue;}
+			ramp_duration_steptime =
+				((((data[j][i*7]) & 0x3F00) >> 8) *
+				((data[j][i*7]) & 0x007F));
+			ramp_duration_ms = ramp_duration_steptime * 1000 /
+				((data[j][i*7] & _15_6_MS_CYCLE_TIME)? SLOW_CLOCK : FAST_CLOCK);
+			if (minimum > ramp_duration_ms) minimum = ramp_duration_ms;
+		}
+		for(j = 0; j < NB_ENGINES; j++)
+		{
+			if(data[j][i*7] == BRANCH_TO(i*7+6, 0) ||
+			   data[j][i*7+2] == BRANCH_TO(i*7 + 7, 0)) {continue;}
+			increment = minimum *
+				((data[j][i*7] & _15_6_MS_CYCLE_TIME)? SLOW_CLOCK : FAST_CLOCK) /
+				(((data[j][i*7]) & 0x3F00) >> 8) / 1000;
+			data[j][i*7] &= 0xFF80;
+			data[j][i*7] |= increment & 0x7F;
+			data[j][i*7 + 1] = data[j][i*7];
+			data[j][i*7 + 2] = data[j][i*7 + 1] | RAMP_DOWN_SIGN;
+			data[j][i*7 + 3] = data[j][i*7 + 2];
+		}
+	}
+}
+
+static uint16_t set_ramp_instruction(uint16_t sign,
+				     uint16_t duration_ms,
+				     uint8_t pwm_value)
+{
+	uint8_t steptime;
+	uint32_t tmp_duration_us;
+	tmp_duration_us = (duration_ms * 1000) / pwm_value;
+
+	if(tmp_duration_us < (FAST_CLOCK_MAX_DELAY_MS*1000)) {
+		/* A null step time would be a ramp of no duration */
+		steptime = MAX((tmp_duration_us * FAST_CLOCK) / 1000000, 1);
+		return RAMP(sign, steptime, pwm_value, _0_49_MS_CYCLE_TIME);
+	} else if(tmp_duration_us < (SLOW_CLOCK_MAX_DELAY_MS*1000)) {
+		steptime = (tmp_duration_us * SLOW_CLOCK) / 1000000;
+		return RAMP(sign, steptime, pwm_value, _15_6_MS_CYCLE_TIME);
+	}
+	else return 0;
+}
+
+int lp5562_compile_wave(struct lp5562_program *prog, const led_s *p,
+			uint8_t nbColor, bool loop)
+{
+	uint8_t i, j = 0;
+	uint16_t (*pattern)[NB_MAX_INSTRUCTIONS] = prog->eng;
+	uint8_t color[NB_ENGINES][nbColor];
+
+	memset(prog->eng, 0, sizeof(prog->eng));
+
+	for(i = 0; i < nbColor; i++) {
+		color[0][i] = p->rgb[i].b;
+		color[1][i] = p->rgb[i].g;
+		color[2][i] = p->rgb[i].r;
+	}
+
+	for(i = 0; i < NB_ENGINES; i++) {
+		for(j = 0; j < nbColor; j++) {
+
+			if(color[0][j] < 2 && color[1][j] < 2 && color[2][j] < 2) {
+				/* add a delay to simulate an empty ramp
+				 * if there isn't any valid ramp. */
+				pattern[i][j*7+1] = BRANCH_TO(j*7, 0);
+				update_wait_loop_cmd(&pattern[i][j*7],
+						     p->duration[j].duration_on +
+						     p->duration[j].duration_on);
+				pattern[i][j*7+2] = BRANCH_TO(j*7 + 7, 0);
+				continue;
+			}
+
+			if(color[i][j] > 1) {
+				pattern[i][j*7] =
+					set_ramp_instruction(RAMP_UP_SIGN,
+						       (p->duration[j].duration_on >> 2),
+						       color[i][j] >> 1);
+				pattern[i][j*7 + 5] = BRANCH_TO(j*7 + 4, 0);
+				update_wait_loop_cmd(&pattern[i][j*7+4],
+						     p->duration[j].duration_off);
+				pattern[i][j*7+6] =
+					SET_TRIGGER(!(i == 0) && (color[0][j] < 2),
+						    !(i == 1) && (color[1][j] < 2),
+						    !(i == 2) && (color[2][j] < 2));
+			} else {
+				pattern[i][j*7] = BRANCH_TO(j*7+6, 0);
+				pattern[i][j*7+6] =
+					WAIT_TRIGGER(!(i == 0) && (color[0][j] > 1),
+						     !(i == 1) && (color[1][j] > 1),
+						     !(i == 2) && (color[2][j] > 1));
+			}
+		}
+		pattern[i][nbColor*7] = loop ? BRANCH_TO(0, 0) : END;
+	}
+	prog->looping = loop;
+
+	adjust_and_fill_ramp(pattern, nbColor);
+
+	update_pattern_duration(prog, p, nbColor);
+
+	return prog->last_duration ? 0 : -1;
+}
+#endif
+/* *INDENT-ON* */
+
+/* Instruction execution time, except for ramp and wait */
+#define INSTRUCTION_TICK 16
+/* Bound of the simulation, far above what 16 instructions can do */
+#define RUN_MAX_STEPS 20000
+
+struct engine_state {
+	uint32_t time;          /* time of the next instruction */
+	uint8_t pc;
+	uint8_t loop;           /* branch loop counter */
+	uint8_t triggers;       /* received triggers, one bit per engine */
+	bool waiting;           /* blocked on a trigger not received yet */
+	bool ended;
+};
+
+uint32_t lp5562_program_run_time(const struct lp5562_program *prog)
+{
+	struct engine_state e[NB_ENGINES];
+	struct engine_state *s;
+	uint32_t end = 0;
+	uint16_t ins;
+	uint8_t steptime, wait;
+	int i, n, step;
+
+	memset(e, 0, sizeof(e));
+
+	for (step = 0; step < RUN_MAX_STEPS; step++) {
+		/* Execute the engine which is the late one */
+		s = NULL;
+		for (i = 0, n = 0; i < NB_ENGINES; i++) {
+			n |= e[i].waiting;
+			if (!e[i].ended && !e[i].waiting &&
+			    (!s || e[i].time < s->time))
+				s = &e[i];
+		}
+		if (!s)
+			/* All ended, or deadlock */
+			return n ? 0 : end;
+		if (s->pc >= NB_MAX_INSTRUCTIONS)
+			/* Runs out of program memory, never ends */
+			return 0;
+
+		ins = prog->eng[s - e][s->pc];
+		switch (ins & 0xE000) {
+		case 0x0000:
+		case 0x2000:
+		case 0x4000:
+		case 0x6000:
+			steptime = (ins >> 8) & 0x3F;
+			if (steptime) {
+				/* Ramp or wait: one step per increment */
+				s->time += steptime * ((ins & _15_6_MS_CYCLE_TIME) ?
+						       SLOW_CLOCK_DIV :
+						       FAST_CLOCK_DIV) *
+					   ((ins & 0x7F) ? (ins & 0x7F) : 1);
+			} else {
+				/* Set PWM, null wait, or go to start */
+				s->time += INSTRUCTION_TICK;
+				if (ins == GO_TO_START) {
+					s->pc = 0;
+					continue;
+				}
+			}
+			s->pc++;
+			break;
+		case BRANCH:
+			s->time += INSTRUCTION_TICK;
+			n = (ins >> 7) & 0x3F;
+			if (!n)
+				/* Unconditional branch: never ends if backward */
+				s->pc = ins & 0x0F;
+			else if (s->loop < n) {
+				s->loop++;
+				s->pc = ins & 0x0F;
+			} else {
+				s->loop = 0;
+				s->pc++;
+			}
+			break;
+		case TRIGGER:
+			/* Send triggers, which wake up the engines waiting */
+			for (i = 0; i < NB_ENGINES; i++) {
+				if (!(ins & (1 << (i + 1))))
+					continue;
+				e[i].triggers |= 1 << (s - e);
+				if (e[i].waiting) {
+					e[i].waiting = false;
+					e[i].time = MAX(e[i].time, s->time);
+				}
+			}
+			/* Wait for triggers, latched until consumed */
+			wait = (ins >> 7) & 0x07;
+			if ((s->triggers & wait) != wait) {
+				s->waiting = true;
+				break;
+			}
+			s->triggers &= ~wait;
+			s->time += INSTRUCTION_TICK;
+			s->pc++;
+			break;
+		default:
+			/* END */
+			s->time += INSTRUCTION_TICK;
+			s->ended = true;
+			if (s->time > end)
+				end = s->time;
+			break;
+		}
+	}
+	return 0;
+}
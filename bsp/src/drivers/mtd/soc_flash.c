@@ -287,19 +287,16 @@ DRIVER_API_RC soc_flash_read(uint32_t address, unsigned int len,
 	return ret;
 }
 
-DRIVER_API_RC soc_flash_write(uint32_t address, unsigned int len,
-			      unsigned int *retlen,
-			      uint32_t *data)
+/* Write without taking the lock, the caller serializes the accesses */
+static DRIVER_API_RC flash_write(uint32_t address, unsigned int len,
+				 unsigned int *retlen,
+				 uint32_t *data)
 {
 	unsigned int i;
 	uint32_t offset, read_offset = 0;
 	int index, read_index;
 	DRIVER_API_RC ret = DRV_RC_OK;
 
-#ifndef CONFIG_OS_NONE
-	rwlock_wrlock(&rwlock, OS_WAIT_FOREVER);
-#endif
-
 	*retlen = 0;
 
 	if (len == 0) {
@@ -418,12 +415,32 @@ DRIVER_API_RC soc_flash_write(uint32_t address, unsigned int len,
 
 	*retlen = len;
 
+	return ret;
+}
+
+DRIVER_API_RC soc_flash_write(uint32_t address, unsigned int len,
+			      unsigned int *retlen,
+			      uint32_t *data)
+{
+	DRIVER_API_RC ret;
+
+#ifndef CONFIG_OS_NONE
+	rwlock_wrlock(&rwlock, OS_WAIT_FOREVER);
+#endif
+	ret = flash_write(address, len, retlen, data);
 #ifndef CONFIG_OS_NONE
 	rwlock_wrunlock(&rwlock);
 #endif
 	return ret;
 }
 
+DRIVER_API_RC soc_flash_panic_write(uint32_t address, unsigned int len,
+				    unsigned int *retlen,
+				    uint32_t *data)
+{
+	return flash_write(address, len, retlen, data);
+}
+
 DRIVER_API_RC soc_flash_block_erase(unsigned int	start_block,
 				    unsigned int	block_count)
 {
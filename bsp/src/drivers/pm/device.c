@@ -28,12 +28,16 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <zephyr.h>
 #include <stddef.h>
+#include <stdio.h>
 #include <errno.h>
 
 #include "infra/device.h"
 #include "infra/log.h"
 #include "infra/panic.h"
+#include "infra/time.h"
+#include "infra/tcmd/handler.h"
 #include "machine.h"
 
 static struct td_device **all_devices = NULL;
@@ -100,6 +104,41 @@ void init_devices(struct td_device **_all_devices, uint32_t _all_devices_count)
 	}
 }
 
+#ifdef CONFIG_DEVICE_PM_STATS
+static struct device_pm_stats pm_stats[CONFIG_DEVICE_PM_STATS_NB];
+
+static void account(uint8_t id, uint32_t start, bool suspend)
+{
+	uint32_t t = get_uptime_32k() - start;
+	struct device_pm_stats *s;
+
+	if (id >= CONFIG_DEVICE_PM_STATS_NB)
+		return;
+	s = &pm_stats[id];
+	if (t > UINT16_MAX)
+		t = UINT16_MAX;
+	if (suspend) {
+		s->suspend_count++;
+		s->suspend_total += t;
+		if (t > s->suspend_max)
+			s->suspend_max = t;
+	} else {
+		s->resume_count++;
+		s->resume_total += t;
+		if (t > s->resume_max)
+			s->resume_max = t;
+	}
+}
+
+int device_pm_get_stats(uint8_t id, struct device_pm_stats *stats)
+{
+	if (id >= CONFIG_DEVICE_PM_STATS_NB)
+		return -EINVAL;
+	*stats = pm_stats[id];
+	return 0;
+}
+#endif
+
 static void resume_device(struct td_device *dev)
 {
 	int ret = 0;
@@ -114,8 +153,17 @@ static void resume_device(struct td_device *dev)
 		/* Device already running */
 		return;
 
-	if (dev->driver->resume && (ret = dev->driver->resume(dev)))
-		goto err_resume_device;
+	if (dev->driver->resume) {
+#ifdef CONFIG_DEVICE_PM_STATS
+		uint32_t start = get_uptime_32k();
+#endif
+		ret = dev->driver->resume(dev);
+#ifdef CONFIG_DEVICE_PM_STATS
+		account(dev->id, start, false);
+#endif
+		if (ret)
+			goto err_resume_device;
+	}
 
 	/* Current device resumed */
 	dev->powerstate = PM_RUNNING;
@@ -129,30 +177,56 @@ err_resume_device:
 	panic(dev->id);
 }
 
-static void resume_devices_from_index(uint32_t i)
+int device_resume_on_demand(struct td_device *dev)
 {
-	int count = 0;
-	struct td_device *dev = NULL;
-	struct td_device **devices = NULL;
+	uint32_t saved = irq_lock();
 
-	if (i < all_devices_count) {
-		count = all_devices_count;
-		devices = all_devices;
-	} else {
-		i = i - all_devices_count;
-		count = board_devices_count;
-		devices = board_devices;
+	if (dev->pm_flags & DEVICE_PM_RESUMING) {
+		irq_unlock(saved);
+		return -EBUSY;
+	}
+	if (!(dev->pm_flags & DEVICE_PM_LAZY_RESUME) ||
+	    dev->powerstate != PM_SUSPENDED) {
+		irq_unlock(saved);
+		return 0;
 	}
+	dev->pm_flags |= DEVICE_PM_RESUMING;
+	irq_unlock(saved);
+
+	/* The resume callback may block */
+	resume_device(dev);
+
+	saved = irq_lock();
+	dev->pm_flags &= ~DEVICE_PM_RESUMING;
+	irq_unlock(saved);
+	return 0;
+}
 
-	for (; i < count; ++i) {
+void resume_device_array(struct td_device **devices, uint32_t count)
+{
+	struct td_device *dev;
+	uint32_t i;
+
+	for (i = 0; i < count; ++i) {
 		dev = devices[i];
+		if ((dev->pm_flags & DEVICE_PM_LAZY_RESUME) &&
+		    dev->powerstate == PM_SUSPENDED) {
+			/* Resumed on first use by its driver */
+#ifdef CONFIG_DEVICE_PM_STATS
+			if (dev->id < CONFIG_DEVICE_PM_STATS_NB)
+				pm_stats[dev->id].lazy_count++;
+#endif
+			continue;
+		}
 		resume_device(dev);
 	}
 }
 
 void resume_devices(void)
 {
-	resume_devices_from_index(0);
+	/* Use the init order: SoC devices, then extended board devices */
+	resume_device_array(all_devices, all_devices_count);
+	resume_device_array(board_devices, board_devices_count);
 }
 
 static int suspend_device(struct td_device *dev, PM_POWERSTATE state)
@@ -170,7 +244,13 @@ static int suspend_device(struct td_device *dev, PM_POWERSTATE state)
 		return ret;
 	}
 
+#ifdef CONFIG_DEVICE_PM_STATS
+	uint32_t start = get_uptime_32k();
+#endif
 	ret = dev->driver->suspend(dev, state);
+#ifdef CONFIG_DEVICE_PM_STATS
+	account(dev->id, start, true);
+#endif
 	if (!ret) {
 		dev->powerstate = state;
 	}
@@ -178,49 +258,86 @@ static int suspend_device(struct td_device *dev, PM_POWERSTATE state)
 	return ret;
 }
 
-int suspend_devices(PM_POWERSTATE state)
+int suspend_device_array(struct td_device **devices, uint32_t count,
+			 PM_POWERSTATE state)
 {
 	int32_t i;
 	int ret = 0;
-	struct td_device *dev = NULL;
 
 	/* Use the reverse order used for init, i.e. we suspend bus devices first,
 	 * then buses, then top level devices */
-	/* Suspend extended board devices firstly */
-	for (i = board_devices_count - 1; i >= 0; --i) {
-		dev = board_devices[i];
-
-		ret = suspend_device(dev, state);
-
+	for (i = count - 1; i >= 0; --i) {
+		ret = suspend_device(devices[i], state);
 		if (ret)
 			break;
 	}
 
-	if (!ret) {
-		/* Then suspend default and SoC devices */
-		for (i = all_devices_count - 1; i >= 0; --i) {
-			dev = all_devices[i];
-
-			ret = suspend_device(dev, state);
-
-			if (ret)
-				break;
-		}
-	} else {
-		/* Error occured on a extended board device,
-		 * Note: extended devices are ordered from all_devices_count to
-		 * board_devices_count.
-		 */
-		i += all_devices_count;
-	}
-
 	if (!ret)
 		return 0;
 
 	/* Suspend aborted, resume all devices starting from where we had
 	 * an issue */
 	if (state > PM_SHUTDOWN)
-		resume_devices_from_index(i + 1);
+		resume_device_array(&devices[i + 1], count - i - 1);
 
 	return -1;
 }
+
+int suspend_devices(PM_POWERSTATE state)
+{
+	/* Suspend extended board devices firstly */
+	if (suspend_device_array(board_devices, board_devices_count, state))
+		return -1;
+
+	/* Then suspend default and SoC devices */
+	if (suspend_device_array(all_devices, all_devices_count, state)) {
+		if (state > PM_SHUTDOWN)
+			resume_device_array(board_devices, board_devices_count);
+		return -1;
+	}
+
+	return 0;
+}
+
+#ifdef CONFIG_DEVICE_PM_TCMD
+/* Convert 32kHz ticks to us */
+#define TICKS_TO_US(t) ((uint32_t)(((uint64_t)(t) * 1000000) >> 15))
+
+/*
+ * Dump the suspend/resume callback statistics of the devices.
+ *
+ * Output: id, suspend count/max us/average us, resume count/max us/average
+ * us, and resumes avoided by lazy resume.
+ */
+void device_pm_tcmd(int argc, char *argv[], struct tcmd_handler_ctx *ctx)
+{
+	struct device_pm_stats s;
+	char buf[96];
+	uint8_t id;
+
+	for (id = 0; id < CONFIG_DEVICE_PM_STATS_NB; id++) {
+		uint32_t saved = irq_lock();
+		s = pm_stats[id];
+		irq_unlock(saved);
+		if (!s.suspend_count && !s.resume_count && !s.lazy_count)
+			continue;
+		snprintf(buf, sizeof(buf),
+			 "dev %u susp %u/%u/%u res %u/%u/%u lazy %u", id,
+			 (unsigned int)s.suspend_count,
+			 (unsigned int)TICKS_TO_US(s.suspend_max),
+			 (unsigned int)(s.suspend_count ?
+					TICKS_TO_US(s.suspend_total) /
+					s.suspend_count : 0),
+			 (unsigned int)s.resume_count,
+			 (unsigned int)TICKS_TO_US(s.resume_max),
+			 (unsigned int)(s.resume_count ?
+					TICKS_TO_US(s.resume_total) /
+					s.resume_count : 0),
+			 (unsigned int)s.lazy_count);
+		TCMD_RSP_PROVISIONAL(ctx, buf);
+	}
+	TCMD_RSP_FINAL(ctx, NULL);
+}
+
+DECLARE_TEST_COMMAND_ENG(pm, devices, device_pm_tcmd);
+#endif
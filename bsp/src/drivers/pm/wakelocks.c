@@ -32,7 +32,11 @@
 #include "infra/pm.h"
 #include "infra/device.h"
 #include "infra/log.h"
+#include "infra/time.h"
+#include "infra/tcmd/handler.h"
 #include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
 #include <errno.h>
 /*! Wakelock management structure */
 struct pm_wakelock_mgr {
@@ -63,11 +67,98 @@ void pm_wakelock_init(struct pm_wakelock *wli)
 {
 	wli->lock = 0;
 	wli->list.next = NULL;
+	wli->prev = NULL;
+#ifdef CONFIG_PM_WAKELOCK_STATS
+	wli->owner = __builtin_return_address(0);
+	wli->acquired_at = 0;
+	wli->stats.count = 0;
+	wli->stats.max = 0;
+	wli->stats.total = 0;
+	/* The memory may have held a freed wakelock: drop its statistics */
+	pm_wakelock_stats_remove(wli);
+#endif
 }
 
+#ifdef CONFIG_PM_WAKELOCK_STATS
+/*
+ * Statistics of the wakelocks with the longest cumulated hold time, keyed by
+ * wakelock address. pm_wakelock_init drops the entry of the address, so that
+ * a wakelock allocated where a freed one lived does not inherit its history.
+ * The table is small and bounded, so updating it keeps pm_wakelock_release
+ * constant time.
+ */
+static struct pm_wakelock_top wl_top[CONFIG_PM_WAKELOCK_STATS_NB];
+
+/* Called with interrupts locked */
+static void wakelock_account(struct pm_wakelock *wl)
+{
+	uint32_t held = get_uptime_32k() - wl->acquired_at;
+	struct pm_wakelock_top *e, *min = &wl_top[0];
+	int i;
+
+	wl->stats.count++;
+	wl->stats.total += held;
+	if (held > wl->stats.max)
+		wl->stats.max = held;
+
+	for (i = 0; i < CONFIG_PM_WAKELOCK_STATS_NB; i++) {
+		e = &wl_top[i];
+		if (e->wl == wl) {
+			e->owner = wl->owner;
+			e->stats.count++;
+			e->stats.total += held;
+			if (held > e->stats.max)
+				e->stats.max = held;
+			return;
+		}
+		if (e->stats.total < min->stats.total)
+			min = e;
+	}
+	/* Not tracked yet: evict the smallest entry if this one is bigger */
+	if (!min->wl || wl->stats.total > min->stats.total) {
+		min->wl = wl;
+		min->owner = wl->owner;
+		min->stats = wl->stats;
+	}
+}
+
+int pm_wakelock_get_top(struct pm_wakelock_top *top, int nb)
+{
+	struct pm_wakelock_top tmp;
+	int i, j, n = 0;
+	uint32_t saved = irq_lock();
+
+	for (i = 0; i < CONFIG_PM_WAKELOCK_STATS_NB && n < nb; i++)
+		if (wl_top[i].wl)
+			top[n++] = wl_top[i];
+	irq_unlock(saved);
+
+	/* Insertion sort on the cumulated hold time */
+	for (i = 1; i < n; i++) {
+		tmp = top[i];
+		for (j = i; j > 0 && top[j - 1].stats.total < tmp.stats.total;
+		     j--)
+			top[j] = top[j - 1];
+		top[j] = tmp;
+	}
+	return n;
+}
+
+void pm_wakelock_stats_remove(const struct pm_wakelock *wl)
+{
+	uint32_t saved = irq_lock();
+	int i;
+
+	for (i = 0; i < CONFIG_PM_WAKELOCK_STATS_NB; i++)
+		if (wl_top[i].wl == wl)
+			memset(&wl_top[i], 0, sizeof(wl_top[i]));
+	irq_unlock(saved);
+}
+#endif
+
 int pm_wakelock_acquire(struct pm_wakelock *wl)
 {
-	list_t *l;
+	struct pm_wakelock *tail;
 	int ret = 0;
 	// Acquire wakelock
 	uint32_t saved = irq_lock();
@@ -79,19 +170,19 @@ int pm_wakelock_acquire(struct pm_wakelock *wl)
 	pm_wakelock_set_any_wakelock_taken_on_cpu(true);
 
 	wl->lock = 1;
+#ifdef CONFIG_PM_WAKELOCK_STATS
+	wl->acquired_at = get_uptime_32k();
+#endif
 
-	if (!(l = pm_wakelock_inst.wl_list.head)) {
-		// List empty, add first item in the list
-		pm_wakelock_inst.wl_list.head = pm_wakelock_inst.wl_list.tail =
-							(list_t *)wl;
-		wl->list.next = NULL;
-	} else {
-		// Insert item  at the end of the list
-		for (; l->next; (l = l->next)) ;
-		pm_wakelock_inst.wl_list.tail = (list_t *)wl;
-		wl->list.next = l->next;
-		l->next = (list_t *)wl;
-	}
+	// Insert item at the end of the list
+	tail = (struct pm_wakelock *)pm_wakelock_inst.wl_list.tail;
+	wl->list.next = NULL;
+	wl->prev = tail;
+	if (tail)
+		tail->list.next = (list_t *)wl;
+	else
+		pm_wakelock_inst.wl_list.head = (list_t *)wl;
+	pm_wakelock_inst.wl_list.tail = (list_t *)wl;
 exit:
 	irq_unlock(saved);
 	return ret;
@@ -99,7 +190,6 @@ exit:
 
 int pm_wakelock_release(struct pm_wakelock *wl)
 {
-	list_t *l;
 	int ret = 0;
 
 	// Lock IRQs
@@ -112,37 +202,32 @@ int pm_wakelock_release(struct pm_wakelock *wl)
 	}
 	// Release wakelock
 	wl->lock = 0;
-	l = pm_wakelock_inst.wl_list.head;
-
-	if (l == (list_t *)wl) {
-		// Check if there is only one item in the wakelock list
-		if (pm_wakelock_inst.wl_list.tail == (list_t *)wl) {
-			pm_wakelock_inst.wl_list.head =
-				pm_wakelock_inst.wl_list.tail = NULL;
-			pm_wakelock_set_any_wakelock_taken_on_cpu(false);
-			// Call callback function to notify that all wakelocks are free
-			if (pm_wakelock_inst.cb != NULL) {
-				pm_wakelock_inst.cb(pm_wakelock_inst.cb_priv);
-			}
-		} else {
-			// release first item in the wakelock list
-			pm_wakelock_inst.wl_list.head = wl->list.next;
-		}
-	} else {
-		// Find wakelock in the list
-		for (; (l->next) && (l->next != (list_t *)wl); (l = l->next)) ;
-
-		if (l->next != NULL) {
-			// Item before wl found, remove wl item from the list
-			l->next = wl->list.next;
-
-			// Check if wl item is the last one in the list
-			if (pm_wakelock_inst.wl_list.tail == (list_t *)wl) {
-				pm_wakelock_inst.wl_list.tail = l;
-			}
-		} else {
-			//wl list clear
-			ret = -ENOENT;
+	if (!pm_wakelock_inst.wl_list.head) {
+		//wl list clear
+		ret = -ENOENT;
+		goto exit;
+	}
+#ifdef CONFIG_PM_WAKELOCK_STATS
+	wakelock_account(wl);
+#endif
+
+	// Unlink wl item from its neighbours
+	if (wl->prev)
+		wl->prev->list.next = wl->list.next;
+	else
+		pm_wakelock_inst.wl_list.head = wl->list.next;
+	if (wl->list.next)
+		((struct pm_wakelock *)wl->list.next)->prev = wl->prev;
+	else
+		pm_wakelock_inst.wl_list.tail = (list_t *)wl->prev;
+	wl->list.next = NULL;
+	wl->prev = NULL;
+
+	if (!pm_wakelock_inst.wl_list.head) {
+		pm_wakelock_set_any_wakelock_taken_on_cpu(false);
+		// Call callback function to notify that all wakelocks are free
+		if (pm_wakelock_inst.cb != NULL) {
+			pm_wakelock_inst.cb(pm_wakelock_inst.cb_priv);
 		}
 	}
 exit:
@@ -166,3 +251,57 @@ void pm_wakelock_set_list_empty_cb(void (*cb)(void *), void *priv)
 
 	irq_unlock(saved);
 }
+
+#ifdef CONFIG_PM_WAKELOCK_TCMD
+/* Convert 32kHz ticks to ms */
+#define TICKS_TO_MS(t) ((uint32_t)(((uint64_t)(t) * 1000) >> 15))
+
+/*
+ * Dump the wakelocks with the longest cumulated hold time, and the ones
+ * currently held.
+ *
+ * Owner is the return address of the pm_wakelock_init caller, to be resolved
+ * with addr2line.
+ */
+void pm_wakelocks_tcmd(int argc, char *argv[], struct tcmd_handler_ctx *ctx)
+{
+	struct pm_wakelock_top top[CONFIG_PM_WAKELOCK_STATS_NB];
+	struct pm_wakelock *wl;
+	char buf[80];
+	uint32_t now, saved;
+	int i, n;
+
+	n = pm_wakelock_get_top(top, CONFIG_PM_WAKELOCK_STATS_NB);
+	for (i = 0; i < n; i++) {
+		snprintf(buf, sizeof(buf),
+			 "wl %p owner %p cnt %u tot %u max %u ms",
+			 top[i].wl, top[i].owner,
+			 (unsigned int)top[i].stats.count,
+			 (unsigned int)TICKS_TO_MS(top[i].stats.total),
+			 (unsigned int)TICKS_TO_MS(top[i].stats.max));
+		TCMD_RSP_PROVISIONAL(ctx, buf);
+	}
+
+	/* Snapshot the held wakelocks, then print them outside of the lock */
+	saved = irq_lock();
+	now = get_uptime_32k();
+	wl = (struct pm_wakelock *)pm_wakelock_inst.wl_list.head;
+	for (n = 0; wl && n < CONFIG_PM_WAKELOCK_STATS_NB; n++) {
+		top[n].wl = wl;
+		top[n].owner = wl->owner;
+		top[n].stats.max = now - wl->acquired_at;
+		wl = (struct pm_wakelock *)wl->list.next;
+	}
+	irq_unlock(saved);
+
+	for (i = 0; i < n; i++) {
+		snprintf(buf, sizeof(buf), "held wl %p owner %p for %u ms",
+			 top[i].wl, top[i].owner,
+			 (unsigned int)TICKS_TO_MS(top[i].stats.max));
+		TCMD_RSP_PROVISIONAL(ctx, buf);
+	}
+	TCMD_RSP_FINAL(ctx, NULL);
+}
+
+DECLARE_TEST_COMMAND_ENG(pm, wakelocks, pm_wakelocks_tcmd);
+#endif
@@ -110,6 +110,8 @@ static int pm_sba_init(struct td_device *dev)
 	// Device initialized
 	sba_dev->controller_initialised = 1;
 	sba_bus_device_array[sba_dev->bus_id] = dev;
+	// Controller is only restored after a suspend when a request comes
+	dev->pm_flags |= DEVICE_PM_LAZY_RESUME;
 	return 0;
 }
 
@@ -463,6 +465,10 @@ DRIVER_API_RC sba_exec_request(sba_request_t *request)
 		(struct sba_master_cfg_data *)dev->priv;
 	// Form this point everything is fine
 
+	/* If another context is resuming the bus, the request is queued: that
+	 * context starts its own request once the resume is over, and the
+	 * queued ones follow from the transfer callback. */
+	device_resume_on_demand(dev);
 	if (sba_dev->controller_initialised != 1) {
 		return DRV_RC_FAIL;
 	}
@@ -471,6 +477,12 @@ DRIVER_API_RC sba_exec_request(sba_request_t *request)
 
 	uint32_t saved = irq_lock();
 
+	if (dev->pm_flags & DEVICE_PM_RESUMING) {
+		/* The resume re-initializes the bus and gates its clock */
+		list_add(&sba_dev->request_list, (list_t *)request);
+		irq_unlock(saved);
+		return rc;
+	}
 	sba_clock_enable(sba_dev);
 	if (sba_dev->current_request == NULL) {
 		sba_dev->current_request = request;
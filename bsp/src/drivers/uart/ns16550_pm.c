@@ -90,9 +90,15 @@ static int ns16550_pm_suspend(struct td_device *td_dev, PM_POWERSTATE state)
 static int ns16550_pm_resume(struct td_device *td_dev)
 {
 	struct ns16550_pm_device *pmdev = td_dev->priv;
+	int ret;
 
-	pmdev->zephyr_device->config->init(pmdev->zephyr_device);
+	ret = pmdev->zephyr_device->config->init(pmdev->zephyr_device);
+	if (ret)
+		return ret;
 	uart_console_init(td_dev);
+	/* Restart the transmission interrupted by the suspend */
+	if (pmdev->uart_tx_callback)
+		pmdev->uart_tx_callback(false);
 	return 0;
 }
 
@@ -100,6 +106,11 @@ void ns16550_pm_uart_ISR(struct td_device *dev)
 {
 	struct ns16550_pm_device *pmdev = (struct ns16550_pm_device *)dev->priv;
 
+	if (pmdev->uart_tx_callback &&
+	    uart_irq_update(pmdev->zephyr_device) &&
+	    uart_irq_tx_ready(pmdev->zephyr_device))
+		pmdev->uart_tx_callback(true);
+
 	if (pmdev->uart_rx_callback)
 		pmdev->uart_rx_callback();
 }
@@ -498,6 +498,9 @@ static void acm_ep_complete(int ep_address, void *priv, int status, int actual)
 			req->xfer_done(actual, req->data);
 		} else {
 			pr_debug(LOG_MODULE_USB, "status: %d", status);
+			/* The writer must know that the buffer is released */
+			if (req->direction == DIRECTION_WRITE)
+				req->xfer_done(-1, req->data);
 		}
 		bfree(req);
 		return;
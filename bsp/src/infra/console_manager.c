@@ -58,9 +58,10 @@ static bool active_backend[ARRAY_SIZE(console_backend)];
 
 static void multi_backend_puts(const char *s, uint16_t len);
 static bool is_multi_backend_ready();
+static void multi_backend_flush(void);
 
 struct log_backend log_backend_multi =
-{ multi_backend_puts, is_multi_backend_ready };
+{ multi_backend_puts, is_multi_backend_ready, multi_backend_flush };
 
 int console_manager_activate_log_backend(const char *	console_name,
 					 bool		activate)
@@ -93,6 +94,16 @@ static void multi_backend_puts(const char *s, uint16_t len)
 	}
 }
 
+static void multi_backend_flush(void)
+{
+	uint8_t i;
+
+	for (i = 0; i < no_of_backends; i++) {
+		if (active_backend[i] && console_backend[i]->log_backend->flush)
+			console_backend[i]->log_backend->flush();
+	}
+}
+
 static bool is_multi_backend_ready()
 {
 	uint8_t i = 0;
@@ -94,7 +94,7 @@ uint8_t cpu_id_to_logcore_id(uint8_t cpu_id)
 #if defined(CONFIG_LOG_MASTER) || !defined(CONFIG_LOG_MULTI_CPU_SUPPORT)
 
 /* The backend used to actually ouput text */
-static struct log_backend out_backend = { NULL, NULL };
+static struct log_backend out_backend = { NULL, NULL, NULL };
 
 void log_set_backend(struct log_backend backend)
 {
@@ -173,4 +173,10 @@ void output_one_message(const log_message_t *msg)
 				LOG_HEADER_LEN - 1 + buf_size + LOG_EOL_LEN);
 }
 
+void output_flush(void)
+{
+	if (out_backend.flush)
+		out_backend.flush();
+}
+
 #endif
@@ -87,6 +87,11 @@ typedef struct __packed log_message {
  */
 void output_one_message(const log_message_t *msg);
 
+/**
+ * Let the backend write out what it buffered, once no message is pending.
+ */
+void output_flush(void);
+
 bool log_check_backend(void);
 #endif
 
@@ -137,6 +137,7 @@ void log_flush()
 		return;
 	while (log_read_msg(&msg) > 0)
 		output_one_message(&msg);
+	output_flush();
 }
 
 /* Logger task. Should be lower prio than any other tasks that send messages. */
@@ -168,6 +169,7 @@ void log_task()
 						(void *)(&slavesdata[i].msg));
 				}
 			}
+			output_flush();
 		}
 	}
 }
@@ -258,6 +260,7 @@ static void log_extract_messages()
 		return;
 	while (log_read_msg(&rx_msg) > 0)
 		output_one_message(&rx_msg);
+	output_flush();
 }
 /**
  * Logger task; should be lower prio than any other task that
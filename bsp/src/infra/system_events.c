@@ -41,8 +41,11 @@
 #include "util/assert.h"
 
 /* SPI flash management */
-#include "cir_storage.h"
-#include "util/cir_storage_flash_spi.h"
+#include "util/event_journal.h"
+#include "util/workqueue.h"
+#include "drivers/spi_flash.h"
+#include "drivers/serial_bus_access.h"
+#include "soc_config.h"
 #include "project_mapping.h"
 
 /* Panic management */
@@ -54,18 +57,124 @@
 
 /* TODO: Use the commonly defined constant instead */
 #define PANIC_NVM_BASE (DEBUGPANIC_START_BLOCK * EMBEDDED_FLASH_BLOCK_SIZE)
+#define PANIC_NVM_END  ((DEBUGPANIC_START_BLOCK + DEBUGPANIC_NB_BLOCKS) * \
+			EMBEDDED_FLASH_BLOCK_SIZE)
 
 /* Align address on 32bits (add 3 then clear LSBs) */
 #define PANIC_ALIGN_32(x) (((uint32_t)(x) + 3) & ~(3))
 #define DEFAULT_ADDRESS ~(0)
 #define RTC_DRV_NAME "RTC"
 
+#define EVENTS_FLASH_ADDRESS (SPI_SYSTEM_EVENT_START_BLOCK * \
+			      SERIAL_FLASH_BLOCK_SIZE)
+
 DEFINE_LOG_MODULE(LOG_MODULE_SYSTEM_EVENTS, "SYEV")
 
-static cir_storage_t * storage = NULL;
+DECLARE_PANIC_DATA_FLASH(arcv2);
+DECLARE_PANIC_DATA_FLASH(x86);
+
+/* A panic header with the beginning of its data */
+union panic_flash_record {
+	struct panic_data_flash_header header;
+	struct arcv2_panic_data_flash arc;
+	struct x86_panic_data_flash x86;
+};
+
+/*
+ * Events are staged in the page buffer of the journal, which is programmed
+ * when full, CONFIG_SYSTEM_EVENTS_FLUSH_DELAY ms after the first staged
+ * event, on shutdown and before a readout.
+ */
+static struct event_journal journal;
+static bool journal_ready;
+static T_MUTEX journal_mutex;
+static T_TIMER flush_timer;
+static bool flush_armed;
+
+/*
+ * On panic the staged events are saved after the panic records, as a record
+ * of arch PANIC_DATA_ARCH_EVENTS, and programmed to the journal on the next
+ * boot. This is the first free address of the panic area found at boot.
+ */
+static uint32_t panic_events_addr = PANIC_NVM_END;
+
+/* Header of the saved events, followed by the staged journal bytes */
+struct panic_events_header {
+	struct panic_data_flash_header header;
+	uint32_t offset;        /* offset of the bytes in the journal */
+};
 
 static void store_panics(uint32_t);
 
+static int events_flash_read(void *priv, uint32_t offset, uint8_t *buf,
+			     uint32_t len)
+{
+	unsigned int retlen;
+
+	if (spi_flash_read_byte(&pf_sba_device_flash_spi0.dev,
+				EVENTS_FLASH_ADDRESS + offset,
+				len, &retlen, buf) != DRV_RC_OK)
+		return -1;
+	return 0;
+}
+
+static int events_flash_write(void *priv, uint32_t offset, const uint8_t *buf,
+			      uint32_t len)
+{
+	unsigned int retlen;
+
+	if (spi_flash_write_byte(&pf_sba_device_flash_spi0.dev,
+				 EVENTS_FLASH_ADDRESS + offset,
+				 len, &retlen, (uint8_t *)buf) != DRV_RC_OK)
+		return -1;
+	return 0;
+}
+
+static int events_flash_erase(void *priv, uint32_t sector)
+{
+	if (spi_flash_sector_erase(&pf_sba_device_flash_spi0.dev,
+				   SPI_SYSTEM_EVENT_START_BLOCK + sector,
+				   1) != DRV_RC_OK)
+		return -1;
+	return 0;
+}
+
+static const struct event_journal_ops events_flash_ops = {
+	.read = events_flash_read,
+	.write = events_flash_write,
+	.erase = events_flash_erase,
+};
+
+/* Must be called with the journal mutex locked */
+static void flush_locked(void)
+{
+	if (flush_armed) {
+		timer_stop(flush_timer);
+		flush_armed = false;
+	}
+	event_journal_flush(&journal);
+}
+
+/* Must be called with the journal mutex locked */
+static void arm_flush(void)
+{
+	if (!flush_armed && event_journal_pending(&journal)) {
+		flush_armed = true;
+		timer_start(flush_timer, CONFIG_SYSTEM_EVENTS_FLUSH_DELAY, NULL);
+	}
+}
+
+static void flush_work(void *data)
+{
+	system_events_flush();
+}
+
+static void flush_timer_cb(void *data)
+{
+	/* Flash accesses are done from the workqueue task */
+	workqueue_queue_work(flush_work, NULL);
+}
+
 void system_events_init()
 {
 	struct device *rtc_dev;
@@ -74,9 +183,17 @@ void system_events_init()
 
 	rtc_dev = device_get_binding(RTC_DRV_NAME);
 	assert(rtc_dev != NULL);
-	storage = cir_storage_flash_spi_init(SYSTEM_EVENT_SIZE,
-					     SPI_SYSTEM_EVENT_START_BLOCK,
-					     SPI_SYSTEM_EVENT_NB_BLOCKS);
+	journal_mutex = mutex_create();
+	flush_timer = timer_create(flush_timer_cb, NULL,
+				   CONFIG_SYSTEM_EVENTS_FLUSH_DELAY, false,
+				   false, NULL);
+	if (event_journal_init(&journal, &events_flash_ops,
+			       SERIAL_FLASH_BLOCK_SIZE,
+			       SPI_SYSTEM_EVENT_NB_BLOCKS,
+			       SYSTEM_EVENT_SIZE) == 0)
+		journal_ready = true;
+	else
+		pr_error(LOG_MODULE_SYSTEM_EVENTS, "Event journal init failed");
 
 	/* Initialization of absolute time using rtc if rtc not reseted at boot */
 	if (rtc_read(rtc_dev) > time())
@@ -91,103 +208,192 @@ void __attribute__((weak)) on_system_event_generated(struct system_event *evt)
 
 void system_event_push(struct system_event *event)
 {
-	if (storage) {
+	if (journal_ready) {
 		memcpy(event->h.hash, version_header.hash, sizeof(event->h.hash));
-		cir_storage_push(storage, (uint8_t *)event);
+		mutex_lock(journal_mutex, OS_WAIT_FOREVER);
+		event_journal_append(&journal, event);
+		arm_flush();
+		mutex_unlock(journal_mutex);
 		on_system_event_generated(event);
 	}
 }
 
-struct system_event *system_event_pop()
+void system_events_flush(void)
 {
-	if (storage) {
-		struct system_event *evt = balloc(SYSTEM_EVENT_SIZE, NULL);
-		cir_storage_err_t err = cir_storage_pop(storage, (uint8_t *)evt);
-		if (err == CBUFFER_STORAGE_SUCCESS)
-			return evt;
-		else {
-			bfree(evt);
-			return NULL;
-		}
+	if (journal_ready) {
+		mutex_lock(journal_mutex, OS_WAIT_FOREVER);
+		flush_locked();
+		mutex_unlock(journal_mutex);
+	}
+}
+
+void system_events_panic(void)
+{
+	struct panic_events_header rec;
+	const uint8_t *buf;
+	unsigned int retlen;
+	uint16_t len;
+
+	/*
+	 * The journal mutex is not taken: the panic may have interrupted its
+	 * owner, and only the bytes already staged are read.
+	 */
+	if (!journal_ready)
+		return;
+	len = event_journal_staged(&journal, &rec.offset, &buf);
+	if (!len || panic_events_addr + sizeof(rec) + len > PANIC_NVM_END)
+		return;
+
+	rec.header.magic = PANIC_DATA_MAGIC;
+	rec.header.struct_size = sizeof(rec) + len;
+	memcpy(&rec.header.build_cksum, version_header.hash,
+	       sizeof(version_header.hash));
+	rec.header.time = time();
+	rec.header.arch = PANIC_DATA_ARCH_EVENTS;
+	rec.header.struct_version = version_header.version;
+	rec.header.flags = PANIC_DATA_FLAG_FRAME_VALID |
+			   PANIC_DATA_FLAG_FRAME_BLE_AVAILABLE;
+	rec.header.reserved = 0;
+
+	/* Frames and records are 32 bits aligned in the page buffer */
+	if (soc_flash_panic_write(panic_events_addr, sizeof(rec) / 4, &retlen,
+				  (uint32_t *)&rec) == DRV_RC_OK)
+		soc_flash_panic_write(panic_events_addr + sizeof(rec),
+				      (len + 3) / 4, &retlen,
+				      (uint32_t *)buf);
+}
+
+void system_events_iter_init(struct event_journal_iter *iter)
+{
+	if (journal_ready) {
+		mutex_lock(journal_mutex, OS_WAIT_FOREVER);
+		flush_locked();
+		event_journal_iter_init(&journal, iter);
+		mutex_unlock(journal_mutex);
 	} else {
+		iter->done = true;
+	}
+}
+
+struct system_event *system_events_iter_next(struct event_journal_iter *iter)
+{
+	const void *evt = NULL;
+
+	if (journal_ready) {
+		mutex_lock(journal_mutex, OS_WAIT_FOREVER);
+		evt = event_journal_iter_next(iter, NULL);
+		mutex_unlock(journal_mutex);
+	}
+	return (struct system_event *)evt;
+}
+
+void system_events_consume(struct event_journal_iter *iter)
+{
+	if (journal_ready) {
+		mutex_lock(journal_mutex, OS_WAIT_FOREVER);
+		event_journal_consume(&journal, iter->next_seq);
+		arm_flush();
+		mutex_unlock(journal_mutex);
+	}
+}
+
+struct system_event *system_event_pop()
+{
+	struct event_journal_iter *iter;
+	struct system_event *evt = NULL;
+	struct system_event *next;
+
+	if (!journal_ready || !event_journal_unread(&journal))
 		return NULL;
+
+	iter = balloc(sizeof(*iter), NULL);
+	system_events_iter_init(iter);
+	next = system_events_iter_next(iter);
+	if (next) {
+		evt = balloc(SYSTEM_EVENT_SIZE, NULL);
+		memcpy(evt, next, SYSTEM_EVENT_SIZE);
+		system_events_consume(iter);
 	}
+	bfree(iter);
+	return evt;
 }
 
-static bool prepare_crash_event_to_store(
-	struct system_event *event_to_store,
-	struct panic_data_flash_header *
-	header,
-	uint32_t
-	panic_addr)
+static void prepare_crash_event_to_store(
+	struct system_event *		event_to_store,
+	const union panic_flash_record *record)
 {
-	unsigned int retlen;
-	DRIVER_API_RC ret;
-	bool event_completed = false;
-
-	union {
-		struct arcv2_panic_arch_data arc;
-		struct x86_panic_arch_data x86;
-	} *panic_data;
-	panic_data =
-		balloc(header->struct_size -
-		       sizeof(struct panic_data_flash_header),
-		       NULL);
-
-	ret = soc_flash_read(panic_addr + sizeof(*header),
-			     (header->struct_size -
-			      sizeof(*header)) / sizeof(uint32_t),
-			     &retlen,
-			     (uint32_t *)panic_data);
-
-	if (!ret && header->arch == ARC_CORE) {
-		event_completed = true;
+	if (record->header.arch == ARC_CORE) {
 		event_to_store->event_data.panic.cpu = SYSTEM_EVENT_PANIC_ARC;
 		event_to_store->event_data.panic.values[0] =
-			panic_data->arc.eret;
+			record->arc.arch_data.eret;
 		event_to_store->event_data.panic.values[1] =
-			panic_data->arc.ecr;
+			record->arc.arch_data.ecr;
 		event_to_store->event_data.panic.values[2] =
-			panic_data->arc.efa;
-		event_to_store->h.timestamp = header->time;
-	} else if (!ret) {
-		event_completed = true;
+			record->arc.arch_data.efa;
+	} else {
 		event_to_store->event_data.panic.cpu = SYSTEM_EVENT_PANIC_QUARK;
 		event_to_store->event_data.panic.values[0] =
-			panic_data->x86.eip;
+			record->x86.arch_data.eip;
 		event_to_store->event_data.panic.values[1] =
-			panic_data->x86.type;
+			record->x86.arch_data.type;
 		event_to_store->event_data.panic.values[2] =
-			panic_data->x86.error;
-		event_to_store->h.timestamp = header->time;
+			record->x86.arch_data.error;
 	}
-	bfree(panic_data);
-	return event_completed;
+	event_to_store->h.timestamp = record->header.time;
+}
+
+/* Program the events saved by system_events_panic() to the journal */
+static void restore_panic_events(uint32_t addr, uint32_t size)
+{
+	struct panic_events_header rec;
+	uint32_t data[EVENT_JOURNAL_PAGE_SIZE / sizeof(uint32_t)];
+	uint32_t len = size - sizeof(rec);
+	unsigned int retlen;
+	int ret;
+
+	if (!journal_ready || size <= sizeof(rec) || len > sizeof(data) ||
+	    soc_flash_read(addr, sizeof(rec) / 4, &retlen,
+			   (uint32_t *)&rec) != DRV_RC_OK ||
+	    soc_flash_read(addr + sizeof(rec), (len + 3) / 4, &retlen,
+			   data) != DRV_RC_OK)
+		return;
+
+	mutex_lock(journal_mutex, OS_WAIT_FOREVER);
+	ret = event_journal_restore(&journal, rec.offset, (uint8_t *)data, len);
+	mutex_unlock(journal_mutex);
+	if (ret)
+		pr_warning(LOG_MODULE_SYSTEM_EVENTS,
+			   "Events staged at panic not restored");
 }
 
 static void store_panics(uint32_t panic_addr)
 {
 	unsigned int retlen;
 	DRIVER_API_RC ret;
-	struct panic_data_flash_header *header =
-		balloc(sizeof(struct panic_data_flash_header), NULL);
-
-	/* Read flash to find panics */
-	while ((soc_flash_read(panic_addr,
-			       sizeof(struct panic_data_flash_header) /
-			       sizeof(uint32_t),
-			       &retlen,
-			       (uint32_t *)header) == DRV_RC_OK)) {
+	union panic_flash_record record;
+	struct system_event evt;
+
+	/* Read each panic header together with the data of its event */
+	while (panic_addr + sizeof(record.header) <= PANIC_NVM_END &&
+	       soc_flash_read(panic_addr,
+			      MIN(sizeof(record), PANIC_NVM_END - panic_addr) /
+			      sizeof(uint32_t),
+			      &retlen,
+			      (uint32_t *)&record) == DRV_RC_OK) {
 		/* If no panic, stop to search panics in flash */
-		if (header->magic != PANIC_DATA_MAGIC)
+		if (record.header.magic != PANIC_DATA_MAGIC ||
+		    record.header.struct_size < sizeof(record.header)) {
+			if (record.header.magic == 0xffffffff)
+				panic_events_addr = panic_addr;
 			break;
+		}
 
 		/* Panic shall be sent if valid and not already pulled */
-		if ((header->flags & PANIC_DATA_FLAG_FRAME_VALID) &&
-		    (header->flags & PANIC_DATA_FLAG_FRAME_BLE_AVAILABLE)) {
+		if ((record.header.flags & PANIC_DATA_FLAG_FRAME_VALID) &&
+		    (record.header.flags & PANIC_DATA_FLAG_FRAME_BLE_AVAILABLE)) {
 			/* Update header to not store again panic data */
-			header->flags = header->flags &
-					~PANIC_DATA_FLAG_FRAME_BLE_AVAILABLE;
+			record.header.flags = record.header.flags &
+					      ~PANIC_DATA_FLAG_FRAME_BLE_AVAILABLE;
 			/* Erase not needed because only one bit is modified from 1 to 0 */
 			ret = soc_flash_write(
 				panic_addr,
@@ -195,28 +401,27 @@ static void store_panics(uint32_t panic_addr)
 				       panic_data_flash_header) /
 				sizeof(uint32_t),
 				&retlen,
-				(uint32_t *)header);
+				(uint32_t *)&record.header);
 			if (ret) {
 				pr_error(LOG_MODULE_SYSTEM_EVENTS,
 					 "Header update failed");
 				break;
 			}
 
-			/* Store panic */
-			struct system_event evt;
-			evt.h.type = SYSTEM_EVENT_TYPE_PANIC;
-			evt.h.size = SYSTEM_EVENT_SIZE;
-
-			if (prepare_crash_event_to_store(&evt, header,
-							 panic_addr)) {
+			if (record.header.arch == PANIC_DATA_ARCH_EVENTS) {
+				restore_panic_events(
+					panic_addr, record.header.struct_size);
+			} else {
+				/* Store panic */
+				system_event_fill_header(&evt,
+							 SYSTEM_EVENT_TYPE_PANIC);
+				prepare_crash_event_to_store(&evt, &record);
 				system_event_push(&evt);
 			}
 		}
 		/* Here, panic magic found. Increment where ptr and start over */
-		panic_addr = PANIC_ALIGN_32(panic_addr + header->struct_size);
+		panic_addr = PANIC_ALIGN_32(panic_addr + record.header.struct_size);
 	}
-
-	bfree(header);
 }
 
 void system_event_fill_header(struct system_event *e, int type)
@@ -332,10 +537,13 @@ void dump_events(int argc, char **argv, struct tcmd_handler_ctx *ctx)
 		"NFC_READER"
 	};
 
+	struct event_journal_iter *iter = balloc(sizeof(*iter), NULL);
 	struct system_event *evt;
 
+	/* One flash read per page of events, no allocation per event */
+	system_events_iter_init(iter);
 	do {
-		evt = system_event_pop();
+		evt = system_events_iter_next(iter);
 		if (evt) {
 			if (evt->h.type < SYSTEM_EVENT_USER_RANGE_START) {
 #define TMP_BUF_SZ 80
@@ -403,9 +611,16 @@ void dump_events(int argc, char **argv, struct tcmd_handler_ctx *ctx)
 			} else {
 				project_dump_event(evt, ctx);
 			}
-			bfree(evt);
 		}
 	} while (evt);
+	system_events_consume(iter);
+	if (iter->lost) {
+		char buf[24];
+		snprintf(buf, sizeof(buf), "%u events lost",
+			 (unsigned int)iter->lost);
+		TCMD_RSP_PROVISIONAL(ctx, buf);
+	}
+	bfree(iter);
 	TCMD_RSP_FINAL(ctx, NULL);
 }
 
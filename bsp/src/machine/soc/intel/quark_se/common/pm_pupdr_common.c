@@ -108,6 +108,7 @@ void pm_shutdown_request(enum pupdr_request req, int param)
 
 #ifdef CONFIG_SYSTEM_EVENTS
 	system_event_push_shutdown(req, param);
+	system_events_flush();
 #endif
 
 	/* Call pm_shutdown_hook if exists */
@@ -14,5 +14,6 @@ obj-y += boot.o
 obj-$(CONFIG_QUARK_SE_PROPERTIES_STORAGE) += properties_storage_soc_flash.o
 obj-y += pm_pupdr.o
 obj-y += idle.o
+obj-$(CONFIG_DEEPSLEEP) += idle_gov.o
 obj-y += pm_pupdr_tcmd.o
-cflags-$(CONFIG_PROFILING) += -finstrument-functions -finstrument-functions-exclude-file-list=idle.c
+cflags-$(CONFIG_PROFILING) += -finstrument-functions -finstrument-functions-exclude-file-list=idle.c,idle_gov.c
@@ -45,21 +45,19 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "util/compiler.h"
-
-/* Minimum deeplseep duration in ms */
-#define DEEP_SLEEP_MIN_DURATION 10
-/* Minimum deeplseep duration in 32k base */
-#define DEEP_SLEEP_MIN_DURATION_32K (DEEP_SLEEP_MIN_DURATION * 32768 / 1000)
-/* Estimated wakeup delay in ms */
-#define ESTIMATED_WAKEUP_DELAY  3
-/* Estimated wakeup delay in 32k base */
-#define ESTIMATED_WAKEUP_DELAY_32K (ESTIMATED_WAKEUP_DELAY * 32768 / 1000)
+#include "idle_gov.h"
 
 static uint32_t cycle_count = 0;
 static uint32_t cycle_idle = 0;
 static volatile uint32_t start = 0;
 
 static bool enable_deep_sleep = true;
+
+static struct idle_gov gov = IDLE_GOV_INIT;
+/* Programmed AONPT expiry of the current deep sleep */
+static uint32_t expiry;
+/* Start of the current shallow idle period */
+static uint32_t idle_start;
 #endif /* CONFIG_DEEPSLEEP */
 
 /* AONPT interruption stub */
@@ -159,11 +157,17 @@ int32_t _tickless_idle_hook(int32_t ticks)
 		pm_shutdown();
 	}
 #ifdef CONFIG_DEEPSLEEP
-	if (
-		!enable_deep_sleep ||
-		ticks < DEEP_SLEEP_MIN_DURATION ||
-		!pm_is_deepsleep_allowed()) {
+	enum idle_reject reject = IDLE_REJECT_NB;
+
+	if (!enable_deep_sleep)
+		reject = IDLE_REJECT_DISABLED;
+	else if (ticks < DEEP_SLEEP_MIN_DURATION)
+		reject = IDLE_REJECT_TIMER;
+	else if (!pm_is_deepsleep_allowed())
+		reject = IDLE_REJECT_LOCKED;
+	if (reject != IDLE_REJECT_NB) {
 		/* We won't go to deep sleep */
+		gov.reject[reject]++;
 		return 0;
 	}
 
@@ -185,6 +189,8 @@ int32_t _tickless_idle_hook(int32_t ticks)
 		 * Wait for a future call of this function, when the ARC has set its next
 		 * wakeup time */
 		if (arc_timeout < 0) {
+			gov.reject[IDLE_REJECT_ARC]++;
+			start = 0;
 			return 0;
 		}
 
@@ -193,23 +199,37 @@ int32_t _tickless_idle_hook(int32_t ticks)
 		timeout = qrk_timeout;
 	}
 
-	/* Check that final deep sleep duration is above threshold */
-	if ((timeout - ESTIMATED_WAKEUP_DELAY_32K) <
-	    DEEP_SLEEP_MIN_DURATION_32K) {
+	/* Check that the predicted deep sleep duration is above break-even */
+	uint32_t margin = idle_gov_wakeup_margin(&gov);
+
+	if (!idle_gov_select(&gov, timeout)) {
+		/* Measure the shallow idle period to refine the prediction,
+		 * and let the AONPT end it if it lasts too long */
+		idle_start = start;
+		if (gov.promote) {
+			qrk_aonpt_configure(gov.promote, NULL, true);
+			qrk_aonpt_start();
+		}
+		start = 0;
 		return 0;
 	}
-	qrk_aonpt_configure(timeout - ESTIMATED_WAKEUP_DELAY_32K, NULL, true);
+	expiry = start + timeout - margin;
+	qrk_aonpt_configure(timeout - margin, NULL, true);
 	qrk_aonpt_start();
 
 	/* Publish final wakeup time to let ARC a last chance to cancel deepsleep */
 	shared_data->soc_next_wakeup = start + timeout;
 
 	if (pm_core_deepsleep()) {
+		gov.wake[IDLE_WAKE_ABORTED]++;
 		start = 0;
 		qrk_aonpt_stop();
 		return 0; /* Deepsleep failed */
 	}
 
+	/* Learn the resume latency from timer wakeups */
+	idle_gov_resumed(&gov, (int32_t)(get_uptime_32k() - expiry));
+
 	/* Force interrupt enabling as it will not
 	 * be done in os idle func */
 	__asm__ __volatile__ ("sti;");
@@ -243,13 +263,26 @@ int32_t _tickless_idle_hook_exit()
 {
 #ifdef CONFIG_DEEPSLEEP
 	if (!start) {
+		if (idle_start) {
+			/* Cancel the promotion timer if another source ended
+			 * the shallow idle period */
+			if (gov.promote)
+				qrk_aonpt_stop();
+			idle_gov_idle_done(&gov, false,
+					   get_uptime_32k() - idle_start);
+			idle_start = 0;
+		}
 		return 0;
 	}
 
+	/* The deep sleep timer is still armed after an early wakeup */
+	qrk_aonpt_stop();
+
 	/* Compute deepsleep ticks */
-	int32_t ret =
-		(((uint64_t)(get_uptime_32k() - start)) * 1000 + 16383) / 32768;
+	uint32_t elapsed = get_uptime_32k() - start;
+	int32_t ret = (((uint64_t)elapsed) * 1000 + 16383) / 32768;
 	start = 0;
+	idle_gov_idle_done(&gov, true, elapsed);
 
 	cycle_count++;
 	cycle_idle += ret;
@@ -291,6 +324,54 @@ void pm_stat_tcmd(int argc, char *argv[], struct tcmd_handler_ctx *ctx)
 }
 DECLARE_TEST_COMMAND(system, slpstat, pm_stat_tcmd);
 
+static void print_hist(struct tcmd_handler_ctx *ctx, const char *name,
+		       const uint32_t *hist, int nb)
+{
+	char buffer[100];
+	int i, len;
+
+	len = snprintf(buffer, sizeof(buffer), "%s:", name);
+	for (i = 0; i < nb; i++)
+		len += snprintf(buffer + len, sizeof(buffer) - len, " %u",
+				(unsigned int)hist[i]);
+	TCMD_RSP_PROVISIONAL(ctx, buffer);
+}
+
+/*
+ * Dump the deep sleep governor state and histograms.
+ *
+ * Residency buckets are <1ms, <2ms, <4ms ... >=256ms. The correction factors
+ * (in 1/1024) are per expected duration, <1ms, <2ms, <4ms ... >=1024ms.
+ */
+void pm_govstat_tcmd(int argc, char *argv[], struct tcmd_handler_ctx *ctx)
+{
+	char buffer[100];
+
+	snprintf(buffer, sizeof(buffer),
+		 "latency: %u margin: %u break-even: %u (32k ticks)",
+		 (unsigned int)idle_gov_latency(&gov),
+		 (unsigned int)idle_gov_wakeup_margin(&gov),
+		 (unsigned int)idle_gov_break_even(&gov));
+	TCMD_RSP_PROVISIONAL(ctx, buffer);
+	print_hist(ctx, "corr", gov.corr, IDLE_CORR_NB);
+	print_hist(ctx, "deep", gov.deep, IDLE_HIST_NB);
+	print_hist(ctx, "shallow", gov.shallow, IDLE_HIST_NB);
+	snprintf(buffer, sizeof(buffer), "wake timer: %u early: %u aborted: %u",
+		 (unsigned int)gov.wake[IDLE_WAKE_TIMER],
+		 (unsigned int)gov.wake[IDLE_WAKE_EARLY],
+		 (unsigned int)gov.wake[IDLE_WAKE_ABORTED]);
+	TCMD_RSP_PROVISIONAL(ctx, buffer);
+	snprintf(buffer, sizeof(buffer),
+		 "reject disabled: %u timer: %u locked: %u arc: %u predict: %u",
+		 (unsigned int)gov.reject[IDLE_REJECT_DISABLED],
+		 (unsigned int)gov.reject[IDLE_REJECT_TIMER],
+		 (unsigned int)gov.reject[IDLE_REJECT_LOCKED],
+		 (unsigned int)gov.reject[IDLE_REJECT_ARC],
+		 (unsigned int)gov.reject[IDLE_REJECT_PREDICT]);
+	TCMD_RSP_FINAL(ctx, buffer);
+}
+DECLARE_TEST_COMMAND_ENG(system, govstat, pm_govstat_tcmd);
+
 void pm_idle_tcmd(int argc, char *argv[], struct tcmd_handler_ctx *ctx)
 {
 	if (argc == 3) {
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2015, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "util/misc.h"
+#include "idle_gov.h"
+
+/* Log2 ms bucket of a duration: <1ms, <2ms, <4ms ... */
+static int idle_bucket(uint32_t ticks, int nb)
+{
+	uint32_t ms = ((uint64_t)ticks * 1000) >> 15;
+	int b = 0;
+
+	while (ms && b < nb - 1) {
+		ms >>= 1;
+		b++;
+	}
+	return b;
+}
+
+uint32_t idle_gov_break_even(const struct idle_gov *gov)
+{
+	return MAX(DEEP_SLEEP_MIN_DURATION_32K,
+		   CONFIG_DEEPSLEEP_BREAK_EVEN_RATIO * idle_gov_latency(gov));
+}
+
+bool idle_gov_select(struct idle_gov *gov, uint32_t timeout)
+{
+	uint32_t latency = idle_gov_latency(gov);
+	uint32_t predicted;
+
+	gov->expected = timeout;
+	gov->bucket = idle_bucket(timeout, IDLE_CORR_NB);
+	predicted = ((uint64_t)timeout * gov->corr[gov->bucket]) /
+		    IDLE_CORR_ONE;
+	gov->promote = 0;
+	/* The deep sleep ends ahead of the timer by the wakeup margin */
+	if (predicted >= idle_gov_wakeup_margin(gov) + idle_gov_break_even(gov))
+		return true;
+
+	gov->reject[IDLE_REJECT_PREDICT]++;
+	/* Bound the cost of a wrong prediction: when still idle after twice
+	 * the break-even time, deep sleep is evaluated again. */
+	if (timeout > 2 * (latency + idle_gov_break_even(gov)))
+		gov->promote = 2 * (latency + idle_gov_break_even(gov));
+	return false;
+}
+
+void idle_gov_resumed(struct idle_gov *gov, int32_t late)
+{
+	int32_t err;
+
+	if (late < 0) {
+		gov->wake[IDLE_WAKE_EARLY]++;
+		return;
+	}
+	gov->wake[IDLE_WAKE_TIMER]++;
+	if (late >= WAKEUP_DELAY_MAX_32K)
+		return;
+	err = late - (int32_t)idle_gov_latency(gov);
+	gov->latency += err;
+	gov->latency_dev += (err < 0 ? -err : err) -
+			    (int32_t)(gov->latency_dev >> 2);
+}
+
+void idle_gov_idle_done(struct idle_gov *gov, bool deep, uint32_t elapsed)
+{
+	uint32_t *corr = &gov->corr[gov->bucket];
+	uint32_t ratio = IDLE_CORR_ONE;
+
+	/* An idle period ended by the promotion timer was not interrupted */
+	if (elapsed < gov->expected &&
+	    (!gov->promote || elapsed < gov->promote))
+		ratio = ((uint64_t)elapsed * IDLE_CORR_ONE) / gov->expected;
+	/* Fast moving average: a change of activity must be caught quickly */
+	*corr = (3 * *corr + ratio) / 4;
+
+	if (deep)
+		gov->deep[idle_bucket(elapsed, IDLE_HIST_NB)]++;
+	else
+		gov->shallow[idle_bucket(elapsed, IDLE_HIST_NB)]++;
+}
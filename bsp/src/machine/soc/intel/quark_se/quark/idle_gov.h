@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2015, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __IDLE_GOV_H__
+#define __IDLE_GOV_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Minimum deeplseep duration in ms */
+#define DEEP_SLEEP_MIN_DURATION 10
+/* Minimum deeplseep duration in 32k base */
+#define DEEP_SLEEP_MIN_DURATION_32K (DEEP_SLEEP_MIN_DURATION * 32768 / 1000)
+/* Initial wakeup delay estimate in ms, refined at each timer wakeup */
+#define ESTIMATED_WAKEUP_DELAY  3
+/* Initial wakeup delay estimate in 32k base */
+#define ESTIMATED_WAKEUP_DELAY_32K (ESTIMATED_WAKEUP_DELAY * 32768 / 1000)
+/* Longer wakeup delays are outliers (debugger, long ISR) and are ignored */
+#define WAKEUP_DELAY_MAX_32K (20 * 32768 / 1000)
+/* Fixed point unit of the idle duration correction factor */
+#define IDLE_CORR_ONE 1024
+/* Number of residency histogram buckets: <1ms, <2ms, <4ms ... >=256ms */
+#define IDLE_HIST_NB 10
+/* Number of correction factors, by expected duration: <1ms ... >=1024ms */
+#define IDLE_CORR_NB 12
+
+enum idle_wake {
+	IDLE_WAKE_TIMER,      /* AONPT expiry */
+	IDLE_WAKE_EARLY,      /* any other wakeup source */
+	IDLE_WAKE_ABORTED,    /* deep sleep refused by pm_core_deepsleep */
+	IDLE_WAKE_NB
+};
+
+enum idle_reject {
+	IDLE_REJECT_DISABLED, /* disabled through "system idle 0" */
+	IDLE_REJECT_TIMER,    /* next kernel timer too close */
+	IDLE_REJECT_LOCKED,   /* wakelock held */
+	IDLE_REJECT_ARC,      /* ARC busy */
+	IDLE_REJECT_PREDICT,  /* predicted idle duration below break-even */
+	IDLE_REJECT_NB
+};
+
+/*
+ * Deep sleep governor.
+ *
+ * The timer based idle duration given by the kernel is only an upper bound:
+ * any interrupt ends the idle period earlier. The governor keeps moving
+ * averages of the measured/expected idle duration ratio, one per log2 range
+ * of expected duration, and uses them to predict the next idle duration: a
+ * periodic interrupt cuts a 1 s timeout and a 40 ms one by very different
+ * ratios. Deep sleep is only entered when the predicted duration, minus the
+ * resume latency, is above the break-even time.
+ *
+ * The resume latency is measured at each timer wakeup as the delay between
+ * the programmed AONPT expiry and the actual resume. The AONPT is programmed
+ * ahead of the timer by the average latency plus twice its mean deviation,
+ * so that the timers are seldom served late. The break-even time is derived
+ * from the latency, as the entry/exit energy cost is proportional to the time
+ * spent running with the clocks and voltage rails being restored.
+ *
+ * The governor does not touch the hardware, so that tools/idle_sim can replay
+ * idle traces through it on the host. All durations are in 32k base.
+ */
+struct idle_gov {
+	uint32_t latency;     /* resume latency average, 32k base << 3 */
+	uint32_t latency_dev; /* resume latency mean deviation, 32k base << 2 */
+	uint32_t corr[IDLE_CORR_NB]; /* measured/expected idle ratio averages */
+	uint32_t expected;    /* expected duration of the current idle period */
+	uint8_t bucket;       /* correction factor of the current idle period */
+	uint32_t promote;     /* shallow idle duration ended by the AONPT */
+	uint32_t deep[IDLE_HIST_NB];    /* deep sleep residency histogram */
+	uint32_t shallow[IDLE_HIST_NB]; /* shallow idle residency histogram */
+	uint32_t wake[IDLE_WAKE_NB];
+	uint32_t reject[IDLE_REJECT_NB];
+};
+
+#define IDLE_GOV_INIT { \
+		.latency = ESTIMATED_WAKEUP_DELAY_32K << 3, \
+		.corr = { [0 ... IDLE_CORR_NB - 1] = IDLE_CORR_ONE }, \
+}
+
+static inline uint32_t idle_gov_latency(const struct idle_gov *gov)
+{
+	return gov->latency >> 3;
+}
+
+/**
+ * Get how long before the timer the AONPT must expire, in 32k base.
+ */
+static inline uint32_t idle_gov_wakeup_margin(const struct idle_gov *gov)
+{
+	return idle_gov_latency(gov) + 2 * (gov->latency_dev >> 2);
+}
+
+/**
+ * Get the break-even time of a deep sleep, in 32k base.
+ */
+uint32_t idle_gov_break_even(const struct idle_gov *gov);
+
+/**
+ * Choose between deep sleep and shallow idle.
+ *
+ * When shallow idle is chosen on a long timeout, gov->promote is set to the
+ * delay after which the AONPT should wake the core up so that deep sleep is
+ * evaluated again, else to 0.
+ *
+ * @param timeout Time to the next timer expiry
+ * @return true to enter deep sleep
+ */
+bool idle_gov_select(struct idle_gov *gov, uint32_t timeout);
+
+/**
+ * Learn the resume latency from a deep sleep exit.
+ *
+ * @param late Resume time minus the programmed AONPT expiry, negative if
+ *             another source woke the core up
+ */
+void idle_gov_resumed(struct idle_gov *gov, int32_t late);
+
+/**
+ * Account a measured idle period against the expected one.
+ *
+ * @param deep true for a deep sleep period, false for a shallow one
+ * @param elapsed Measured duration of the idle period
+ */
+void idle_gov_idle_done(struct idle_gov *gov, bool deep, uint32_t elapsed);
+
+#endif /* __IDLE_GOV_H__ */
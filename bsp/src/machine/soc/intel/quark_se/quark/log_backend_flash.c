@@ -28,7 +28,10 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <string.h>
+
 #include "util/assert.h"
+#include "util/misc.h"
 #include "machine/soc/intel/quark_se/quark/log_backend_flash.h"
 #include "machine/soc/intel/quark_se/soc_config.h"
 #include "project_mapping.h"
@@ -38,90 +41,297 @@
 #include <infra/log.h>
 #include <drivers/spi_flash.h>
 
+/*
+ * The log area is a ring of flash sectors, written in sequence. Each sector
+ * starts with a header holding its sequence number, followed by framed log
+ * records:
+ *
+ *   sector:  | header | record | record | ... | 0xff padding |
+ *   record:  | len (2) | crc (2) | seq (4) | len bytes of text |
+ *
+ * The crc is a CRC16-CCITT over seq and text. A record never spans two
+ * sectors, and an erased length (0xffff) marks the end of a sector. A record
+ * torn by a power loss ends its sector: the next record goes to a new sector
+ * with the same sequence number.
+ * Records are packed in a RAM copy of the current flash page, programmed when
+ * the page is full or when the logger has no more message to output.
+ *
+ * Sector sequence number s is always stored in sector s % LOG_FLASH_NB_SECTORS,
+ * so the sectors written since the last wrap of sector 0 have the same lap
+ * number: the write head is found by a binary search on it.
+ *
+ * tools/scripts/log/DecodeFlashLog.py extracts the logs from a dump of
+ * the area.
+ */
 
 #define FLASH_SECTOR_SIZE       SERIAL_FLASH_BLOCK_SIZE
 #define LOG_FLASH_ADDRESS_START (SPI_LOG_START_BLOCK * SERIAL_FLASH_BLOCK_SIZE)
 #define LOG_FLASH_SECTOR_START  (SPI_LOG_START_BLOCK)
-#define FLASH_LOG_SECTOR_COUNT  (SPI_LOG_END_BLOCK)
-#define READ_BLOCK_LEN          256
-#define READ_BLOCK_COUNT        (FLASH_SECTOR_SIZE / READ_BLOCK_LEN)
-#define SPARE                   0xFFFFFFFF
+#define LOG_FLASH_NB_SECTORS    (SPI_LOG_NB_BLOCKS)
+#define LOG_FLASH_PAGE_SIZE     256
+
+#define LOG_FLASH_SECTOR_MAGIC  0x53474f4c /* "LOGS" */
+#define LOG_FLASH_ERASED_LEN    0xffff
+
+struct log_flash_sector {
+	uint32_t magic;
+	uint32_t seq;           /* sector sequence number */
+	uint32_t first_record;  /* sequence number of the first record */
+	uint32_t check;
+};
 
-static uint32_t flash_index; /* current write pointer to flash */
-static int current_index = 0; /* current write pointer in header contains all flash_index */
-static int current_sector = 0; /* current write sector */
+struct log_flash_record {
+	uint16_t len;
+	uint16_t crc;
+	uint32_t seq;
+};
+
+#define SECTOR_ADDR(idx)        (LOG_FLASH_ADDRESS_START + \
+				 (idx) * FLASH_SECTOR_SIZE)
 
 static struct td_device *spi_dev;
 
-void log_backend_flash_init()
+static uint32_t sector_seq;     /* sequence number of the current sector */
+static uint32_t record_seq;     /* sequence number of the next record */
+static uint32_t page_addr;      /* flash address of the current page */
+static uint16_t page_fill;      /* bytes of the page written in the buffer */
+static uint16_t programmed;     /* bytes of the page already programmed */
+static uint32_t sector_end;     /* flash address of the end of the sector */
+static uint8_t page[LOG_FLASH_PAGE_SIZE];
+static bool flash_log_ready;
+static struct log_backend_flash_stats stats;
+
+static uint16_t log_flash_crc16(uint16_t crc, const uint8_t *buf, uint16_t len)
+{
+	int i;
+
+	while (len--) {
+		crc ^= (uint16_t)*buf++ << 8;
+		for (i = 0; i < 8; i++)
+			crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+	}
+	return crc;
+}
+
+static uint32_t sector_check(const struct log_flash_sector *hdr)
+{
+	return ~(hdr->magic ^ hdr->seq ^ hdr->first_record);
+}
+
+/* Return the lap of a sector (number of wraps of the ring), -1 if erased */
+static int32_t sector_lap(uint32_t idx, struct log_flash_sector *hdr)
 {
-	spi_dev = (struct td_device *)&pf_sba_device_flash_spi0;
-	uint32_t data[READ_BLOCK_LEN / 4] = { 0 };
 	unsigned int retlen;
-	int i, j;
 
-	current_sector = 1;
-	flash_index = LOG_FLASH_ADDRESS_START + current_sector *
-		      FLASH_SECTOR_SIZE;
-	current_index = 0;
+	if (spi_flash_read_byte(spi_dev, SECTOR_ADDR(idx), sizeof(*hdr),
+				&retlen, (uint8_t *)hdr) != DRV_RC_OK ||
+	    hdr->magic != LOG_FLASH_SECTOR_MAGIC ||
+	    hdr->check != sector_check(hdr) ||
+	    hdr->seq % LOG_FLASH_NB_SECTORS != idx)
+		return -1;
+	return hdr->seq / LOG_FLASH_NB_SECTORS;
+}
 
-	/* TODO check if OTA pacakage and erase block */
-	for (i = READ_BLOCK_COUNT; i > 0; i--) {
-		spi_flash_read(spi_dev, READ_BLOCK_LEN * (i - 1),
-			       READ_BLOCK_LEN / 4,
-			       &retlen,
-			       data);
-		assert(retlen == READ_BLOCK_LEN / 4);
-
-		for (j = retlen; j > 0; j--) {
-			if (data[j - 1] != SPARE) {
-				flash_index = data[j - 1];
-				current_index =
-					(i - 1) * (READ_BLOCK_LEN / 4) + j;
-				break;
-			}
+/* Program the part of the page which is not yet in flash */
+static void flush_page(void)
+{
+	unsigned int wlen = 0;
+
+	if (page_fill <= programmed)
+		return;
+	spi_flash_write_byte(spi_dev, page_addr + programmed,
+			     page_fill - programmed, &wlen, &page[programmed]);
+	assert(wlen == (unsigned int)(page_fill - programmed));
+	programmed = page_fill;
+	stats.programs++;
+}
+
+/* Start buffering the page at addr, whose first bytes are already in flash */
+static void load_page(uint32_t addr)
+{
+	page_addr = addr & ~(LOG_FLASH_PAGE_SIZE - 1);
+	page_fill = addr - page_addr;
+	programmed = page_fill;
+	memset(page, 0xff, sizeof(page));
+}
+
+/* Erase the next sector of the ring and write its header */
+static void open_sector(void)
+{
+	struct log_flash_sector hdr;
+	uint32_t idx;
+
+	flush_page();
+	sector_seq++;
+	idx = sector_seq % LOG_FLASH_NB_SECTORS;
+	spi_flash_sector_erase(spi_dev, LOG_FLASH_SECTOR_START + idx, 1);
+	stats.erases++;
+
+	hdr.magic = LOG_FLASH_SECTOR_MAGIC;
+	hdr.seq = sector_seq;
+	hdr.first_record = record_seq;
+	hdr.check = sector_check(&hdr);
+	load_page(SECTOR_ADDR(idx));
+	sector_end = SECTOR_ADDR(idx) + FLASH_SECTOR_SIZE;
+	memcpy(page, &hdr, sizeof(hdr));
+	page_fill = sizeof(hdr);
+}
+
+/* Copy bytes in the page buffer, programming each page when full */
+static void append(const uint8_t *data, uint16_t len)
+{
+	uint16_t n;
+
+	while (len) {
+		n = MIN(len, LOG_FLASH_PAGE_SIZE - page_fill);
+		memcpy(&page[page_fill], data, n);
+		page_fill += n;
+		data += n;
+		len -= n;
+		if (page_fill == LOG_FLASH_PAGE_SIZE) {
+			flush_page();
+			load_page(page_addr + LOG_FLASH_PAGE_SIZE);
 		}
-		if (flash_index != LOG_FLASH_ADDRESS_START + current_sector *
-		    FLASH_SECTOR_SIZE)
-			break;
 	}
 }
 
-static void spi_flash_puts(const char *s, uint16_t len)
+/* Check the crc of the record stored at addr */
+static bool record_valid(uint32_t addr, const struct log_flash_record *rec)
 {
-	unsigned int wlen = 0;
-	int next_sector;
+	uint8_t buf[64];
+	unsigned int retlen;
+	uint16_t len = rec->len;
+	uint16_t crc;
+	uint16_t n;
 
-	if ((flash_index + len) >
-	    (FLASH_LOG_SECTOR_COUNT * FLASH_SECTOR_SIZE)) {
-		flash_index = FLASH_SECTOR_SIZE;
+	crc = log_flash_crc16(0xffff, (const uint8_t *)&rec->seq,
+			      sizeof(rec->seq));
+	addr += sizeof(*rec);
+	while (len) {
+		n = MIN(len, sizeof(buf));
+		if (spi_flash_read_byte(spi_dev, addr, n, &retlen, buf) !=
+		    DRV_RC_OK)
+			return false;
+		crc = log_flash_crc16(crc, buf, n);
+		addr += n;
+		len -= n;
 	}
+	return crc == rec->crc;
+}
 
-	spi_flash_write_byte(spi_dev, LOG_FLASH_ADDRESS_START + flash_index,
-			     len, &wlen,
-			     (uint8_t *)s);
-	assert(wlen == len);
-	flash_index += wlen;
+/*
+ * Find the first free byte of the head sector by following the records.
+ * Return false if the sector cannot be appended to.
+ */
+static bool recover_head(uint32_t idx, const struct log_flash_sector *hdr)
+{
+	struct log_flash_record rec;
+	uint32_t addr = SECTOR_ADDR(idx) + sizeof(*hdr);
+	uint32_t end = SECTOR_ADDR(idx) + FLASH_SECTOR_SIZE;
+	unsigned int retlen;
 
-	if (current_index >= READ_BLOCK_LEN / 4 * READ_BLOCK_COUNT) {
-		spi_flash_sector_erase(spi_dev, LOG_FLASH_SECTOR_START, 1);
-		current_index = 0;
+	record_seq = hdr->first_record;
+	while (addr + sizeof(rec) <= end) {
+		if (spi_flash_read_byte(spi_dev, addr, sizeof(rec), &retlen,
+					(uint8_t *)&rec) != DRV_RC_OK)
+			return false;
+		if (rec.len == LOG_FLASH_ERASED_LEN)
+			break;
+		/*
+		 * A record torn by a power loss may have its length programmed
+		 * and its sequence number still erased: the records of a
+		 * sector are numbered in sequence, and the crc covers the rest
+		 */
+		if (addr + sizeof(rec) + rec.len > end ||
+		    rec.seq != record_seq || !record_valid(addr, &rec))
+			return false;
+		record_seq++;
+		addr += sizeof(rec) + rec.len;
 	}
-	spi_flash_write_byte(spi_dev, LOG_FLASH_ADDRESS_START +
-			     (current_index * 4),
-			     sizeof(flash_index), &wlen,
-			     (uint8_t *)&flash_index);
-	current_index++;
-
-	next_sector = flash_index / FLASH_SECTOR_SIZE;
-	if (next_sector != current_sector) {
-		current_sector = next_sector;
-		/* Prepare one erased sector */
-		spi_flash_sector_erase(spi_dev, LOG_FLASH_SECTOR_START +
-				       ((next_sector +
-					 1) % FLASH_LOG_SECTOR_COUNT), 1);
+
+	load_page(addr);
+	sector_end = end;
+	return true;
+}
+
+void log_backend_flash_init()
+{
+	struct log_flash_sector hdr;
+	int32_t lap0;
+	uint32_t lo, hi, mid;
+
+	if (flash_log_ready)
+		return;
+	spi_dev = (struct td_device *)&pf_sba_device_flash_spi0;
+
+	/* TODO check if OTA pacakage and erase block */
+	lap0 = sector_lap(0, &hdr);
+	if (lap0 < 0) {
+		/* Either the area is empty or sector 0 was being erased */
+		lo = LOG_FLASH_NB_SECTORS - 1;
+		if (sector_lap(lo, &hdr) < 0) {
+			sector_seq = (uint32_t)-1;
+			record_seq = 0;
+			open_sector();
+			flash_log_ready = true;
+			return;
+		}
+	} else {
+		/* Last sector written during the same lap as sector 0 */
+		lo = 0;
+		hi = LOG_FLASH_NB_SECTORS;
+		while (hi - lo > 1) {
+			mid = (lo + hi) / 2;
+			if (sector_lap(mid, &hdr) == lap0)
+				lo = mid;
+			else
+				hi = mid;
+		}
+		sector_lap(lo, &hdr);
 	}
-	;
+
+	sector_seq = hdr.seq;
+	if (!recover_head(lo, &hdr))
+		open_sector();
+	flash_log_ready = true;
+}
+
+static void spi_flash_puts(const char *s, uint16_t len)
+{
+	struct log_flash_record rec;
+	uint32_t write_addr = page_addr + page_fill;
+
+	if (!flash_log_ready)
+		return;
+
+	if (len > FLASH_SECTOR_SIZE - sizeof(struct log_flash_sector) -
+	    sizeof(rec))
+		len = FLASH_SECTOR_SIZE - sizeof(struct log_flash_sector) -
+		      sizeof(rec);
+
+	if (write_addr + sizeof(rec) + len > sector_end)
+		open_sector();
+
+	rec.len = len;
+	rec.seq = record_seq++;
+	rec.crc = log_flash_crc16(0xffff, (const uint8_t *)&rec.seq,
+				  sizeof(rec.seq));
+	rec.crc = log_flash_crc16(rec.crc, (const uint8_t *)s, len);
+	append((const uint8_t *)&rec, sizeof(rec));
+	append((const uint8_t *)s, len);
+	stats.records++;
+	stats.bytes += len;
+}
+
+static void spi_flash_flush(void)
+{
+	if (flash_log_ready)
+		flush_page();
+}
+
+void log_backend_flash_get_stats(struct log_backend_flash_stats *s)
+{
+	*s = stats;
 }
 
 static bool is_spi_flash_ready(void)
@@ -131,5 +341,6 @@ static bool is_spi_flash_ready(void)
 
 struct log_backend log_backend_flash = {
 	.put_one_msg = spi_flash_puts,
-	.is_backend_ready = is_spi_flash_ready
+	.is_backend_ready = is_spi_flash_ready,
+	.flush = spi_flash_flush
 };
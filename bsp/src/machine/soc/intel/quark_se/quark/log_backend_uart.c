@@ -30,21 +30,224 @@
 
 #include "machine/soc/intel/quark_se/quark/log_backend_uart.h"
 
+#include <stdio.h>
+#include <string.h>
 #include <uart.h>
 #include <init.h>
+#include <zephyr.h>
+
+#include "infra/pm.h"
+#include "infra/tcmd/handler.h"
+#include "util/misc.h"
 
 /** UART port index */
 #define UART_LOG_DEVICE_NAME uart_ns16550_1
 
-static void uart_puts(const char *s, uint16_t len)
+extern struct device DEVICE_NAME_GET(UART_LOG_DEVICE_NAME);
+
+static void uart_poll_puts(const char *s, uint16_t len)
 {
-	extern struct device DEVICE_NAME_GET(UART_LOG_DEVICE_NAME);
 	uint16_t i;
+
 	for (i = 0; i < len; i++) {
 		uart_poll_out(DEVICE_GET(UART_LOG_DEVICE_NAME), s[i]);
 	}
 }
 
+#ifdef CONFIG_QUARK_SE_QUARK_LOG_BACKEND_UART_IRQ
+
+#define UART_LOG_BUF_SIZE CONFIG_QUARK_SE_QUARK_LOG_BACKEND_UART_BUF_SIZE
+
+/*
+ * Log lines are copied in a ring buffer drained by the UART TX interrupt, so
+ * the logger does not busy-wait on the UART anymore. A line which does not
+ * fit in the ring is dropped, and the number of dropped lines is reported in
+ * the log stream as soon as there is room for it.
+ *
+ * Until the first TX interrupt is received (UART interrupt not connected yet)
+ * a full ring is flushed in polled mode instead of dropping lines, and after
+ * log_backend_uart_panic() all the output is polled.
+ */
+static char ring[UART_LOG_BUF_SIZE];
+static uint16_t ring_head;      /* next byte to write */
+static uint16_t ring_tail;      /* next byte to send */
+static uint16_t ring_count;
+static bool tx_irq_ok;
+static bool polled;
+static uint32_t pending_drops;
+static struct pm_wakelock tx_wl;
+static struct log_backend_uart_stats stats;
+
+/* Called with interrupts locked */
+static void ring_put(const char *s, uint16_t len)
+{
+	uint16_t n = MIN(len, UART_LOG_BUF_SIZE - ring_head);
+
+	memcpy(&ring[ring_head], s, n);
+	memcpy(ring, s + n, len - n);
+	ring_head = (ring_head + len) % UART_LOG_BUF_SIZE;
+	ring_count += len;
+	if (ring_count > stats.high_water)
+		stats.high_water = ring_count;
+}
+
+/* Called with interrupts locked */
+static void ring_flush_polled(void)
+{
+	uint16_t n;
+
+	while (ring_count) {
+		n = MIN(ring_count, UART_LOG_BUF_SIZE - ring_tail);
+		uart_poll_puts(&ring[ring_tail], n);
+		ring_tail = (ring_tail + n) % UART_LOG_BUF_SIZE;
+		ring_count -= n;
+	}
+}
+
+void log_backend_uart_init(void)
+{
+	uint32_t flags = irq_lock();
+
+	/* Send the early logs: the wakelock must not be held while reset */
+	ring_flush_polled();
+	if (tx_wl.lock)
+		pm_wakelock_release(&tx_wl);
+	pm_wakelock_init(&tx_wl);
+	irq_unlock(flags);
+}
+
+void log_backend_uart_tx_isr(bool irq)
+{
+	struct device *dev = DEVICE_GET(UART_LOG_DEVICE_NAME);
+	uint32_t flags = irq_lock();
+	uint16_t len;
+	int n;
+
+	/* The interrupt is known to work once one has been received */
+	if (irq)
+		tx_irq_ok = true;
+	while (ring_count && !polled) {
+		len = MIN(ring_count, UART_LOG_BUF_SIZE - ring_tail);
+		n = uart_fifo_fill(dev, (uint8_t *)&ring[ring_tail], len);
+		ring_tail = (ring_tail + n) % UART_LOG_BUF_SIZE;
+		ring_count -= n;
+		stats.tx_irqs++;
+		if (n < len)
+			/* TX FIFO full, wait for the next interrupt */
+			break;
+	}
+
+	if (ring_count && !polled) {
+		uart_irq_tx_enable(dev);
+	} else {
+		uart_irq_tx_disable(dev);
+		pm_wakelock_release(&tx_wl);
+	}
+	irq_unlock(flags);
+}
+
+static void uart_puts(const char *s, uint16_t len)
+{
+	static const char drop_fmt[] = "-- %u log lines dropped on uart --\r\n";
+	char drop_msg[sizeof(drop_fmt) + 8];
+	int drop_len = 0;
+	uint32_t flags;
+
+	if (pending_drops)
+		drop_len = snprintf(drop_msg, sizeof(drop_msg), drop_fmt,
+				    (unsigned int)pending_drops);
+
+	flags = irq_lock();
+	stats.lines++;
+	stats.bytes += len;
+	if (polled || len > UART_LOG_BUF_SIZE) {
+		ring_flush_polled();
+		uart_poll_puts(s, len);
+		irq_unlock(flags);
+		return;
+	}
+	if (len > UART_LOG_BUF_SIZE - ring_count) {
+		if (!tx_irq_ok) {
+			ring_flush_polled();
+		} else {
+			pending_drops++;
+			stats.dropped_lines++;
+			stats.dropped_bytes += len;
+			irq_unlock(flags);
+			return;
+		}
+	}
+	if (drop_len > 0 &&
+	    drop_len + len <= UART_LOG_BUF_SIZE - ring_count) {
+		ring_put(drop_msg, drop_len);
+		pending_drops = 0;
+	}
+	ring_put(s, len);
+	/* Stay awake until the ring is drained */
+	pm_wakelock_acquire(&tx_wl);
+	uart_irq_tx_enable(DEVICE_GET(UART_LOG_DEVICE_NAME));
+	irq_unlock(flags);
+}
+
+void log_backend_uart_panic(void)
+{
+	uint32_t flags = irq_lock();
+
+	polled = true;
+	uart_irq_tx_disable(DEVICE_GET(UART_LOG_DEVICE_NAME));
+	ring_flush_polled();
+	irq_unlock(flags);
+}
+
+void log_backend_uart_get_stats(struct log_backend_uart_stats *s)
+{
+	uint32_t flags = irq_lock();
+
+	*s = stats;
+	s->pending = ring_count;
+	irq_unlock(flags);
+}
+
+#ifdef CONFIG_LOG_EXTRA_TCMD
+void log_uart_stats(int argc, char *argv[], struct tcmd_handler_ctx *ctx)
+{
+	struct log_backend_uart_stats s;
+	char tmp[64];
+
+	log_backend_uart_get_stats(&s);
+	snprintf(tmp, sizeof(tmp), "lines %u bytes %u irqs %u",
+		 (unsigned int)s.lines, (unsigned int)s.bytes,
+		 (unsigned int)s.tx_irqs);
+	TCMD_RSP_PROVISIONAL(ctx, tmp);
+	snprintf(tmp, sizeof(tmp), "dropped lines %u bytes %u",
+		 (unsigned int)s.dropped_lines, (unsigned int)s.dropped_bytes);
+	TCMD_RSP_PROVISIONAL(ctx, tmp);
+	snprintf(tmp, sizeof(tmp), "ring %u/%u max %u",
+		 (unsigned int)s.pending, UART_LOG_BUF_SIZE,
+		 (unsigned int)s.high_water);
+	TCMD_RSP_FINAL(ctx, tmp);
+}
+
+DECLARE_TEST_COMMAND_ENG(log, uart, log_uart_stats);
+#endif
+
+#else
+
+void log_backend_uart_init(void)
+{
+}
+
+static void uart_puts(const char *s, uint16_t len)
+{
+	uart_poll_puts(s, len);
+}
+
+void log_backend_uart_panic(void)
+{
+}
+
+#endif
+
 static bool uart_ready(void)
 {
 	return true;
@@ -28,62 +28,243 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+
 #include <string.h>
 #include <stdio.h>
+#include <zephyr.h>
 #include "infra/log.h"
 #include "infra/panic.h"
+#include "infra/tcmd/handler.h"
+#include "machine/soc/intel/quark_se/quark/log_backend_usb.h"
 #include "os/os.h"
+#include "util/workqueue.h"
 #include "drivers/usb_acm.h"
 
 extern bool is_console_backend_usb_acm_ready(void);
 
 #define LOG_ACM_INTERFACE (0)                                   /* index of the ACM interface to use */
-#define LOG_MAX_TOTAL_MSG_LEN (30 + LOG_MAX_MSG_LEN + 2)        /* Header + maximum size of a message + "\r\n" */
+#define LOG_USB_BUF_SIZE CONFIG_LOG_BACKEND_USB_BUF_SIZE        /* size of one bulk transfer */
+#define LOG_USB_WAIT_MS CONFIG_LOG_BACKEND_USB_WAIT_MS
+
+/*
+ * Log lines are packed in one buffer while the other one is being sent, so
+ * that a single bulk transfer carries all the lines queued during the previous
+ * transfer. A line which does not fit waits at most LOG_USB_WAIT_MS for the
+ * transfer in flight, and is dropped after that. The next lines are dropped
+ * without waiting until there is room again, so that a stalled host does not
+ * stall the logger: the number of dropped lines is then reported in the log
+ * stream. The buffer filled during a transfer is sent from the workqueue
+ * once the transfer completes, as the completion runs in interrupt context.
+ */
+static char buffers[2][LOG_USB_BUF_SIZE];
+static uint8_t fill_idx;        /* buffer being filled */
+static uint16_t fill_len;       /* bytes queued in the buffer being filled */
+static bool in_flight;          /* the other buffer is being sent */
+static bool send_queued;        /* log_usb_send_work() is queued */
+static uint8_t xfer_gen;        /* identifies the current transfer */
+static uint32_t pending_drops;  /* dropped lines not yet reported */
+static struct log_backend_usb_stats stats;
 
 static T_SEMAPHORE usb_ready = NULL;
-static char message[LOG_MAX_TOTAL_MSG_LEN];
-static uint16_t message_size = 0;
+
+/*
+ * Swap the buffers if the filled one can be sent. Called with interrupts
+ * locked, the transfer itself is started by the caller with
+ * log_usb_start_xfer().
+ */
+static char *log_usb_swap(uint16_t *len, uint8_t *gen)
+{
+	char *buf;
+
+	if (in_flight || fill_len == 0)
+		return NULL;
+
+	buf = buffers[fill_idx];
+	*len = fill_len;
+	*gen = xfer_gen;
+	fill_idx ^= 1;
+	fill_len = 0;
+	in_flight = true;
+	return buf;
+}
+
+static void cb_xfer_done(int actual, void *data);
+
+static void log_usb_start_xfer(char *buf, uint16_t len, uint8_t gen)
+{
+	uint32_t flags;
+
+	if (!buf)
+		return;
+
+	stats.xfers++;
+	if (acm_write(LOG_ACM_INTERFACE, (uint8_t *)buf, len, cb_xfer_done,
+		      (void *)(uintptr_t)gen) == 0)
+		return;
+
+	/* The content of the buffer is lost, the next one can be sent */
+	flags = irq_lock();
+	stats.xfer_errors++;
+	stats.dropped_bytes += len;
+	if (gen == xfer_gen)
+		in_flight = false;
+	irq_unlock(flags);
+}
+
+static void log_usb_send_work(void *data)
+{
+	uint32_t flags;
+	uint16_t len = 0;
+	uint8_t gen = 0;
+	char *buf;
+
+	flags = irq_lock();
+	send_queued = false;
+	buf = log_usb_swap(&len, &gen);
+	irq_unlock(flags);
+
+	log_usb_start_xfer(buf, len, gen);
+}
 
 static void cb_xfer_done(int actual, void *data)
 {
+	uint32_t flags;
+	bool send = false;
+
+	flags = irq_lock();
+	/* Ignore the completion of a transfer aborted by a disconnection */
+	if ((uintptr_t)data != xfer_gen) {
+		irq_unlock(flags);
+		return;
+	}
+	if (actual < 0)
+		stats.xfer_errors++;
+	else
+		stats.bytes_sent += actual;
+	in_flight = false;
+	if (fill_len && !send_queued) {
+		send_queued = true;
+		send = true;
+	}
+	irq_unlock(flags);
+
+	if (send && workqueue_queue_work(log_usb_send_work, NULL) != E_OS_OK) {
+		/* Sent with the next line */
+		flags = irq_lock();
+		send_queued = false;
+		irq_unlock(flags);
+	}
 	semaphore_give(usb_ready, NULL);
 }
 
 static void usb_puts(const char *s, uint16_t len)
 {
+	static const char drop_fmt[] = "-- %u log lines dropped on usb --\r\n";
+	char drop_msg[sizeof(drop_fmt) + 8];
+	int drop_len = 0;
+	uint32_t flags;
+	uint16_t xfer_len = 0;
+	uint8_t gen = 0;
+	char *buf;
+
 	/* Lazy initialization of usb_ready semaphore */
 	if (!usb_ready)
 		usb_ready = semaphore_create(0);
-	/* Assembling of the message */
-	if (message_size + len > LOG_MAX_TOTAL_MSG_LEN)
-		len = LOG_MAX_TOTAL_MSG_LEN - message_size;
-	strncpy(&message[message_size], s, len);
-	message_size += len;
-
-	if (message_size >= 2) {
-		if (strncmp(&message[message_size - 2], "\r\n", 2) == 0) { /* If the message is assembled */
-			acm_write(LOG_ACM_INTERFACE, (uint8_t *)message,
-				  message_size, cb_xfer_done,
-				  NULL);
-			if (semaphore_take(usb_ready,
-					   OS_WAIT_FOREVER) != E_OS_OK)
-				panic(E_OS_ERR);
-			message_size = 0;
+
+	if (len > LOG_USB_BUF_SIZE)
+		len = LOG_USB_BUF_SIZE;
+
+	if (pending_drops)
+		drop_len = snprintf(drop_msg, sizeof(drop_msg), drop_fmt,
+				    (unsigned int)pending_drops);
+
+	flags = irq_lock();
+	while (fill_len + len > LOG_USB_BUF_SIZE) {
+		/* Send the full buffer if no transfer is in flight anymore */
+		buf = log_usb_swap(&xfer_len, &gen);
+		irq_unlock(flags);
+		if (buf) {
+			log_usb_start_xfer(buf, xfer_len, gen);
+		} else if (semaphore_take(usb_ready, pending_drops ? OS_NO_WAIT :
+					  LOG_USB_WAIT_MS) != E_OS_OK) {
+			flags = irq_lock();
+			if (fill_len + len <= LOG_USB_BUF_SIZE)
+				break;
+			pending_drops++;
+			stats.dropped_lines++;
+			stats.dropped_bytes += len;
+			irq_unlock(flags);
+			return;
 		}
+		flags = irq_lock();
 	}
+
+	if (drop_len > 0 && fill_len + drop_len + len <= LOG_USB_BUF_SIZE) {
+		memcpy(&buffers[fill_idx][fill_len], drop_msg, drop_len);
+		fill_len += drop_len;
+		pending_drops = 0;
+	}
+	memcpy(&buffers[fill_idx][fill_len], s, len);
+	fill_len += len;
+	stats.lines++;
+	stats.bytes_queued += len;
+	buf = log_usb_swap(&xfer_len, &gen);
+	irq_unlock(flags);
+
+	log_usb_start_xfer(buf, xfer_len, gen);
 }
 
 void release_usb_backend_xfer(void)
 {
+	uint32_t flags;
 	OS_ERR_TYPE err;
 
+	/*
+	 * The transfer in flight will not complete: forget it so that the
+	 * next lines are sent on reconnection.
+	 */
+	flags = irq_lock();
+	if (in_flight) {
+		in_flight = false;
+		xfer_gen++;
+	}
+	irq_unlock(flags);
+
 	/* Neglect err in case of multiple release from usb acm backend */
 	semaphore_give(usb_ready, &err);
 }
 
+void log_backend_usb_get_stats(struct log_backend_usb_stats *s)
+{
+	uint32_t flags = irq_lock();
+
+	*s = stats;
+	irq_unlock(flags);
+}
+
 static bool is_usb_acm_backend_ready(void)
 {
 	return is_console_backend_usb_acm_ready();
 }
 
 struct log_backend log_backend_usb = { usb_puts, is_usb_acm_backend_ready };
+
+#ifdef CONFIG_LOG_EXTRA_TCMD
+void log_usb_stats(int argc, char *argv[], struct tcmd_handler_ctx *ctx)
+{
+	struct log_backend_usb_stats s;
+	char tmp[64];
+
+	log_backend_usb_get_stats(&s);
+	snprintf(tmp, sizeof(tmp), "lines %u bytes %u sent %u xfers %u",
+		 (unsigned int)s.lines, (unsigned int)s.bytes_queued,
+		 (unsigned int)s.bytes_sent, (unsigned int)s.xfers);
+	TCMD_RSP_PROVISIONAL(ctx, tmp);
+	snprintf(tmp, sizeof(tmp), "dropped lines %u bytes %u errors %u",
+		 (unsigned int)s.dropped_lines, (unsigned int)s.dropped_bytes,
+		 (unsigned int)s.xfer_errors);
+	TCMD_RSP_FINAL(ctx, tmp);
+}
+
+DECLARE_TEST_COMMAND_ENG(log, usb, log_usb_stats);
+#endif
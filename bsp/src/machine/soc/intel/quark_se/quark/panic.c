@@ -47,6 +47,12 @@
 #ifdef CONFIG_IPC
 #include "infra/ipc.h"
 #endif
+#ifdef CONFIG_QUARK_SE_QUARK_LOG_BACKEND_UART
+#include "machine/soc/intel/quark_se/quark/log_backend_uart.h"
+#endif
+#ifdef CONFIG_SYSTEM_EVENTS
+#include "infra/system_events.h"
+#endif
 #ifdef CONFIG_QUARK_SE_PANIC_DEBUG
 #include <misc/printk.h>
 #include "project_mapping.h"
@@ -279,6 +285,14 @@ void panic_trap(struct x86_panic_arch_data *dump)
 		// Notify panic to the other cores with timeout as synchronisation
 		panic_notify(PANIC_NOTIFY_TIMEOUT);
 
+#ifdef CONFIG_QUARK_SE_QUARK_LOG_BACKEND_UART
+		// Send the logs still queued for the UART
+		log_backend_uart_panic();
+#endif
+#ifdef CONFIG_SYSTEM_EVENTS
+		// Save the system events not programmed to the SPI flash yet
+		system_events_panic();
+#endif
 #ifdef CONFIG_QUARK_SE_PANIC_DEBUG
 		// Flush QRK panic dump over UART (for debug purposes)
 		panic_handler(footer);
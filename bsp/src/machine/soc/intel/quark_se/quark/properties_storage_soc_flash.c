@@ -33,6 +33,7 @@
 #include <stdbool.h>
 
 #include "util/compiler.h"
+#include "util/misc.h"
 #include "infra/properties_storage.h"
 #include "infra/panic.h"
 #include "infra/log.h"
@@ -40,6 +41,7 @@
 
 #include "drivers/soc_flash.h"
 
+
 /*
  * Implementation of the properties_storage API on top of the Quark SE
  * SOC Flash driver.
@@ -66,8 +68,66 @@
  * value needs to be written, it must fit in the remaining space of the block.
  *
  * The last property in a block is followed by 8 bytes set at value zero.
+ *
+ * The properties of a batch are written contiguously between a begin record
+ * and a commit record, which are headers with reserved keys. These keys only
+ * differ from a free header by their first byte, so that they can't be
+ * partially written. The entries of a batch are ignored if the commit record
+ * is missing. The previous entries of these properties are not flagged
+ * obsolete in the same partition: they are superseded by the batch as entries
+ * are always read from the oldest to the most recent one, and scrapped when
+ * their block is compacted. As the two partitions are not read in write
+ * order, all the previous entries of a property are flagged when it is moved
+ * to the other partition or deleted.
+ *
+ * When a block is closed, a summary of its entries is written at the end of
+ * the block:
+ * | Header | Entries | 8 zero bytes | Free | Summary entries | Trailer |
+ * Each summary entry gives the key, length and offset of one entry of the
+ * block. The 8 bytes trailer is written last and validates the summary. At
+ * boot, closed blocks are indexed from their summary instead of reading the
+ * header of each entry. Blocks without a valid summary are scanned entry by
+ * entry.
  */
 
+#ifdef CONFIG_QUARK_DRIVER_TESTS
+/* Number of flash writes since the last init, and number of writes after
+ * which the flash accesses are dropped to simulate a power cut */
+static uint32_t nb_flash_writes;
+static uint32_t power_cut_after = UINT32_MAX;
+
+static DRIVER_API_RC storage_flash_write(uint32_t address, unsigned int len,
+					 unsigned int *retlen, uint32_t *data)
+{
+	if (nb_flash_writes++ >= power_cut_after) {
+		*retlen = len;
+		return DRV_RC_OK;
+	}
+	return soc_flash_write(address, len, retlen, data);
+}
+
+static DRIVER_API_RC storage_flash_block_erase(unsigned int start_block,
+					       unsigned int block_count)
+{
+	if (nb_flash_writes >= power_cut_after)
+		return DRV_RC_OK;
+	return soc_flash_block_erase(start_block, block_count);
+}
+
+void properties_storage_test_cut_power(uint32_t nb_writes)
+{
+	power_cut_after = nb_flash_writes + nb_writes;
+}
+
+uint32_t properties_storage_test_nb_writes(void)
+{
+	return nb_flash_writes;
+}
+#else
+#define storage_flash_write soc_flash_write
+#define storage_flash_block_erase soc_flash_block_erase
+#endif
+
 #define NEXT_MULTIPLE_OF_4(x) (((x) + 3) & ~3)
 #define BLOCK_FOR_OFFSET(part, offset) ((offset) / (part)->block_size)
 #define NEXT_BLOCK(part, block)	\
@@ -84,6 +144,8 @@ typedef struct {
 	uint16_t nb_blocks;
 	/* Size of one block in bytes */
 	uint16_t block_size;
+	/* Number of entries written in the current write block */
+	uint16_t nb_entries_in_block;
 	/* Offset of the first valid entry in bytes */
 	uint32_t current_read_offset;
 	/* Offset of the first available byte in bytes */
@@ -108,9 +170,30 @@ static flash_partition_t not_persistent_partition = {
 	.block_size = EMBEDDED_FLASH_BLOCK_SIZE,
 };
 
+static bool partition_contains(const flash_partition_t *part, uint32_t offset)
+{
+	return offset >= part->start_block * part->block_size &&
+	       offset < (part->start_block + part->nb_blocks) *
+	       part->block_size;
+}
+
+static flash_partition_t *partition_of(uint32_t offset)
+{
+	return partition_contains(&reset_persistent_partition, offset) ?
+	       &reset_persistent_partition : &not_persistent_partition;
+}
+
 #define PROPERTY_FLAG_NONE          0xFF /* 0b11111111 */
 #define PROPERTY_FLAG_OBSOLETE      0xFE /* 0b11111110 */
 
+/* Key of a free entry */
+#define PROPERTY_KEY_FREE           0xffffffff
+/* Key of the record committing a batch */
+#define PROPERTY_KEY_BATCH_COMMIT   0xfffffffe
+/* Key of the record starting a batch */
+#define PROPERTY_KEY_BATCH_BEGIN    0xfffffffd
+#define IS_RESERVED_KEY(key)        ((key) >= PROPERTY_KEY_BATCH_BEGIN)
+
 /* The header for each block is a 32 bits value */
 #define BLOCK_HEADER_SIZE 4
 /* A free header is == 0xffffffff */
@@ -122,8 +205,7 @@ typedef struct {
 	uint32_t key;
 	/* Length of the corresponding data */
 	uint16_t len;
-	/* The entry is obsolete if bit 0 is 0
-	 * It is the last one in a block if bit 1 is 0 */
+	/* The entry is obsolete if bit 0 is 0 */
 	uint8_t pflags;
 	uint8_t reserved;
 } property_flash_header_t;
@@ -132,100 +214,392 @@ typedef struct {
 #define IS_ENTRY_OBSOLETE(prop_header) \
 	(((prop_header).pflags & ~PROPERTY_FLAG_OBSOLETE) == 0)
 
+/* Size of an entry on flash. Batch records have no data: their length is
+ * ignored as it could have been partially written */
+#define ENTRY_SIZE(prop_header)	\
+	(IS_RESERVED_KEY((prop_header).key) ? PROPERTY_HEADER_SIZE : \
+	 NEXT_MULTIPLE_OF_4(PROPERTY_HEADER_SIZE + (prop_header).len))
+
+/* The 8 zero bytes following the last entry of a block read as a header with
+ * all fields at zero, which is not a valid entry as pflags is never 0 */
+#define END_OF_BLOCK_MARKER_SIZE 8
+#define IS_END_OF_BLOCK_MARKER(prop_header) \
+	((prop_header).key == 0 && (prop_header).len == 0 && \
+	 (prop_header).pflags == 0)
+
+/* One entry of a block summary */
+typedef struct {
+	uint32_t key;
+	/* Offset of the entry header from the start of the block */
+	uint16_t offset;
+	/* Length of the corresponding data */
+	uint16_t len;
+} block_summary_entry_t;
+
+/* Last 8 bytes of a closed block */
+typedef struct {
+	uint16_t magic;
+	uint16_t nb_entries;
+	/* Bitwise complement of nb_entries */
+	uint16_t nb_entries_check;
+	uint16_t reserved;
+} block_summary_trailer_t;
+
+#define BLOCK_SUMMARY_MAGIC 0x5053 /* "SP" */
+/* Size of the summary of a block containing n entries */
+#define BLOCK_SUMMARY_SIZE(n) (((n) + 1) * 8)
+/* Number of summary entries read or written with one flash access */
+#define BLOCK_SUMMARY_CHUNK 16
+
 /* This implementation maintains an index of all properties in RAM,
- * the index is re-generated at startup by scanning the content of the
- * blocks allocated to the properties storage */
+ * the index is re-generated at startup from the block summaries, or by
+ * scanning the content of the blocks allocated to the properties storage.
+ *
+ * The index is an open addressing hash table with linear probing. It is sized
+ * to twice the maximum number of properties so that probe sequences remain
+ * short and always end on an unused slot. */
 typedef struct {
 	uint32_t key;
 	uint16_t len;
 	uint8_t used;    /* false if the element is unused */
-	uint8_t reserved;
+	uint8_t flags;
 	uint32_t offset; /* in byte, from byte 0 of block 0 (possibly outside partition) */
 } property_info_t;
 
-static property_info_t ram_cache[PROPERTIES_STORAGE_MAX_NB_PROPERTIES];
+/* The element was indexed from a block summary: its obsolete flag still has
+ * to be checked in its flash header */
+#define PROPERTY_INFO_UNCHECKED 0x01
+/* Previous entries of the property may have been superseded by a batch
+ * without being flagged obsolete */
+#define PROPERTY_INFO_STALE 0x02
+
+#define PROPERTIES_INDEX_SIZE (2 * PROPERTIES_STORAGE_MAX_NB_PROPERTIES)
+#define PROPERTIES_INDEX_MASK (PROPERTIES_INDEX_SIZE - 1)
+
+static property_info_t ram_cache[PROPERTIES_INDEX_SIZE];
+static uint16_t nb_properties;
+
+static uint32_t property_hash(uint32_t key)
+{
+	/* Multiplicative hashing: keys are usually built from a service id in
+	 * the upper bits and a small index in the lower bits */
+	return ((key * 2654435761u) >> 16) & PROPERTIES_INDEX_MASK;
+}
 
 static property_info_t *get_property_info(uint32_t key)
 {
-	for (int i = 0; i < PROPERTIES_STORAGE_MAX_NB_PROPERTIES; ++i) {
-		if (ram_cache[i].key == key && ram_cache[i].used == true)
+	uint32_t i = property_hash(key);
+
+	while (ram_cache[i].used) {
+		if (ram_cache[i].key == key)
 			return &ram_cache[i];
+		i = (i + 1) & PROPERTIES_INDEX_MASK;
 	}
 	return NULL;
 }
-static property_info_t *alloc_property_info()
+
+static property_info_t *alloc_property_info(uint32_t key)
 {
-	for (int i = 0; i < PROPERTIES_STORAGE_MAX_NB_PROPERTIES; ++i) {
-		if (ram_cache[i].used == false) {
-			ram_cache[i].used = true;
-			return &ram_cache[i];
-		}
-	}
-	return NULL;
+	if (nb_properties >= PROPERTIES_STORAGE_MAX_NB_PROPERTIES)
+		return NULL;
+
+	uint32_t i = property_hash(key);
+	while (ram_cache[i].used)
+		i = (i + 1) & PROPERTIES_INDEX_MASK;
+
+	ram_cache[i].used = true;
+	ram_cache[i].key = key;
+	ram_cache[i].flags = 0;
+	nb_properties++;
+	return &ram_cache[i];
 }
 
 static void free_property_info(property_info_t *p)
 {
 	assert(p->used == true);
+
+	uint32_t hole = p - ram_cache;
+	uint32_t i = hole;
+
 	p->used = false;
+	nb_properties--;
+
+	/* Shift back the following elements of the probe sequence which can
+	 * take the freed slot, so that no lookup stops early on it */
+	while (1) {
+		i = (i + 1) & PROPERTIES_INDEX_MASK;
+		if (!ram_cache[i].used)
+			break;
+		uint32_t home = property_hash(ram_cache[i].key);
+		if (((i - home) & PROPERTIES_INDEX_MASK) >=
+		    ((i - hole) & PROPERTIES_INDEX_MASK)) {
+			ram_cache[hole] = ram_cache[i];
+			ram_cache[i].used = false;
+			hole = i;
+		}
+	}
 }
 
 static void clear_all_property_info()
 {
-	for (int i = 0; i < PROPERTIES_STORAGE_MAX_NB_PROPERTIES; ++i)
+	for (int i = 0; i < PROPERTIES_INDEX_SIZE; ++i)
 		ram_cache[i].used = false;
+	nb_properties = 0;
 }
 
-static bool is_entry_last_in_block(uint32_t				offset,
-				   const property_flash_header_t *	pfh)
+/* Add or update a property in the RAM index at boot. Whether its previous
+ * entries were all flagged obsolete is not known */
+static bool index_property(uint32_t key, uint16_t len, uint32_t offset,
+			   uint8_t flags)
 {
-	/* An entry is last in block if the following 8 bytes are equal to zero */
-	uint32_t d[2];
-	unsigned int ret_len;
-	DRIVER_API_RC __maybe_unused ret = soc_flash_read(
-		offset + NEXT_MULTIPLE_OF_4(
-			PROPERTY_HEADER_SIZE + pfh->len), 2, &ret_len, d);
+	property_info_t *p = get_property_info(key);
 
-	assert(ret == DRV_RC_OK && ret_len == 2);
-	return d[0] == 0 && d[1] == 0;
+	if (p == NULL)
+		p = alloc_property_info(key);
+	if (p == NULL)
+		return false;
+	p->len = len;
+	p->offset = offset;
+	p->flags = flags | PROPERTY_INFO_STALE;
+	return true;
 }
 
-static bool set_entry_last_in_block(uint32_t				offset,
-				    const property_flash_header_t *	pfh)
+typedef struct {
+	/* Offset following the last entry of the block */
+	uint32_t end_offset;
+	/* Offset of the last entry of the block */
+	uint32_t last_offset;
+	uint16_t nb_entries;
+	/* True if the end of block marker was found */
+	bool closed;
+} block_scan_t;
+
+/* Find the commit record of the batch whose begin record is at offset.
+ * commit_offset is set to 0 if the batch was not committed.
+ * As we can't recover errors at this level, just return false if
+ * an error occured */
+static bool find_batch_commit(const flash_partition_t *part, uint32_t offset,
+			      uint32_t *commit_offset)
 {
-	static uint32_t d[2] = { 0, 0 };
-	unsigned int ret_len;
-	DRIVER_API_RC ret =
-		soc_flash_write(offset +
-				NEXT_MULTIPLE_OF_4(PROPERTY_HEADER_SIZE +
-						   pfh->len), 2, &ret_len, d);
+	uint32_t block_end = (BLOCK_FOR_OFFSET(part, offset) + 1) *
+			     part->block_size;
+	property_flash_header_t prop_header;
 
-	return ret == DRV_RC_OK && ret_len == 2;
+	*commit_offset = 0;
+	offset += PROPERTY_HEADER_SIZE;
+	while (offset + PROPERTY_HEADER_SIZE <= block_end) {
+		unsigned int ret_len;
+		DRIVER_API_RC ret = soc_flash_read(offset, 2, &ret_len,
+						   (uint32_t *)&prop_header);
+		if (ret != DRV_RC_OK || ret_len != 2)
+			return false;
+		if (prop_header.key == PROPERTY_KEY_BATCH_COMMIT) {
+			*commit_offset = offset;
+			break;
+		}
+		if (IS_RESERVED_KEY(prop_header.key) ||
+		    IS_END_OF_BLOCK_MARKER(prop_header) ||
+		    prop_header.len > PROPERTIES_STORAGE_MAX_VALUE_LEN)
+			break;
+		offset += ENTRY_SIZE(prop_header);
+	}
+	return true;
 }
 
-/* Find next free offset in block */
-static uint32_t find_next_free_offset(const flash_partition_t *part,
-				      uint16_t block, bool *status)
+/* Read all entry headers of a block, optionally adding them to the RAM index.
+ * As we can't recover errors at this level, just return false if
+ * an error occured */
+static bool scan_block(const flash_partition_t *part, uint16_t block,
+		       bool index, block_scan_t *scan)
 {
-	*status = true;
+	uint32_t block_end = (block + 1) * part->block_size;
 	uint32_t offset = block * part->block_size + BLOCK_HEADER_SIZE; /* starts after header */
+	uint32_t commit_offset;
 	property_flash_header_t prop_header = { 0 };
-	while (1) {
+
+	scan->nb_entries = 0;
+	scan->closed = false;
+	scan->last_offset = offset;
+
+	while (offset + PROPERTY_HEADER_SIZE <= block_end) {
 		unsigned int ret_len;
-		DRIVER_API_RC __maybe_unused ret = soc_flash_read(
-			offset, 2, &ret_len,
-			(uint32_t *)&
-			prop_header);
-		if (ret != DRV_RC_OK || ret_len != 2) {
-			*status = false;
-			return 0;
+		DRIVER_API_RC ret = soc_flash_read(offset, 2, &ret_len,
+						   (uint32_t *)&prop_header);
+		if (ret != DRV_RC_OK || ret_len != 2)
+			return false;
+		if (prop_header.key == PROPERTY_KEY_FREE)
+			break;
+		if (IS_END_OF_BLOCK_MARKER(prop_header)) {
+			scan->closed = true;
+			break;
 		}
-		if (prop_header.key == 0xffffffff)
+		if (prop_header.key == PROPERTY_KEY_BATCH_BEGIN) {
+			if (!find_batch_commit(part, offset, &commit_offset))
+				return false;
+			if (commit_offset == 0) {
+				/* The batch was interrupted by a reset: nothing
+				 * can be written after it in this block */
+				scan->closed = true;
+				break;
+			}
+		}
+
+		uint32_t size = ENTRY_SIZE(prop_header);
+		if (size > PROPERTY_HEADER_SIZE +
+		    PROPERTIES_STORAGE_MAX_VALUE_LEN ||
+		    offset + size > block_end) {
+			/* The header was partially written before a reset */
+			scan->closed = true;
 			break;
-		offset += NEXT_MULTIPLE_OF_4(
-			PROPERTY_HEADER_SIZE + prop_header.len);
+		}
+
+		if (index && !IS_RESERVED_KEY(prop_header.key)) {
+			if (!IS_ENTRY_OBSOLETE(prop_header)) {
+				/* The entry is the most up-to-date one seen so
+				 * far for this property */
+				if (!index_property(prop_header.key,
+						    prop_header.len, offset, 0))
+					return false;
+			} else {
+				/* The property was deleted, or will be
+				 * overridden by a more recent entry. An entry of
+				 * the other partition is the one which made
+				 * this one obsolete */
+				property_info_t *p =
+					get_property_info(prop_header.key);
+				if (p && partition_contains(part, p->offset))
+					free_property_info(p);
+			}
+		}
+		scan->last_offset = offset;
+		scan->nb_entries++;
+		offset += size;
+	}
+	scan->end_offset = offset;
+	return true;
+}
+
+/* Fill the RAM index from the summary of a closed block. loaded is set to
+ * false if the block has no valid summary.
+ * As we can't recover errors at this level, just return false if
+ * an error occured */
+static bool load_block_summary(const flash_partition_t *part, uint16_t block,
+			       bool *loaded)
+{
+	uint32_t block_start = block * part->block_size;
+	uint32_t block_end = block_start + part->block_size;
+	block_summary_trailer_t trailer;
+	block_summary_entry_t chunk[BLOCK_SUMMARY_CHUNK];
+	unsigned int ret_len;
+	DRIVER_API_RC ret;
+
+	*loaded = false;
+	ret = soc_flash_read(block_end - sizeof(trailer), 2, &ret_len,
+			     (uint32_t *)&trailer);
+	if (ret != DRV_RC_OK || ret_len != 2)
+		return false;
+	if (trailer.magic != BLOCK_SUMMARY_MAGIC ||
+	    trailer.nb_entries != (uint16_t)~trailer.nb_entries_check ||
+	    BLOCK_SUMMARY_SIZE(trailer.nb_entries) >
+	    part->block_size - BLOCK_HEADER_SIZE)
+		return true;
+
+	uint32_t offset = block_end - BLOCK_SUMMARY_SIZE(trailer.nb_entries);
+	for (int i = 0; i < trailer.nb_entries; i += BLOCK_SUMMARY_CHUNK) {
+		int n = MIN(trailer.nb_entries - i, BLOCK_SUMMARY_CHUNK);
+		ret = soc_flash_read(offset, n * 2, &ret_len,
+				     (uint32_t *)chunk);
+		if (ret != DRV_RC_OK || ret_len != n * 2)
+			return false;
+		for (int j = 0; j < n; j++) {
+			block_summary_entry_t *e = &chunk[j];
+			if (IS_RESERVED_KEY(e->key))
+				continue;
+			if (e->len > PROPERTIES_STORAGE_MAX_VALUE_LEN ||
+			    e->offset < BLOCK_HEADER_SIZE || (e->offset & 3) ||
+			    e->offset + NEXT_MULTIPLE_OF_4(
+				    PROPERTY_HEADER_SIZE + e->len) >
+			    part->block_size)
+				return false;
+			uint8_t flags = PROPERTY_INFO_UNCHECKED;
+			property_info_t *p = get_property_info(e->key);
+			if (p && !partition_contains(part, p->offset)) {
+				/* The property was moved between the
+				 * partitions: only a valid entry overrides the
+				 * one of the other partition */
+				property_flash_header_t pfh;
+				ret = soc_flash_read(block_start + e->offset, 2,
+						     &ret_len,
+						     (uint32_t *)&pfh);
+				if (ret != DRV_RC_OK || ret_len != 2 ||
+				    pfh.key != e->key)
+					return false;
+				if (IS_ENTRY_OBSOLETE(pfh))
+					continue;
+				flags = 0;
+			}
+			if (!index_property(e->key, e->len,
+					    block_start + e->offset, flags))
+				return false;
+		}
+		offset += n * sizeof(block_summary_entry_t);
+	}
+	*loaded = true;
+	return true;
+}
+
+/* Write the summary of the block being closed. It is skipped if the entries
+ * left no room for it, the block is then scanned entry by entry at boot */
+static void write_block_summary(flash_partition_t *part, uint16_t block)
+{
+	uint32_t block_start = block * part->block_size;
+	uint16_t nb_entries = part->nb_entries_in_block;
+
+	if (nb_entries == 0 ||
+	    part->current_write_offset + END_OF_BLOCK_MARKER_SIZE +
+	    BLOCK_SUMMARY_SIZE(nb_entries) > block_start + part->block_size)
+		return;
+
+	block_summary_entry_t chunk[BLOCK_SUMMARY_CHUNK];
+	block_summary_trailer_t trailer = {
+		.magic = BLOCK_SUMMARY_MAGIC,
+		.nb_entries = nb_entries,
+		.nb_entries_check = ~nb_entries,
+		.reserved = 0xffff,
+	};
+	uint32_t src_offset = block_start + BLOCK_HEADER_SIZE;
+	uint32_t dst_offset = block_start + part->block_size -
+			      BLOCK_SUMMARY_SIZE(nb_entries);
+	unsigned int ret_len;
+	DRIVER_API_RC ret;
+	int n = 0;
+
+	for (int i = 0; i < nb_entries; i++) {
+		property_flash_header_t prop_header;
+		ret = soc_flash_read(src_offset, 2, &ret_len,
+				     (uint32_t *)&prop_header);
+		assert(ret == DRV_RC_OK && ret_len == 2);
+		assert(prop_header.key != PROPERTY_KEY_FREE);
+
+		chunk[n].key = prop_header.key;
+		chunk[n].offset = src_offset - block_start;
+		chunk[n].len = prop_header.len;
+		src_offset += ENTRY_SIZE(prop_header);
+
+		if (++n == BLOCK_SUMMARY_CHUNK || i == nb_entries - 1) {
+			ret = storage_flash_write(dst_offset, n * 2, &ret_len,
+					      (uint32_t *)chunk);
+			if (ret != DRV_RC_OK)
+				panic(67);
+			dst_offset += n * sizeof(block_summary_entry_t);
+			n = 0;
+		}
 	}
-	return offset;
+
+	/* The trailer validates the summary */
+	ret = storage_flash_write(dst_offset, 2, &ret_len, (uint32_t *)&trailer);
+	if (ret != DRV_RC_OK)
+		panic(67);
 }
 
 /* Determine which blocks are the oldest and more recently written
@@ -240,6 +614,8 @@ static bool init_read_write_offset_from_flash(flash_partition_t *part)
 	uint32_t max_used_block_header = 0xffffffff;
 	uint32_t nb_unused_block = 0;
 
+	part->nb_entries_in_block = 0;
+
 	for (b = part->start_block;
 	     b < part->start_block + part->nb_blocks;
 	     ++b) {
@@ -277,7 +653,7 @@ static bool init_read_write_offset_from_flash(flash_partition_t *part)
 		/* Init the first partition */
 		unsigned int ret_len;
 		part->last_written_block_header = 0;
-		DRIVER_API_RC ret = soc_flash_write(
+		DRIVER_API_RC ret = storage_flash_write(
 			part->start_block *
 			part->block_size, 1,
 			&ret_len,
@@ -307,80 +683,82 @@ static bool init_read_write_offset_from_flash(flash_partition_t *part)
 	part->current_read_offset = min_used_block * part->block_size +
 				    BLOCK_HEADER_SIZE;
 	part->last_written_block_header = max_used_block_header;
-	bool status;
-	part->current_write_offset = find_next_free_offset(part, max_used_block,
-							   &status);
+	/* The exact write offset in this block is found when filling the
+	 * index */
+	part->current_write_offset = max_used_block * part->block_size +
+				     BLOCK_HEADER_SIZE;
 	part->previous_write_offset = part->current_write_offset;
-	return status;
+	return true;
 }
 
-
-/* Return the offset where to read the next property. It doesn't mean that there
- * is one at this offset */
-static uint32_t get_next_property_offset(
-	const flash_partition_t *	part,
-	uint32_t			offset,
-	const property_flash_header_t * prop_header)
+/* Fill the global properties index in RAM and find the write offset in the
+ * most recent block. write_block_closed is set if this block was closed but
+ * the next one was not started.
+ * As we can't recover errors at this level, just return false if
+ * an error occured */
+static bool fill_index_from_flash(flash_partition_t *	part,
+				  bool *		write_block_closed)
 {
-	/* When this flag is set, we know that this entry is the last one in this
-	 * block and that the next block is already used by the next entry */
-	if (is_entry_last_in_block(offset, prop_header)) {
-		uint16_t next_block =
-			NEXT_BLOCK(part, BLOCK_FOR_OFFSET(part, offset));
-		return next_block * part->block_size + BLOCK_HEADER_SIZE;
+	uint16_t write_block = BLOCK_FOR_OFFSET(part,
+						part->current_write_offset);
+	block_scan_t scan;
+	bool loaded;
+
+	/* Closed blocks are indexed from the oldest to the most recent, so that
+	 * the last entry written for a property overrides the previous ones */
+	for (uint16_t b = OLDEST_BLOCK(part); b != write_block;
+	     b = NEXT_BLOCK(part, b)) {
+		if (!load_block_summary(part, b, &loaded))
+			return false;
+		if (!loaded && !scan_block(part, b, true, &scan))
+			return false;
 	}
-	return offset + NEXT_MULTIPLE_OF_4(
-		       PROPERTY_HEADER_SIZE + prop_header->len);
+
+	if (!scan_block(part, write_block, true, &scan))
+		return false;
+	part->current_write_offset = scan.end_offset;
+	part->previous_write_offset = scan.last_offset;
+	part->nb_entries_in_block = scan.nb_entries;
+	*write_block_closed = scan.closed;
+	return true;
 }
 
-/* Fill the global properties index in RAM
+/* Drop from the index the elements loaded from a block summary whose flash
+ * entry was made obsolete by a delete.
  * As we can't recover errors at this level, just return false if
  * an error occured */
-static bool fill_index_from_flash(const flash_partition_t *part)
+static bool check_unchecked_property_info(void)
 {
-	/* Case of a completely empty store */
-	if (part->current_read_offset == part->current_write_offset)
-		return true;
-
-	/* We can now assume that there is a valid header at position
-	 * part->current_read_offset */
+	int i = 0;
 
-	uint32_t offset = part->current_read_offset;
-	property_flash_header_t prop_header = { 0 };
-
-	/* Read first property */
-	unsigned int ret_len;
-	DRIVER_API_RC ret = soc_flash_read(offset, 2, &ret_len,
-					   (uint32_t *)&prop_header);
-	if (ret != DRV_RC_OK || ret_len != 2 || prop_header.key == 0xffffffff)
-		return false;
-	while (1) {
-		if (!IS_ENTRY_OBSOLETE(prop_header)) {
-			/* The entry is the most up-to-date one for this property, store it
-			 * in our RAM index */
-			property_info_t *p = alloc_property_info();
-			/* As we reload a previous valid storage, we can't overflow by
-			 * design */
-			assert(p);
-
-			p->key = prop_header.key;
-			p->len = prop_header.len;
-			p->offset = offset;
+	while (i < PROPERTIES_INDEX_SIZE) {
+		property_info_t *p = &ram_cache[i];
+		if (!p->used || !(p->flags & PROPERTY_INFO_UNCHECKED)) {
+			i++;
+			continue;
 		}
-		offset = get_next_property_offset(part, offset, &prop_header);
-		ret = soc_flash_read(offset, 2, &ret_len,
-				     (uint32_t *)&prop_header);
-		if (ret != DRV_RC_OK || ret_len != 2)
+
+		property_flash_header_t pfh;
+		unsigned int ret_len;
+		DRIVER_API_RC ret = soc_flash_read(p->offset, 2, &ret_len,
+						   (uint32_t *)&pfh);
+		if (ret != DRV_RC_OK || ret_len != 2 || pfh.key != p->key)
 			return false;
-		if (prop_header.key == 0xffffffff)
-			break;
+		if (IS_ENTRY_OBSOLETE(pfh)) {
+			/* The slot is refilled by the following elements of
+			 * the probe sequence: check it again */
+			free_property_info(p);
+			continue;
+		}
+		p->flags &= ~PROPERTY_INFO_UNCHECKED;
+		i++;
 	}
 	return true;
 }
 
 static void format_partition(flash_partition_t *part)
 {
-	DRIVER_API_RC __maybe_unused ret = soc_flash_block_erase(
+	DRIVER_API_RC __maybe_unused ret = storage_flash_block_erase(
 		part->start_block,
 		part->
 		nb_blocks);
@@ -390,11 +768,24 @@ static void format_partition(flash_partition_t *part)
 	assert(ret == DRV_RC_OK);
 }
 
+static void prepare_next_block(flash_partition_t *part);
+
 /* Intialize the property storage from the flash content. In case of errors, we
  * violently re-format the partition.. */
 void properties_storage_init(void)
 {
 	int run_iter = 0;
+	bool reset_persistent_closed;
+	bool not_persistent_closed;
+
+	BUILD_BUG_ON(!IS_POWER_OF_TWO(PROPERTIES_INDEX_SIZE));
+	BUILD_BUG_ON(sizeof(block_summary_entry_t) != 8);
+	BUILD_BUG_ON(sizeof(block_summary_trailer_t) != 8);
+
+#ifdef CONFIG_QUARK_DRIVER_TESTS
+	nb_flash_writes = 0;
+	power_cut_after = UINT32_MAX;
+#endif
 
 restart:
 	run_iter++;
@@ -415,14 +806,27 @@ restart:
 	}
 
 	/* Fill the RAM index from the flash entries */
-	if (!fill_index_from_flash(&reset_persistent_partition)) {
+	if (!fill_index_from_flash(&reset_persistent_partition,
+				   &reset_persistent_closed)) {
 		format_partition(&reset_persistent_partition);
 		goto restart;
 	}
-	if (!fill_index_from_flash(&not_persistent_partition)) {
+	if (!fill_index_from_flash(&not_persistent_partition,
+				   &not_persistent_closed)) {
+		format_partition(&not_persistent_partition);
+		goto restart;
+	}
+	if (!check_unchecked_property_info()) {
+		format_partition(&reset_persistent_partition);
 		format_partition(&not_persistent_partition);
 		goto restart;
 	}
+
+	/* Complete a block change interrupted by a reset */
+	if (reset_persistent_closed)
+		prepare_next_block(&reset_persistent_partition);
+	if (not_persistent_closed)
+		prepare_next_block(&not_persistent_partition);
 }
 
 void properties_storage_format_all(void)
@@ -432,10 +836,10 @@ void properties_storage_format_all(void)
 	properties_storage_init();
 }
 
-/* Copy the entry at src_offset to the current write offset */
-static void copy_entry_if_not_obsolete(flash_partition_t *	part,
-				       uint32_t *		src_offset,
-				       bool *			last_in_block)
+/* Copy the entry at src_offset to the current write offset. Returns false
+ * when the end of the block is reached */
+static bool copy_entry_if_not_obsolete(flash_partition_t *	part,
+				       uint32_t *		src_offset)
 {
 	uint8_t tmp[PROPERTY_HEADER_SIZE + PROPERTIES_STORAGE_MAX_VALUE_LEN];
 	property_flash_header_t *prop_header = (property_flash_header_t *)tmp;
@@ -445,15 +849,20 @@ static void copy_entry_if_not_obsolete(flash_partition_t *	part,
 		soc_flash_read(*src_offset, 2, &ret_len, (uint32_t *)tmp);
 
 	assert(ret == DRV_RC_OK && ret_len == 2);
-	assert(prop_header->key != 0xffffffff);
 
-	*last_in_block = is_entry_last_in_block(*src_offset, prop_header);
+	if (IS_END_OF_BLOCK_MARKER(*prop_header) ||
+	    prop_header->key == PROPERTY_KEY_FREE)
+		return false;
 
-	const unsigned int value_size = NEXT_MULTIPLE_OF_4(prop_header->len) /
-					4;
+	const unsigned int value_size = (ENTRY_SIZE(*prop_header) -
+					 PROPERTY_HEADER_SIZE) / 4;
+	property_info_t *prop_info = get_property_info(prop_header->key);
 
-	/* Scraps obsolete content */
-	if (!IS_ENTRY_OBSOLETE(*prop_header)) {
+	/* Scraps obsolete content, batch records, and outdated entries which
+	 * were superseded by a batch or could not be flagged obsolete because
+	 * of a reset */
+	if (!IS_ENTRY_OBSOLETE(*prop_header) && prop_info &&
+	    prop_info->offset == *src_offset) {
 		ret =
 			soc_flash_read(*src_offset + PROPERTY_HEADER_SIZE,
 				       value_size,
@@ -463,23 +872,23 @@ static void copy_entry_if_not_obsolete(flash_partition_t *	part,
 		/* Reset all flags */
 		prop_header->pflags = PROPERTY_FLAG_NONE;
 		ret =
-			soc_flash_write(part->current_write_offset, 2 +
+			storage_flash_write(part->current_write_offset, 2 +
 					value_size,
 					&ret_len,
 					(uint32_t *)tmp);
 		assert(ret == DRV_RC_OK && ret_len == 2 + value_size);
 
-		property_info_t *prop_info = get_property_info(prop_header->key);
 		/* Update RAM index for this entry */
-		assert(prop_info);
 		prop_info->offset = part->current_write_offset;
 
 		part->previous_write_offset = part->current_write_offset;
 		part->current_write_offset += PROPERTY_HEADER_SIZE +
 					      value_size * 4;
+		part->nb_entries_in_block++;
 	}
 
 	*src_offset += PROPERTY_HEADER_SIZE + value_size * 4;
+	return true;
 }
 
 static properties_storage_status_t make_entry_obsolete_in_flash(uint32_t offset)
@@ -495,40 +904,127 @@ static properties_storage_status_t make_entry_obsolete_in_flash(uint32_t offset)
 
 	assert(!IS_ENTRY_OBSOLETE(pfh));
 	pfh.pflags &= PROPERTY_FLAG_OBSOLETE;
-	ret = soc_flash_write(offset, 2, &ret_len, (uint32_t *)&pfh);
+	ret = storage_flash_write(offset, 2, &ret_len, (uint32_t *)&pfh);
 	if (ret != DRV_RC_OK)
 		panic(67);
 	return ret;
 }
 
+/* Flag obsolete the entries of a property which were superseded by a batch,
+ * they all precede its current entry at offset */
+static void make_stale_entries_obsolete(const flash_partition_t *part,
+					uint32_t key, uint32_t offset)
+{
+	uint16_t block = OLDEST_BLOCK(part);
+
+	for (int i = 0; i < part->nb_blocks; i++) {
+		uint32_t block_end = (block + 1) * part->block_size;
+		uint32_t entry = block * part->block_size + BLOCK_HEADER_SIZE;
+
+		while (entry + PROPERTY_HEADER_SIZE <= block_end) {
+			property_flash_header_t pfh;
+			unsigned int ret_len;
+			DRIVER_API_RC ret = soc_flash_read(entry, 2, &ret_len,
+							   (uint32_t *)&pfh);
+
+			assert(ret == DRV_RC_OK && ret_len == 2);
+			if (entry == offset)
+				return;
+			if (pfh.key == PROPERTY_KEY_FREE ||
+			    IS_END_OF_BLOCK_MARKER(pfh) ||
+			    ENTRY_SIZE(pfh) > PROPERTY_HEADER_SIZE +
+			    PROPERTIES_STORAGE_MAX_VALUE_LEN)
+				break;
+			if (pfh.key == key && !IS_ENTRY_OBSOLETE(pfh))
+				make_entry_obsolete_in_flash(entry);
+			entry += ENTRY_SIZE(pfh);
+		}
+		block = NEXT_BLOCK(part, block);
+	}
+}
+
+/* Flag obsolete all the entries of a property before it is deleted or moved
+ * to the other partition */
+static properties_storage_status_t make_property_obsolete_in_flash(
+	property_info_t *p)
+{
+	if (p->flags & PROPERTY_INFO_STALE) {
+		make_stale_entries_obsolete(partition_of(p->offset), p->key,
+					    p->offset);
+		p->flags &= ~PROPERTY_INFO_STALE;
+	}
+	return make_entry_obsolete_in_flash(p->offset);
+}
+
+/* Return true if nb_entries entries of size bytes in total fit in the current
+ * write block, while keeping room for the end of block marker and the block
+ * summary */
+static bool entries_fit_in_block(const flash_partition_t *part, uint32_t size,
+				 uint16_t nb_entries)
+{
+	uint32_t block_end =
+		(BLOCK_FOR_OFFSET(part, part->current_write_offset) + 1) *
+		part->block_size;
+
+	return part->current_write_offset + size + END_OF_BLOCK_MARKER_SIZE +
+	       BLOCK_SUMMARY_SIZE(part->nb_entries_in_block + nb_entries) <=
+	       block_end;
+}
+
+/* Make room for nb_entries entries of size bytes in total in the current
+ * write block, moving to the next blocks if needed */
+static properties_storage_status_t make_room_in_block(flash_partition_t *part,
+						      uint32_t		size,
+						      uint16_t		nb_entries)
+{
+	uint16_t old_write_block = BLOCK_FOR_OFFSET(part,
+						    part->current_write_offset);
+
+	/* The space reserved for the end of block marker and the block summary
+	 * also ensures that the new incremented write_offset will still lay
+	 * inside the current block */
+	while (!entries_fit_in_block(part, size, nb_entries)) {
+		/* We don't have enough space in current block, prepare the next one */
+		prepare_next_block(part);
+
+		/* If we have wrapped around looking for a slot large enough, it
+		 * means that the store is completely filled with valid entries */
+		if (old_write_block ==
+		    BLOCK_FOR_OFFSET(part, part->current_write_offset))
+			return PROPERTIES_STORAGE_BOUNDS_ERROR;
+	}
+	return PROPERTIES_STORAGE_SUCCESS;
+}
+
 /* Initialize the next block to prepare writting in it. This may involve
  * shifting the oldest blocks content into the new one to get rid of obsolete
  * properties to make space */
 static void prepare_next_block(flash_partition_t *part)
 {
-	/* Flag the last entry as last in its block */
-	property_flash_header_t pfh = { 0 };
+	/* Flag the end of the block, right after its last entry */
+	static uint32_t d[2] = { 0, 0 };
+	uint16_t block = BLOCK_FOR_OFFSET(part, part->current_write_offset);
 	unsigned int ret_len;
-	DRIVER_API_RC __maybe_unused ret = soc_flash_read(
-		part->previous_write_offset, 2, &ret_len, (uint32_t *)&pfh);
+	DRIVER_API_RC ret = storage_flash_write(part->current_write_offset, 2,
+					    &ret_len, d);
 
-	assert(ret == DRV_RC_OK && ret_len == 2);
-	set_entry_last_in_block(part->previous_write_offset, &pfh);
+	if (ret != DRV_RC_OK)
+		panic(67);
+	write_block_summary(part, block);
 
 	/* Init the next free block by writing its header */
-	uint16_t next_block = NEXT_BLOCK(part, BLOCK_FOR_OFFSET(part,
-								part->
-								current_write_offset));
+	uint16_t next_block = NEXT_BLOCK(part, block);
 	part->last_written_block_header++;
 	if (part->last_written_block_header == UNUSED_BLOCK_HEADER)
 		part->last_written_block_header = 0;
-	ret = soc_flash_write(next_block * part->block_size, 1,
+	ret = storage_flash_write(next_block * part->block_size, 1,
 			      &ret_len,
 			      (uint32_t *)&(part->last_written_block_header));
 	if (ret != DRV_RC_OK)
 		panic(67);
 	part->current_write_offset = next_block * part->block_size +
 				     BLOCK_HEADER_SIZE;
+	part->nb_entries_in_block = 0;
 
 	if (BLOCK_IS_LAST_FREE(part, next_block)) {
 		/* We are starting to write on the last free block, but we always
@@ -539,13 +1035,10 @@ static void prepare_next_block(flash_partition_t *part)
 		uint32_t src_offset = oldest_block * part->block_size +
 				      BLOCK_HEADER_SIZE;
 
-		bool last_in_block = false;
 		/* Copy oldest block in new one. Note that the write_offset of the
 		 * partition is updated within the copy_entry_if_not_obsolete
 		 * function */
-		while (!last_in_block)
-			copy_entry_if_not_obsolete(part, &src_offset,
-						   &last_in_block);
+		while (copy_entry_if_not_obsolete(part, &src_offset)) ;
 
 		part->current_read_offset =
 			NEXT_BLOCK(part,
@@ -554,7 +1047,7 @@ static void prepare_next_block(flash_partition_t *part)
 
 		/* We are done copying one block into the other, we can now clear
 		 * the oldest block */
-		DRIVER_API_RC ret = soc_flash_block_erase(oldest_block, 1);
+		DRIVER_API_RC ret = storage_flash_block_erase(oldest_block, 1);
 		if (ret != DRV_RC_OK)
 			panic(67);
 	}
@@ -565,45 +1058,26 @@ properties_storage_status_t properties_storage_set(
 	const uint8_t *buf,
 	uint16_t len, bool factory_reset_persistent)
 {
-	if (len > PROPERTIES_STORAGE_MAX_VALUE_LEN)
+	if (len > PROPERTIES_STORAGE_MAX_VALUE_LEN || IS_RESERVED_KEY(key))
 		return PROPERTIES_STORAGE_INVALID_ARG;
 
+	/* Don't write anything on flash if the index is full */
+	property_info_t *p = get_property_info(key);
+	if (p == NULL && nb_properties >= PROPERTIES_STORAGE_MAX_NB_PROPERTIES)
+		return PROPERTIES_STORAGE_BOUNDS_ERROR;
+
 	unsigned int ret_len;
 	flash_partition_t *part = factory_reset_persistent ?
 				  &reset_persistent_partition : &
 				  not_persistent_partition;
-
-	uint16_t old_write_block = BLOCK_FOR_OFFSET(part,
-						    part->current_write_offset);
-
-	uint32_t remaining_space_in_block = part->block_size -
-					    (part->current_write_offset %
-					     part->block_size);
+	uint32_t wlen = NEXT_MULTIPLE_OF_4(PROPERTY_HEADER_SIZE + len);
 
 	/* Ensure we have enough contiguous space in the currently written block */
-	/* The "+8" here is important: it ensures that after writing the new
-	 * property, we will still have at least 8 bytes free at the end of the
-	 * block so that:
-	 * - the new incremented write_offset will still lay inside the current
-	 *   block
-	 * - we reserve 8 bytes for potentially flagging this entry as the last
-	 *   one in the block
-	 */
-	while (NEXT_MULTIPLE_OF_4(PROPERTY_HEADER_SIZE + len + 8) >
-	       remaining_space_in_block) {
-		/* We don't have enough space in current block, prepare the next one */
-		prepare_next_block(part);
-
-		/* If we have wrapped around looking for a slot large enough, it
-		 * means that the store is completely filled with valid entries */
-		if (old_write_block ==
-		    BLOCK_FOR_OFFSET(part, part->current_write_offset))
-			return PROPERTIES_STORAGE_BOUNDS_ERROR;
+	if (make_room_in_block(part, wlen, 1) != PROPERTIES_STORAGE_SUCCESS)
+		return PROPERTIES_STORAGE_BOUNDS_ERROR;
 
-		remaining_space_in_block = part->block_size -
-					   (part->current_write_offset %
-					    part->block_size);
-	}
+	/* The block change may have moved the previous entry */
+	p = get_property_info(key);
 
 	/* From this point we know we have enough space available at
 	 * current_write_offset to write the new entry. */
@@ -614,29 +1088,29 @@ properties_storage_status_t properties_storage_set(
 	prop_header->len = len;
 	prop_header->reserved = 0xff;
 	memcpy(tmp + PROPERTY_HEADER_SIZE, buf, len);
-	uint32_t wlen = NEXT_MULTIPLE_OF_4(PROPERTY_HEADER_SIZE + len);
-	DRIVER_API_RC ret = soc_flash_write(part->current_write_offset,
+	DRIVER_API_RC ret = storage_flash_write(part->current_write_offset,
 					    wlen / 4, &ret_len, (uint32_t *)tmp);
 	if (ret != DRV_RC_OK || ret_len != wlen / 4)
 		panic(67);
 	part->previous_write_offset = part->current_write_offset;
 	part->current_write_offset += wlen;
+	part->nb_entries_in_block++;
 	assert(BLOCK_FOR_OFFSET(part, part->current_write_offset) ==
 	       BLOCK_FOR_OFFSET(part, part->previous_write_offset));
 
-	property_info_t *p = get_property_info(key);
 	if (p != NULL) {
 		/* The element was already present in the RAM index, make the previous
 		 * entry obsolete */
-		ret = make_entry_obsolete_in_flash(p->offset);
+		if (partition_contains(part, p->offset))
+			ret = make_entry_obsolete_in_flash(p->offset);
+		else
+			ret = make_property_obsolete_in_flash(p);
 		if (ret != DRV_RC_OK)
 			return PROPERTIES_STORAGE_IO_ERROR;
 	} else {
 		/* Allocate a new property info in our cache */
-		p = alloc_property_info();
-		if (p == NULL)
-			return PROPERTIES_STORAGE_BOUNDS_ERROR;
-		p->key = key;
+		p = alloc_property_info(key);
+		assert(p);
 	}
 	p->offset = part->previous_write_offset;
 	p->len = len;
@@ -644,6 +1118,108 @@ properties_storage_status_t properties_storage_set(
 	return PROPERTIES_STORAGE_SUCCESS;
 }
 
+properties_storage_status_t properties_storage_set_batch(
+	const properties_storage_item_t *items, uint8_t nb_items,
+	bool factory_reset_persistent)
+{
+	flash_partition_t *part = factory_reset_persistent ?
+				  &reset_persistent_partition : &
+				  not_persistent_partition;
+	/* Size of the batch, including its begin and commit records */
+	uint32_t size = 2 * PROPERTY_HEADER_SIZE;
+	int nb_new = 0;
+
+	if (nb_items == 0 || nb_items > PROPERTIES_STORAGE_MAX_BATCH_ITEMS)
+		return PROPERTIES_STORAGE_INVALID_ARG;
+
+	for (int i = 0; i < nb_items; i++) {
+		if (items[i].len > PROPERTIES_STORAGE_MAX_VALUE_LEN ||
+		    IS_RESERVED_KEY(items[i].key))
+			return PROPERTIES_STORAGE_INVALID_ARG;
+		size += NEXT_MULTIPLE_OF_4(PROPERTY_HEADER_SIZE + items[i].len);
+		if (get_property_info(items[i].key) == NULL)
+			nb_new++;
+	}
+
+	/* Don't write anything on flash if the index is full, or if the batch
+	 * can't fit in a block */
+	if (nb_properties + nb_new > PROPERTIES_STORAGE_MAX_NB_PROPERTIES ||
+	    BLOCK_HEADER_SIZE + size + END_OF_BLOCK_MARKER_SIZE +
+	    BLOCK_SUMMARY_SIZE(nb_items + 2) > part->block_size)
+		return PROPERTIES_STORAGE_BOUNDS_ERROR;
+
+	if (make_room_in_block(part, size, nb_items + 2) !=
+	    PROPERTIES_STORAGE_SUCCESS)
+		return PROPERTIES_STORAGE_BOUNDS_ERROR;
+
+	/* The batch is written contiguously, the RAM index is updated only
+	 * once the commit record is written */
+	uint8_t tmp[PROPERTY_HEADER_SIZE + PROPERTIES_STORAGE_MAX_VALUE_LEN];
+	property_flash_header_t *prop_header = (property_flash_header_t *)tmp;
+	unsigned int ret_len;
+	DRIVER_API_RC ret;
+
+	prop_header->pflags = PROPERTY_FLAG_NONE;
+	prop_header->key = PROPERTY_KEY_BATCH_BEGIN;
+	prop_header->len = 0;
+	prop_header->reserved = 0xff;
+	ret = storage_flash_write(part->current_write_offset, 2, &ret_len,
+			      (uint32_t *)tmp);
+	if (ret != DRV_RC_OK || ret_len != 2)
+		panic(67);
+	part->current_write_offset += PROPERTY_HEADER_SIZE;
+	uint32_t batch_offset = part->current_write_offset;
+
+	for (int i = 0; i < nb_items; i++) {
+		uint32_t wlen = NEXT_MULTIPLE_OF_4(PROPERTY_HEADER_SIZE +
+						   items[i].len);
+		prop_header->pflags = PROPERTY_FLAG_NONE;
+		prop_header->key = items[i].key;
+		prop_header->len = items[i].len;
+		prop_header->reserved = 0xff;
+		memcpy(tmp + PROPERTY_HEADER_SIZE, items[i].buf, items[i].len);
+		ret = storage_flash_write(part->current_write_offset, wlen / 4,
+				      &ret_len, (uint32_t *)tmp);
+		if (ret != DRV_RC_OK || ret_len != wlen / 4)
+			panic(67);
+		part->current_write_offset += wlen;
+	}
+
+	prop_header->pflags = PROPERTY_FLAG_NONE;
+	prop_header->key = PROPERTY_KEY_BATCH_COMMIT;
+	prop_header->len = 0;
+	prop_header->reserved = 0xff;
+	ret = storage_flash_write(part->current_write_offset, 2, &ret_len,
+			      (uint32_t *)tmp);
+	if (ret != DRV_RC_OK || ret_len != 2)
+		panic(67);
+	part->previous_write_offset = part->current_write_offset;
+	part->current_write_offset += PROPERTY_HEADER_SIZE;
+	part->nb_entries_in_block += nb_items + 2;
+
+	uint32_t offset = batch_offset;
+	for (int i = 0; i < nb_items; i++) {
+		property_info_t *p = get_property_info(items[i].key);
+		if (p == NULL) {
+			p = alloc_property_info(items[i].key);
+			assert(p);
+		} else if (partition_contains(part, p->offset)) {
+			/* The previous entry is superseded by the batch */
+			p->flags |= PROPERTY_INFO_STALE;
+		} else {
+			/* The batch is committed and moved the property to
+			 * this partition, make the previous entries obsolete */
+			make_property_obsolete_in_flash(p);
+		}
+		p->offset = offset;
+		p->len = items[i].len;
+		offset += NEXT_MULTIPLE_OF_4(PROPERTY_HEADER_SIZE +
+					     items[i].len);
+	}
+
+	return PROPERTIES_STORAGE_SUCCESS;
+}
+
 properties_storage_status_t properties_storage_get_info(
 	uint32_t	key,
 	uint16_t *	len,
@@ -656,15 +1232,8 @@ properties_storage_status_t properties_storage_get_info(
 		return PROPERTIES_STORAGE_KEY_NOT_FOUND_ERROR;
 
 	*len = pinfo->len;
-	*factory_reset_persistent = false;
-	if (pinfo->offset >= reset_persistent_partition.start_block *
-	    reset_persistent_partition.block_size &&
-	    pinfo->offset <
-	    (reset_persistent_partition.start_block +
-	     reset_persistent_partition.nb_blocks) *
-	    reset_persistent_partition.block_size) {
-		*factory_reset_persistent = true;
-	}
+	*factory_reset_persistent = partition_contains(
+		&reset_persistent_partition, pinfo->offset);
 	return PROPERTIES_STORAGE_SUCCESS;
 }
 
@@ -684,37 +1253,21 @@ properties_storage_status_t properties_storage_get(uint32_t key, uint8_t *buf,
 	if (len < pinfo->len)
 		return PROPERTIES_STORAGE_BOUNDS_ERROR;
 
-	/* Read the multiple of 4 part first directly in the output variable */
+	/* Read the header and the padded value in a single flash access */
+	uint32_t tmp[(PROPERTY_HEADER_SIZE + PROPERTIES_STORAGE_MAX_VALUE_LEN) /
+		     4];
+	property_flash_header_t *prop_header = (property_flash_header_t *)tmp;
+	unsigned int wlen = NEXT_MULTIPLE_OF_4(PROPERTY_HEADER_SIZE +
+					       pinfo->len) / 4;
 	unsigned int ret_len;
-	DRIVER_API_RC ret;
-
-	if (pinfo->len > 4) {
-		ret =
-			soc_flash_read(pinfo->offset + PROPERTY_HEADER_SIZE,
-				       (pinfo->len & ~3) / 4, &ret_len,
-				       (uint32_t *)buf);
-		if (ret != DRV_RC_OK) {
-			*readlen = 0;
-			return PROPERTIES_STORAGE_IO_ERROR;
-		}
-
-		if ((pinfo->len & 3) == 0)
-			return PROPERTIES_STORAGE_SUCCESS;
-	}
+	DRIVER_API_RC ret = soc_flash_read(pinfo->offset, wlen, &ret_len, tmp);
 
-	/* Read the rest */
-	uint8_t data[4];
-	ret = soc_flash_read(
-		(pinfo->offset + PROPERTY_HEADER_SIZE + pinfo->len) & ~3, 1,
-		&ret_len,
-		(uint32_t *)&data);
-	if (ret != DRV_RC_OK) {
+	if (ret != DRV_RC_OK || ret_len != wlen || prop_header->key != key) {
 		*readlen = 0;
 		return PROPERTIES_STORAGE_IO_ERROR;
 	}
 
-	for (int i = 0; i < (pinfo->len & 3); ++i)
-		buf[(pinfo->len & ~3) + i] = data[i];
+	memcpy(buf, (uint8_t *)tmp + PROPERTY_HEADER_SIZE, pinfo->len);
 
 	return PROPERTIES_STORAGE_SUCCESS;
 }
@@ -727,7 +1280,7 @@ properties_storage_status_t properties_storage_delete(uint32_t key)
 	if (pinfo == NULL)
 		return PROPERTIES_STORAGE_KEY_NOT_FOUND_ERROR;
 
-	make_entry_obsolete_in_flash(pinfo->offset);
+	make_property_obsolete_in_flash(pinfo);
 	free_property_info(pinfo);
 
 	return PROPERTIES_STORAGE_SUCCESS;
@@ -44,6 +44,7 @@
 #include "machine/soc/intel/quark_se/soc_config.h"
 #include "machine/soc/intel/quark_se/arc/soc_register.h"
 #include "machine/soc/intel/quark_se/quark/uart_tcmd_client.h"
+#include "machine/soc/intel/quark_se/quark/log_backend_uart.h"
 #include "drivers/soc_comparator.h"
 #include "drivers/lp5562.h"
 #include "drivers/apds9190.h"
@@ -287,6 +288,9 @@ struct td_device pf_device_uart1_pm = {
 	.priv = &(struct ns16550_pm_device){
 #ifdef CONFIG_TCMD_CONSOLE_UART
 		.uart_rx_callback = uart_console_input,
+#endif
+#ifdef CONFIG_QUARK_SE_QUARK_LOG_BACKEND_UART_IRQ
+		.uart_tx_callback = log_backend_uart_tx_isr,
 #endif
 		.vector = SOC_UART1_INTERRUPT,
 		.uart_int_mask = INT_UART_1_MASK,
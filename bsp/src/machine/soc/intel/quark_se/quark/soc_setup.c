@@ -54,6 +54,7 @@
 #include "project_mapping.h"
 #include "machine/soc/intel/quark_se/quark/uart_tcmd_client.h"
 #include "machine/soc/intel/quark_se/quark/reboot_reg.h"
+#include "machine/soc/intel/quark_se/quark/log_backend_uart.h"
 #include "infra/boot.h"
 #include "infra/log.h"
 #include "infra/ipc.h"
@@ -246,6 +247,9 @@ void soc_setup(void)
 
 	/* Init wakelocks */
 	pm_wakelock_init_mgr();
+#ifdef CONFIG_QUARK_SE_QUARK_LOG_BACKEND_UART
+	log_backend_uart_init();
+#endif
 
 	/* Init devices */
 	init_all_devices();
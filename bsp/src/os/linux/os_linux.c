@@ -87,38 +87,73 @@ OS_ERR_TYPE bfree(void *ptr)
 
 /*************************    QUEUES   *************************/
 
+/* Messages are kept out of band: their first bytes belong to the caller */
+#define QUEUE_DEFAULT_SIZE 32
+
 typedef struct queue_ {
-	list_head_t lh;
+	void **msgs;
+	int first;
 	int count;
+	int size;
 	int used;
 } q_t;
 
 q_t q_pool[10] = { { 0 }, };
 
-void queue_put(void *queue, void *msg)
+static int queue_put_at(q_t *q, void *msg, bool head)
 {
-	q_t *q = (q_t *)queue;
+	int ret = -1;
+	unsigned int flags = irq_lock();
 
-	list_add(&q->lh, (list_t *)msg);
+	if (q->count < q->size) {
+		if (head) {
+			q->first = (q->first + q->size - 1) % q->size;
+			q->msgs[q->first] = msg;
+		} else {
+			q->msgs[(q->first + q->count) % q->size] = msg;
+		}
+		q->count++;
+		ret = 0;
+	}
+	irq_unlock(flags);
+	return ret;
+}
+
+OS_ERR_TYPE queue_put(void *queue, void *msg)
+{
+	if (queue_put_at((q_t *)queue, msg, false)) {
+		pr_error(LOG_MODULE_OS, "queue %p full", queue);
+		return E_OS_ERR_OVERFLOW;
+	}
 #ifdef DEBUG_OS
 	pr_debug(LOG_MODULE_OS, "queue_put: %p <- %p", queue, msg);
 #endif
+	return E_OS_OK;
 }
-void queue_put_head(void *queue, void *msg)
+OS_ERR_TYPE queue_put_head(void *queue, void *msg)
 {
-	q_t *q = (q_t *)queue;
-
-	list_add_head(&q->lh, (list_t *)msg);
+	if (queue_put_at((q_t *)queue, msg, true)) {
+		pr_error(LOG_MODULE_OS, "queue %p full", queue);
+		return E_OS_ERR_OVERFLOW;
+	}
 #ifdef DEBUG_OS
 	pr_debug(LOG_MODULE_OS, "queue_put: %p <- %p", queue, msg);
 #endif
+	return E_OS_OK;
 }
 
 void *queue_wait(void *queue)
 {
 	q_t *q = (q_t *)queue;
-	void *elem = (void *)list_get(&q->lh);
+	void *elem = NULL;
+	unsigned int flags = irq_lock();
 
+	if (q->count > 0) {
+		elem = q->msgs[q->first];
+		q->first = (q->first + 1) % q->size;
+		q->count--;
+	}
+	irq_unlock(flags);
 #ifdef DEBUG_OS
 	pr_debug(LOG_MODULE_OS, "queue_wait: %p -> %p", queue, elem);
 #endif
@@ -129,18 +164,26 @@ void queue_get_message(T_QUEUE queue, T_QUEUE_MESSAGE *message, int timeout,
 		       OS_ERR_TYPE *err)
 {
 	*message = queue_wait(queue);
+	if (err)
+		*err = *message ? E_OS_OK : E_OS_ERR_EMPTY;
 }
 
 void queue_send_message(T_QUEUE queue, T_QUEUE_MESSAGE message,
 			OS_ERR_TYPE *err)
 {
-	queue_put(queue, message);
+	int ret = queue_put_at((q_t *)queue, message, false);
+
+	if (err)
+		*err = ret ? E_OS_ERR_OVERFLOW : E_OS_OK;
 }
 
 void queue_send_message_head(T_QUEUE queue, T_QUEUE_MESSAGE message,
 			     OS_ERR_TYPE *err)
 {
-	queue_put_head(queue, message);
+	int ret = queue_put_at((q_t *)queue, message, true);
+
+	if (err)
+		*err = ret ? E_OS_ERR_OVERFLOW : E_OS_OK;
 }
 
 T_QUEUE queue_create(uint32_t max_size)
@@ -148,28 +191,35 @@ T_QUEUE queue_create(uint32_t max_size)
 	int i, found = 0;
 	q_t *q;
 
+	if (max_size == 0)
+		max_size = QUEUE_DEFAULT_SIZE;
 	for (i = 0; i < 10; i++) {
 		q = &q_pool[i];
 		if (q->used == 0) {
-			q->used = 1;
 			found = 1;
 			break;
 		}
 	}
 	if (!found) return (T_QUEUE)NULL;
-	list_init(&q->lh);
+	q->msgs = malloc(max_size * sizeof(q->msgs[0]));
+	if (!q->msgs)
+		return (T_QUEUE)NULL;
+	q->used = 1;
+	q->first = 0;
 	q->count = 0;
+	q->size = max_size;
 	return (T_QUEUE)q;
 }
 
 void queue_delete(T_QUEUE queue)
 {
-	void *element = NULL;
 	q_t *q = (q_t *)queue;
 
-	while ((element = list_get(&q->lh)) != NULL)
-		list_remove(&q->lh, element);
-	bfree(q);
+	/* Queues come from q_pool, only their ring is allocated */
+	free(q->msgs);
+	q->msgs = NULL;
+	q->count = 0;
+	q->used = 0;
 }
 
 
@@ -331,7 +381,7 @@ T_TIMER timer_create(T_ENTRY_POINT callback, void *privData, uint32_t delay,
 		     bool repeat, bool startup,
 		     OS_ERR_TYPE *err)
 {
-	struct timer *t = (struct timer *)malloc(sizeof(*t));
+	struct timer *t = (struct timer *)calloc(1, sizeof(*t));
 
 	if (!t)
 		return t;
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#ifdef CONFIG_OS_ZEPHYR
+#include <zephyr.h>
+#elif !defined(__i386__) && !defined(__x86_64__)
+#include <time.h>
+#endif
+
+#include "util/cunit_bench.h"
+
+uint32_t cu_bench_counter(void)
+{
+#if defined(__i386__) || defined(__x86_64__)
+	uint32_t lo, hi;
+
+	__asm__ volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+	return lo;
+#elif defined(CONFIG_OS_ZEPHYR)
+	/* ARC timer 0 count, accumulated over the system ticks */
+	return sys_cycle_get_32();
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+#endif
+}
+
+const char *cu_bench_unit(void)
+{
+#if defined(__i386__) || defined(__x86_64__) || defined(CONFIG_OS_ZEPHYR)
+	return "cycles";
+#else
+	return "ns";
+#endif
+}
+
+/* Cost of reading the counter, removed from the samples */
+static uint32_t counter_overhead(void)
+{
+	uint32_t min = UINT32_MAX;
+	uint32_t start;
+	int i;
+
+	for (i = 0; i < 8; i++) {
+		start = cu_bench_counter();
+		start = cu_bench_counter() - start;
+		if (start < min)
+			min = start;
+	}
+	return min;
+}
+
+static uint32_t sample(cu_bench_body_t body, void *priv, uint32_t n,
+		       uint32_t overhead)
+{
+	uint32_t start = cu_bench_counter();
+
+	body(n, priv);
+	start = cu_bench_counter() - start;
+	return start > overhead ? start - overhead : 0;
+}
+
+void cu_bench_run(const char *name, cu_bench_body_t body, void *priv,
+		  struct cu_bench_result *res)
+{
+	uint32_t samples[CU_BENCH_MAX_SAMPLES];
+	struct cu_bench_result r;
+	uint32_t overhead = counter_overhead();
+	uint32_t best = UINT32_MAX;
+	uint32_t stable = 0;
+	uint32_t t;
+	int i, j;
+
+	/* Warm up, and grow the samples until they can be timed */
+	r.iter = 1;
+	body(1, priv);
+	while ((t = sample(body, priv, r.iter, overhead)) <
+	       CU_BENCH_SAMPLE_TICKS && r.iter < CU_BENCH_MAX_ITER) {
+		if (t < CU_BENCH_SAMPLE_TICKS / 16)
+			r.iter *= 16;
+		else
+			r.iter *= 2;
+		if (r.iter > CU_BENCH_MAX_ITER)
+			r.iter = CU_BENCH_MAX_ITER;
+	}
+
+	for (r.samples = 0; r.samples < CU_BENCH_MAX_SAMPLES; r.samples++) {
+		if (r.samples >= CU_BENCH_MIN_SAMPLES &&
+		    stable >= CU_BENCH_STABLE)
+			break;
+		t = sample(body, priv, r.iter, overhead);
+		if (t < best - best / 100) {
+			best = t;
+			stable = 0;
+		} else {
+			stable++;
+			if (t < best)
+				best = t;
+		}
+		/* Keep the samples sorted */
+		for (i = r.samples; i > 0 && samples[i - 1] > t; i--)
+			samples[i] = samples[i - 1];
+		samples[i] = t;
+	}
+
+	j = r.iter / 2;
+	r.min = (samples[0] + j) / r.iter;
+	r.median = (samples[r.samples / 2] + j) / r.iter;
+	r.max = (samples[r.samples - 1] + j) / r.iter;
+
+	cu_print("CU_BENCH %s %s iter=%u samples=%u min=%u med=%u max=%u\n",
+		 name, cu_bench_unit(), r.iter, r.samples, r.min, r.median,
+		 r.max);
+	if (res)
+		*res = r;
+}
@@ -0,0 +1,520 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include "util/event_journal.h"
+
+/*
+ * The journal area is a ring of sectors, written in sequence. Each sector
+ * starts with a header, followed by frames of records:
+ *
+ *   sector:  | header | frame | frame | ... | 0xff padding |
+ *   frame:   | seq (4) | count (1) | 0 (1) | crc (2) | count records |
+ *
+ * The crc is a CRC16-CCITT over the frame, crc field excluded. A frame never
+ * spans two pages, and only starts where its header and one record fit in
+ * the page: readers skip the end of the pages the same way as the writer.
+ * A frame without record is an acknowledge, telling that the records before
+ * its seq have been consumed.
+ *
+ * Sector sequence number s is always stored in sector s % nb_sectors, so the
+ * head sector is found by a binary search on the lap number, as for the
+ * flash log backend. The sector header also holds the next record and first
+ * unconsumed record numbers when it was opened: mounting only reads the
+ * head sector.
+ */
+
+#define JOURNAL_SECTOR_MAGIC    0x4c4e524a /* "JRNL" */
+
+struct journal_sector {
+	uint32_t magic;
+	uint32_t seq;           /* sector sequence number */
+	uint32_t first_record;  /* sequence number of the next record */
+	uint32_t read_seq;      /* first unconsumed record */
+	uint32_t check;
+};
+
+struct journal_frame {
+	uint32_t seq;           /* first record, or first unconsumed for an ack */
+	uint8_t count;
+	uint8_t zero;
+	uint16_t crc;
+};
+
+#define FRAME_SIZE              sizeof(struct journal_frame)
+#define PAGE_OFFSET(addr)       ((addr) & (EVENT_JOURNAL_PAGE_SIZE - 1))
+#define SECTOR_ADDR(j, s)       (((s) % (j)->nb_sectors) * (j)->sector_size)
+
+static uint16_t journal_crc16(uint16_t crc, const uint8_t *buf, uint32_t len)
+{
+	int i;
+
+	while (len--) {
+		crc ^= (uint16_t)*buf++ << 8;
+		for (i = 0; i < 8; i++)
+			crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+	}
+	return crc;
+}
+
+static uint16_t frame_crc(const struct event_journal *j, const uint8_t *frame,
+			  uint8_t count)
+{
+	uint16_t crc;
+
+	crc = journal_crc16(0xffff, frame, offsetof(struct journal_frame, crc));
+	return journal_crc16(crc, frame + FRAME_SIZE, count * j->elt_size);
+}
+
+static uint32_t sector_check(const struct journal_sector *hdr)
+{
+	return ~(hdr->magic ^ hdr->seq ^ hdr->first_record ^ hdr->read_seq);
+}
+
+static bool sector_valid(const struct event_journal *j,
+			 const struct journal_sector *hdr, uint32_t idx)
+{
+	return hdr->magic == JOURNAL_SECTOR_MAGIC &&
+	       hdr->check == sector_check(hdr) &&
+	       hdr->seq % j->nb_sectors == idx;
+}
+
+/* Return true if a frame holding one record fits at this page offset */
+static bool frame_fits(const struct event_journal *j, uint32_t offset)
+{
+	return offset + FRAME_SIZE + j->elt_size <= EVENT_JOURNAL_PAGE_SIZE;
+}
+
+static int journal_read(struct event_journal *j, uint32_t addr, void *buf,
+			uint32_t len)
+{
+	j->stats.reads++;
+	if (j->ops->read(j->ops->priv, addr, buf, len)) {
+		j->stats.errors++;
+		return -1;
+	}
+	return 0;
+}
+
+/* Program the part of the page which is not yet in flash */
+static int program_page(struct event_journal *j)
+{
+	int ret = 0;
+
+	if (j->page_fill <= j->programmed)
+		return 0;
+	j->stats.programs++;
+	if (j->ops->write(j->ops->priv, j->page_addr + j->programmed,
+			  &j->page[j->programmed],
+			  j->page_fill - j->programmed)) {
+		j->stats.errors++;
+		ret = -1;
+	}
+	j->programmed = j->page_fill;
+	return ret;
+}
+
+/* Start buffering the page at addr, whose first bytes are already in flash */
+static void load_page(struct event_journal *j, uint32_t addr)
+{
+	j->page_addr = addr - PAGE_OFFSET(addr);
+	j->page_fill = PAGE_OFFSET(addr);
+	j->programmed = j->page_fill;
+	memset(j->page, 0xff, sizeof(j->page));
+}
+
+/* Erase the next sector of the ring and stage its header */
+static int open_sector(struct event_journal *j)
+{
+	struct journal_sector hdr;
+	int ret = program_page(j);
+	uint32_t idx;
+
+	j->sector_seq++;
+	idx = j->sector_seq % j->nb_sectors;
+	j->stats.erases++;
+	if (j->ops->erase(j->ops->priv, idx)) {
+		j->stats.errors++;
+		ret = -1;
+	}
+
+	hdr.magic = JOURNAL_SECTOR_MAGIC;
+	hdr.seq = j->sector_seq;
+	hdr.first_record = j->next_seq;
+	hdr.read_seq = j->read_seq;
+	hdr.check = sector_check(&hdr);
+	load_page(j, idx * j->sector_size);
+	memcpy(j->page, &hdr, sizeof(hdr));
+	j->page_fill = sizeof(hdr);
+	return ret;
+}
+
+static void close_frame(struct event_journal *j)
+{
+	struct journal_frame f;
+
+	if (j->frame < 0)
+		return;
+	memcpy(&f, &j->page[j->frame], FRAME_SIZE);
+	f.crc = frame_crc(j, &j->page[j->frame], f.count);
+	memcpy(&j->page[j->frame], &f, FRAME_SIZE);
+	j->frame = -1;
+}
+
+/* Start a frame at the write position, in the next page if it is full */
+static int open_frame(struct event_journal *j, uint32_t seq)
+{
+	struct journal_frame f = { .seq = seq, .count = 0, .zero = 0 };
+	int ret = 0;
+
+	close_frame(j);
+	if (!frame_fits(j, j->page_fill)) {
+		ret = program_page(j);
+		if ((j->page_addr + EVENT_JOURNAL_PAGE_SIZE) % j->sector_size)
+			load_page(j, j->page_addr + EVENT_JOURNAL_PAGE_SIZE);
+		else if (open_sector(j))
+			ret = -1;
+	}
+	j->frame = j->page_fill;
+	memcpy(&j->page[j->page_fill], &f, FRAME_SIZE);
+	j->page_fill += FRAME_SIZE;
+	return ret;
+}
+
+int event_journal_append(struct event_journal *j, const void *elt)
+{
+	int ret = 0;
+
+	if (j->frame < 0)
+		ret = open_frame(j, j->next_seq);
+
+	memcpy(&j->page[j->page_fill], elt, j->elt_size);
+	j->page_fill += j->elt_size;
+	j->page[j->frame + offsetof(struct journal_frame, count)]++;
+	j->next_seq++;
+	j->stats.appended++;
+
+	/* Program the page as soon as it cannot hold another record */
+	if (j->page_fill + j->elt_size > EVENT_JOURNAL_PAGE_SIZE) {
+		close_frame(j);
+		if (program_page(j))
+			ret = -1;
+	}
+	return ret;
+}
+
+int event_journal_flush(struct event_journal *j)
+{
+	close_frame(j);
+	return program_page(j);
+}
+
+uint16_t event_journal_staged(struct event_journal *j, uint32_t *offset,
+			      const uint8_t **buf)
+{
+	close_frame(j);
+	*offset = j->page_addr + j->programmed;
+	*buf = &j->page[j->programmed];
+	return j->page_fill > j->programmed ? j->page_fill - j->programmed : 0;
+}
+
+int event_journal_restore(struct event_journal *j, uint32_t offset,
+			  const uint8_t *buf, uint16_t len)
+{
+	uint8_t erased[FRAME_SIZE];
+	uint32_t i, k, n;
+
+	if (!len || PAGE_OFFSET(offset) + len > EVENT_JOURNAL_PAGE_SIZE ||
+	    offset + len > j->nb_sectors * j->sector_size)
+		return -1;
+
+	for (i = 0; i < len; i += n) {
+		n = len - i < sizeof(erased) ? len - i : sizeof(erased);
+		if (journal_read(j, offset + i, erased, n))
+			return -1;
+		for (k = 0; k < n; k++)
+			if (erased[k] != 0xff)
+				return -1;
+	}
+
+	if (j->ops->write(j->ops->priv, offset, buf, len)) {
+		j->stats.errors++;
+		return -1;
+	}
+	return event_journal_init(j, j->ops, j->sector_size, j->nb_sectors,
+				  j->elt_size);
+}
+
+void event_journal_consume(struct event_journal *j, uint32_t seq)
+{
+	if (seq > j->next_seq)
+		seq = j->next_seq;
+	if (seq <= j->read_seq)
+		return;
+	j->read_seq = seq;
+	open_frame(j, seq);
+	close_frame(j);
+}
+
+/* Return the lap of a sector (number of wraps of the ring), -1 if erased */
+static int32_t sector_lap(struct event_journal *j, uint32_t idx,
+			  struct journal_sector *hdr)
+{
+	if (journal_read(j, idx * j->sector_size, hdr, sizeof(*hdr)) ||
+	    !sector_valid(j, hdr, idx))
+		return -1;
+	return hdr->seq / j->nb_sectors;
+}
+
+/*
+ * Find the first free byte of the head sector by following the frames, and
+ * the record numbers from the frames found. Return false if the sector
+ * cannot be appended to.
+ */
+static bool recover_head(struct event_journal *j, uint32_t idx,
+			 const struct journal_sector *hdr)
+{
+	struct journal_frame f;
+	uint32_t addr = idx * j->sector_size + sizeof(*hdr);
+	uint32_t end = (idx + 1) * j->sector_size;
+	uint32_t last = 0, next_seq = 0, read_seq = 0, len = 0;
+
+	j->next_seq = hdr->first_record;
+	j->read_seq = hdr->read_seq;
+	while (addr < end) {
+		if (!frame_fits(j, PAGE_OFFSET(addr))) {
+			addr += EVENT_JOURNAL_PAGE_SIZE - PAGE_OFFSET(addr);
+			continue;
+		}
+		if (journal_read(j, addr, &f, FRAME_SIZE))
+			return false;
+		if (f.zero == 0xff)
+			break;
+		len = FRAME_SIZE + f.count * j->elt_size;
+		if (f.zero || PAGE_OFFSET(addr) + len > EVENT_JOURNAL_PAGE_SIZE)
+			/* Torn frame header */
+			return false;
+		/* Numbers before the last frame, in case it is torn */
+		next_seq = j->next_seq;
+		read_seq = j->read_seq;
+		if (f.count)
+			j->next_seq = f.seq + f.count;
+		else if (f.seq > j->read_seq)
+			j->read_seq = f.seq;
+		last = addr;
+		addr += len;
+	}
+
+	if (last) {
+		/* Only the last frame may have been cut by a power loss */
+		if (journal_read(j, last, j->page, len))
+			return false;
+		memcpy(&f, j->page, FRAME_SIZE);
+		if (f.crc != frame_crc(j, j->page, f.count)) {
+			j->next_seq = next_seq;
+			j->read_seq = read_seq;
+			return false;
+		}
+	}
+	if (j->read_seq > j->next_seq)
+		j->read_seq = j->next_seq;
+	if (addr >= end)
+		return false;
+	load_page(j, addr);
+	return true;
+}
+
+int event_journal_init(struct event_journal *j,
+		       const struct event_journal_ops *ops,
+		       uint32_t sector_size, uint16_t nb_sectors,
+		       uint16_t elt_size)
+{
+	struct journal_sector hdr;
+	int32_t lap0;
+	uint32_t lo, hi, mid;
+
+	if (sector_size % EVENT_JOURNAL_PAGE_SIZE || nb_sectors < 2 ||
+	    !elt_size || sizeof(hdr) + FRAME_SIZE + elt_size >
+	    EVENT_JOURNAL_PAGE_SIZE)
+		return -1;
+
+	memset(j, 0, sizeof(*j));
+	j->ops = ops;
+	j->sector_size = sector_size;
+	j->nb_sectors = nb_sectors;
+	j->elt_size = elt_size;
+	j->frame = -1;
+
+	lap0 = sector_lap(j, 0, &hdr);
+	if (lap0 < 0) {
+		/* Either the area is empty or sector 0 was being erased */
+		lo = nb_sectors - 1;
+		if (sector_lap(j, lo, &hdr) < 0) {
+			j->sector_seq = (uint32_t)-1;
+			return open_sector(j);
+		}
+	} else {
+		/* Last sector written during the same lap as sector 0 */
+		lo = 0;
+		hi = nb_sectors;
+		while (hi - lo > 1) {
+			mid = (lo + hi) / 2;
+			if (sector_lap(j, mid, &hdr) == lap0)
+				lo = mid;
+			else
+				hi = mid;
+		}
+		sector_lap(j, lo, &hdr);
+	}
+
+	j->sector_seq = hdr.seq;
+	if (!recover_head(j, lo, &hdr))
+		return open_sector(j);
+	return 0;
+}
+
+/* Load a page of the area in the cursor buffer */
+static bool iter_load(struct event_journal_iter *it, uint32_t addr)
+{
+	it->addr = addr;
+	it->pos = 0;
+	return !journal_read(it->journal, addr, it->buf, sizeof(it->buf));
+}
+
+/* Load the first page of sector seq, return false if it holds another one */
+static bool iter_sector(struct event_journal_iter *it, uint32_t seq,
+			struct journal_sector *hdr)
+{
+	struct event_journal *j = it->journal;
+
+	it->sector_seq = seq;
+	if (!iter_load(it, SECTOR_ADDR(j, seq)))
+		return false;
+	memcpy(hdr, it->buf, sizeof(*hdr));
+	it->pos = sizeof(*hdr);
+	return sector_valid(j, hdr, seq % j->nb_sectors) && hdr->seq == seq;
+}
+
+static void iter_next_sector(struct event_journal_iter *it)
+{
+	struct journal_sector hdr;
+
+	while (it->sector_seq != it->journal->sector_seq)
+		if (iter_sector(it, it->sector_seq + 1, &hdr))
+			return;
+	it->done = true;
+}
+
+void event_journal_iter_init(struct event_journal *j,
+			     struct event_journal_iter *it)
+{
+	struct journal_sector hdr;
+	uint32_t seq = j->sector_seq;
+	uint32_t oldest = seq >= j->nb_sectors - 1U ?
+			  seq - (j->nb_sectors - 1U) : 0;
+	uint32_t start = seq;
+	bool found = false;
+
+	it->journal = j;
+	it->next_seq = j->read_seq;
+	it->lost = 0;
+	it->left = 0;
+	it->done = false;
+
+	/* Look backwards for the sector holding the first unconsumed record */
+	while (iter_sector(it, seq, &hdr)) {
+		start = seq;
+		found = true;
+		if (hdr.first_record <= it->next_seq || seq == oldest)
+			break;
+		seq--;
+	}
+	if (!found)
+		it->done = true;
+	else if (it->sector_seq != start && !iter_sector(it, start, &hdr))
+		iter_next_sector(it);
+}
+
+const void *event_journal_iter_next(struct event_journal_iter *it,
+				    uint32_t *seq)
+{
+	struct event_journal *j = it->journal;
+	struct journal_frame f;
+	const uint8_t *elt;
+	uint32_t len, s;
+
+	while (!it->done) {
+		if (it->left) {
+			elt = &it->buf[it->pos];
+			it->pos += j->elt_size;
+			it->left--;
+			s = it->seq++;
+			if (s < it->next_seq)
+				/* Already consumed, or seen before a wrap */
+				continue;
+			it->lost += s - it->next_seq;
+			it->next_seq = s + 1;
+			if (seq)
+				*seq = s;
+			return elt;
+		}
+
+		if (!frame_fits(j, it->pos)) {
+			if ((it->addr + EVENT_JOURNAL_PAGE_SIZE) % j->sector_size &&
+			    iter_load(it, it->addr + EVENT_JOURNAL_PAGE_SIZE))
+				continue;
+			iter_next_sector(it);
+			continue;
+		}
+
+		memcpy(&f, &it->buf[it->pos], FRAME_SIZE);
+		if (f.zero == 0xff) {
+			/* Nothing more in this sector */
+			iter_next_sector(it);
+			continue;
+		}
+		len = FRAME_SIZE + f.count * j->elt_size;
+		if (f.zero || it->pos + len > EVENT_JOURNAL_PAGE_SIZE) {
+			/* Corrupted header, skip the rest of the page */
+			it->pos = EVENT_JOURNAL_PAGE_SIZE;
+			continue;
+		}
+		if (f.crc != frame_crc(j, &it->buf[it->pos], f.count)) {
+			it->pos += len;
+			continue;
+		}
+		it->pos += FRAME_SIZE;
+		it->seq = f.seq;
+		it->left = f.count;
+	}
+	return NULL;
+}
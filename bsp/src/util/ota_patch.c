@@ -0,0 +1,558 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+
+#include "util/ota_patch.h"
+#include "util/misc.h"
+
+/* Applier states */
+#define STATE_HEADER    0
+#define STATE_PAYLOAD   1
+#define STATE_SKIP      2
+
+/* LZG stream format (liblzg) */
+#define LZG_HEADER_SIZE 16
+#define LZG_METHOD_COPY 0
+#define LZG_METHOD_LZG1 1
+
+/* Minibsdiff patch format */
+#define BSDIFF_HEADER_SIZE 32
+#define BSDIFF_CTRL_SIZE   24
+
+/* Size of the stack buffer used to compare or add flash content */
+#define SCRATCH_SIZE    32
+
+static const uint32_t crc32_nibble[16] = {
+	0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac,
+	0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+	0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c,
+	0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c
+};
+
+static const uint8_t lzg_length_decode[32] = {
+	2,  3,	4,  5,	6,  7,	8,  9,	10, 11, 12, 13, 14, 15, 16, 17,
+	18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 35, 48, 72, 128
+};
+
+uint32_t ota_crc32(uint32_t crc, const uint8_t *buf, uint32_t len)
+{
+	crc = ~crc;
+	while (len--) {
+		crc ^= *buf++;
+		crc = (crc >> 4) ^ crc32_nibble[crc & 0xf];
+		crc = (crc >> 4) ^ crc32_nibble[crc & 0xf];
+	}
+	return ~crc;
+}
+
+static uint32_t get_be32(const uint8_t *p)
+{
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+	       ((uint32_t)p[2] << 8) | p[3];
+}
+
+static void lzg_start(struct ota_lzg *lzg, uint8_t *dst, uint32_t dst_size)
+{
+	memset(lzg, 0, sizeof(*lzg));
+	lzg->dst = dst;
+	lzg->dst_size = dst_size;
+	lzg->sum_a = 1;
+}
+
+static int lzg_parse_header(struct ota_lzg *lzg)
+{
+	if (lzg->hdr[0] != 'L' || lzg->hdr[1] != 'Z' || lzg->hdr[2] != 'G')
+		return OTA_PATCH_ERR_DECODE;
+
+	lzg->decoded_size = get_be32(&lzg->hdr[3]);
+	lzg->encoded_size = get_be32(&lzg->hdr[7]);
+	lzg->checksum = get_be32(&lzg->hdr[11]);
+	lzg->method = lzg->hdr[15];
+
+	if (lzg->method != LZG_METHOD_COPY && lzg->method != LZG_METHOD_LZG1)
+		return OTA_PATCH_ERR_DECODE;
+	if (lzg->decoded_size > lzg->dst_size)
+		return OTA_PATCH_ERR_NO_MEM;
+	return OTA_PATCH_OK;
+}
+
+/* Decode the symbol held in lzg->sym, which is known to be complete */
+static int lzg_decode_symbol(struct ota_lzg *lzg)
+{
+	uint8_t s = lzg->sym[0];
+	uint8_t b = lzg->sym[1];
+	uint32_t length;
+	uint32_t offset;
+	uint8_t *dst;
+
+	if (s == lzg->marker[0]) {
+		/* Distant copy */
+		length = lzg_length_decode[b & 0x1f];
+		offset = (((uint32_t)(b & 0xe0)) << 11) |
+			 ((uint32_t)lzg->sym[2] << 8) | lzg->sym[3];
+		offset += 2056;
+	} else if (s == lzg->marker[1]) {
+		/* Medium copy */
+		length = lzg_length_decode[b & 0x1f];
+		offset = (((uint32_t)(b & 0xe0)) << 3) | lzg->sym[2];
+		offset += 8;
+	} else if (s == lzg->marker[2]) {
+		/* Short copy */
+		length = (b >> 6) + 3;
+		offset = (b & 0x3f) + 8;
+	} else {
+		/* Near copy (RLE) */
+		length = lzg_length_decode[b & 0x1f];
+		offset = (b >> 5) + 1;
+	}
+
+	if (offset > lzg->dst_pos || length > lzg->decoded_size - lzg->dst_pos)
+		return OTA_PATCH_ERR_DECODE;
+
+	/* Source and destination may overlap: copy byte per byte */
+	dst = &lzg->dst[lzg->dst_pos];
+	lzg->dst_pos += length;
+	while (length--) {
+		*dst = *(dst - offset);
+		dst++;
+	}
+	return OTA_PATCH_OK;
+}
+
+static int lzg_push(struct ota_lzg *lzg, uint8_t c)
+{
+	uint32_t data_pos;
+	uint8_t need;
+	uint8_t s;
+
+	if (lzg->encoded_pos < LZG_HEADER_SIZE) {
+		lzg->hdr[lzg->encoded_pos++] = c;
+		if (lzg->encoded_pos == LZG_HEADER_SIZE)
+			return lzg_parse_header(lzg);
+		return OTA_PATCH_OK;
+	}
+
+	data_pos = lzg->encoded_pos++ - LZG_HEADER_SIZE;
+	if (data_pos >= lzg->encoded_size)
+		return OTA_PATCH_ERR_DECODE;
+	lzg->sum_a += c;
+	lzg->sum_b += lzg->sum_a;
+
+	if (lzg->method == LZG_METHOD_COPY) {
+		if (lzg->dst_pos >= lzg->decoded_size)
+			return OTA_PATCH_ERR_DECODE;
+		lzg->dst[lzg->dst_pos++] = c;
+		return OTA_PATCH_OK;
+	}
+
+	/* LZG1 streams start with the 4 marker symbols */
+	if (data_pos < sizeof(lzg->marker)) {
+		lzg->marker[data_pos] = c;
+		return OTA_PATCH_OK;
+	}
+
+	lzg->sym[lzg->sym_len++] = c;
+	s = lzg->sym[0];
+	if (s != lzg->marker[0] && s != lzg->marker[1] &&
+	    s != lzg->marker[2] && s != lzg->marker[3]) {
+		need = 1;
+	} else if (lzg->sym_len < 2) {
+		return OTA_PATCH_OK;
+	} else if (lzg->sym[1] == 0) {
+		/* Marker symbol used as a literal */
+		need = 2;
+	} else if (s == lzg->marker[0]) {
+		need = 4;
+	} else if (s == lzg->marker[1]) {
+		need = 3;
+	} else {
+		need = 2;
+	}
+	if (lzg->sym_len < need)
+		return OTA_PATCH_OK;
+
+	lzg->sym_len = 0;
+	if (need > 2 || (need == 2 && lzg->sym[1] != 0))
+		return lzg_decode_symbol(lzg);
+
+	if (lzg->dst_pos >= lzg->decoded_size)
+		return OTA_PATCH_ERR_DECODE;
+	lzg->dst[lzg->dst_pos++] = s;
+	return OTA_PATCH_OK;
+}
+
+static int lzg_end(struct ota_lzg *lzg)
+{
+	if (lzg->encoded_pos < LZG_HEADER_SIZE ||
+	    lzg->encoded_pos - LZG_HEADER_SIZE != lzg->encoded_size ||
+	    lzg->sym_len != 0 || lzg->dst_pos != lzg->decoded_size ||
+	    lzg->checksum != (((uint32_t)lzg->sum_b << 16) | lzg->sum_a))
+		return OTA_PATCH_ERR_DECODE;
+	return OTA_PATCH_OK;
+}
+
+/*
+ * bsdiff offsets are 64-bit sign-magnitude little endian values, only the
+ * ones fitting in 31 bits can be valid in a chunk.
+ */
+static bool offtin(const uint8_t *buf, int32_t *val)
+{
+	if (buf[4] || buf[5] || buf[6] || (buf[7] & 0x7f) || (buf[3] & 0x80))
+		return false;
+
+	*val = (int32_t)(buf[0] | ((uint32_t)buf[1] << 8) |
+			 ((uint32_t)buf[2] << 16) | ((uint32_t)buf[3] << 24));
+	if (buf[7] & 0x80)
+		*val = -*val;
+	return true;
+}
+
+/* Add the installed chunk bytes [old_pos, old_pos + len) to dst */
+static int add_old(struct ota_patch_ctx *ctx, uint8_t *dst, int32_t old_pos,
+		   int32_t len)
+{
+	const struct ota_chunk_header *hdr = &ctx->hdr;
+	uint32_t base = hdr->id * ctx->chunk_size;
+	uint8_t scratch[SCRATCH_SIZE];
+	int32_t start = 0;
+	int32_t end = len;
+	int32_t n;
+	int32_t i;
+
+	/* Bytes outside of the installed chunk are taken as 0 */
+	if (old_pos < 0)
+		start = MIN(-old_pos, len);
+	if (old_pos + end > (int32_t)hdr->from_len)
+		end = MAX((int32_t)hdr->from_len - old_pos, start);
+
+	while (start < end) {
+		n = MIN(end - start, SCRATCH_SIZE);
+		if (ctx->ops->read_old(ctx->ops->priv, base + old_pos + start,
+				       scratch, n))
+			return OTA_PATCH_ERR_FLASH;
+		for (i = 0; i < n; i++)
+			dst[start + i] += scratch[i];
+		start += n;
+	}
+	return OTA_PATCH_OK;
+}
+
+/* Rebuild the new chunk in out_buf from the decoded patch */
+static int bspatch_chunk(struct ota_patch_ctx *ctx, const uint8_t *patch,
+			 uint32_t patch_len)
+{
+	int32_t new_size = ctx->hdr.to_len;
+	int32_t ctrl_len, diff_len, extra_len, new_len;
+	const uint8_t *ctrl, *diff, *extra;
+	int32_t new_pos = 0;
+	int32_t old_pos = 0;
+	int32_t x, y, z;
+	int rc;
+
+	if (patch_len < BSDIFF_HEADER_SIZE || memcmp(patch, "MBSDIF43", 8) ||
+	    !offtin(&patch[8], &ctrl_len) || !offtin(&patch[16], &diff_len) ||
+	    !offtin(&patch[24], &new_len) || ctrl_len < 0 || diff_len < 0 ||
+	    new_len != new_size ||
+	    (uint32_t)ctrl_len + diff_len > patch_len - BSDIFF_HEADER_SIZE)
+		return OTA_PATCH_ERR_DECODE;
+
+	ctrl = &patch[BSDIFF_HEADER_SIZE];
+	diff = ctrl + ctrl_len;
+	extra = diff + diff_len;
+	extra_len = patch_len - BSDIFF_HEADER_SIZE - ctrl_len - diff_len;
+
+	while (new_pos < new_size) {
+		if (ctrl_len < BSDIFF_CTRL_SIZE || !offtin(&ctrl[0], &x) ||
+		    !offtin(&ctrl[8], &y) || !offtin(&ctrl[16], &z))
+			return OTA_PATCH_ERR_DECODE;
+		ctrl += BSDIFF_CTRL_SIZE;
+		ctrl_len -= BSDIFF_CTRL_SIZE;
+
+		/* Add x bytes of diff to the installed chunk */
+		if (x < 0 || x > new_size - new_pos || x > diff_len)
+			return OTA_PATCH_ERR_DECODE;
+		memcpy(&ctx->out_buf[new_pos], diff, x);
+		rc = add_old(ctx, &ctx->out_buf[new_pos], old_pos, x);
+		if (rc)
+			return rc;
+		diff += x;
+		diff_len -= x;
+		new_pos += x;
+		old_pos += x;
+
+		/* Copy y bytes of extra, then seek z bytes in the installed chunk */
+		if (y < 0 || y > new_size - new_pos || y > extra_len)
+			return OTA_PATCH_ERR_DECODE;
+		memcpy(&ctx->out_buf[new_pos], extra, y);
+		extra += y;
+		extra_len -= y;
+		new_pos += y;
+		old_pos += z;
+	}
+	return OTA_PATCH_OK;
+}
+
+static int read_crc(struct ota_patch_ctx *ctx,
+		    int (*read)(void *, uint32_t, uint8_t *, uint32_t),
+		    uint32_t offset, uint32_t len, uint32_t *crc)
+{
+	if (len && read(ctx->ops->priv, offset, ctx->out_buf, len))
+		return OTA_PATCH_ERR_FLASH;
+	*crc = ota_crc32(0, ctx->out_buf, len);
+	return OTA_PATCH_OK;
+}
+
+/* Check if the new image already holds buf at offset */
+static int new_matches(struct ota_patch_ctx *ctx, uint32_t offset,
+		       const uint8_t *buf, uint32_t len, bool *match)
+{
+	uint8_t scratch[SCRATCH_SIZE];
+	uint32_t n;
+
+	*match = false;
+	while (len) {
+		n = MIN(len, SCRATCH_SIZE);
+		if (ctx->ops->read_new(ctx->ops->priv, offset, scratch, n))
+			return OTA_PATCH_ERR_FLASH;
+		if (memcmp(scratch, buf, n))
+			return OTA_PATCH_OK;
+		offset += n;
+		buf += n;
+		len -= n;
+	}
+	*match = true;
+	return OTA_PATCH_OK;
+}
+
+/* Copy the chunks which did not change from the installed image */
+static int keep_chunks(struct ota_patch_ctx *ctx, int32_t last_id,
+		       uint32_t image_len)
+{
+	const struct ota_patch_ops *ops = ctx->ops;
+	uint32_t offset;
+	uint32_t len;
+	bool match;
+	int rc;
+
+	for (; ctx->next_id < last_id; ctx->next_id++) {
+		offset = ctx->next_id * ctx->chunk_size;
+		if (offset >= image_len)
+			break;
+		if (ops->in_place)
+			continue;
+
+		len = MIN(ctx->chunk_size, image_len - offset);
+		if (ops->read_old(ops->priv, offset, ctx->out_buf, len))
+			return OTA_PATCH_ERR_FLASH;
+		rc = new_matches(ctx, offset, ctx->out_buf, len, &match);
+		if (rc)
+			return rc;
+		if (!match && ops->write_new(ops->priv, offset, ctx->out_buf, len))
+			return OTA_PATCH_ERR_FLASH;
+		ctx->nb_kept++;
+	}
+	return OTA_PATCH_OK;
+}
+
+static void chunk_complete(struct ota_patch_ctx *ctx)
+{
+	ctx->state = STATE_HEADER;
+	ctx->next_id = ctx->hdr.id + 1;
+	if (ctx->ops->chunk_done)
+		ctx->ops->chunk_done(ctx->ops->priv, ctx->in_offset,
+				     ctx->hdr.id);
+}
+
+static int start_chunk(struct ota_patch_ctx *ctx)
+{
+	struct ota_chunk_header *hdr = &ctx->hdr;
+	uint32_t offset = hdr->id * ctx->chunk_size;
+	uint32_t hdr_crc = hdr->crc;
+	uint32_t crc;
+	int rc;
+
+	hdr->crc = 0;
+	crc = ota_crc32(0, (const uint8_t *)hdr, sizeof(*hdr));
+	hdr->crc = hdr_crc;
+	if (hdr->magic != OTA_CHUNK_HEADER_MAGIC ||
+	    hdr->version != OTA_CHUNK_HEADER_VERSION || crc != hdr_crc ||
+	    hdr->type < OTA_CHUNK_TYPE_KEEP ||
+	    hdr->type > OTA_CHUNK_TYPE_COMPRESSED_PATCH ||
+	    hdr->id < ctx->next_id || hdr->size < 0 ||
+	    (hdr->size == 0) != (hdr->type == OTA_CHUNK_TYPE_KEEP) ||
+	    hdr->from_len > ctx->chunk_size || hdr->to_len > ctx->chunk_size)
+		return OTA_PATCH_ERR_HEADER;
+
+	rc = keep_chunks(ctx, hdr->id, UINT32_MAX);
+	if (rc)
+		return rc;
+
+	if (hdr->type == OTA_CHUNK_TYPE_KEEP) {
+		rc = keep_chunks(ctx, hdr->id + 1, offset + hdr->to_len);
+		if (rc == OTA_PATCH_OK)
+			chunk_complete(ctx);
+		return rc;
+	}
+
+	ctx->payload_left = hdr->size;
+
+	/* Already applied before a reset */
+	rc = read_crc(ctx, ctx->ops->read_new, offset, hdr->to_len, &crc);
+	if (rc)
+		return rc;
+	if (crc == hdr->to_crc) {
+		ctx->nb_skipped++;
+		ctx->state = STATE_SKIP;
+		return OTA_PATCH_OK;
+	}
+
+	if (hdr->type == OTA_CHUNK_TYPE_COMPRESSED) {
+		lzg_start(&ctx->lzg, ctx->out_buf, ctx->chunk_size);
+	} else {
+		rc = read_crc(ctx, ctx->ops->read_old, offset, hdr->from_len,
+			      &crc);
+		if (rc)
+			return rc;
+		if (crc != hdr->from_crc)
+			return OTA_PATCH_ERR_FROM_CRC;
+		lzg_start(&ctx->lzg, ctx->patch_buf, ctx->patch_buf_size);
+	}
+	ctx->state = STATE_PAYLOAD;
+	return OTA_PATCH_OK;
+}
+
+static int end_chunk(struct ota_patch_ctx *ctx)
+{
+	const struct ota_chunk_header *hdr = &ctx->hdr;
+	int rc;
+
+	rc = lzg_end(&ctx->lzg);
+	if (rc)
+		return rc;
+
+	if (hdr->type == OTA_CHUNK_TYPE_COMPRESSED_PATCH) {
+		rc = bspatch_chunk(ctx, ctx->patch_buf, ctx->lzg.dst_pos);
+		if (rc)
+			return rc;
+	} else if (ctx->lzg.dst_pos != hdr->to_len) {
+		return OTA_PATCH_ERR_TO_CRC;
+	}
+
+	if (ota_crc32(0, ctx->out_buf, hdr->to_len) != hdr->to_crc)
+		return OTA_PATCH_ERR_TO_CRC;
+
+	if (ctx->ops->write_new(ctx->ops->priv, hdr->id * ctx->chunk_size,
+				ctx->out_buf, hdr->to_len))
+		return OTA_PATCH_ERR_FLASH;
+
+	ctx->nb_applied++;
+	chunk_complete(ctx);
+	return OTA_PATCH_OK;
+}
+
+int ota_patch_init(struct ota_patch_ctx *ctx, const struct ota_patch_ops *ops,
+		   uint8_t *work, uint32_t work_size, uint32_t chunk_size)
+{
+	memset(ctx, 0, sizeof(*ctx));
+	if (work_size <= chunk_size)
+		return OTA_PATCH_ERR_NO_MEM;
+
+	ctx->ops = ops;
+	ctx->chunk_size = chunk_size;
+	ctx->out_buf = work;
+	ctx->patch_buf = work + chunk_size;
+	ctx->patch_buf_size = work_size - chunk_size;
+	ctx->state = STATE_HEADER;
+	return OTA_PATCH_OK;
+}
+
+void ota_patch_resume(struct ota_patch_ctx *ctx, uint32_t in_offset,
+		      int16_t id)
+{
+	ctx->in_offset = in_offset;
+	ctx->next_id = id + 1;
+}
+
+int ota_patch_feed(struct ota_patch_ctx *ctx, const uint8_t *data,
+		   uint32_t len)
+{
+	uint32_t n;
+	uint32_t i;
+
+	while (len && ctx->status == OTA_PATCH_OK) {
+		switch (ctx->state) {
+		case STATE_HEADER:
+			n = MIN(len, sizeof(ctx->hdr) - ctx->hdr_len);
+			memcpy((uint8_t *)&ctx->hdr + ctx->hdr_len, data, n);
+			ctx->hdr_len += n;
+			break;
+		case STATE_PAYLOAD:
+			n = MIN(len, ctx->payload_left);
+			for (i = 0; i < n && ctx->status == OTA_PATCH_OK; i++)
+				ctx->status = lzg_push(&ctx->lzg, data[i]);
+			ctx->payload_left -= n;
+			break;
+		default:
+			n = MIN(len, ctx->payload_left);
+			ctx->payload_left -= n;
+			break;
+		}
+		data += n;
+		len -= n;
+		ctx->in_offset += n;
+		if (ctx->status != OTA_PATCH_OK)
+			break;
+
+		if (ctx->state == STATE_HEADER) {
+			if (ctx->hdr_len == sizeof(ctx->hdr)) {
+				ctx->hdr_len = 0;
+				ctx->status = start_chunk(ctx);
+			}
+		} else if (ctx->payload_left == 0) {
+			if (ctx->state == STATE_PAYLOAD)
+				ctx->status = end_chunk(ctx);
+			else
+				chunk_complete(ctx);
+		}
+	}
+	return ctx->status;
+}
+
+int ota_patch_finish(struct ota_patch_ctx *ctx, uint32_t image_len)
+{
+	if (ctx->status != OTA_PATCH_OK)
+		return ctx->status;
+	if (ctx->state != STATE_HEADER || ctx->hdr_len)
+		return OTA_PATCH_ERR_TRUNCATED;
+
+	ctx->status = keep_chunks(ctx, INT16_MAX + 1, image_len);
+	return ctx->status;
+}
@@ -31,6 +31,9 @@
 #include <string.h>
 #include "util/cunit_test.h"
 #include "infra/properties_storage.h"
+#include "infra/time.h"
+
+#define NB_LOOKUPS 10000
 
 void properties_storage_test(void)
 {
@@ -251,6 +254,183 @@ void properties_storage_test(void)
 	ret = properties_storage_set(999999, data, 13, false);
 	CU_ASSERT("Write NOK", ret == PROPERTIES_STORAGE_BOUNDS_ERROR);
 
+	properties_storage_format_all();
+
+	/* Check that the index rebuilt at boot from the block summaries keeps
+	 * the latest values and ignores deleted properties */
+	for (int i = 0; i < PROPERTIES_STORAGE_MAX_NB_PROPERTIES - 1; ++i) {
+		ret = properties_storage_set(i, data, 13, false);
+		CU_ASSERT("Write OK", ret == PROPERTIES_STORAGE_SUCCESS);
+	}
+	for (int i = 0; i < 2 * 2048 / 24; ++i) {
+		ret = properties_storage_set(999999, data2, 9, false);
+		CU_ASSERT("Write OK", ret == PROPERTIES_STORAGE_SUCCESS);
+	}
+	for (int i = 0; i < PROPERTIES_STORAGE_MAX_NB_PROPERTIES - 1; i += 2) {
+		ret = properties_storage_delete(i);
+		CU_ASSERT("Delete OK", ret == PROPERTIES_STORAGE_SUCCESS);
+	}
+
+	uint32_t start = get_uptime_32k();
+	properties_storage_init();
+	uint32_t init_time = get_uptime_32k() - start;
+
+	for (int i = 0; i < PROPERTIES_STORAGE_MAX_NB_PROPERTIES - 1; ++i) {
+		ret = properties_storage_get(i, rdata, sizeof(rdata), &readlen);
+		if (i & 1) {
+			CU_ASSERT("Read OK", ret == PROPERTIES_STORAGE_SUCCESS);
+			CU_ASSERT("Read Length OK", readlen == 13);
+			CU_ASSERT("Read content correct",
+				  strncmp(data, rdata, 13) == 0);
+		} else {
+			CU_ASSERT("Get NOK",
+				  ret == PROPERTIES_STORAGE_KEY_NOT_FOUND_ERROR);
+		}
+	}
+	ret = properties_storage_get(999999, rdata, sizeof(rdata), &readlen);
+	CU_ASSERT("Read OK", ret == PROPERTIES_STORAGE_SUCCESS);
+	CU_ASSERT("Read Length OK", readlen == 9);
+	CU_ASSERT("Read content correct", strncmp(data2, rdata, 9) == 0);
+
+	/* Measure the RAM index lookup time */
+	bool persistent;
+	start = get_uptime_32k();
+	for (int i = 0; i < NB_LOOKUPS; ++i)
+		properties_storage_get_info(i % PROPERTIES_STORAGE_MAX_NB_PROPERTIES,
+					    &readlen, &persistent);
+	uint32_t lookup_time = get_uptime_32k() - start;
+
+	cu_print("%d properties: init %d us, %d lookups in %d us\n",
+		 PROPERTIES_STORAGE_MAX_NB_PROPERTIES,
+		 (int)((uint64_t)init_time * 1000000 / 32768), NB_LOOKUPS,
+		 (int)((uint64_t)lookup_time * 1000000 / 32768));
+
+	properties_storage_format_all();
+
+	/* Batch of properties, superseding a previous value */
+	ret = properties_storage_set(2, data, 13, false);
+	CU_ASSERT("Write OK", ret == PROPERTIES_STORAGE_SUCCESS);
+	properties_storage_item_t items[PROPERTIES_STORAGE_MAX_BATCH_ITEMS + 1];
+	for (int i = 0; i < PROPERTIES_STORAGE_MAX_BATCH_ITEMS + 1; ++i) {
+		items[i].key = i;
+		items[i].buf = data2;
+		items[i].len = i + 1;
+	}
+	ret = properties_storage_set_batch(items,
+					   PROPERTIES_STORAGE_MAX_BATCH_ITEMS + 1,
+					   false);
+	CU_ASSERT("Batch NOK", ret == PROPERTIES_STORAGE_INVALID_ARG);
+	for (int i = 0; i < 3 * 2048 / 80; ++i) {
+		ret = properties_storage_set_batch(items, 4, false);
+		CU_ASSERT("Batch OK", ret == PROPERTIES_STORAGE_SUCCESS);
+	}
+	properties_storage_init();
+	for (int i = 0; i < 4; ++i) {
+		ret = properties_storage_get(i, rdata, sizeof(rdata), &readlen);
+		CU_ASSERT("Read OK", ret == PROPERTIES_STORAGE_SUCCESS);
+		CU_ASSERT("Read Length OK", readlen == i + 1);
+		CU_ASSERT("Read content correct",
+			  strncmp(data2, rdata, i + 1) == 0);
+	}
+	ret = properties_storage_delete(2);
+	CU_ASSERT("Delete OK", ret == PROPERTIES_STORAGE_SUCCESS);
+	properties_storage_init();
+	ret = properties_storage_get(2, rdata, sizeof(rdata), &readlen);
+	CU_ASSERT("Get NOK", ret == PROPERTIES_STORAGE_KEY_NOT_FOUND_ERROR);
+
+#if defined(CONFIG_QUARK_SE_PROPERTIES_STORAGE) && \
+	defined(CONFIG_QUARK_DRIVER_TESTS)
+	/* A batch costs one write per item and its begin and commit records:
+	 * the entries it supersedes in the same partition are not flagged */
+	properties_storage_format_all();
+	ret = properties_storage_set(2, data, 13, false);
+	CU_ASSERT("Write OK", ret == PROPERTIES_STORAGE_SUCCESS);
+	ret = properties_storage_set(3, data, 13, false);
+	CU_ASSERT("Write OK", ret == PROPERTIES_STORAGE_SUCCESS);
+	uint32_t nb_writes = properties_storage_test_nb_writes();
+	ret = properties_storage_set_batch(items, 4, false);
+	CU_ASSERT("Batch OK", ret == PROPERTIES_STORAGE_SUCCESS);
+	nb_writes = properties_storage_test_nb_writes() - nb_writes;
+	CU_ASSERT("Batch flash writes", nb_writes == 4 + 2);
+	cu_print("batch of 4 properties: %d flash writes\n", nb_writes);
+
+	/* The entry superseded in the other partition is flagged */
+	ret = properties_storage_set(5, data, 13, true);
+	CU_ASSERT("Write OK", ret == PROPERTIES_STORAGE_SUCCESS);
+	nb_writes = properties_storage_test_nb_writes();
+	ret = properties_storage_set_batch(&items[5], 1, false);
+	CU_ASSERT("Batch OK", ret == PROPERTIES_STORAGE_SUCCESS);
+	nb_writes = properties_storage_test_nb_writes() - nb_writes;
+	CU_ASSERT("Batch flash writes", nb_writes == 1 + 2 + 1);
+	properties_storage_init();
+	ret = properties_storage_get_info(5, &readlen, &persistent);
+	CU_ASSERT("Get info OK", ret == PROPERTIES_STORAGE_SUCCESS);
+	CU_ASSERT("Moved to the non persistent partition",
+		  readlen == 6 && !persistent);
+
+	/* Moving or deleting a property flags the entries superseded by its
+	 * batches, so that none of them is read again at boot */
+	for (int i = 0; i < 2; ++i) {
+		ret = properties_storage_set_batch(&items[6], 2, false);
+		CU_ASSERT("Batch OK", ret == PROPERTIES_STORAGE_SUCCESS);
+	}
+	ret = properties_storage_set(6, data, 13, true);
+	CU_ASSERT("Write OK", ret == PROPERTIES_STORAGE_SUCCESS);
+	ret = properties_storage_delete(7);
+	CU_ASSERT("Delete OK", ret == PROPERTIES_STORAGE_SUCCESS);
+	ret = properties_storage_set(7, data, 13, true);
+	CU_ASSERT("Write OK", ret == PROPERTIES_STORAGE_SUCCESS);
+	properties_storage_init();
+	for (int i = 6; i < 8; ++i) {
+		ret = properties_storage_get(i, rdata, sizeof(rdata), &readlen);
+		CU_ASSERT("Read OK", ret == PROPERTIES_STORAGE_SUCCESS);
+		CU_ASSERT("Read Length OK", readlen == 13);
+		CU_ASSERT("Read content correct",
+			  strncmp(data, rdata, 13) == 0);
+	}
+
+	properties_storage_item_t new_items[4];
+	for (int i = 0; i < 4; ++i) {
+		new_items[i].key = i;
+		new_items[i].buf = data;
+		new_items[i].len = i + 1;
+	}
+
+	/* Power cut before the commit record: the previous values are kept */
+	properties_storage_test_cut_power(1 + 4);
+	properties_storage_set_batch(new_items, 4, false);
+	properties_storage_init();
+	for (int i = 0; i < 4; ++i) {
+		ret = properties_storage_get(i, rdata, sizeof(rdata), &readlen);
+		CU_ASSERT("Read OK", ret == PROPERTIES_STORAGE_SUCCESS);
+		CU_ASSERT("Read Length OK", readlen == i + 1);
+		CU_ASSERT("Read previous content",
+			  strncmp(data2, rdata, i + 1) == 0);
+	}
+
+	/* Power cut right after the commit record: the batch values are read
+	 * over the previous entries, which are not flagged */
+	properties_storage_test_cut_power(1 + 4 + 1);
+	properties_storage_set_batch(new_items, 4, false);
+	properties_storage_init();
+	for (int i = 0; i < 4; ++i) {
+		ret = properties_storage_get(i, rdata, sizeof(rdata), &readlen);
+		CU_ASSERT("Read OK", ret == PROPERTIES_STORAGE_SUCCESS);
+		CU_ASSERT("Read Length OK", readlen == i + 1);
+		CU_ASSERT("Read batch content",
+			  strncmp(data, rdata, i + 1) == 0);
+	}
+
+	/* The entries superseded by the batch are superseded again afterwards */
+	ret = properties_storage_set(2, data2, 9, false);
+	CU_ASSERT("Write OK", ret == PROPERTIES_STORAGE_SUCCESS);
+	properties_storage_init();
+	ret = properties_storage_get(2, rdata, sizeof(rdata), &readlen);
+	CU_ASSERT("Read OK", ret == PROPERTIES_STORAGE_SUCCESS);
+	CU_ASSERT("Read Length OK", readlen == 9);
+	CU_ASSERT("Read content correct", strncmp(data2, rdata, 9) == 0);
+#endif
+
 	/* Format the partition: later unit tests rely on it being not full.. */
 	properties_storage_format_all();
 }
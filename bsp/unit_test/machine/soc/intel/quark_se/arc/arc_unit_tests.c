@@ -83,6 +83,7 @@ void run_arc_driver_tests(void)
 #endif
 
 	CU_RUN_TEST(wakelock_test);
+	CU_RUN_TEST(device_pm_test);
 
 #if defined (CONFIG_BMI160)
 	CU_RUN_TEST(bmi160_unit_test);
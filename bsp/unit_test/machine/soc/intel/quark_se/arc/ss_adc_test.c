@@ -67,6 +67,24 @@ static void adc_read_test(void)
 		adc_read(i);
 }
 
+static void adc_read_multi_test(void)
+{
+	uint8_t channels[ADC_SCAN_MAX_CHANNELS] = { 0, 1, TEST_CHANNEL, 18 };
+	uint16_t data[ADC_SCAN_MAX_CHANNELS];
+	DRIVER_API_RC ret;
+	int i;
+
+	cu_print("Starting ADC read multi Test\n");
+	ret = ss_adc_read_multi(channels, ADC_SCAN_MAX_CHANNELS, data);
+	CU_ASSERT("ADC read multi ERROR\n", (ret == DRV_RC_OK));
+	for (i = 0; i < ADC_SCAN_MAX_CHANNELS; i++)
+		cu_print("Channel[%d] = %d\n", channels[i], data[i]);
+
+	ret = ss_adc_read_multi(channels, ADC_SCAN_MAX_CHANNELS + 1, data);
+	CU_ASSERT("Too many channels accepted\n",
+		  (ret == DRV_RC_INVALID_CONFIG));
+}
+
 void adc_test(void)
 {
 	cu_print("#################################\n");
@@ -74,6 +92,7 @@ void adc_test(void)
 	cu_print("#################################\n");
 
 	adc_read_test();
+	adc_read_multi_test();
 
 	cu_print("#################################\n");
 	cu_print("End of ADC test\n");
@@ -4,6 +4,12 @@ obj-$(CONFIG_INTEL_QRK_SPI) += sba_spi_tst.o
 endif
 obj-$(CONFIG_LOG_CBUFFER) += cbuffer_test.o
 obj-y += wakelock_tst.o
+obj-$(CONFIG_CUNIT_BENCH) += bench_wakelock.o
+obj-y += device_pm_tst.o
 obj-y += list_tst.o
+obj-$(CONFIG_LP5562_LED) += lp5562_pattern_tst.o
+obj-$(CONFIG_DRV2605) += drv2605_seq_tst.o
+obj-$(CONFIG_OTA_PATCH) += ota_patch_tst.o
+obj-$(CONFIG_EVENT_JOURNAL) += event_journal_tst.o
 obj-$(CONFIG_SOC_COMPARATOR) += comparator_tst.o
 obj-y += timer_tst.o
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * \file bench_wakelock.c
+ *
+ * Wakelock micro benchmarks: release and acquire of one wakelock among
+ * several held ones, which must not depend on the number held.
+ */
+
+#include <stdint.h>
+
+#include "infra/pm.h"
+#include "util/cunit_bench.h"
+
+#define BENCH_WL_NB     64
+
+static struct pm_wakelock bench_wl[BENCH_WL_NB];
+
+/* Release and acquire again each of the priv held wakelocks in turn */
+static void bench_wakelock_body(uint32_t n, void *priv)
+{
+	uint32_t held = (uintptr_t)priv;
+	uint32_t i = 0;
+
+	while (n--) {
+		pm_wakelock_release(&bench_wl[i]);
+		pm_wakelock_acquire(&bench_wl[i]);
+		if (++i == held)
+			i = 0;
+	}
+}
+
+static void bench_wakelock_held(const char *name, uint32_t held)
+{
+	uint32_t i;
+
+	for (i = 0; i < held; i++) {
+		pm_wakelock_init(&bench_wl[i]);
+		pm_wakelock_acquire(&bench_wl[i]);
+	}
+	CU_BENCH(name, bench_wakelock_body, (void *)(uintptr_t)held);
+	for (i = 0; i < held; i++) {
+		pm_wakelock_release(&bench_wl[i]);
+#ifdef CONFIG_PM_WAKELOCK_STATS
+		pm_wakelock_stats_remove(&bench_wl[i]);
+#endif
+	}
+}
+
+void bench_wakelock(void)
+{
+	bench_wakelock_held("wakelock_rel_acq_1", 1);
+	bench_wakelock_held("wakelock_rel_acq_4", 4);
+	bench_wakelock_held("wakelock_rel_acq_16", 16);
+	bench_wakelock_held("wakelock_rel_acq_64", BENCH_WL_NB);
+}
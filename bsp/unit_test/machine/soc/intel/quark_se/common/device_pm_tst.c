@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "util/cunit_test.h"
+#include "util/misc.h"
+#include "infra/device.h"
+#include <errno.h>
+
+/* Mock devices: a bus (lazy), two children and a top level device */
+enum { MOCK_BUS, MOCK_CHILD0, MOCK_CHILD1, MOCK_DEV, MOCK_NB };
+
+/* Device ids of the mock devices, out of the range of the real devices so
+ * that the device pm statistics are left untouched */
+#define MOCK_ID_BASE 0x70
+#define MOCK_INDEX(dev) ((dev)->id - MOCK_ID_BASE)
+
+static uint8_t mock_trace[16];
+static int mock_trace_len;
+static int mock_fail_id = -1;
+
+static int mock_suspend(struct td_device *dev, PM_POWERSTATE state)
+{
+	if (MOCK_INDEX(dev) == mock_fail_id)
+		return -1;
+	mock_trace[mock_trace_len++] = MOCK_INDEX(dev);
+	return 0;
+}
+
+static int mock_nested_ret;
+
+static int mock_resume(struct td_device *dev)
+{
+	mock_trace[mock_trace_len++] = 0x80 | MOCK_INDEX(dev);
+	/* Another context asking for the device during its resume */
+	if (dev->pm_flags & DEVICE_PM_RESUMING)
+		mock_nested_ret = device_resume_on_demand(dev);
+	return 0;
+}
+
+static struct driver mock_driver = {
+	.suspend = mock_suspend,
+	.resume = mock_resume
+};
+
+static struct td_device mock_dev[MOCK_NB];
+static struct td_device *mock_devices[MOCK_NB];
+
+static void mock_reset(void)
+{
+	int i;
+
+	for (i = 0; i < MOCK_NB; i++) {
+		mock_dev[i].id = MOCK_ID_BASE + i;
+		mock_dev[i].driver = &mock_driver;
+		mock_dev[i].powerstate = PM_RUNNING;
+		mock_dev[i].pm_flags = 0;
+		mock_devices[i] = &mock_dev[i];
+	}
+	mock_dev[MOCK_BUS].pm_flags = DEVICE_PM_LAZY_RESUME;
+	mock_trace_len = 0;
+	mock_fail_id = -1;
+	mock_nested_ret = 0;
+}
+
+static bool mock_trace_is(const uint8_t *expected, int len)
+{
+	int i;
+
+	if (mock_trace_len != len)
+		return false;
+	for (i = 0; i < len; i++)
+		if (mock_trace[i] != expected[i])
+			return false;
+	return true;
+}
+
+void device_pm_test(void)
+{
+	int ret;
+
+#ifdef CONFIG_DEVICE_PM_STATS
+	BUILD_BUG_ON(CONFIG_DEVICE_PM_STATS_NB > MOCK_ID_BASE);
+#endif
+
+	cu_print("##################################################\n");
+	cu_print("# Purpose of device pm tests (No HW cfg needed): #\n");
+	cu_print("# - Suspend children before their bus            #\n");
+	cu_print("# - Leave lazy devices suspended on resume       #\n");
+	cu_print("# - Resume lazy devices on demand                #\n");
+	cu_print("# - Roll back an aborted suspend                 #\n");
+	cu_print("##################################################\n");
+
+	/* Reverse order suspend, in order resume, lazy bus left suspended */
+	mock_reset();
+	ret = suspend_device_array(mock_devices, MOCK_NB, PM_SUSPENDED);
+	CU_ASSERT("suspend failed", !ret);
+	resume_device_array(mock_devices, MOCK_NB);
+	{
+		const uint8_t expected[] = {
+			MOCK_DEV, MOCK_CHILD1, MOCK_CHILD0, MOCK_BUS,
+			0x80 | MOCK_CHILD0, 0x80 | MOCK_CHILD1,
+			0x80 | MOCK_DEV
+		};
+		CU_ASSERT("wrong suspend/resume order",
+			  mock_trace_is(expected, sizeof(expected)));
+	}
+	CU_ASSERT("lazy bus resumed",
+		  mock_dev[MOCK_BUS].powerstate == PM_SUSPENDED);
+
+	/* On demand resume, only once */
+	mock_trace_len = 0;
+	ret = device_resume_on_demand(&mock_dev[MOCK_BUS]);
+	CU_ASSERT("on demand resume failed", !ret);
+	ret = device_resume_on_demand(&mock_dev[MOCK_BUS]);
+	CU_ASSERT("on demand resume failed", !ret);
+	CU_ASSERT("lazy bus not resumed on demand",
+		  mock_dev[MOCK_BUS].powerstate == PM_RUNNING &&
+		  mock_trace_len == 1);
+	CU_ASSERT("nested on demand resume not busy",
+		  mock_nested_ret == -EBUSY &&
+		  !(mock_dev[MOCK_BUS].pm_flags & DEVICE_PM_RESUMING));
+
+	/* Only lazy devices are resumed on demand */
+	mock_trace_len = 0;
+	mock_dev[MOCK_CHILD0].powerstate = PM_SUSPENDED;
+	device_resume_on_demand(&mock_dev[MOCK_CHILD0]);
+	mock_dev[MOCK_BUS].powerstate = PM_SHUTDOWN;
+	device_resume_on_demand(&mock_dev[MOCK_BUS]);
+	CU_ASSERT("device resumed on demand",
+		  mock_trace_len == 0 &&
+		  mock_dev[MOCK_CHILD0].powerstate == PM_SUSPENDED &&
+		  mock_dev[MOCK_BUS].powerstate == PM_SHUTDOWN);
+
+	/* Unused lazy bus: no callback on the next cycle */
+	mock_reset();
+	mock_dev[MOCK_BUS].powerstate = PM_SUSPENDED;
+	ret = suspend_device_array(mock_devices, MOCK_NB, PM_SUSPENDED);
+	CU_ASSERT("suspend failed", !ret);
+	CU_ASSERT("suspended bus suspended again",
+		  mock_trace_len == 3 && mock_trace[2] == MOCK_CHILD0);
+
+	/* Abort on child 0: child 1 and the top level device are resumed */
+	mock_reset();
+	mock_fail_id = MOCK_CHILD0;
+	ret = suspend_device_array(mock_devices, MOCK_NB, PM_SUSPENDED);
+	CU_ASSERT("suspend should have failed", ret == -1);
+	{
+		const uint8_t expected[] = {
+			MOCK_DEV, MOCK_CHILD1,
+			0x80 | MOCK_CHILD1, 0x80 | MOCK_DEV
+		};
+		CU_ASSERT("wrong rollback",
+			  mock_trace_is(expected, sizeof(expected)));
+	}
+	CU_ASSERT("bus suspended by an aborted suspend",
+		  mock_dev[MOCK_BUS].powerstate == PM_RUNNING &&
+		  mock_dev[MOCK_CHILD0].powerstate == PM_RUNNING &&
+		  mock_dev[MOCK_CHILD1].powerstate == PM_RUNNING);
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+
+#include "util/cunit_test.h"
+#include "drivers/drv2605_seq.h"
+
+/* Emulated DRV2605 register file, written with auto-increment bursts */
+#define DST_WAVEQ1_REG 0x04
+#define DST_GO_REG     0x0C
+
+static uint8_t dst_regs[0x20];
+static int dst_transactions;
+
+static void dst_burst(uint8_t reg, const uint8_t *val, uint8_t len)
+{
+	memcpy(&dst_regs[reg], val, len);
+	dst_transactions++;
+}
+
+/* Upload a sequence and start it, as the driver does */
+static void dst_play(const struct drv2605_seq *seq)
+{
+	uint8_t regs[DRV2605_SEQ_SLOTS + 1];
+
+	memcpy(regs, seq->slot, DRV2605_SEQ_SLOTS);
+	regs[DRV2605_SEQ_SLOTS] = 1;
+	dst_burst(DST_WAVEQ1_REG, regs, sizeof(regs));
+}
+
+/* Play all the sequences of a pattern, return the total duration */
+static uint32_t dst_play_pattern(const vibration_special_effect_t *p)
+{
+	struct drv2605_seq seq;
+	uint8_t step = 0;
+	uint32_t duration = 0;
+
+	dst_transactions = 0;
+	memset(dst_regs, 0, sizeof(dst_regs));
+	while (!drv2605_seq_special(&seq, p, &step) && seq.nb) {
+		dst_play(&seq);
+		duration += seq.duration;
+	}
+	return duration;
+}
+
+void drv2605_seq_test(void)
+{
+	struct drv2605_seq seq;
+	uint8_t step;
+	vibration_special_effect_t p = {
+		.effect_1 = 1, .duration_off_1 = 100,
+		.effect_2 = 2, .duration_off_2 = 200,
+		.effect_3 = 3
+	};
+	const uint8_t three[] = { 1, DRV2605_SEQ_WAIT | 10, 2,
+				  DRV2605_SEQ_WAIT | 20, 3, 0, 0, 0 };
+
+	/* Three effects: one transaction, waits in the sequencer */
+	CU_ASSERT("bad pattern duration", dst_play_pattern(&p) == 450);
+	CU_ASSERT("bad number of transactions", dst_transactions == 1);
+	CU_ASSERT("bad sequence",
+		  !memcmp(&dst_regs[DST_WAVEQ1_REG], three, sizeof(three)));
+	CU_ASSERT("sequence not started", dst_regs[DST_GO_REG] == 1);
+
+	/* Five effects: nine slots, the last off time is a CPU wait */
+	p.duration_off_3 = 300;
+	p.effect_4 = 4;
+	p.duration_off_4 = 400;
+	p.effect_5 = 15;
+	step = 0;
+	CU_ASSERT("compile failed", !drv2605_seq_special(&seq, &p, &step));
+	CU_ASSERT("bad first sequence",
+		  seq.nb == 7 && seq.slot[6] == 4 && seq.duration == 1200);
+	CU_ASSERT("compile failed", !drv2605_seq_special(&seq, &p, &step));
+	CU_ASSERT("bad second sequence",
+		  seq.nb == 1 && seq.slot[0] == 15 && seq.slot[1] == 0 &&
+		  seq.duration == 750);
+	CU_ASSERT("compile failed", !drv2605_seq_special(&seq, &p, &step));
+	CU_ASSERT("pattern should be over", seq.nb == 0);
+	CU_ASSERT("bad pattern duration", dst_play_pattern(&p) == 1950);
+	CU_ASSERT("bad number of transactions", dst_transactions == 2);
+
+	/* Off times longer than one wait slot */
+	memset(&p, 0, sizeof(p));
+	p.effect_1 = 1;
+	p.duration_off_1 = 3000;
+	p.effect_2 = 2;
+	step = 0;
+	CU_ASSERT("compile failed", !drv2605_seq_special(&seq, &p, &step));
+	CU_ASSERT("bad long wait",
+		  seq.nb == 5 && seq.slot[1] == (DRV2605_SEQ_WAIT | 127) &&
+		  seq.slot[2] == (DRV2605_SEQ_WAIT | 127) &&
+		  seq.slot[3] == (DRV2605_SEQ_WAIT | 46) && seq.slot[4] == 2);
+
+	/* A null off time ends the pattern after the effect */
+	p.duration_off_1 = 0;
+	CU_ASSERT("bad pattern duration", dst_play_pattern(&p) == 50);
+	CU_ASSERT("bad sequence", dst_regs[DST_WAVEQ1_REG + 1] == 0);
+
+	/* Effects out of the library are rejected before playing */
+	p.duration_off_1 = 100;
+	p.effect_2 = 124;
+	step = 0;
+	CU_ASSERT("invalid effect accepted",
+		  drv2605_seq_special(&seq, &p, &step) == -1);
+}
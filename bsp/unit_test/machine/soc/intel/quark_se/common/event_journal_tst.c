@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+
+#include "util/cunit_test.h"
+#include "util/event_journal.h"
+
+#define TST_SECTOR_SIZE 1024
+#define TST_NB_SECTORS  3
+#define TST_ELT_SIZE    32
+
+/* RAM model of a NOR flash: programming only clears bits */
+static uint8_t tst_flash[TST_NB_SECTORS * TST_SECTOR_SIZE];
+static uint32_t tst_write_limit;
+static bool tst_bad_write;
+
+static int tst_read(void *priv, uint32_t offset, uint8_t *buf, uint32_t len)
+{
+	if (offset + len > sizeof(tst_flash))
+		return -1;
+	memcpy(buf, &tst_flash[offset], len);
+	return 0;
+}
+
+static int tst_write(void *priv, uint32_t offset, const uint8_t *buf,
+		     uint32_t len)
+{
+	uint32_t i;
+
+	if (offset + len > sizeof(tst_flash) ||
+	    offset / EVENT_JOURNAL_PAGE_SIZE !=
+	    (offset + len - 1) / EVENT_JOURNAL_PAGE_SIZE) {
+		tst_bad_write = true;
+		return -1;
+	}
+	for (i = 0; i < len; i++) {
+		if (buf[i] & ~tst_flash[offset + i])
+			tst_bad_write = true;
+		/* Power loss simulation: only program the first bytes */
+		if (tst_write_limit && !--tst_write_limit)
+			return -1;
+		tst_flash[offset + i] &= buf[i];
+	}
+	return 0;
+}
+
+static int tst_erase(void *priv, uint32_t sector)
+{
+	if (sector >= TST_NB_SECTORS)
+		return -1;
+	memset(&tst_flash[sector * TST_SECTOR_SIZE], 0xff, TST_SECTOR_SIZE);
+	return 0;
+}
+
+static const struct event_journal_ops tst_ops = {
+	.read = tst_read,
+	.write = tst_write,
+	.erase = tst_erase,
+};
+
+static struct event_journal journal;
+static struct event_journal_iter iter;
+
+static void tst_record(uint8_t *elt, uint32_t n)
+{
+	memset(elt, n, TST_ELT_SIZE);
+	memcpy(elt, &n, sizeof(n));
+}
+
+static void tst_append(uint32_t first, uint32_t count)
+{
+	uint8_t elt[TST_ELT_SIZE];
+
+	while (count--) {
+		tst_record(elt, first++);
+		event_journal_append(&journal, elt);
+	}
+}
+
+/*
+ * Read all unconsumed records, check that they are in order, that each one
+ * matches its sequence number and that the last one is last.
+ * Return the number of records read.
+ */
+static uint32_t tst_read_all(uint32_t *first)
+{
+	uint8_t elt[TST_ELT_SIZE];
+	const uint8_t *p;
+	uint32_t seq, prev = 0, n = 0;
+
+	event_journal_iter_init(&journal, &iter);
+	while ((p = event_journal_iter_next(&iter, &seq))) {
+		tst_record(elt, seq);
+		CU_ASSERT("corrupted record", !memcmp(p, elt, TST_ELT_SIZE));
+		CU_ASSERT("records out of order", !n || seq > prev);
+		if (!n && first)
+			*first = seq;
+		prev = seq;
+		n++;
+	}
+	CU_ASSERT("last record missing", !n || prev + 1 == journal.next_seq);
+	return n;
+}
+
+void event_journal_tst(void)
+{
+	uint8_t saved[EVENT_JOURNAL_PAGE_SIZE];
+	const uint8_t *buf;
+	uint32_t first, n, offset;
+	uint16_t len;
+
+	cu_print("##############################################################\n");
+	cu_print("# Purpose of the event journal test :                        #\n");
+	cu_print("#             Append, read back, remount, wrap and power loss#\n");
+	cu_print("##############################################################\n");
+
+	memset(tst_flash, 0xff, sizeof(tst_flash));
+	tst_bad_write = false;
+	tst_write_limit = 0;
+
+	CU_ASSERT("bad geometry accepted",
+		  event_journal_init(&journal, &tst_ops, 1000, TST_NB_SECTORS,
+				     TST_ELT_SIZE) < 0);
+	CU_ASSERT("init failed",
+		  !event_journal_init(&journal, &tst_ops, TST_SECTOR_SIZE,
+				      TST_NB_SECTORS, TST_ELT_SIZE));
+
+	/* A burst costs one program per page */
+	tst_append(0, 20);
+	CU_ASSERT("no pending records", event_journal_pending(&journal));
+	CU_ASSERT("flush failed", !event_journal_flush(&journal));
+	CU_ASSERT("too many programs", journal.stats.programs <= 3);
+	CU_ASSERT("wrong record count", tst_read_all(&first) == 20 &&
+		  first == 0 && iter.lost == 0);
+
+	/* Consumed records are not read again, even after a remount */
+	event_journal_consume(&journal, 12);
+	CU_ASSERT("wrong unread count", event_journal_unread(&journal) == 8);
+	tst_append(20, 3);
+	event_journal_flush(&journal);
+	CU_ASSERT("init failed",
+		  !event_journal_init(&journal, &tst_ops, TST_SECTOR_SIZE,
+				      TST_NB_SECTORS, TST_ELT_SIZE));
+	CU_ASSERT("wrong sequence after remount", journal.next_seq == 23 &&
+		  journal.read_seq == 12);
+	n = tst_read_all(&first);
+	CU_ASSERT("consumed records read", n == 11 && first == 12);
+
+	/* Appending after a remount continues the same page */
+	tst_append(23, 1);
+	event_journal_flush(&journal);
+	CU_ASSERT("single record flush", journal.stats.programs == 1);
+	CU_ASSERT("record lost after remount", tst_read_all(NULL) == 12);
+
+	/* Overwritten records are reported lost */
+	tst_append(24, 200);
+	event_journal_flush(&journal);
+	n = tst_read_all(&first);
+	CU_ASSERT("wrap not handled", n > 40 && n + iter.lost == 224 - 12);
+	event_journal_consume(&journal, iter.next_seq);
+	CU_ASSERT("all consumed", event_journal_unread(&journal) == 0);
+	event_journal_flush(&journal);
+	CU_ASSERT("init failed",
+		  !event_journal_init(&journal, &tst_ops, TST_SECTOR_SIZE,
+				      TST_NB_SECTORS, TST_ELT_SIZE));
+	CU_ASSERT("consumed records read", tst_read_all(NULL) == 0);
+
+	/* Power loss in the middle of a frame */
+	tst_append(224, 2);
+	event_journal_flush(&journal);
+	tst_append(226, 3);
+	tst_write_limit = 50;
+	event_journal_flush(&journal);
+	tst_write_limit = 0;
+	CU_ASSERT("init failed",
+		  !event_journal_init(&journal, &tst_ops, TST_SECTOR_SIZE,
+				      TST_NB_SECTORS, TST_ELT_SIZE));
+	CU_ASSERT("torn frame not dropped", journal.next_seq == 226);
+	tst_append(226, 4);
+	event_journal_flush(&journal);
+	n = tst_read_all(&first);
+	CU_ASSERT("records lost after power loss", n == 6 && first == 224);
+
+	/* Records staged when a panic occurs are programmed after the reset */
+	tst_append(230, 1);
+	len = event_journal_staged(&journal, &offset, &buf);
+	CU_ASSERT("nothing staged", len > 0 && len <= sizeof(saved));
+	memcpy(saved, buf, len);
+	CU_ASSERT("init failed",
+		  !event_journal_init(&journal, &tst_ops, TST_SECTOR_SIZE,
+				      TST_NB_SECTORS, TST_ELT_SIZE));
+	CU_ASSERT("staged records in flash", journal.next_seq == 230);
+	CU_ASSERT("restore failed",
+		  !event_journal_restore(&journal, offset, saved, len));
+	CU_ASSERT("records not restored", journal.next_seq == 231);
+	CU_ASSERT("restored twice",
+		  event_journal_restore(&journal, offset, saved, len) < 0);
+	n = tst_read_all(&first);
+	CU_ASSERT("records lost after panic", n == 7 && first == 224);
+
+	CU_ASSERT("flash misuse", !tst_bad_write);
+}
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "util/cunit_test.h"
+#include "drivers/led/lp5562_pattern.h"
+
+/* Unconditional branch to the first instruction */
+#define LOOP_TO_START 0xA000
+
+static led_s lpt_pattern;
+
+static void lpt_set(uint16_t on0, uint16_t off0, uint16_t on1, uint16_t off1,
+		    uint16_t on2, uint16_t off2)
+{
+	uint16_t t[6] = { on0, off0, on1, off1, on2, off2 };
+	int i;
+
+	for (i = 0; i < 3; i++) {
+		lpt_pattern.duration[i].duration_on = t[2 * i];
+		lpt_pattern.duration[i].duration_off = t[2 * i + 1];
+		lpt_pattern.rgb[i].r = 255;
+		lpt_pattern.rgb[i].g = 50 * i;
+		lpt_pattern.rgb[i].b = 10;
+	}
+}
+
+static bool lpt_has_loop(const struct lp5562_program *prog)
+{
+	int i, j;
+
+	for (i = 0; i < LP5562_NB_ENGINES; i++)
+		for (j = 0; j < LP5562_NB_INSTRUCTIONS; j++)
+			if (prog->eng[i][j] == LOOP_TO_START)
+				return true;
+	return false;
+}
+
+/* Run time of the engines, in ms, must be close to the expected duration */
+static bool lpt_run_time_is(const struct lp5562_program *prog,
+			    uint16_t expected)
+{
+	uint32_t ms = lp5562_program_run_time(prog) * 1000 / LP5562_CLOCK;
+
+	return ms + expected / 20 + 2 >= expected &&
+	       ms <= expected + expected / 20 + 2;
+}
+
+void lp5562_pattern_test(void)
+{
+	struct lp5562_program prog;
+	uint8_t n;
+
+	/* Played once: the engines end after the last on time */
+	lpt_set(100, 100, 200, 300, 50, 70);
+	for (n = 1; n <= 3; n++) {
+		CU_ASSERT("blink compile failed",
+			  !lp5562_compile_blink(&prog, &lpt_pattern, n, false));
+		CU_ASSERT("blink should not loop",
+			  !prog.looping && !lpt_has_loop(&prog));
+		CU_ASSERT("bad blink run time",
+			  lpt_run_time_is(&prog, prog.last_duration));
+	}
+	CU_ASSERT("bad blink duration", prog.duration == 820);
+	CU_ASSERT("bad blink last duration", prog.last_duration == 750);
+
+	/* Long durations use the slow clock and wait loops */
+	lpt_set(1000, 2000, 1000, 2000, 3000, 0);
+	CU_ASSERT("blink compile failed",
+		  !lp5562_compile_blink(&prog, &lpt_pattern, 3, false));
+	CU_ASSERT("bad long blink run time",
+		  lpt_run_time_is(&prog, prog.last_duration));
+
+	/* Short durations use the fast clock */
+	lpt_set(5, 5, 5, 5, 5, 5);
+	CU_ASSERT("blink compile failed",
+		  !lp5562_compile_blink(&prog, &lpt_pattern, 2, false));
+	CU_ASSERT("bad short blink run time",
+		  lpt_run_time_is(&prog, prog.last_duration));
+
+	/* Continuous: one and two colors loop in the engines, three don't */
+	lpt_set(100, 100, 200, 300, 50, 70);
+	for (n = 1; n <= 3; n++) {
+		CU_ASSERT("blink compile failed",
+			  !lp5562_compile_blink(&prog, &lpt_pattern, n, true));
+		CU_ASSERT("bad continuous blink",
+			  prog.looping == (n < 3) &&
+			  lpt_has_loop(&prog) == (n < 3));
+		CU_ASSERT("looping blink should never end",
+			  (lp5562_program_run_time(&prog) == 0) == (n < 3));
+	}
+
+	/* No on time */
+	lpt_set(0, 100, 0, 0, 0, 0);
+	CU_ASSERT("blink without on time accepted",
+		  lp5562_compile_blink(&prog, &lpt_pattern, 1, false) == -1);
+
+#ifdef CONFIG_LED_WAVE_SUPPORT
+	/* Waves include the off time of each color */
+	lpt_set(500, 500, 1000, 2000, 0, 0);
+	for (n = 1; n <= 2; n++) {
+		CU_ASSERT("wave compile failed",
+			  !lp5562_compile_wave(&prog, &lpt_pattern, n, false));
+		CU_ASSERT("bad wave run time",
+			  !prog.looping &&
+			  lpt_run_time_is(&prog, prog.duration));
+		CU_ASSERT("wave compile failed",
+			  !lp5562_compile_wave(&prog, &lpt_pattern, n, true));
+		CU_ASSERT("looping wave should never end",
+			  prog.looping && lpt_has_loop(&prog) &&
+			  !lp5562_program_run_time(&prog));
+	}
+#endif
+}
@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+
+#include "util/cunit_test.h"
+#include "util/misc.h"
+#include "util/ota_patch.h"
+#include "infra/time.h"
+
+#define TST_CHUNK_SIZE  256
+#define TST_OLD_LEN     (3 * TST_CHUNK_SIZE)
+#define TST_NEW_LEN     (2 * TST_CHUNK_SIZE + 200)
+#define TST_FEED_SIZE   7
+
+/*
+ * Package generated with bsdiff_chunk.py semantics for a 256 bytes chunk
+ * size: chunk 0 is unchanged (omitted), chunk 1 is a patch, chunk 2 is
+ * compressed and shorter than in the installed image.
+ */
+static const uint8_t tst_package[] = {
+	0x43, 0x21, 0x4b, 0x24, 0x01, 0x03, 0x01, 0x00, 0x38, 0x00, 0x00, 0x00,
+	0x2a, 0x48, 0x34, 0xb7, 0x00, 0x01, 0x00, 0x00, 0xd8, 0x77, 0xc9, 0xa6,
+	0x00, 0x01, 0x00, 0x00, 0xcf, 0x8e, 0x06, 0x84, 0x4c, 0x5a, 0x47, 0x00,
+	0x00, 0x01, 0x38, 0x00, 0x00, 0x00, 0x28, 0xaa, 0x95, 0x09, 0x3c, 0x01,
+	0x02, 0x03, 0x04, 0x05, 0x4d, 0x42, 0x53, 0x44, 0x49, 0x46, 0x34, 0x33,
+	0x18, 0x00, 0x05, 0x05, 0x01, 0x05, 0xf5, 0x05, 0x17, 0x28, 0x1b, 0x0e,
+	0x01, 0xf4, 0xe7, 0xda, 0xcd, 0xc0, 0xb3, 0x03, 0x1b, 0x22, 0x05, 0x1f,
+	0x05, 0x1e, 0x05, 0x05, 0x43, 0x21, 0x4b, 0x24, 0x01, 0x02, 0x02, 0x00,
+	0x2d, 0x00, 0x00, 0x00, 0xc7, 0x6d, 0xda, 0x08, 0x00, 0x01, 0x00, 0x00,
+	0xd8, 0x77, 0xc9, 0xa6, 0xc8, 0x00, 0x00, 0x00, 0x37, 0xf7, 0x02, 0xff,
+	0x4c, 0x5a, 0x47, 0x00, 0x00, 0x00, 0xc8, 0x00, 0x00, 0x00, 0x1d, 0x63,
+	0x44, 0x05, 0xdc, 0x01, 0x00, 0x01, 0x02, 0x03, 0x5a, 0x5b, 0x58, 0x59,
+	0x5e, 0x5f, 0x5c, 0x5d, 0x52, 0x53, 0x50, 0x51, 0x56, 0x57, 0x54, 0x55,
+	0x01, 0x1f, 0x08, 0x01, 0x1d, 0x08, 0x01, 0x06, 0x08,
+};
+
+static uint8_t old_image[TST_OLD_LEN];
+static uint8_t new_image[TST_OLD_LEN];
+static uint8_t expected[TST_NEW_LEN];
+static uint8_t work[2 * TST_CHUNK_SIZE + 128];
+static int nb_writes;
+static uint32_t done_offset;
+static int16_t done_id;
+
+static int tst_read_old(void *priv, uint32_t offset, uint8_t *buf, uint32_t len)
+{
+	if (offset + len > sizeof(old_image))
+		return -1;
+	memcpy(buf, &old_image[offset], len);
+	return 0;
+}
+
+static int tst_read_new(void *priv, uint32_t offset, uint8_t *buf, uint32_t len)
+{
+	if (offset + len > sizeof(new_image))
+		return -1;
+	memcpy(buf, &new_image[offset], len);
+	return 0;
+}
+
+static int tst_write_new(void *priv, uint32_t offset, const uint8_t *buf,
+			 uint32_t len)
+{
+	if (offset + len > sizeof(new_image))
+		return -1;
+	memcpy(&new_image[offset], buf, len);
+	nb_writes++;
+	return 0;
+}
+
+static void tst_chunk_done(void *priv, uint32_t in_offset, int16_t id)
+{
+	done_offset = in_offset;
+	done_id = id;
+}
+
+static const struct ota_patch_ops tst_ops = {
+	.read_old = tst_read_old,
+	.read_new = tst_read_new,
+	.write_new = tst_write_new,
+	.chunk_done = tst_chunk_done,
+};
+
+static void tst_images_init(void)
+{
+	int i;
+
+	for (i = 0; i < TST_OLD_LEN; i++)
+		old_image[i] = i * 13;
+	memcpy(expected, old_image, 2 * TST_CHUNK_SIZE);
+	memset(&expected[TST_CHUNK_SIZE + 10], 0xaa, 10);
+	for (i = 0; i < 200; i++)
+		expected[2 * TST_CHUNK_SIZE + i] = (i % 16) ^ 0x5a;
+	memset(new_image, 0xff, sizeof(new_image));
+	nb_writes = 0;
+}
+
+static int tst_apply(struct ota_patch_ctx *ctx, uint32_t from)
+{
+	uint32_t i;
+	int rc = OTA_PATCH_OK;
+
+	for (i = from; i < sizeof(tst_package) && rc == OTA_PATCH_OK;
+	     i += TST_FEED_SIZE)
+		rc = ota_patch_feed(ctx, &tst_package[i],
+				    MIN(TST_FEED_SIZE, sizeof(tst_package) - i));
+	if (rc == OTA_PATCH_OK)
+		rc = ota_patch_finish(ctx, TST_NEW_LEN);
+	return rc;
+}
+
+void ota_patch_tst(void)
+{
+	struct ota_patch_ctx ctx;
+	uint32_t start, duration;
+	int rc;
+
+	cu_print("##############################################################\n");
+	cu_print("# OTA patch applier test                                     #\n");
+	cu_print("##############################################################\n");
+
+	CU_ASSERT("crc32 mismatch",
+		  ota_crc32(0, (const uint8_t *)"123456789", 9) == 0xcbf43926);
+
+	/* Full update */
+	tst_images_init();
+	rc = ota_patch_init(&ctx, &tst_ops, work, sizeof(work), TST_CHUNK_SIZE);
+	CU_ASSERT("init failed", rc == OTA_PATCH_OK);
+	start = get_uptime_32k();
+	rc = tst_apply(&ctx, 0);
+	duration = get_uptime_32k() - start;
+	CU_ASSERT("update failed", rc == OTA_PATCH_OK);
+	CU_ASSERT("wrong new image", !memcmp(new_image, expected, TST_NEW_LEN));
+	CU_ASSERT("wrong chunk count", ctx.nb_applied == 2 && ctx.nb_kept == 1);
+	CU_ASSERT("wrong progress", done_offset == sizeof(tst_package) &&
+		  done_id == 2);
+	cu_print("%d bytes package for a %d bytes image, applied in %d us, "
+		 "%d bytes of RAM\n", sizeof(tst_package), TST_NEW_LEN,
+		 (int)((uint64_t)duration * 1000000 / 32768),
+		 sizeof(ctx) + sizeof(work));
+
+	/* Applying again is a no-op */
+	nb_writes = 0;
+	ota_patch_init(&ctx, &tst_ops, work, sizeof(work), TST_CHUNK_SIZE);
+	rc = tst_apply(&ctx, 0);
+	CU_ASSERT("update failed", rc == OTA_PATCH_OK);
+	CU_ASSERT("chunks rewritten", nb_writes == 0 && ctx.nb_skipped == 2);
+
+	/* Resume after the first chunk of the package */
+	tst_images_init();
+	ota_patch_init(&ctx, &tst_ops, work, sizeof(work), TST_CHUNK_SIZE);
+	rc = ota_patch_feed(&ctx, tst_package, 100);
+	CU_ASSERT("feed failed", rc == OTA_PATCH_OK && done_id == 1);
+	memset(&new_image[2 * TST_CHUNK_SIZE], 0xff, TST_CHUNK_SIZE);
+	ota_patch_init(&ctx, &tst_ops, work, sizeof(work), TST_CHUNK_SIZE);
+	ota_patch_resume(&ctx, done_offset, done_id);
+	rc = tst_apply(&ctx, done_offset);
+	CU_ASSERT("resume failed", rc == OTA_PATCH_OK && ctx.nb_applied == 1);
+	CU_ASSERT("wrong new image", !memcmp(new_image, expected, TST_NEW_LEN));
+
+	/* Patch applied on a different image */
+	tst_images_init();
+	old_image[TST_CHUNK_SIZE + 100]++;
+	ota_patch_init(&ctx, &tst_ops, work, sizeof(work), TST_CHUNK_SIZE);
+	rc = tst_apply(&ctx, 0);
+	CU_ASSERT("wrong base image accepted", rc == OTA_PATCH_ERR_FROM_CRC);
+
+	/* Work buffer too small for the patch */
+	tst_images_init();
+	ota_patch_init(&ctx, &tst_ops, work, TST_CHUNK_SIZE + 64,
+		       TST_CHUNK_SIZE);
+	rc = tst_apply(&ctx, 0);
+	CU_ASSERT("patch overflow", rc == OTA_PATCH_ERR_NO_MEM);
+}
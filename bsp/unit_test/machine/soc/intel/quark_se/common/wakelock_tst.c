@@ -51,8 +51,10 @@ void wakelock_test(void)
 {
 	int ret;
 
-	// Declare wakelock for test
+	// Declare wakelocks for test
 	struct pm_wakelock pm0;
+	struct pm_wakelock pm1;
+	struct pm_wakelock pm2;
 
 	cu_print("##################################################\n");
 	cu_print("# Purpose of wakelock tests (No HW cfg needed):  #\n");
@@ -60,6 +62,8 @@ void wakelock_test(void)
 	cu_print("# - Try to acquire a locked wakelock             #\n");
 	cu_print("# - Release a valid wakelock and check all WL are freed #\n");
 	cu_print("# - Try release already released wakelocks       #\n");
+	cu_print("# - Release wakelocks out of acquisition order   #\n");
+	cu_print("# - Check wakelock hold statistics               #\n");
 	cu_print("##################################################\n");
 
 	// Init test locks
@@ -85,6 +89,60 @@ void wakelock_test(void)
 	ret = pm_wakelock_release(&pm0);
 	CU_ASSERT("release pm0 ok. It should have failed", ret == -EINVAL);
 
+	// Release wakelocks from the middle, the tail, then the head of the list
+	pm_wakelock_init(&pm1);
+	pm_wakelock_init(&pm2);
+	ret = pm_wakelock_acquire(&pm0);
+	ret |= pm_wakelock_acquire(&pm1);
+	ret |= pm_wakelock_acquire(&pm2);
+	CU_ASSERT("acquire pm0/pm1/pm2 failed", !ret);
+	ret = pm_wakelock_release(&pm1);
+	CU_ASSERT("release pm1 failed", !ret);
+	CU_ASSERT("wakelock list empty", !pm_wakelock_is_list_empty());
+	ret = pm_wakelock_release(&pm2);
+	CU_ASSERT("release pm2 failed", !ret);
+	CU_ASSERT("wakelock list empty", !pm_wakelock_is_list_empty());
+	ret = pm_wakelock_acquire(&pm1);
+	CU_ASSERT("acquire pm1 again failed", !ret);
+	ret = pm_wakelock_release(&pm0);
+	CU_ASSERT("release pm0 failed", !ret);
+	CU_ASSERT("wakelock list empty", !pm_wakelock_is_list_empty());
+	ret = pm_wakelock_release(&pm1);
+	CU_ASSERT("release pm1 failed", !ret);
+
+#ifdef CONFIG_PM_WAKELOCK_STATS
+	struct pm_wakelock_top top[CONFIG_PM_WAKELOCK_STATS_NB];
+	int i, n;
+
+	CU_ASSERT("pm0 hold count", pm0.stats.count == 2);
+	CU_ASSERT("pm1 hold count", pm1.stats.count == 2);
+	CU_ASSERT("pm2 hold count", pm2.stats.count == 1);
+	CU_ASSERT("pm1 max hold time",
+		  pm1.stats.max <= pm1.stats.total);
+
+	n = pm_wakelock_get_top(top, CONFIG_PM_WAKELOCK_STATS_NB);
+	CU_ASSERT("no wakelock statistics", n > 0);
+	for (i = 1; i < n; i++)
+		CU_ASSERT("wakelock statistics not sorted",
+			  top[i - 1].stats.total >= top[i].stats.total);
+
+	// A new wakelock at the address of pm0 does not inherit its statistics
+	pm_wakelock_init(&pm0);
+	n = pm_wakelock_get_top(top, CONFIG_PM_WAKELOCK_STATS_NB);
+	for (i = 0; i < n; i++)
+		CU_ASSERT("stale wakelock statistics", top[i].wl != &pm0);
+
+	// The test wakelocks are on the stack: forget them before returning
+	pm_wakelock_stats_remove(&pm0);
+	pm_wakelock_stats_remove(&pm1);
+	pm_wakelock_stats_remove(&pm2);
+	n = pm_wakelock_get_top(top, CONFIG_PM_WAKELOCK_STATS_NB);
+	for (i = 0; i < n; i++)
+		CU_ASSERT("test wakelock left in statistics",
+			  top[i].wl != &pm0 && top[i].wl != &pm1 &&
+			  top[i].wl != &pm2);
+#endif
+
 	// Flush circular buffer
 	local_task_sleep_ms(100);
 }
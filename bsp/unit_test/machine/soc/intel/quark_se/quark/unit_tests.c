@@ -30,6 +30,7 @@
 
 #include "os/os.h"
 #include "util/cunit_test.h"
+#include "util/cunit_bench.h"
 #include "machine/soc/intel/quark_se/quark/log_backend_uart.h"
 
 void run_unit_tests(void)
@@ -63,7 +64,41 @@ void run_unit_tests(void)
 
 	CU_RUN_TEST(cbuffer_tst);
 	CU_RUN_TEST(wakelock_test);
+#if defined(CONFIG_CUNIT_BENCH)
+	CU_RUN_BENCH(bench_wakelock);
+#endif
+	CU_RUN_TEST(device_pm_test);
 	CU_RUN_TEST(list_test);
+#if defined(CONFIG_LP5562_LED)
+	CU_RUN_TEST(lp5562_pattern_test);
+#endif
+#if defined(CONFIG_DRV2605)
+	CU_RUN_TEST(drv2605_seq_test);
+#endif
+#if defined(CONFIG_SERVICES_QUARK_SE_GPIO_IMPL)
+	CU_RUN_TEST(gpio_edge_test);
+#endif
+#if defined(CONFIG_BLE_APP_CONN_POLICY)
+	CU_RUN_TEST(ble_conn_policy_test);
+#endif
+#if defined(CONFIG_BLE_HRS_LIB)
+	CU_RUN_TEST(ble_hrs_meas_test);
+#endif
+#if defined(CONFIG_STEP_DETECTOR)
+	CU_RUN_TEST(step_detector_test);
+#endif
+#if defined(CONFIG_FG_MODEL)
+	CU_RUN_TEST(fg_model_test);
+#endif
+#if defined(CONFIG_NFC_STN54_FW_UPDATE)
+	CU_RUN_TEST(nfc_fwu_test);
+#endif
+#if defined(CONFIG_OTA_PATCH)
+	CU_RUN_TEST(ota_patch_tst);
+#endif
+#if defined(CONFIG_EVENT_JOURNAL)
+	CU_RUN_TEST(event_journal_tst);
+#endif
 
 	cu_print("##################################################\n");
 	cu_print("#        STARTING DRIVER TEST IN DEEPSLEEP       #\n");
@@ -16,4 +16,5 @@ obj-y += test_malloc.o
 obj-y += test_mutex.o
 obj-y += test_stub.o
 obj-y += test_suite.o
+obj-$(CONFIG_CUNIT_BENCH) += bench_os.o
 CFLAGS_test_malloc.o +=-I$(CONFIG_MEM_POOL_DEF_PATH)
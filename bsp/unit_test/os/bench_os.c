@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * \file bench_os.c
+ *
+ * OS abstraction / micro benchmarks of the services used on the hot paths:
+ * memory pools, queues, semaphores, timers, port messages and cbuffer.
+ */
+
+#include <string.h>
+
+#include "os/os.h"
+#include "infra/port.h"
+#include "infra/message.h"
+#include "util/cbuffer.h"
+#include "util/cunit_bench.h"
+
+#define BENCH_QUEUE_SIZE        8
+#define BENCH_CB_MSG            16
+
+static void bench_balloc_body(uint32_t n, void *priv)
+{
+	uint32_t size = (uintptr_t)priv;
+	void *ptr;
+
+	while (n--) {
+		ptr = balloc(size, NULL);
+		bfree(ptr);
+	}
+}
+
+static void bench_balloc_depth_body(uint32_t n, void *priv)
+{
+	void *ptr[4];
+	int i;
+
+	while (n--) {
+		for (i = 0; i < 4; i++)
+			ptr[i] = balloc(32, NULL);
+		for (i = 0; i < 4; i++)
+			bfree(ptr[i]);
+	}
+}
+
+static void bench_queue_body(uint32_t n, void *priv)
+{
+	T_QUEUE queue = priv;
+	T_QUEUE_MESSAGE msg = priv;
+
+	while (n--) {
+		queue_send_message(queue, msg, NULL);
+		queue_get_message(queue, &msg, OS_NO_WAIT, NULL);
+	}
+}
+
+static void bench_queue_empty_body(uint32_t n, void *priv)
+{
+	T_QUEUE queue = priv;
+	T_QUEUE_MESSAGE msg;
+	OS_ERR_TYPE err;
+
+	while (n--)
+		queue_get_message(queue, &msg, OS_NO_WAIT, &err);
+}
+
+static void bench_sema_body(uint32_t n, void *priv)
+{
+	T_SEMAPHORE sema = priv;
+
+	while (n--) {
+		semaphore_give(sema, NULL);
+		semaphore_take(sema, OS_NO_WAIT);
+	}
+}
+
+static void bench_timer_cb(void *priv)
+{
+}
+
+static void bench_timer_body(uint32_t n, void *priv)
+{
+	T_TIMER timer = priv;
+
+	while (n--) {
+		timer_start(timer, 1000, NULL);
+		timer_stop(timer);
+	}
+}
+
+static void bench_timer_create_body(uint32_t n, void *priv)
+{
+	T_TIMER timer;
+
+	while (n--) {
+		timer = timer_create(bench_timer_cb, NULL, 1000, false, true,
+				     NULL);
+		timer_delete(timer);
+	}
+}
+
+#ifdef CONFIG_PORT_IS_MASTER
+struct bench_port {
+	uint16_t id;
+	T_QUEUE queue;
+	uint32_t handled;
+};
+
+static void bench_port_handler(struct message *msg, void *priv)
+{
+	struct bench_port *port = priv;
+
+	port->handled++;
+	message_free(msg);
+}
+
+/* Allocation, sending, dispatching and freeing of a local message */
+static void bench_port_body(uint32_t n, void *priv)
+{
+	struct bench_port *port = priv;
+	struct message *msg;
+
+	while (n--) {
+		msg = message_alloc(sizeof(*msg) + 8, NULL);
+		MESSAGE_SRC(msg) = port->id;
+		MESSAGE_DST(msg) = port->id;
+		MESSAGE_LEN(msg) = sizeof(*msg) + 8;
+		port_send_message(msg);
+		queue_process_message(port->queue);
+	}
+}
+#endif
+
+#ifdef CONFIG_LOG_CBUFFER
+static void bench_cbuffer_body(uint32_t n, void *priv)
+{
+	cbuffer_t *cb = priv;
+	uint8_t msg[BENCH_CB_MSG];
+
+	memset(msg, 0x5a, sizeof(msg));
+	while (n--) {
+		cb_push(cb, msg, sizeof(msg));
+		cb_pop(cb, cb->r, msg, sizeof(msg));
+	}
+}
+#endif
+
+void bench_os(void)
+{
+	T_QUEUE queue;
+	T_SEMAPHORE sema;
+	T_TIMER timer;
+
+	CU_BENCH("balloc_free_16", bench_balloc_body, (void *)16);
+	CU_BENCH("balloc_free_128", bench_balloc_body, (void *)128);
+	CU_BENCH("balloc_free_4x32", bench_balloc_depth_body, NULL);
+
+	queue = queue_create(BENCH_QUEUE_SIZE);
+	CU_ASSERT("bench queue", queue != NULL);
+	if (queue) {
+		CU_BENCH("queue_send_get", bench_queue_body, queue);
+		CU_BENCH("queue_get_empty", bench_queue_empty_body, queue);
+		queue_delete(queue);
+	}
+
+	sema = semaphore_create(0);
+	CU_ASSERT("bench semaphore", sema != NULL);
+	if (sema) {
+		CU_BENCH("sema_give_take", bench_sema_body, sema);
+		semaphore_delete(sema);
+	}
+
+	timer = timer_create(bench_timer_cb, NULL, 1000, false, false, NULL);
+	CU_ASSERT("bench timer", timer != NULL);
+	if (timer) {
+		CU_BENCH("timer_start_stop", bench_timer_body, timer);
+		timer_delete(timer);
+	}
+	CU_BENCH("timer_create_delete", bench_timer_create_body, NULL);
+
+#ifdef CONFIG_PORT_IS_MASTER
+	/* Ports can not be freed: the port of the benchmark is kept */
+	{
+		static struct bench_port port;
+
+		if (port.id == 0) {
+			port.queue = queue_create(BENCH_QUEUE_SIZE);
+			port.id = port_alloc(port.queue);
+			port_set_handler(port.id, bench_port_handler, &port);
+		}
+		port.handled = 0;
+		CU_BENCH("port_message", bench_port_body, &port);
+		CU_ASSERT("bench port messages handled", port.handled > 0);
+	}
+#endif
+
+#ifdef CONFIG_LOG_CBUFFER
+	{
+		/* cbuffer works on buffers of the log size */
+		static uint8_t cb_data[CONFIG_LOG_CBUFFER_SIZE];
+		static cbuffer_t cb = {
+			.buf = cb_data, .buf_size = CONFIG_LOG_CBUFFER_SIZE
+		};
+
+		cb_init(&cb);
+		CU_BENCH("cbuffer_push_pop_16", bench_cbuffer_body, &cb);
+	}
+#endif
+}
@@ -31,6 +31,9 @@
 #include <string.h>
 #include "pinmux.h"
 #include "util/cunit_test.h"
+#ifdef CONFIG_CUNIT_BENCH
+#include "util/cunit_bench.h"
+#endif
 #include "test_task.h"
 #include "utility.h"
 #include "test_queue.h"
@@ -216,6 +219,11 @@ void test_task(void *param)
 	CU_RUN_TEST(test_balib);
 #endif
 
+#ifdef CONFIG_CUNIT_BENCH
+	cu_print("======================\n");
+	cu_print(" OS Abstraction Benchmarks\n");
+	CU_RUN_BENCH(bench_os);
+#endif
 
 	semaphore_give(sema_test_task, NULL);
 }
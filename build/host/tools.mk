@@ -65,3 +65,166 @@ $(LZG): $(OUT)/tools/intermediates $(OUT)/tools/bin $(LZG_LIB)/tools $(LZG_LIB)/
 
 ota_tools: $(LZG) $(MINIBSDIFF) $(MINIBSDIFF_LIB) $(OUT)/tools/bin/ota.py $(OUT)/tools/bin/bsdiff_chunk.py
 	$(AT)echo Deploying tools to generate OTA packages
+
+#############################################################
+# Host round trip of the OTA patch applier
+#############################################################
+
+# Usage: make ota_replay OTA_FROM=<installed image> OTA_TO=<new image>
+.PHONY: ota_replay
+ota_replay: ota_tools $(OUT)/tools/intermediates $(OUT)/tools/bin
+	$(AT)$(MAKE) -C $(T)/tools/ota_replay T=$(T) \
+		OUT=$(OUT)/tools/intermediates/ota_replay \
+		BIN=$(OUT)/tools/bin \
+		BSDIFF_CHUNK='$(PYTHON) $(OUT)/tools/bin/bsdiff_chunk.py' \
+		$(if $(OTA_FROM),run FROM=$(OTA_FROM) TO=$(OTA_TO))
+
+#############################################################
+# Host replay of sensor traces through open sensor core
+#############################################################
+
+.PHONY: opencore_replay
+opencore_replay: $(OUT)/tools/intermediates $(OUT)/tools/bin
+	$(AT)$(MAKE) -C $(T)/tools/opencore_replay T=$(T) \
+		OUT=$(OUT)/tools/intermediates/opencore_replay \
+		BIN=$(OUT)/tools/bin
+
+#############################################################
+# Host evaluation of the step detector
+#############################################################
+
+.PHONY: step_eval
+step_eval: $(OUT)/tools/intermediates $(OUT)/tools/bin
+	$(AT)$(MAKE) -C $(T)/tools/step_eval T=$(T) \
+		OUT=$(OUT)/tools/intermediates/step_eval \
+		BIN=$(OUT)/tools/bin
+
+#############################################################
+# Host simulation of the fuel gauge
+#############################################################
+
+.PHONY: fg_sim
+fg_sim: $(OUT)/tools/intermediates $(OUT)/tools/bin
+	$(AT)$(MAKE) -C $(T)/tools/fg_sim T=$(T) \
+		OUT=$(OUT)/tools/intermediates/fg_sim \
+		BIN=$(OUT)/tools/bin
+
+#############################################################
+# Host simulation of the system events storage
+#############################################################
+
+.PHONY: event_sim
+event_sim: $(OUT)/tools/intermediates $(OUT)/tools/bin
+	$(AT)$(MAKE) -C $(T)/tools/event_sim T=$(T) \
+		OUT=$(OUT)/tools/intermediates/event_sim \
+		BIN=$(OUT)/tools/bin
+
+#############################################################
+# Host run of the OS abstraction micro benchmarks and of the wakelock test
+#############################################################
+
+.PHONY: os_bench
+os_bench: $(OUT)/tools/intermediates $(OUT)/tools/bin
+	$(AT)$(MAKE) -C $(T)/tools/os_bench T=$(T) \
+		OUT=$(OUT)/tools/intermediates/os_bench \
+		BIN=$(OUT)/tools/bin all asan test
+
+#############################################################
+# Host benchmark of the properties storage
+#############################################################
+
+.PHONY: props_bench
+props_bench: $(OUT)/tools/intermediates $(OUT)/tools/bin
+	$(AT)$(MAKE) -C $(T)/tools/props_bench T=$(T) \
+		OUT=$(OUT)/tools/intermediates/props_bench \
+		BIN=$(OUT)/tools/bin run
+
+#############################################################
+# Host simulation of the bootupdater
+#############################################################
+
+.PHONY: boot_sim
+boot_sim: $(OUT)/tools/intermediates $(OUT)/tools/bin
+	$(AT)$(MAKE) -C $(T)/tools/boot_sim T=$(T) \
+		OUT=$(OUT)/tools/intermediates/boot_sim \
+		BIN=$(OUT)/tools/bin
+
+#############################################################
+# Host simulation of the fuel gauge ADC sampling
+#############################################################
+
+.PHONY: adc_scan_sim
+adc_scan_sim: $(OUT)/tools/intermediates $(OUT)/tools/bin
+	$(AT)$(MAKE) -C $(T)/tools/adc_scan_sim T=$(T) \
+		OUT=$(OUT)/tools/intermediates/adc_scan_sim \
+		BIN=$(OUT)/tools/bin run
+
+#############################################################
+# Host simulation of the FAT flash translation layer
+#############################################################
+
+.PHONY: ftl_sim
+ftl_sim: $(OUT)/tools/intermediates $(OUT)/tools/bin
+	$(AT)$(MAKE) -C $(T)/tools/ftl_sim T=$(T) \
+		OUT=$(OUT)/tools/intermediates/ftl_sim \
+		BIN=$(OUT)/tools/bin run
+
+#############################################################
+# Host simulation of the USB log backend
+#############################################################
+
+.PHONY: log_usb_sim
+log_usb_sim: $(OUT)/tools/intermediates $(OUT)/tools/bin
+	$(AT)$(MAKE) -C $(T)/tools/log_usb_sim T=$(T) \
+		OUT=$(OUT)/tools/intermediates/log_usb_sim \
+		BIN=$(OUT)/tools/bin run
+
+#############################################################
+# Host simulation of the UART log backend
+#############################################################
+
+.PHONY: log_uart_sim
+log_uart_sim: $(OUT)/tools/intermediates $(OUT)/tools/bin
+	$(AT)$(MAKE) -C $(T)/tools/log_uart_sim T=$(T) \
+		OUT=$(OUT)/tools/intermediates/log_uart_sim \
+		BIN=$(OUT)/tools/bin run
+
+#############################################################
+# Host simulation of the flash log backend
+#############################################################
+
+.PHONY: log_flash_sim
+log_flash_sim: $(OUT)/tools/intermediates $(OUT)/tools/bin
+	$(AT)$(MAKE) -C $(T)/tools/log_flash_sim T=$(T) \
+		OUT=$(OUT)/tools/intermediates/log_flash_sim \
+		BIN=$(OUT)/tools/bin run
+
+#############################################################
+# Host simulation of the Quark deep sleep governor
+#############################################################
+
+.PHONY: idle_sim
+idle_sim: $(OUT)/tools/intermediates $(OUT)/tools/bin
+	$(AT)$(MAKE) -C $(T)/tools/idle_sim T=$(T) \
+		OUT=$(OUT)/tools/intermediates/idle_sim \
+		BIN=$(OUT)/tools/bin run
+
+#############################################################
+# Host run of the device power management tests
+#############################################################
+
+.PHONY: device_pm_test
+device_pm_test: $(OUT)/tools/intermediates $(OUT)/tools/bin
+	$(AT)$(MAKE) -C $(T)/tools/device_pm_test T=$(T) \
+		OUT=$(OUT)/tools/intermediates/device_pm_test \
+		BIN=$(OUT)/tools/bin run
+
+#############################################################
+# Host simulation of the LP5562 LED driver
+#############################################################
+
+.PHONY: led_sim
+led_sim: $(OUT)/tools/intermediates $(OUT)/tools/bin
+	$(AT)$(MAKE) -C $(T)/tools/led_sim T=$(T) \
+		OUT=$(OUT)/tools/intermediates/led_sim \
+		BIN=$(OUT)/tools/bin run
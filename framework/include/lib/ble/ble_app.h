@@ -71,7 +71,9 @@
  * After a disconnection, it starts normal advertising mode.
  *
  * Default connection interval is 150ms. It can be dynamically updated by using
- * @ref ble_app_conn_update.
+ * @ref ble_app_conn_update. With the `CONFIG_BLE_APP_CONN_POLICY` option, the
+ * connection parameters follow the notifications reported by
+ * @ref ble_app_conn_notify, until @ref ble_app_conn_update is called.
  *
  *
  * @ingroup ble_stack
@@ -138,6 +140,15 @@ int ble_app_conn_update(const struct bt_le_conn_param *p_params);
  */
 int ble_app_restore_default_conn(void);
 
+/**
+ * Report a notification sent to the peer.
+ *
+ * The connection parameters follow the rate of the notifications: a link
+ * without frequent notifications is moved to a long connection interval
+ * with slave latency (`CONFIG_BLE_APP_CONN_POLICY` option).
+ */
+void ble_app_conn_notify(void);
+
 /**
  * Start advertisement reason.
  */
@@ -74,6 +74,15 @@ enum ble_hrs_location {
  */
 extern const enum ble_hrs_location ble_hrs_sensor_location;
 
+/**
+ * Sensor contact status
+ */
+enum ble_hrs_contact {
+	BLE_HRS_CONTACT_UNSUPPORTED = 0,
+	BLE_HRS_CONTACT_LOST = 0x04,
+	BLE_HRS_CONTACT_DETECTED = 0x06
+};
+
 /**
  * Function to update the heart rate measure.
  *
@@ -86,6 +95,46 @@ extern const enum ble_hrs_location ble_hrs_sensor_location;
  */
 int ble_hrs_update(uint8_t value);
 
+/**
+ * Update the heart rate measure, without notifying it at once.
+ *
+ * The latest heart rate, energy expended and the RR-intervals are sent
+ * together every `CONFIG_BLE_HRS_NOTIF_PERIOD` ms, or as soon as the
+ * RR-intervals fill a notification. With a null period, they are sent at
+ * once.
+ *
+ * @param hr New heart rate value, in beats per minute
+ * @param contact Sensor contact status
+ *
+ * @return 0 in case of success or negative value in case of error.
+ */
+int ble_hrs_update_meas(uint16_t hr, enum ble_hrs_contact contact);
+
+/**
+ * Add a RR-interval to the next heart rate measure.
+ *
+ * @param rr RR-interval, in 1/1024 s
+ *
+ * @return 0 in case of success, -ENOSPC if the RR-interval was dropped
+ *         because the pending ones were not notified yet, or negative value
+ *         in case of error.
+ */
+int ble_hrs_add_rr(uint16_t rr);
+
+/**
+ * Set the energy expended, sent once in the next heart rate measure.
+ *
+ * @param energy Accumulated energy expended, in kJ
+ */
+void ble_hrs_set_energy(uint16_t energy);
+
+/**
+ * Notify the pending heart rate measure at once.
+ *
+ * @return 0 in case of success or negative value in case of error.
+ */
+int ble_hrs_flush(void);
+
 /**
  * Retrieve the reference of the HRS measure characteristic value attribute.
  *
@@ -81,16 +81,17 @@ int ble_rscs_init(void);
  * Function to update the measurement value.
  *
  * The remote peers will automatically be notified of this change if they
- * subscribed.
+ * subscribed. Only the latest value of each `CONFIG_BLE_RSCS_NOTIF_PERIOD`
+ * is notified.
  *
  * @param speed The new instantaneous speed value
  * @param cadence The new instantaneous cadence value
  *
  * @return 0 in case of success or negative value in case of error.
  *
- * @note This function will invoke the corresponding functions to retrieve the
- * value of the optional measurements: stride length, total distance and
- * walk/run status.
+ * @note The corresponding functions to retrieve the value of the optional
+ * measurements (stride length, total distance and walk/run status) are
+ * invoked when the measurement is notified.
  */
 int ble_rscs_update(uint16_t speed, uint8_t cadence);
 
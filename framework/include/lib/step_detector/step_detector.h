@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __STEP_DETECTOR_H__
+#define __STEP_DETECTOR_H__
+
+#include <stdint.h>
+
+/*
+ * Integer step detector working on the accelerometer samples.
+ *
+ * The magnitude of the acceleration is smoothed and the gravity, tracked
+ * by a slow low pass filter, is removed from it. A step is the highest
+ * peak between two crossings of the signal through zero, with an hysteresis,
+ * that is far enough from the previous step and whose height above the
+ * previous valley reaches a threshold that adapts to the recent steps.
+ *
+ * Steps are only counted once STEP_BOUT_STEPS of them came at a walking
+ * pace: the first steps of a bout are then counted at once. The cadence is
+ * computed from the last step intervals, the peak times being interpolated
+ * between the samples, so that 25Hz is enough for an accurate cadence.
+ *
+ * The filters adapt to the time between samples: any rate from 20Hz to
+ * 200Hz can be used, and it can change at run time.
+ */
+
+/* Steps of a bout before they are counted */
+#define STEP_BOUT_STEPS         4
+/* Step intervals used for the cadence */
+#define STEP_INTERVALS          4
+/* Shortest and longest step intervals, in ms */
+#define STEP_MIN_INTERVAL       250
+#define STEP_MAX_INTERVAL       2000
+/* Cadence from which the activity is running, in steps/min */
+#define STEP_RUN_CADENCE        140
+
+struct step_detector {
+	/* Filters, in mg Q4 */
+	int32_t gravity;
+	int32_t smooth;
+	int32_t prev;           /* previous signal */
+	uint32_t last_t;        /* time of the previous sample */
+	uint16_t dt;            /* time between samples of the alphas */
+	uint16_t gravity_alpha; /* Q12 */
+	uint16_t smooth_alpha;  /* Q12 */
+	uint8_t started;
+	/* Peak detection */
+	uint8_t above;          /* signal above zero since the last valley */
+	int32_t peak;
+	int32_t peak_left;      /* signal before the peak */
+	uint32_t peak_t;
+	uint32_t peak_fine_t;   /* interpolated peak time */
+	int32_t valley;
+	int32_t amplitude;      /* mean height of the steps */
+	/* Steps */
+	uint32_t last_step_t;
+	uint8_t bout;           /* steps of the bout, up to STEP_BOUT_STEPS */
+	uint8_t intervals_count;
+	uint8_t interval_idx;
+	uint16_t intervals[STEP_INTERVALS];
+	uint32_t steps;         /* counted steps */
+};
+
+/*
+ * Reset the detector, steps count included.
+ */
+void step_detector_init(struct step_detector *sd);
+
+/*
+ * Process an accelerometer sample.
+ *
+ * @param acc acceleration on the 3 axes, in mg
+ * @param t time of the sample, in ms
+ *
+ * @return number of steps counted by this sample
+ */
+int step_detector_process(struct step_detector *sd, const int16_t acc[3],
+			  uint32_t t);
+
+/*
+ * Get the current cadence.
+ *
+ * @param now current time, in ms
+ *
+ * @return cadence in steps/min, 0 out of a bout
+ */
+uint16_t step_detector_cadence(const struct step_detector *sd, uint32_t now);
+
+#endif /* __STEP_DETECTOR_H__ */
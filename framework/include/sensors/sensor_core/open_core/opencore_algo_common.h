@@ -103,10 +103,38 @@ typedef struct {
 	uint16_t put_idx;
 	uint16_t get_idx;
 	int16_t raw_data_offset;
+	uint32_t timestamp;	/* newest frame in match_buffer, in ms */
 }sensor_data_demand_t;
 
+/**
+ * binding of a demand to the sensors serving it, resolved by open sensor
+ * core each time the physical sensors are reconfigured, so that exec does
+ * not have to look them up for every sample
+ **/
+typedef struct {
+	void *phy_sensor;		/* active physical sensor, NULL if off */
+	exposed_sensor_t *exposed;	/* exposed sensor of the same type/id */
+	uint8_t frame_size;		/* data frame size, 0 if off */
+}feed_binding_t;
+
+/**
+ * frames of one demand handed to exec_block, oldest first
+ **/
+typedef struct {
+	void *frames;		/* count contiguous frames */
+	uint16_t count;		/* 0 if no data for this demand */
+	uint8_t frame_size;
+	uint32_t timestamp;	/* of the first frame, in ms */
+	uint16_t interval;	/* between two frames, in 1/10 ms */
+}feed_block_t;
+
 /**
  * feed control api structure, which are called by open sensor core
+ *
+ * exec_block is optional: when set, the frames received since the last
+ * call are handed at once, one feed_block_t per demand, and exec may be
+ * NULL. As a block may produce several results, exec_block reports them
+ * with ReportSensDataDirectly() rather than through ready_flag.
  **/
 struct feed_general_t;
 typedef struct {
@@ -122,6 +150,7 @@ typedef struct {
 	int (*set_property)(struct feed_general_t *, uint8_t exposed_type,
 			    uint8_t exposed_id, uint8_t param_length,
 			    void *ptr_param);
+	int (*exec_block)(feed_block_t *, struct feed_general_t *);
 }feed_control_api_t;
 
 /**
@@ -136,6 +165,7 @@ typedef struct feed_general_t {
 	uint16_t mark_flag;
 	feed_control_api_t ctl_api;
 	void *param;
+	feed_binding_t *binding;	/* one per demand */
 	int8_t demand_length;
 	uint8_t rf_cnt;
 	basic_algo_type_t type;
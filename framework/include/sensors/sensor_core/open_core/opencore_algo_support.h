@@ -104,6 +104,29 @@ static inline int GetDemandIdx(feed_general_t *feed, uint8_t type)
 	return -1;
 }
 
+/**
+ *  @brief  Get the data frame size of a demand of the feed.
+ * @param[in]  feed : the feed structure
+ * @param[in]  idx : the demand index
+ * @return the frame size, or -1 if the physical sensor is not active.
+ */
+static inline int GetDemandFrameSize(feed_general_t *feed, int idx)
+{
+	return feed->binding[idx].frame_size ?
+	       feed->binding[idx].frame_size : -1;
+}
+
+/**
+ *  @brief  Get the exposed sensor of the same type and id as a demand.
+ * @param[in]  feed : the feed structure
+ * @param[in]  idx : the demand index
+ * @return the exposed sensor, or NULL if none.
+ */
+static inline exposed_sensor_t *GetDemandExposed(feed_general_t *feed, int idx)
+{
+	return feed->binding[idx].exposed;
+}
+
 /**
  *  @brief  With this api, algorithm can report algo exec result to app directly
  * @param[in]  exposed_sensor : pointer of exposed sensor
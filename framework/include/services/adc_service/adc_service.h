@@ -64,15 +64,57 @@
 #define MSG_ID_ADC_SERVICE_GET_VAL_RSP          (MSG_ID_ADC_SERVICE_RSP | 0x5)
 #define MSG_ID_ADC_SERVICE_SUBSCRIBE_RSP        (MSG_ID_ADC_SERVICE_RSP | 0x6)
 #define MSG_ID_ADC_SERVICE_UNSUBSCRIBE_RSP      (MSG_ID_ADC_SERVICE_RSP | 0x7)
+#define MSG_ID_ADC_SERVICE_SCAN_SUBSCRIBE_RSP   (MSG_ID_ADC_SERVICE_RSP | 0x8)
+#define MSG_ID_ADC_SERVICE_SCAN_UNSUBSCRIBE_RSP (MSG_ID_ADC_SERVICE_RSP | 0x9)
 
 /** Message ID of service response for ADC events */
 #define MSG_ID_ADC_SERVICE_GET_VAL_EVT                  (MSG_ID_ADC_SERVICE_EVT)
+#define MSG_ID_ADC_SERVICE_SCAN_EVT                     (MSG_ID_ADC_SERVICE_EVT | 0x1)
 
 /** ID for ADC RX interrupt */
 #define ADC_EVT_RX                      0
 /** ID for ADC ERR interrupt */
 #define ADC_EVT_ERR                     1
 
+/** Maximum number of channels of a scan subscription */
+#define ADC_SERVICE_SCAN_MAX_CHANNELS   4
+/** Maximum number of values (batch_size * nb_channels) of a scan event */
+#define ADC_SERVICE_SCAN_MAX_VALUES     64
+/** No load switch GPIO to toggle for a scanned channel */
+#define ADC_SERVICE_NO_GPIO             0xff
+
+/** Samples delivered by a scan subscription */
+typedef enum {
+	ADC_SCAN_DECIMATE = 0,  /*!< Last scan of each period */
+	ADC_SCAN_AVERAGE        /*!< Average of the scans of each period */
+} adc_service_scan_mode_t;
+
+/**
+ * Scan subscription configuration, see @ref adc_service_scan_subscribe
+ */
+typedef struct {
+	uint8_t channels[ADC_SERVICE_SCAN_MAX_CHANNELS];  /*!< ADC channels [0..18] */
+	uint8_t gpio_pins[ADC_SERVICE_SCAN_MAX_CHANNELS]; /*!< SS GPIO load switch of each channel or ADC_SERVICE_NO_GPIO */
+	uint8_t nb_channels;    /*!< Number of channels */
+	bool active_high;       /*!< Polarity of the GPIOs */
+	uint8_t mode;           /*!< ADC_SCAN_DECIMATE or ADC_SCAN_AVERAGE */
+	uint16_t settle_time;   /*!< Time in ms between GPIO activation and the scan */
+	uint16_t batch_size;    /*!< Number of samples per event */
+	uint32_t period;        /*!< Time in ms between two samples */
+} adc_service_scan_cfg_t;
+
+/**
+ * Event message structure for @ref adc_service_scan_subscribe
+ */
+typedef struct {
+	struct cfw_message header;
+	uint32_t timestamp;     /*!< Timestamp of the last sample */
+	int status;             /*!< DRV_RC_OK, or the error of a failed scan */
+	uint16_t nb_samples;    /*!< Number of samples of each channel */
+	uint8_t nb_channels;    /*!< Number of channels */
+	uint16_t values[];      /*!< nb_samples groups of nb_channels values, in subscription order */
+} adc_service_scan_evt_msg_t;
+
 /**
  * @ref adc_service_subscribe response message structure
  */
@@ -171,6 +213,44 @@ void adc_service_subscribe(cfw_service_conn_t *service_conn, uint32_t channel,
 void adc_service_unsubscribe(cfw_service_conn_t *	service_conn,
 			     void *			adc_svc_client);
 
+/**
+ * Subscribe to periodic samples of a set of channels.
+ *
+ * All the scan subscriptions share a single hardware sequence, run at the
+ * shortest of their periods. At each scan all the subscribed channels are
+ * converted, after all the load switch GPIOs have been activated once for
+ * the scan. Each subscription gets a sample every time its own period has
+ * elapsed (the last scan or the average of the scans of the period), and an
+ * event when batch_size samples are available.
+ *
+ * A subscription is rejected if the shortest period would not be longer than
+ * the longest settle time of the subscriptions using GPIOs.
+ *
+ * @param service_conn Service connection handle.
+ * @param cfg Scan configuration, copied in the request.
+ * @param priv Private data that will be passed back in the response and the event messages.
+ *
+ * @b Response: _MSG_ID_ADC_SERVICE_SCAN_SUBSCRIBE_RSP_ with attached \ref adc_service_subscribe_rsp_msg_t
+ *
+ * @b Events: _MSG_ID_ADC_SERVICE_SCAN_EVT_ with attached \ref adc_service_scan_evt_msg_t
+ */
+void adc_service_scan_subscribe(cfw_service_conn_t *		service_conn,
+				const adc_service_scan_cfg_t *	cfg,
+				void *				priv);
+
+/**
+ * Unsubscribe a scan subscription.
+ *
+ * Samples of an incomplete batch are dropped.
+ *
+ * @param service_conn Service connection handle.
+ * @param adc_scan_client Subscribe connection handle as received in \ref adc_service_subscribe_rsp_msg_t.
+ *
+ * @b Response: _MSG_ID_ADC_SERVICE_SCAN_UNSUBSCRIBE_RSP_
+ */
+void adc_service_scan_unsubscribe(cfw_service_conn_t *	service_conn,
+				  void *		adc_scan_client);
+
 /** @} */
 
 #endif /* __ADC_SERVICE_H__ */
@@ -119,6 +119,16 @@ typedef enum {
 	BATTERY_SHUTDOWN_LEVEL_ALARM,
 } battery_alarm_type_t;
 
+/**
+ * @enum battery_load_source_t
+ * Subsystems hinting their current to the fuel gauge
+ */
+typedef enum {
+	BATTERY_LOAD_RADIO = 0,
+	BATTERY_LOAD_HAPTIC,
+	BATTERY_LOAD_COUNT
+} battery_load_source_t;
+
 /** Message ID Response offset */
 #define MSG_ID_BATTERY_SERVICE_RSP                            (	\
 		MSG_ID_BATT_SERVICE_BASE + 0x40)
@@ -338,6 +348,21 @@ void battery_service_set_measure_interval(
 	cfw_service_conn_t *			conn,
 	struct battery_service_period_cfg_msg * period_cfg,
 	void *					priv);
+
+/**
+ * Hint the fuel gauge about the current drawn by a subsystem.
+ *
+ * This is a direct call, not a request to the service: the subsystem calls
+ * it from its own context each time its consumption changes, and the fuel
+ * gauge compensates the voltage measures for the load. The hints set before
+ * the fuel gauge is started are kept. Only available with CONFIG_FG_MODEL.
+ *
+ * Authorized execution levels:  task, fiber.
+ * @param[in] source Subsystem drawing the current.
+ * @param[in] current_ua Current drawn from now on, in uA, 0 when idle.
+ */
+void battery_service_set_load_hint(battery_load_source_t source,
+				   uint32_t current_ua);
 /** @} */
 
 #endif /* _BATTERY_SERVICE_H_ */
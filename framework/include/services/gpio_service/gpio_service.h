@@ -112,15 +112,44 @@ typedef struct gpio_service_listen_rsp_msg {
 	int status;             /*!< Response status code.*/
 } gpio_service_listen_rsp_msg_t;
 
-/** Event message structure for @ref gpio_service_listen */
+/** Edge of a listened GPIO */
+struct gpio_service_edge {
+	uint32_t timestamp;     /*!< Time of the edge, in 32kHz clock unit */
+	bool state;             /*!< Gpio state after the edge */
+};
+
+/**
+ * Event message structure for @ref gpio_service_listen.
+ *
+ * The event holds all the edges of the GPIO since the previous event, oldest
+ * first; pin_state and timestamp describe the last one.
+ */
 typedef struct gpio_service_listen_evt_msg {
 	struct cfw_message header; /*!< Message header */
 	uint8_t index;          /*!< Index of GPIO which triggered the interrupt */
 	bool pin_state;         /*!< Current gpio state */
-	uint32_t timestamp;     /*!< Gpio event timestamp */
+	uint32_t timestamp;     /*!< Gpio event timestamp, in ms */
 	int status;             /*!< Response status code.*/
+	uint16_t lost;          /*!< Edges lost since the previous event */
+	uint8_t nb_edges;       /*!< Number of edges */
+	struct gpio_service_edge edges[]; /*!< Edges, oldest first */
 } gpio_service_listen_evt_msg_t;
 
+/**
+ * Get the time of an edge of a GPIO event, in ms.
+ * @param evt GPIO event
+ * @param i Index of the edge in the event
+ * @return the time of the edge, on the same time base as the event timestamp
+ */
+static inline uint32_t gpio_service_edge_ms(
+	const gpio_service_listen_evt_msg_t *evt, uint8_t i)
+{
+	uint32_t delta = evt->edges[evt->nb_edges - 1].timestamp -
+			 evt->edges[i].timestamp;
+
+	return evt->timestamp - (uint32_t)(((uint64_t)delta * 1000) >> 15);
+}
+
 /** Response message structure @ref gpio_service_unlisten */
 typedef struct gpio_service_unlisten_rsp_msg {
 	struct cfw_message header; /*!< Message header */
@@ -214,6 +243,25 @@ void gpio_service_listen(cfw_service_conn_t *service_conn, uint8_t pin,
 			 gpio_service_isr_mode_t mode, uint8_t debounce,
 			 void *priv);
 
+/**
+ * Register to gpio state change, with delayed delivery of the edges.
+ *
+ * Same as @ref gpio_service_listen, but an edge may wait up to max_latency
+ * ms before being sent, so that the edges of bursts are sent together in
+ * fewer events.
+ * @param service_conn Service connection
+ * @param pin GPIO index in the port to configure
+ * @param mode Interrupt mode (RISING_EDGE, FALLING_EDGE, BOTH_EDGE)
+ * @param debounce Debounce config (DEB_OFF, DEB_ON)
+ * @param max_latency Longest delay of an edge before it is sent, in ms
+ * @param priv Private data pointer passed back in the response message.
+ * @b Response: _MSG_ID_GPIO_SERVICE_LISTEN_RSP_ with attached \ref gpio_service_listen_rsp_msg_t
+ * @b Event: _MSG_ID_GPIO_SERVICE_EVT_ with attached \ref gpio_service_listen_evt_msg_t
+ */
+void gpio_service_listen_batch(cfw_service_conn_t *service_conn, uint8_t pin,
+			       gpio_service_isr_mode_t mode, uint8_t debounce,
+			       uint16_t max_latency, void *priv);
+
 /**
  * Unregister to gpio state change.
  *
@@ -55,6 +55,55 @@
 #define MSG_ID_PROP_SERVICE_READ_RSP    ((MSG_ID_PROP_SERVICE_BASE + 3) | 0x40)
 #define MSG_ID_PROP_SERVICE_WRITE_RSP   ((MSG_ID_PROP_SERVICE_BASE + 4) | 0x40)
 #define MSG_ID_PROP_SERVICE_REMOVE_RSP  ((MSG_ID_PROP_SERVICE_BASE + 2) | 0x40)
+#define MSG_ID_PROP_SERVICE_READ_MULTI_RSP  ((MSG_ID_PROP_SERVICE_BASE + 5) | \
+					     0x40)
+#define MSG_ID_PROP_SERVICE_WRITE_MULTI_RSP ((MSG_ID_PROP_SERVICE_BASE + 6) | \
+					     0x40)
+
+/** Maximum number of properties in a multiple properties request */
+#define PROPERTIES_SERVICE_MAX_MULTI_ITEMS PROPERTIES_STORAGE_MAX_BATCH_ITEMS
+
+/**
+ * Identifier of a property in a @ref properties_service_read_multi request.
+ */
+typedef struct properties_service_id {
+	uint16_t service_id;    /*!< Service_id of the property */
+	uint16_t property_id;   /*!< Property_id of the property */
+} properties_service_id_t;
+
+/**
+ * Property value passed to @ref properties_service_write_multi.
+ */
+typedef struct properties_service_write_item {
+	uint16_t service_id;    /*!< Service_id of the property */
+	uint16_t property_id;   /*!< Property_id of the property */
+	const void *buffer;     /*!< Buffer containing the new value */
+	uint16_t size;          /*!< Size of the new value */
+} properties_service_write_item_t;
+
+/**
+ * Property value in a multiple properties message.
+ *
+ * The value is padded to 4 bytes, use @ref PROPERTIES_SERVICE_NEXT_ITEM to
+ * get the following item.
+ */
+typedef struct properties_service_item {
+	uint16_t service_id;    /*!< Service_id of the property */
+	uint16_t property_id;   /*!< Property_id of the property */
+	int16_t status;         /*!< Status of the read of this property */
+	uint16_t property_size; /*!< Size of property value */
+	uint8_t value[];        /*!< Property value */
+} properties_service_item_t;
+
+/** Size of an item of a multiple properties message */
+#define PROPERTIES_SERVICE_ITEM_SIZE(size) \
+	(sizeof(properties_service_item_t) + (((size) + 3) & ~3))
+
+/** Return the item following item in a multiple properties message */
+#define PROPERTIES_SERVICE_NEXT_ITEM(item) \
+	((properties_service_item_t *)((uint8_t *)(item) + \
+				       PROPERTIES_SERVICE_ITEM_SIZE( \
+					       (item)->property_size)))
 
 /**
  * Structure containing the response to:
@@ -94,6 +143,27 @@ typedef struct properties_service_write_rsp_msg {
 	int status;                     /*!< Response status code.*/
 } properties_service_write_rsp_msg_t;
 
+/**
+ * Structure containing the response to:
+ *  - @ref properties_service_read_multi
+ */
+typedef struct properties_service_read_multi_rsp_msg {
+	struct cfw_message header;      /*!< Message header */
+	int status;                     /*!< Status of the read operation, use it to check for errors */
+	uint16_t nb_items;              /*!< Number of items */
+	uint16_t items_size;            /*!< Size of all items in bytes */
+	uint8_t start_of_items[];       /*!< First @ref properties_service_item_t */
+} properties_service_read_multi_rsp_msg_t;
+
+/**
+ * Structure containing the response to:
+ *  - @ref properties_service_write_multi
+ */
+typedef struct properties_service_write_multi_rsp_msg {
+	struct cfw_message header;      /*!< Message header */
+	int status;                     /*!< Response status code.*/
+} properties_service_write_multi_rsp_msg_t;
+
 /**
  * Read a property.
  *
@@ -160,6 +230,47 @@ void properties_service_remove(cfw_service_conn_t *conn, uint16_t service_id,
 			       uint16_t property_id,
 			       void *priv);
 
+/**
+ * Read several properties with a single request.
+ *
+ * The response holds one @ref properties_service_item_t per requested
+ * property, in the order of the request. The status of each item tells
+ * whether the property was found.
+ *
+ * @param conn Service client connection pointer.
+ * @param ids Properties to read
+ * @param nb_items Number of properties, at most
+ *        PROPERTIES_SERVICE_MAX_MULTI_ITEMS
+ * @param priv Private data pointer that will be passed back in the response
+ *
+ * @b Response: _MSG_ID_PROP_SERVICE_READ_MULTI_RSP_ with attached \ref properties_service_read_multi_rsp_msg_t
+ */
+void properties_service_read_multi(cfw_service_conn_t *			conn,
+				   const properties_service_id_t *	ids,
+				   uint8_t				nb_items,
+				   void *				priv);
+
+/**
+ * Write or add several properties atomically.
+ *
+ * Either all the properties are written, or none of them, even if a reset
+ * occurs during the operation. The properties are stored with a single flash
+ * append, which is cheaper than writing them one by one.
+ *
+ * @param conn Service client connection pointer.
+ * @param items Properties to write
+ * @param nb_items Number of properties, at most
+ *        PROPERTIES_SERVICE_MAX_MULTI_ITEMS
+ * @param factory_reset_persistent Set to true if the properties need to
+ *        persist upon a factory reset
+ * @param priv Private data pointer that will be passed back in the response
+ *
+ * @b Response: _MSG_ID_PROP_SERVICE_WRITE_MULTI_RSP_ with attached \ref properties_service_write_multi_rsp_msg_t
+ */
+void properties_service_write_multi(
+	cfw_service_conn_t *conn, const properties_service_write_item_t *items,
+	uint8_t nb_items, bool factory_reset_persistent, void *priv);
+
 /** @} */
 
 #endif /* __PROPERTIES_SERVICE_H__ */
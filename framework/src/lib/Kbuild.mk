@@ -1,3 +1,4 @@
 obj-y += button/
 obj-y += ble/
 obj-y += led/
+obj-y += step_detector/
@@ -6,6 +6,7 @@ obj-y += lns/
 obj-y += rscs/
 obj-y += tcmd/
 obj-$(CONFIG_BLE_APP) += ble_app.o
+obj-$(CONFIG_BLE_APP_CONN_POLICY) += ble_conn_policy.o
 
 # for the nordic rpc functions
 CFLAGS_ble_app.o = -I$(T)/external/zephyr/drivers/nble_curie/
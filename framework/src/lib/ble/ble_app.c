@@ -35,7 +35,7 @@
 #include "util/assert.h"
 #include "services/ble_service/ble_service.h"
 #include "services/properties_service/properties_service.h"
-#ifdef CONFIG_BLE_APP_USE_BAT
+#if defined(CONFIG_BLE_APP_USE_BAT) || defined(CONFIG_FG_MODEL)
 #include "services/battery_service/battery_service.h"
 #endif
 #include "ble_service_utils.h"
@@ -64,6 +64,10 @@
 #include "util/misc.h"
 /* boot reason */
 #include "infra/boot.h"
+#ifdef CONFIG_BLE_APP_CONN_POLICY
+#include "infra/time.h"
+#include "ble_conn_policy.h"
+#endif
 
 /* NBLE specific */
 #include "gap_internal.h"
@@ -81,6 +85,20 @@
 #define SLAVE_LATENCY CONFIG_BLE_SLAVE_LATENCY
 #define CONN_SUP_TIMEOUT MSEC_TO_10_MS_UNITS(CONFIG_BLE_CONN_SUP_TIMEOUT)
 
+#ifdef CONFIG_BLE_APP_CONN_POLICY
+static const struct ble_conn_params conn_profiles[BLE_CONN_PROFILES] = {
+	[BLE_CONN_ACTIVE] = {
+		MIN_CONN_INTERVAL, MAX_CONN_INTERVAL, SLAVE_LATENCY,
+		CONN_SUP_TIMEOUT
+	},
+	[BLE_CONN_IDLE] = {
+		MSEC_TO_1_25_MS_UNITS(CONFIG_BLE_IDLE_MIN_CONN_INTERVAL),
+		MSEC_TO_1_25_MS_UNITS(CONFIG_BLE_IDLE_MAX_CONN_INTERVAL),
+		CONFIG_BLE_IDLE_SLAVE_LATENCY, CONN_SUP_TIMEOUT
+	},
+};
+#endif
+
 #define BLE_APP_APPEARANCE 192
 #define BLE_APP_MANUFACTURER 2
 
@@ -109,6 +127,9 @@ struct ble_app_cb {
 	T_TIMER adv_timer;
 	uint32_t adv_timeout;
 	struct ble_connection_values conn_values;
+#ifdef CONFIG_BLE_APP_CONN_POLICY
+	struct ble_conn_policy conn_policy;
+#endif
 	bt_addr_le_t my_bd_addr;
 	/* the name must be stored in FULL because the property interface is asynchronous */
 	uint8_t device_name[BLE_MAX_DEVICE_NAME + 1];
@@ -128,6 +149,7 @@ struct ble_app_prop_rd_msg {
  * Local functions declaration
  */
 static void ble_app_delete_conn_timer(void);
+static void conn_params_timer_handler(void *privData);
 
 /*
  * External functions declaration
@@ -356,6 +378,64 @@ static void ble_app_delete_conn_timer(void)
 	_ble_app_cb.conn_timer = NULL;
 }
 
+#ifdef CONFIG_BLE_APP_CONN_POLICY
+/* Send the request of the policy, and wait for its next deadline */
+static void conn_policy_run(void)
+{
+	struct ble_conn_params req;
+	struct bt_le_conn_param conn_params;
+	OS_ERR_TYPE os_err;
+	uint32_t now = get_uptime_ms();
+	uint32_t next;
+
+	if (!_ble_app_cb.conn_timer)
+		return;
+
+	if (ble_conn_policy_poll(&_ble_app_cb.conn_policy, now, &req)) {
+		conn_params.interval_min = req.interval_min;
+		conn_params.interval_max = req.interval_max;
+		conn_params.latency = req.latency;
+		conn_params.timeout = req.timeout;
+		pr_debug(LOG_MODULE_BLE, "conn params: %d-%d, latency %d",
+			 req.interval_min, req.interval_max, req.latency);
+		bt_conn_le_param_update(_ble_app_cb.conn_periph, &conn_params);
+	}
+
+	/* Re-arm the timer on the next deadline, if any */
+	timer_stop(_ble_app_cb.conn_timer);
+	next = ble_conn_policy_next(&_ble_app_cb.conn_policy, now);
+	if (next)
+		timer_start(_ble_app_cb.conn_timer, next, &os_err);
+}
+
+static void conn_policy_start(void)
+{
+	ble_app_delete_conn_timer();
+	_ble_app_cb.conn_timer = timer_create(conn_params_timer_handler, NULL,
+					      BLE_CONN_START_HOLD, false, false,
+					      NULL);
+	conn_policy_run();
+}
+
+static void conn_params_timer_handler(void *privData)
+{
+	struct bt_conn_info info = { 0 };
+
+	bt_conn_get_info(_ble_app_cb.conn_periph, &info);
+	if (info.role == BT_CONN_ROLE_MASTER) {
+		ble_app_delete_conn_timer();
+		return;
+	}
+	conn_policy_run();
+}
+
+void ble_app_conn_notify(void)
+{
+	if (_ble_app_cb.conn_periph &&
+	    ble_conn_policy_notify(&_ble_app_cb.conn_policy, get_uptime_ms()))
+		conn_policy_run();
+}
+#else
 static void conn_params_timer_handler(void *privData)
 {
 	OS_ERR_TYPE os_err;
@@ -382,6 +462,11 @@ static void conn_params_timer_handler(void *privData)
 		ble_app_delete_conn_timer();
 }
 
+void ble_app_conn_notify(void)
+{
+}
+#endif
+
 #ifdef CONFIG_BLE_APP_USE_BAT
 static void on_batt_service_open(cfw_service_conn_t *p_conn, void *param)
 {
@@ -457,6 +542,18 @@ void ble_app_adv_timer_delete(void)
 	}
 }
 
+#ifdef CONFIG_FG_MODEL
+/* A radio event costs about the same charge whatever its period */
+static void ble_app_load_hint(uint32_t period_us)
+{
+	battery_service_set_load_hint(BATTERY_LOAD_RADIO, period_us ?
+				      CONFIG_FG_MODEL_RADIO_EVENT_NC * 1000 /
+				      period_us : 0);
+}
+#else
+#define ble_app_load_hint(period_us) do {} while (0)
+#endif
+
 static void adv_timeout_cb(void)
 {
 	/* when advertisement timedout, start slow advertising without timeout */
@@ -471,6 +568,7 @@ static void adv_timer_handler(void *privData)
 	ble_app_adv_timer_delete();
 
 	bt_le_adv_stop();
+	ble_app_load_hint(0);
 
 	if (adv_cb)
 		adv_cb();
@@ -550,6 +648,10 @@ static void advertise_start(enum ble_adv_reason reason)
 	if (!status && timeout)
 		ble_app_adv_timer_start(timeout, adv_timeout_cb);
 
+	/* Interval in 0.625 ms */
+	if (!status)
+		ble_app_load_hint(interval * 625);
+
 	if (status)
 		pr_error(LOG_MODULE_MAIN, "start_adv err %d", status);
 }
@@ -581,6 +683,7 @@ void ble_app_stop_advertisement(void)
 {
 	ble_app_adv_timer_delete();
 	bt_le_adv_stop();
+	ble_app_load_hint(0);
 }
 
 __weak void on_ble_app_started(void)
@@ -649,13 +752,24 @@ static void on_connected(struct bt_conn *conn, uint8_t err)
 			_ble_app_cb.conn_values.latency = info.le.latency;
 			_ble_app_cb.conn_values.supervision_to =
 				info.le.timeout;
-
+			/* Interval in 1.25 ms */
+			ble_app_load_hint((uint32_t)info.le.interval * 1250 *
+					  (info.le.latency + 1));
+
+#ifdef CONFIG_BLE_APP_CONN_POLICY
+			/* Adapt the connection parameters to the traffic */
+			ble_conn_policy_init(&_ble_app_cb.conn_policy,
+					     conn_profiles, get_uptime_ms(),
+					     info.le.interval, info.le.latency);
+			conn_policy_start();
+#else
 			/* If peripheral and connection values are not compliant with the PPCP */
 			/* Start a timer to configure the parameters */
 			_ble_app_cb.conn_timer = timer_create(
 				conn_params_timer_handler,
 				NULL, 5000, false,
 				true, NULL);
+#endif
 		}
 
 #if !defined(BLE_APP_DEBUG)
@@ -690,6 +804,7 @@ static void on_disconnected(struct bt_conn *conn, uint8_t reason)
 	if (info.role == BT_CONN_ROLE_SLAVE) {
 		_ble_app_cb.conn_periph = NULL;
 		bt_conn_unref(conn);
+		ble_app_load_hint(0);
 
 		ble_app_stop_advertisement();
 		ble_app_start_advertisement(BLE_ADV_DISCONNECT);
@@ -709,6 +824,15 @@ static void on_le_param_updated(struct bt_conn *conn, uint16_t interval,
 	_ble_app_cb.conn_values.interval = interval;
 	_ble_app_cb.conn_values.latency = latency;
 	_ble_app_cb.conn_values.supervision_to = timeout;
+	if (conn == _ble_app_cb.conn_periph)
+		ble_app_load_hint((uint32_t)interval * 1250 * (latency + 1));
+#ifdef CONFIG_BLE_APP_CONN_POLICY
+	if (conn == _ble_app_cb.conn_periph) {
+		ble_conn_policy_updated(&_ble_app_cb.conn_policy,
+					get_uptime_ms(), interval, latency);
+		conn_policy_run();
+	}
+#endif
 }
 
 static struct bt_conn_cb conn_callbacks = {
@@ -899,7 +1023,17 @@ int ble_app_restore_default_conn(void)
 		MIN_CONN_INTERVAL, MAX_CONN_INTERVAL, SLAVE_LATENCY,
 		CONN_SUP_TIMEOUT
 	};
+	int ret;
 
 	/* Send request to restore default connection */
-	return ble_app_conn_update(&conn_params);
+	ret = ble_app_conn_update(&conn_params);
+#ifdef CONFIG_BLE_APP_CONN_POLICY
+	/* and let the policy follow the traffic again */
+	if (!ret) {
+		_ble_app_cb.conn_policy.requested = BLE_CONN_ACTIVE;
+		_ble_app_cb.conn_policy.requested_at = get_uptime_ms();
+		conn_policy_start();
+	}
+#endif
+	return ret;
 }
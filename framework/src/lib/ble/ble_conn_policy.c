@@ -0,0 +1,223 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "util/misc.h"
+#include "ble_conn_policy.h"
+
+/* Time a lower demand must last before leaving a profile, in ms */
+static const uint32_t conn_hold[BLE_CONN_PROFILES] = {
+	[BLE_CONN_ACTIVE] = 10000,
+	[BLE_CONN_IDLE] = 0,
+};
+
+/* Longest filtered time between notifications, in ms */
+#define NOTIFY_GAP_MAX 60000
+
+/* Interval in 1.25ms unit to ms */
+#define INTERVAL_MS(i) ((uint32_t)(i) * 5 / 4)
+
+static bool time_after_eq(uint32_t a, uint32_t b)
+{
+	return (int32_t)(a - b) >= 0;
+}
+
+/* Profile matching connection parameters */
+static uint8_t conn_match(const struct ble_conn_policy *policy,
+			  uint16_t interval, uint16_t latency)
+{
+	const struct ble_conn_params *params;
+	uint8_t p;
+
+	for (p = 0; p < BLE_CONN_PROFILES; p++) {
+		params = &policy->params[p];
+		if (interval >= params->interval_min &&
+		    interval <= params->interval_max &&
+		    latency == params->latency)
+			return p;
+	}
+	return BLE_CONN_UNKNOWN;
+}
+
+/* Notifications faster than the idle connection events, in ms */
+static uint32_t conn_active_gap(const struct ble_conn_policy *policy)
+{
+	return 2 * INTERVAL_MS(policy->params[BLE_CONN_IDLE].interval_max);
+}
+
+/* Profile needed by the traffic of the link */
+static uint8_t conn_demand(const struct ble_conn_policy *policy, uint32_t now)
+{
+	uint32_t active_gap = conn_active_gap(policy);
+
+	if (now - policy->last_notify < 2 * active_gap &&
+	    policy->notify_gap < active_gap)
+		return BLE_CONN_ACTIVE;
+	return BLE_CONN_IDLE;
+}
+
+/* Keep the earliest deadline after now */
+static void conn_deadline(uint32_t *next, uint32_t now, uint32_t at)
+{
+	uint32_t delay = at - now;
+
+	if ((int32_t)delay > 0 && (!*next || delay < *next))
+		*next = delay;
+}
+
+/* Profile to request for a demand, avoiding profiles in back-off */
+static uint8_t conn_allowed(const struct ble_conn_policy *policy,
+			    uint32_t now, uint8_t profile)
+{
+	if (!policy->rejects[profile] ||
+	    time_after_eq(now, policy->retry_at[profile]))
+		return profile;
+	/* Fall back to the default parameters */
+	if (profile != BLE_CONN_ACTIVE)
+		return conn_allowed(policy, now, BLE_CONN_ACTIVE);
+	return BLE_CONN_UNKNOWN;
+}
+
+static void conn_rejected(struct ble_conn_policy *policy, uint32_t now)
+{
+	uint8_t p = policy->requested;
+	uint8_t shift;
+
+	if (policy->rejects[p] < UINT8_MAX)
+		policy->rejects[p]++;
+	shift = MIN(policy->rejects[p] - 1, BLE_CONN_BACKOFF_SHIFT_MAX);
+	policy->retry_at[p] = now + (BLE_CONN_BACKOFF << shift);
+	policy->requested = BLE_CONN_UNKNOWN;
+}
+
+void ble_conn_policy_init(struct ble_conn_policy *policy,
+			  const struct ble_conn_params *params, uint32_t now,
+			  uint16_t interval, uint16_t latency)
+{
+	uint8_t p;
+
+	policy->params = params;
+	policy->connected_at = now;
+	policy->last_notify = now - NOTIFY_GAP_MAX;
+	policy->notify_gap = NOTIFY_GAP_MAX;
+	policy->requested = BLE_CONN_UNKNOWN;
+	policy->lower = false;
+	for (p = 0; p < BLE_CONN_PROFILES; p++)
+		policy->rejects[p] = 0;
+	policy->profile = conn_match(policy, interval, latency);
+}
+
+int ble_conn_policy_notify(struct ble_conn_policy *policy, uint32_t now)
+{
+	uint32_t gap = MIN(now - policy->last_notify, NOTIFY_GAP_MAX);
+	uint8_t demand = conn_demand(policy, now);
+
+	policy->notify_gap = (3 * policy->notify_gap + gap) / 4;
+	policy->last_notify = now;
+	return conn_demand(policy, now) != demand;
+}
+
+void ble_conn_policy_updated(struct ble_conn_policy *policy, uint32_t now,
+			     uint16_t interval, uint16_t latency)
+{
+	uint8_t p = conn_match(policy, interval, latency);
+
+	if (policy->requested != BLE_CONN_UNKNOWN) {
+		if (p == policy->requested) {
+			policy->rejects[p] = 0;
+			policy->requested = BLE_CONN_UNKNOWN;
+		} else {
+			conn_rejected(policy, now);
+		}
+	}
+	if (p != policy->profile)
+		policy->lower = false;
+	policy->profile = p;
+}
+
+int ble_conn_policy_poll(struct ble_conn_policy *policy, uint32_t now,
+			 struct ble_conn_params *req)
+{
+	uint8_t target = conn_demand(policy, now);
+
+	/* Let the peer discover the services */
+	if (now - policy->connected_at < BLE_CONN_START_HOLD)
+		return 0;
+
+	/* One request at a time */
+	if (policy->requested != BLE_CONN_UNKNOWN) {
+		if (now - policy->requested_at < BLE_CONN_REQ_TIMEOUT)
+			return 0;
+		conn_rejected(policy, now);
+	}
+
+	/* Leave a profile for a less active one after its hold time */
+	if (policy->profile != BLE_CONN_UNKNOWN && target > policy->profile) {
+		if (!policy->lower) {
+			policy->lower = true;
+			policy->lower_since = now;
+		}
+		if (now - policy->lower_since < conn_hold[policy->profile])
+			return 0;
+	} else {
+		policy->lower = false;
+	}
+
+	target = conn_allowed(policy, now, target);
+	if (target == BLE_CONN_UNKNOWN || target == policy->profile)
+		return 0;
+
+	policy->requested = target;
+	policy->requested_at = now;
+	*req = policy->params[target];
+	return 1;
+}
+
+uint32_t ble_conn_policy_next(const struct ble_conn_policy *policy,
+			      uint32_t now)
+{
+	uint32_t next = 0;
+	uint8_t p;
+
+	conn_deadline(&next, now, policy->connected_at + BLE_CONN_START_HOLD);
+	if (policy->requested != BLE_CONN_UNKNOWN)
+		conn_deadline(&next, now,
+			      policy->requested_at + BLE_CONN_REQ_TIMEOUT);
+	/* End of the notifications */
+	if (conn_demand(policy, now) == BLE_CONN_ACTIVE)
+		conn_deadline(&next, now, policy->last_notify +
+			      2 * conn_active_gap(policy));
+	if (policy->lower && policy->profile != BLE_CONN_UNKNOWN)
+		conn_deadline(&next, now, policy->lower_since +
+			      conn_hold[policy->profile]);
+	for (p = 0; p < BLE_CONN_PROFILES; p++)
+		if (policy->rejects[p])
+			conn_deadline(&next, now, policy->retry_at[p]);
+	return next;
+}
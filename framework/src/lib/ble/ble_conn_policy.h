@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __BLE_CONN_POLICY_H__
+#define __BLE_CONN_POLICY_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Connection parameters policy of the peripheral link.
+ *
+ * The policy follows the traffic of the link: frequent notifications get
+ * the default parameters, and an idle link a long interval with slave
+ * latency. Moves to a more active profile are requested at once, moves to
+ * a less active one only once the lower demand has lasted for the hold time
+ * of the current profile.
+ *
+ * A request that the peer does not apply in time, or applies with other
+ * values, is a rejection: the profile is then not requested again before a
+ * back-off delay, doubled on each new rejection.
+ *
+ * The policy does not call the BLE stack nor run timers: the caller sends
+ * the requests, reports the parameters updates, and polls the policy again
+ * after the delay given by ble_conn_policy_next().
+ */
+
+/* Connection profiles, from the most to the least active */
+enum ble_conn_profile {
+	BLE_CONN_ACTIVE,
+	BLE_CONN_IDLE,
+	BLE_CONN_PROFILES,
+	BLE_CONN_UNKNOWN = BLE_CONN_PROFILES
+};
+
+/* Connection parameters, in the units of the BLE stack */
+struct ble_conn_params {
+	uint16_t interval_min;  /* 1.25ms unit */
+	uint16_t interval_max;  /* 1.25ms unit */
+	uint16_t latency;       /* connection events */
+	uint16_t timeout;       /* 10ms unit */
+};
+
+struct ble_conn_policy {
+	const struct ble_conn_params *params;   /* of each profile */
+	uint32_t connected_at;
+	uint32_t last_notify;   /* time of the last notification */
+	uint32_t notify_gap;    /* filtered time between notifications */
+	uint8_t profile;        /* profile of the link */
+	uint8_t requested;      /* profile requested, UNKNOWN if none */
+	uint32_t requested_at;
+	bool lower;             /* less activity needed than the profile */
+	uint32_t lower_since;
+	uint8_t rejects[BLE_CONN_PROFILES];
+	uint32_t retry_at[BLE_CONN_PROFILES];
+};
+
+/* Time after the connection without request, in ms */
+#define BLE_CONN_START_HOLD     5000
+/* Time to wait for the update of the parameters, in ms */
+#define BLE_CONN_REQ_TIMEOUT    5000
+/* First back-off delay of a rejected profile, in ms */
+#define BLE_CONN_BACKOFF        30000
+/* Longest back-off delay, as a shift of the first one */
+#define BLE_CONN_BACKOFF_SHIFT_MAX 4
+
+/*
+ * Start the policy of a new connection.
+ *
+ * @param params parameters of each profile
+ * @param now current time, in ms
+ * @param interval, latency parameters of the new connection
+ */
+void ble_conn_policy_init(struct ble_conn_policy *policy,
+			  const struct ble_conn_params *params, uint32_t now,
+			  uint16_t interval, uint16_t latency);
+
+/*
+ * Record a notification sent to the peer.
+ *
+ * @return 1 if the profile needed by the traffic changed and the policy is
+ *         to be polled, 0 otherwise
+ */
+int ble_conn_policy_notify(struct ble_conn_policy *policy, uint32_t now);
+
+/*
+ * Report an update of the connection parameters.
+ */
+void ble_conn_policy_updated(struct ble_conn_policy *policy, uint32_t now,
+			     uint16_t interval, uint16_t latency);
+
+/*
+ * Get the parameters to request to the peer, if any.
+ *
+ * @return 1 if req is to be sent, 0 otherwise
+ */
+int ble_conn_policy_poll(struct ble_conn_policy *policy, uint32_t now,
+			 struct ble_conn_params *req);
+
+/*
+ * Get the delay before the policy is to be polled again, without new event.
+ *
+ * @return delay in ms, 0 if the policy waits for an event
+ */
+uint32_t ble_conn_policy_next(const struct ble_conn_policy *policy,
+			      uint32_t now);
+
+#endif /* __BLE_CONN_POLICY_H__ */
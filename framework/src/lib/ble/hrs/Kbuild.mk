@@ -1 +1,2 @@
 obj-$(CONFIG_BLE_HRS_LIB) += ble_hrs.o
+obj-$(CONFIG_BLE_HRS_LIB) += ble_hrs_meas.o
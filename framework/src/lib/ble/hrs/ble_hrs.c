@@ -30,10 +30,18 @@
 
 #include "lib/ble/hrs/ble_hrs.h"
 
+#include <errno.h>
+#include <zephyr.h>
 #include <bluetooth/gatt.h>
 
+#include "os/os.h"
+#include "ble_hrs_meas.h"
+
 // for __weak
 #include "util/compiler.h"
+#ifdef CONFIG_BLE_APP_CONN_POLICY
+#include "lib/ble/ble_app.h"
+#endif
 
 /* Heart rate Service Variables */
 static struct bt_gatt_ccc_cfg hrs_measurement_ccc_cfg[1] = {};
@@ -80,19 +88,114 @@ int ble_hrs_init(void)
 				ARRAY_SIZE(hrs_attrs));
 }
 
-struct ble_hrs_measurement {
-	uint8_t flags;
-	uint8_t value;
-};
+/* Measurement values waiting for the next notification */
+static struct ble_hrs_acc hrs_acc;
+static bool hrs_pending;
+static T_TIMER hrs_timer;
+
+static int hrs_notify(void)
+{
+	uint8_t meas[BLE_HRS_MEAS_MAX_LEN];
+	uint8_t len;
+	uint32_t key = irq_lock();
+
+	len = ble_hrs_acc_encode(&hrs_acc, meas);
+	hrs_pending = hrs_acc.nb_rr != 0;
+	irq_unlock(key);
+
+#ifdef CONFIG_BLE_APP_CONN_POLICY
+	ble_app_conn_notify();
+#endif
+	return bt_gatt_notify(NULL, hrs_value, meas, len, NULL);
+}
+
+static void hrs_timer_cb(void *priv)
+{
+	/* Already sent with a full or an immediate notification */
+	if (!hrs_pending)
+		return;
+	hrs_notify();
+	/* RR-intervals left over restart the period */
+	if (hrs_pending)
+		timer_start(hrs_timer, CONFIG_BLE_HRS_NOTIF_PERIOD, NULL);
+}
+
+/* Send the pending values at the end of the notification period */
+static int hrs_schedule(void)
+{
+	uint32_t key;
+	bool start;
+
+	if (!CONFIG_BLE_HRS_NOTIF_PERIOD)
+		return hrs_notify();
+
+	if (!hrs_timer) {
+		hrs_timer = timer_create(hrs_timer_cb, NULL,
+					 CONFIG_BLE_HRS_NOTIF_PERIOD, false,
+					 false, NULL);
+		if (!hrs_timer)
+			return hrs_notify();
+	}
+	key = irq_lock();
+	start = !hrs_pending;
+	hrs_pending = true;
+	irq_unlock(key);
+	if (start)
+		timer_start(hrs_timer, CONFIG_BLE_HRS_NOTIF_PERIOD, NULL);
+	return 0;
+}
+
+static void hrs_set_meas(uint16_t hr, enum ble_hrs_contact contact)
+{
+	uint32_t key = irq_lock();
+
+	hrs_acc.hr = hr;
+	hrs_acc.flags = (hrs_acc.flags & BLE_HRS_FLAG_ENERGY) | contact;
+	irq_unlock(key);
+}
 
 int ble_hrs_update(uint8_t value)
 {
-	struct ble_hrs_measurement measurement;
+	hrs_set_meas(value, BLE_HRS_CONTACT_UNSUPPORTED);
+	return hrs_notify();
+}
+
+int ble_hrs_update_meas(uint16_t hr, enum ble_hrs_contact contact)
+{
+	hrs_set_meas(hr, contact);
+	return hrs_schedule();
+}
+
+int ble_hrs_add_rr(uint16_t rr)
+{
+	uint32_t key = irq_lock();
+	bool added;
+	bool full;
 
-	measurement.flags = 0;
-	measurement.value = value;
-	return bt_gatt_notify(NULL, hrs_value, &measurement,
-			      sizeof(measurement), NULL);
+	added = ble_hrs_acc_add_rr(&hrs_acc, rr);
+	full = hrs_acc.nb_rr >= ble_hrs_acc_rr_room(&hrs_acc);
+	irq_unlock(key);
+
+	if (!added)
+		return -ENOSPC;
+	/* A full notification is sent without waiting */
+	if (full)
+		return hrs_notify();
+	return hrs_schedule();
+}
+
+void ble_hrs_set_energy(uint16_t energy)
+{
+	uint32_t key = irq_lock();
+
+	hrs_acc.energy = energy;
+	hrs_acc.flags |= BLE_HRS_FLAG_ENERGY;
+	irq_unlock(key);
+}
+
+int ble_hrs_flush(void)
+{
+	return hrs_notify();
 }
 
 const struct bt_gatt_attr *ble_hrs_attr(void)
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+
+#include "util/misc.h"
+#include "ble_hrs_meas.h"
+
+static uint8_t *put_le16(uint8_t *p, uint16_t v)
+{
+	p[0] = v;
+	p[1] = v >> 8;
+	return p + 2;
+}
+
+uint8_t ble_hrs_acc_rr_room(const struct ble_hrs_acc *acc)
+{
+	uint8_t len = 1 + (acc->hr > UINT8_MAX ? 2 : 1);
+
+	if (acc->flags & BLE_HRS_FLAG_ENERGY)
+		len += 2;
+	return (BLE_HRS_MEAS_MAX_LEN - len) / 2;
+}
+
+bool ble_hrs_acc_add_rr(struct ble_hrs_acc *acc, uint16_t rr)
+{
+	if (acc->nb_rr >= BLE_HRS_RR_MAX)
+		return false;
+	acc->rr[acc->nb_rr++] = rr;
+	return true;
+}
+
+uint8_t ble_hrs_acc_encode(struct ble_hrs_acc *acc, uint8_t *buf)
+{
+	uint8_t nb_rr = MIN(acc->nb_rr, ble_hrs_acc_rr_room(acc));
+	uint8_t *p = &buf[1];
+	uint8_t i;
+
+	buf[0] = acc->flags;
+	if (acc->hr > UINT8_MAX) {
+		buf[0] |= BLE_HRS_FLAG_HR16;
+		p = put_le16(p, acc->hr);
+	} else {
+		*p++ = acc->hr;
+	}
+	if (acc->flags & BLE_HRS_FLAG_ENERGY)
+		p = put_le16(p, acc->energy);
+	if (nb_rr)
+		buf[0] |= BLE_HRS_FLAG_RR;
+	for (i = 0; i < nb_rr; i++)
+		p = put_le16(p, acc->rr[i]);
+
+	/* Energy is sent once, the other RR-intervals next time */
+	acc->flags &= ~BLE_HRS_FLAG_ENERGY;
+	acc->nb_rr -= nb_rr;
+	memmove(acc->rr, &acc->rr[nb_rr], acc->nb_rr * sizeof(acc->rr[0]));
+	return p - buf;
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef BLE_HRS_MEAS_H_
+#define BLE_HRS_MEAS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Heart Rate Measurement characteristic value: flags, heart rate on 8 or
+ * 16 bits, then optional energy expended (kJ) and RR-intervals (1/1024 s),
+ * all little endian.
+ */
+#define BLE_HRS_FLAG_HR16               0x01
+#define BLE_HRS_FLAG_CONTACT_DETECTED   0x02
+#define BLE_HRS_FLAG_CONTACT_SUPPORTED  0x04
+#define BLE_HRS_FLAG_ENERGY             0x08
+#define BLE_HRS_FLAG_RR                 0x10
+
+/* Largest measurement notified with the default ATT MTU (23) */
+#define BLE_HRS_MEAS_MAX_LEN 20
+
+/* Most RR-intervals in one measurement: 8 bit heart rate, no energy */
+#define BLE_HRS_RR_MAX ((BLE_HRS_MEAS_MAX_LEN - 2) / 2)
+
+/*
+ * Values accumulated until the next measurement notification. The heart
+ * rate and contact status are the latest ones; the energy expended is only
+ * sent once after each update; RR-intervals are sent oldest first, and the
+ * ones that do not fit are kept for the next notification.
+ */
+struct ble_hrs_acc {
+	uint16_t hr;
+	uint16_t energy;
+	uint8_t flags;          /* contact and energy flags */
+	uint8_t nb_rr;
+	uint16_t rr[BLE_HRS_RR_MAX];
+};
+
+/*
+ * Number of RR-intervals that fit in the next measurement.
+ */
+uint8_t ble_hrs_acc_rr_room(const struct ble_hrs_acc *acc);
+
+/*
+ * Add a RR-interval. Returns false if there is no room left: the
+ * accumulator must be encoded first.
+ */
+bool ble_hrs_acc_add_rr(struct ble_hrs_acc *acc, uint16_t rr);
+
+/*
+ * Encode the next measurement in buf (BLE_HRS_MEAS_MAX_LEN bytes), and
+ * remove the sent values from the accumulator.
+ *
+ * Returns the length of the measurement.
+ */
+uint8_t ble_hrs_acc_encode(struct ble_hrs_acc *acc, uint8_t *buf);
+
+#endif /* BLE_HRS_MEAS_H_ */
@@ -1 +1,2 @@
 obj-$(CONFIG_BLE_RSCS_LIB) += ble_rscs.o
+obj-$(CONFIG_BLE_RSCS_LIB) += ble_rscs_meas.o
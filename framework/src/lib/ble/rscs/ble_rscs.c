@@ -34,6 +34,11 @@
 #include <bluetooth/gatt.h>
 
 #include "infra/log.h"
+#include "os/os.h"
+#include "ble_rscs_meas.h"
+#ifdef CONFIG_BLE_APP_CONN_POLICY
+#include "lib/ble/ble_app.h"
+#endif
 
 /* RSC measurement characteristic */
 static struct bt_gatt_ccc_cfg rsc_measurement_ccc_cfg[1] = {};
@@ -161,56 +166,55 @@ out:
 	return err;
 }
 
-struct ble_rscs_measurement {
-	/* bit 0: stride present, bit 1: distance present, bit 2: walk/run */
-	uint8_t flags;
-	/* mandatory */
-	uint16_t speed;
-	/* mandatory */
-	uint8_t cadence;
-	/* optional: stride or distance */
-	union {
-		uint16_t stride;
-		uint32_t distance;
-	};
-	/* optional: distance if stride is present */
-	uint32_t distance_after_stride;
-} __packed;
+/* Latest measurement, waiting for the end of the notification period */
+static uint16_t rscs_speed;
+static uint8_t rscs_cadence;
+static bool rscs_pending;
+static T_TIMER rscs_timer;
+
+static int rscs_notify(void)
+{
+	uint8_t meas[BLE_RSCS_MEAS_MAX_LEN];
+	uint8_t len;
+
+	rscs_pending = false;
+	len = ble_rscs_encode(meas, rscs_speed, rscs_cadence,
+			      on_ble_rscs_get_stride_lenth(),
+			      on_ble_rscs_get_total_distance(),
+			      on_ble_rscs_get_walk_run());
+
+#ifdef CONFIG_BLE_APP_CONN_POLICY
+	ble_app_conn_notify();
+#endif
+	return bt_gatt_notify(NULL, measurement_value, meas, len, NULL);
+}
+
+static void rscs_timer_cb(void *priv)
+{
+	if (rscs_pending)
+		rscs_notify();
+}
 
 int ble_rscs_update(uint16_t speed, uint8_t cadence)
 {
-	struct ble_rscs_measurement measurement;
-	int rv;
-	uint16_t length = offsetof(struct ble_rscs_measurement, stride);
-
-	measurement.flags = 0;
-	measurement.speed = sys_cpu_to_le16(speed);
-	measurement.cadence = cadence;
-	rv = on_ble_rscs_get_stride_lenth();
-	if (rv >= 0) {
-		measurement.flags |= 1;
-		measurement.stride = sys_cpu_to_le16((uint16_t)rv);
-		length += sizeof(uint16_t);
+	rscs_speed = speed;
+	rscs_cadence = cadence;
+	if (!CONFIG_BLE_RSCS_NOTIF_PERIOD)
+		return rscs_notify();
+
+	if (!rscs_timer) {
+		rscs_timer = timer_create(rscs_timer_cb, NULL,
+					  CONFIG_BLE_RSCS_NOTIF_PERIOD, false,
+					  false, NULL);
+		if (!rscs_timer)
+			return rscs_notify();
 	}
-	rv = on_ble_rscs_get_total_distance();
-	if (rv >= 0) {
-		uint32_t distance = sys_cpu_to_le32((uint32_t)rv);
-
-		measurement.flags |= 2;
-		if (measurement.flags & 1) {
-			measurement.distance_after_stride = distance;
-		} else {
-			measurement.distance = distance;
-		}
-		length += sizeof(uint32_t);
-	}
-	rv = on_ble_rscs_get_walk_run();
-	if (rv >= 0) {
-		measurement.flags |= rv ? 4 : 0;
+	/* Following updates only replace the values to notify */
+	if (!rscs_pending) {
+		rscs_pending = true;
+		timer_start(rscs_timer, CONFIG_BLE_RSCS_NOTIF_PERIOD, NULL);
 	}
-
-	return bt_gatt_notify(NULL, measurement_value, &measurement, length,
-			      NULL);
+	return 0;
 }
 
 __weak void on_ble_rscs_enabled(void)
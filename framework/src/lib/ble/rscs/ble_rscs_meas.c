@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ble_rscs_meas.h"
+
+uint8_t ble_rscs_encode(uint8_t *buf, uint16_t speed, uint8_t cadence,
+			int stride, int distance, int walk_run)
+{
+	uint8_t *p = &buf[4];
+
+	buf[0] = 0;
+	buf[1] = speed;
+	buf[2] = speed >> 8;
+	buf[3] = cadence;
+	if (stride >= 0) {
+		buf[0] |= BLE_RSCS_FLAG_STRIDE;
+		*p++ = stride;
+		*p++ = stride >> 8;
+	}
+	if (distance >= 0) {
+		buf[0] |= BLE_RSCS_FLAG_DISTANCE;
+		*p++ = distance;
+		*p++ = distance >> 8;
+		*p++ = distance >> 16;
+		*p++ = distance >> 24;
+	}
+	if (walk_run > 0)
+		buf[0] |= BLE_RSCS_FLAG_RUNNING;
+	return p - buf;
+}
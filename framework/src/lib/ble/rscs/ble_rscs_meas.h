@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef BLE_RSCS_MEAS_H_
+#define BLE_RSCS_MEAS_H_
+
+#include <stdint.h>
+
+/*
+ * RSC Measurement characteristic value: flags, speed (1/256 m/s), cadence
+ * (1/min), then optional stride length (cm) and total distance (1/10 m),
+ * all little endian.
+ */
+#define BLE_RSCS_FLAG_STRIDE    0x01
+#define BLE_RSCS_FLAG_DISTANCE  0x02
+#define BLE_RSCS_FLAG_RUNNING   0x04
+
+#define BLE_RSCS_MEAS_MAX_LEN 10
+
+/*
+ * Encode a measurement in buf (BLE_RSCS_MEAS_MAX_LEN bytes). Negative
+ * stride, distance or walk_run values are not present.
+ *
+ * Returns the length of the measurement.
+ */
+uint8_t ble_rscs_encode(uint8_t *buf, uint16_t speed, uint8_t cadence,
+			int stride, int distance, int walk_run);
+
+#endif /* BLE_RSCS_MEAS_H_ */
@@ -93,13 +93,15 @@ void gpio_service_handler(struct cfw_message *msg, void *param)
 
 	switch (CFW_MESSAGE_ID(msg)) {
 	case MSG_ID_GPIO_SERVICE_EVT: {
-		bool state =
-			!!(((gpio_service_listen_evt_msg_t *)msg)->pin_state) ^
-			priv->active_low;
-		button_gpio_event(
-			button, state,
-			((gpio_service_listen_evt_msg_t *)msg)->
-			timestamp);
+		gpio_service_listen_evt_msg_t *evt =
+			(gpio_service_listen_evt_msg_t *)msg;
+		uint8_t i;
+
+		/* Replay all the edges, so that short presses are not lost */
+		for (i = 0; i < evt->nb_edges; i++)
+			button_gpio_event(button,
+					  evt->edges[i].state ^ priv->active_low,
+					  gpio_service_edge_ms(evt, i));
 	} break;
 
 	case MSG_ID_GPIO_SERVICE_LISTEN_RSP: {
@@ -0,0 +1 @@
+obj-$(CONFIG_STEP_DETECTOR) += step_detector.o
@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "lib/step_detector/step_detector.h"
+
+#include <string.h>
+
+#include "util/misc.h"
+
+/* Filters fixed point format */
+#define Q               4
+/* Magnitude clamp, in mg: the filters do not overflow up to it */
+#define MAG_MAX         16000
+/* Time constants of the gravity and smoothing filters, in ms */
+#define GRAVITY_TAU     1000
+#define SMOOTH_TAU      20
+/* Longest time between two samples before the filters restart, in ms */
+#define MAX_GAP         500
+/* Smallest step height and hysteresis of the zero crossings, in mg */
+#define MIN_HEIGHT      (120 << Q)
+#define MIN_HYST        (30 << Q)
+
+static uint32_t isqrt(uint32_t x)
+{
+	uint32_t res = 0;
+	uint32_t bit = 1UL << 30;
+
+	while (bit > x)
+		bit >>= 2;
+	while (bit) {
+		if (x >= res + bit) {
+			x -= res + bit;
+			res = (res >> 1) + bit;
+		} else {
+			res >>= 1;
+		}
+		bit >>= 2;
+	}
+	return res;
+}
+
+/* First order low pass coefficient for a time constant, in Q12 */
+static uint16_t alpha(uint32_t dt, uint32_t tau)
+{
+	return (dt << 12) / (tau + dt);
+}
+
+/*
+ * Time of the top of the parabola going through the samples around the
+ * peak, left, peak and right being dt apart.
+ */
+static uint32_t peak_time(int32_t left, int32_t peak, int32_t right,
+			  uint32_t t, uint32_t dt)
+{
+	int32_t den = 2 * (left - 2 * peak + right);
+
+	if (den >= 0)
+		return t;
+	return t + (int32_t)dt * (left - right) / den;
+}
+
+static int step(struct step_detector *sd, int32_t height)
+{
+	uint32_t t = sd->peak_fine_t;
+	uint32_t interval = t - sd->last_step_t;
+	int in_bout = sd->bout && interval <= STEP_MAX_INTERVAL;
+
+	if (in_bout && interval < STEP_MIN_INTERVAL)
+		return 0;
+	if (height < MAX(MIN_HEIGHT, sd->amplitude >> 1)) {
+		/* Let the threshold follow a quieter motion */
+		sd->amplitude -= sd->amplitude >> 3;
+		return 0;
+	}
+	if (sd->amplitude)
+		sd->amplitude += (height - sd->amplitude) >> 2;
+	else
+		sd->amplitude = height;
+	sd->last_step_t = t;
+
+	if (in_bout && sd->bout < STEP_BOUT_STEPS && sd->intervals_count) {
+		/* A bout starts with steps at a regular pace */
+		uint16_t last = sd->intervals[(sd->interval_idx +
+					       STEP_INTERVALS - 1) %
+					      STEP_INTERVALS];
+
+		in_bout = interval * 3 > last * 2 && interval * 2 < last * 3;
+	}
+	if (!in_bout) {
+		sd->bout = 1;
+		sd->intervals_count = 0;
+		return 0;
+	}
+	sd->intervals[sd->interval_idx] = interval;
+	sd->interval_idx = (sd->interval_idx + 1) % STEP_INTERVALS;
+	if (sd->intervals_count < STEP_INTERVALS)
+		sd->intervals_count++;
+
+	if (sd->bout < STEP_BOUT_STEPS) {
+		if (++sd->bout < STEP_BOUT_STEPS)
+			return 0;
+		sd->steps += STEP_BOUT_STEPS;
+		return STEP_BOUT_STEPS;
+	}
+	sd->steps++;
+	return 1;
+}
+
+void step_detector_init(struct step_detector *sd)
+{
+	memset(sd, 0, sizeof(*sd));
+}
+
+int step_detector_process(struct step_detector *sd, const int16_t acc[3],
+			  uint32_t t)
+{
+	uint32_t dt = t - sd->last_t;
+	int32_t mag;
+	int32_t s;
+	int32_t hyst;
+	int ret = 0;
+
+	mag = isqrt((uint32_t)((int32_t)acc[0] * acc[0]) +
+		    (uint32_t)((int32_t)acc[1] * acc[1]) +
+		    (uint32_t)((int32_t)acc[2] * acc[2]));
+	mag = MIN(mag, MAG_MAX) << Q;
+	sd->last_t = t;
+
+	if (!sd->started || dt > MAX_GAP) {
+		sd->gravity = mag;
+		sd->smooth = mag;
+		sd->prev = 0;
+		sd->above = 0;
+		sd->valley = 0;
+		sd->started = 1;
+		return 0;
+	}
+	if (dt == 0)
+		dt = 1;
+	if (dt != sd->dt) {
+		sd->dt = dt;
+		sd->gravity_alpha = alpha(dt, GRAVITY_TAU);
+		sd->smooth_alpha = alpha(dt, SMOOTH_TAU);
+	}
+	sd->smooth += ((mag - sd->smooth) * sd->smooth_alpha + 2048) >> 12;
+	sd->gravity += ((mag - sd->gravity) * sd->gravity_alpha + 2048) >> 12;
+	s = sd->smooth - sd->gravity;
+	hyst = MAX(MIN_HYST, sd->amplitude >> 3);
+
+	if (sd->above) {
+		if (s > sd->peak) {
+			sd->peak_left = sd->prev;
+			sd->peak = s;
+			sd->peak_t = t;
+			sd->peak_fine_t = t;
+		} else if (sd->peak_t == t - dt) {
+			sd->peak_fine_t = peak_time(sd->peak_left, sd->peak, s,
+						    sd->peak_t, dt);
+		}
+		if (s < -hyst) {
+			sd->above = 0;
+			ret = step(sd, sd->peak - sd->valley);
+			sd->valley = s;
+		}
+	} else {
+		if (s < sd->valley)
+			sd->valley = s;
+		if (s > hyst) {
+			sd->above = 1;
+			sd->peak_left = sd->prev;
+			sd->peak = s;
+			sd->peak_t = t;
+			sd->peak_fine_t = t;
+		}
+	}
+	sd->prev = s;
+	return ret;
+}
+
+uint16_t step_detector_cadence(const struct step_detector *sd, uint32_t now)
+{
+	uint32_t sum = 0;
+	int i;
+
+	if (sd->bout < STEP_BOUT_STEPS)
+		return 0;
+	for (i = 0; i < sd->intervals_count; i++)
+		sum += sd->intervals[i];
+	/* The bout ends when two steps are missing */
+	if (now - sd->last_step_t >
+	    MIN(STEP_MAX_INTERVAL, 2 * sum / sd->intervals_count))
+		return 0;
+	return (60000UL * sd->intervals_count + sum / 2) / sum;
+}
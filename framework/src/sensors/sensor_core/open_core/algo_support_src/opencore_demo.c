@@ -67,55 +67,55 @@ static int demo_algorithm_hold_idle(void)
 	return 0;
 }
 
+static exposed_sensor_t demo_exposed_sensor;
+
+/************
+ * the demand indexes are resolved once, when the algorithm is started,
+ * rather than for every sample.
+ ***********/
+static int demo_index_a = -1;
+static int demo_index_g = -1;
+
 /*********************
- * the callback function below is template of algorirhm's execute function
- * in case of the algorithm demanding accelerometer data.
+ * the callback function below is template of algorirhm's block execute
+ * function in case of the algorithm demanding accelerometer and gyroscope
+ * data: blocks[i] holds the frames of demand i read since the last call.
+ * As several results may come out of one block, they are reported directly.
  **********************/
-static int demo_algorithm_exec(void **sensor_data, feed_general_t *feed)
+static int demo_algorithm_exec_block(feed_block_t *blocks, feed_general_t *feed)
 {
 	int16_t accel_data[3] = { 0 };
 	int gyro_data[3] = { 0 };
-	int index_a = GetDemandIdx(feed, SENSOR_ACCELEROMETER);
-	int index_g = GetDemandIdx(feed, SENSOR_GYROSCOPE);
+	int index_a = demo_index_a;
+	int index_g = demo_index_g;
 	int result = 0;
-	int ret = 0;
 
 	if (index_a >= 0 && index_g >= 0) {
-		if (sensor_data[index_a] != NULL || sensor_data[index_g] !=
-		    NULL) {
-			int size = GetSensorDataFrameSize(
-				feed->demand[index_a].type,
-				feed->demand[index_a].id);
-			if (size > 0 && sensor_data[index_a] != NULL)
-				memcpy(&accel_data[0], sensor_data[index_a],
-				       size);
-
-			size = GetSensorDataFrameSize(
-				feed->demand[index_g].type,
-				feed->demand[index_g].id);
-			if (size > 0 && sensor_data[index_g] != NULL)
-				memcpy(&gyro_data[0], sensor_data[index_g],
-				       size);
+		feed_block_t *accel = &blocks[index_a];
+		feed_block_t *gyro = &blocks[index_g];
+		int count = accel->count > gyro->count ?
+			    accel->count : gyro->count;
+
+		for (int i = 0; i < count; i++) {
+			if (i < accel->count)
+				memcpy(&accel_data[0],
+				       accel->frames + i * accel->frame_size,
+				       sizeof(accel_data));
+			if (i < gyro->count)
+				memcpy(&gyro_data[0],
+				       gyro->frames + i * gyro->frame_size,
+				       sizeof(gyro_data));
 
 			result = demo_algorithm_process(accel_data, gyro_data);
 			if (result == 1) {
-				exposed_sensor_t *sensor = GetExposedStruct(
-					SENSOR_ALGO_DEMO, DEFAULT_ID);
-				if (sensor != NULL) {
-					struct demo_algo_result *value =
-						(struct demo_algo_result *)
-						sensor->
-						rpt_data_buf;
-					value->type = result;
-					value->ax = accel_data[0];
-					value->ay = accel_data[1];
-					value->az = accel_data[2];
-					value->gx = gyro_data[0];
-					value->gy = gyro_data[1];
-					value->gz = gyro_data[2];
-					sensor->ready_flag = 1;
-					ret++;
-				}
+				demo_rpt_buf.type = result;
+				demo_rpt_buf.ax = accel_data[0];
+				demo_rpt_buf.ay = accel_data[1];
+				demo_rpt_buf.az = accel_data[2];
+				demo_rpt_buf.gx = gyro_data[0];
+				demo_rpt_buf.gy = gyro_data[1];
+				demo_rpt_buf.gz = gyro_data[2];
+				ReportSensDataDirectly(&demo_exposed_sensor);
 			}
 		}
 	}
@@ -127,7 +127,7 @@ static int demo_algorithm_exec(void **sensor_data, feed_general_t *feed)
 		START_IDLE(feed);
 	}
 
-	return ret;
+	return 0;
 }
 
 /***********************
@@ -135,6 +135,8 @@ static int demo_algorithm_exec(void **sensor_data, feed_general_t *feed)
  **********************/
 static int demo_algorithm_init(feed_general_t *feed_ptr)
 {
+	demo_index_a = GetDemandIdx(feed_ptr, SENSOR_ACCELEROMETER);
+	demo_index_g = GetDemandIdx(feed_ptr, SENSOR_GYROSCOPE);
 	return 0;
 }
 
@@ -206,7 +208,7 @@ sensor_data_demand_t basic_algo_demo_demand[] = {
  * 2. demand: describe what physical sensor data to demand in the basic_algo.
  * 3. demand_length: count of demand array.
  * 4. ctl_api: consist of the api what are used to control the basic_algo,
- *      such as init, exex, goto_idle and out_idle
+ *      such as init, exec (or exec_block), goto_idle and out_idle
  * 5. <define_feedinit> is used to make out the feed list in opencore.
  *******************************/
 static feed_general_t demo_algo = {
@@ -217,7 +219,7 @@ static feed_general_t demo_algo = {
 	.ctl_api = {
 		.init = demo_algorithm_init,
 		.deinit = demo_algorithm_deinit,
-		.exec = demo_algorithm_exec,
+		.exec_block = demo_algorithm_exec_block,
 		.goto_idle = demo_algorithm_goto_idle,
 		.out_idle = demo_algorithm_out_idle,
 	},
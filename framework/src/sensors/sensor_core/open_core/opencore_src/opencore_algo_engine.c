@@ -37,6 +37,7 @@
 static char commit_buf[sizeof(struct ia_cmd)
 		+ sizeof(struct sensor_data)
 		+ COMMIT_DATA_MAX_LENGTH]__attribute__((section(".dccm")));
+static uint8_t block_buf[BLOCK_BUFFER_SIZE]__attribute__((section(".dccm")));
 static uint16_t algo_engine_port;
 extern uint8_t read_out_fifo_flag;
 
@@ -63,19 +64,47 @@ void OpencoreCommitSensData(uint8_t type, uint8_t id, void* data_ptr, int data_l
 	}
 }
 
+static void CommitReadySensData(void)
+{
+	for(list_t* next = exposed_sensor_list.head; next != NULL; next = next->next){
+		exposed_sensor_t* exposed_sensor = (exposed_sensor_t*)next;
+		if(exposed_sensor->ready_flag != 0){
+			OpencoreCommitSensData(exposed_sensor->type, exposed_sensor->id,
+				exposed_sensor->rpt_data_buf, exposed_sensor->rpt_data_buf_len);
+			exposed_sensor->ready_flag = 0;
+		}
+	}
+}
+
+static void HandleAlgoBlock(feed_general_t* feed, feed_block_t* blocks)
+{
+	if(feed->ctl_api.exec_block(blocks, feed) != 0)
+		CommitReadySensData();
+}
+
 static void HandleAlgo(feed_general_t* feed, void** data_ptr)
 {
-	int ret = feed->ctl_api.exec(data_ptr, feed);
-	if(ret != 0){
-		for(list_t* next = exposed_sensor_list.head; next != NULL; next = next->next){
-			exposed_sensor_t* exposed_sensor = (exposed_sensor_t*)next;
-			if(exposed_sensor->ready_flag != 0){
-				OpencoreCommitSensData(exposed_sensor->type, exposed_sensor->id,
-					exposed_sensor->rpt_data_buf, exposed_sensor->rpt_data_buf_len);
-				exposed_sensor->ready_flag = 0;
-			}
+	if(feed->ctl_api.exec == NULL){
+		//block only feed: one frame per block
+		feed_block_t blocks[feed->demand_length];
+		uint32_t now = get_uptime_ms();
+		memset(blocks, 0, sizeof(blocks));
+		for(int i = 0; i < feed->demand_length; i++){
+			sensor_handle_t* phy_sensor = GetDemandPhySensor(feed, i);
+			if(data_ptr[i] == NULL || phy_sensor == NULL)
+				continue;
+			blocks[i].frames = data_ptr[i];
+			blocks[i].count = 1;
+			blocks[i].frame_size = phy_sensor->sensor_data_frame_size;
+			blocks[i].timestamp = now;
+			blocks[i].interval = 10000 / feed->demand[i].freq;
 		}
+		HandleAlgoBlock(feed, blocks);
+		return;
 	}
+
+	if(feed->ctl_api.exec(data_ptr, feed) != 0)
+		CommitReadySensData();
 }
 
 static void AddCaliData(uint8_t phy_type, sensor_handle_t* phy_sensor, void* ptr_from)
@@ -101,6 +130,62 @@ static void AddCaliData(uint8_t phy_type, sensor_handle_t* phy_sensor, void* ptr
 	}
 }
 
+/*
+ * All demands at the same frequency: hand the matched frames in blocks,
+ * split where a match buffer wraps around.
+ */
+static void HandleMatchBufferBlock(feed_general_t* feed, int length)
+{
+	sensor_data_demand_t* demand = feed->demand;
+	uint8_t demand_length = feed->demand_length;
+
+	while(length > 0){
+		feed_block_t blocks[demand_length];
+		sensor_handle_t* phy_sensor[demand_length];
+		int chunk = length;
+		int act = 0;
+
+		for(int i = 0; i < demand_length; i++){
+			phy_sensor[i] = NULL;
+			if(demand[i].freq == 0 || demand[i].match_buffer == NULL)
+				continue;
+			phy_sensor[i] = GetDemandPhySensor(feed, i);
+			if(phy_sensor[i] == NULL)
+				continue;
+			if(chunk > demand[i].match_data_count)
+				chunk = demand[i].match_data_count;
+			if(chunk > demand[i].match_buffer_repo - demand[i].get_idx)
+				chunk = demand[i].match_buffer_repo - demand[i].get_idx;
+			act++;
+		}
+		if(act == 0 || chunk <= 0)
+			break;
+
+		memset(blocks, 0, sizeof(blocks));
+		for(int i = 0; i < demand_length; i++){
+			if(phy_sensor[i] == NULL)
+				continue;
+			int frame_size = phy_sensor[i]->sensor_data_frame_size;
+			void* ptr_from = demand[i].match_buffer + frame_size * demand[i].get_idx;
+			//add the calibration offset value
+			for(int k = 0; k < chunk; k++)
+				AddCaliData(demand[i].type, phy_sensor[i], ptr_from + k * frame_size);
+			blocks[i].frames = ptr_from;
+			blocks[i].count = chunk;
+			blocks[i].frame_size = frame_size;
+			blocks[i].timestamp = demand[i].timestamp
+				- (demand[i].match_data_count - 1) * 1000 / demand[i].freq;
+			blocks[i].interval = 10000 / demand[i].freq;
+			demand[i].get_idx += chunk;
+			demand[i].match_data_count -= chunk;
+			if(demand[i].get_idx >= demand[i].match_buffer_repo)
+				demand[i].get_idx = 0;
+		}
+		HandleAlgoBlock(feed, blocks);
+		length -= chunk;
+	}
+}
+
 static void HandleMatchBufferData(feed_general_t* feed)
 {
 	sensor_data_demand_t* demand = feed->demand;
@@ -152,6 +237,17 @@ static void HandleMatchBufferData(feed_general_t* feed)
 				vernier_length = count * scale[i];
 		}
 
+		if(feed->ctl_api.exec_block != NULL){
+			int uniform = 1;
+			for(int i = 0; i < demand_length; i++)
+				if(demand[i].freq != 0 && scale[i] != 1)
+					uniform = 0;
+			if(uniform != 0){
+				HandleMatchBufferBlock(feed, vernier_length);
+				return;
+			}
+		}
+
 		for(int v = 0; v < vernier_length; v++){
 			void* ptr[demand_length];
 			memset(ptr, 0, sizeof(ptr));
@@ -159,7 +255,7 @@ static void HandleMatchBufferData(feed_general_t* feed)
 			for(int i = 0; i < demand_length; i++){
 				if(demand[i].freq == 0)
 					continue;
-				sensor_handle_t* phy_sensor = GetActivePollSensStruct(demand[i].type, demand[i].id);
+				sensor_handle_t* phy_sensor = GetDemandPhySensor(feed, i);
 				if(phy_sensor != NULL && scale[i] != 0 && demand[i].match_buffer != NULL){
 					if(v % scale[i] == 0 && demand[i].get_idx != demand[i].put_idx){
 						void* ptr_from = demand[i].match_buffer
@@ -176,12 +272,50 @@ static void HandleMatchBufferData(feed_general_t* feed)
 				}
 			}
 
-			if(act != 0 && feed->ctl_api.exec != NULL)
+			if(act != 0 && HAS_EXEC(feed))
 				HandleAlgo(feed, ptr);
 		}
 	}
 }
 
+/*
+ * Hand the frames of a raw data node to exec_block, through block_buf:
+ * the node is shared with the other feeds, so the calibration offset is
+ * added to a copy. Returns the number of frames.
+ */
+static int FeedBlockDirectly(feed_general_t* feed, int i, sensor_handle_t* phy_sensor,
+				raw_data_node_t* raw_data, int gap)
+{
+	sensor_data_demand_t* demand = &feed->demand[i];
+	int frame_size = phy_sensor->sensor_data_frame_size;
+	int max_count = sizeof(block_buf) / frame_size;
+	feed_block_t blocks[feed->demand_length];
+	feed_block_t* block = &blocks[i];
+	int count;
+
+	memset(blocks, 0, sizeof(blocks));
+	block->frames = block_buf;
+	block->frame_size = frame_size;
+	block->interval = 10000 / demand->freq;
+	for(count = 0; gap * count + demand->raw_data_offset < raw_data->raw_data_count; count++){
+		int idx = gap * count + demand->raw_data_offset;
+		void* ptr_to = block_buf + block->count * frame_size;
+		if(block->count == 0)
+			block->timestamp = raw_data->timestamp
+				- (raw_data->raw_data_count - 1 - idx) * 10000 / phy_sensor->freq;
+		memcpy(ptr_to, raw_data->buffer + idx * frame_size, frame_size);
+		//add cali offset
+		AddCaliData(demand->type, phy_sensor, ptr_to);
+		if(++block->count == max_count){
+			HandleAlgoBlock(feed, blocks);
+			block->count = 0;
+		}
+	}
+	if(block->count != 0)
+		HandleAlgoBlock(feed, blocks);
+	return count;
+}
+
 static void FeedSensDataDirectly(feed_general_t* feed)
 {
 	sensor_data_demand_t* demand = feed->demand;
@@ -189,7 +323,7 @@ static void FeedSensDataDirectly(feed_general_t* feed)
 	for(int i = 0; i < demand_length; i++){
 		if(demand[i].freq == 0)
 			continue;
-		sensor_handle_t* phy_sensor = GetActivePollSensStruct(demand[i].type, demand[i].id);
+		sensor_handle_t* phy_sensor = GetDemandPhySensor(feed, i);
 		if(phy_sensor != NULL){
 			list_t* node = phy_sensor->raw_data_head[phy_sensor->head_for_algo].head;
 			while(node != NULL){
@@ -204,15 +338,19 @@ static void FeedSensDataDirectly(feed_general_t* feed)
 				void* ptr[demand_length];
 				memset(ptr, 0, sizeof(ptr));
 
-				for(count = 0; gap * count + demand[i].raw_data_offset < raw_sensor_data_count; count++){
-					int idx = gap * count + demand[i].raw_data_offset;
-					void* ptr_from = phy_sensor->feed_data_buffer;
-					memcpy(ptr_from, buffer + idx * frame_size, frame_size);
-					//add cali offset
-					AddCaliData(demand[i].type, phy_sensor, ptr_from);
-					ptr[i] = ptr_from;
-					if(feed->ctl_api.exec != NULL)
-						HandleAlgo(feed, ptr);
+				if(feed->ctl_api.exec_block != NULL){
+					count = FeedBlockDirectly(feed, i, phy_sensor, raw_data, gap);
+				}else{
+					for(count = 0; gap * count + demand[i].raw_data_offset < raw_sensor_data_count; count++){
+						int idx = gap * count + demand[i].raw_data_offset;
+						void* ptr_from = phy_sensor->feed_data_buffer;
+						memcpy(ptr_from, buffer + idx * frame_size, frame_size);
+						//add cali offset
+						AddCaliData(demand[i].type, phy_sensor, ptr_from);
+						ptr[i] = ptr_from;
+						if(feed->ctl_api.exec != NULL)
+							HandleAlgo(feed, ptr);
+					}
 				}
 				demand[i].raw_data_offset = gap - (raw_sensor_data_count
 					- (gap * (count - 1) + demand[i].raw_data_offset));
@@ -263,7 +401,7 @@ static void FeedSensDataAfterMatch(feed_general_t* feed, match_t type)
 	for(int i = 0; i < demand_length; i++){
 		if(demand[i].freq == 0)
 			continue;
-		sensor_handle_t* phy_sensor = GetActivePollSensStruct(demand[i].type, demand[i].id);
+		sensor_handle_t* phy_sensor = GetDemandPhySensor(feed, i);
 		if(phy_sensor != NULL)
 			//get raw data node
 			node[i] = phy_sensor->raw_data_head[phy_sensor->head_for_algo].head;
@@ -275,7 +413,7 @@ static void FeedSensDataAfterMatch(feed_general_t* feed, match_t type)
 		for(int i = 0; i < demand_length; i++){
 			if(demand[i].freq == 0)
 				continue;
-			sensor_handle_t* phy_sensor = GetActivePollSensStruct(demand[i].type, demand[i].id);
+			sensor_handle_t* phy_sensor = GetDemandPhySensor(feed, i);
 			if ((phy_sensor != NULL) && (node[i] != NULL)) {
 				raw_data_node_t* raw_data = (raw_data_node_t*)((void*)node[i] - offsetof(raw_data_node_t, raw_data_node));
 				uint16_t raw_sensor_data_count = raw_data->raw_data_count;
@@ -284,10 +422,17 @@ static void FeedSensDataAfterMatch(feed_general_t* feed, match_t type)
 
 				if(type == SYNC){
 					int	target_count = cm_time_consume / ValueRound((float)1000 / demand[i].freq);
+					//block feed: match as many frames as the buffer holds
+					if(feed->ctl_api.exec_block != NULL && demand[i].match_buffer_repo > target_count)
+						target_count *= (demand[i].match_buffer_repo - 1) / target_count;
 					for(; gap * count[i] + demand[i].raw_data_offset < raw_sensor_data_count
 							&& demand[i].match_data_count < target_count; count[i]++){
 						CopySensorData2DelayBuf(&demand[i], buffer, gap, count[i], phy_sensor->sensor_data_frame_size);
 					}
+					//time of the last frame copied
+					if(count[i] > 0)
+						demand[i].timestamp = raw_data->timestamp - (raw_sensor_data_count - 1
+							- (gap * (count[i] - 1) + demand[i].raw_data_offset)) * 10000 / phy_sensor->freq;
 					if(gap * count[i] + demand[i].raw_data_offset >= raw_sensor_data_count){
 						demand[i].raw_data_offset = gap - (raw_sensor_data_count
 							- (gap * (count[i] - 1) + demand[i].raw_data_offset));
@@ -300,6 +445,7 @@ static void FeedSensDataAfterMatch(feed_general_t* feed, match_t type)
 						< raw_sensor_data_count; count++){
 						CopySensorData2DelayBuf(&demand[i], buffer, gap, count, phy_sensor->sensor_data_frame_size);
 					}
+					demand[i].timestamp = raw_data->timestamp;
 
 					demand[i].raw_data_offset = gap - (raw_sensor_data_count
 						- (gap * (count - 1) + demand[i].raw_data_offset));
@@ -311,8 +457,12 @@ static void FeedSensDataAfterMatch(feed_general_t* feed, match_t type)
 
 		if(defect == d_valid_cnt && type == ASYNC)
 			break;
-		if(defect > 0 && type == SYNC)
+		if(defect > 0 && type == SYNC){
+			//don't hold the frames of a block feed until the next read
+			if(feed->ctl_api.exec_block != NULL)
+				HandleMatchBufferData(feed);
 			break;
+		}
 
 		HandleMatchBufferData(feed);
 	}
@@ -401,6 +551,7 @@ static int ReadFifo(sensor_handle_t* phy_sensor, int* fifo_clear)
 				if(node != NULL){
 					node->buffer = phy_sensor_node->buffer;
 					node->raw_data_count = ret / phy_sensor_node->sensor_data_frame_size;
+					node->timestamp = get_uptime_ms();
 					uint8_t head_for_raw = phy_sensor_node->head_for_algo == 0 ? 1 : 0;
 					list_add(&phy_sensor_node->raw_data_head[head_for_raw], &node->raw_data_node);
 				}else{
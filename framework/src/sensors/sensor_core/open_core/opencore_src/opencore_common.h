@@ -101,6 +101,7 @@ typedef struct {
 	list_t raw_data_node;
 	void *buffer;
 	uint16_t raw_data_count;
+	uint32_t timestamp;	//read time of the last frame, in ms
 }raw_data_node_t;
 
 struct poll_links {
@@ -150,8 +151,20 @@ typedef struct {
 	uint8_t fifo_share_read_sync_done : 1;
 }sensor_handle_t;
 
+#define DSS_POOL_CLASSES 4
+
+//usage of one slot size of the raw data pool in DCCM
+typedef struct {
+	uint16_t size;		//slot size in bytes
+	uint8_t count;		//slots in the pool
+	uint8_t used;		//slots currently allocated
+	uint8_t peak;		//high-water mark of allocated slots
+	uint16_t fail;		//requests of this size class that found no free slot
+}dss_pool_stat_t;
+
 void *AllocFromDss(uint32_t size);
 int FreeInDss(void *buf);
+int GetDssPoolStat(dss_pool_stat_t *stat, int count);
 
 DEFINE_LOG_MODULE(LOG_MODULE_OPEN_CORE, "OCOR")
 
@@ -123,6 +123,7 @@ static int SensorCoreProcess(int* poll_timeout)
 							memcpy(buffer, phy_sensor->buffer, ret);
 							node->buffer = buffer;
 							node->raw_data_count = ret / phy_sensor->sensor_data_frame_size;
+							node->timestamp = get_uptime_ms();
 							uint8_t head_for_raw = phy_sensor->head_for_algo == 0 ? 1 : 0;
 							list_add(&phy_sensor->raw_data_head[head_for_raw], &node->raw_data_node);
 						}else{
@@ -924,6 +925,7 @@ static struct ia_cmd* ParseCmd(struct ia_cmd* inbound)
 					if(node != NULL && buffer != NULL){
 						node->buffer = buffer;
 						node->raw_data_count = sensor_data->data_length / phy_sensor->sensor_data_frame_size;
+						node->timestamp = sensor_data->timestamp;
 						memcpy(buffer, sensor_data->data, sensor_data->data_length);
 						list_add(&phy_sensor->raw_data_head, &node->raw_data_node);
 					}else{
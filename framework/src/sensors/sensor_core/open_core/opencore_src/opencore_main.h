@@ -46,6 +46,9 @@
 #define VALID_FRAME_LENGTH      6
 #define RAW_FRAME_LENGTH        7
 #define FIFO_NOT_CLEAR 1
+#define BLOCK_BUFFER_SIZE 256
+
+#define HAS_EXEC(feed) ((feed)->ctl_api.exec != NULL || (feed)->ctl_api.exec_block != NULL)
 
 typedef enum {
 	ALGO_OPEN = 0,
@@ -151,6 +151,26 @@ int GetSensorDataFrameSize(uint8_t type, uint8_t id)
 	return -1;
 }
 
+void BindFeeds(void)
+{
+	for (list_t *next = feed_list.head; next != NULL; next = next->next) {
+		feed_general_t *feed = (feed_general_t *)next;
+
+		for (int i = 0; i < feed->demand_length; i++) {
+			feed_binding_t *binding = &feed->binding[i];
+			sensor_handle_t *phy_sensor =
+				GetActivePollSensStruct(feed->demand[i].type,
+							feed->demand[i].id);
+
+			binding->phy_sensor = phy_sensor;
+			binding->frame_size = phy_sensor != NULL ?
+					      phy_sensor->sensor_data_frame_size : 0;
+			binding->exposed = GetExposedStruct(feed->demand[i].type,
+							    feed->demand[i].id);
+		}
+	}
+}
+
 uint16_t GetSensSamplingTime(sensor_handle_t *phy_sensor)
 {
 	uint16_t odr = 0;
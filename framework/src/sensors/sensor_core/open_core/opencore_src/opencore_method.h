@@ -48,6 +48,14 @@ sensor_handle_t *GetPollSensStruct(uint8_t type, uint8_t id);
 
 int GetSensorDataFrameSize(uint8_t type, uint8_t id);
 
+/* Active physical sensor of a demand, from the feed binding */
+static inline sensor_handle_t *GetDemandPhySensor(feed_general_t *feed, int idx)
+{
+	return (sensor_handle_t *)feed->binding[idx].phy_sensor;
+}
+
+void BindFeeds(void);
+
 uint16_t GetSensSamplingTime(sensor_handle_t *phy_sensor);
 
 uint16_t SetSensSamplingTime(sensor_handle_t *phy_sensor, uint16_t odr_x10);
@@ -43,10 +43,11 @@ static int sensor_rawdata_prepare_exec(void** sensor_data, feed_general_t* feed)
 	int ret = 0;
 	for(int i = 0; i < feed->demand_length; i++){
 		void* data = sensor_data[i];
-		exposed_sensor_t* exposed_sensor =
-			GetExposedStruct(feed->demand[i].type, feed->demand[i].id);
-		sensor_handle_t* phy_sensor = GetActivePollSensStruct(feed->demand[i].type, feed->demand[i].id);
-		if(phy_sensor != NULL && data != NULL && exposed_sensor != NULL){
+		if(data == NULL)
+			continue;
+		exposed_sensor_t* exposed_sensor = GetDemandExposed(feed, i);
+		sensor_handle_t* phy_sensor = GetDemandPhySensor(feed, i);
+		if(phy_sensor != NULL && exposed_sensor != NULL){
 			int cnt = exposed_sensor->data_frame_count;
 			memcpy(exposed_sensor->rpt_data_buf + cnt * phy_sensor->sensor_data_frame_size, data, phy_sensor->sensor_data_frame_size);
 			exposed_sensor->data_frame_count++;
@@ -146,8 +147,7 @@ static int sensor_rawdata_prepare_reset(feed_general_t* feed)
 {
 	int act = 0;
 	for(int i = 0; i < feed->demand_length; i++){
-		exposed_sensor_t* exposed_sensor =
-			GetExposedStruct(feed->demand[i].type, feed->demand[i].id);
+		exposed_sensor_t* exposed_sensor = GetDemandExposed(feed, i);
 		sensor_handle_t* phy_sensor = GetPollSensStruct(feed->demand[i].type, feed->demand[i].id);
 		if (exposed_sensor == NULL || phy_sensor == NULL)
 			continue;
@@ -187,8 +187,7 @@ static int sensor_rawdata_prepare_goto_idle(feed_general_t* feed)
 {
 	for(int i = 0; i < feed->demand_length; i++){
 		if(feed->demand[i].freq != 0){
-			exposed_sensor_t* exposed_sensor =
-				GetExposedStruct(feed->demand[i].type, feed->demand[i].id);
+			exposed_sensor_t* exposed_sensor = GetDemandExposed(feed, i);
 			if (!exposed_sensor)
 				continue;
 			exposed_sensor->data_frame_count = 0;
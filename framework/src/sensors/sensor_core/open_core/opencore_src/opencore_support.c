@@ -65,9 +65,17 @@ static volatile uint8_t buf_mask_256;
 static volatile uint8_t buf_mask_512;
 static volatile uint8_t buf_mask_1024;
 
+//slot usage of each pool, indexed 64/128/512/1024
+static const uint16_t dss_slot_size[DSS_POOL_CLASSES] = {64, 128, 512, 1024};
+static const uint8_t dss_slot_count[DSS_POOL_CLASSES] = {BUF_CNT_64, BUF_CNT_128, BUF_CNT_512, BUF_CNT_1024};
+static uint8_t dss_used[DSS_POOL_CLASSES];
+static uint8_t dss_peak[DSS_POOL_CLASSES];
+static uint16_t dss_fail[DSS_POOL_CLASSES];
+
 void* AllocFromDss(uint32_t size)
 {
 	void* ptr = NULL;
+	int pool = -1;
 	void* start = (void*)&buffer_for_raw_sensor_data[0];
 	uint32_t key = irq_lock();
 	if(size <= 64 && buf_mask_64 != (1 << BUF_CNT_64) - 1){
@@ -75,6 +83,7 @@ void* AllocFromDss(uint32_t size)
 			if((buf_mask_64 & (1 << i)) == 0){
 				ptr = start + 64*i;
 				buf_mask_64 |= 1 << i;
+				pool = 0;
 				break;
 			}
 		}
@@ -83,6 +92,7 @@ void* AllocFromDss(uint32_t size)
 			if((buf_mask_128 & (1 << i)) == 0){
 				ptr = start + 64*BUF_CNT_64 + 128*i;
 				buf_mask_128 |= 1 << i;
+				pool = 1;
 				break;
 			}
 		}
@@ -91,6 +101,7 @@ void* AllocFromDss(uint32_t size)
 			if((buf_mask_512 & (1 << i)) == 0){
 				ptr = start + 64*BUF_CNT_64 + 128*BUF_CNT_128 + 512*i;
 				buf_mask_512 |= 1 << i;
+				pool = 2;
 				break;
 			}
 		}
@@ -99,11 +110,18 @@ void* AllocFromDss(uint32_t size)
 			if((buf_mask_1024 & (1 << i)) == 0){
 				ptr = start + 64*BUF_CNT_64 + 128*BUF_CNT_128 + 512*BUF_CNT_512 + 1024*i;
 				buf_mask_1024 |= 1 << i;
+				pool = 3;
 				break;
 			}
 		}
 	}
 
+	if(pool >= 0){
+		if(++dss_used[pool] > dss_peak[pool])
+			dss_peak[pool] = dss_used[pool];
+	}else{
+		dss_fail[size <= 64 ? 0 : size <= 128 ? 1 : size <= 512 ? 2 : 3]++;
+	}
 	irq_unlock(key);
 	return ptr;
 }
@@ -111,12 +129,14 @@ void* AllocFromDss(uint32_t size)
 int FreeInDss(void* buf)
 {
 	int ret = -1;
+	int pool = -1;
 	void* start = (void*)&buffer_for_raw_sensor_data[0];
 	uint32_t key = irq_lock();
 	if(buf < start + 64*BUF_CNT_64){
 		for(int i = 0; i < BUF_CNT_64; i++){
 			if(buf == start + 64*i){
 				buf_mask_64 &= ~(1<<i);
+				pool = 0;
 				ret = 0;
 				break;
 			}
@@ -125,6 +145,7 @@ int FreeInDss(void* buf)
 		for(int i = 0; i < BUF_CNT_128; i++){
 			if(buf == start + 64*BUF_CNT_64 + 128*i){
 				buf_mask_128 &= ~(1<<i);
+				pool = 1;
 				ret = 0;
 				break;
 			}
@@ -133,6 +154,7 @@ int FreeInDss(void* buf)
 		for(int i = 0; i < BUF_CNT_512; i++){
 			if(buf == start + 64*BUF_CNT_64 + 128*BUF_CNT_128 + 512*i){
 				buf_mask_512 &= ~(1<<i);
+				pool = 2;
 				ret = 0;
 				break;
 			}
@@ -141,16 +163,34 @@ int FreeInDss(void* buf)
 		for(int i = 0; i < BUF_CNT_1024; i++){
 			if(buf == start + 64*BUF_CNT_64 + 128*BUF_CNT_128 + 512*BUF_CNT_512 + 1024*i){
 				buf_mask_1024 &= ~(1<<i);
+				pool = 3;
 				ret = 0;
 				break;
 			}
 		}
 	}
 
+	if(pool >= 0)
+		dss_used[pool]--;
 	irq_unlock(key);
 	return ret;
 }
 
+int GetDssPoolStat(dss_pool_stat_t* stat, int count)
+{
+	int i;
+	uint32_t key = irq_lock();
+	for(i = 0; i < count && i < DSS_POOL_CLASSES; i++){
+		stat[i].size = dss_slot_size[i];
+		stat[i].count = dss_slot_count[i];
+		stat[i].used = dss_used[i];
+		stat[i].peak = dss_peak[i];
+		stat[i].fail = dss_fail[i];
+	}
+	irq_unlock(key);
+	return i;
+}
+
 static uint16_t MatchFreq(sensor_handle_t* phy_sensor, uint16_t freq)
 {
 	uint16_t final_freq = 1;
@@ -295,7 +335,7 @@ int CheckMinDelayBuffer(feed_general_t* feed)
 			continue;
 		if((demand[i].flag & IGNORE) != 0)
 			continue;
-		sensor_handle_t* phy_sensor = GetActivePollSensStruct(demand[i].type, demand[i].id);
+		sensor_handle_t* phy_sensor = GetDemandPhySensor(feed, i);
 		if(phy_sensor != NULL){
 			if(equal_pi == 0){
 				equal_pi = phy_sensor->pi;
@@ -398,6 +438,9 @@ void RefleshSensorCore(void)
 		}
 	}
 
+	//active phy_sensors are known: resolve the demands of every feed
+	BindFeeds();
+
 	for(list_t* next = phy_sensor_list_poll.head; next != NULL; next = next->next){
 		sensor_handle_t* phy_sensor = (sensor_handle_t*)((void*)next - offsetof(sensor_handle_t, links.poll.poll_link));
 		if((phy_sensor->stat_flag & ON) == 0 && phy_sensor->dirty != 0){
@@ -594,6 +637,10 @@ void RefleshSensorCore(void)
 					int count = 0;
 					if((demand[i].flag & IGNORE) == 0){
 						count = (max_time_consume + cm_time_consume) / d_si;
+						//block feed: batch up to the buffer limit
+						if(feed->ctl_api.exec_block != NULL && min_check_ret == 0
+							&& count < d_min_buf_limit_pi / d_si)
+							count = d_min_buf_limit_pi / d_si;
 					}else{
 						count = d_si / phy_sensor->pi + 1;
 					}
@@ -908,6 +955,7 @@ out:
 	if(demand_ptr == NULL)
 		return;
 
+	memset(demand_ptr, 0, sizeof(sensor_data_demand_t) * count);
 	atlsp_algoC.demand = demand_ptr;
 	atlsp_algoC.demand_length = count;
 
@@ -921,6 +969,7 @@ out:
 		if(exposed_sensor == NULL)
 			continue;
 
+		memset(exposed_sensor, 0, sizeof(exposed_sensor_t));
 		exposed_sensor->depend_flag = 1 << BASIC_ALGO_RAWDATA;
 		exposed_sensor->type = phy_sensor->type;
 		exposed_sensor->id = phy_sensor->id;
@@ -998,6 +1047,10 @@ static void FeedInit(void)
 			}
 		}
 
+		//balloc panics rather than returning NULL
+		if(feed->demand_length > 0)
+			feed->binding = balloc(sizeof(feed_binding_t) * feed->demand_length, NULL);
+
 		if(feed->type != (uint8_t)BASIC_ALGO_OHRM)
 			list_add(&feed_list, (list_t*)feed);
 		else
@@ -28,6 +28,8 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <string.h>
+
 #include "cfw/cfw_service.h"
 
 #include "machine.h"
@@ -37,6 +39,7 @@
 #include "infra/device.h"
 #include "infra/log.h"
 #include "infra/time.h"
+#include "util/misc.h"
 #include "services/adc_service/adc_service.h"
 #include "adc_service_private.h"
 
@@ -62,6 +65,43 @@ typedef struct adc_tracked_gpio_list_ {
 
 list_head_t adc_gpio_tracked_list;
 
+/**
+ * \brief adc scan subscription
+ */
+typedef struct adc_scan_client {
+	list_t list;                                            /*!< Linking stucture */
+	cfw_service_conn_t *conn;                               /*!< Client connection */
+	void *priv;                                             /*!< Priv data from client */
+	adc_service_scan_cfg_t cfg;                             /*!< Subscription configuration */
+	uint8_t index[ADC_SERVICE_SCAN_MAX_CHANNELS];           /*!< Position of each channel in the scan */
+	uint16_t decimation;                                    /*!< Scans per sample */
+	uint16_t nb_scans;                                      /*!< Scans accumulated for the next sample */
+	uint32_t sum[ADC_SERVICE_SCAN_MAX_CHANNELS];            /*!< Accumulated values for the next sample */
+	adc_service_scan_evt_msg_t *evt;                        /*!< Batch being filled */
+} adc_scan_client_t;
+
+/**
+ * \brief channels, GPIOs and timings of the shared scan
+ */
+typedef struct adc_scan_set {
+	uint8_t channels[ADC_SCAN_MAX_CHANNELS];
+	uint8_t gpio_pins[ADC_SCAN_MAX_CHANNELS];
+	bool gpio_active_high[ADC_SCAN_MAX_CHANNELS];
+	uint8_t nb_channels;
+	uint8_t nb_gpios;
+	uint16_t settle_time;
+	uint32_t period;
+} adc_scan_set_t;
+
+static struct {
+	list_head_t clients;    /*!< adc_scan_client_t list */
+	adc_scan_set_t set;     /*!< Current scan configuration */
+	adc_scan_set_t active;  /*!< GPIOs activated for the pending scan */
+	T_TIMER timer;          /*!< Scan timer */
+	bool settling;          /*!< GPIOs are active, next timeout is the scan */
+	uint32_t nb_scans;      /*!< Scans done since boot */
+} adc_scan;
+
 static void adc_handle_message(struct cfw_message *msg, void *param);
 static void adc_client_connected(conn_handle_t *instance);
 static void adc_client_disconnected(conn_handle_t *instance);
@@ -73,6 +113,7 @@ static void *adc_service_subscribe_request(cfw_service_conn_t *c,
 					   uint32_t time2,
 					   void *priv);
 static inline void adc_svc_ss_adc_read(adc_service_request_t *adc_svc_req);
+static void adc_scan_timer_handler(void *priv_data);
 
 static struct td_device *adc_dev;
 static struct td_device *ss_dev;
@@ -85,8 +126,11 @@ static service_t adc_service = {
 
 static void adc_service_init(int id, void *queue)
 {
+	BUILD_BUG_ON(ADC_SERVICE_SCAN_MAX_CHANNELS > ADC_SCAN_MAX_CHANNELS);
+
 	adc_dev = &pf_device_ss_adc;
 	list_init(&adc_gpio_tracked_list);
+	list_init(&adc_scan.clients);
 	cfw_register_service(queue, &adc_service, adc_handle_message, NULL);
 }
 
@@ -216,6 +260,369 @@ out:
 	cfw_msg_free(msg);
 }
 
+/*******************************************************************************
+ *************************** SCAN SUBSCRIPTIONS ********************************
+ ******************************************************************************/
+
+/* Return the SS GPIO port of a pin and convert the pin to a port bit */
+static struct td_device *adc_scan_gpio_port(uint8_t *pin)
+{
+	if (*pin < SS_GPIO_8B0_BITS)
+		return &pf_device_ss_gpio_8b0;
+	*pin -= SS_GPIO_8B0_BITS;
+	return &pf_device_ss_gpio_8b1;
+}
+
+/* Configure a load switch GPIO for one more scan client */
+static void adc_scan_gpio_get(uint8_t pin)
+{
+	struct td_device *dev = adc_scan_gpio_port(&pin);
+	gpio_cfg_data_t out_pin_cfg =
+	{ .gpio_type = GPIO_OUTPUT, .int_type = EDGE,
+	  .int_polarity = ACTIVE_LOW,
+	  .int_debounce = DEBOUNCE_OFF,
+	  .int_ls_sync = LS_SYNC_OFF,
+	  .gpio_cb = NULL,
+	  .gpio_cb_arg = NULL, };
+	adc_tracked_gpio_list_t *gpio_list =
+		(adc_tracked_gpio_list_t *)list_find_first(
+			&adc_gpio_tracked_list,
+			adc_gpio_tracked_cb,
+			&pin);
+
+	if (gpio_list == NULL) {
+		gpio_list = (adc_tracked_gpio_list_t *)
+			    balloc(sizeof(*gpio_list), NULL);
+		gpio_list->tr_gpio_pin = pin;
+		gpio_list->tr_total_clients = 0;
+		gpio_list->tr_gpio_counter = 0;
+		list_add(&adc_gpio_tracked_list, (list_t *)&gpio_list->list);
+	}
+	if (gpio_list->tr_total_clients++ == 0)
+		gpio_set_config(dev, pin, &out_pin_cfg);
+}
+
+static void adc_scan_gpio_put(uint8_t pin)
+{
+	struct td_device *dev = adc_scan_gpio_port(&pin);
+	adc_tracked_gpio_list_t *gpio_list =
+		(adc_tracked_gpio_list_t *)list_find_first(
+			&adc_gpio_tracked_list,
+			adc_gpio_tracked_cb,
+			&pin);
+
+	if (!gpio_list)
+		return;
+	if (gpio_list->tr_total_clients > 0)
+		gpio_list->tr_total_clients--;
+	if (!gpio_list->tr_total_clients) {
+		gpio_deconfig(dev, pin);
+		list_remove(&adc_gpio_tracked_list, (list_t *)&gpio_list->list);
+		bfree(gpio_list);
+	}
+}
+
+/*
+ * Activate or release a load switch GPIO. As for periodic subscriptions, the
+ * GPIO is only released when no other client needs it.
+ */
+static void adc_scan_gpio_write(uint8_t pin, bool active_high, bool active)
+{
+	struct td_device *dev = adc_scan_gpio_port(&pin);
+	adc_tracked_gpio_list_t *gpio_list =
+		(adc_tracked_gpio_list_t *)list_find_first(
+			&adc_gpio_tracked_list,
+			adc_gpio_tracked_cb,
+			&pin);
+
+	if (!gpio_list)
+		return;
+	if (active) {
+		if (!gpio_list->tr_gpio_counter++)
+			gpio_write(dev, pin, active_high);
+	} else if (gpio_list->tr_gpio_counter) {
+		if (!--gpio_list->tr_gpio_counter)
+			gpio_write(dev, pin, !active_high);
+	}
+}
+
+static bool adc_scan_cfg_valid(const adc_service_scan_cfg_t *cfg)
+{
+	uint8_t i;
+
+	if (cfg->nb_channels == 0 ||
+	    cfg->nb_channels > ADC_SERVICE_SCAN_MAX_CHANNELS ||
+	    cfg->batch_size == 0 ||
+	    cfg->batch_size * cfg->nb_channels > ADC_SERVICE_SCAN_MAX_VALUES ||
+	    cfg->period <= cfg->settle_time)
+		return false;
+
+	for (i = 0; i < cfg->nb_channels; i++) {
+		if (cfg->channels[i] > ADC_MAX_CHANNEL)
+			return false;
+		if (cfg->gpio_pins[i] != ADC_SERVICE_NO_GPIO &&
+		    (cfg->gpio_pins[i] >= SS_GPIO_8B0_BITS + SS_GPIO_8B1_BITS ||
+		     cfg->settle_time == 0))
+			return false;
+	}
+	return true;
+}
+
+/* Merge the channels and GPIOs of a client in the scan configuration */
+static bool adc_scan_set_add(adc_scan_set_t *set, adc_scan_client_t *cli)
+{
+	const adc_service_scan_cfg_t *cfg = &cli->cfg;
+	uint8_t i, j;
+
+	for (i = 0; i < cfg->nb_channels; i++) {
+		for (j = 0; j < set->nb_channels; j++)
+			if (set->channels[j] == cfg->channels[i])
+				break;
+		if (j == set->nb_channels) {
+			if (j == ADC_SCAN_MAX_CHANNELS)
+				return false;
+			set->channels[set->nb_channels++] = cfg->channels[i];
+		}
+		cli->index[i] = j;
+
+		if (cfg->gpio_pins[i] == ADC_SERVICE_NO_GPIO)
+			continue;
+		for (j = 0; j < set->nb_gpios; j++)
+			if (set->gpio_pins[j] == cfg->gpio_pins[i])
+				break;
+		if (j == set->nb_gpios) {
+			if (j == ADC_SCAN_MAX_CHANNELS)
+				return false;
+			set->gpio_pins[j] = cfg->gpio_pins[i];
+			set->gpio_active_high[j] = cfg->active_high;
+			set->nb_gpios++;
+		}
+		set->settle_time = MAX(set->settle_time, cfg->settle_time);
+	}
+	if (!set->period || cfg->period < set->period)
+		set->period = cfg->period;
+	/* The GPIOs of the slowest settling client are activated before each
+	 * scan of the fastest one */
+	if (set->nb_gpios && set->period <= set->settle_time)
+		return false;
+	return true;
+}
+
+/*
+ * Compute the scan configuration for the current clients plus new_cli if not
+ * NULL, and apply it if new_cli fits in the scan.
+ */
+static bool adc_scan_update(adc_scan_client_t *new_cli)
+{
+	adc_scan_set_t set = {};
+	adc_scan_client_t *cli;
+	list_t *l;
+
+	for (l = adc_scan.clients.head; l; l = l->next)
+		adc_scan_set_add(&set, (adc_scan_client_t *)l);
+	if (new_cli && !adc_scan_set_add(&set, new_cli))
+		return false;
+
+	/* The scan runs at the fastest client rate */
+	for (l = adc_scan.clients.head; l; l = l->next) {
+		cli = (adc_scan_client_t *)l;
+		cli->decimation = MAX(cli->cfg.period / set.period, 1);
+	}
+	if (new_cli)
+		new_cli->decimation = MAX(new_cli->cfg.period / set.period, 1);
+	adc_scan.set = set;
+	return true;
+}
+
+static void adc_scan_start_timer(void)
+{
+	uint32_t delay = adc_scan.set.period;
+
+	if (adc_scan.set.nb_gpios)
+		delay -= adc_scan.set.settle_time;
+	timer_start(adc_scan.timer, delay, NULL);
+}
+
+static void adc_scan_client_push(adc_scan_client_t *cli, uint16_t *values,
+				 DRIVER_API_RC status)
+{
+	const adc_service_scan_cfg_t *cfg = &cli->cfg;
+	uint16_t *out;
+	uint8_t i;
+
+	if (!cli->evt) {
+		cli->evt = (adc_service_scan_evt_msg_t *)
+			   cfw_alloc_rsp_message_for_client(
+			cli->conn, MSG_ID_ADC_SERVICE_SCAN_EVT,
+			sizeof(*cli->evt) + cfg->batch_size *
+			cfg->nb_channels * sizeof(cli->evt->values[0]),
+			cli->priv);
+		CFW_MESSAGE_TYPE((struct cfw_message *)cli->evt) = TYPE_EVT;
+		cli->evt->status = DRV_RC_OK;
+		cli->evt->nb_samples = 0;
+		cli->evt->nb_channels = cfg->nb_channels;
+	}
+
+	/* A failed scan is reported in the batch status and not accumulated */
+	if (status != DRV_RC_OK) {
+		cli->evt->status = status;
+		return;
+	}
+
+	for (i = 0; i < cfg->nb_channels; i++) {
+		if (cfg->mode == ADC_SCAN_AVERAGE)
+			cli->sum[i] += values[cli->index[i]];
+		else
+			cli->sum[i] = values[cli->index[i]];
+	}
+	if (++cli->nb_scans < cli->decimation)
+		return;
+
+	out = &cli->evt->values[cli->evt->nb_samples * cfg->nb_channels];
+	for (i = 0; i < cfg->nb_channels; i++) {
+		out[i] = cfg->mode == ADC_SCAN_AVERAGE ?
+			 cli->sum[i] / cli->nb_scans : cli->sum[i];
+		cli->sum[i] = 0;
+	}
+	cli->nb_scans = 0;
+
+	if (++cli->evt->nb_samples == cfg->batch_size) {
+		cli->evt->timestamp = get_uptime_ms();
+		cfw_send_message(cli->evt);
+		cli->evt = NULL;
+	}
+}
+
+static void adc_scan_timer_handler(void *priv_data)
+{
+	uint16_t values[ADC_SCAN_MAX_CHANNELS];
+	DRIVER_API_RC status;
+	uint8_t i;
+	list_t *l;
+
+	/* Activate all the load switches once, then wait for the settle time */
+	if (!adc_scan.settling && adc_scan.set.nb_gpios) {
+		adc_scan.active = adc_scan.set;
+		for (i = 0; i < adc_scan.active.nb_gpios; i++)
+			adc_scan_gpio_write(adc_scan.active.gpio_pins[i],
+					    adc_scan.active.gpio_active_high[i],
+					    true);
+		adc_scan.settling = true;
+		timer_start(adc_scan.timer, adc_scan.set.settle_time, NULL);
+		return;
+	}
+
+	status = ss_adc_read_multi(adc_scan.set.channels,
+				   adc_scan.set.nb_channels, values);
+	adc_scan.nb_scans++;
+
+	if (adc_scan.settling) {
+		for (i = 0; i < adc_scan.active.nb_gpios; i++)
+			adc_scan_gpio_write(adc_scan.active.gpio_pins[i],
+					    adc_scan.active.gpio_active_high[i],
+					    false);
+		adc_scan.settling = false;
+	}
+
+	for (l = adc_scan.clients.head; l; l = l->next)
+		adc_scan_client_push((adc_scan_client_t *)l, values, status);
+
+	adc_scan_start_timer();
+}
+
+static void handle_scan_subscribe(struct cfw_message *msg)
+{
+	adc_service_scan_req_msg_t *req = (adc_service_scan_req_msg_t *)msg;
+	adc_service_subscribe_rsp_msg_t *resp =
+		(adc_service_subscribe_rsp_msg_t *)cfw_alloc_rsp_msg(
+			msg,
+			MSG_ID_ADC_SERVICE_SCAN_SUBSCRIBE_RSP,
+			sizeof(*resp));
+	adc_scan_client_t *cli;
+	uint8_t i;
+
+	resp->adc_sub_conn_handle = NULL;
+	resp->status = DRV_RC_INVALID_CONFIG;
+	if (!adc_scan_cfg_valid(&req->cfg)) {
+		pr_debug(LOG_MODULE_MAIN, "Invalid scan configuration\n");
+		goto out;
+	}
+
+	cli = (adc_scan_client_t *)balloc(sizeof(*cli), NULL);
+	memset(cli, 0, sizeof(*cli));
+	cli->conn = req->adc_service_conn;
+	cli->priv = msg->priv;
+	cli->cfg = req->cfg;
+	if (!adc_scan_update(cli)) {
+		pr_debug(LOG_MODULE_MAIN,
+			 "Too many scanned channels or settle time too long\n");
+		bfree(cli);
+		goto out;
+	}
+
+	for (i = 0; i < cli->cfg.nb_channels; i++)
+		if (cli->cfg.gpio_pins[i] != ADC_SERVICE_NO_GPIO)
+			adc_scan_gpio_get(cli->cfg.gpio_pins[i]);
+	list_add(&adc_scan.clients, &cli->list);
+
+	if (!adc_scan.timer) {
+		adc_scan.timer = timer_create(adc_scan_timer_handler, NULL,
+					      adc_scan.set.period, false,
+					      false, NULL);
+		adc_scan.settling = false;
+	}
+	/* Restart at the new rate, unless GPIOs are active for a scan */
+	if (!adc_scan.settling)
+		adc_scan_start_timer();
+
+	resp->adc_sub_conn_handle = cli;
+	resp->status = DRV_RC_OK;
+out:
+	cfw_send_message(resp);
+	cfw_msg_free(msg);
+}
+
+static void handle_scan_unsubscribe(struct cfw_message *msg)
+{
+	adc_scan_client_t *cli = (adc_scan_client_t *)msg->priv;
+	adc_service_subscribe_rsp_msg_t *resp =
+		(adc_service_subscribe_rsp_msg_t *)cfw_alloc_rsp_msg(
+			msg,
+			MSG_ID_ADC_SERVICE_SCAN_UNSUBSCRIBE_RSP,
+			sizeof(*resp));
+	uint8_t i;
+
+	resp->status = DRV_RC_FAIL;
+	if (!cli)
+		goto out;
+
+	list_remove(&adc_scan.clients, &cli->list);
+	if (list_empty(&adc_scan.clients)) {
+		/* Release the load switches of an interrupted scan */
+		if (adc_scan.settling)
+			for (i = 0; i < adc_scan.active.nb_gpios; i++)
+				adc_scan_gpio_write(
+					adc_scan.active.gpio_pins[i],
+					adc_scan.active.gpio_active_high[i],
+					false);
+		timer_delete(adc_scan.timer);
+		adc_scan.timer = NULL;
+		adc_scan.settling = false;
+	}
+	adc_scan_update(NULL);
+
+	for (i = 0; i < cli->cfg.nb_channels; i++)
+		if (cli->cfg.gpio_pins[i] != ADC_SERVICE_NO_GPIO)
+			adc_scan_gpio_put(cli->cfg.gpio_pins[i]);
+	if (cli->evt)
+		cfw_msg_free(&cli->evt->header);
+	bfree(cli);
+	resp->status = DRV_RC_OK;
+out:
+	cfw_send_message(resp);
+	cfw_msg_free(msg);
+}
+
 static void adc_handle_message(struct cfw_message *msg, void *param)
 {
 	switch (CFW_MESSAGE_ID(msg)) {
@@ -228,6 +635,12 @@ static void adc_handle_message(struct cfw_message *msg, void *param)
 	case MSG_ID_ADC_UNSUBSCRIBE_REQ:
 		handle_unsubscribe(msg);
 		break;
+	case MSG_ID_ADC_SCAN_SUBSCRIBE_REQ:
+		handle_scan_subscribe(msg);
+		break;
+	case MSG_ID_ADC_SCAN_UNSUBSCRIBE_REQ:
+		handle_scan_unsubscribe(msg);
+		break;
 	default:
 		cfw_print_default_handle_error_msg(LOG_MODULE_MAIN,
 						   CFW_MESSAGE_ID(
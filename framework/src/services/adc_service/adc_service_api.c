@@ -77,3 +77,25 @@ void adc_service_unsubscribe(cfw_service_conn_t *c, void *adc_svc_client)
 
 	cfw_send_message(msg);
 }
+
+void adc_service_scan_subscribe(cfw_service_conn_t *c,
+				const adc_service_scan_cfg_t *cfg, void *priv)
+{
+	struct cfw_message *msg = cfw_alloc_message_for_service(
+		c, MSG_ID_ADC_SCAN_SUBSCRIBE_REQ,
+		sizeof(adc_service_scan_req_msg_t), priv);
+	adc_service_scan_req_msg_t *req = (adc_service_scan_req_msg_t *)msg;
+
+	req->adc_service_conn = c;
+	req->cfg = *cfg;
+	cfw_send_message(msg);
+}
+
+void adc_service_scan_unsubscribe(cfw_service_conn_t *c, void *adc_scan_client)
+{
+	struct cfw_message *msg = cfw_alloc_message_for_service(
+		c, MSG_ID_ADC_SCAN_UNSUBSCRIBE_REQ,
+		sizeof(struct cfw_message), adc_scan_client);
+
+	cfw_send_message(msg);
+}
@@ -38,6 +38,8 @@
 #define MSG_ID_ADC_GET_VAL_REQ          (MSG_ID_ADC_REQ | 0x5)
 #define MSG_ID_ADC_SUBSCRIBE_REQ        (MSG_ID_ADC_REQ | 0x6)
 #define MSG_ID_ADC_UNSUBSCRIBE_REQ      (MSG_ID_ADC_REQ | 0x7)
+#define MSG_ID_ADC_SCAN_SUBSCRIBE_REQ   (MSG_ID_ADC_REQ | 0x8)
+#define MSG_ID_ADC_SCAN_UNSUBSCRIBE_REQ (MSG_ID_ADC_REQ | 0x9)
 
 /** ADC min channel ID */
 #define ADC_MIN_CHANNEL             0
@@ -66,4 +68,13 @@ typedef struct adc_service_cli_req {
 	void *priv;             /*!< Priv data from client */
 } adc_service_cli_req_t;
 
+/**
+ * Scan subscribe request message structure
+ */
+typedef struct adc_service_scan_req_msg {
+	struct cfw_message header;
+	cfw_service_conn_t *adc_service_conn;   /*!< the service connection */
+	adc_service_scan_cfg_t cfg;             /*!< scan configuration */
+} adc_service_scan_req_msg_t;
+
 #endif /* __ADC_SERVICE_PRIVATE_H__ */
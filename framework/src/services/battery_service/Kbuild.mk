@@ -35,7 +35,9 @@ obj-$(CONFIG_SERVICES_QUARK_SE_CHARGER)    += charging_sm.o \
 obj-$(CONFIG_USB_POWER_SUPPLY)             += usb_power_supply_driver.o
 obj-$(CONFIG_QI_BQ51003)                   += qi_bq51003_driver.o
 obj-$(CONFIG_SERVICES_QUARK_SE_BATTERY_IMPL)    += battery_service_private.o
-obj-$(CONFIG_SERVICES_QUARK_SE_FUELGAUGE)       += adc_fuel_gauge_api.o
+obj-$(CONFIG_SERVICES_QUARK_SE_FUELGAUGE)       += adc_fuel_gauge_api.o \
+                                                   fg_lut.o
+obj-$(CONFIG_FG_MODEL)                          += fg_model.o
 obj-y += battery_LUT/
 
 ifeq ($(CONFIG_SERVICES_QUARK_SE_BATTERY),y)
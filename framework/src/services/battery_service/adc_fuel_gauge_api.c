@@ -45,7 +45,14 @@
 #include "battery_LUT/battery_LUT.h"
 #include "battery_property.h"
 #include "fuel_gauge_api.h"
+#include "fg_lut.h"
 #include "charging_sm.h"
+#ifdef CONFIG_FG_MODEL
+#include <zephyr.h>
+#include "os/os.h"
+#include "infra/time.h"
+#include "fg_model.h"
+#endif
 #if (CONFIG_SW_TEMP_MNG != 0)
 #include "hal_charger.h"
 #endif
@@ -82,16 +89,6 @@
 #define FG_FULL_CHARGE                          100
 
 #define BATT_LEVEL_FULL_NO_CHARGE       4250
-#define LOOKUP_INDEX_10PRCT                     10      /**< index within lookup table related to voltage
-	                                                 * corresponding to 10% of charge*/
-#define LOOKUP_INDEX_30PRCT                     11      /**< index within lookup table related to voltage
-	                                                 * corresponding to 30% of charge*/
-#define LOOKUP_INDEX_50PRCT                     12      /**< index within lookup table related to voltage
-	                                                 * corresponding to 50% of charge*/
-#define LOOKUP_INDEX_70PRCT                     13      /**< index within lookup table related to voltage
-	                                                 * corresponding to 70% of charge*/
-#define LOOKUP_INDEX_90PRCT                     14      /**< index within lookup table related to voltage
-	                                                 * corresponding to 90% of charge*/
 
 #define FG_INITIAL_TEMPERATURE          20      /**< temperature at Boot time */
 
@@ -186,12 +183,36 @@ struct adc_filter_t {
 };
 static struct adc_filter_t adc_filter = {};
 
+#ifdef CONFIG_FG_ADC_SCAN
+/*
+ * @struct fg_scan_t
+ * @brief ADC service scan subscription of a measure
+ */
+struct fg_scan_t {
+	uint8_t channel;        /**< ADC channel */
+	uint8_t gpio;           /**< SS GPIO of the load switch */
+	uint16_t period;        /**< (ms) wanted period, 0 to unsubscribe */
+	uint16_t subscribed;    /**< (ms) period of the subscription */
+	void *handle;           /**< subscription, NULL if not subscribed */
+	bool is_pending;        /**< waiting for a (un)subscribe response */
+};
+
+static struct fg_scan_t fg_voltage_scan = {
+	ADC_VOLTAGE_CHANNEL, SS_GPIO_SW_FG_VOLT_EN
+};
+static struct fg_scan_t fg_temp_scan = {
+	ADC_TEMPERATURE_CHANNEL, SS_GPIO_SW_FG_TEMP_EN
+};
+#else
 static struct adc_request_info_t adc_request_info = { };
+#endif
 
 static cfw_service_conn_t *adc_service_conn = NULL;             /**< ADC service handler */
 static bool adc_init_done = false;                              /**< equal to 'true' once adc init done */
 
+#ifndef CONFIG_FG_ADC_SCAN
 static cfw_service_conn_t *fg_gpio_service_conn = NULL;         /**< GPIO service handler */
+#endif
 static bool gpio_init_done = false;                             /**< equal to 'true' once gpio init done */
 
 static int16_t current_temperature = FG_INITIAL_TEMPERATURE;
@@ -203,11 +224,13 @@ static fg_event_callback_t g_fg_event_callback;
 static struct fg_level_report_t fg_level_report = {}; /**< saved current level report informations */
 static struct fg_temp_report_t fg_temp_report = {}; /**< saved current temperature report informations */
 
+#ifndef CONFIG_FG_ADC_SCAN
 static T_TIMER adc_timer = NULL;
 static T_TIMER adc_load_switch_timer = NULL;
 
 /* PM Parameters for ADC GPIO Operations */
 struct pm_wakelock fg_wakelock;
+#endif
 
 /* Wakelock used for Curie V3 workaround */
 struct pm_wakelock fg_no_sleep_wakelock;
@@ -220,13 +243,80 @@ static struct fg_measure_cfg_t fg_measure_cfg = {
 	{ FG_FIRST_VOLTAGE_MEASURE, FG_DFLT_VOLTAGE_PERIOD_MEASURE }
 };
 
+#ifdef CONFIG_FG_MODEL
+static const struct fg_model_params fg_model_params = {
+	.capacity_mas = CONFIG_FG_MODEL_CAPACITY_MAH * 3600,
+	.r0_mohm = CONFIG_FG_MODEL_R0_MOHM,
+	.r1_mohm = CONFIG_FG_MODEL_R1_MOHM,
+	.tau_s = CONFIG_FG_MODEL_TAU_S,
+	.base_ua = CONFIG_FG_MODEL_BASE_UA
+};
+
+/* Updated from the fuel gauge and from the hinting subsystems, under
+ * fg_model_mutex. The mutex is created by fg_init(): before, the hints are
+ * only stored in fg_loads_ua, under irq lock */
+static struct fg_model fg_model;
+static T_MUTEX fg_model_mutex;
+/* Last hint of each subsystem, applied again when the model is initialized */
+static uint32_t fg_loads_ua[BATTERY_LOAD_COUNT];
+
+static void fg_model_start(void)
+{
+	T_MUTEX mutex = fg_model_mutex;
+	uint32_t flags;
+	int i;
+
+	if (!mutex)
+		mutex = mutex_create();
+	assert(mutex);
+	mutex_lock(mutex, OS_WAIT_FOREVER);
+	/* From now on, the hints are set to the model */
+	flags = irq_lock();
+	fg_model_mutex = mutex;
+	irq_unlock(flags);
+
+	fg_model_init(&fg_model, &fg_model_params, get_uptime_ms());
+	fg_model_set_temperature(&fg_model, current_temperature,
+				 get_uptime_ms());
+	for (i = 0; i < BATTERY_LOAD_COUNT; i++)
+		fg_model_set_load(&fg_model, i, fg_loads_ua[i],
+				  get_uptime_ms());
+	mutex_unlock(mutex);
+}
+
+static uint8_t fg_model_measure(const uint16_t *table, uint16_t voltage_mv,
+				bool is_charging)
+{
+	uint8_t soc;
+
+	mutex_lock(fg_model_mutex, OS_WAIT_FOREVER);
+	fg_model_update(&fg_model, table, voltage_mv, is_charging,
+			get_uptime_ms());
+	soc = fg_model_get_soc(&fg_model);
+	mutex_unlock(fg_model_mutex);
+	return soc;
+}
+
+static void fg_model_temperature(int16_t temperature)
+{
+	mutex_lock(fg_model_mutex, OS_WAIT_FOREVER);
+	fg_model_set_temperature(&fg_model, temperature, get_uptime_ms());
+	mutex_unlock(fg_model_mutex);
+}
+#endif
+
 static fg_status_t fg_set_shutdown_level_alarm_threshold(
 	uint16_t
 	shutdown_level_alarm_threshold);
+#ifdef CONFIG_FG_ADC_SCAN
+static void fg_init_scans(void);
+#else
 static void fg_init_timer(void);
+#endif
 
 DEFINE_LOG_MODULE(LOG_MODULE_FG, "FG_S")
 
+#ifndef CONFIG_FG_ADC_SCAN
 /*
  * @brief Initialised GPIO for enabling adc conversion
  */
@@ -293,6 +383,7 @@ static void fg_clear_sw_enable(int channel)
 	}
 	pm_wakelock_release(&fg_wakelock);
 }
+#endif
 
 /*
  * @brief Notify upper layer if need
@@ -394,47 +485,15 @@ static void fg_set_battery_soc_properties(uint8_t battery_soc_measured)
 	battery_properties->battery_soc = battery_soc_measured;
 }
 
-/*
- * @brief Get Percentage of battery capacity from linearization
- * @param[in] voltage_x Voltage corresponding to first point
- * @param[in] percent_x Percentage corresponding to the first point
- * @param[in] voltage_y Voltage corresponding to second point
- * @param[in] percent_y Percentage corresponding to the second point
- * @param[in] voltage_batt Battery voltage from which percentage is required
- * @param[in,out] percent_batt Percentage corresponding to voltage_batt
- * @return None
- */
-static void fg_linearize(uint16_t voltage_x,
-			 uint16_t percent_x,
-			 uint16_t voltage_y,
-			 uint16_t percent_y,
-			 uint16_t voltage_batt, uint8_t *percent_batt)
-{
-	assert((voltage_y != voltage_x) && percent_batt);
-	/*!
-	 * Y1 = a.X1 + b
-	 * Y2 = a.X2 + b
-	 * a = (Y2 - Y1)/(X2 - X1)
-	 * percent = a.Voltage + b
-	 * percent = Voltage.(Y2 - Y1)/(X2 - X1) + b
-	 * percent = Y1 + (Voltage - X1).(Y2 -Y1)/(X2 -X1)
-	 */
-	*percent_batt =
-		percent_x +
-		(uint16_t)((voltage_batt -
-			    voltage_x) *
-			   (percent_y - percent_x)) / (voltage_y - voltage_x);
-}
-
 /*
  * @brief Set current fuel gauge from Temperature and battery voltage
- * @param[in] batt_voltage_mv Current battery voltage
+ * @param[in] batt_voltage_mv Current battery voltage, filtered
+ * @param[in] raw_voltage_mv Current battery voltage, as measured
  * @return FG_STATUS_SUCCESS if Ok
  */
-static fg_status_t fg_set_battery_soc(int16_t batt_voltage_mv)
+static fg_status_t fg_set_battery_soc(int16_t	batt_voltage_mv,
+				      uint16_t	raw_voltage_mv)
 {
-	uint16_t batt_level_full = 0;
-	uint8_t lookup_index;
 	uint16_t *p_table = NULL;
 	uint8_t battery_soc_measured = 0;
 	fg_status_t fg_status = FG_STATUS_ERROR_OUT_OF_RANGE;
@@ -464,53 +523,13 @@ static fg_status_t fg_set_battery_soc(int16_t batt_voltage_mv)
 	if (fg_status != FG_STATUS_SUCCESS)
 		return FG_INVALID_LOOKUP_TABLE;
 
-	batt_level_full = p_table[BATTPROP_LOOKUP_TABLE_SIZE - 1];
-
-	if (batt_level_full < batt_voltage_mv) {
-		battery_soc_measured = FG_FULL_CHARGE;
-		fg_status = FG_STATUS_SUCCESS;
-	} else if (batt_voltage_mv >= p_table[LOOKUP_INDEX_90PRCT]) {
-		battery_soc_measured = FG_FULL_CHARGE - 1;
-		fg_status = FG_STATUS_SUCCESS;
-		for (lookup_index = LOOKUP_INDEX_90PRCT;
-		     lookup_index <= (BATTPROP_LOOKUP_TABLE_SIZE - 1);
-		     lookup_index++) {
-			if (batt_voltage_mv < p_table[lookup_index + 1]) {
-				battery_soc_measured =
-					90 + (lookup_index -
-					      LOOKUP_INDEX_90PRCT);
-				break;
-			}
-		}
-	} else if (batt_voltage_mv < p_table[LOOKUP_INDEX_10PRCT]) {
-		for (lookup_index = 0;
-		     lookup_index <= LOOKUP_INDEX_10PRCT;
-		     lookup_index++) {
-			if (batt_voltage_mv <= p_table[lookup_index]) {
-				battery_soc_measured = lookup_index;
-				fg_status = FG_STATUS_SUCCESS;
-				break;
-			}
-		}
-	} else {
-		uint16_t percent_x = 10;
-		for (lookup_index = LOOKUP_INDEX_10PRCT,
-		     percent_x = 10;
-		     lookup_index < LOOKUP_INDEX_90PRCT;
-		     lookup_index++,
-		     percent_x += 20) {
-			if (batt_voltage_mv < p_table[lookup_index + 1]) {
-				fg_linearize(p_table[lookup_index],
-					     percent_x,
-					     p_table[lookup_index + 1],
-					     percent_x + 20,
-					     batt_voltage_mv,
-					     &battery_soc_measured);
-				fg_status = FG_STATUS_SUCCESS;
-				break;
-			}
-		}
-	}
+#ifdef CONFIG_FG_MODEL
+	/* The model compensates the load by itself, it needs the raw measure */
+	battery_soc_measured = fg_model_measure(p_table, raw_voltage_mv,
+						battprop_fuelgauge.is_charging);
+#else
+	battery_soc_measured = fg_lut_get_soc(p_table, batt_voltage_mv);
+#endif
 
 	if (FG_STATUS_SUCCESS == fg_status) {
 		if ((battprop_fuelgauge.is_charging && battery_soc_measured >
@@ -541,6 +560,10 @@ static void fg_set_temperature_soc(int16_t batt_temp_C)
 
 	battery_service_evt_content_rsp_msg.temp_soc = batt_temp_C;
 
+#ifdef CONFIG_FG_MODEL
+	fg_model_temperature(batt_temp_C);
+#endif
+
 	/*temperature over/under heat - shutdown request */
 	if ((batt_temp_C > (fg_temp_report.fg_shutdown_set_high_threshold)) ||
 	    (batt_temp_C < (fg_temp_report.fg_shutdown_set_low_threshold))) {
@@ -599,6 +622,7 @@ static void fg_set_temperature_soc(int16_t batt_temp_C)
 	}
 }
 
+#ifndef CONFIG_FG_ADC_SCAN
 /*
  * @brief Parse value form ADC answer
  * @param[in] msg Message from ADC
@@ -622,6 +646,7 @@ static fg_status_t fg_parse_adc_value(struct cfw_message *	msg,
 	}
 	return fg_status;
 }
+#endif
 
 static bool fg_is_charge_evt_detected(struct adc_filter_t *adc_filter)
 {
@@ -639,7 +664,7 @@ static void fg_adc_filter_init(struct adc_filter_t *adc_filter)
 	adc_filter->vbatt_table_count = 0;
 	adc_filter->error_count = 0;
 	adc_filter->last_charger_state = charging_sm_get_state();
-	memset(adc_filter->vbatt_table, 0, FB_FILTER_COUNT_VALUE);
+	memset(adc_filter->vbatt_table, 0, sizeof(adc_filter->vbatt_table));
 }
 
 
@@ -804,61 +829,143 @@ static void manage_charger(int16_t temperature)
 #endif
 
 /*
- * @brief Send ADC conversion result to the one which did the request
+ * @brief Update the fuel gauge with an ADC conversion result
  * @param[in] channel Channel from where conversion come from
+ * @param[in] adc_value ADC numeric value
  * @return None
  */
-static void fg_response_by_channel(struct cfw_message *msg, int channel)
+static void fg_measure_done(int channel, int16_t adc_value)
 {
 	fg_status_t fg_status = FG_STATUS_ERROR_IPC;
-	int16_t adc_value = 0;
 	uint16_t batt_voltage = 0;
 	int16_t temperature = 0;
 
-	fg_status = fg_parse_adc_value(msg, (int16_t *)&adc_value);
-
 	switch (channel) {
 	case ADC_VOLTAGE_CHANNEL:
-		if (FG_STATUS_SUCCESS == fg_status) {
-			fg_convert_voltage(adc_value, &batt_voltage);
-			current_batt_voltage = batt_voltage;
-			fg_status = fg_set_battery_soc(batt_voltage);
+		fg_convert_voltage(adc_value, &batt_voltage);
+		current_batt_voltage = batt_voltage;
+		fg_status = fg_set_battery_soc(batt_voltage,
+					       BATT_ADC_TO_MV(adc_value));
 #ifdef DEBUG_BATTERY_SERVICE
-			pr_info(LOG_MODULE_FG,
-				"Batt Voltage [%dmV] -> SOC[%d%%]\n",
-				batt_voltage,
-				current_battery_soc);
+		pr_info(LOG_MODULE_FG,
+			"Batt Voltage [%dmV] -> SOC[%d%%]\n",
+			batt_voltage,
+			current_battery_soc);
 #endif
-			if (FG_STATUS_SUCCESS != fg_status)
-				pr_error(
-					LOG_MODULE_FG,
-					"unable to retrieve battery fuel gauge");
-		}
-		/* Disabling conversion */
-		fg_clear_sw_enable(channel);
+		if (FG_STATUS_SUCCESS != fg_status)
+			pr_error(LOG_MODULE_FG,
+				 "unable to retrieve battery fuel gauge");
 		break;
 
 	case ADC_TEMPERATURE_CHANNEL:
-		if (FG_STATUS_SUCCESS == fg_status) {
-			fg_convert_temp(adc_value, &temperature);
-			current_temperature = temperature;
+		fg_convert_temp(adc_value, &temperature);
+		current_temperature = temperature;
 #ifdef DEBUG_BATTERY_SERVICE
-			pr_info(LOG_MODULE_FG, "Batt Temp [%dC]\n",
-				current_temperature);
+		pr_info(LOG_MODULE_FG, "Batt Temp [%dC]\n",
+			current_temperature);
 #endif
-			fg_set_temperature_soc(temperature);
+		fg_set_temperature_soc(temperature);
 #if (CONFIG_SW_TEMP_MNG != 0)
-			manage_charger(temperature);
+		manage_charger(temperature);
 #endif
-		}
-		/* Disabling conversion */
-		fg_clear_sw_enable(channel);
 		break;
 
 	default:
 		break;
 	}
 }
+
+#ifdef CONFIG_FG_ADC_SCAN
+/*
+ * @brief Subscribe, unsubscribe or change the period of a scan
+ * @param[in,out] scan Scan to bring to its wanted period
+ * @return None
+ * @remark Only one request of a scan is pending at a time, the scan is
+ *         brought to its latest wanted period when the response is received
+ */
+static void fg_scan_sync(struct fg_scan_t *scan)
+{
+	adc_service_scan_cfg_t cfg = {};
+
+	if (!adc_init_done || scan->is_pending)
+		return;
+
+	if (scan->handle && scan->subscribed != scan->period) {
+		adc_service_scan_unsubscribe(adc_service_conn, scan->handle);
+		scan->is_pending = true;
+	} else if (!scan->handle && scan->period) {
+		cfg.channels[0] = scan->channel;
+		cfg.gpio_pins[0] = scan->gpio;
+		cfg.nb_channels = 1;
+		cfg.active_high = true;
+		cfg.mode = ADC_SCAN_DECIMATE;
+		cfg.settle_time = FG_LOAD_SWITCH_DELAY;
+		cfg.batch_size = 1;
+		cfg.period = scan->period;
+		adc_service_scan_subscribe(adc_service_conn, &cfg, scan);
+		scan->subscribed = scan->period;
+		scan->is_pending = true;
+	}
+}
+
+static void fg_scan_subscribed(adc_service_subscribe_rsp_msg_t *rsp)
+{
+	struct fg_scan_t *scan = rsp->header.priv;
+
+	scan->is_pending = false;
+	if (DRV_RC_OK != rsp->status) {
+		pr_error(LOG_MODULE_FG, "%s err", "adc_scan");
+		/* Do not retry until the next change of interval */
+		scan->period = 0;
+		return;
+	}
+	scan->handle = rsp->adc_sub_conn_handle;
+	fg_scan_sync(scan);
+}
+
+static void fg_scan_unsubscribed(struct cfw_message *msg)
+{
+	struct fg_scan_t *scan = &fg_voltage_scan;
+
+	/* The response carries the subscription handle */
+	if (msg->priv != scan->handle)
+		scan = &fg_temp_scan;
+	scan->handle = NULL;
+	scan->is_pending = false;
+	fg_scan_sync(scan);
+}
+
+static void fg_scan_evt(adc_service_scan_evt_msg_t *evt)
+{
+	struct fg_scan_t *scan = evt->header.priv;
+
+	if (DRV_RC_OK != evt->status || !evt->nb_samples) {
+		pr_error(LOG_MODULE_FG, "adc err:(%d)", evt->status);
+		return;
+	}
+	fg_measure_done(scan->channel, evt->values[0]);
+
+	/* The first voltage measure is done sooner than the next ones */
+	if (scan == &fg_voltage_scan) {
+		scan->period = fg_measure_cfg.voltage_cfg.interval;
+		fg_scan_sync(scan);
+	}
+}
+#else
+/*
+ * @brief Send ADC conversion result to the one which did the request
+ * @param[in] channel Channel from where conversion come from
+ * @return None
+ */
+static void fg_response_by_channel(struct cfw_message *msg, int channel)
+{
+	int16_t adc_value = 0;
+
+	if (FG_STATUS_SUCCESS == fg_parse_adc_value(msg, &adc_value))
+		fg_measure_done(channel, adc_value);
+	/* Disabling conversion */
+	fg_clear_sw_enable(channel);
+}
 /**
  * @brief Adc load switch timer callback
  * @param[in] data from ADC.
@@ -867,6 +974,7 @@ static void fg_load_switch_timer_callback(void *channel)
 {
 	adc_service_get_value(adc_service_conn, (uint32_t)channel, NULL);
 }
+#endif
 static void (*fg_init_done_cb)(void) = NULL;
 
 static void service_connection_cb(cfw_service_conn_t *conn, void *param)
@@ -879,7 +987,9 @@ static void service_connection_cb(cfw_service_conn_t *conn, void *param)
 #endif
 		adc_service_conn = conn;
 		adc_init_done = true;
-	} else if ((void *)GPIO_SVC_EN == param) {
+	}
+#ifndef CONFIG_FG_ADC_SCAN
+	else if ((void *)GPIO_SVC_EN == param) {
 #ifdef DEBUG_BATTERY_SERVICE
 		pr_info(LOG_MODULE_FG, "%s service open\n", "GPIO");
 #endif
@@ -887,10 +997,15 @@ static void service_connection_cb(cfw_service_conn_t *conn, void *param)
 		gpio_init_done = true;
 		fg_gpio_init();
 	}
+#endif
 
 	if ((gpio_init_done == true) && (adc_init_done == true) &&
 	    (fg_init_done_cb != NULL)) {
+#ifdef CONFIG_FG_ADC_SCAN
+		fg_init_scans();
+#else
 		fg_init_timer();
+#endif
 		battery_properties = battery_properties_get();
 		fg_set_shutdown_level_alarm_threshold(
 			battery_properties->battery_shutdown_voltage);
@@ -907,6 +1022,17 @@ static void fg_handle_msg(struct cfw_message *msg, void *data)
 	switch (CFW_MESSAGE_ID(msg)) {
 	case MSG_ID_CFW_CLOSE_SERVICE_RSP:
 		break;
+#ifdef CONFIG_FG_ADC_SCAN
+	case MSG_ID_ADC_SERVICE_SCAN_SUBSCRIBE_RSP:
+		fg_scan_subscribed((adc_service_subscribe_rsp_msg_t *)msg);
+		break;
+	case MSG_ID_ADC_SERVICE_SCAN_UNSUBSCRIBE_RSP:
+		fg_scan_unsubscribed(msg);
+		break;
+	case MSG_ID_ADC_SERVICE_SCAN_EVT:
+		fg_scan_evt((adc_service_scan_evt_msg_t *)msg);
+		break;
+#else
 	case MSG_ID_ADC_SERVICE_GET_VAL_RSP:
 		fg_response_by_channel(msg, adc_request_info.channel);
 		adc_request_info.is_adc_in_use = false;
@@ -943,6 +1069,7 @@ static void fg_handle_msg(struct cfw_message *msg, void *data)
 			}
 		}
 		break;
+#endif
 	default: break;
 	}
 	cfw_msg_free(msg);
@@ -1023,6 +1150,53 @@ static void fg_save_callback(fg_event_callback_t *fg_event_callback)
 	g_fg_event_callback.fg_callback = fg_event_callback->fg_callback;
 }
 
+#ifdef CONFIG_FG_ADC_SCAN
+/*
+ * @brief Set interval between two measure related to temperature
+ * @parm[in] temp_interval New interval
+ * @return None
+ * @remark if temp_interval is equal to zero, temperature measure are suspended
+ */
+void fg_set_temp_interval(uint16_t temp_interval)
+{
+#if (FG_DFLT_TEMPERATURE_PERIOD_MEASURE != 0)
+	fg_measure_cfg.temp_cfg.interval = temp_interval;
+#else
+	fg_measure_cfg.temp_cfg.interval = 0;
+#endif
+	fg_temp_scan.period = fg_measure_cfg.temp_cfg.interval;
+	fg_scan_sync(&fg_temp_scan);
+}
+
+/*
+ * @brief Set interval between two measure related to voltage
+ * @parm[in] batt_interval New interval
+ * @return None
+ * @remark if batt_interval is equal to zero, vbatt measure are suspended
+ */
+void fg_set_voltage_interval(uint16_t batt_interval)
+{
+	fg_measure_cfg.voltage_cfg.interval = batt_interval;
+	/* Else applied after the first measure, done sooner than the next ones */
+	if (fg_voltage_scan.period != FG_FIRST_VOLTAGE_MEASURE) {
+		fg_voltage_scan.period = batt_interval;
+		fg_scan_sync(&fg_voltage_scan);
+	}
+}
+
+/*
+ * @brief Subscribe to the voltage and temperature scans
+ * @remark The ADC service activates the load switches and converts the
+ *         channels of both scans in the same wake-up
+ */
+static void fg_init_scans(void)
+{
+	fg_voltage_scan.period = FG_FIRST_VOLTAGE_MEASURE;
+	fg_temp_scan.period = fg_measure_cfg.temp_cfg.interval;
+	fg_scan_sync(&fg_voltage_scan);
+	fg_scan_sync(&fg_temp_scan);
+}
+#else
 static void fg_start_temp_conversion(void)
 {
 	if (adc_init_done && gpio_init_done &&
@@ -1147,6 +1321,7 @@ static void fg_init_timer(void)
 
 	fg_calibration_timer();
 }
+#endif
 
 /**
  * @brief Initialize the Fuel Gauge Interface.
@@ -1156,7 +1331,9 @@ static void fg_init_timer(void)
 void fg_init(void *fg_svc_queue, fg_event_callback_t *fg_event_callback,
 	     void (*bs_fuel_gauge_status)(void))
 {
+#ifndef CONFIG_FG_ADC_SCAN
 	adc_request_info.is_adc_in_use = false;
+#endif
 
 	assert(fg_svc_queue && fg_event_callback);
 
@@ -1164,14 +1341,22 @@ void fg_init(void *fg_svc_queue, fg_event_callback_t *fg_event_callback,
 	fg_init_level_report();
 	fg_init_temp_report();
 	fg_adc_filter_init(&adc_filter);
+#ifdef CONFIG_FG_MODEL
+	fg_model_start();
+#endif
 	fg_init_done_cb = bs_fuel_gauge_status;
 	g_client = cfw_client_init(
 		get_service_queue(), fg_handle_msg, bs_fuel_gauge_status);
 	cfw_open_service_helper(g_client, SS_ADC_SERVICE_ID,
 				service_connection_cb,
 				(void *)SS_ADC_SERVICE_ID);
+#ifdef CONFIG_FG_ADC_SCAN
+	/* The ADC service drives the load switches of the scans */
+	gpio_init_done = true;
+#else
 	cfw_open_service_helper(g_client, GPIO_SVC_EN,
 				service_connection_cb, (void *)GPIO_SVC_EN);
+#endif
 
 	/* Check the revision of the SoC to prepare sw workaround */
 	if (board_feature_has(HW_IDLE_QUIRK)) {
@@ -1193,7 +1378,14 @@ void fg_init(void *fg_svc_queue, fg_event_callback_t *fg_event_callback,
  */
 void fg_close(void)
 {
+#ifdef CONFIG_FG_ADC_SCAN
+	fg_voltage_scan.period = 0;
+	fg_temp_scan.period = 0;
+	fg_scan_sync(&fg_voltage_scan);
+	fg_scan_sync(&fg_temp_scan);
+#else
 	timer_stop(adc_timer);
+#endif
 	adc_init_done = false;
 	gpio_init_done = false;
 	current_battery_soc = BP_INIT_FLASH_SOC_VAL;
@@ -1441,6 +1633,32 @@ fg_status_t fg_get_device_type(uint16_t *bat_dev_type)
 	return FG_STATUS_NOT_IMPLEMENTED;
 }
 
+#ifdef CONFIG_FG_MODEL
+void battery_service_set_load_hint(battery_load_source_t	source,
+				   uint32_t			current_ua)
+{
+	uint32_t flags;
+
+	if (source >= BATTERY_LOAD_COUNT)
+		return;
+
+	flags = irq_lock();
+	fg_loads_ua[source] = current_ua;
+	if (!fg_model_mutex) {
+		/* The model is not started yet */
+		irq_unlock(flags);
+		return;
+	}
+	irq_unlock(flags);
+
+	/* Moving the model to now can take several steps, outside of the
+	 * irq lock */
+	mutex_lock(fg_model_mutex, OS_WAIT_FOREVER);
+	fg_model_set_load(&fg_model, source, current_ua, get_uptime_ms());
+	mutex_unlock(fg_model_mutex);
+}
+#endif
+
 /**
  * @brief Fuel Gauge get Battery Effective Current.
  * @param[out] Battery Effective Current [mA].
@@ -1448,5 +1666,13 @@ fg_status_t fg_get_device_type(uint16_t *bat_dev_type)
  */
 fg_status_t fg_get_effective_current(uint16_t *eff_curr)
 {
+#ifdef CONFIG_FG_MODEL
+	if (NULL == eff_curr)
+		return FG_STATUS_ERROR_PARAMETER;
+	/* Estimation from the base load and the hints */
+	*eff_curr = fg_model.current_ua / 1000;
+	return FG_STATUS_SUCCESS;
+#else
 	return FG_STATUS_NOT_IMPLEMENTED;
+#endif
 }
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "util/assert.h"
+
+#include "fg_lut.h"
+
+/*
+ * @brief Get Percentage of battery capacity from linearization
+ * @param[in] voltage_x Voltage corresponding to first point
+ * @param[in] percent_x Percentage corresponding to the first point
+ * @param[in] voltage_y Voltage corresponding to second point
+ * @param[in] percent_y Percentage corresponding to the second point
+ * @param[in] voltage_batt Battery voltage from which percentage is required
+ * @param[in,out] percent_batt Percentage corresponding to voltage_batt
+ * @return None
+ */
+static void fg_linearize(uint16_t voltage_x,
+			 uint16_t percent_x,
+			 uint16_t voltage_y,
+			 uint16_t percent_y,
+			 uint16_t voltage_batt, uint8_t *percent_batt)
+{
+	assert((voltage_y != voltage_x) && percent_batt);
+	/*!
+	 * Y1 = a.X1 + b
+	 * Y2 = a.X2 + b
+	 * a = (Y2 - Y1)/(X2 - X1)
+	 * percent = a.Voltage + b
+	 * percent = Voltage.(Y2 - Y1)/(X2 - X1) + b
+	 * percent = Y1 + (Voltage - X1).(Y2 -Y1)/(X2 -X1)
+	 */
+	*percent_batt =
+		percent_x +
+		(uint16_t)((voltage_batt -
+			    voltage_x) *
+			   (percent_y - percent_x)) / (voltage_y - voltage_x);
+}
+
+uint8_t fg_lut_get_soc(const uint16_t *table, int16_t voltage_mv)
+{
+	uint8_t lookup_index;
+	uint8_t soc = 0;
+
+	if (table[BATTPROP_LOOKUP_TABLE_SIZE - 1] < voltage_mv) {
+		soc = FG_LUT_FULL_CHARGE;
+	} else if (voltage_mv >= table[LOOKUP_INDEX_90PRCT]) {
+		soc = FG_LUT_FULL_CHARGE - 1;
+		for (lookup_index = LOOKUP_INDEX_90PRCT;
+		     lookup_index < (BATTPROP_LOOKUP_TABLE_SIZE - 1);
+		     lookup_index++) {
+			if (voltage_mv < table[lookup_index + 1]) {
+				soc = 90 + (lookup_index -
+					    LOOKUP_INDEX_90PRCT);
+				break;
+			}
+		}
+	} else if (voltage_mv < table[LOOKUP_INDEX_10PRCT]) {
+		for (lookup_index = 0;
+		     lookup_index <= LOOKUP_INDEX_10PRCT;
+		     lookup_index++) {
+			if (voltage_mv <= table[lookup_index]) {
+				soc = lookup_index;
+				break;
+			}
+		}
+	} else {
+		uint16_t percent_x;
+		for (lookup_index = LOOKUP_INDEX_10PRCT,
+		     percent_x = 10;
+		     lookup_index < LOOKUP_INDEX_90PRCT;
+		     lookup_index++,
+		     percent_x += 20) {
+			if (voltage_mv < table[lookup_index + 1]) {
+				fg_linearize(table[lookup_index],
+					     percent_x,
+					     table[lookup_index + 1],
+					     percent_x + 20,
+					     voltage_mv,
+					     &soc);
+				break;
+			}
+		}
+	}
+
+	return soc;
+}
+
+/* State of charge of a point of the table, in 0.01 % */
+static uint16_t fg_lut_point_bp(uint8_t index)
+{
+	if (index < LOOKUP_INDEX_10PRCT)
+		return index * 100;
+	if (index <= LOOKUP_INDEX_90PRCT)
+		return (10 + 20 * (index - LOOKUP_INDEX_10PRCT)) * 100;
+	return (FG_LUT_FULL_CHARGE -
+		(BATTPROP_LOOKUP_TABLE_SIZE - 1 - index)) * 100;
+}
+
+uint32_t fg_lut_get_soc_ppm(const uint16_t *table, uint16_t voltage_mv,
+			    uint16_t *uv_per_bp)
+{
+	uint8_t i = 0;
+	uint16_t dv;
+	uint16_t dbp;
+	uint32_t soc;
+
+	/* Segment holding the voltage, or the first or last one */
+	while (i < BATTPROP_LOOKUP_TABLE_SIZE - 2 && voltage_mv >= table[i + 1])
+		i++;
+
+	dv = table[i + 1] > table[i] ? table[i + 1] - table[i] : 0;
+	dbp = fg_lut_point_bp(i + 1) - fg_lut_point_bp(i);
+
+	if (voltage_mv <= table[i] || !dv)
+		soc = fg_lut_point_bp(i) * 100;
+	else if (voltage_mv >= table[i + 1])
+		soc = fg_lut_point_bp(i + 1) * 100;
+	else
+		soc = fg_lut_point_bp(i) * 100 +
+		      (uint32_t)(voltage_mv - table[i]) * dbp * 100 / dv;
+
+	if (uv_per_bp) {
+		*uv_per_bp = (uint32_t)dv * 1000 / dbp;
+		if (!*uv_per_bp)
+			*uv_per_bp = 1;
+	}
+
+	return soc;
+}
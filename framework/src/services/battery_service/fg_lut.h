@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __FG_LUT_H__
+#define __FG_LUT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "battery_LUT/battery_LUT.h"
+
+/*
+ * Layout of the battery lookup tables: the voltage at index 0 to 9 is the
+ * one of 0 to 9 %, index 10 to 14 cover 10 to 90 % by steps of 20 %, and
+ * index 15 to 24 are 91 to 100 %.
+ */
+#define LOOKUP_INDEX_10PRCT                     10      /**< index within lookup table related to voltage
+	                                                 * corresponding to 10% of charge*/
+#define LOOKUP_INDEX_30PRCT                     11      /**< index within lookup table related to voltage
+	                                                 * corresponding to 30% of charge*/
+#define LOOKUP_INDEX_50PRCT                     12      /**< index within lookup table related to voltage
+	                                                 * corresponding to 50% of charge*/
+#define LOOKUP_INDEX_70PRCT                     13      /**< index within lookup table related to voltage
+	                                                 * corresponding to 70% of charge*/
+#define LOOKUP_INDEX_90PRCT                     14      /**< index within lookup table related to voltage
+	                                                 * corresponding to 90% of charge*/
+
+#define FG_LUT_FULL_CHARGE                      100
+
+/** State of charge unit of fg_lut_get_soc_ppm(): 1 ppm of the capacity */
+#define FG_LUT_SOC_PPM_FULL                     1000000
+
+/**
+ * Battery level of a voltage, as the fuel gauge always reported it.
+ *
+ * The level is the index of the first point above the voltage below 10 %,
+ * the linearization between the points from 10 to 90 %, and the index of
+ * the last point below the voltage above 90 %.
+ *
+ * @param table Lookup table of the charging state and temperature
+ * @param voltage_mv Battery voltage
+ * @return battery level in percent
+ */
+uint8_t fg_lut_get_soc(const uint16_t *table, int16_t voltage_mv);
+
+/**
+ * Fine state of charge of a voltage, interpolated between all the points
+ * of the table.
+ *
+ * @param table Lookup table of the charging state and temperature
+ * @param voltage_mv Open circuit voltage
+ * @param uv_per_bp Slope of the table around the voltage, in uV per 0.01 %,
+ *        at least 1. NULL if not needed.
+ * @return state of charge in ppm, clamped to [0, FG_LUT_SOC_PPM_FULL]
+ */
+uint32_t fg_lut_get_soc_ppm(const uint16_t *table, uint16_t voltage_mv,
+			    uint16_t *uv_per_bp);
+
+#endif /* __FG_LUT_H__ */
@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "fg_model.h"
+
+#define FG_MODEL_STEP_MS        4000    /* max coulomb counting step */
+#define FG_MODEL_MAX_UA         500000  /* keeps current * step in 32 bits */
+#define FG_MODEL_ADC_NOISE_UV   5000    /* voltage measure error */
+#define FG_MODEL_CHARGE_UV      20000   /* charge table error */
+#define FG_MODEL_HINT_ERR_DIV   4       /* hinted loads are known at 25 % */
+#define FG_MODEL_DRIFT_MS_BP2   100     /* coulomb counting drift: 1 (0.01 %)^2
+	                                 * per 100 ms */
+#define FG_MODEL_P_MAX          1000000 /* (0.01 %)^2, 10 % std deviation */
+#define FG_MODEL_R_MAX          100000000
+
+/*
+ * Temperature correction, linear from 25 C in Q10: the resistances rise by
+ * 4 % per degree below and fall by 2 % per degree above, the capacity
+ * shrinks by 0.6 % per degree below.
+ */
+#define FG_MODEL_T_REF          25
+#define FG_MODEL_T_MIN          -20
+#define FG_MODEL_T_MAX          60
+#define FG_MODEL_R_COLD_Q10     41
+#define FG_MODEL_R_HOT_Q10      20
+#define FG_MODEL_R_MIN_Q10      512
+#define FG_MODEL_CAP_COLD_Q10   6
+
+static void fg_model_scale(struct fg_model *m)
+{
+	const struct fg_model_params *p = m->params;
+	int32_t dt = FG_MODEL_T_REF - m->temperature;
+	int32_t r = 1024;
+	int32_t c = 1024;
+
+	if (dt > 0) {
+		r += FG_MODEL_R_COLD_Q10 * dt;
+		c -= FG_MODEL_CAP_COLD_Q10 * dt;
+	} else {
+		r += FG_MODEL_R_HOT_Q10 * dt;
+		if (r < FG_MODEL_R_MIN_Q10)
+			r = FG_MODEL_R_MIN_Q10;
+	}
+
+	m->r0_mohm = ((uint32_t)p->r0_mohm * r) >> 10;
+	m->r1_mohm = ((uint32_t)p->r1_mohm * r) >> 10;
+	m->capacity_mas = (uint32_t)(((uint64_t)p->capacity_mas * c) >> 10);
+}
+
+static void fg_model_sum_loads(struct fg_model *m)
+{
+	uint32_t current = m->params->base_ua;
+	int i;
+
+	for (i = 0; i < BATTERY_LOAD_COUNT; i++)
+		current += m->loads_ua[i];
+	m->current_ua = current > FG_MODEL_MAX_UA ? FG_MODEL_MAX_UA : current;
+}
+
+/*
+ * Move the model to now with the current load: coulomb counting and
+ * polarization. The polarization uses the implicit Euler step, stable for
+ * any step and exact once relaxed.
+ */
+static void fg_model_advance(struct fg_model *m, uint32_t now_ms)
+{
+	uint32_t elapsed = now_ms - m->last_ms;
+	uint32_t tau_ms = (uint32_t)m->params->tau_s * 1000;
+	int32_t target_uv = m->current_ua * m->r1_mohm / 1000;
+
+	m->last_ms = now_ms;
+
+	while (elapsed) {
+		uint32_t step = elapsed > FG_MODEL_STEP_MS ?
+				FG_MODEL_STEP_MS : elapsed;
+		uint32_t used;
+
+		elapsed -= step;
+
+		m->vrc_uv += (int32_t)((int64_t)(target_uv - m->vrc_uv) *
+				       step / (tau_ms + step));
+		if (!m->valid)
+			continue;
+
+		m->soc_rem += m->current_ua * step;
+		used = m->soc_rem / m->capacity_mas;
+		m->soc_rem -= used * m->capacity_mas;
+		m->soc -= used;
+		if (m->soc < 0)
+			m->soc = 0;
+		m->unc += used / FG_MODEL_HINT_ERR_DIV;
+		m->p += step / FG_MODEL_DRIFT_MS_BP2;
+		if (m->p > FG_MODEL_P_MAX)
+			m->p = FG_MODEL_P_MAX;
+	}
+}
+
+void fg_model_init(struct fg_model *m, const struct fg_model_params *params,
+		   uint32_t now_ms)
+{
+	int i;
+
+	m->params = params;
+	for (i = 0; i < BATTERY_LOAD_COUNT; i++)
+		m->loads_ua[i] = 0;
+	m->temperature = FG_MODEL_T_REF;
+	fg_model_scale(m);
+	fg_model_sum_loads(m);
+	m->vrc_uv = 0;
+	m->soc = 0;
+	m->soc_rem = 0;
+	m->unc = 0;
+	m->p = FG_MODEL_P_MAX;
+	m->last_ms = now_ms;
+	m->valid = false;
+}
+
+void fg_model_set_load(struct fg_model *m, battery_load_source_t source,
+		       uint32_t current_ua, uint32_t now_ms)
+{
+	if (source >= BATTERY_LOAD_COUNT)
+		return;
+	fg_model_advance(m, now_ms);
+	m->loads_ua[source] = current_ua;
+	fg_model_sum_loads(m);
+}
+
+void fg_model_set_temperature(struct fg_model *m, int16_t temperature,
+			      uint32_t now_ms)
+{
+	if (temperature < FG_MODEL_T_MIN)
+		temperature = FG_MODEL_T_MIN;
+	if (temperature > FG_MODEL_T_MAX)
+		temperature = FG_MODEL_T_MAX;
+	if (temperature == m->temperature)
+		return;
+	fg_model_advance(m, now_ms);
+	m->temperature = temperature;
+	fg_model_scale(m);
+}
+
+uint32_t fg_model_update(struct fg_model *m, const uint16_t *table,
+			 uint16_t voltage_mv, bool charging, uint32_t now_ms)
+{
+	uint32_t ocv_uv = (uint32_t)voltage_mv * 1000;
+	uint32_t sigma_uv = FG_MODEL_ADC_NOISE_UV;
+	uint16_t uv_per_bp;
+	uint32_t measured;
+	uint32_t r;
+	uint32_t k;
+
+	if (charging) {
+		/* Unknown charger current: no coulomb counting nor load drop */
+		m->last_ms = now_ms;
+		m->vrc_uv = 0;
+		sigma_uv += FG_MODEL_CHARGE_UV;
+	} else {
+		int32_t drop_uv;
+
+		fg_model_advance(m, now_ms);
+		drop_uv = m->current_ua * m->r0_mohm / 1000 + m->vrc_uv;
+		ocv_uv += drop_uv;
+		sigma_uv += (drop_uv < 0 ? -drop_uv : drop_uv) / 4;
+	}
+
+	measured = fg_lut_get_soc_ppm(table, (ocv_uv + 500) / 1000,
+				      &uv_per_bp);
+
+	/* Measure variance, in (0.01 %)^2 */
+	r = sigma_uv / uv_per_bp;
+	r = r < 10000 ? r * r : FG_MODEL_R_MAX;
+
+	/* Follow the charge table, as nothing else tells how fast it fills */
+	if (!m->valid || charging) {
+		m->soc = measured;
+		m->soc_rem = 0;
+		m->unc = 0;
+		m->p = r < FG_MODEL_P_MAX ? r : FG_MODEL_P_MAX;
+		m->valid = true;
+		return m->soc;
+	}
+
+	/* Coulomb counting error since the last measure, in (0.01 %)^2 */
+	m->unc /= 100;
+	m->p += m->unc < 1000 ? m->unc * m->unc : FG_MODEL_P_MAX;
+	if (m->p > FG_MODEL_P_MAX)
+		m->p = FG_MODEL_P_MAX;
+	m->unc = 0;
+
+	/* Kalman gain in Q10 */
+	k = (m->p << 10) / (m->p + r);
+	m->soc += ((int32_t)measured - m->soc) * (int32_t)k / 1024;
+	m->p -= (m->p * k) >> 10;
+
+	if (m->soc < 0)
+		m->soc = 0;
+	if (m->soc > FG_LUT_SOC_PPM_FULL)
+		m->soc = FG_LUT_SOC_PPM_FULL;
+
+	return m->soc;
+}
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __FG_MODEL_H__
+#define __FG_MODEL_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "services/battery_service/battery_service.h"
+#include "fg_lut.h"
+
+/*
+ * Equivalent circuit fuel gauge.
+ *
+ * The battery is an open circuit voltage source, function of the state of
+ * charge, in series with a resistance R0 and a R1 // C1 polarization pair:
+ *
+ *      V = OCV(soc) - I.R0 - Vrc       dVrc/dt = (I.R1 - Vrc) / (R1.C1)
+ *
+ * The current I is the base load of the system plus the hints of the power
+ * hungry subsystems. Between two voltage measures the state of charge is
+ * coulomb counted from I. On a measure, the load drop is added back to the
+ * voltage to get the open circuit voltage, which the lookup table turns into
+ * a state of charge, and both estimations are blended by a scalar Kalman
+ * gain: the measure weighs less under heavy load and where the table is
+ * flat, the coulomb counting weighs less as time passes.
+ *
+ * All the computations are integer: current in uA, time in ms, resistance
+ * in mOhm, voltage in uV and state of charge in ppm of the capacity.
+ */
+
+/** Battery characteristics at 25 C */
+struct fg_model_params {
+	uint32_t capacity_mas;  /*!< Capacity, in mA.s */
+	uint16_t r0_mohm;       /*!< Series resistance */
+	uint16_t r1_mohm;       /*!< Polarization resistance */
+	uint16_t tau_s;         /*!< Polarization time constant R1.C1 */
+	uint16_t base_ua;       /*!< System load not covered by the hints */
+};
+
+struct fg_model {
+	const struct fg_model_params *params;
+	uint32_t loads_ua[BATTERY_LOAD_COUNT];
+	uint32_t current_ua;    /* base load and hints */
+	int16_t temperature;
+	uint16_t r0_mohm;       /* at temperature */
+	uint16_t r1_mohm;       /* at temperature */
+	uint32_t capacity_mas;  /* at temperature */
+	int32_t vrc_uv;         /* polarization voltage */
+	int32_t soc;            /* ppm */
+	uint32_t soc_rem;       /* coulomb counting remainder, nA.s */
+	uint32_t unc;           /* coulomb counting uncertainty since the
+	                         * last measure, ppm */
+	uint32_t p;             /* variance of soc, (0.01 %)^2 */
+	uint32_t last_ms;
+	bool valid;             /* soc initialized by a measure */
+};
+
+/**
+ * Initialize the model, at 25 C and with the base load only.
+ *
+ * The state of charge is unknown until the first fg_model_update().
+ */
+void fg_model_init(struct fg_model *m, const struct fg_model_params *params,
+		   uint32_t now_ms);
+
+/**
+ * Set the current drawn by a subsystem, from now on.
+ */
+void fg_model_set_load(struct fg_model *m, battery_load_source_t source,
+		       uint32_t current_ua, uint32_t now_ms);
+
+/**
+ * Set the battery temperature, from now on.
+ *
+ * The resistances rise and the capacity shrinks in the cold.
+ */
+void fg_model_set_temperature(struct fg_model *m, int16_t temperature,
+			      uint32_t now_ms);
+
+/**
+ * Correct the state of charge with a battery voltage measure.
+ *
+ * While charging the charger current is unknown: the coulomb counting stops
+ * and the state of charge follows the charge table, which already accounts
+ * for the charger.
+ *
+ * @param table Lookup table of the charging state and temperature
+ * @param voltage_mv Measured battery voltage
+ * @param charging true if the battery is being charged
+ * @return state of charge, in ppm
+ */
+uint32_t fg_model_update(struct fg_model *m, const uint16_t *table,
+			 uint16_t voltage_mv, bool charging, uint32_t now_ms);
+
+static inline uint8_t fg_model_get_soc(const struct fg_model *m)
+{
+	return (m->soc + FG_LUT_SOC_PPM_FULL / 200) /
+	       (FG_LUT_SOC_PPM_FULL / 100);
+}
+
+#endif /* __FG_MODEL_H__ */
@@ -27,6 +27,7 @@
 # POSSIBILITY OF SUCH DAMAGE.
 
 obj-$(CONFIG_SERVICES_QUARK_SE_GPIO_IMPL)       += gpio_service.o
+obj-$(CONFIG_SERVICES_QUARK_SE_GPIO_IMPL)       += gpio_edge.o
 ifeq ($(CONFIG_SERVICES_QUARK_SE_GPIO),y)
 obj-y                                      += gpio_service_api.o
 endif
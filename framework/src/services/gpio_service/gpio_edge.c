@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "util/compiler.h"
+#include "gpio_edge.h"
+
+void gpio_edge_ring_init(struct gpio_edge_ring *ring,
+			 struct gpio_service_edge *edges, uint16_t size)
+{
+	ring->edges = edges;
+	ring->mask = size - 1;
+	ring->head = 0;
+	ring->tail = 0;
+	ring->lost = 0;
+	ring->lost_seen = 0;
+}
+
+uint16_t gpio_edge_push(struct gpio_edge_ring *ring, bool state,
+			uint32_t timestamp)
+{
+	uint16_t head = ring->head;
+	uint16_t count = head - ring->tail;
+	struct gpio_service_edge *edge;
+
+	if (count > ring->mask) {
+		ring->lost++;
+		return 0;
+	}
+	edge = &ring->edges[head & ring->mask];
+	edge->timestamp = timestamp;
+	edge->state = state;
+	/* The edge must be written before it is published */
+	BARRIER();
+	ring->head = head + 1;
+	return count + 1;
+}
+
+uint16_t gpio_edge_pop(struct gpio_edge_ring *ring,
+		       struct gpio_service_edge *edges, uint16_t max,
+		       uint16_t *lost)
+{
+	uint16_t tail = ring->tail;
+	uint16_t count = ring->head - tail;
+	uint16_t i;
+
+	/* Read the edges after head */
+	BARRIER();
+	if (count > max)
+		count = max;
+	for (i = 0; i < count; i++)
+		edges[i] = ring->edges[(tail + i) & ring->mask];
+	BARRIER();
+	ring->tail = tail + count;
+
+	*lost = ring->lost - ring->lost_seen;
+	ring->lost_seen += *lost;
+	return count;
+}
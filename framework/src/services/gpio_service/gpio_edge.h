@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __GPIO_EDGE_H__
+#define __GPIO_EDGE_H__
+
+#include <stdint.h>
+#include "services/gpio_service/gpio_service.h"
+
+/*
+ * Ring of the edges of a listened GPIO.
+ *
+ * The edges are written by the GPIO interrupt and read by the service: the
+ * ISR only moves head and the overflow counter, the service only moves tail,
+ * so that no lock is needed. When the ring is full, new edges are dropped
+ * and counted.
+ */
+struct gpio_edge_ring {
+	struct gpio_service_edge *edges;
+	uint16_t mask;                  /* size - 1, size is a power of 2 */
+	volatile uint16_t head;         /* written by the ISR only */
+	volatile uint16_t tail;         /* written by the service only */
+	volatile uint16_t lost;         /* written by the ISR only */
+	uint16_t lost_seen;             /* written by the service only */
+};
+
+/*
+ * Initialize a ring of size edges (a power of 2).
+ */
+void gpio_edge_ring_init(struct gpio_edge_ring *ring,
+			 struct gpio_service_edge *edges, uint16_t size);
+
+/*
+ * Record an edge, from the GPIO interrupt.
+ *
+ * Returns the number of edges in the ring, or 0 if the ring is full and the
+ * edge is lost.
+ */
+uint16_t gpio_edge_push(struct gpio_edge_ring *ring, bool state,
+			uint32_t timestamp);
+
+/*
+ * Move up to max edges out of the ring, oldest first.
+ *
+ * Returns the number of edges, and sets lost to the number of edges
+ * dropped since the previous call.
+ */
+uint16_t gpio_edge_pop(struct gpio_edge_ring *ring,
+		       struct gpio_service_edge *edges, uint16_t max,
+		       uint16_t *lost);
+
+static inline uint16_t gpio_edge_count(const struct gpio_edge_ring *ring)
+{
+	return (uint16_t)(ring->head - ring->tail);
+}
+
+#endif /* __GPIO_EDGE_H__ */
@@ -29,13 +29,16 @@
  */
 
 #include <stdint.h>
+#include <zephyr.h>
 #include "cfw/cfw_service.h"
 #include "drivers/gpio.h"
 #include "gpio_service_private.h"
+#include "gpio_edge.h"
 #include "infra/log.h"
 #include "infra/device.h"
 #include "infra/time.h"
 #include "util/assert.h"
+#include "util/misc.h"
 #include "machine.h"
 
 /**
@@ -46,6 +49,13 @@ struct gpio_service_data {
 	struct td_device **gpio_devs;
 };
 
+/* Delivery state of the edges of a listened gpio */
+enum {
+	FLUSH_IDLE,     /* no edge waiting */
+	FLUSH_ARMED,    /* edges waiting for the latency timer */
+	FLUSH_POSTED    /* flush message sent to the service */
+};
+
 /**
  * \brief gpio listen management structure
  */
@@ -53,6 +63,12 @@ struct gpio_service_listen_priv {
 	conn_handle_t *conn;
 	void *priv;
 	uint8_t pin;
+	volatile uint8_t flush;
+	bool closing;           /* unlistened, free on flush */
+	uint16_t max_latency;   /* longest delay of an edge, in ms */
+	T_TIMER timer;
+	struct gpio_edge_ring ring;
+	struct gpio_service_edge edges[CONFIG_GPIO_SERVICE_EDGES];
 };
 
 static void gpio_client_connected(conn_handle_t *instance);
@@ -188,28 +204,122 @@ static void gpio_set_default_config(gpio_cfg_data_t *config)
 	config->gpio_cb_arg = NULL;
 }
 
+/* Ask the service to send the waiting edges */
+static void gpio_service_post_flush(struct gpio_service_listen_priv *listen)
+{
+	struct cfw_message *msg = cfw_alloc_message(sizeof(*msg));
+
+	CFW_MESSAGE_LEN(msg) = sizeof(*msg);
+	CFW_MESSAGE_ID(msg) = MSG_ID_GPIO_FLUSH_REQ;
+	CFW_MESSAGE_TYPE(msg) = TYPE_REQ;
+	CFW_MESSAGE_SRC(msg) = listen->conn->svc->port_id;
+	CFW_MESSAGE_DST(msg) = listen->conn->svc->port_id;
+	CFW_MESSAGE_PRIV(msg) = listen;
+	CFW_MESSAGE_CONN(msg) = listen->conn;
+	listen->flush = FLUSH_POSTED;
+	cfw_send_message(msg);
+}
+
+static void gpio_service_timer_cb(void *priv)
+{
+	struct gpio_service_listen_priv *listen =
+		(struct gpio_service_listen_priv *)priv;
+	uint32_t flags = irq_lock();
+
+	if (listen->flush == FLUSH_ARMED)
+		gpio_service_post_flush(listen);
+	irq_unlock(flags);
+}
+
+/*
+ * Called from the gpio interrupt: record the edge, and make sure that it is
+ * sent within the latency of the listener. A half full ring is sent at once.
+ */
 static void gpio_service_callback(bool state, void *priv)
 {
-	struct gpio_service_listen_priv *service_priv =
+	struct gpio_service_listen_priv *listen =
 		(struct gpio_service_listen_priv *)priv;
+	uint16_t count;
+
+	count = gpio_edge_push(&listen->ring, state, get_uptime_32k());
+	if (listen->flush == FLUSH_POSTED || !count)
+		return;
+
+	if (count <= CONFIG_GPIO_SERVICE_EDGES / 2) {
+		if (listen->flush == FLUSH_ARMED)
+			return;
+		if (listen->max_latency) {
+			listen->flush = FLUSH_ARMED;
+			timer_start(listen->timer, listen->max_latency, NULL);
+			return;
+		}
+	} else if (listen->flush == FLUSH_ARMED) {
+		timer_stop(listen->timer);
+	}
+	gpio_service_post_flush(listen);
+}
 
-	gpio_service_listen_evt_msg_t *msg;
-
-	msg = (gpio_service_listen_evt_msg_t *)cfw_alloc_message(sizeof(*msg));
-	CFW_MESSAGE_LEN((struct cfw_message *)msg) = sizeof(*msg);
-	CFW_MESSAGE_ID((struct cfw_message *)msg) = MSG_ID_GPIO_SERVICE_EVT;
-	CFW_MESSAGE_TYPE((struct cfw_message *)msg) = TYPE_EVT;
-	CFW_MESSAGE_SRC((struct cfw_message *)msg) =
-		service_priv->conn->svc->port_id;
-	CFW_MESSAGE_DST((struct cfw_message *)msg) =
-		service_priv->conn->client_port;
-	CFW_MESSAGE_PRIV((struct cfw_message *)msg) = service_priv->priv;
-	CFW_MESSAGE_CONN((struct cfw_message *)msg) = service_priv->conn;
-	msg->pin_state = state;
-	msg->index = service_priv->pin;
-	msg->timestamp = get_uptime_ms();
+static void gpio_service_listen_free(struct gpio_service_listen_priv *listen)
+{
+	uint32_t flags = irq_lock();
+	bool posted = listen->flush == FLUSH_POSTED;
+
+	if (listen->flush == FLUSH_ARMED)
+		timer_stop(listen->timer);
+	listen->closing = true;
+	irq_unlock(flags);
+
+	if (listen->timer)
+		timer_delete(listen->timer);
+	/* A posted flush message still refers to the listener */
+	if (!posted)
+		bfree(listen);
+}
 
-	cfw_send_message(msg);
+/* Send all the waiting edges of a listened gpio in one event */
+static void handle_flush(struct cfw_message *msg)
+{
+	struct gpio_service_listen_priv *listen =
+		(struct gpio_service_listen_priv *)CFW_MESSAGE_PRIV(msg);
+	gpio_service_listen_evt_msg_t *evt;
+	struct gpio_service_edge *last;
+	uint16_t count, lost;
+
+	if (listen->closing) {
+		bfree(listen);
+		return;
+	}
+	/* Edges recorded from now on need a new flush */
+	listen->flush = FLUSH_IDLE;
+	count = gpio_edge_count(&listen->ring);
+	if (!count)
+		return;
+
+	evt = (gpio_service_listen_evt_msg_t *)cfw_alloc_message(
+		sizeof(*evt) + count * sizeof(evt->edges[0]));
+	count = gpio_edge_pop(&listen->ring, evt->edges, count, &lost);
+	last = &evt->edges[count - 1];
+
+	CFW_MESSAGE_LEN((struct cfw_message *)evt) =
+		sizeof(*evt) + count * sizeof(evt->edges[0]);
+	CFW_MESSAGE_ID((struct cfw_message *)evt) = MSG_ID_GPIO_SERVICE_EVT;
+	CFW_MESSAGE_TYPE((struct cfw_message *)evt) = TYPE_EVT;
+	CFW_MESSAGE_SRC((struct cfw_message *)evt) =
+		listen->conn->svc->port_id;
+	CFW_MESSAGE_DST((struct cfw_message *)evt) =
+		listen->conn->client_port;
+	CFW_MESSAGE_PRIV((struct cfw_message *)evt) = listen->priv;
+	CFW_MESSAGE_CONN((struct cfw_message *)evt) = listen->conn;
+	evt->index = listen->pin;
+	evt->pin_state = last->state;
+	evt->timestamp = get_uptime_ms() -
+			 (uint32_t)(((uint64_t)(get_uptime_32k() -
+						last->timestamp) * 1000) >> 15);
+	evt->status = DRV_RC_OK;
+	evt->lost = lost;
+	evt->nb_edges = count;
+
+	cfw_send_message(evt);
 }
 
 /**
@@ -465,7 +575,7 @@ static void handle_unlisten(struct cfw_message *	msg,
 
 	// Listen is now disabled, free callback argument
 	if (priv != NULL) {
-		bfree(priv);
+		gpio_service_listen_free(priv);
 	}
 	resp->status = DRV_RC_OK;
 
@@ -526,6 +636,24 @@ static void handle_listen(struct cfw_message *		msg,
 	priv->priv = ((gpio_listen_req_msg_t *)(msg))->header.priv;
 	priv->conn = ((gpio_listen_req_msg_t *)(msg))->header.conn;
 	priv->pin = req->index;
+	priv->flush = FLUSH_IDLE;
+	priv->closing = false;
+	priv->max_latency = req->max_latency;
+	priv->timer = NULL;
+	/* The ring indexes wrap on the size, and nb_edges is 8 bit */
+	BUILD_BUG_ON(!IS_POWER_OF_TWO(CONFIG_GPIO_SERVICE_EDGES));
+	BUILD_BUG_ON(CONFIG_GPIO_SERVICE_EDGES > 128);
+	gpio_edge_ring_init(&priv->ring, priv->edges,
+			    CONFIG_GPIO_SERVICE_EDGES);
+	if (priv->max_latency) {
+		priv->timer = timer_create(gpio_service_timer_cb, priv,
+					   priv->max_latency, false, false,
+					   &err);
+		if (!priv->timer) {
+			ret = DRV_RC_FAIL;
+			goto exit_free_priv;
+		}
+	}
 
 	// Default configuration for interrupts
 	gpio_set_default_config(&config);
@@ -565,13 +693,17 @@ static void handle_listen(struct cfw_message *		msg,
 			 "gpio_svc: Failed to configure gpio %d (err=%d)\n",
 			 svc->svc.service_id,
 			 ret);
+		goto exit_free_priv;
 	}
 
 	resp->status = ret;
 	goto send_rsp;
 
 exit_free_priv:
+	if (priv->timer)
+		timer_delete(priv->timer);
 	bfree(priv);
+	resp->status = ret;
 send_rsp:
 	cfw_send_message(resp);
 }
@@ -600,6 +732,9 @@ static void gpio_handle_message(struct cfw_message *msg, void *param)
 	case MSG_ID_GPIO_UNLISTEN_REQ:
 		handle_unlisten(msg, gpio_svc);
 		break;
+	case MSG_ID_GPIO_FLUSH_REQ:
+		handle_flush(msg);
+		break;
 	default:
 		cfw_print_default_handle_error_msg(LOG_MODULE_GPIO_SVC,
 						   CFW_MESSAGE_ID(
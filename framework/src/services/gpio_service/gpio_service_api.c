@@ -86,6 +86,13 @@ void gpio_service_get_bank_state(cfw_service_conn_t *service_conn, void *priv)
 void gpio_service_listen(cfw_service_conn_t *c, uint8_t pin,
 			 gpio_service_isr_mode_t mode, uint8_t debounce,
 			 void *priv)
+{
+	gpio_service_listen_batch(c, pin, mode, debounce, 0, priv);
+}
+
+void gpio_service_listen_batch(cfw_service_conn_t *c, uint8_t pin,
+			       gpio_service_isr_mode_t mode, uint8_t debounce,
+			       uint16_t max_latency, void *priv)
 {
 	struct cfw_message *msg = cfw_alloc_message_for_service(
 		c, MSG_ID_GPIO_LISTEN_REQ,
@@ -96,6 +103,7 @@ void gpio_service_listen(cfw_service_conn_t *c, uint8_t pin,
 	req->index = pin;
 	req->mode = mode;
 	req->debounce = debounce;
+	req->max_latency = max_latency;
 	cfw_send_message(msg);
 }
 
@@ -46,6 +46,8 @@
 #define MSG_ID_GPIO_UNLISTEN_REQ    (MSG_ID_GPIO_SERVICE_BASE + 4)
 /** service internal message ID for gpio_service_get_bank_state */
 #define MSG_ID_GPIO_GET_BANK_REQ    (MSG_ID_GPIO_SERVICE_BASE + 5)
+/** service internal message ID to send the edges of a listened gpio */
+#define MSG_ID_GPIO_FLUSH_REQ       (MSG_ID_GPIO_SERVICE_BASE + 6)
 
 /** Request message structure for gpio_service_configure */
 typedef struct gpio_configure_req_msg {
@@ -73,6 +75,7 @@ typedef struct gpio_listen_req_msg {
 	uint8_t index;                     /*!< index of GPIO pin to monitor */
 	gpio_service_isr_mode_t mode;      /*!< interrupt mode */
 	gpio_service_debounce_mode_t debounce; /*!< debounce mode */
+	uint16_t max_latency;              /*!< longest delay of an edge, in ms */
 } gpio_listen_req_msg_t;
 
 /** Request message structure for gpio_service_unlisten */
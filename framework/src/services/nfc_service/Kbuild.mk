@@ -2,4 +2,5 @@ obj-$(CONFIG_NFC_SERVICE) += nfc_service_api.o
 obj-$(CONFIG_NFC_SERVICE_IMPL) += nfc_service.o
 obj-$(CONFIG_NFC_STN54_SUPPORT) += nfc_stn54_sm.o
 obj-$(CONFIG_NFC_STN54_SUPPORT) += nfc_stn54_seq.o
+obj-$(CONFIG_NFC_STN54_FW_UPDATE) += nfc_stn54_fwu.o
 obj-$(CONFIG_NFC_STN54_SUPPORT) += nfc_stn54_tcmd.o
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "util/misc.h"
+#include "nfc_stn54_seq.h"
+#include "nfc_stn54_fwu.h"
+
+/* PCB of the commands: data frame, no retransmission, no CRC */
+#define FWU_PCB (PCB_TYPE_DATAFRAME | PCB_DATAFRAME_RETRANSMIT_NO | \
+		 PCB_FRAME_CRC_INFO_NOTPRESENT)
+
+void nfc_fwu_init(struct nfc_fwu *fwu, uint8_t *buf, uint16_t size,
+		  uint32_t offset, uint32_t len, nfc_fwu_read_t read,
+		  void *priv)
+{
+	fwu->read = read;
+	fwu->priv = priv;
+	fwu->buf = buf;
+	fwu->size = size;
+	fwu->pos = 0;
+	fwu->end = 0;
+	fwu->offset = offset;
+	fwu->remaining = len;
+}
+
+/* Make sure that at least needed bytes are in the buffer after pos */
+static int fwu_fill(struct nfc_fwu *fwu, uint16_t needed)
+{
+	uint16_t avail = fwu->end - fwu->pos;
+	uint16_t len;
+
+	if (avail >= needed)
+		return 0;
+	if (needed > fwu->size || fwu->remaining < needed - avail)
+		/* Truncated image */
+		return -1;
+
+	/* Keep the unread bytes, and fill the rest of the buffer */
+	memmove(fwu->buf, &fwu->buf[fwu->pos], avail);
+	fwu->pos = 0;
+	fwu->end = avail;
+	len = MIN(fwu->size - avail, fwu->remaining);
+	if (fwu->read(fwu->offset, &fwu->buf[avail], len, fwu->priv))
+		return -1;
+	fwu->offset += len;
+	fwu->remaining -= len;
+	fwu->end += len;
+	return 0;
+}
+
+int nfc_fwu_next(struct nfc_fwu *fwu, uint8_t **frame, uint16_t *len,
+		 uint16_t *delay_ms)
+{
+	uint8_t *record;
+	uint16_t cmd_len;
+
+	if (!nfc_fwu_remaining(fwu))
+		return 0;
+
+	if (fwu_fill(fwu, 1))
+		return -1;
+	cmd_len = fwu->buf[fwu->pos];
+	if (!cmd_len || cmd_len + 2 > NFC_FWU_RECORD_MAX)
+		return -1;
+	if (fwu_fill(fwu, cmd_len + 2))
+		return -1;
+
+	record = &fwu->buf[fwu->pos];
+	fwu->pos += cmd_len + 2;
+
+	/* The PCB takes the place of the length byte */
+	record[0] = FWU_PCB;
+	*frame = record;
+	*len = cmd_len + 1;
+	*delay_ms = record[cmd_len + 1] * NFC_FWU_DELAY_UNIT;
+	return 1;
+}
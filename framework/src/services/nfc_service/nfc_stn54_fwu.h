@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __NFC_STN54_FWU_H__
+#define __NFC_STN54_FWU_H__
+
+#include <stdint.h>
+
+/*
+ * STN54 firmware image reader.
+ *
+ * The image is a list of records: a length byte, the command, and a delay
+ * byte giving the longest time the controller takes to process the command.
+ * Records are read from flash in large chunks into a read-ahead buffer, and
+ * returned as NDLC frames built in place: the PCB overwrites the length
+ * byte of the record, so that commands are never copied.
+ */
+
+/* Unit of the delay byte of the records, in ms */
+#define NFC_FWU_DELAY_UNIT 8
+
+/* Longest record: length byte, command (an NDLC frame holds the PCB and up
+ * to 254 bytes) and delay byte */
+#define NFC_FWU_RECORD_MAX (1 + 254 + 1)
+
+/*
+ * Read len bytes of the image at offset. Returns 0 on success.
+ */
+typedef int (*nfc_fwu_read_t)(uint32_t offset, uint8_t *buf, uint16_t len,
+			      void *priv);
+
+struct nfc_fwu {
+	nfc_fwu_read_t read;
+	void *priv;
+	uint8_t *buf;           /* read-ahead buffer */
+	uint16_t size;          /* read-ahead buffer size */
+	uint16_t pos;           /* next record in the buffer */
+	uint16_t end;           /* end of the data read in the buffer */
+	uint32_t offset;        /* offset of the next read */
+	uint32_t remaining;     /* bytes of the image not read yet */
+};
+
+/*
+ * Start reading an image of len bytes at offset, through a read-ahead
+ * buffer of size bytes (at least NFC_FWU_RECORD_MAX).
+ */
+void nfc_fwu_init(struct nfc_fwu *fwu, uint8_t *buf, uint16_t size,
+		  uint32_t offset, uint32_t len, nfc_fwu_read_t read,
+		  void *priv);
+
+/*
+ * Get the next command of the image, as an NDLC frame ready to be written
+ * to the controller. The frame is in the read-ahead buffer, and is valid
+ * until the next call.
+ *
+ * Returns 1 and sets frame, len and delay_ms; 0 at the end of the image;
+ * -1 on read error or malformed record.
+ */
+int nfc_fwu_next(struct nfc_fwu *fwu, uint8_t **frame, uint16_t *len,
+		 uint16_t *delay_ms);
+
+/*
+ * Number of bytes of the image not returned yet.
+ */
+static inline uint32_t nfc_fwu_remaining(const struct nfc_fwu *fwu)
+{
+	return fwu->remaining + fwu->end - fwu->pos;
+}
+
+#endif /* __NFC_STN54_FWU_H__ */
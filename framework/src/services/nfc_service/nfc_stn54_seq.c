@@ -40,8 +40,17 @@
 #ifdef CONFIG_NFC_STN54_FW_UPDATE
 #include <string.h>
 #include <drivers/spi_flash.h>
+#include "infra/time.h"
+#include "nfc_stn54_fwu.h"
+
+/* Size of the firmware image read-ahead buffer */
+#define FWU_READ_AHEAD_SIZE 1024
+
 static T_TIMER fwu_timer;
-static ndlc_msg_t tx_msg;
+static struct nfc_fwu fwu;
+static uint32_t fwu_sent_at;    /* time the last command was sent */
+static uint16_t fwu_delay;      /* longest processing time of the command */
+static bool fwu_pending;        /* last command not acknowledged yet */
 #endif
 
 static const uint8_t fdt_reg_tuned[] = { 0x84, 0x01, 0x00, 0x24, 0x82, 0x11,
@@ -116,15 +125,62 @@ static void fwu_timer_cb(void *param)
 	return;
 }
 
-int nfc_send_ndlc(uint8_t *buffer, int length)
+static int fwu_flash_read(uint32_t offset, uint8_t *buf, uint16_t len,
+			  void *priv)
+{
+	unsigned int retlen;
+
+	return spi_flash_read_byte((struct td_device *)priv, offset, len,
+				   &retlen, buf) != DRV_RC_OK;
+}
+
+void nfc_scn_fw_update_stop(void)
+{
+	if (fwu_timer)
+		timer_stop(fwu_timer);
+	fwu_pending = false;
+	if (fwu.buf) {
+		bfree(fwu.buf);
+		fwu.buf = NULL;
+	}
+}
+
+/*
+ * Send the next command of the image, or end the update. The controller
+ * response normally triggers the next command: the command delay is only
+ * the longest time to wait for it.
+ */
+static void fwu_send_next(void)
 {
-	ndlc_msg_t *msg = &tx_msg;
+	uint8_t *frame;
+	uint16_t len;
+	int ret;
+
+	timer_stop(fwu_timer);
+	fwu_pending = false;
+
+	ret = nfc_fwu_next(&fwu, &frame, &len, &fwu_delay);
+	if (ret > 0) {
+		if (nfc_stn54_write(frame, len) == DRV_RC_OK) {
+			fwu_sent_at = get_uptime_ms();
+			fwu_pending = true;
+			timer_start(fwu_timer, fwu_delay ? fwu_delay : 1, NULL);
+			pr_debug(LOG_MODULE_NFC, "c:%3db, d:%3dms, r:%5db",
+				 len - 1, fwu_delay, nfc_fwu_remaining(&fwu));
+			return;
+		}
+		ret = -1;
+	}
 
-	msg->pcb = PCB_TYPE_DATAFRAME |	\
-		   PCB_DATAFRAME_RETRANSMIT_NO | \
-		   PCB_FRAME_CRC_INFO_NOTPRESENT;
-	memcpy(msg->buffer, buffer, length);
-	return nfc_stn54_write((uint8_t *)msg, length + 1);
+	nfc_scn_fw_update_stop();
+	if (ret < 0) {
+		pr_error(LOG_MODULE_NFC, "Error - o:%d, r:%d)", fwu.offset,
+			 nfc_fwu_remaining(&fwu));
+		nfc_fsm_event_post(EV_NFC_FW_UPDATE_FAIL, NULL, NULL);
+	} else {
+		/* update done OK; do tuning */
+		nfc_fsm_event_post(EV_NFC_FW_UPDATE_DONE, NULL, NULL);
+	}
 }
 #endif
 
@@ -1079,10 +1135,10 @@ void nfc_scn_fw_update(bool start, uint8_t *rx_data, uint8_t len)
 #else
 	ndlc_msg_t *rx_msg = (ndlc_msg_t *)rx_data;
 	uint8_t *p_buffer = rx_msg->buffer;
-
-	static uint32_t r_offset;
-	static uint32_t len_to_do;
-	int status = DRV_RC_OK;
+	uint32_t r_offset;
+	uint32_t len_to_do;
+	uint32_t elapsed;
+	uint8_t *buf;
 
 	if (start) {
 		pr_info(LOG_MODULE_NFC, "scn: fw update start");
@@ -1092,7 +1148,22 @@ void nfc_scn_fw_update(bool start, uint8_t *rx_data, uint8_t len)
 		memcpy(&len_to_do, &rx_data[0 + sizeof(r_offset)],
 		       sizeof(len_to_do));
 
-		fwu_timer = timer_create(fwu_timer_cb, "", 250, 0, 0, NULL);
+		/* Release an update still in progress */
+		nfc_scn_fw_update_stop();
+
+		buf = balloc(FWU_READ_AHEAD_SIZE, NULL);
+		if (!buf) {
+			nfc_fsm_event_post(EV_NFC_FW_UPDATE_FAIL, NULL, NULL);
+			return;
+		}
+		nfc_fwu_init(&fwu, buf, FWU_READ_AHEAD_SIZE, r_offset,
+			     len_to_do, fwu_flash_read,
+			     &pf_sba_device_flash_spi0);
+		fwu_pending = false;
+
+		if (!fwu_timer)
+			fwu_timer = timer_create(fwu_timer_cb, "", 250, 0, 0,
+						 NULL);
 
 		/* simulate a timer event, to start the update */
 		nfc_fsm_event_post(EV_NFC_SCN_TIMER, (void *)3, NULL);
@@ -1100,60 +1171,37 @@ void nfc_scn_fw_update(bool start, uint8_t *rx_data, uint8_t len)
 		return;
 	}
 
-	if (rx_msg->pcb == 0x84) {
-		/* do nothing with incoming data; we don't care for now */
-	} else if (rx_msg->pcb == TIMER_MESSAGE_TYPE) {
-		if (p_buffer[0] == 0x03) {
-			if (len_to_do > 0) {
-				uint8_t r_buff[253 + 2];
-				uint16_t cmd_len;
-				uint8_t cmd_delay;
-				unsigned int retlen;
-				struct td_device *spidev =
-					(struct td_device *)&
-					pf_sba_device_flash_spi0;
-
-				spi_flash_read_byte(spidev, r_offset, 1,
-						    &retlen,
-						    (uint8_t *)r_buff);
-				spi_flash_read_byte(spidev, r_offset + 1,
-						    r_buff[0] + 1, &retlen,
-						    (uint8_t *)(r_buff + 1));
-
-				cmd_len = r_buff[0];
-				cmd_delay = r_buff[cmd_len + 1];
-				status = nfc_send_ndlc(&r_buff[1], cmd_len);
-				if (status == DRV_RC_OK) {
-					cmd_delay = r_buff[cmd_len + 1];
-					r_offset += (cmd_len + 1 + 1); /*len + cmd + delay */
-					len_to_do -= (cmd_len + 1 + 1); // The complete command (length command) + byte of length_command (1) + byte of Delay (1)
-					timer_start(fwu_timer, 8 * cmd_delay,
-						    NULL);
-					pr_info(LOG_MODULE_NFC,
-						"c:%3db, d:%3dms, r:%5db",
-						cmd_len, 8 *
-						cmd_delay,
-						len_to_do);
-				}
-			}
-
-			if (len_to_do > 0 && status != DRV_RC_OK) {
-				timer_stop(fwu_timer);
-				pr_error(LOG_MODULE_NFC,
-					 "Error - o:%d, r:%d, s:%d)", r_offset,
-					 len_to_do,
-					 status);
-				nfc_fsm_event_post(EV_NFC_FW_UPDATE_FAIL, NULL,
-						   NULL);
-			}
+	if (!fwu.buf) {
+		/* Update over, late event */
+		return;
+	}
 
-			if (len_to_do <= 0) {
-				/* update done OK; do tuning */
-				nfc_fsm_event_post(EV_NFC_FW_UPDATE_DONE, NULL,
-						   NULL);
-			}
+	if ((rx_msg->pcb & PCB_TYPE_MASK) == PCB_TYPE_DATAFRAME) {
+		/* Only a response of the controller tells that the command is
+		 * processed: notifications and HCI data are ignored */
+		if (!fwu_pending ||
+		    (p_buffer[NCI_TYPE_OFFSET] & NCI_MT_MASK) != NCI_MT_RSP)
+			return;
+		if (p_buffer[NCI_PAYLOAD_OFFSET + 1] != NCI_STATUS_OK) {
+			pr_error(LOG_MODULE_NFC, "Error - o:%d, s:%d",
+				 fwu.offset, p_buffer[NCI_PAYLOAD_OFFSET + 1]);
+			nfc_scn_fw_update_stop();
+			nfc_fsm_event_post(EV_NFC_FW_UPDATE_FAIL, NULL, NULL);
+			return;
 		}
+	} else if (rx_msg->pcb == TIMER_MESSAGE_TYPE && p_buffer[0] == 0x03) {
+		/* A timer event posted before the last command was sent is
+		 * late: wait for the end of the command delay */
+		elapsed = get_uptime_ms() - fwu_sent_at;
+		if (fwu_pending && elapsed < fwu_delay) {
+			timer_start(fwu_timer, fwu_delay - elapsed, NULL);
+			return;
+		}
+	} else {
+		return;
 	}
+
+	fwu_send_next();
 #endif
 }
 
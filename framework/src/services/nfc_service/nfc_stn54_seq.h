@@ -69,6 +69,10 @@
 #define HCI_2ND_BYTE_OFFSET   0x04
 
 #define NCI_FRAME_TYPE_MASK   0x7F
+
+/* Message type of a control packet */
+#define NCI_MT_MASK           0xE0
+#define NCI_MT_RSP            0x40
 #define NCI_MAX_FRAME_SIZE    0xfa
 
 /* GID + type */
@@ -193,6 +197,8 @@ void nfc_scn_get_config(bool start, uint8_t *rx_data, uint8_t len);
 void nfc_scn_set_config(bool start, uint8_t *rx_data, uint8_t len);
 void nfc_scn_set_mode(bool start, uint8_t *rx_data, uint8_t len);
 void nfc_scn_fw_update(bool start, uint8_t *rx_data, uint8_t len);
+/* Stop the firmware update timer and release its buffer */
+void nfc_scn_fw_update_stop(void);
 void nfc_scn_raw_write(bool start, uint8_t *rx_data, uint8_t len);
 void nfc_scn_ams_read_reg(bool start, uint8_t *rx_data, uint8_t len);
 void nfc_scn_ams_write_reg(bool start, uint8_t *rx_data, uint8_t len);
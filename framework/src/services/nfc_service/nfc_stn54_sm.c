@@ -304,6 +304,13 @@ static void nfc_fsm_run(struct fsm_event_message *evt)
 				if (fsm_table[i].action != NULL) {
 					previous_state = state;
 					state = (fsm_table[i].action)(evt);
+#ifdef CONFIG_NFC_STN54_FW_UPDATE
+					/* Release the update resources when it
+					 * ends or is aborted */
+					if (previous_state == ST_FW_UPDATE &&
+					    state != ST_FW_UPDATE)
+						nfc_scn_fw_update_stop();
+#endif
 					if (previous_state != state) {
 						pr_info(
 							LOG_MODULE_NFC,
@@ -185,6 +185,121 @@ static void handle_remove_property(struct cfw_message *msg)
 	cfw_send_message(rsp);
 }
 
+/* Handle for a Read Multiple Properties request message */
+static void handle_read_multi_property(struct cfw_message *msg)
+{
+	read_multi_property_req_msg_t *req =
+		(read_multi_property_req_msg_t *)msg;
+	properties_service_read_multi_rsp_msg_t *rsp;
+	uint32_t items_size = 0;
+	uint16_t len;
+	bool persistent;
+	int i;
+
+	if (req->nb_items > PROPERTIES_SERVICE_MAX_MULTI_ITEMS) {
+		rsp = (properties_service_read_multi_rsp_msg_t *)
+		      cfw_alloc_rsp_msg(
+			msg, MSG_ID_PROP_SERVICE_READ_MULTI_RSP, sizeof(*rsp));
+		rsp->status = DRV_RC_INVALID_CONFIG;
+		rsp->nb_items = 0;
+		rsp->items_size = 0;
+		cfw_msg_free(msg);
+		cfw_send_message(rsp);
+		return;
+	}
+
+	/* Compute the size of the response first */
+	for (i = 0; i < req->nb_items; i++) {
+		len = 0;
+		properties_storage_get_info(
+			SERVICE_ID_PROPERTY_ID_TO_KEY(req->ids[i].service_id,
+						      req->ids[i].property_id),
+			&len, &persistent);
+		items_size += PROPERTIES_SERVICE_ITEM_SIZE(len);
+	}
+
+	rsp = (properties_service_read_multi_rsp_msg_t *)
+	      cfw_alloc_rsp_msg(
+		msg, MSG_ID_PROP_SERVICE_READ_MULTI_RSP,
+		sizeof(*rsp) + items_size);
+	properties_service_item_t *item =
+		(properties_service_item_t *)rsp->start_of_items;
+
+	rsp->status = DRV_RC_OK;
+	rsp->nb_items = req->nb_items;
+	rsp->items_size = items_size;
+	for (i = 0; i < req->nb_items; i++) {
+		uint16_t read_len;
+		properties_storage_status_t ret = properties_storage_get(
+			SERVICE_ID_PROPERTY_ID_TO_KEY(req->ids[i].service_id,
+						      req->ids[i].property_id),
+			item->value, PROPERTIES_STORAGE_MAX_VALUE_LEN,
+			&read_len);
+
+		item->service_id = req->ids[i].service_id;
+		item->property_id = req->ids[i].property_id;
+		switch (ret) {
+		case PROPERTIES_STORAGE_KEY_NOT_FOUND_ERROR:
+			item->status = DRV_RC_INVALID_OPERATION;
+			break;
+		case PROPERTIES_STORAGE_SUCCESS:
+			item->status = DRV_RC_OK;
+			break;
+		default:
+			item->status = DRV_RC_FAIL;
+			rsp->status = DRV_RC_FAIL;
+		}
+		item->property_size = item->status == DRV_RC_OK ? read_len : 0;
+		item = PROPERTIES_SERVICE_NEXT_ITEM(item);
+	}
+
+	cfw_msg_free(msg);
+	cfw_send_message(rsp);
+}
+
+/* Handle for a Write Multiple Properties request message */
+static void handle_write_multi_property(struct cfw_message *msg)
+{
+	write_multi_property_req_msg_t *req =
+		(write_multi_property_req_msg_t *)msg;
+	properties_storage_item_t items[PROPERTIES_SERVICE_MAX_MULTI_ITEMS];
+	properties_service_item_t *item =
+		(properties_service_item_t *)req->start_of_items;
+	properties_storage_status_t ret = PROPERTIES_STORAGE_INVALID_ARG;
+
+	if (req->nb_items <= PROPERTIES_SERVICE_MAX_MULTI_ITEMS) {
+		for (int i = 0; i < req->nb_items; i++) {
+			items[i].key = SERVICE_ID_PROPERTY_ID_TO_KEY(
+				item->service_id, item->property_id);
+			items[i].buf = item->value;
+			items[i].len = item->property_size;
+			item = PROPERTIES_SERVICE_NEXT_ITEM(item);
+		}
+		ret = properties_storage_set_batch(
+			items, req->nb_items,
+			req->factory_reset_persistent);
+	}
+
+	properties_service_write_multi_rsp_msg_t *rsp =
+		(properties_service_write_multi_rsp_msg_t *)cfw_alloc_rsp_msg(
+			msg,
+			MSG_ID_PROP_SERVICE_WRITE_MULTI_RSP,
+			sizeof(*rsp));
+
+	switch (ret) {
+	case PROPERTIES_STORAGE_SUCCESS:
+		rsp->status = DRV_RC_OK;
+		break;
+	case PROPERTIES_STORAGE_INVALID_ARG:
+		rsp->status = DRV_RC_INVALID_CONFIG;
+		break;
+	default:
+		rsp->status = DRV_RC_FAIL;
+	}
+
+	cfw_msg_free(msg);
+	cfw_send_message(rsp);
+}
 
 static void handle_request(struct cfw_message *msg, void *param)
 {
@@ -201,6 +316,12 @@ static void handle_request(struct cfw_message *msg, void *param)
 	case MSG_ID_PROP_SERVICE_ADD_PROP_REQ:
 		handle_add_property(msg);
 		break;
+	case MSG_ID_PROP_SERVICE_READ_MULTI_PROP_REQ:
+		handle_read_multi_property(msg);
+		break;
+	case MSG_ID_PROP_SERVICE_WRITE_MULTI_PROP_REQ:
+		handle_write_multi_property(msg);
+		break;
 	default:
 		cfw_print_default_handle_error_msg(LOG_MODULE_MAIN,
 						   CFW_MESSAGE_ID(
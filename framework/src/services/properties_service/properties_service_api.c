@@ -105,3 +105,52 @@ void properties_service_remove(cfw_service_conn_t *conn, uint16_t service_id,
 	req->property_id = property_id;
 	cfw_send_message(msg);
 }
+
+void properties_service_read_multi(cfw_service_conn_t *			conn,
+				   const properties_service_id_t *	ids,
+				   uint8_t				nb_items,
+				   void *				priv)
+{
+	struct cfw_message *msg = cfw_alloc_message_for_service(
+		conn, MSG_ID_PROP_SERVICE_READ_MULTI_PROP_REQ,
+		sizeof(read_multi_property_req_msg_t) +
+		nb_items * sizeof(properties_service_id_t), priv);
+	read_multi_property_req_msg_t *req =
+		(read_multi_property_req_msg_t *)msg;
+
+	req->nb_items = nb_items;
+	memcpy(req->ids, ids, nb_items * sizeof(properties_service_id_t));
+	cfw_send_message(msg);
+}
+
+void properties_service_write_multi(
+	cfw_service_conn_t *conn, const properties_service_write_item_t *items,
+	uint8_t nb_items, bool factory_reset_persistent, void *priv)
+{
+	uint16_t items_size = 0;
+	int i;
+
+	for (i = 0; i < nb_items; i++)
+		items_size += PROPERTIES_SERVICE_ITEM_SIZE(items[i].size);
+
+	struct cfw_message *msg = cfw_alloc_message_for_service(
+		conn, MSG_ID_PROP_SERVICE_WRITE_MULTI_PROP_REQ,
+		sizeof(write_multi_property_req_msg_t) + items_size, priv);
+	write_multi_property_req_msg_t *req =
+		(write_multi_property_req_msg_t *)msg;
+	properties_service_item_t *item =
+		(properties_service_item_t *)req->start_of_items;
+
+	req->factory_reset_persistent = factory_reset_persistent;
+	req->nb_items = nb_items;
+	req->items_size = items_size;
+	for (i = 0; i < nb_items; i++) {
+		item->service_id = items[i].service_id;
+		item->property_id = items[i].property_id;
+		item->status = DRV_RC_OK;
+		item->property_size = items[i].size;
+		memcpy(item->value, items[i].buffer, items[i].size);
+		item = PROPERTIES_SERVICE_NEXT_ITEM(item);
+	}
+	cfw_send_message(msg);
+}
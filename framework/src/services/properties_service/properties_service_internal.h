@@ -32,11 +32,14 @@
 #define __PROPERTIES_SERVICE_INTERNAL_H__
 
 #include "cfw/cfw.h"
+#include "services/properties_service/properties_service.h"
 
 #define MSG_ID_PROP_SERVICE_ADD_PROP_REQ      (MSG_ID_PROP_SERVICE_BASE + 1)
 #define MSG_ID_PROP_SERVICE_REMOVE_PROP_REQ   (MSG_ID_PROP_SERVICE_BASE + 2)
 #define MSG_ID_PROP_SERVICE_READ_PROP_REQ     (MSG_ID_PROP_SERVICE_BASE + 3)
 #define MSG_ID_PROP_SERVICE_WRITE_PROP_REQ    (MSG_ID_PROP_SERVICE_BASE + 4)
+#define MSG_ID_PROP_SERVICE_READ_MULTI_PROP_REQ  (MSG_ID_PROP_SERVICE_BASE + 5)
+#define MSG_ID_PROP_SERVICE_WRITE_MULTI_PROP_REQ (MSG_ID_PROP_SERVICE_BASE + 6)
 
 #define ADD_PROP_ACTION                       0x1
 #define WRITE_PROP_ACTION                     0x2
@@ -76,5 +79,19 @@ typedef struct read_property_req_msg {
 	uint16_t property_id;
 } read_property_req_msg_t;
 
+typedef struct read_multi_property_req_msg {
+	struct  cfw_message header;
+	uint8_t nb_items;
+	properties_service_id_t ids[];
+} read_multi_property_req_msg_t;
+
+typedef struct write_multi_property_req_msg {
+	struct cfw_message header;
+	uint8_t factory_reset_persistent;
+	uint8_t nb_items;
+	uint16_t items_size;
+	/* Items are properties_service_item_t, the status is unused */
+	uint8_t start_of_items[];
+} write_multi_property_req_msg_t;
 
 #endif /* __PROPERTIES_SERVICE_INTERNAL_H__ */
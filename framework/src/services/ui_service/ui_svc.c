@@ -37,6 +37,9 @@
 
 #include "services/services_ids.h"
 #include "services/ui_service/ui_service.h"
+#ifdef CONFIG_FG_MODEL
+#include "services/battery_service/battery_service.h"
+#endif
 #include "ui_service_private.h"
 
 #include "drivers/led/led.h"
@@ -368,6 +371,9 @@ void ui_play_vibr_callback(int8_t result)
 
 	cfw_msg_free(ui_vibr_req);
 	ui_vibr_req = NULL;
+#ifdef CONFIG_FG_MODEL
+	battery_service_set_load_hint(BATTERY_LOAD_HAPTIC, 0);
+#endif
 
 	/* Release the semaphore to continue with shutdown sequence */
 	semaphore_give(vibr_play_done, NULL);
@@ -760,6 +766,10 @@ void ui_play_vibr(struct cfw_message *msg)
 	 * Result will be returned in above vibr callback.
 	 */
 	pr_debug(LOG_MODULE_UI_SVC, "UI service : ui_play_vibr");
+#ifdef CONFIG_FG_MODEL
+	battery_service_set_load_hint(BATTERY_LOAD_HAPTIC,
+				      CONFIG_FG_MODEL_HAPTIC_UA);
+#endif
 	haptic_play(haptic_dev, vibr_req->type, &vibr_req->pattern);
 
 	/* Acquire semphore to sync up during shutdown */
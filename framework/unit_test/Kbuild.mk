@@ -1 +1,2 @@
 obj-y += services/
+obj-y += lib/
@@ -0,0 +1,5 @@
+obj-$(CONFIG_BLE_APP_CONN_POLICY) += ble_conn_policy_test.o
+CFLAGS_ble_conn_policy_test.o = -I$(T)/framework/src/lib/ble
+obj-$(CONFIG_BLE_HRS_LIB) += ble_hrs_meas_test.o
+CFLAGS_ble_hrs_meas_test.o = -I$(T)/framework/src/lib/ble/hrs -I$(T)/framework/src/lib/ble/rscs
+obj-$(CONFIG_STEP_DETECTOR) += step_detector_test.o
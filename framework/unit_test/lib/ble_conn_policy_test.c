@@ -0,0 +1,258 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+
+#include "util/cunit_test.h"
+#include "util/misc.h"
+#include "ble_conn_policy.h"
+
+/*
+ * Simulation of a connection driven by a traffic trace, comparing the
+ * traffic policy with the fixed default parameters. The policy is polled
+ * as ble_app does: on the notifications which change the demand, on the
+ * parameters updates, and at the deadline given by ble_conn_policy_next().
+ *
+ * Radio model of the peripheral: each connection event it listens to costs
+ * EVT_US, and each data packet PKT_US more. Without data to send, it skips
+ * up to latency events.
+ */
+#define EVT_US 300
+#define PKT_US 400
+
+/* Connection parameters of the central at connection: 30ms, no latency */
+#define CONN_INTERVAL 24
+
+/* Trace duration, in ms */
+#define SIM_TIME (10 * 60 * 1000)
+
+static const struct ble_conn_params sim_params[BLE_CONN_PROFILES] = {
+	[BLE_CONN_ACTIVE] = { 64, 120, 0, 600 },
+	[BLE_CONN_IDLE] = { 320, 400, 4, 600 },
+};
+
+struct sim_trace {
+	uint32_t notify_period; /* ms, 0 for none */
+	uint32_t notify_end;    /* end of the notifications, in ms */
+	bool reject_idle;       /* the central never applies idle params */
+};
+
+struct sim_result {
+	uint32_t radio_ms;
+	uint16_t requests;
+	uint16_t polls;
+};
+
+/* Poll the policy, the request is applied by the central after 100ms */
+static void sim_poll(struct ble_conn_policy *policy, uint32_t now,
+		     const struct sim_trace *trace, struct sim_result *res,
+		     struct ble_conn_params *req, uint32_t *update_at,
+		     uint32_t *next_poll)
+{
+	uint32_t next;
+
+	res->polls++;
+	if (ble_conn_policy_poll(policy, now, req)) {
+		res->requests++;
+		if (!(trace->reject_idle &&
+		      req->latency == sim_params[BLE_CONN_IDLE].latency))
+			*update_at = now + 100;
+	}
+	next = ble_conn_policy_next(policy, now);
+	*next_poll = next ? now + next : UINT32_MAX;
+}
+
+static void sim_run(const struct sim_trace *trace, bool dynamic,
+		    struct sim_result *res)
+{
+	struct ble_conn_policy policy;
+	struct ble_conn_params req;
+	uint64_t radio_us = 0;
+	uint32_t now = 0, next_poll = UINT32_MAX, next_notify;
+	uint32_t update_at = UINT32_MAX;
+	uint32_t queued = 0, skipped = 0;
+	uint16_t interval = CONN_INTERVAL, latency = 0;
+
+	memset(res, 0, sizeof(*res));
+	ble_conn_policy_init(&policy, sim_params, now, interval, latency);
+	next_notify = trace->notify_period ? trace->notify_period : UINT32_MAX;
+	if (dynamic)
+		sim_poll(&policy, now, trace, res, &req, &update_at,
+			 &next_poll);
+
+	while (now < SIM_TIME) {
+		now += interval * 5 / 4;
+
+		/* Traffic */
+		while (now >= next_notify && next_notify < trace->notify_end) {
+			queued++;
+			if (ble_conn_policy_notify(&policy, next_notify) &&
+			    dynamic)
+				sim_poll(&policy, next_notify, trace, res,
+					 &req, &update_at, &next_poll);
+			next_notify += trace->notify_period;
+		}
+
+		/* Parameters requests */
+		if (dynamic && now >= next_poll)
+			sim_poll(&policy, now, trace, res, &req, &update_at,
+				 &next_poll);
+		if (!dynamic && !res->requests && now >= 5000) {
+			/* Fixed policy: default parameters after 5s */
+			req = sim_params[BLE_CONN_ACTIVE];
+			res->requests++;
+			update_at = now + 100;
+		}
+		if (now >= update_at) {
+			update_at = UINT32_MAX;
+			interval = req.interval_max;
+			latency = req.latency;
+			ble_conn_policy_updated(&policy, now, interval,
+						latency);
+			if (dynamic)
+				sim_poll(&policy, now, trace, res, &req,
+					 &update_at, &next_poll);
+		}
+
+		/* Radio */
+		if (!queued && skipped < latency) {
+			skipped++;
+			continue;
+		}
+		skipped = 0;
+		radio_us += EVT_US + queued * PKT_US;
+		queued = 0;
+	}
+	res->radio_ms = radio_us / 1000;
+}
+
+static void sim_compare(const char *name, const struct sim_trace *trace,
+			struct sim_result *fixed, struct sim_result *dyn)
+{
+	sim_run(trace, false, fixed);
+	sim_run(trace, true, dyn);
+	cu_print("%s: radio %dms -> %dms, %d requests, %d polls\n", name,
+		 fixed->radio_ms, dyn->radio_ms, dyn->requests, dyn->polls);
+}
+
+static void ble_conn_policy_unit(void)
+{
+	struct ble_conn_policy policy;
+	struct ble_conn_params req;
+	uint32_t t;
+	int i;
+
+	ble_conn_policy_init(&policy, sim_params, 0, CONN_INTERVAL, 0);
+	CU_ASSERT("unknown params", policy.profile == BLE_CONN_UNKNOWN);
+	CU_ASSERT("no request at connection",
+		  !ble_conn_policy_poll(&policy, 1000, &req));
+
+	CU_ASSERT("start hold deadline",
+		  ble_conn_policy_next(&policy, 1000) ==
+		  BLE_CONN_START_HOLD - 1000);
+
+	/* No notification: idle at the end of the start hold */
+	CU_ASSERT("idle request", ble_conn_policy_poll(&policy, 5000, &req) &&
+		  req.latency == sim_params[BLE_CONN_IDLE].latency);
+	CU_ASSERT("request deadline",
+		  ble_conn_policy_next(&policy, 5000) == BLE_CONN_REQ_TIMEOUT);
+	CU_ASSERT("one request at a time",
+		  !ble_conn_policy_poll(&policy, 6000, &req));
+	ble_conn_policy_updated(&policy, 6100, 400, 4);
+	CU_ASSERT("idle applied", policy.profile == BLE_CONN_IDLE);
+	CU_ASSERT("no deadline when idle",
+		  !ble_conn_policy_poll(&policy, 6100, &req) &&
+		  !ble_conn_policy_next(&policy, 6100));
+
+	/* Back to the default parameters, then idle after the hold time */
+	ble_conn_policy_updated(&policy, 7000, 120, 0);
+	CU_ASSERT("active applied", policy.profile == BLE_CONN_ACTIVE);
+	CU_ASSERT("active hold", !ble_conn_policy_poll(&policy, 7000, &req) &&
+		  ble_conn_policy_next(&policy, 7000) == 10000);
+	CU_ASSERT("idle request", ble_conn_policy_poll(&policy, 17000, &req) &&
+		  req.latency == sim_params[BLE_CONN_IDLE].latency);
+
+	/* Idle rejected by timeout: back-off, then default parameters */
+	CU_ASSERT("no request before timeout",
+		  !ble_conn_policy_poll(&policy, 21000, &req));
+	CU_ASSERT("no fallback to the profile of the link",
+		  !ble_conn_policy_poll(&policy, 22000, &req));
+	CU_ASSERT("back-off deadline", ble_conn_policy_next(&policy, 22000) ==
+		  BLE_CONN_BACKOFF);
+	for (t = 23000; t < 22000 + BLE_CONN_BACKOFF; t += 1000)
+		if (ble_conn_policy_poll(&policy, t, &req))
+			break;
+	CU_ASSERT("idle in back-off", t >= 22000 + BLE_CONN_BACKOFF);
+	CU_ASSERT("idle retried", ble_conn_policy_poll(&policy, t, &req) &&
+		  req.latency == sim_params[BLE_CONN_IDLE].latency);
+
+	/* Applied with other values: rejected, longer back-off */
+	ble_conn_policy_updated(&policy, t + 100, 200, 0);
+	CU_ASSERT("other values", policy.profile == BLE_CONN_UNKNOWN &&
+		  policy.rejects[BLE_CONN_IDLE] == 2);
+	CU_ASSERT("doubled back-off", policy.retry_at[BLE_CONN_IDLE] ==
+		  t + 100 + 2 * BLE_CONN_BACKOFF);
+
+	/* Frequent notifications need the default parameters */
+	ble_conn_policy_init(&policy, sim_params, 0, 400, 4);
+	CU_ASSERT("idle params", policy.profile == BLE_CONN_IDLE);
+	for (i = 0; i < 20; i++)
+		if (ble_conn_policy_notify(&policy, 10000 + i * 250))
+			break;
+	CU_ASSERT("demand change reported", i < 20);
+	CU_ASSERT("active request",
+		  ble_conn_policy_poll(&policy, 10000 + i * 250, &req) &&
+		  req.latency == 0 &&
+		  req.interval_max == sim_params[BLE_CONN_ACTIVE].interval_max);
+}
+
+void ble_conn_policy_test(void)
+{
+	struct sim_result fixed, dyn;
+	struct sim_trace idle = { 0 };
+	struct sim_trace hrs = { 1000, SIM_TIME, false };
+	struct sim_trace rscs = { 250, 2 * 60 * 1000, false };
+	struct sim_trace rejecting = { 1000, SIM_TIME, true };
+
+	ble_conn_policy_unit();
+
+	sim_compare("idle", &idle, &fixed, &dyn);
+	CU_ASSERT("idle radio time", dyn.radio_ms < fixed.radio_ms / 4);
+
+	sim_compare("hrs 1Hz", &hrs, &fixed, &dyn);
+	CU_ASSERT("1Hz radio time", dyn.radio_ms < fixed.radio_ms / 2);
+
+	sim_compare("rscs 4Hz", &rscs, &fixed, &dyn);
+	CU_ASSERT("4Hz radio time", dyn.radio_ms < fixed.radio_ms);
+
+	/* Back-off: 30s, 60s, 120s, 240s, then every 480s */
+	sim_compare("rejecting", &rejecting, &fixed, &dyn);
+	CU_ASSERT("rejections respected", dyn.requests <= 8);
+}
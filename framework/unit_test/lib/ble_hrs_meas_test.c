@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+
+#include "util/cunit_test.h"
+#include "ble_hrs_meas.h"
+#ifdef CONFIG_BLE_RSCS_LIB
+#include "ble_rscs_meas.h"
+#endif
+
+/* Notification period of the simulation, in ms */
+#define SIM_PERIOD 1000
+
+static bool meas_equal(const uint8_t *buf, uint8_t len, const uint8_t *ref,
+		       uint8_t ref_len)
+{
+	return len == ref_len && !memcmp(buf, ref, len);
+}
+
+static void ble_hrs_meas_encoding(void)
+{
+	struct ble_hrs_acc acc = { 0 };
+	uint8_t buf[BLE_HRS_MEAS_MAX_LEN];
+	uint8_t len;
+	int i;
+
+	static const uint8_t hr8[] = { 0x06, 72 };
+	static const uint8_t hr16[] = { 0x01, 0x2c, 0x01 };
+	static const uint8_t energy[] = { 0x18, 80, 0x34, 0x12, 0x00, 0x04 };
+	static const uint8_t no_energy[] = { 0x10, 80, 0x01, 0x04 };
+
+	acc.hr = 72;
+	acc.flags = 0x06;
+	len = ble_hrs_acc_encode(&acc, buf);
+	CU_ASSERT("8 bit heart rate", meas_equal(buf, len, hr8, sizeof(hr8)));
+
+	acc.hr = 300;
+	acc.flags = 0;
+	len = ble_hrs_acc_encode(&acc, buf);
+	CU_ASSERT("16 bit heart rate",
+		  meas_equal(buf, len, hr16, sizeof(hr16)));
+
+	/* Energy expended is sent once */
+	acc.hr = 80;
+	acc.energy = 0x1234;
+	acc.flags = BLE_HRS_FLAG_ENERGY;
+	ble_hrs_acc_add_rr(&acc, 0x400);
+	len = ble_hrs_acc_encode(&acc, buf);
+	CU_ASSERT("energy and rr",
+		  meas_equal(buf, len, energy, sizeof(energy)));
+	ble_hrs_acc_add_rr(&acc, 0x401);
+	len = ble_hrs_acc_encode(&acc, buf);
+	CU_ASSERT("energy sent once",
+		  meas_equal(buf, len, no_energy, sizeof(no_energy)));
+
+	/* RR-intervals filling the notification, the last one is kept */
+	acc.flags = BLE_HRS_FLAG_ENERGY;
+	CU_ASSERT("rr room with energy", ble_hrs_acc_rr_room(&acc) == 8);
+	for (i = 0; i < 9; i++)
+		CU_ASSERT("rr added", ble_hrs_acc_add_rr(&acc, 1000 + i));
+	len = ble_hrs_acc_encode(&acc, buf);
+	CU_ASSERT("full notification", len == BLE_HRS_MEAS_MAX_LEN &&
+		  buf[0] == 0x18 && buf[4] == (1000 & 0xff) &&
+		  buf[18] == (1007 & 0xff) && buf[19] == (1007 >> 8));
+	CU_ASSERT("rr kept", acc.nb_rr == 1 && acc.rr[0] == 1008);
+	CU_ASSERT("rr room", ble_hrs_acc_rr_room(&acc) == BLE_HRS_RR_MAX);
+	len = ble_hrs_acc_encode(&acc, buf);
+	CU_ASSERT("rr sent next", len == 4 && buf[2] == (1008 & 0xff) &&
+		  acc.nb_rr == 0);
+
+	for (i = 0; i < BLE_HRS_RR_MAX; i++)
+		ble_hrs_acc_add_rr(&acc, i);
+	CU_ASSERT("rr overflow", !ble_hrs_acc_add_rr(&acc, 0));
+}
+
+#ifdef CONFIG_BLE_RSCS_LIB
+static void ble_rscs_meas_encoding(void)
+{
+	uint8_t buf[BLE_RSCS_MEAS_MAX_LEN];
+	uint8_t len;
+
+	static const uint8_t mandatory[] = { 0x00, 0x00, 0x03, 90 };
+	static const uint8_t stride[] = { 0x05, 0x00, 0x03, 90, 0x78, 0x00 };
+	static const uint8_t all[] = { 0x07, 0x00, 0x03, 90, 0x78, 0x00,
+				       0x10, 0x27, 0x00, 0x00 };
+	static const uint8_t distance[] = { 0x02, 0x00, 0x03, 90,
+					    0x10, 0x27, 0x00, 0x00 };
+
+	len = ble_rscs_encode(buf, 0x300, 90, -1, -1, -1);
+	CU_ASSERT("rscs mandatory",
+		  meas_equal(buf, len, mandatory, sizeof(mandatory)));
+	len = ble_rscs_encode(buf, 0x300, 90, 120, -1, 1);
+	CU_ASSERT("rscs stride", meas_equal(buf, len, stride, sizeof(stride)));
+	/* Distance right after the stride length */
+	len = ble_rscs_encode(buf, 0x300, 90, 120, 10000, 1);
+	CU_ASSERT("rscs all", meas_equal(buf, len, all, sizeof(all)));
+	len = ble_rscs_encode(buf, 0x300, 90, -1, 10000, 0);
+	CU_ASSERT("rscs distance",
+		  meas_equal(buf, len, distance, sizeof(distance)));
+}
+#endif
+
+/* Send the next measurement, and check its RR-intervals follow the others */
+static bool sim_send(struct ble_hrs_acc *acc, uint16_t *next_rr)
+{
+	uint8_t buf[BLE_HRS_MEAS_MAX_LEN];
+	uint8_t len = ble_hrs_acc_encode(acc, buf);
+	uint8_t i = (buf[0] & BLE_HRS_FLAG_HR16) ? 3 : 2;
+	bool ok = true;
+
+	if (buf[0] & BLE_HRS_FLAG_ENERGY)
+		i += 2;
+	for (; i < len; i += 2)
+		ok &= (buf[i] | buf[i + 1] << 8) == (*next_rr)++;
+	return ok;
+}
+
+/*
+ * Notifications sent during one minute at a steady heart rate, with one
+ * RR-interval per beat, flushed every SIM_PERIOD or when full.
+ */
+static uint32_t sim_notifications(uint16_t bpm)
+{
+	struct ble_hrs_acc acc = { 0 };
+	uint32_t beat_ms = 60000 / bpm;
+	uint32_t flush_at = 0;
+	uint32_t notifs = 0;
+	uint16_t next_rr = 0;
+	uint16_t beat;
+	bool ok = true;
+
+	acc.hr = bpm;
+	acc.flags = 0x06;
+	for (beat = 0; beat < bpm; beat++) {
+		uint32_t now = beat * beat_ms;
+
+		if (flush_at && now >= flush_at) {
+			ok &= sim_send(&acc, &next_rr);
+			notifs++;
+			flush_at = acc.nb_rr ? flush_at + SIM_PERIOD : 0;
+		}
+		ble_hrs_acc_add_rr(&acc, beat);
+		if (acc.nb_rr >= ble_hrs_acc_rr_room(&acc)) {
+			ok &= sim_send(&acc, &next_rr);
+			notifs++;
+		} else if (!flush_at) {
+			flush_at = now + SIM_PERIOD;
+		}
+	}
+	while (acc.nb_rr) {
+		ok &= sim_send(&acc, &next_rr);
+		notifs++;
+	}
+	CU_ASSERT("rr sent in order", ok && next_rr == bpm);
+	return notifs;
+}
+
+void ble_hrs_meas_test(void)
+{
+	static const uint16_t rates[] = { 60, 120, 180 };
+	uint32_t notifs;
+	int i;
+
+	ble_hrs_meas_encoding();
+#ifdef CONFIG_BLE_RSCS_LIB
+	ble_rscs_meas_encoding();
+#endif
+
+	for (i = 0; i < 3; i++) {
+		notifs = sim_notifications(rates[i]);
+		cu_print("%d bpm: %d -> %d notifications/min\n", rates[i],
+			 rates[i], notifs);
+		/* At most one per period, whatever the heart rate */
+		CU_ASSERT("one notification per period",
+			  notifs <= 60000 / SIM_PERIOD);
+	}
+}
@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdint.h>
+
+#include "util/cunit_test.h"
+#include "lib/step_detector/step_detector.h"
+
+/* One period of a sine, amplitude 1024 */
+static const int16_t sine[32] = {
+	0, 200, 392, 569, 724, 851, 946, 1004,
+	1024, 1004, 946, 851, 724, 569, 392, 200,
+	0, -200, -392, -569, -724, -851, -946, -1004,
+	-1024, -1004, -946, -851, -724, -569, -392, -200
+};
+
+/* Sine of a phase in 1/65536 of a period, interpolated */
+static int32_t sin_q16(uint32_t phase)
+{
+	uint32_t i = (phase >> 11) & 31;
+	int32_t frac = phase & 2047;
+
+	return sine[i] + (((sine[(i + 1) & 31] - sine[i]) * frac) >> 11);
+}
+
+static uint32_t rand_state = 1;
+
+/* Sensor noise, -amp..amp mg */
+static int16_t noise(int16_t amp)
+{
+	rand_state = rand_state * 1103515245 + 12345;
+	return (int32_t)((rand_state >> 16) % (2 * amp + 1)) - amp;
+}
+
+struct walk {
+	uint32_t t;             /* ms */
+	uint32_t phase;         /* steps, Q16 */
+	uint32_t steps;         /* steps walked */
+};
+
+/*
+ * Walk for duration ms at cadence steps/min: the magnitude swings by swing
+ * mg once per step and the gravity turns with the arm, every two steps.
+ */
+static uint32_t walk(struct step_detector *sd, struct walk *w,
+		     uint32_t duration, uint32_t rate, uint32_t cadence,
+		     int16_t swing)
+{
+	uint32_t end = w->t + duration;
+	uint32_t dt = 1000 / rate;
+	uint32_t found = 0;
+	int16_t acc[3];
+
+	for (; w->t < end; w->t += dt) {
+		uint32_t prev = w->phase;
+		int32_t mag = 1000 + swing * sin_q16(w->phase) / 1024;
+		/* 0.5 rad from the vertical, swinging by 0.5 rad */
+		uint32_t angle = 5200 + 5 * sin_q16(w->phase / 2);
+
+		acc[0] = mag * sin_q16(angle) / 1024 + noise(10);
+		acc[1] = noise(10);
+		acc[2] = mag * sin_q16(angle + 16384) / 1024 + noise(10);
+		found += step_detector_process(sd, acc, w->t);
+
+		w->phase += (uint64_t)cadence * dt * 65536 / 60000;
+		w->steps += (w->phase >> 16) - (prev >> 16);
+	}
+	return found;
+}
+
+static int near(uint32_t a, uint32_t b, uint32_t tol)
+{
+	return a + tol >= b && a <= b + tol;
+}
+
+static void step_detector_walk(void)
+{
+	static const struct {
+		uint16_t rate;
+		uint16_t cadence;
+		int16_t swing;
+	} cases[] = {
+		{ 25, 90, 250 }, { 25, 115, 400 }, { 25, 170, 1200 },
+		{ 50, 115, 400 }, { 100, 90, 250 }, { 100, 170, 1200 },
+	};
+	struct step_detector sd;
+	struct walk w;
+	uint32_t found;
+	uint16_t cadence;
+	int i;
+
+	for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+		step_detector_init(&sd);
+		w.t = 0;
+		w.phase = 0;
+		w.steps = 0;
+		found = walk(&sd, &w, 60000, cases[i].rate, cases[i].cadence,
+			     cases[i].swing);
+		cadence = step_detector_cadence(&sd, w.t - 1000 /
+						cases[i].rate);
+		cu_print("%d Hz, %d steps/min: %d steps of %d, cadence %d\n",
+			 cases[i].rate, cases[i].cadence, found, w.steps,
+			 cadence);
+		CU_ASSERT("steps counted", near(found, w.steps, 2));
+		CU_ASSERT("steps total", sd.steps == found);
+		CU_ASSERT("cadence", near(cadence, cases[i].cadence, 3));
+	}
+}
+
+static void step_detector_bouts(void)
+{
+	struct step_detector sd;
+	struct walk w = { 0, 0, 0 };
+	uint32_t found;
+	int16_t still[3] = { 500, 0, 866 };
+	int i;
+
+	step_detector_init(&sd);
+
+	/* Sensor noise only */
+	for (i = 0; i < 25 * 30; i++) {
+		still[0] = 500 + noise(30);
+		still[2] = 866 + noise(30);
+		step_detector_process(&sd, still, w.t);
+		w.t += 40;
+	}
+	CU_ASSERT("no step still", sd.steps == 0);
+	CU_ASSERT("no cadence still", step_detector_cadence(&sd, w.t) == 0);
+
+	/* Three steps are not a walk */
+	found = walk(&sd, &w, 1500, 25, 120, 400);
+	found += walk(&sd, &w, 3000, 25, 0, 0);
+	CU_ASSERT("short bout ignored", found == 0 && sd.steps == 0);
+
+	/* The rate can change during the walk */
+	w.steps = 0;
+	found = walk(&sd, &w, 20000, 25, 110, 400);
+	found += walk(&sd, &w, 20000, 100, 110, 400);
+	CU_ASSERT("rate change", near(found, w.steps, 2));
+	CU_ASSERT("cadence at rate change",
+		  near(step_detector_cadence(&sd, w.t - 10), 110, 3));
+
+	/* The cadence drops once the walk stops */
+	walk(&sd, &w, 2000, 100, 0, 0);
+	CU_ASSERT("cadence after stop",
+		  step_detector_cadence(&sd, w.t - 10) == 0);
+}
+
+void step_detector_test(void)
+{
+	step_detector_walk();
+	step_detector_bouts();
+}
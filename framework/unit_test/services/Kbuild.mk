@@ -2,6 +2,13 @@ obj-y += service_tests.o
 obj-y += adc_service_test.o
 obj-y += ui_svc_test.o
 obj-$(CONFIG_PWRBTN_GPIO) += pwrbtn_service_test.o
+obj-$(CONFIG_SERVICES_QUARK_SE_GPIO_IMPL) += gpio_edge_test.o
+CFLAGS_gpio_edge_test.o = -I$(T)/framework/src/services/gpio_service
+obj-$(CONFIG_SERVICES_QUARK_SE_GPIO_IMPL) += gpio_service_test.o
+obj-$(CONFIG_NFC_STN54_FW_UPDATE) += nfc_fwu_test.o
+CFLAGS_nfc_fwu_test.o = -I$(T)/framework/src/services/nfc_service
+obj-$(CONFIG_FG_MODEL) += fg_model_test.o
+CFLAGS_fg_model_test.o = -I$(T)/framework/src/services/battery_service
 
 ifeq ($(CONFIG_QUARK_DRIVER_TESTS),y)
 obj-y += ll_storage_service_test.o
@@ -43,6 +43,10 @@
 #define GPIO_SET_HIGH 1
 #define ADC_GET_TIME 4000
 #define GPIO_SET_TIME 2000
+#define SCAN_CHANNEL 10
+#define SCAN_PERIOD 100
+#define SCAN_BATCH 4
+#define NO_OF_SCAN_EVT 3
 
 #define ADC_CU_ASSERT(msg, cdt)	\
 	do { CU_ASSERT(msg, cdt); \
@@ -55,6 +59,9 @@ static uint8_t resp_cnt = 0;
 static uint8_t adc_evt_counter;
 static void *adc_svc_client[2];
 static int8_t idx;
+static void *adc_scan_client;
+static uint8_t adc_scan_evt_counter;
+static uint8_t adc_scan_rejected;
 static void adc_handle_msg(struct cfw_message *msg, void *data)
 {
 	DRIVER_API_RC ret = DRV_RC_FAIL;
@@ -102,6 +109,38 @@ static void adc_handle_msg(struct cfw_message *msg, void *data)
 		CU_ASSERT("ADC get value fails", ret == DRV_RC_OK);
 		adc_evt_counter++;
 		break;
+	case MSG_ID_ADC_SERVICE_SCAN_SUBSCRIBE_RSP:
+		ret = ((adc_service_subscribe_rsp_msg_t *)msg)->status;
+		/* priv is set for the subscriptions expected to be rejected */
+		if (msg->priv) {
+			CU_ASSERT("ADC scan subscribe not rejected",
+				  ret == DRV_RC_INVALID_CONFIG);
+			adc_scan_rejected++;
+			break;
+		}
+		adc_scan_client =
+			((adc_service_subscribe_rsp_msg_t *)msg)->
+			adc_sub_conn_handle;
+		CU_ASSERT("ADC scan subscribe fails", ret == DRV_RC_OK);
+		break;
+	case MSG_ID_ADC_SERVICE_SCAN_UNSUBSCRIBE_RSP:
+		ret = ((adc_service_subscribe_rsp_msg_t *)msg)->status;
+		CU_ASSERT("ADC scan unsubscribe fails", ret == DRV_RC_OK);
+		adc_scan_evt_counter++;
+		break;
+	case MSG_ID_ADC_SERVICE_SCAN_EVT:
+	{
+		adc_service_scan_evt_msg_t *evt =
+			(adc_service_scan_evt_msg_t *)msg;
+		CU_ASSERT("ADC scan fails", evt->status == DRV_RC_OK);
+		CU_ASSERT("Wrong scan batch", evt->nb_samples == SCAN_BATCH &&
+			  evt->nb_channels == 2);
+		cu_print("Scan batch: channel %d = %d, channel %d = %d\n",
+			 TEST_CHANNEL, evt->values[0], SCAN_CHANNEL,
+			 evt->values[1]);
+		adc_scan_evt_counter++;
+		break;
+	}
 	default:
 		cu_print("default cfw handler\n");
 		break;
@@ -152,6 +191,68 @@ void adc_service_subscribe_test()
 		      adc_evt_counter == NO_OF_REQUEST + 1);
 }
 
+void adc_service_scan_test()
+{
+	uint64_t timeout = 0;
+	adc_service_scan_cfg_t cfg = {
+		.channels = { TEST_CHANNEL, SCAN_CHANNEL },
+		.gpio_pins = { SS_GPIO_SW_FG_VOLT_EN, ADC_SERVICE_NO_GPIO },
+		.nb_channels = 2,
+		.active_high = GPIO_SET_HIGH,
+		.mode = ADC_SCAN_AVERAGE,
+		.settle_time = 4,
+		.batch_size = SCAN_BATCH,
+		.period = SCAN_PERIOD,
+	};
+	adc_service_scan_cfg_t fast_cfg = {};
+
+	cu_print(
+		"##################################################################\n");
+	cu_print(
+		"# Purpose of ADC service scan test :                             #\n");
+	cu_print(
+		"# sample 2 channels in one scan and get batches of samples       #\n");
+	cu_print(
+		"##################################################################\n");
+
+	adc_service_scan_subscribe(adc_service_handle, &cfg, NULL);
+	while ((++timeout) <= 0xFFFFFF) {
+		queue_process_message(get_test_queue());
+		if (adc_scan_evt_counter == NO_OF_SCAN_EVT)
+			break;
+	}
+	ADC_CU_ASSERT("Timeout expired, no adc scan event",
+		      timeout <= 0xFFFFFF);
+
+	/* A scan period not longer than the settle time of the GPIO of the
+	 * running subscription is rejected */
+	fast_cfg.channels[0] = SCAN_CHANNEL;
+	fast_cfg.gpio_pins[0] = ADC_SERVICE_NO_GPIO;
+	fast_cfg.nb_channels = 1;
+	fast_cfg.batch_size = 1;
+	fast_cfg.period = cfg.settle_time;
+	timeout = 0;
+	adc_service_scan_subscribe(adc_service_handle, &fast_cfg,
+				   &adc_scan_rejected);
+	while ((++timeout) <= 0xFFFFFF) {
+		queue_process_message(get_test_queue());
+		if (adc_scan_rejected)
+			break;
+	}
+	ADC_CU_ASSERT("Timeout expired, no adc scan subscribe response",
+		      timeout <= 0xFFFFFF);
+
+	timeout = 0;
+	adc_service_scan_unsubscribe(adc_service_handle, adc_scan_client);
+	while ((++timeout) <= 0xFFFFFF) {
+		queue_process_message(get_test_queue());
+		if (adc_scan_evt_counter == NO_OF_SCAN_EVT + 1)
+			break;
+	}
+	ADC_CU_ASSERT("Timeout expired, no adc scan unsubscribe response",
+		      timeout <= 0xFFFFFF);
+}
+
 void adc_service_test()
 {
 	uint64_t timeout = 0;
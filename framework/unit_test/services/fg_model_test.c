@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdint.h>
+
+#include "util/cunit_test.h"
+#include "fg_lut.h"
+#include "fg_model.h"
+
+/* 45mAh Li-Lon, discharge at 25C */
+static const uint16_t table[BATTPROP_LOOKUP_TABLE_SIZE] = {
+	3320, 3390, 3405, 3440, 3465,
+	3481, 3511, 3534, 3545, 3560,
+	3581, 3685, 3773, 3905, 4070,
+	4105, 4131, 4163, 4186, 4202,
+	4215, 4227, 4239, 4253, 4265
+};
+
+static const struct fg_model_params params = {
+	.capacity_mas = 45 * 3600,
+	.r0_mohm = 800,
+	.r1_mohm = 400,
+	.tau_s = 60,
+	.base_ua = 1000
+};
+
+/* Battery simulated with the same circuit as the model, 1 s steps */
+struct fg_test_battery {
+	int64_t charge_uas;
+	int32_t vrc_uv;
+};
+
+static uint16_t fg_test_ocv(uint32_t soc_ppm)
+{
+	uint16_t lo = table[0], hi = table[BATTPROP_LOOKUP_TABLE_SIZE - 1];
+
+	/* Bisect the voltage, the table being monotonic */
+	while (lo < hi) {
+		uint16_t mid = (lo + hi + 1) / 2;
+		if (fg_lut_get_soc_ppm(table, mid, NULL) <= soc_ppm)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+	return lo;
+}
+
+static uint32_t fg_test_soc(const struct fg_test_battery *b)
+{
+	return b->charge_uas * 1000 / (45 * 3600);
+}
+
+static uint16_t fg_test_step(struct fg_test_battery *b, uint32_t current_ua)
+{
+	b->charge_uas -= current_ua;
+	b->vrc_uv += ((int32_t)(current_ua * 400 / 1000) - b->vrc_uv) / 61;
+	return fg_test_ocv(fg_test_soc(b)) -
+	       (current_ua * 800 / 1000 + b->vrc_uv) / 1000;
+}
+
+static int32_t diff(int32_t a, int32_t b)
+{
+	return a > b ? a - b : b - a;
+}
+
+static void fg_lut_test(void)
+{
+	uint32_t prev = 0, soc;
+	uint16_t slope;
+	uint16_t mv;
+	bool monotonic = true;
+
+	CU_ASSERT("lut below", fg_lut_get_soc(table, 3000) == 0);
+	CU_ASSERT("lut 5 %", fg_lut_get_soc(table, 3481) == 5);
+	CU_ASSERT("lut 50 %", fg_lut_get_soc(table, 3773) == 50);
+	CU_ASSERT("lut 40 %", fg_lut_get_soc(table, 3729) == 40);
+	CU_ASSERT("lut 95 %", fg_lut_get_soc(table, 4203) == 95);
+	CU_ASSERT("lut last point", fg_lut_get_soc(table, 4265) == 99);
+	CU_ASSERT("lut full", fg_lut_get_soc(table, 4266) == 100);
+
+	CU_ASSERT("ppm below", fg_lut_get_soc_ppm(table, 3000, NULL) == 0);
+	CU_ASSERT("ppm point", fg_lut_get_soc_ppm(table, 3773, NULL) == 500000);
+	CU_ASSERT("ppm full",
+		  fg_lut_get_soc_ppm(table, 4300, NULL) == FG_LUT_SOC_PPM_FULL);
+	soc = fg_lut_get_soc_ppm(table, 3729, &slope);
+	CU_ASSERT("ppm linear", diff(soc, 400000) <= 100);
+	CU_ASSERT("ppm flat slope", slope == 44);
+	fg_lut_get_soc_ppm(table, 3395, &slope);
+	CU_ASSERT("ppm steep slope", slope == 150);
+
+	for (mv = 3300; mv < 4300; mv++) {
+		soc = fg_lut_get_soc_ppm(table, mv, NULL);
+		if (soc < prev)
+			monotonic = false;
+		prev = soc;
+	}
+	CU_ASSERT("ppm monotonic", monotonic);
+}
+
+static void fg_model_coulomb_test(void)
+{
+	struct fg_model m;
+	int32_t start;
+
+	fg_model_init(&m, &params, 0);
+	CU_ASSERT("base load", m.current_ua == 1000);
+	fg_model_update(&m, table, 3905, false, 0);
+	/* 0.8 mV of load drop, 165 mV for 20 % */
+	CU_ASSERT("first measure", m.soc == 700000 + 1 * 200000 / 165);
+	start = m.soc;
+
+	/* 45 mA more for 10 minutes drains 1/6 of 45 mAh, with the base */
+	fg_model_set_load(&m, BATTERY_LOAD_HAPTIC, 45000, 0);
+	fg_model_set_load(&m, BATTERY_LOAD_HAPTIC, 0, 600000);
+	CU_ASSERT("coulomb counting",
+		  diff(start - m.soc, 1000000 * 46 / 6 / 45) <= 1);
+
+	/* Hints from unknown sources are dropped */
+	fg_model_set_load(&m, BATTERY_LOAD_COUNT, 45000, 600000);
+	CU_ASSERT("unknown source", m.current_ua == 1000);
+}
+
+static void fg_model_temperature_test(void)
+{
+	struct fg_model m;
+
+	fg_model_init(&m, &params, 0);
+	fg_model_set_temperature(&m, 0, 0);
+	CU_ASSERT("cold r0", m.r0_mohm == 800 * 2049 / 1024);
+	CU_ASSERT("cold capacity", m.capacity_mas == 45 * 3600 * 874 / 1024);
+	fg_model_set_temperature(&m, 45, 0);
+	CU_ASSERT("hot r0", m.r0_mohm == 800 * 624 / 1024);
+	fg_model_set_temperature(&m, 100, 0);
+	CU_ASSERT("hot clamp", m.r0_mohm == 400);
+}
+
+/*
+ * Discharge from 80 % under the base load with haptic bursts, measured
+ * about every minute: the model must stay within 1 % of the battery, when
+ * reading the table under load is off by more than 10 %.
+ */
+static void fg_model_load_test(void)
+{
+	struct fg_model m;
+	struct fg_test_battery b = { 45 * 3600 * 800, 0 };
+	int32_t err, model_max = 0, lut_max = 0;
+	uint32_t t, current;
+	uint16_t v = 0;
+
+	fg_model_init(&m, &params, 0);
+	for (t = 0; t < 3 * 3600; t++) {
+		/* 2 s of haptics every 30 s, hinted 25 % low */
+		current = (t % 30) < 2 ? 81000 : 1000;
+		if (t % 30 == 0)
+			fg_model_set_load(&m, BATTERY_LOAD_HAPTIC, 60000,
+					  t * 1000);
+		if (t % 30 == 2)
+			fg_model_set_load(&m, BATTERY_LOAD_HAPTIC, 0,
+					  t * 1000);
+		v = fg_test_step(&b, current);
+		if (t % 61 != 1)
+			continue;
+		fg_model_update(&m, table, v, false, t * 1000);
+		/* The first measure, under load, needs a few more */
+		err = t > 600 ? diff(m.soc, fg_test_soc(&b)) : 0;
+		model_max = err > model_max ? err : model_max;
+		err = diff(fg_lut_get_soc(table, v) * 10000, fg_test_soc(&b));
+		lut_max = err > lut_max ? err : lut_max;
+	}
+	cu_print("fg model: max error %d ppm, lut %d ppm\n", model_max,
+		 lut_max);
+	CU_ASSERT("model under load", model_max < 10000);
+	CU_ASSERT("lut under load", lut_max > 100000);
+	CU_ASSERT("soc reported", fg_model_get_soc(&m) ==
+		  (fg_test_soc(&b) + 5000) / 10000);
+}
+
+static void fg_model_charge_test(void)
+{
+	struct fg_model m;
+
+	fg_model_init(&m, &params, 0);
+	fg_model_update(&m, table, 3773, false, 0);
+	fg_model_set_load(&m, BATTERY_LOAD_RADIO, 5000, 0);
+	/* No coulomb counting nor load drop while charging */
+	fg_model_update(&m, table, 3905, true, 600000);
+	CU_ASSERT("charge follows table", m.soc == 700000);
+	CU_ASSERT("charge get soc", fg_model_get_soc(&m) == 70);
+}
+
+void fg_model_test(void)
+{
+	fg_lut_test();
+	fg_model_coulomb_test();
+	fg_model_temperature_test();
+	fg_model_load_test();
+	fg_model_charge_test();
+}
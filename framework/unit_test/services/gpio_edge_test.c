@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "util/cunit_test.h"
+#include "gpio_edge.h"
+
+/*
+ * Ring of the gpio service, as driven by its gpio callback and flush
+ * handler. The path through the drivers and the service is tested by
+ * gpio_service_edge_test, on the test board.
+ */
+
+#define EDGE_TEST_RING_SIZE 16
+
+static struct gpio_service_edge ring_edges[EDGE_TEST_RING_SIZE];
+static struct gpio_edge_ring ring;
+static struct gpio_service_edge out[EDGE_TEST_RING_SIZE];
+static uint32_t now;            /* 32kHz clock */
+static bool level;
+
+static uint16_t edge_test_toggle(uint32_t elapsed)
+{
+	now += elapsed;
+	level = !level;
+	return gpio_edge_push(&ring, level, now);
+}
+
+void gpio_edge_test(void)
+{
+	uint16_t nb, lost;
+	uint32_t start;
+	int i, j;
+	bool ok;
+
+	gpio_edge_ring_init(&ring, ring_edges, EDGE_TEST_RING_SIZE);
+
+	/* The count returned by push tells the callback when to flush */
+	ok = true;
+	for (i = 0; i < EDGE_TEST_RING_SIZE; i++)
+		ok &= edge_test_toggle(10) == i + 1;
+	CU_ASSERT("edge count", ok);
+	CU_ASSERT("edge lost when full", !edge_test_toggle(10));
+	nb = gpio_edge_pop(&ring, out, EDGE_TEST_RING_SIZE, &lost);
+	CU_ASSERT("edges batched", nb == EDGE_TEST_RING_SIZE && lost == 1);
+
+	/* Burst larger than the ring: the first edges are kept, in order */
+	start = now;
+	for (i = 0; i < 40; i++)
+		edge_test_toggle(3);
+	CU_ASSERT("ring full", gpio_edge_count(&ring) == EDGE_TEST_RING_SIZE);
+	nb = gpio_edge_pop(&ring, out, EDGE_TEST_RING_SIZE, &lost);
+	CU_ASSERT("burst batched", nb == EDGE_TEST_RING_SIZE);
+	CU_ASSERT("burst overflow counted", lost == 40 - EDGE_TEST_RING_SIZE);
+	ok = true;
+	for (i = 0; i < nb; i++)
+		ok &= out[i].timestamp == start + 3 * (i + 1) &&
+		      out[i].state == (i & 1);
+	CU_ASSERT("burst edges in order", ok);
+	nb = gpio_edge_pop(&ring, out, EDGE_TEST_RING_SIZE, &lost);
+	CU_ASSERT("overflow reported once", nb == 0 && lost == 0);
+
+	/* Partial reads, and index wrap around */
+	ok = true;
+	for (i = 0; i < 10000; i++) {
+		for (j = 0; j < 1 + i % 16; j++)
+			edge_test_toggle(1);
+		start = now - j;
+		nb = gpio_edge_pop(&ring, out, 7, &lost);
+		while (nb) {
+			ok &= out[0].timestamp == start + 1;
+			start += nb;
+			nb = gpio_edge_pop(&ring, out, 7, &lost);
+		}
+		ok &= lost == 0 && start == now;
+	}
+	CU_ASSERT("edges continuous across wrap", ok);
+	CU_ASSERT("ring empty", !gpio_edge_count(&ring));
+}
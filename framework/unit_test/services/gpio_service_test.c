@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+
+#include "cfw/cfw.h"
+#include "infra/time.h"
+#include "scss_registers.h"
+
+#include "service_tests.h"
+#include "services/gpio_service/gpio_service.h"
+
+/* SS GPIO 11 drives SS GPIO 10, like in the ss_gpio driver test */
+#define TST_INPUT_PIN          10
+#define TST_OUTPUT_PIN         11
+#define MUX_SS_GPIO_10_PWM0    63
+#define MUX_SS_GPIO_11_PWM1    64
+
+#define TST_LATENCY            500
+/* Same ring size on both cores */
+#define TST_HALF_RING          (CONFIG_GPIO_SERVICE_EDGES / 2)
+
+static cfw_service_conn_t *tst_conn;
+static volatile int tst_rsp;
+static volatile int tst_status;
+static volatile int tst_evt_count;
+static uint32_t tst_evt_time;
+static uint8_t tst_nb_edges;
+static uint16_t tst_lost;
+static bool tst_pin_state;
+static bool tst_last_ms_ok;
+static struct gpio_service_edge tst_edges[CONFIG_GPIO_SERVICE_EDGES];
+
+static void gpio_svc_tst_handle_msg(struct cfw_message *msg, void *data)
+{
+	gpio_service_listen_evt_msg_t *evt;
+
+	switch (CFW_MESSAGE_ID(msg)) {
+	case MSG_ID_CFW_OPEN_SERVICE_RSP:
+		tst_conn = (cfw_service_conn_t *)
+			   ((cfw_open_conn_rsp_msg_t *)msg)->service_conn;
+		break;
+	case MSG_ID_GPIO_SERVICE_CONFIGURE_RSP:
+	case MSG_ID_GPIO_SERVICE_SET_STATE_RSP:
+		tst_status = ((gpio_service_set_state_rsp_msg_t *)msg)->status;
+		tst_rsp = 1;
+		break;
+	case MSG_ID_GPIO_SERVICE_LISTEN_RSP:
+		tst_status = ((gpio_service_listen_rsp_msg_t *)msg)->status;
+		tst_rsp = 1;
+		break;
+	case MSG_ID_GPIO_SERVICE_UNLISTEN_RSP:
+		tst_status = ((gpio_service_unlisten_rsp_msg_t *)msg)->status;
+		tst_rsp = 1;
+		break;
+	case MSG_ID_GPIO_SERVICE_EVT:
+		evt = (gpio_service_listen_evt_msg_t *)msg;
+		tst_evt_time = get_uptime_ms();
+		tst_evt_count++;
+		tst_lost = evt->lost;
+		tst_pin_state = evt->pin_state;
+		tst_nb_edges = evt->nb_edges;
+		if (tst_nb_edges > CONFIG_GPIO_SERVICE_EDGES)
+			tst_nb_edges = CONFIG_GPIO_SERVICE_EDGES;
+		memcpy(tst_edges, evt->edges,
+		       tst_nb_edges * sizeof(tst_edges[0]));
+		tst_last_ms_ok = evt->nb_edges &&
+				 gpio_service_edge_ms(evt, evt->nb_edges - 1) ==
+				 evt->timestamp;
+		break;
+	default:
+		break;
+	}
+	cfw_msg_free(msg);
+}
+
+static int gpio_svc_tst_set(bool value)
+{
+	tst_rsp = 0;
+	gpio_service_set_state(tst_conn, TST_OUTPUT_PIN, value, NULL);
+	SRV_WAIT(!tst_rsp, 2000);
+	return tst_rsp ? tst_status : DRV_RC_TIMEOUT;
+}
+
+/* Toggle the output count times from low, return the time of the first */
+static uint32_t gpio_svc_tst_toggle(int count)
+{
+	uint32_t start = get_uptime_ms();
+	int i;
+
+	for (i = 0; i < count; i++)
+		gpio_svc_tst_set(!(i & 1));
+	return start;
+}
+
+static bool gpio_svc_tst_edges_ok(void)
+{
+	bool ok = tst_nb_edges && tst_edges[0].state;
+	int i;
+
+	for (i = 1; i < tst_nb_edges; i++)
+		ok &= tst_edges[i].state == !(i & 1) &&
+		      (int32_t)(tst_edges[i].timestamp -
+				tst_edges[i - 1].timestamp) >= 0;
+	return ok;
+}
+
+static void gpio_svc_tst_run(void)
+{
+	uint32_t start;
+
+	tst_rsp = 0;
+	gpio_service_configure(tst_conn, TST_OUTPUT_PIN, 1, NULL);
+	SRV_WAIT(!tst_rsp, 2000);
+	CU_ASSERT("output configure failed", tst_rsp && !tst_status);
+	CU_ASSERT("output set failed", gpio_svc_tst_set(0) == DRV_RC_OK);
+
+	tst_rsp = 0;
+	gpio_service_listen_batch(tst_conn, TST_INPUT_PIN, BOTH_EDGE, DEB_OFF,
+				  TST_LATENCY, NULL);
+	SRV_WAIT(!tst_rsp, 2000);
+	CU_ASSERT("listen failed", tst_rsp && !tst_status);
+	if (!tst_rsp || tst_status)
+		return;
+
+	/* A short burst waits for the latency, and comes in one event */
+	tst_evt_count = 0;
+	start = gpio_svc_tst_toggle(6);
+	SRV_WAIT(!tst_evt_count, 2 * TST_LATENCY);
+	/* No other event may follow */
+	SRV_WAIT(tst_evt_count < 2, TST_LATENCY);
+	CU_ASSERT("burst not in one event", tst_evt_count == 1);
+	CU_ASSERT("burst edges missing", tst_nb_edges == 6 && !tst_lost);
+	CU_ASSERT("burst edges out of order", gpio_svc_tst_edges_ok());
+	CU_ASSERT("burst pin state", !tst_pin_state);
+	CU_ASSERT("burst event time", tst_last_ms_ok);
+	CU_ASSERT("burst not delayed",
+		  tst_evt_time - start >= TST_LATENCY / 2);
+
+	/* More than half a ring is sent without waiting */
+	tst_evt_count = 0;
+	start = gpio_svc_tst_toggle(TST_HALF_RING + 1);
+	SRV_WAIT(!tst_evt_count, 2 * TST_LATENCY);
+	CU_ASSERT("half ring not flushed",
+		  tst_evt_count == 1 && tst_evt_time - start < TST_LATENCY);
+	CU_ASSERT("half ring edges missing",
+		  tst_nb_edges == TST_HALF_RING + 1 && !tst_lost);
+	CU_ASSERT("half ring edges out of order", gpio_svc_tst_edges_ok());
+
+	tst_rsp = 0;
+	gpio_service_unlisten(tst_conn, TST_INPUT_PIN, NULL);
+	SRV_WAIT(!tst_rsp, 2000);
+	CU_ASSERT("unlisten failed", tst_rsp && !tst_status);
+}
+
+void gpio_service_edge_test(void)
+{
+	uint8_t input_mode = GET_PIN_MODE(MUX_SS_GPIO_10_PWM0);
+	uint8_t output_mode = GET_PIN_MODE(MUX_SS_GPIO_11_PWM1);
+	cfw_client_t *client;
+
+	cu_print("##################################################\n");
+	cu_print("# Purpose of GPIO service edge test :            #\n");
+	cu_print("# batch the edges of a listened GPIO             #\n");
+	cu_print("# !!! Pins SS %d and SS %d must be connected !   #\n",
+		 TST_INPUT_PIN, TST_OUTPUT_PIN);
+	cu_print("##################################################\n");
+
+	if (!cfw_service_registered(SS_GPIO_SERVICE_ID)) {
+		cu_print("ss gpio service not registered\n");
+		return;
+	}
+
+	client = cfw_client_init(get_test_queue(), gpio_svc_tst_handle_msg,
+				 NULL);
+	tst_conn = NULL;
+	cfw_open_service_conn(client, SS_GPIO_SERVICE_ID, NULL);
+	SRV_WAIT(!tst_conn, 2000);
+	CU_ASSERT("can not open ss gpio service", tst_conn != NULL);
+	if (tst_conn == NULL)
+		return;
+
+	SET_PIN_MODE(MUX_SS_GPIO_10_PWM0, QRK_PMUX_SEL_MODEA);
+	SET_PIN_MODE(MUX_SS_GPIO_11_PWM1, QRK_PMUX_SEL_MODEA);
+	gpio_svc_tst_run();
+	SET_PIN_MODE(MUX_SS_GPIO_10_PWM0, input_mode);
+	SET_PIN_MODE(MUX_SS_GPIO_11_PWM1, output_mode);
+
+	cfw_close_service_conn(tst_conn, NULL);
+}
@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+
+#include "util/cunit_test.h"
+#include "util/misc.h"
+#include "nfc_stn54_seq.h"
+#include "nfc_stn54_fwu.h"
+
+/* Read-ahead buffer smaller than the image, so that records straddle it */
+#define FWU_TEST_BUF_SIZE 300
+#define FWU_TEST_IMG_SIZE 2048
+#define FWU_TEST_OFFSET 0x1000
+
+/* Modelled processing time of a command, in ms per 32 bytes */
+#define FWU_TEST_PROC_MS 1
+
+static uint8_t fwu_img[FWU_TEST_IMG_SIZE];
+static uint8_t fwu_buf[FWU_TEST_BUF_SIZE];
+static int fwu_reads;
+static bool fwu_read_fails;
+
+static int fwu_test_read(uint32_t offset, uint8_t *buf, uint16_t len,
+			 void *priv)
+{
+	uint32_t start = offset - FWU_TEST_OFFSET;
+
+	fwu_reads++;
+	if (fwu_read_fails || (uint8_t *)priv != fwu_img ||
+	    offset < FWU_TEST_OFFSET || start + len > FWU_TEST_IMG_SIZE)
+		return -1;
+	memcpy(buf, &fwu_img[start], len);
+	return 0;
+}
+
+/* Build an image of records of growing lengths; returns its size */
+static uint32_t fwu_test_image(int nb_cmds)
+{
+	uint32_t size = 0;
+	uint16_t cmd_len;
+	int i, j;
+
+	for (i = 0; i < nb_cmds; i++) {
+		cmd_len = 3 + (i * 37) % 251;
+		if (size + cmd_len + 2 > FWU_TEST_IMG_SIZE)
+			break;
+		fwu_img[size++] = cmd_len;
+		for (j = 0; j < cmd_len; j++)
+			fwu_img[size++] = i + j;
+		fwu_img[size++] = i % 32;
+	}
+	return size;
+}
+
+/*
+ * Play the image to a modelled controller, checking each frame against the
+ * image. Returns the number of commands, and the update time when commands
+ * are paced by the controller responses and by the fixed delays.
+ */
+static int fwu_test_play(uint32_t size, uint32_t *paced_ms,
+			 uint32_t *fixed_ms)
+{
+	struct nfc_fwu fwu;
+	uint32_t pos = 0;
+	uint8_t *frame;
+	uint16_t len, delay;
+	uint32_t xfer_us, proc_ms;
+	int ret, nb = 0;
+
+	*paced_ms = *fixed_ms = 0;
+	nfc_fwu_init(&fwu, fwu_buf, sizeof(fwu_buf), FWU_TEST_OFFSET, size,
+		     fwu_test_read, fwu_img);
+	while ((ret = nfc_fwu_next(&fwu, &frame, &len, &delay)) > 0) {
+		CU_ASSERT("frame PCB", frame[0] == (PCB_TYPE_DATAFRAME |
+						    PCB_DATAFRAME_RETRANSMIT_NO));
+		CU_ASSERT("frame length", len == fwu_img[pos] + 1);
+		CU_ASSERT("frame payload",
+			  !memcmp(&frame[1], &fwu_img[pos + 1], len - 1));
+		CU_ASSERT("frame delay",
+			  delay == fwu_img[pos + len] * NFC_FWU_DELAY_UNIT);
+		pos += len + 1;
+		CU_ASSERT("remaining", nfc_fwu_remaining(&fwu) == size - pos);
+
+		/* I2C at 400kHz: about 25us per byte; the controller answers
+		 * once the command is processed, within the command delay */
+		xfer_us = 25 * (len + 4);
+		proc_ms = MIN(FWU_TEST_PROC_MS * (1 + len / 32), delay);
+		*paced_ms += xfer_us / 1000 + proc_ms;
+		*fixed_ms += xfer_us / 1000 + delay;
+		nb++;
+	}
+	CU_ASSERT("image played to the end", ret == 0 && pos == size);
+	return nb;
+}
+
+void nfc_fwu_test(void)
+{
+	struct nfc_fwu fwu;
+	uint32_t size, paced_ms, fixed_ms;
+	uint8_t *frame;
+	uint16_t len, delay;
+	int nb;
+
+	size = fwu_test_image(50);
+	fwu_reads = 0;
+	fwu_read_fails = false;
+	nb = fwu_test_play(size, &paced_ms, &fixed_ms);
+	CU_ASSERT("all commands sent", nb > 10);
+	/* One read per buffer refill, instead of two per command */
+	CU_ASSERT("flash reads batched",
+		  fwu_reads <= (int)(size / (FWU_TEST_BUF_SIZE -
+					     NFC_FWU_RECORD_MAX / 2)) + 2);
+	CU_ASSERT("paced update faster", paced_ms < fixed_ms);
+	cu_print("nfc fwu: %d cmds, %d reads, %dms paced, %dms fixed\n", nb,
+		 fwu_reads, paced_ms, fixed_ms);
+
+	/* Empty image */
+	nfc_fwu_init(&fwu, fwu_buf, sizeof(fwu_buf), FWU_TEST_OFFSET, 0,
+		     fwu_test_read, fwu_img);
+	CU_ASSERT("empty image", nfc_fwu_next(&fwu, &frame, &len, &delay) == 0);
+
+	/* Truncated last record */
+	nfc_fwu_init(&fwu, fwu_buf, sizeof(fwu_buf), FWU_TEST_OFFSET, size - 1,
+		     fwu_test_read, fwu_img);
+	while (nfc_fwu_next(&fwu, &frame, &len, &delay) > 0)
+		;
+	CU_ASSERT("truncated image",
+		  nfc_fwu_next(&fwu, &frame, &len, &delay) == -1);
+
+	/* Zero length record */
+	fwu_img[0] = 0;
+	nfc_fwu_init(&fwu, fwu_buf, sizeof(fwu_buf), FWU_TEST_OFFSET, size,
+		     fwu_test_read, fwu_img);
+	CU_ASSERT("empty record",
+		  nfc_fwu_next(&fwu, &frame, &len, &delay) == -1);
+
+	/* Flash read error */
+	fwu_test_image(50);
+	fwu_read_fails = true;
+	nfc_fwu_init(&fwu, fwu_buf, sizeof(fwu_buf), FWU_TEST_OFFSET, size,
+		     fwu_test_read, fwu_img);
+	CU_ASSERT("read error",
+		  nfc_fwu_next(&fwu, &frame, &len, &delay) == -1);
+	fwu_read_fails = false;
+}
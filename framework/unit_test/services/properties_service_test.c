@@ -44,6 +44,9 @@ static uint32_t read_prop = DRV_RC_TOTAL_RC_CODE;
 static uint32_t write_prop = DRV_RC_TOTAL_RC_CODE;
 static uint32_t add_prop = DRV_RC_TOTAL_RC_CODE;
 static uint32_t delete_prop = DRV_RC_TOTAL_RC_CODE;
+static uint32_t write_multi_prop = DRV_RC_TOTAL_RC_CODE;
+static uint32_t read_multi_prop = DRV_RC_TOTAL_RC_CODE;
+static uint8_t read_multi_data[64];
 static uint32_t read_size_1 = 0;
 static uint32_t read_size_2 = 0;
 static uint8_t read_prop_index = 0;
@@ -56,6 +59,8 @@ static void reset(void)
 	write_prop = DRV_RC_TOTAL_RC_CODE;
 	add_prop = DRV_RC_TOTAL_RC_CODE;
 	delete_prop = DRV_RC_TOTAL_RC_CODE;
+	write_multi_prop = DRV_RC_TOTAL_RC_CODE;
+	read_multi_prop = DRV_RC_TOTAL_RC_CODE;
 	read_size_1 = 0;
 	read_size_2 = 0;
 	read_prop_index = 0;
@@ -131,6 +136,20 @@ static void handle_msg(struct cfw_message *msg, void *data)
 		delete_prop =
 			((properties_service_write_rsp_msg_t *)msg)->status;
 		break;
+	case MSG_ID_PROP_SERVICE_WRITE_MULTI_RSP:
+		write_multi_prop =
+			((properties_service_write_multi_rsp_msg_t *)msg)->
+			status;
+		break;
+	case MSG_ID_PROP_SERVICE_READ_MULTI_RSP: {
+		properties_service_read_multi_rsp_msg_t *rsp =
+			(properties_service_read_multi_rsp_msg_t *)msg;
+		if (rsp->items_size <= sizeof(read_multi_data))
+			memcpy(read_multi_data, rsp->start_of_items,
+			       rsp->items_size);
+		read_multi_prop = rsp->status;
+		break;
+	}
 	default:
 		cu_print("default cfw handler\n");
 		break;
@@ -295,6 +314,69 @@ static void property_test(void)
 	reset();
 	local_task_sleep_ms(100);
 
+	// Write several properties at once, including an existing one
+	properties_service_write_item_t items[] = {
+		{ non_persist_service_id, non_persist_property_id, value,
+		  non_persistent_size },
+		{ non_persist_service_id, non_persist_property_id + 1,
+		  persisten_value, persistent_size },
+	};
+	properties_service_write_multi(props_service_conn, items, 2, false,
+				       NULL);
+
+	SRV_WAIT((write_multi_prop == DRV_RC_TOTAL_RC_CODE), 0xFFFFF);
+	CU_ASSERT("Property Write Multi failure", write_multi_prop == DRV_RC_OK);
+
+	reset();
+	local_task_sleep_ms(100);
+
+	// Read them back, with a missing property
+	properties_service_id_t ids[] = {
+		{ non_persist_service_id, non_persist_property_id },
+		{ non_persist_service_id, non_persist_property_id + 1 },
+		{ non_persist_service_id, non_persist_property_id + 2 },
+	};
+	properties_service_read_multi(props_service_conn, ids, 3, NULL);
+
+	SRV_WAIT((read_multi_prop == DRV_RC_TOTAL_RC_CODE), 0xFFFFF);
+	CU_ASSERT("Property Read Multi failure", read_multi_prop == DRV_RC_OK);
+
+	properties_service_item_t *item =
+		(properties_service_item_t *)read_multi_data;
+	CU_ASSERT("Property Read Multi failure: incorrect item 0",
+		  item->status == DRV_RC_OK &&
+		  item->property_size == non_persistent_size &&
+		  memcmp(value, item->value, non_persistent_size) == 0);
+	item = PROPERTIES_SERVICE_NEXT_ITEM(item);
+	CU_ASSERT("Property Read Multi failure: incorrect item 1",
+		  item->status == DRV_RC_OK &&
+		  item->property_size == persistent_size &&
+		  memcmp(persisten_value, item->value, persistent_size) == 0);
+	item = PROPERTIES_SERVICE_NEXT_ITEM(item);
+	CU_ASSERT("Property Read Multi failure: item 2 should not exist",
+		  item->status == DRV_RC_INVALID_OPERATION &&
+		  item->property_size == 0);
+
+	reset();
+	local_task_sleep_ms(100);
+
+	// Read too many properties at once
+	properties_service_id_t many_ids[PROPERTIES_SERVICE_MAX_MULTI_ITEMS + 1];
+	for (int i = 0; i < PROPERTIES_SERVICE_MAX_MULTI_ITEMS + 1; i++) {
+		many_ids[i].service_id = non_persist_service_id;
+		many_ids[i].property_id = non_persist_property_id;
+	}
+	properties_service_read_multi(props_service_conn, many_ids,
+				      PROPERTIES_SERVICE_MAX_MULTI_ITEMS + 1,
+				      NULL);
+
+	SRV_WAIT((read_multi_prop == DRV_RC_TOTAL_RC_CODE), 0xFFFFF);
+	CU_ASSERT("Property Read Multi should fail",
+		  read_multi_prop == DRV_RC_INVALID_CONFIG);
+
+	reset();
+	local_task_sleep_ms(100);
+
 	// Delete the property
 	properties_service_remove(props_service_conn, non_persist_service_id,
 				  non_persist_property_id,
@@ -27,74 +27,60 @@
  * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
  * POSSIBILITY OF SUCH DAMAGE.
  */
-#include "infra/time.h"
 #include "opencore_algo_support.h"
-
-#define MAG_THRESHOLD_LVL    500       /* Dummy threshold just to compute the step count */
-#define FIVE_SEC_DURATION    5 * 1000  /* Cadence computation period (ms) */
-#define FIVE_SEC_IN_ONE_MIN  12        /* Cadence unit is nb/mn */
-#define MAX_CADENCE          512
+#include "lib/step_detector/step_detector.h"
 
 /* Structure used to report event */
 static struct cadence_result stepcadence_rpt_buf;
 
-static uint16_t step_count = 0;
-static uint32_t local_time = 0;
+static struct step_detector stepcadence_detector;
 
-/* Algorithm to compute cadence */
-static int stepcadence_algorithm_process(int16_t accel_data[3])
-{
-	uint32_t mag = 0;
-	int cadence = -1;
-
-	mag = (uint32_t)(accel_data[0] +
-			 accel_data[1] +
-			 accel_data[2]);
-	if (mag > MAG_THRESHOLD_LVL) {
-		step_count++;
-	}
-	/* Compute cadence every FIVE_SEC_DURATION period */
-	if (get_uptime_ms() >=
-	    (local_time + FIVE_SEC_DURATION)) {
-		/* cadence unit is nb/mn  and limited to MAX_CADENCE */
-		cadence = (step_count * FIVE_SEC_IN_ONE_MIN) % MAX_CADENCE;
-		step_count = 0;
-		local_time = get_uptime_ms();
-	}
-	return cadence;
-}
+static exposed_sensor_t stepcadence_exposed_sensor;
+
+/* Accelerometer demand index, resolved when the algorithm is started */
+static int stepcadence_index_a = -1;
 
 /*
  * The callback function below is the executed function on reception of
- * accelerometer data.
+ * accelerometer data: all the frames read since the last call are handed
+ * at once.
  */
-static int stepcadence_algorithm_exec(void **sensor_data, feed_general_t *feed)
+static int stepcadence_algorithm_exec_block(feed_block_t *blocks,
+					    feed_general_t *feed)
 {
 	int16_t accel_data[3] = { 0 };
-	int index_a = GetDemandIdx(feed, SENSOR_ACCELEROMETER);
-	int result = 0;
-	int ret = 0;
-
-	/* Retrieve accelerometer data and run algorithm */
-	if (index_a >= 0 && sensor_data[index_a] != NULL) {
-		int size = GetSensorDataFrameSize(
-			feed->demand[index_a].type,
-			feed->demand[index_a].id);
-		if (size > 0)
-			memcpy(&accel_data[0], sensor_data[index_a], size);
-
-		/* Run algorithm and report cadence if any */
-		result = stepcadence_algorithm_process(accel_data);
-		if (result != -1) {
-			exposed_sensor_t *sensor = GetExposedStruct(
-				SENSOR_ABS_CADENCE, DEFAULT_ID);
-			if (sensor != NULL) {
-				struct cadence_result *value =
-					(struct cadence_result *)
-					sensor->rpt_data_buf;
-				value->cadence = result;
-				sensor->ready_flag = 1;
-				ret = 1;
+	int index_a = stepcadence_index_a;
+	uint32_t time = 0;
+	uint16_t cadence;
+	uint16_t activity;
+	int i;
+
+	if (index_a >= 0) {
+		feed_block_t *accel = &blocks[index_a];
+		int size = accel->frame_size < sizeof(accel_data) ?
+			   accel->frame_size : sizeof(accel_data);
+
+		for (i = 0; i < accel->count; i++) {
+			memcpy(&accel_data[0],
+			       accel->frames + i * accel->frame_size, size);
+			time = accel->timestamp + i * accel->interval / 10;
+			step_detector_process(&stepcadence_detector,
+					      accel_data, time);
+		}
+
+		/* Report the cadence when it changes */
+		if (accel->count > 0) {
+			cadence = step_detector_cadence(&stepcadence_detector,
+							time);
+			activity = cadence == 0 ? NONACTIVITY :
+				   cadence < STEP_RUN_CADENCE ? WALKING :
+				   RUNNING;
+			if (cadence != stepcadence_rpt_buf.cadence ||
+			    activity != stepcadence_rpt_buf.activity) {
+				stepcadence_rpt_buf.cadence = cadence;
+				stepcadence_rpt_buf.activity = activity;
+				ReportSensDataDirectly(
+					&stepcadence_exposed_sensor);
 			}
 		}
 	}
@@ -102,7 +88,7 @@ static int stepcadence_algorithm_exec(void **sensor_data, feed_general_t *feed)
 	/* Accept to go to idle */
 	START_IDLE(feed);
 
-	return ret;
+	return 0;
 }
 
 /*
@@ -110,6 +96,9 @@ static int stepcadence_algorithm_exec(void **sensor_data, feed_general_t *feed)
  */
 static int stepcadence_algorithm_init(feed_general_t *feed_ptr)
 {
+	stepcadence_index_a = GetDemandIdx(feed_ptr, SENSOR_ACCELEROMETER);
+	step_detector_init(&stepcadence_detector);
+	memset(&stepcadence_rpt_buf, 0, sizeof(stepcadence_rpt_buf));
 	return 0;
 }
 
@@ -158,7 +147,7 @@ sensor_data_demand_t stepcadence_algo_demand[] = {
 		.id = DEFAULT_ID,
 		.range_max = DEFAULT_VALUE,
 		.range_min = DEFAULT_VALUE,
-		.freq = 100,
+		.freq = 25,
 		.rt = 1000,
 	}
 };
@@ -171,7 +160,7 @@ sensor_data_demand_t stepcadence_algo_demand[] = {
  * - demand: describes what physical sensor data is needed in the basic algo.
  * - demand_length: count of demand array.
  * - ctl_api: consists of the api callbacks used to control the basic algo,
- *            such as init, exex, goto_idle and out_idle
+ *            such as init, exec_block, goto_idle and out_idle
  * <define_feedinit> is used to make out the feed list in opencore.
  */
 static feed_general_t stepcadence_algo = {
@@ -182,7 +171,7 @@ static feed_general_t stepcadence_algo = {
 	.ctl_api = {
 		.init = stepcadence_algorithm_init,
 		.deinit = stepcadence_algorithm_deinit,
-		.exec = stepcadence_algorithm_exec,
+		.exec_block = stepcadence_algorithm_exec_block,
 		.goto_idle = stepcadence_algorithm_goto_idle,
 		.out_idle = stepcadence_algorithm_out_idle,
 	},
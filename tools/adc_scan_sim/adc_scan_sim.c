@@ -0,0 +1,699 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Host simulation of the fuel gauge sampling, counting the core wake-ups of
+ * the battery voltage and temperature measures.
+ *
+ * The fuel gauge (adc_fuel_gauge_api.c) and the ADC service (adc_service.c)
+ * are the target sources, built either with the fuel gauge timer and the GPIO
+ * service load switches, or with CONFIG_FG_ADC_SCAN. They run on a simulated
+ * clock: the fuel gauge on the Quark, the ADC and GPIO services on the ARC.
+ * The framework, the timers, the GPIO service and the drivers are modeled
+ * here. A message between the cores takes IPC_US, a message on the same core
+ * is handled at once.
+ *
+ * A core wakes up when it handles a timer or a message at a time it was not
+ * already running. The counts do not depend on the host, but they are those of
+ * the model: interrupts, scheduler ticks and the other services are left out.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "cfw/cfw.h"
+#include "cfw/cfw_service.h"
+#include "machine.h"
+#include "os/os.h"
+#include "infra/device.h"
+#include "infra/log.h"
+#include "infra/pm.h"
+#include "drivers/gpio.h"
+#include "drivers/ss_adc.h"
+#include "services/adc_service/adc_service.h"
+#include "services/battery_service/battery_service.h"
+
+#include "battery_LUT/battery_LUT.h"
+#include "battery_property.h"
+#include "fuel_gauge_api.h"
+#include "charging_sm.h"
+
+#include "adc_scan_sim.h"
+
+#define WARMUP_S        120     /* Boot measures and subscriptions */
+#define MAX_EVENTS      256
+
+#define MS(us)          ((us) / 1000)
+
+static const char *const core_names[NB_CORES] = { "quark", "arc" };
+
+static uint64_t now_us;
+static int cur_core = QUARK;
+
+static struct {
+	uint64_t last_us;       /* Time of the last handled event */
+	uint32_t wakeups;
+	uint32_t timers;
+	uint32_t msgs;
+} cores[NB_CORES];
+
+static struct {
+	uint32_t sequences;     /* ADC hardware sequences */
+	uint32_t conversions;   /* Channels converted */
+	uint32_t gpio_writes;
+	uint64_t ls_on_us;      /* Time a load switch is on */
+	uint64_t ls_since_us;
+	bool ls_on;
+	uint32_t measures;      /* ADC results received by the fuel gauge */
+} stats;
+
+/*
+ * Event queue
+ */
+
+enum evt_kind { EVT_TIMER, EVT_MSG, EVT_CALL };
+
+struct sim_timer {
+	T_ENTRY_POINT cb;
+	void *priv;
+	uint32_t delay;
+	bool repeat;
+	bool deleted;
+	int core;
+	uint32_t gen;           /* Invalidates the queued expiries */
+	uint32_t pending;       /* Queued expiries */
+};
+
+struct sim_evt {
+	uint64_t time;
+	uint32_t seq;
+	int core;
+	enum evt_kind kind;
+	void *ptr;
+	void (*call)(void *ptr, uint32_t arg);
+	uint32_t arg;
+};
+
+static struct sim_evt events[MAX_EVENTS];
+static int nb_events;
+static uint32_t evt_seq;
+
+static bool evt_before(const struct sim_evt *a, const struct sim_evt *b)
+{
+	return a->time < b->time || (a->time == b->time && a->seq < b->seq);
+}
+
+static void evt_push(struct sim_evt e)
+{
+	int i = nb_events++;
+
+	if (nb_events > MAX_EVENTS) {
+		fprintf(stderr, "event queue full\n");
+		exit(1);
+	}
+	e.seq = evt_seq++;
+	while (i && evt_before(&e, &events[(i - 1) / 2])) {
+		events[i] = events[(i - 1) / 2];
+		i = (i - 1) / 2;
+	}
+	events[i] = e;
+}
+
+static struct sim_evt evt_pop(void)
+{
+	struct sim_evt top = events[0], last = events[--nb_events];
+	int i = 0, c;
+
+	while ((c = 2 * i + 1) < nb_events) {
+		if (c + 1 < nb_events && evt_before(&events[c + 1], &events[c]))
+			c++;
+		if (!evt_before(&events[c], &last))
+			break;
+		events[i] = events[c];
+		i = c;
+	}
+	events[i] = last;
+	return top;
+}
+
+void sim_call(int core, uint64_t delay_us,
+		     void (*call)(void *, uint32_t), void *ptr, uint32_t arg)
+{
+	evt_push((struct sim_evt){ .time = now_us + delay_us, .core = core,
+				   .kind = EVT_CALL, .call = call, .ptr = ptr,
+				   .arg = arg });
+}
+
+/*
+ * OS
+ */
+
+uint32_t get_uptime_ms(void)
+{
+	return MS(now_us);
+}
+
+void *balloc(uint32_t size, OS_ERR_TYPE *err)
+{
+	if (err)
+		*err = E_OS_OK;
+	return malloc(size);
+}
+
+OS_ERR_TYPE bfree(void *buffer)
+{
+	free(buffer);
+	return E_OS_OK;
+}
+
+static void timer_queue(struct sim_timer *t)
+{
+	t->pending++;
+	evt_push((struct sim_evt){ .time = now_us + t->delay * 1000ULL,
+				   .core = t->core, .kind = EVT_TIMER,
+				   .ptr = t, .arg = t->gen });
+}
+
+T_TIMER timer_create(T_ENTRY_POINT callback, void *privData, uint32_t delay,
+		     bool repeat, bool startup, OS_ERR_TYPE *err)
+{
+	struct sim_timer *t = calloc(1, sizeof(*t));
+
+	t->cb = callback;
+	t->priv = privData;
+	t->delay = delay;
+	t->repeat = repeat;
+	t->core = cur_core;
+	if (startup)
+		timer_queue(t);
+	if (err)
+		*err = E_OS_OK;
+	return t;
+}
+
+void timer_start(T_TIMER tmr, uint32_t delay, OS_ERR_TYPE *err)
+{
+	struct sim_timer *t = tmr;
+
+	t->gen++;
+	t->delay = delay;
+	timer_queue(t);
+	if (err)
+		*err = E_OS_OK;
+}
+
+void timer_stop(T_TIMER tmr)
+{
+	((struct sim_timer *)tmr)->gen++;
+}
+
+void timer_delete(T_TIMER tmr)
+{
+	struct sim_timer *t = tmr;
+
+	t->gen++;
+	t->deleted = true;
+	if (!t->pending)
+		free(t);
+}
+
+void pm_wakelock_init(struct pm_wakelock *wli)
+{
+}
+
+int pm_wakelock_acquire(struct pm_wakelock *wl)
+{
+	return 0;
+}
+
+int pm_wakelock_release(struct pm_wakelock *wl)
+{
+	return 0;
+}
+
+void log_printk(uint8_t level, const char *module_short_name,
+		const char *format, ...)
+{
+}
+
+/*
+ * Framework: one client, the fuel gauge, and the ADC and GPIO services
+ */
+
+static handle_msg_cb_t fg_handler;
+static void *fg_handler_param;
+static void (*adc_handler)(struct cfw_message *, void *);
+static service_t *adc_svc;
+
+static cfw_service_conn_t adc_conn = {
+	.port = PORT_ADC, .service_id = SS_ADC_SERVICE_ID
+};
+static cfw_service_conn_t gpio_conn = {
+	.port = PORT_GPIO, .service_id = SS_GPIO_SERVICE_ID
+};
+
+static int port_core(uint16_t port)
+{
+	return port == PORT_FG ? QUARK : ARC;
+}
+
+T_QUEUE get_service_queue(void)
+{
+	return NULL;
+}
+
+cfw_client_t *cfw_client_init(void *queue, handle_msg_cb_t cb, void *param)
+{
+	fg_handler = cb;
+	fg_handler_param = param;
+	return &fg_handler;
+}
+
+int cfw_register_service(T_QUEUE queue, service_t *service,
+			 handle_msg_cb_t handle_message, void *data)
+{
+	adc_svc = service;
+	adc_handler = handle_message;
+	return 0;
+}
+
+static void sim_open_done(void *cb, uint32_t service_id)
+{
+	cfw_service_conn_t *conn = service_id == SS_ADC_SERVICE_ID ?
+				   &adc_conn : &gpio_conn;
+
+	((void (*)(cfw_service_conn_t *, void *))cb)(
+		conn, (void *)(uintptr_t)service_id);
+}
+
+void cfw_open_service_helper(cfw_client_t *client, uint16_t service_id,
+			     void (*cb)(cfw_service_conn_t *, void *),
+			     void *cb_param)
+{
+	/* The service manager answers through the ARC */
+	sim_call(QUARK, 2 * IPC_US, sim_open_done, cb, service_id);
+}
+
+struct cfw_message *sim_alloc(int id, int size, uint16_t src,
+				     uint16_t dst, void *priv)
+{
+	struct cfw_message *msg = calloc(1, size);
+
+	CFW_MESSAGE_ID(msg) = id;
+	CFW_MESSAGE_SRC(msg) = src;
+	CFW_MESSAGE_DST(msg) = dst;
+	CFW_MESSAGE_LEN(msg) = size;
+	msg->priv = priv;
+	return msg;
+}
+
+struct cfw_message *cfw_alloc_message(int size)
+{
+	return calloc(1, size);
+}
+
+struct cfw_message *cfw_alloc_message_for_service(
+	const cfw_service_conn_t *c, int msg_id, int msg_size, void *priv)
+{
+	struct cfw_message *msg = sim_alloc(msg_id, msg_size, PORT_FG, c->port,
+					    priv);
+
+	msg->conn = (void *)c;
+	return msg;
+}
+
+struct cfw_message *cfw_alloc_rsp_msg(const struct cfw_message *req,
+				      int msg_id, int size)
+{
+	struct cfw_message *msg = sim_alloc(msg_id, size,
+					    CFW_MESSAGE_DST(req),
+					    CFW_MESSAGE_SRC(req), req->priv);
+
+	msg->conn = req->conn;
+	CFW_MESSAGE_TYPE(msg) = TYPE_RSP;
+	return msg;
+}
+
+struct cfw_message *cfw_alloc_rsp_message_for_client(cfw_service_conn_t *conn,
+						     int msg_id, int size,
+						     void *priv)
+{
+	struct cfw_message *msg = sim_alloc(msg_id, size, conn->port, PORT_FG,
+					    priv);
+
+	msg->conn = conn;
+	return msg;
+}
+
+int _cfw_send_message(struct cfw_message *msg)
+{
+	int core = port_core(CFW_MESSAGE_DST(msg));
+
+	evt_push((struct sim_evt){ .time = now_us +
+					   (core == cur_core ? 0 : IPC_US),
+				   .core = core, .kind = EVT_MSG,
+				   .ptr = msg });
+	return 0;
+}
+
+void cfw_msg_free(struct cfw_message *msg)
+{
+	free(msg);
+}
+
+void cfw_print_default_handle_error_msg(const char *module, uint16_t msg_id)
+{
+}
+
+/*
+ * Load switch GPIOs, through the GPIO service or the SS GPIO driver
+ */
+
+void sim_gpio_level(uint8_t pin, bool level)
+{
+	stats.gpio_writes++;
+	if (level && !stats.ls_on)
+		stats.ls_since_us = now_us;
+	else if (!level && stats.ls_on)
+		stats.ls_on_us += now_us - stats.ls_since_us;
+	stats.ls_on = level;
+}
+
+static DRIVER_API_RC sim_gpio_set_config(struct td_device *dev, uint8_t bit,
+					 gpio_cfg_data_t *config)
+{
+	return DRV_RC_OK;
+}
+
+static DRIVER_API_RC sim_gpio_deconfig(struct td_device *dev, uint8_t bit)
+{
+	return DRV_RC_OK;
+}
+
+static DRIVER_API_RC sim_gpio_write(struct td_device *dev, uint8_t bit,
+				    bool value)
+{
+	sim_gpio_level(bit, value);
+	return DRV_RC_OK;
+}
+
+static struct gpio_driver sim_gpio_driver = {
+	.set_config = sim_gpio_set_config,
+	.deconfig = sim_gpio_deconfig,
+	.write = sim_gpio_write,
+};
+
+static struct gpio_port sim_gpio_port = { .api = &sim_gpio_driver };
+
+struct td_device pf_device_ss_gpio_8b0 = { .priv = &sim_gpio_port };
+struct td_device pf_device_ss_gpio_8b1 = { .priv = &sim_gpio_port };
+struct td_device pf_device_ss_adc;
+
+/*
+ * ADC and battery
+ */
+
+#define SIM_MV_START    4100    /* Battery voltage at boot */
+#define SIM_MV_PER_H    60      /* Discharge slope */
+#define SIM_TEMP_C      25
+
+static uint16_t sim_adc_value(uint8_t channel)
+{
+	uint32_t mv = SIM_MV_START - SIM_MV_PER_H * now_us / 3600000000ULL;
+
+	stats.conversions++;
+	if (channel == ADC_TEMPERATURE_CHANNEL)
+		return (CONFIG_B_TEMP_ADC_FACTOR - SIM_TEMP_C * 1000) /
+		       CONFIG_A_TEMP_ADC_FACTOR;
+	return mv * 1000 / CONFIG_BATT_ADC_FACTOR;
+}
+
+DRIVER_API_RC ss_adc_read(uint8_t channel_id, uint16_t *result_value)
+{
+	stats.sequences++;
+	*result_value = sim_adc_value(channel_id);
+	return DRV_RC_OK;
+}
+
+DRIVER_API_RC ss_adc_read_multi(const uint8_t *channel_ids,
+				uint8_t nb_channels, uint16_t *result_values)
+{
+	uint8_t i;
+
+	stats.sequences++;
+	for (i = 0; i < nb_channels; i++)
+		result_values[i] = sim_adc_value(channel_ids[i]);
+	return DRV_RC_OK;
+}
+
+static struct battery_properties_t battery_properties = {
+	.battery_soc = BP_INIT_FLASH_SOC_VAL,
+};
+
+struct battery_properties_t *battery_properties_get(void)
+{
+	return &battery_properties;
+}
+
+bp_status_t battery_properties_get_lookupTable(
+	struct battprop_fuelgauge_t *battprop_fuelgauge, uint16_t **lookuptable)
+{
+	*lookuptable = (uint16_t *)dflt_lookup_tables[
+		BATTPROP_LOOKUPTAB_DISCHARGE_25];
+	return BP_STATUS_SUCCESS;
+}
+
+enum e_state charging_sm_get_state(void)
+{
+	return DISCHARGE;
+}
+
+bool charging_sm_is_charging(void)
+{
+	return false;
+}
+
+/*
+ * Fuel gauge client
+ */
+
+static uint8_t last_soc;
+
+static void fg_evt(fg_event_t fg_event,
+		   battery_service_evt_content_rsp_msg_t *content)
+{
+	if (fg_event == FG_EVT_SOC_UPDATED)
+		last_soc = content->bat_soc;
+}
+
+static void fg_ready(void)
+{
+}
+
+static void sim_dispatch_msg(struct cfw_message *msg)
+{
+	if (CFW_MESSAGE_DST(msg) != PORT_FG) {
+		adc_handler(msg, adc_svc);
+		return;
+	}
+	if (CFW_MESSAGE_ID(msg) == MSG_ID_ADC_SERVICE_GET_VAL_RSP ||
+	    CFW_MESSAGE_ID(msg) == MSG_ID_ADC_SERVICE_SCAN_EVT)
+		stats.measures++;
+	fg_handler(msg, fg_handler_param);
+}
+
+static void sim_wake(int core)
+{
+	if (cores[core].last_us != now_us)
+		cores[core].wakeups++;
+	cores[core].last_us = now_us;
+}
+
+static void sim_run(uint64_t end_us)
+{
+	struct sim_evt e;
+	struct sim_timer *t;
+
+	while (nb_events && events[0].time <= end_us) {
+		e = evt_pop();
+		now_us = e.time;
+		cur_core = e.core;
+		switch (e.kind) {
+		case EVT_TIMER:
+			t = e.ptr;
+			t->pending--;
+			if (t->deleted) {
+				if (!t->pending)
+					free(t);
+				break;
+			}
+			if (e.arg != t->gen)
+				break;
+			sim_wake(e.core);
+			cores[e.core].timers++;
+			if (t->repeat)
+				timer_queue(t);
+			t->cb(t->priv);
+			break;
+		case EVT_MSG:
+			sim_wake(e.core);
+			cores[e.core].msgs++;
+			sim_dispatch_msg(e.ptr);
+			break;
+		case EVT_CALL:
+			/* Requests to the modeled services */
+			sim_wake(e.core);
+			cores[e.core].msgs++;
+			e.call(e.ptr, e.arg);
+			break;
+		}
+	}
+	now_us = end_us;
+}
+
+static void sim_reset_stats(void)
+{
+	int i;
+
+	for (i = 0; i < NB_CORES; i++) {
+		cores[i].wakeups = 0;
+		cores[i].timers = 0;
+		cores[i].msgs = 0;
+	}
+	stats.sequences = 0;
+	stats.conversions = 0;
+	stats.gpio_writes = 0;
+	stats.ls_on_us = 0;
+	stats.ls_since_us = now_us;
+	stats.measures = 0;
+}
+
+static uint32_t per_hour(uint64_t count, uint32_t duration_s)
+{
+	return (count * 3600 + duration_s / 2) / duration_s;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr,
+		"usage: %s [-d seconds] [-v voltage_ms] [-t temperature_ms]\n"
+		"  -d  simulated time after the %d s boot phase (3600)\n"
+		"  -v  voltage measure period, set through "
+		"fg_set_voltage_interval\n"
+		"  -t  temperature measure period, set through "
+		"fg_set_temp_interval\n",
+		name, WARMUP_S);
+}
+
+extern const struct _cfw_registered_service __service_ADC_SS_ADC_SERVICE_ID;
+
+int main(int argc, char **argv)
+{
+	fg_event_callback_t fg_callback = { fg_evt };
+	uint32_t duration_s = 3600;
+	int voltage_ms = -1, temp_ms = -1;
+	uint32_t total = 0;
+	int opt, i;
+
+	while ((opt = getopt(argc, argv, "d:v:t:h")) != -1) {
+		switch (opt) {
+		case 'd':
+			duration_s = atoi(optarg);
+			break;
+		case 'v':
+			voltage_ms = atoi(optarg);
+			break;
+		case 't':
+			temp_ms = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+	if (!duration_s) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	/* The board features are read from the shared RAM block */
+	if (mmap((void *)RAM_START, 4096, PROT_READ | PROT_WRITE,
+		 MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) ==
+	    MAP_FAILED) {
+		perror("mmap");
+		return 1;
+	}
+
+	for (i = 0; i < NB_CORES; i++)
+		cores[i].last_us = UINT64_MAX;
+
+	cur_core = ARC;
+	__service_ADC_SS_ADC_SERVICE_ID.init(SS_ADC_SERVICE_ID, NULL);
+	cur_core = QUARK;
+	fg_init((void *)&fg_callback, &fg_callback, fg_ready);
+	if (voltage_ms >= 0)
+		fg_set_voltage_interval(voltage_ms);
+	if (temp_ms >= 0)
+		fg_set_temp_interval(temp_ms);
+
+	sim_run(WARMUP_S * 1000000ULL);
+	sim_reset_stats();
+	sim_run(now_us + duration_s * 1000000ULL);
+	if (stats.ls_on)
+		stats.ls_on_us += now_us - stats.ls_since_us;
+
+#ifdef CONFIG_FG_ADC_SCAN
+	printf("ADC service scans\n");
+#else
+	printf("fuel gauge timer and GPIO service\n");
+#endif
+	printf("  per hour, over %u s after a %d s boot phase:\n",
+	       duration_s, WARMUP_S);
+	for (i = 0; i < NB_CORES; i++) {
+		printf("  %-5s wake-ups %6u  timers %6u  messages %6u\n",
+		       core_names[i], per_hour(cores[i].wakeups, duration_s),
+		       per_hour(cores[i].timers, duration_s),
+		       per_hour(cores[i].msgs, duration_s));
+		total += cores[i].wakeups;
+	}
+	printf("  total wake-ups %u\n", per_hour(total, duration_s));
+	printf("  ADC sequences %u, conversions %u\n",
+	       per_hour(stats.sequences, duration_s),
+	       per_hour(stats.conversions, duration_s));
+	printf("  load switch writes %u, on %u ms\n",
+	       per_hour(stats.gpio_writes, duration_s),
+	       per_hour(stats.ls_on_us / 1000, duration_s));
+	printf("  fuel gauge measures %u, last SOC %u%%\n",
+	       per_hour(stats.measures, duration_s), last_soc);
+	return 0;
+}
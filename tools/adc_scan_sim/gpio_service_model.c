@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Model of the GPIO service on the ARC, for the load switches of the fuel
+ * gauge timer mode. It answers each request after a message to the ARC.
+ */
+
+#include "cfw/cfw_service.h"
+#include "services/gpio_service/gpio_service.h"
+
+#include "adc_scan_sim.h"
+
+static void sim_gpio_service_rsp(void *priv, uint32_t id)
+{
+	gpio_service_set_state_rsp_msg_t *rsp =
+		(gpio_service_set_state_rsp_msg_t *)sim_alloc(
+			id, sizeof(*rsp), PORT_GPIO, PORT_FG, priv);
+
+	rsp->status = DRV_RC_OK;
+	cfw_send_message(rsp);
+}
+
+static void sim_gpio_service_set(void *priv, uint32_t pin_level)
+{
+	sim_gpio_level(pin_level >> 1, pin_level & 1);
+	sim_gpio_service_rsp(priv, MSG_ID_GPIO_SERVICE_SET_STATE_RSP);
+}
+
+void gpio_service_configure(cfw_service_conn_t *service_conn, uint8_t index,
+			    uint8_t mode, void *priv)
+{
+	sim_call(ARC, IPC_US, sim_gpio_service_rsp, priv,
+		 MSG_ID_GPIO_SERVICE_CONFIGURE_RSP);
+}
+
+void gpio_service_set_state(cfw_service_conn_t *service_conn, uint8_t index,
+			    uint8_t value, void *priv)
+{
+	sim_call(ARC, IPC_US, sim_gpio_service_set, priv, index << 1 | value);
+}
@@ -0,0 +1,324 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Host simulation of the bootupdater (bsp/bootable/bootupdater).
+ *
+ * The embedded flash is a RAM array. The installed bootloader is put on the
+ * boot pages and the new one on the pages where the flashing stages it, then
+ * the target code of the bootupdater copies it. For typical differences
+ * between two versions, the simulation counts the pages erased and the words
+ * programmed. It then replays each update with a power cut at every flash
+ * operation, checks that running the updater again completes it, and checks
+ * that a page which can't be programmed is reported.
+ */
+
+#include <limits.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define main bootupdater_main
+#include "bootupdater.c"
+#undef main
+
+#define BL_SIZE (BOOT_PAGE_NR * EMBEDDED_FLASH_BLOCK_SIZE)
+/* Size of the code of the generated bootloaders, the end is left erased */
+#define CODE_SIZE (BL_SIZE * 3 / 4)
+/* Version header near the start of the image: its version string and hash
+ * differ between two builds */
+#define VERSION_OFFSET 0x40
+#define VERSION_SIZE 32
+
+uint8_t host_flash[EMBEDDED_FLASH_NB_BLOCKS * EMBEDDED_FLASH_BLOCK_SIZE];
+uint32_t host_scss_regs[0x1000 / 4];
+
+static struct {
+	unsigned int erases;
+	unsigned int writes;
+	unsigned int words;
+} stats;
+
+/* Flash operations since the start of the current run, and operation
+ * interrupted by a power cut */
+static unsigned int nb_ops;
+static unsigned int cut_at = UINT_MAX;
+static jmp_buf power_cut;
+/* Page which never programs correctly */
+static int bad_page = -1;
+static int verbose;
+
+static uint8_t installed[BL_SIZE];
+static uint8_t new_bl[BL_SIZE];
+
+int soc_flash_block_erase(unsigned int start_block, unsigned int block_count)
+{
+	for (unsigned int b = start_block; b < start_block + block_count;
+	     b++) {
+		uint8_t *page = &host_flash[b * EMBEDDED_FLASH_BLOCK_SIZE];
+		if (++nb_ops == cut_at) {
+			/* The content of a page which was being erased is
+			 * undefined */
+			memset(page, 0x5a, EMBEDDED_FLASH_BLOCK_SIZE / 2);
+			longjmp(power_cut, 1);
+		}
+		memset(page, 0xff, EMBEDDED_FLASH_BLOCK_SIZE);
+		stats.erases++;
+	}
+	return 0;
+}
+
+/* Programming only clears bits, as on the embedded flash */
+int soc_flash_write(uint32_t address, unsigned int len, unsigned int *retlen,
+		    uint32_t *data)
+{
+	uint32_t *dst = (uint32_t *)&host_flash[address];
+	unsigned int n = ++nb_ops == cut_at ? len / 2 : len;
+
+	for (unsigned int i = 0; i < n; i++)
+		dst[i] &= data[i];
+	if (bad_page >= 0 &&
+	    address / EMBEDDED_FLASH_BLOCK_SIZE == (unsigned int)bad_page)
+		dst[0] = 0;
+	stats.writes++;
+	stats.words += n;
+	if (n != len)
+		longjmp(power_cut, 1);
+	*retlen = len;
+	return 0;
+}
+
+void uart_puts(char *str)
+{
+	if (verbose)
+		fputs(str, stdout);
+}
+
+void uart_init(int which, uint32_t port, int baud_rate)
+{
+}
+
+void soc_init(void)
+{
+}
+
+void set_boot_target(enum boot_targets target)
+{
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr,
+		"Usage: %s [-v] [-s seed] [-f installed.bin -t new.bin]\n"
+		"  -v  print the output of the bootupdater\n"
+		"  -s  seed of the generated bootloaders\n"
+		"  -f  installed bootloader, -t new bootloader: simulate this\n"
+		"      update instead of the generated ones\n",
+		name);
+	exit(1);
+}
+
+static void load(const char *path, uint8_t *buf)
+{
+	FILE *f = fopen(path, "rb");
+
+	if (!f) {
+		perror(path);
+		exit(1);
+	}
+	memset(buf, 0xff, BL_SIZE);
+	if (fread(buf, 1, BL_SIZE, f) == BL_SIZE && fgetc(f) != EOF) {
+		fprintf(stderr, "%s: larger than the %d boot pages\n", path,
+			BOOT_PAGE_NR);
+		exit(1);
+	}
+	fclose(f);
+}
+
+static void random_bytes(uint8_t *buf, int len)
+{
+	while (len--)
+		*buf++ = rand();
+}
+
+/* Build a new bootloader from the installed one */
+static void make_new(const char *scenario)
+{
+	memcpy(new_bl, installed, BL_SIZE);
+	random_bytes(&new_bl[VERSION_OFFSET], VERSION_SIZE);
+	if (!strcmp(scenario, "patch")) {
+		/* A fix changes a few instructions of one function */
+		random_bytes(&new_bl[CODE_SIZE / 2], 16);
+	} else if (!strcmp(scenario, "insert")) {
+		/* A function grows, the following code moves */
+		int at = CODE_SIZE * 3 / 5;
+		memmove(&new_bl[at + 128], &installed[at], CODE_SIZE - at);
+		random_bytes(&new_bl[at], 128);
+	} else if (!strcmp(scenario, "rebuild")) {
+		random_bytes(new_bl, CODE_SIZE);
+	}
+}
+
+/* Put the installed and the new bootloaders in flash. The progress page
+ * holds what the previous flashing left there */
+static void setup_flash(void)
+{
+	memset(host_flash, 0xff, sizeof(host_flash));
+	memcpy(PAGE_ADDR(BOOT_PAGE_START), installed, BL_SIZE);
+	memcpy(PAGE_ADDR(ARC_START_PAGE), new_bl, BL_SIZE);
+	random_bytes((uint8_t *)PAGE_ADDR(PROGRESS_PAGE),
+		     EMBEDDED_FLASH_BLOCK_SIZE);
+	memset(&stats, 0, sizeof(stats));
+}
+
+static int bl_updated(void)
+{
+	return !memcmp(PAGE_ADDR(BOOT_PAGE_START), new_bl, BL_SIZE);
+}
+
+/* Run the updater with a power cut at operation cut, then run it again
+ * without power cut if it was interrupted */
+static void run_update(unsigned int cut)
+{
+	nb_ops = 0;
+	cut_at = cut;
+	if (setjmp(power_cut) == 0) {
+		copy_boot_pages();
+		return;
+	}
+	nb_ops = 0;
+	cut_at = UINT_MAX;
+	copy_boot_pages();
+}
+
+static int simulate(const char *scenario)
+{
+	int nb_diff = 0;
+
+	for (int i = 0; i < BOOT_PAGE_NR; i++)
+		nb_diff += !!memcmp(&installed[i * EMBEDDED_FLASH_BLOCK_SIZE],
+				    &new_bl[i * EMBEDDED_FLASH_BLOCK_SIZE],
+				    EMBEDDED_FLASH_BLOCK_SIZE);
+
+	setup_flash();
+	run_update(UINT_MAX);
+	if (!bl_updated()) {
+		printf("%-8s update failed\n", scenario);
+		return 1;
+	}
+	unsigned int nb_ops_update = nb_ops;
+	printf("%-8s %2d pages differ: %2u erases %5u words %3u flash ops",
+	       scenario, nb_diff, stats.erases, stats.words, nb_ops_update);
+
+	/* Power cut at each flash operation, then a second run */
+	unsigned int worst = 0, sum = 0;
+	for (unsigned int cut = 1; cut <= nb_ops_update; cut++) {
+		setup_flash();
+		run_update(cut);
+		if (!bl_updated()) {
+			printf("\n%-8s not resumed after a power cut at "
+			       "operation %u\n", scenario, cut);
+			return 1;
+		}
+		sum += stats.erases;
+		if (stats.erases > worst)
+			worst = stats.erases;
+	}
+	printf(", power cut: %.1f erases, %u worst\n",
+	       (double)sum / nb_ops_update, worst);
+
+	/* A page which can't be programmed fails all the passes */
+	setup_flash();
+	bad_page = BOOT_PAGE_START + BOOT_PAGE_NR - 1;
+	memset(&installed[bad_page * EMBEDDED_FLASH_BLOCK_SIZE], 0,
+	       EMBEDDED_FLASH_BLOCK_SIZE);
+	memcpy(PAGE_ADDR(bad_page), &installed[bad_page *
+					       EMBEDDED_FLASH_BLOCK_SIZE],
+	       EMBEDDED_FLASH_BLOCK_SIZE);
+	int pass;
+	for (pass = 0; pass < BOOT_UPDATE_PASSES; pass++)
+		if (copy_boot_pages() == 0)
+			break;
+	bad_page = -1;
+	if (pass != BOOT_UPDATE_PASSES) {
+		printf("%-8s bad page not reported\n", scenario);
+		return 1;
+	}
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	static const char *const scenarios[] = {
+		"version", "patch", "insert", "rebuild"
+	};
+	const char *from = NULL, *to = NULL;
+	int opt, ret = 0;
+
+	srand(1);
+	while ((opt = getopt(argc, argv, "vs:f:t:")) != -1) {
+		switch (opt) {
+		case 'v':
+			verbose = 1;
+			break;
+		case 's':
+			srand(atoi(optarg));
+			break;
+		case 'f':
+			from = optarg;
+			break;
+		case 't':
+			to = optarg;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (!from != !to)
+		usage(argv[0]);
+
+	printf("full copy: %d erases %5d words\n", BOOT_PAGE_NR,
+	       BL_SIZE / 4);
+	if (from) {
+		load(from, installed);
+		load(to, new_bl);
+		return simulate("files");
+	}
+	for (unsigned int i = 0; i < sizeof(scenarios) / sizeof(*scenarios);
+	     i++) {
+		memset(installed, 0xff, BL_SIZE);
+		random_bytes(installed, CODE_SIZE);
+		make_new(scenarios[i]);
+		ret |= simulate(scenarios[i]);
+	}
+	return ret;
+}
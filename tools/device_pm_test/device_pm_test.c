@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Host run of the device power management unit tests, with mock drivers.
+ *
+ * device_pm_test (bsp/unit_test/.../device_pm_tst.c) brings its own mock
+ * devices. sba_resume_test drives the SBA driver over a mock SoC I2C
+ * controller, whose transfers complete when the test says so, to check that
+ * a request issued while the bus is being resumed on demand is queued and
+ * run after the resume. Everything runs on a single host thread: the
+ * "interrupt" issuing a request during the resume is a call made from the
+ * mock controller configuration, which sba_resume() runs.
+ */
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "infra/device.h"
+#include "infra/log.h"
+#include "drivers/serial_bus_access.h"
+#include "drivers/soc_i2c.h"
+#include "util/cunit_test.h"
+
+void __assert_fail(void)
+{
+	fprintf(stderr, "assertion failed\n");
+	abort();
+}
+
+uint32_t get_uptime_32k(void)
+{
+	static uint32_t now;
+
+	return now += 3;
+}
+
+void pm_wakelock_set_any_wakelock_taken_on_cpu(bool wl_status)
+{
+}
+
+void panic(int err)
+{
+	fprintf(stderr, "panic %d\n", err);
+	abort();
+}
+
+void log_printk(uint8_t level, const char *module, const char *format, ...)
+{
+	va_list args;
+
+	va_start(args, format);
+	vprintf(format, args);
+	va_end(args);
+	printf("\n");
+}
+
+void log_flush(void)
+{
+}
+
+/* Mock SoC I2C controller */
+static i2c_cfg_data_t mock_i2c_cfg;
+static int mock_i2c_clock;
+static uint8_t *mock_i2c_started[8];
+static int mock_i2c_nb;
+/* Request issued from "interrupt context" during the next configuration */
+static sba_request_t *mock_i2c_nested;
+static DRIVER_API_RC mock_i2c_nested_rc;
+
+DRIVER_API_RC soc_i2c_clock_enable(struct sba_master_cfg_data *sba_dev)
+{
+	mock_i2c_clock = 1;
+	return DRV_RC_OK;
+}
+
+DRIVER_API_RC soc_i2c_clock_disable(struct sba_master_cfg_data *sba_dev)
+{
+	mock_i2c_clock = 0;
+	return DRV_RC_OK;
+}
+
+DRIVER_API_RC soc_i2c_set_config(SOC_I2C_CONTROLLER controller_id,
+				 i2c_cfg_data_t *config)
+{
+	sba_request_t *req = mock_i2c_nested;
+
+	mock_i2c_cfg = *config;
+	if (req) {
+		mock_i2c_nested = NULL;
+		mock_i2c_nested_rc = sba_exec_request(req);
+	}
+	return DRV_RC_OK;
+}
+
+static DRIVER_API_RC mock_i2c_start(uint8_t *data)
+{
+	if (!mock_i2c_clock ||
+	    mock_i2c_nb == sizeof(mock_i2c_started) / sizeof(uint8_t *))
+		return DRV_RC_FAIL;
+	mock_i2c_started[mock_i2c_nb++] = data;
+	return DRV_RC_OK;
+}
+
+DRIVER_API_RC soc_i2c_write(SOC_I2C_CONTROLLER controller_id, uint8_t *data,
+			    uint32_t data_len, uint32_t slave_addr)
+{
+	return mock_i2c_start(data);
+}
+
+DRIVER_API_RC soc_i2c_read(SOC_I2C_CONTROLLER controller_id, uint8_t *data,
+			   uint32_t data_len, uint32_t slave_addr)
+{
+	return mock_i2c_start(data);
+}
+
+DRIVER_API_RC soc_i2c_transfer(SOC_I2C_CONTROLLER controller_id,
+			       uint8_t *data_write, uint32_t data_write_len,
+			       uint8_t *data_read, uint32_t data_read_len,
+			       uint32_t slave_addr)
+{
+	return mock_i2c_start(data_write);
+}
+
+/* End of the current transfer interrupt */
+static void mock_i2c_complete(void)
+{
+	mock_i2c_cfg.cb_tx(mock_i2c_cfg.cb_tx_data);
+}
+
+static int done_nb;
+
+static void done(sba_request_t *req)
+{
+	done_nb++;
+}
+
+static void request_init(sba_request_t *req, uint8_t *buf)
+{
+	memset(req, 0, sizeof(*req));
+	req->request_type = SBA_TX;
+	req->bus_id = SBA_I2C_MASTER_0;
+	req->tx_buff = buf;
+	req->tx_len = 1;
+	req->callback = done;
+}
+
+void sba_resume_test(void)
+{
+	extern struct driver serial_bus_access_driver;
+	static struct sba_master_cfg_data sba_dev = {
+		.bus_id = SBA_I2C_MASTER_0,
+	};
+	static struct td_device bus = {
+		.id = 0x70,
+		.driver = &serial_bus_access_driver,
+		.priv = &sba_dev,
+	};
+	struct td_device *devices[] = { &bus };
+	uint8_t buf[3];
+	sba_request_t req[3];
+	DRIVER_API_RC rc;
+	int ret;
+
+	init_devices(devices, 1);
+	CU_ASSERT("bus not lazy", bus.pm_flags & DEVICE_PM_LAZY_RESUME);
+
+	/* Running bus: a request waits for the current one */
+	request_init(&req[0], &buf[0]);
+	request_init(&req[1], &buf[1]);
+	rc = sba_exec_request(&req[0]);
+	rc |= sba_exec_request(&req[1]);
+	CU_ASSERT("request failed", rc == DRV_RC_OK);
+	mock_i2c_complete();
+	mock_i2c_complete();
+	CU_ASSERT("requests not run in order",
+		  mock_i2c_nb == 2 && mock_i2c_started[0] == &buf[0] &&
+		  mock_i2c_started[1] == &buf[1] && done_nb == 2);
+	CU_ASSERT("bus clock left on", !mock_i2c_clock);
+
+	/* Suspended bus, a request issued while the first one resumes it */
+	ret = suspend_device_array(devices, 1, PM_SUSPENDED);
+	CU_ASSERT("suspend failed", !ret && bus.powerstate == PM_SUSPENDED);
+	mock_i2c_nb = done_nb = 0;
+	request_init(&req[0], &buf[0]);
+	request_init(&req[2], &buf[2]);
+	mock_i2c_nested = &req[2];
+	mock_i2c_nested_rc = DRV_RC_FAIL;
+	rc = sba_exec_request(&req[0]);
+	CU_ASSERT("request failed", rc == DRV_RC_OK);
+	CU_ASSERT("request rejected during the resume",
+		  mock_i2c_nested_rc == DRV_RC_OK);
+	CU_ASSERT("bus not resumed",
+		  bus.powerstate == PM_RUNNING &&
+		  !(bus.pm_flags & DEVICE_PM_RESUMING));
+	CU_ASSERT("request started during the resume",
+		  mock_i2c_nb == 1 && mock_i2c_started[0] == &buf[0]);
+	mock_i2c_complete();
+	CU_ASSERT("queued request not started",
+		  mock_i2c_nb == 2 && mock_i2c_started[1] == &buf[2]);
+	mock_i2c_complete();
+	CU_ASSERT("requests not completed",
+		  done_nb == 2 && sba_dev.current_request == NULL);
+	CU_ASSERT("bus clock left on", !mock_i2c_clock);
+	CU_ASSERT("bus wakelock left held", pm_wakelock_is_list_empty());
+}
+
+int main(void)
+{
+	CU_RUN_TEST(device_pm_test);
+	CU_RUN_TEST(sba_resume_test);
+	cu_print_report_final();
+	return 0;
+}
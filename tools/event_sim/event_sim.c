@@ -0,0 +1,483 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Host simulator of the system events storage.
+ *
+ * The same stream of events goes to the former circular storage, one
+ * element pushed per event, and to the event journal staged in RAM, flushed
+ * after an idle delay or on shutdown and mounted again on each boot. Both
+ * run on a model of the SPI NOR flash of the system events partition, which
+ * counts the page programs, sector erases and reads. A readout of the unread
+ * events is then timed for both, the circular storage popping one event at
+ * a time and the journal read with its iterator.
+ *
+ * Times are estimated from the flash counters with the timing options,
+ * they are not measured on target.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "cir_storage.h"
+#include "cir_storage_backend.h"
+#include "util/event_journal.h"
+
+#define SECTOR_SIZE     4096    /* SERIAL_FLASH_BLOCK_SIZE */
+#define NB_SECTORS      3       /* SPI_SYSTEM_EVENT_NB_BLOCKS */
+#define PAGE_SIZE       256
+#define EVENT_SIZE      32      /* SYSTEM_EVENT_SIZE */
+#define CMD_BYTES       4       /* opcode and address of each access */
+#define MAX_EVENTS      100000
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
+/* Event types, see infra/system_events.h */
+enum {
+	EVT_BOOT = 1, EVT_PANIC, EVT_SHUTDOWN, EVT_UPTIME, EVT_BATTERY,
+	EVT_BLE_PAIRING, EVT_BLE_CONN, EVT_WORN, EVT_NFC
+};
+
+struct sim_event {
+	uint32_t t_ms;
+	uint16_t type;
+};
+
+struct flash_stats {
+	uint32_t reads;
+	uint32_t read_bytes;
+	uint32_t programs;      /* page program operations */
+	uint32_t program_bytes;
+	uint32_t erases;
+};
+
+static uint8_t flash[NB_SECTORS * SECTOR_SIZE];
+static struct flash_stats cnt;
+static uint32_t violations;     /* programs setting bits, out of bounds */
+
+static double spi_mhz = 8;
+static double program_ms = 0.5;
+static double erase_ms = 40;
+
+static unsigned seed = 1;
+
+static double rnd(void)
+{
+	seed = seed * 1103515245 + 12345;
+	return ((seed >> 8) & 0xFFFFFF) / (double)0x1000000;
+}
+
+static int flash_read(uint32_t addr, uint8_t *buf, uint32_t len)
+{
+	if (addr + len > sizeof(flash)) {
+		violations++;
+		return -1;
+	}
+	memcpy(buf, &flash[addr], len);
+	cnt.reads++;
+	cnt.read_bytes += len;
+	return 0;
+}
+
+/* Program, split in page programs as the SPI flash driver does */
+static int flash_write(uint32_t addr, const uint8_t *buf, uint32_t len)
+{
+	uint32_t i;
+
+	if (addr + len > sizeof(flash)) {
+		violations++;
+		return -1;
+	}
+	for (i = 0; i < len; i++) {
+		if (!i || !((addr + i) % PAGE_SIZE))
+			cnt.programs++;
+		if (buf[i] & ~flash[addr + i])
+			violations++;
+		flash[addr + i] &= buf[i];
+	}
+	cnt.program_bytes += len;
+	return 0;
+}
+
+static int flash_erase(uint32_t sector)
+{
+	if (sector >= NB_SECTORS) {
+		violations++;
+		return -1;
+	}
+	memset(&flash[sector * SECTOR_SIZE], 0xff, SECTOR_SIZE);
+	cnt.erases++;
+	return 0;
+}
+
+static void flash_reset(void)
+{
+	memset(flash, 0xff, sizeof(flash));
+	memset(&cnt, 0, sizeof(cnt));
+}
+
+static struct flash_stats stats_since(const struct flash_stats *start)
+{
+	struct flash_stats s = {
+		.reads = cnt.reads - start->reads,
+		.read_bytes = cnt.read_bytes - start->read_bytes,
+		.programs = cnt.programs - start->programs,
+		.program_bytes = cnt.program_bytes - start->program_bytes,
+		.erases = cnt.erases - start->erases,
+	};
+
+	return s;
+}
+
+/* Estimated time the flash is busy */
+static double flash_ms(const struct flash_stats *s)
+{
+	double bytes = s->read_bytes + s->program_bytes +
+		       (double)(s->reads + s->programs + s->erases) * CMD_BYTES;
+
+	return bytes * 8 / (spi_mhz * 1000) + s->programs * program_ms +
+	       s->erases * erase_ms;
+}
+
+/* Former storage: circular storage package on the flash model */
+static int32_t cs_read(cir_storage_flash_t *s, uint32_t addr, uint32_t len,
+		       uint8_t *buf)
+{
+	return flash_read(addr, buf, len);
+}
+
+static int32_t cs_write(cir_storage_flash_t *s, uint32_t addr, uint32_t len,
+			uint8_t *buf)
+{
+	return flash_write(addr, buf, len);
+}
+
+static int32_t cs_erase(cir_storage_flash_t *s, uint32_t first, uint32_t count)
+{
+	while (count--)
+		if (flash_erase(first++))
+			return -1;
+	return 0;
+}
+
+static void cs_lock(cir_storage_flash_t *s)
+{
+}
+
+static cir_storage_flash_t cs = {
+	.parent = {
+		.buffer_size = NB_SECTORS * SECTOR_SIZE,
+		.elt_size = EVENT_SIZE,
+	},
+	.block_first = 0,
+	.block_last = NB_SECTORS - 1,
+	.block_size = SECTOR_SIZE,
+	.read = cs_read,
+	.write = cs_write,
+	.erase = cs_erase,
+	.lock = cs_lock,
+	.unlock = cs_lock,
+};
+
+/* New storage: event journal on the flash model */
+static int ej_read(void *priv, uint32_t offset, uint8_t *buf, uint32_t len)
+{
+	return flash_read(offset, buf, len);
+}
+
+static int ej_write(void *priv, uint32_t offset, const uint8_t *buf,
+		    uint32_t len)
+{
+	if (offset / PAGE_SIZE != (offset + len - 1) / PAGE_SIZE)
+		violations++;
+	return flash_write(offset, buf, len);
+}
+
+static int ej_erase(void *priv, uint32_t sector)
+{
+	return flash_erase(sector);
+}
+
+static const struct event_journal_ops ej_ops = {
+	.read = ej_read,
+	.write = ej_write,
+	.erase = ej_erase,
+};
+
+static struct event_journal journal;
+static struct event_journal_iter iter;
+
+static struct sim_event events[MAX_EVENTS];
+
+static void make_record(uint8_t *rec, uint32_t n)
+{
+	memset(rec, 0, EVENT_SIZE);
+	memcpy(rec, &events[n].type, sizeof(events[n].type));
+	memcpy(rec + 4, &events[n].t_ms, sizeof(events[n].t_ms));
+	memcpy(rec + 8, &n, sizeof(n));
+}
+
+static uint32_t add(uint32_t n, uint32_t t_ms, uint16_t type)
+{
+	if (n < MAX_EVENTS) {
+		events[n].t_ms = t_ms;
+		events[n].type = type;
+	}
+	return n + 1;
+}
+
+/*
+ * Generate a day of a wearable: battery level every 5 min, worn changes,
+ * BLE connections with reconnection bursts, NFC readers, and reboots with
+ * their shutdown event and boot burst.
+ */
+static uint32_t generate(uint32_t count)
+{
+	uint32_t battery = 300000, ble = 0, worn = 600000, nfc = 3600000;
+	uint32_t reboot = 0, t = 0, n = 0, k;
+
+	while (n < count) {
+		t = MIN(MIN(battery, ble), MIN(MIN(worn, nfc), reboot));
+		if (t == reboot) {
+			if (t)
+				n = add(n, t, EVT_SHUTDOWN);
+			t += 3000;
+			n = add(n, t, EVT_BOOT);
+			if (rnd() < 0.1)
+				n = add(n, t + 5, EVT_PANIC);
+			n = add(n, t + 10, EVT_BATTERY);
+			n = add(n, t + 20, EVT_BATTERY);
+			n = add(n, t + 500, EVT_BLE_PAIRING);
+			n = add(n, t + 800, EVT_WORN);
+			reboot = t + 4 * 3600000 + rnd() * 8 * 3600000;
+		} else if (t == battery) {
+			n = add(n, t, EVT_BATTERY);
+			battery = t + 300000;
+		} else if (t == ble) {
+			/* Connection, then reconnections at a few 100 ms */
+			n = add(n, t, EVT_BLE_CONN);
+			for (k = rnd() * 4; k; k--) {
+				t += 200 + rnd() * 600;
+				n = add(n, t, EVT_BLE_CONN);
+				n = add(n, t + 50, EVT_BLE_CONN);
+			}
+			if (rnd() < 0.3)
+				n = add(n, t + 100, EVT_UPTIME);
+			ble = t + 5 * 60000 + rnd() * 30 * 60000;
+		} else if (t == worn) {
+			n = add(n, t, EVT_WORN);
+			worn = t + 20 * 60000 + rnd() * 2 * 3600000;
+		} else {
+			n = add(n, t, EVT_NFC);
+			n = add(n, t + 2000 + rnd() * 5000, EVT_NFC);
+			nfc = t + 3600000 + rnd() * 6 * 3600000;
+		}
+	}
+	return MIN(n, MAX_EVENTS);
+}
+
+static void store_cir_storage(uint32_t count)
+{
+	uint8_t rec[EVENT_SIZE];
+	uint32_t i;
+
+	flash_reset();
+	cir_storage_flash_init(&cs);
+	for (i = 0; i < count; i++) {
+		make_record(rec, i);
+		cir_storage_push(&cs.parent, rec);
+	}
+}
+
+/* Push the events as system_events.c does, flush_ms 0 flushing each one */
+static void store_journal(uint32_t count, uint32_t flush_ms)
+{
+	uint8_t rec[EVENT_SIZE];
+	uint32_t i, armed_ms = 0;
+	bool armed = false;
+
+	flash_reset();
+	event_journal_init(&journal, &ej_ops, SECTOR_SIZE, NB_SECTORS,
+			   EVENT_SIZE);
+	for (i = 0; i < count; i++) {
+		if (armed && events[i].t_ms >= armed_ms + flush_ms) {
+			/* Idle timer expired before this event */
+			event_journal_flush(&journal);
+			armed = false;
+		}
+		if (i && events[i].type == EVT_BOOT)
+			/* Mount again after a reboot */
+			event_journal_init(&journal, &ej_ops, SECTOR_SIZE,
+					   NB_SECTORS, EVENT_SIZE);
+		make_record(rec, i);
+		event_journal_append(&journal, rec);
+		if (!flush_ms || events[i].type == EVT_SHUTDOWN) {
+			event_journal_flush(&journal);
+			armed = false;
+		} else if (!armed && event_journal_pending(&journal)) {
+			armed = true;
+			armed_ms = events[i].t_ms;
+		}
+	}
+	event_journal_flush(&journal);
+}
+
+static void print_store(const char *name, uint32_t count)
+{
+	printf("  %-30s %7.1f %7.1f %9.0f %9.1f\n", name,
+	       cnt.programs * 1000.0 / count, cnt.erases * 1000.0 / count,
+	       cnt.program_bytes * 1000.0 / count,
+	       flash_ms(&cnt) * 1000 / count);
+}
+
+static bool check_record(const uint8_t *p, uint32_t n)
+{
+	uint8_t rec[EVENT_SIZE];
+
+	make_record(rec, n);
+	return !memcmp(p, rec, EVENT_SIZE);
+}
+
+static void print_readout(const char *name, uint32_t n, uint32_t allocs,
+			  const struct flash_stats *s, bool ok)
+{
+	double ms = flash_ms(s);
+
+	printf("  %-30s %5u %6u %6u %6u %8.1f %8.0f%s\n", name, n, s->reads,
+	       s->programs, allocs, ms, ms > 0 ? n * 1000 / ms : 0,
+	       ok ? "" : "  MISMATCH");
+}
+
+/* Read back the first count events, stored as in the event stream */
+static void readout(uint32_t count, uint32_t flush_ms)
+{
+	struct flash_stats start;
+	uint8_t rec[EVENT_SIZE];
+	const uint8_t *p;
+	uint32_t n, seq;
+	bool ok = true;
+
+	printf("\nReadout of %u unread events\n"
+	       "  %-30s %5s %6s %6s %6s %8s %8s\n", count, "", "events",
+	       "reads", "progs", "allocs", "ms", "evt/s");
+
+	store_cir_storage(count);
+	start = cnt;
+	for (n = 0; cir_storage_pop(&cs.parent, rec) == CBUFFER_STORAGE_SUCCESS;
+	     n++)
+		ok &= check_record(rec, n);
+	start = stats_since(&start);
+	print_readout("circular storage, pop", n, n, &start, ok && n == count);
+
+	store_journal(count, flush_ms);
+	start = cnt;
+	event_journal_iter_init(&journal, &iter);
+	for (n = 0; (p = event_journal_iter_next(&iter, &seq)); n++)
+		ok &= seq == n && check_record(p, n);
+	event_journal_consume(&journal, iter.next_seq);
+	event_journal_flush(&journal);
+	start = stats_since(&start);
+	print_readout("journal, iterator", n, 1, &start, ok && n == count);
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr,
+		"usage: %s [-n events] [-d flush_ms] [-r readout] [-s seed]\n"
+		"          [-f spi_mhz] [-p program_ms] [-e erase_ms]\n"
+		"Defaults: 1000 events, 2000 ms flush delay, readout of 200\n"
+		"events, %.0f MHz SPI, %.1f ms page program, %.0f ms sector\n"
+		"erase, %d command bytes per access.\n",
+		name, spi_mhz, program_ms, erase_ms, CMD_BYTES);
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t count = 1000, flush_ms = 2000, nb_readout = 200;
+	char name[32];
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:d:r:s:f:p:e:h")) != -1) {
+		switch (opt) {
+		case 'n':
+			count = atoi(optarg);
+			break;
+		case 'd':
+			flush_ms = atoi(optarg);
+			break;
+		case 'r':
+			nb_readout = atoi(optarg);
+			break;
+		case 's':
+			seed = atoi(optarg);
+			break;
+		case 'f':
+			spi_mhz = atof(optarg);
+			break;
+		case 'p':
+			program_ms = atof(optarg);
+			break;
+		case 'e':
+			erase_ms = atof(optarg);
+			break;
+		default:
+			usage(argv[0]);
+			return opt != 'h';
+		}
+	}
+	if (!count || count > MAX_EVENTS || spi_mhz <= 0) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	count = generate(count);
+	printf("%u events over %.1f h\n  %-30s %7s %7s %9s %9s\n", count,
+	       events[count - 1].t_ms / 3600000.0, "per 1000 events", "progs",
+	       "erases", "bytes", "busy ms");
+
+	store_cir_storage(count);
+	print_store("circular storage", count);
+	store_journal(count, 0);
+	print_store("journal, flush each event", count);
+	store_journal(count, flush_ms);
+	snprintf(name, sizeof(name), "journal, flush after %u ms", flush_ms);
+	print_store(name, count);
+
+	if (nb_readout > count)
+		nb_readout = count;
+	if (nb_readout)
+		readout(nb_readout, flush_ms);
+
+	if (violations)
+		printf("%u flash misuses\n", violations);
+	return violations != 0;
+}
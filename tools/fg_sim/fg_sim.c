@@ -0,0 +1,668 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Host simulator of the fuel gauge.
+ *
+ * A battery with its own R0 + RC circuit, capacity and temperature goes
+ * through load profiles, built in or loaded from a CSV file. Its voltage,
+ * with the ADC noise, feeds both estimations of the fuel gauge service: the
+ * lookup table read of the averaged voltage, and the load compensated model
+ * fed with the hints of the radio and the haptics. Both report the level
+ * the way the service does, only downwards while discharging and upwards
+ * while charging, and the reported levels are compared with the true state
+ * of charge.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+
+#include "fg_lut.h"
+#include "fg_model.h"
+
+#define STEP_MS         100
+#define ERR_PERIOD_MS   10000   /* error and trace period */
+#define MAX_HOURS       96
+#define LOW_LEVEL       20      /* default low level alarm */
+#define SOC_INIT        0xFF
+
+/* Service constants, see adc_fuel_gauge_api.c */
+#define FILTER_COUNT    3
+#define FILTER_DIFF_MAX 10
+#define FILTER_ERR_MAX  2
+
+/* Model configuration, the Kconfig defaults for this battery */
+static const struct fg_model_params model_params = {
+	.capacity_mas = 45 * 3600,
+	.r0_mohm = 800,
+	.r1_mohm = 400,
+	.tau_s = 60,
+	.base_ua = 1000
+};
+#define HAPTIC_HINT_UA  80000
+#define RADIO_EVENT_NC  15000
+
+/* The true battery is off the model on purpose */
+#define TRUE_CAPACITY_MAH       43.0
+#define TRUE_R0                 0.95
+#define TRUE_R1                 0.45
+#define TRUE_TAU_S              80.0
+#define TRUE_RADIO_EVENT_NC     18000.0
+#define TRUE_HAPTIC_UA          90000
+#define CHARGE_CC_UA            45000
+#define CHARGE_EOC_UA           4500
+#define CHARGE_TAPER            0.9     /* constant voltage from 90 % */
+#define CHARGE_TABLE_UA         1200    /* system load of the charge table */
+#define ADC_NOISE_MV            3.0
+
+enum charger_state { DISCHARGE, CHARGE, COMPLETE };
+
+/* Load of the system at a time */
+struct load {
+	uint32_t current_ua;    /* drawn by the system */
+	uint32_t hint_ua[BATTERY_LOAD_COUNT];
+	int16_t temperature;
+	bool charger;           /* plugged */
+};
+
+struct profile {
+	const char *name;
+	void (*load)(uint32_t t_ms, struct load *l);
+	double soc;             /* at start */
+	uint32_t hours;         /* 0 until empty or charged */
+};
+
+struct battery {
+	double soc;             /* 0..1 */
+	double vrc;             /* V */
+	double current;         /* A, < 0 when charging */
+	enum charger_state state;
+};
+
+/* Estimation of a method, as the service would report it */
+struct method {
+	const char *name;
+	uint32_t interval_ms;
+	uint32_t next_ms;
+	uint8_t reported;
+	uint32_t samples;
+	double err_sum;
+	uint32_t err_count;
+	double err_max;
+	double low_ms;          /* first time reported at the low level */
+	/* lookup table method: the service voltage filter */
+	enum charger_state filter_state;
+	uint8_t filter_count;
+	uint8_t filter_errors;
+	uint16_t filter[FILTER_COUNT];
+	/* model method */
+	struct fg_model model;
+	uint32_t hint_ua[BATTERY_LOAD_COUNT];
+	int16_t temperature;
+};
+
+static unsigned seed = 1;
+
+static double rnd(void)
+{
+	seed = seed * 1103515245 + 12345;
+	return ((seed >> 8) & 0xFFFFFF) / (double)0x1000000;
+}
+
+static double gauss(double sigma)
+{
+	double u = rnd() + 1e-9, v = rnd();
+
+	return sigma * sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+/* Stateless pseudo random value of a slot of a profile */
+static uint32_t slot_hash(uint32_t slot, uint32_t salt)
+{
+	uint32_t h = (slot + 1) * 2654435761u ^ salt * 40503u;
+
+	h ^= h >> 15;
+	h *= 2246822519u;
+	h ^= h >> 13;
+	return h;
+}
+
+/* Lookup table of the charger state and temperature, as battery_property */
+static const uint16_t *table_of(enum charger_state state, int16_t temp)
+{
+	if (state == CHARGE)
+		return dflt_lookup_tables[0];
+	if (temp < BP_TH_DISCHARGE_0)
+		return dflt_lookup_tables[1];
+	if (temp < BP_TH_DISCHARGE_12)
+		return dflt_lookup_tables[2];
+	return dflt_lookup_tables[3];
+}
+
+/* Voltage of a state of charge in a table */
+static double table_voltage(const uint16_t *t, double soc)
+{
+	uint32_t ppm = soc < 0 ? 0 : soc > 1 ? 1000000 : soc * 1000000;
+	uint16_t lo = t[0], hi = t[BATTPROP_LOOKUP_TABLE_SIZE - 1];
+	uint32_t a, b;
+
+	while (hi - lo > 1) {
+		uint16_t mid = (lo + hi) / 2;
+		if (fg_lut_get_soc_ppm(t, mid, NULL) <= ppm)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	a = fg_lut_get_soc_ppm(t, lo, NULL);
+	b = fg_lut_get_soc_ppm(t, hi, NULL);
+	if (b <= a)
+		return lo / 1000.0;
+	return (lo + (double)(ppm - a) / (b - a)) / 1000.0;
+}
+
+/*
+ * Built in profiles. The radio and the haptics draw more than hinted, and
+ * some loads are not hinted at all.
+ */
+static uint32_t radio_ua(uint32_t period_us, double *true_ua)
+{
+	*true_ua += TRUE_RADIO_EVENT_NC * 1000 / period_us;
+	return RADIO_EVENT_NC * 1000 / period_us;
+}
+
+static void base_load(uint32_t t_ms, struct load *l, double *ua)
+{
+	uint32_t slot = t_ms / 300000;
+	uint32_t at = t_ms % 300000;
+
+	*ua = 1200;
+	/* Flash writes, not hinted: 6 mA for 2 s every 5 minutes */
+	if (at >= slot_hash(slot, 1) % 298000 &&
+	    at < slot_hash(slot, 1) % 298000 + 2000)
+		*ua += 6000;
+	l->temperature = 25;
+	l->charger = false;
+	memset(l->hint_ua, 0, sizeof(l->hint_ua));
+}
+
+/* Haptic burst of 0.5 to 2.5 s in a slot, with a probability in % */
+static void haptic_load(uint32_t t_ms, uint32_t slot_ms, uint32_t prob,
+			struct load *l, double *ua)
+{
+	uint32_t slot = t_ms / slot_ms;
+	uint32_t h = slot_hash(slot, 2);
+	uint32_t len = 500 + (h >> 8) % 2000;
+	uint32_t start = (h >> 4) % (slot_ms - len);
+	uint32_t at = t_ms % slot_ms;
+
+	if (h % 100 < prob && at >= start && at < start + len) {
+		*ua += TRUE_HAPTIC_UA;
+		l->hint_ua[BATTERY_LOAD_HAPTIC] = HAPTIC_HINT_UA;
+	}
+}
+
+static void profile_idle(uint32_t t_ms, struct load *l)
+{
+	double ua;
+
+	base_load(t_ms, l, &ua);
+	/* Slow advertising, 1 s */
+	l->hint_ua[BATTERY_LOAD_RADIO] = radio_ua(1000000, &ua);
+	l->current_ua = ua;
+}
+
+static void profile_wear(uint32_t t_ms, struct load *l)
+{
+	double ua;
+
+	base_load(t_ms, l, &ua);
+	/* Connected at 50 ms, notifications every 10 minutes or so */
+	l->hint_ua[BATTERY_LOAD_RADIO] = radio_ua(50000, &ua);
+	haptic_load(t_ms, 600000, 50, l, &ua);
+	l->current_ua = ua;
+}
+
+static void profile_heavy(uint32_t t_ms, struct load *l)
+{
+	double ua;
+
+	base_load(t_ms, l, &ua);
+	/* Streaming at 15 ms, a notification every minute */
+	l->hint_ua[BATTERY_LOAD_RADIO] = radio_ua(15000, &ua);
+	haptic_load(t_ms, 60000, 100, l, &ua);
+	l->current_ua = ua;
+}
+
+static void profile_cold(uint32_t t_ms, struct load *l)
+{
+	profile_wear(t_ms, l);
+	l->temperature = 5;
+}
+
+static void profile_charge(uint32_t t_ms, struct load *l)
+{
+	profile_wear(t_ms, l);
+	l->charger = true;
+}
+
+static const struct profile profiles[] = {
+	{ "idle", profile_idle, 1.0, 0 },
+	{ "wear", profile_wear, 1.0, 0 },
+	{ "heavy", profile_heavy, 1.0, 0 },
+	{ "cold", profile_cold, 1.0, 0 },
+	{ "charge", profile_charge, 0.05, 0 },
+};
+
+/* Load profile of a CSV file */
+struct csv_row {
+	uint32_t t_ms;
+	struct load load;
+};
+
+static struct csv_row *csv_rows;
+static uint32_t csv_count;
+
+static void profile_csv(uint32_t t_ms, struct load *l)
+{
+	uint32_t lo = 0, hi = csv_count;
+
+	/* Last row at or before t */
+	while (hi - lo > 1) {
+		uint32_t mid = (lo + hi) / 2;
+		if (csv_rows[mid].t_ms <= t_ms)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	*l = csv_rows[lo].load;
+}
+
+static int load_csv(const char *path, struct profile *p)
+{
+	FILE *f = fopen(path, "r");
+	char line[256];
+	uint32_t size = 0;
+
+	if (!f) {
+		perror(path);
+		return -1;
+	}
+	p->name = path;
+	p->load = profile_csv;
+	p->soc = 1.0;
+	p->hours = 0;
+	while (fgets(line, sizeof(line), f)) {
+		double t, ma, radio, haptic, soc;
+		int temp, charger;
+		struct csv_row *r;
+
+		if (sscanf(line, "# soc %lf", &soc) == 1)
+			p->soc = soc / 100;
+		if (line[0] == '#' || sscanf(line, "%lf,%lf,%lf,%lf,%d,%d", &t,
+					     &ma, &radio, &haptic, &temp,
+					     &charger) != 6)
+			continue;
+		if (csv_count == size) {
+			size = size ? size * 2 : 256;
+			csv_rows = realloc(csv_rows, size * sizeof(*csv_rows));
+			if (!csv_rows)
+				exit(1);
+		}
+		r = &csv_rows[csv_count++];
+		memset(r, 0, sizeof(*r));
+		r->t_ms = t * 1000;
+		r->load.current_ua = ma * 1000;
+		r->load.hint_ua[BATTERY_LOAD_RADIO] = radio * 1000;
+		r->load.hint_ua[BATTERY_LOAD_HAPTIC] = haptic * 1000;
+		r->load.temperature = temp;
+		r->load.charger = charger;
+	}
+	fclose(f);
+	if (!csv_count) {
+		fprintf(stderr, "%s: no load\n", path);
+		return -1;
+	}
+	p->hours = (csv_rows[csv_count - 1].t_ms + 3599999) / 3600000;
+	return 0;
+}
+
+/*
+ * True battery, resistances rising and capacity shrinking in the cold.
+ *
+ * Its open circuit voltage is the discharge table. While charging, its
+ * voltage is the charge table with the system load of the table: both
+ * estimations trust the charge table, only the loads change the voltage.
+ */
+static double battery_step(struct battery *b, const struct load *l)
+{
+	double cold = l->temperature < 25 ? 25 - l->temperature : 0;
+	double r0 = TRUE_R0 * (1 + 0.045 * cold);
+	double r1 = TRUE_R1 * (1 + 0.045 * cold);
+	double capacity = TRUE_CAPACITY_MAH * 3.6 * (1 - 0.007 * cold);
+	double current = l->current_ua / 1e6;
+	double dt = STEP_MS / 1000.0;
+	double v;
+
+	if (!l->charger) {
+		b->state = DISCHARGE;
+	} else if (b->state != COMPLETE) {
+		/* Constant current, then tapering to end of charge */
+		double charge = CHARGE_CC_UA / 1e6;
+
+		if (b->soc > CHARGE_TAPER)
+			charge *= (1 - b->soc) / (1 - CHARGE_TAPER);
+		b->state = charge < CHARGE_EOC_UA / 1e6 ? COMPLETE : CHARGE;
+		current -= charge;
+	}
+	/* The charger powers the system once complete */
+	if (b->state == COMPLETE)
+		current = 0;
+
+	if (b->state == CHARGE)
+		v = table_voltage(table_of(CHARGE, l->temperature), b->soc) -
+		    (l->current_ua - CHARGE_TABLE_UA) / 1e6 * r0;
+	else
+		v = table_voltage(table_of(DISCHARGE, l->temperature),
+				  b->soc) - current * r0 - b->vrc;
+
+	b->current = current;
+	b->soc -= current * dt / capacity;
+	if (b->soc > 1)
+		b->soc = 1;
+	b->vrc += (current * r1 - b->vrc) * dt / (TRUE_TAU_S + dt);
+	return v;
+}
+
+static void report(struct method *m, uint8_t soc, bool charging)
+{
+	if (m->reported == SOC_INIT || (charging && soc > m->reported) ||
+	    (!charging && soc < m->reported))
+		m->reported = soc;
+}
+
+/* Voltage filter of the service, fg_adc_filter() */
+static uint16_t lut_filter(struct method *m, enum charger_state state,
+			   uint16_t mv)
+{
+	uint16_t last = m->filter[FILTER_COUNT - 1];
+	uint16_t margin = FILTER_DIFF_MAX + (m->interval_ms >> 14);
+	bool ok = false;
+	uint32_t sum = 0;
+	int i;
+
+	if (state != m->filter_state) {
+		m->filter_state = state;
+		m->filter_count = 0;
+		m->filter_errors = 0;
+	}
+	if (m->filter_count < FILTER_COUNT) {
+		m->filter[m->filter_count++] = mv;
+	} else {
+		if (state == CHARGE)
+			ok = mv >= last && mv - last < margin;
+		else if (state == DISCHARGE)
+			ok = mv <= last && last - mv < margin;
+		else
+			ok = mv < last + FILTER_DIFF_MAX &&
+			     mv + FILTER_DIFF_MAX > last;
+		m->filter_errors = ok ? 0 : m->filter_errors + 1;
+		if (m->filter_errors >= FILTER_ERR_MAX) {
+			ok = true;
+			m->filter_errors = 0;
+		}
+		if (ok) {
+			memmove(m->filter, m->filter + 1,
+				(FILTER_COUNT - 1) * sizeof(m->filter[0]));
+			m->filter[FILTER_COUNT - 1] = mv;
+		}
+	}
+	for (i = 0; i < m->filter_count; i++)
+		sum += m->filter[i];
+	return sum / m->filter_count;
+}
+
+static void lut_measure(struct method *m, enum charger_state state,
+			int16_t temp, uint16_t mv)
+{
+	uint16_t filtered = lut_filter(m, state, mv);
+
+	report(m, fg_lut_get_soc(table_of(state, temp), filtered),
+	       state == CHARGE);
+}
+
+static void model_hints(struct method *m, const struct load *l, uint32_t t)
+{
+	int i;
+
+	for (i = 0; i < BATTERY_LOAD_COUNT; i++) {
+		if (l->hint_ua[i] != m->hint_ua[i]) {
+			m->hint_ua[i] = l->hint_ua[i];
+			fg_model_set_load(&m->model, i, l->hint_ua[i], t);
+		}
+	}
+	if (l->temperature != m->temperature) {
+		m->temperature = l->temperature;
+		fg_model_set_temperature(&m->model, l->temperature, t);
+	}
+}
+
+static void model_measure(struct method *m, enum charger_state state,
+			  int16_t temp, uint16_t mv, uint32_t t)
+{
+	fg_model_update(&m->model, table_of(state, temp), mv, state == CHARGE,
+			t);
+	report(m, fg_model_get_soc(&m->model), state == CHARGE);
+}
+
+static void method_init(struct method *m, const char *name,
+			uint32_t interval_ms)
+{
+	memset(m, 0, sizeof(*m));
+	m->name = name;
+	m->interval_ms = interval_ms;
+	/* First measure 3 s after boot */
+	m->next_ms = 3000;
+	m->reported = SOC_INIT;
+	m->low_ms = -1;
+	m->temperature = 25;
+	fg_model_init(&m->model, &model_params, 0);
+}
+
+static void method_error(struct method *m, double soc, bool discharging,
+			 uint32_t t)
+{
+	double err;
+
+	if (m->reported == SOC_INIT)
+		return;
+	err = fabs(m->reported - soc * 100);
+	m->err_sum += err;
+	m->err_count++;
+	if (err > m->err_max)
+		m->err_max = err;
+	if (discharging && m->low_ms < 0 && m->reported <= LOW_LEVEL)
+		m->low_ms = t;
+}
+
+static void run(const struct profile *p, uint32_t lut_ms, uint32_t model_ms,
+		FILE *trace)
+{
+	struct battery b = { p->soc, 0, 0, DISCHARGE };
+	struct method lut, model;
+	struct load l;
+	uint32_t end = (p->hours ? p->hours : MAX_HOURS) * 3600000;
+	uint32_t t;
+	double true_low = -1;
+	uint32_t complete = 0;
+	uint16_t mv = 0;
+
+	method_init(&lut, "lut", lut_ms);
+	method_init(&model, "model", model_ms);
+
+	if (trace)
+		fprintf(trace, "# %s\n# time_s,true_soc,lut_soc,model_soc,"
+			"voltage_mv,current_ua\n", p->name);
+
+	for (t = 0; t < end; t += STEP_MS) {
+		double v;
+
+		p->load(t, &l);
+		v = battery_step(&b, &l);
+		model_hints(&model, &l, t);
+
+		if (t >= lut.next_ms || t >= model.next_ms)
+			mv = lround(v * 1000 + gauss(ADC_NOISE_MV));
+		if (t >= lut.next_ms) {
+			lut_measure(&lut, b.state, l.temperature, mv);
+			lut.samples++;
+			lut.next_ms += lut.interval_ms;
+		}
+		if (t >= model.next_ms) {
+			model_measure(&model, b.state, l.temperature, mv, t);
+			model.samples++;
+			model.next_ms += model.interval_ms;
+		}
+
+		if (t % ERR_PERIOD_MS)
+			continue;
+		method_error(&lut, b.soc, b.state == DISCHARGE, t);
+		method_error(&model, b.soc, b.state == DISCHARGE, t);
+		if (b.state == DISCHARGE && true_low < 0 &&
+		    b.soc * 100 <= LOW_LEVEL)
+			true_low = t;
+		if (trace)
+			fprintf(trace, "%u,%.2f,%u,%u,%u,%.0f\n", t / 1000,
+				b.soc * 100, lut.reported, model.reported,
+				(unsigned)(v * 1000), b.current * 1e6);
+		/* Built in profiles end when empty, or charged for 30 min */
+		if (!p->hours && b.soc <= 0)
+			break;
+		if (b.state == COMPLETE && !complete)
+			complete = t;
+		if (!p->hours && complete && t > complete + 1800000)
+			break;
+	}
+
+	printf("%-10s %6.1f h  true end %5.1f %%\n", p->name, t / 3600000.0,
+	       b.soc * 100);
+	for (struct method *m = &lut; m; m = m == &lut ? &model : NULL) {
+		printf("  %-6s every %2u s  %6u samples  error mean %5.2f %%"
+		       "  max %5.1f %%", m->name, m->interval_ms / 1000,
+		       m->samples, m->err_count ? m->err_sum / m->err_count : 0,
+		       m->err_max);
+		if (true_low >= 0 && m->low_ms >= 0)
+			printf("  low level %+6.1f min",
+			       (m->low_ms - true_low) / 60000);
+		printf("\n");
+	}
+}
+
+static void usage(const char *name)
+{
+	unsigned i;
+
+	fprintf(stderr,
+		"usage: %s [-i lut_ms] [-m model_ms] [-s seed] [-o trace.csv]\n"
+		"          [-l load.csv] [profile...]\n"
+		"Built in profiles:", name);
+	for (i = 0; i < sizeof(profiles) / sizeof(profiles[0]); i++)
+		fprintf(stderr, " %s", profiles[i].name);
+	fprintf(stderr,
+		"\nLoad file rows: time_s,current_ma,radio_hint_ma,"
+		"haptic_hint_ma,temp_c,charger\n"
+		"each row holding until the next one, and an optional\n"
+		"'# soc N' line for the state of charge at start, in %%.\n"
+		"The low level column is the delay of the %d %% alarm.\n",
+		LOW_LEVEL);
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t lut_ms = 30000, model_ms = 60000;
+	const char *csv = NULL;
+	FILE *trace = NULL;
+	unsigned i;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "i:m:s:o:l:h")) != -1) {
+		switch (opt) {
+		case 'i':
+			lut_ms = atoi(optarg);
+			break;
+		case 'm':
+			model_ms = atoi(optarg);
+			break;
+		case 's':
+			seed = atoi(optarg);
+			break;
+		case 'o':
+			trace = fopen(optarg, "w");
+			if (!trace) {
+				perror(optarg);
+				return 1;
+			}
+			break;
+		case 'l':
+			csv = optarg;
+			break;
+		default:
+			usage(argv[0]);
+			return opt != 'h';
+		}
+	}
+	if (!lut_ms || !model_ms) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	if (csv) {
+		struct profile p;
+
+		if (load_csv(csv, &p))
+			return 1;
+		run(&p, lut_ms, model_ms, trace);
+	}
+	for (i = 0; i < sizeof(profiles) / sizeof(profiles[0]); i++) {
+		int j, selected = optind == argc && !csv;
+
+		for (j = optind; j < argc; j++)
+			if (!strcmp(argv[j], profiles[i].name))
+				selected = 1;
+		if (selected)
+			run(&profiles[i], lut_ms, model_ms, trace);
+	}
+
+	if (trace)
+		fclose(trace);
+	return 0;
+}
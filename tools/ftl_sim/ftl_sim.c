@@ -0,0 +1,523 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Host simulation of the FAT flash translation layer (bsp/src/drivers/fs).
+ *
+ * The SPI flash is a RAM array: programming only clears bits, erasing sets a
+ * 4 kB sector to 0xff. A model of FatFs writes files through the FTL the way
+ * f_write() and f_sync() do: data sectors, the FAT sector of each allocated
+ * cluster and the directory sector, through a one sector window, on a volume
+ * whose data area is aligned on the FTL block when it is a power of 2, like
+ * f_mkfs() does with GET_BLOCK_SIZE. For each workload, the simulation
+ * counts the sectors erased and the bytes programmed per MB written by the
+ * application.
+ *
+ * With -p, the workloads are cut by power losses at random points of the
+ * flash operations, a program being cut after a part of its bytes and an
+ * erase leaving half of the sector erased. After each cut, the volume is
+ * mounted again and each sector must hold the data of its last f_sync() or
+ * data written after it.
+ */
+
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "drivers/spi_flash.h"
+#include "machine.h"
+#include "util/misc.h"
+#include "fat_ftl.h"
+
+#define FLASH_SIZE (CONFIG_FAT_FS_FTL_NB_BLOCKS * FTL_ERASE_SIZE)
+/* FatFs cluster of 4 kB */
+#define CLUSTER_SECTORS 8
+#define ROOT_DIR_SECTORS 32
+#define MB (1024 * 1024)
+
+struct sba_device {
+	int unused;
+};
+
+struct sba_device pf_sba_device_flash_spi0;
+
+static uint8_t flash[FLASH_SIZE];
+
+static struct {
+	unsigned long long erases;
+	unsigned long long programmed;
+	unsigned long long read;
+	/* Programs of a 0 bit to 1, lost on a real flash */
+	unsigned long long overwrites;
+} flash_stats;
+
+/* Flash operation units before the power cut: one per byte programmed,
+ * FTL_ERASE_SIZE per erase */
+static long long cut_budget = -1;
+static jmp_buf power_cut;
+
+static void spend(long long units)
+{
+	if (cut_budget >= 0)
+		cut_budget = cut_budget > units ? cut_budget - units : 0;
+}
+
+DRIVER_API_RC spi_flash_read_byte(struct td_device *dev, uint32_t address,
+				  unsigned int len, unsigned int *retlen,
+				  uint8_t *data)
+{
+	if (address + len > FLASH_SIZE)
+		return DRV_RC_INVALID_OPERATION;
+	memcpy(data, &flash[address], len);
+	flash_stats.read += len;
+	*retlen = len;
+	return DRV_RC_OK;
+}
+
+DRIVER_API_RC spi_flash_write_byte(struct td_device *dev, uint32_t address,
+				   unsigned int len, unsigned int *retlen,
+				   uint8_t *data)
+{
+	unsigned int n = len;
+	unsigned int i;
+
+	if (address + len > FLASH_SIZE)
+		return DRV_RC_INVALID_OPERATION;
+	if (cut_budget >= 0 && cut_budget < len)
+		n = cut_budget;
+	for (i = 0; i < n; i++) {
+		if (~flash[address + i] & data[i])
+			flash_stats.overwrites++;
+		flash[address + i] &= data[i];
+	}
+	flash_stats.programmed += n;
+	spend(len);
+	if (n < len)
+		longjmp(power_cut, 1);
+	*retlen = len;
+	return DRV_RC_OK;
+}
+
+DRIVER_API_RC spi_flash_sector_erase(struct td_device *dev,
+				     uint32_t start_block, uint32_t nb_blocks)
+{
+	uint32_t addr = start_block * FTL_ERASE_SIZE;
+	uint32_t size = nb_blocks * FTL_ERASE_SIZE;
+
+	if (addr + size > FLASH_SIZE)
+		return DRV_RC_INVALID_OPERATION;
+	if (cut_budget >= 0 && cut_budget < size) {
+		/* Half erased, either end first */
+		memset(&flash[addr + (rand() & 1) * size / 2], 0xff, size / 2);
+		cut_budget = 0;
+		longjmp(power_cut, 1);
+	}
+	memset(&flash[addr], 0xff, size);
+	flash_stats.erases += nb_blocks;
+	spend(size);
+	return DRV_RC_OK;
+}
+
+DRIVER_API_RC spi_flash_ioctl(struct td_device *dev, uint32_t *result,
+			      uint8_t ioctl)
+{
+	if (ioctl != STORAGE_SECTOR_SIZE)
+		return DRV_RC_INVALID_OPERATION;
+	*result = FTL_ERASE_SIZE;
+	return DRV_RC_OK;
+}
+
+/*
+ * Sector contents: the sector number, and a version taken from a counter
+ * incremented at each sector write. Version 0 is an erased sector.
+ */
+static uint32_t nb_sectors;
+static uint32_t version_counter;
+static uint32_t *written;       /* Last version written */
+static uint32_t *synced;        /* Version at the last sync */
+static int failures;
+
+static void fill_sector(uint8_t *buf, uint32_t sector, uint32_t version)
+{
+	uint32_t i;
+
+	memcpy(buf, &sector, 4);
+	memcpy(buf + 4, &version, 4);
+	for (i = 8; i < FTL_SECTOR_SIZE; i++)
+		buf[i] = (uint8_t)(sector * 31 + version * 7 + i);
+}
+
+/* Version held by a sector buffer, -1 if corrupted */
+static int64_t sector_version(const uint8_t *buf, uint32_t sector)
+{
+	uint8_t ref[FTL_SECTOR_SIZE];
+	uint32_t version;
+	uint32_t i;
+
+	for (i = 0; i < FTL_SECTOR_SIZE && buf[i] == 0xff; i++)
+		;
+	if (i == FTL_SECTOR_SIZE)
+		return 0;
+	memcpy(&version, buf + 4, 4);
+	fill_sector(ref, sector, version);
+	return memcmp(buf, ref, FTL_SECTOR_SIZE) ? -1 : version;
+}
+
+static void write_sector(uint32_t sector)
+{
+	uint8_t buf[FTL_SECTOR_SIZE];
+
+	written[sector] = ++version_counter;
+	fill_sector(buf, sector, written[sector]);
+	if (fat_ftl_write(buf, sector, 1) != DRV_RC_OK) {
+		printf("  write of sector %u failed\n", sector);
+		failures++;
+	}
+}
+
+static void sync_disk(void)
+{
+	if (fat_ftl_sync() != DRV_RC_OK) {
+		printf("  sync failed\n");
+		failures++;
+	}
+	memcpy(synced, written, nb_sectors * sizeof(*synced));
+}
+
+/* Check the volume after a power cut, and take its content as written and
+ * synced: the writes lost by the cut are not written again */
+static void check_volume(void)
+{
+	uint8_t buf[FTL_SECTOR_SIZE];
+	int64_t version;
+	uint32_t s;
+
+	if (fat_ftl_init() != DRV_RC_OK) {
+		printf("  mount failed\n");
+		failures++;
+		return;
+	}
+	for (s = 0; s < nb_sectors; s++) {
+		if (fat_ftl_read(buf, s, 1) != DRV_RC_OK)
+			version = -1;
+		else
+			version = sector_version(buf, s);
+		if (version < synced[s] || version > written[s]) {
+			if (failures++ < 10)
+				printf("  sector %u: version %lld, synced %u "
+				       "written %u\n", s, (long long)version,
+				       synced[s], written[s]);
+			continue;
+		}
+		written[s] = synced[s] = version;
+	}
+}
+
+/*
+ * Model of a FatFs volume with one file: the FAT and directory sectors go
+ * through the window of the file system, the data sectors through the
+ * sector buffer of the file.
+ */
+static struct {
+	uint32_t fat_start;
+	uint32_t dir_start;
+	uint32_t data_start;
+	uint32_t nb_clusters;
+	uint32_t max_size;      /* The file is truncated at this size */
+	int64_t win;            /* Sector in the window */
+	bool win_dirty;
+	uint32_t size;          /* Size of the file */
+	uint32_t clusters;      /* Clusters of the file */
+	bool buf_dirty;         /* Last data sector partially written */
+} vol;
+
+static void mkfs(void)
+{
+	uint32_t align = FTL_SECTORS_PER_BLOCK;
+	uint32_t fat_sectors;
+
+	/* Not a power of 2: reported as unknown (1) */
+	if (align & (align - 1))
+		align = 1;
+	/* FAT12, 1.5 byte per cluster */
+	fat_sectors = (nb_sectors / CLUSTER_SECTORS * 3 / 2 +
+		       FTL_SECTOR_SIZE - 1) / FTL_SECTOR_SIZE;
+	vol.fat_start = 1;
+	vol.dir_start = vol.fat_start + fat_sectors;
+	vol.data_start = vol.dir_start + ROOT_DIR_SECTORS;
+	vol.data_start = (vol.data_start + align - 1) / align * align;
+	vol.nb_clusters = (nb_sectors - vol.data_start) / CLUSTER_SECTORS;
+	/* Leave room for the clusters freed while the file is truncated */
+	vol.max_size = MIN(MB, vol.nb_clusters / 2 * CLUSTER_SECTORS *
+			   FTL_SECTOR_SIZE);
+	vol.win = -1;
+	vol.win_dirty = false;
+	vol.size = 0;
+	vol.clusters = 0;
+	vol.buf_dirty = false;
+}
+
+static void move_window(uint32_t sector)
+{
+	if (vol.win == sector)
+		return;
+	if (vol.win_dirty)
+		write_sector(vol.win);
+	vol.win = sector;
+	vol.win_dirty = false;
+}
+
+static void update_fat(uint32_t cluster)
+{
+	move_window(vol.fat_start + (cluster + 2) * 3 / 2 / FTL_SECTOR_SIZE);
+	vol.win_dirty = true;
+}
+
+static uint32_t data_sector(uint32_t offset)
+{
+	return vol.data_start + offset / FTL_SECTOR_SIZE;
+}
+
+static void file_sync(void)
+{
+	if (vol.buf_dirty) {
+		write_sector(data_sector(vol.size));
+		vol.buf_dirty = false;
+	}
+	/* Size and time of the directory entry */
+	move_window(vol.dir_start);
+	vol.win_dirty = true;
+	move_window(vol.dir_start);
+	write_sector(vol.win);
+	vol.win_dirty = false;
+	sync_disk();
+}
+
+static void file_truncate(void)
+{
+	uint32_t c;
+
+	for (c = 0; c < vol.clusters; c++)
+		update_fat(c);
+	vol.size = 0;
+	vol.clusters = 0;
+	vol.buf_dirty = false;
+	file_sync();
+}
+
+static void file_write(uint32_t len)
+{
+	uint32_t n;
+
+	while (len) {
+		if (vol.size == vol.max_size)
+			file_truncate();
+		if (vol.size == vol.clusters * CLUSTER_SECTORS *
+		    FTL_SECTOR_SIZE)
+			update_fat(vol.clusters++);
+		n = MIN(len, FTL_SECTOR_SIZE - vol.size % FTL_SECTOR_SIZE);
+		vol.size += n;
+		len -= n;
+		vol.buf_dirty = true;
+		if (vol.size % FTL_SECTOR_SIZE == 0) {
+			write_sector(data_sector(vol.size - 1));
+			vol.buf_dirty = false;
+		}
+	}
+}
+
+/* Sector overwrite in the file, written directly by f_write() */
+static void file_rewrite(uint32_t offset)
+{
+	write_sector(data_sector(offset));
+}
+
+enum workload {
+	STREAM,         /* 512 B writes, f_sync() every 4 kB */
+	LOGGER,         /* 64 B records, f_sync() after each one */
+	REWRITE,        /* 512 B overwrites in a 256 kB file, f_sync() every 8 */
+	NB_WORKLOADS
+};
+
+static const char *const workload_names[] = { "stream", "logger", "rewrite" };
+
+#define REWRITE_FILE_SIZE (256 * 1024)
+
+static void workload_setup(enum workload w)
+{
+	if (w != REWRITE)
+		return;
+	while (vol.size < REWRITE_FILE_SIZE)
+		file_write(FTL_SECTOR_SIZE);
+	file_sync();
+}
+
+/* One step of a workload, returns the bytes written by the application */
+static uint32_t workload_step(enum workload w, uint32_t step)
+{
+	switch (w) {
+	case STREAM:
+		file_write(FTL_SECTOR_SIZE);
+		if (vol.size % (CLUSTER_SECTORS * FTL_SECTOR_SIZE) == 0)
+			file_sync();
+		return FTL_SECTOR_SIZE;
+	case LOGGER:
+		file_write(64);
+		file_sync();
+		return 64;
+	default:
+		file_rewrite(rand() % REWRITE_FILE_SIZE);
+		if (step % 8 == 7)
+			file_sync();
+		return FTL_SECTOR_SIZE;
+	}
+}
+
+static void format(void)
+{
+	memset(flash, 0xff, sizeof(flash));
+	memset(written, 0, nb_sectors * sizeof(*written));
+	memset(synced, 0, nb_sectors * sizeof(*synced));
+	if (fat_ftl_init() != DRV_RC_OK) {
+		printf("mount of an erased volume failed\n");
+		exit(1);
+	}
+	mkfs();
+}
+
+static void run_wear(enum workload w, uint32_t mbytes)
+{
+	unsigned long long app = 0;
+	double n;
+	uint32_t step;
+
+	format();
+	workload_setup(w);
+	memset(&flash_stats, 0, sizeof(flash_stats));
+	for (step = 0; app < (unsigned long long)mbytes * MB; step++)
+		app += workload_step(w, step);
+	file_sync();
+
+	n = (double)app / MB;
+	printf("  %-8s %10.1f %14.1f %14.2f %10llu\n", workload_names[w],
+	       flash_stats.erases / n, flash_stats.programmed / n / 1024,
+	       (double)flash_stats.programmed / app, flash_stats.overwrites);
+}
+
+static void run_cuts(enum workload w, uint32_t nb_cuts, long long max_units)
+{
+	uint32_t cut;
+	uint32_t step = 0;
+
+	format();
+	workload_setup(w);
+	for (cut = 0; cut < nb_cuts; cut++) {
+		cut_budget = 1 + rand() % max_units;
+		if (!setjmp(power_cut)) {
+			for (;; step++)
+				workload_step(w, step);
+		}
+		cut_budget = -1;
+		/* FatFs mounts again and forgets its buffers */
+		vol.win = -1;
+		vol.win_dirty = false;
+		vol.buf_dirty = false;
+		check_volume();
+	}
+	printf("  %-8s %u power cuts, %d errors, %llu bit overwrites\n",
+	       workload_names[w], nb_cuts, failures, flash_stats.overwrites);
+}
+
+static void usage(const char *name)
+{
+	printf("usage: %s [-w stream|logger|rewrite] [-m MB] [-p cuts] "
+	       "[-s seed]\n"
+	       "  -m MB     application data written by each workload (16)\n"
+	       "  -p cuts   power cuts per workload instead of the wear report\n",
+	       name);
+}
+
+int main(int argc, char **argv)
+{
+	int w_first = 0, w_last = NB_WORKLOADS - 1;
+	uint32_t mbytes = 16;
+	uint32_t nb_cuts = 0;
+	unsigned int seed = 1;
+	int opt;
+	int w;
+
+	while ((opt = getopt(argc, argv, "w:m:p:s:h")) != -1) {
+		switch (opt) {
+		case 'w':
+			for (w = 0; w < NB_WORKLOADS; w++)
+				if (!strcmp(optarg, workload_names[w]))
+					w_first = w_last = w;
+			break;
+		case 'm':
+			mbytes = atoi(optarg);
+			break;
+		case 'p':
+			nb_cuts = atoi(optarg);
+			break;
+		case 's':
+			seed = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+			return opt != 'h';
+		}
+	}
+	srand(seed);
+
+	nb_sectors = fat_ftl_sector_count();
+	written = calloc(nb_sectors, sizeof(*written));
+	synced = calloc(nb_sectors, sizeof(*synced));
+	if (!written || !synced)
+		return 1;
+
+	format();
+	printf("FTL blocks of %d sectors, %u sectors (%u kB) on %u kB of "
+	       "flash, data area at sector %u\n", FTL_SECTORS_PER_BLOCK,
+	       nb_sectors, nb_sectors / 2, FLASH_SIZE / 1024, vol.data_start);
+
+	if (nb_cuts) {
+		for (w = w_first; w <= w_last; w++)
+			run_cuts(w, nb_cuts, 2 * MB);
+		return failures != 0;
+	}
+
+	printf("  %-8s %10s %14s %14s %10s\n", "workload", "erases/MB",
+	       "programmed/MB", "write ampl.", "overwrites");
+	for (w = w_first; w <= w_last; w++)
+		run_wear(w, mbytes);
+	return failures != 0;
+}
@@ -0,0 +1,383 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Host simulator of the Quark deep sleep governor.
+ *
+ * Idle traces, built in or loaded from a CSV file, are replayed through the
+ * governor of bsp/src/machine/soc/intel/quark_se/quark/idle_gov.c and
+ * through the fixed threshold policy it replaced, the way
+ * _tickless_idle_hook() drives them: an idle period starts with the time to
+ * the next kernel timer, and ends at that timer or earlier on an interrupt.
+ * A policy sleeps deeply until its programmed AONPT expiry or the interrupt,
+ * then pays the true resume latency; a shallow idle period ends on the timer,
+ * the interrupt or the promotion timer, after which the idle hook runs again.
+ *
+ * The energy is an estimate from the power figures below, not a target
+ * measurement: only the idle time is accounted, the active time between two
+ * idle periods costs the same under both policies.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "idle_gov.h"
+
+/* Model assumptions, in uW */
+#define SHALLOW_UW      2000    /* core halted, clocks running */
+#define DEEP_UW         30      /* deep sleep */
+#define ACTIVE_UW       6000    /* deep sleep entry and resume */
+#define ENTRY_US        300     /* deep sleep entry duration */
+
+#define MS_32K(ms)      ((uint32_t)((uint64_t)(ms) * 32768 / 1000))
+#define US_32K(us)      ((uint32_t)((uint64_t)(us) * 32768 / 1000000))
+
+/* An idle period: time to the next kernel timer, and to an interrupt */
+struct idle_rec {
+	uint32_t timeout;
+	uint32_t irq;           /* 0: none before the timer */
+};
+
+struct trace {
+	const char *name;
+	void (*gen)(struct idle_rec *r, uint32_t i);
+};
+
+struct result {
+	double energy_uj;
+	double idle_s;
+	double deep_s;
+	uint32_t deep;          /* deep sleeps */
+	uint32_t late_timers;   /* timers served after their expiry */
+	double timer_delay_ms;
+	uint32_t late_irqs;     /* interrupts served during a resume */
+	double irq_delay_ms;
+};
+
+static unsigned seed = 1;
+static uint32_t latency_us = 1500;
+static uint32_t jitter_us = 200;
+
+static double rnd(void)
+{
+	seed = seed * 1103515245 + 12345;
+	return ((seed >> 8) & 0xFFFFFF) / (double)0x1000000;
+}
+
+static uint32_t rnd_ms(double lo, double hi)
+{
+	return MS_32K(lo + (hi - lo) * rnd());
+}
+
+/* 50 Hz sensor polling on a kernel timer, nothing else */
+static void gen_sensor(struct idle_rec *r, uint32_t i)
+{
+	r->timeout = MS_32K(20);
+	r->irq = 0;
+}
+
+/* BLE connection events every 30 ms from the ARC, 1 s kernel timer */
+static void gen_ble(struct idle_rec *r, uint32_t i)
+{
+	r->timeout = MS_32K(1000 - (i % 33) * 30);
+	r->irq = rnd_ms(29, 31);
+	if (r->irq >= r->timeout)
+		r->irq = 0;
+}
+
+/* Bursts of 20 transfers 1 to 3 ms apart, every 200 to 500 ms */
+static void gen_burst(struct idle_rec *r, uint32_t i)
+{
+	r->timeout = MS_32K(1000);
+	r->irq = i % 20 ? rnd_ms(1, 3) : rnd_ms(200, 500);
+}
+
+/* Random timers, half of the idle periods ended by an interrupt */
+static void gen_mixed(struct idle_rec *r, uint32_t i)
+{
+	r->timeout = rnd_ms(5, 200);
+	r->irq = rnd() < 0.5 ?
+		 MS_32K(1) + (r->timeout - MS_32K(1)) * rnd() : 0;
+}
+
+static const struct trace traces[] = {
+	{ "sensor", gen_sensor },
+	{ "ble", gen_ble },
+	{ "burst", gen_burst },
+	{ "mixed", gen_mixed },
+};
+
+static double uj(uint32_t uw, uint32_t ticks)
+{
+	return (double)uw * ticks / 32768;
+}
+
+static uint32_t true_latency(void)
+{
+	return US_32K(latency_us - jitter_us + 2 * jitter_us * rnd());
+}
+
+/*
+ * Replay an idle period. With gov NULL, the fixed threshold policy: deep
+ * sleep when the timeout minus a 3 ms wakeup delay estimate is at least
+ * 10 ms.
+ */
+static void replay(const struct idle_rec *rec, struct idle_gov *gov,
+		   struct result *res)
+{
+	uint32_t t = 0, end = rec->irq ? rec->irq : rec->timeout;
+
+	while (t < end) {
+		uint32_t rem = rec->timeout - t;
+		uint32_t latency, wake, resume, lat, promote = 0;
+		bool deep, measured = false;
+
+		/* The kernel passes whole ms */
+		if (rem * 1000 / 32768 < DEEP_SLEEP_MIN_DURATION) {
+			if (gov)
+				gov->reject[IDLE_REJECT_TIMER]++;
+			deep = false;
+		} else if (gov) {
+			deep = idle_gov_select(gov, rem);
+			promote = gov->promote;
+			measured = true;
+		} else {
+			deep = rem - ESTIMATED_WAKEUP_DELAY_32K >=
+			       DEEP_SLEEP_MIN_DURATION_32K;
+		}
+
+		if (!deep) {
+			uint32_t stop = end;
+
+			if (promote && t + promote < end)
+				stop = t + promote;
+			res->energy_uj += uj(SHALLOW_UW, stop - t);
+			if (measured)
+				idle_gov_idle_done(gov, false, stop - t);
+			t = stop;
+			continue;
+		}
+
+		latency = gov ? idle_gov_wakeup_margin(gov) :
+			  ESTIMATED_WAKEUP_DELAY_32K;
+		wake = t + rem - latency;
+		if (rec->irq && rec->irq < wake)
+			wake = rec->irq;
+		lat = true_latency();
+		resume = wake + lat;
+		res->deep++;
+		res->deep_s += (wake - t) / 32768.0;
+		res->energy_uj += uj(ACTIVE_UW, US_32K(ENTRY_US)) +
+				  uj(DEEP_UW, wake - t) + uj(ACTIVE_UW, lat);
+		if (gov) {
+			idle_gov_resumed(gov, (int32_t)(resume -
+							(t + rem - latency)));
+			idle_gov_idle_done(gov, true, resume - t);
+		}
+		if (rec->irq && rec->irq <= resume) {
+			res->late_irqs++;
+			res->irq_delay_ms += (resume - rec->irq) * 1000.0 /
+					     32768;
+		} else if (!rec->irq && resume > rec->timeout) {
+			res->late_timers++;
+			res->timer_delay_ms += (resume - rec->timeout) *
+					       1000.0 / 32768;
+		}
+		t = resume;
+	}
+	res->idle_s += end / 32768.0;
+}
+
+static void print_result(const char *name, const struct result *res)
+{
+	printf("  %-8s %7.1f uW  %6u deep  %5.1f %% deep  "
+	       "%5u late timers %7.2f ms  %5u late irqs %7.2f ms\n",
+	       name, res->energy_uj / res->idle_s, res->deep,
+	       100 * res->deep_s / res->idle_s, res->late_timers,
+	       res->late_timers ? res->timer_delay_ms / res->late_timers : 0,
+	       res->late_irqs,
+	       res->late_irqs ? res->irq_delay_ms / res->late_irqs : 0);
+}
+
+static void run(const char *name, const struct idle_rec *recs, uint32_t nb)
+{
+	struct idle_gov gov = IDLE_GOV_INIT;
+	struct result fixed, adaptive;
+	unsigned saved = seed;
+	uint32_t i;
+
+	/* Both policies see the same resume latencies */
+	memset(&fixed, 0, sizeof(fixed));
+	for (i = 0; i < nb; i++)
+		replay(&recs[i], NULL, &fixed);
+	seed = saved;
+	memset(&adaptive, 0, sizeof(adaptive));
+	for (i = 0; i < nb; i++)
+		replay(&recs[i], &gov, &adaptive);
+
+	printf("%-10s %u idle periods, %.1f s idle\n", name, nb,
+	       fixed.idle_s);
+	print_result("fixed", &fixed);
+	print_result("governor", &adaptive);
+	printf("  governor %+.1f %% energy, latency %.2f ms, margin %.2f ms, "
+	       "break-even %.2f ms, predict rejects %u\n",
+	       100 * (adaptive.energy_uj / fixed.energy_uj - 1),
+	       idle_gov_latency(&gov) * 1000.0 / 32768,
+	       idle_gov_wakeup_margin(&gov) * 1000.0 / 32768,
+	       idle_gov_break_even(&gov) * 1000.0 / 32768,
+	       (unsigned)gov.reject[IDLE_REJECT_PREDICT]);
+}
+
+static struct idle_rec *load_csv(const char *path, uint32_t *nb)
+{
+	FILE *f = fopen(path, "r");
+	struct idle_rec *recs = NULL;
+	uint32_t size = 0;
+	char line[256];
+
+	*nb = 0;
+	if (!f) {
+		perror(path);
+		return NULL;
+	}
+	while (fgets(line, sizeof(line), f)) {
+		double timeout, irq;
+
+		if (line[0] == '#' ||
+		    sscanf(line, "%lf,%lf", &timeout, &irq) != 2 ||
+		    timeout <= 0)
+			continue;
+		if (*nb == size) {
+			size = size ? size * 2 : 256;
+			recs = realloc(recs, size * sizeof(*recs));
+			if (!recs)
+				exit(1);
+		}
+		recs[*nb].timeout = MS_32K(timeout);
+		recs[*nb].irq = irq > 0 && irq < timeout ? MS_32K(irq) : 0;
+		if (recs[*nb].timeout)
+			(*nb)++;
+	}
+	fclose(f);
+	if (!*nb) {
+		fprintf(stderr, "%s: no idle period\n", path);
+		free(recs);
+		return NULL;
+	}
+	return recs;
+}
+
+static void usage(const char *name)
+{
+	unsigned i;
+
+	fprintf(stderr,
+		"usage: %s [-l latency_us] [-j jitter_us] [-n periods] "
+		"[-s seed]\n"
+		"          [-t trace.csv] [trace...]\n"
+		"Built in traces:", name);
+	for (i = 0; i < sizeof(traces) / sizeof(traces[0]); i++)
+		fprintf(stderr, " %s", traces[i].name);
+	fprintf(stderr,
+		"\nTrace file rows: timeout_ms,irq_ms, the time to the next "
+		"kernel timer\nand to the interrupt that ended the idle "
+		"period, 0 if the timer did.\n"
+		"-l and -j set the true resume latency, uniform in "
+		"latency +- jitter.\n"
+		"Power figures are model assumptions: shallow %u uW, deep "
+		"%u uW,\nentry (%u us) and resume %u uW.\n",
+		SHALLOW_UW, DEEP_UW, ENTRY_US, ACTIVE_UW);
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t nb = 10000, i;
+	const char *csv = NULL;
+	struct idle_rec *recs;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "l:j:n:s:t:h")) != -1) {
+		switch (opt) {
+		case 'l':
+			latency_us = atoi(optarg);
+			break;
+		case 'j':
+			jitter_us = atoi(optarg);
+			break;
+		case 'n':
+			nb = atoi(optarg);
+			break;
+		case 's':
+			seed = atoi(optarg);
+			break;
+		case 't':
+			csv = optarg;
+			break;
+		default:
+			usage(argv[0]);
+			return opt != 'h';
+		}
+	}
+	if (!nb || jitter_us > latency_us) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	printf("resume latency %u +- %u us\n", latency_us, jitter_us);
+	if (csv) {
+		uint32_t n;
+
+		recs = load_csv(csv, &n);
+		if (!recs)
+			return 1;
+		run(csv, recs, n);
+		free(recs);
+	}
+	recs = malloc(nb * sizeof(*recs));
+	if (!recs)
+		return 1;
+	for (i = 0; i < sizeof(traces) / sizeof(traces[0]); i++) {
+		int j, selected = optind == argc && !csv;
+		uint32_t k;
+
+		for (j = optind; j < argc; j++)
+			if (!strcmp(argv[j], traces[i].name))
+				selected = 1;
+		if (!selected)
+			continue;
+		for (k = 0; k < nb; k++)
+			traces[i].gen(&recs[k], k);
+		run(traces[i].name, recs, nb);
+	}
+	free(recs);
+	return 0;
+}
@@ -0,0 +1,426 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Host simulation of the LP5562 LED driver.
+ *
+ * The pattern handler (bsp/src/drivers/led/lp5562_led.c) and the low-level
+ * driver (lp5562.c) run in virtual time, in microseconds, over a model of
+ * the chip behind a mock sba_exec_dev_request(), which counts the I2C
+ * transactions. The model stores the engines program memory, and when the
+ * engines are started it computes when they end with
+ * lp5562_program_run_time(), scaled by the oscillator deviation. All the
+ * engines end together: the ENABLE register then reads them on hold, the
+ * STATUS register reads them ended once, and the program counters read 0.
+ * A program which never ends keeps the engines running. Transfers complete
+ * at once. Each scenario plays a pattern and reports the I2C transactions
+ * of the configuration and after it, the status checks, and when the end
+ * notification is sent compared to the end of the engines.
+ *
+ * lp5562_pattern_test (bsp/unit_test/.../lp5562_pattern_tst.c) runs first,
+ * and led_end_test checks that every pattern played once is notified, after
+ * the end of the engines.
+ */
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "os/os.h"
+#include "infra/log.h"
+#include "machine.h"
+#include "drivers/lp5562.h"
+#include "drivers/led/led.h"
+#include "drivers/led/lp5562_pattern.h"
+#include "util/cunit_test.h"
+
+#define REG_ENABLE  0x00
+#define REG_OP_MODE 0x01
+#define REG_PC1     0x09
+#define REG_PC3     0x0B
+#define REG_STATUS  0x0C
+#define REG_PRG_EN1 0x10
+#define REG_PRG_END 0x70
+
+/* Engines execution bits of the ENABLE register */
+#define ENABLE_EXEC_MASK 0x3F
+
+/* Time simulated after the configuration of a pattern */
+#define HORIZON_US 10000000ULL
+
+static int clock_dev_pct;  /* Oscillator deviation, positive when slow */
+
+static uint64_t now;
+
+/* LP5562 model */
+static struct {
+	uint8_t enable;
+	uint8_t prg[REG_PRG_END - REG_PRG_EN1];
+	bool running;
+	bool ended;             /* STATUS not read since the end */
+	uint64_t end;           /* 0: never ends */
+} chip;
+
+static uint32_t i2c_nb;
+static uint32_t status_nb;
+
+/* Time the engines take to run the loaded programs, 0 if they never end */
+static uint64_t chip_run_us(void)
+{
+	struct lp5562_program prog;
+	uint32_t ticks;
+	int i, j;
+
+	memset(&prog, 0, sizeof(prog));
+	/* The program memory holds the instructions most significant byte
+	 * first */
+	for (i = 0; i < LP5562_NB_ENGINES; i++)
+		for (j = 0; j < LP5562_NB_INSTRUCTIONS; j++)
+			prog.eng[i][j] = chip.prg[i * 32 + 2 * j] << 8 |
+					 chip.prg[i * 32 + 2 * j + 1];
+	ticks = lp5562_program_run_time(&prog);
+	if (!ticks)
+		return 0;
+	return (uint64_t)ticks * 1000000 * (100 + clock_dev_pct) /
+	       (100 * LP5562_CLOCK);
+}
+
+static void chip_update(void)
+{
+	if (chip.running && chip.end && now >= chip.end) {
+		chip.running = false;
+		chip.ended = true;
+		chip.enable &= ~ENABLE_EXEC_MASK;
+	}
+}
+
+static void chip_write(const uint8_t *buf, uint32_t len)
+{
+	uint8_t reg = buf[0];
+	uint32_t i;
+
+	chip_update();
+	if (reg >= REG_PRG_EN1 && reg + len - 1 <= REG_PRG_END) {
+		for (i = 1; i < len; i++)
+			chip.prg[reg - REG_PRG_EN1 + i - 1] = buf[i];
+		return;
+	}
+	if (reg != REG_ENABLE)
+		return;
+	chip.enable = buf[1];
+	chip.running = (buf[1] & ENABLE_EXEC_MASK) != 0;
+	chip.ended = false;
+	if (chip.running) {
+		uint64_t run = chip_run_us();
+
+		chip.end = run ? now + run : 0;
+	}
+}
+
+static uint8_t chip_read(uint8_t reg)
+{
+	uint8_t val;
+
+	chip_update();
+	switch (reg) {
+	case REG_ENABLE:
+		status_nb++;
+		return chip.enable;
+	case REG_STATUS:
+		/* Reading the status resets the bits */
+		val = chip.ended ? 0x07 : 0;
+		chip.ended = false;
+		return val;
+	case REG_PC1 ... REG_PC3:
+		return chip.running ? 1 : 0;
+	default:
+		return 0;
+	}
+}
+
+DRIVER_API_RC sba_exec_dev_request(struct sba_device *dev,
+				   struct sba_request *req)
+{
+	i2c_nb++;
+	if (req->request_type == SBA_TRANSFER)
+		req->rx_buff[0] = chip_read(req->tx_buff[0]);
+	else
+		chip_write(req->tx_buff, req->tx_len);
+	req->status = DRV_RC_OK;
+	req->callback(req);
+	return DRV_RC_OK;
+}
+
+static struct lp5562_info lp5562_info;
+
+struct sba_device pf_sba_device_led_lp5562 = {
+	.dev.id = 0,
+	.dev.driver = &led_lp5562_driver,
+	.dev.priv = &lp5562_info,
+	.addr.slave_addr = 0x30,
+};
+
+/* OS stubs, in virtual time */
+static struct {
+	T_ENTRY_POINT callback;
+	void *data;
+	bool active;
+	uint64_t expiry;
+} timer;
+
+T_TIMER timer_create(T_ENTRY_POINT callback, void *privData, uint32_t delay,
+		     bool repeat, bool startup, OS_ERR_TYPE *err)
+{
+	timer.callback = callback;
+	timer.data = privData;
+	return &timer;
+}
+
+void timer_start(T_TIMER tmr, uint32_t delay, OS_ERR_TYPE *err)
+{
+	timer.active = true;
+	timer.expiry = now + delay * 1000ULL;
+}
+
+void timer_stop(T_TIMER tmr)
+{
+	timer.active = false;
+}
+
+static uint32_t sem_count;
+
+T_SEMAPHORE semaphore_create(uint32_t initialCount)
+{
+	sem_count = initialCount;
+	return &sem_count;
+}
+
+void semaphore_give(T_SEMAPHORE semaphore, OS_ERR_TYPE *err)
+{
+	sem_count++;
+}
+
+OS_ERR_TYPE semaphore_take(T_SEMAPHORE semaphore, int timeout)
+{
+	if (!sem_count)
+		return E_OS_ERR_BUSY;
+	sem_count--;
+	return E_OS_OK;
+}
+
+void local_task_sleep_ms(int time)
+{
+	now += time * 1000ULL;
+}
+
+void pm_wakelock_init(struct pm_wakelock *wli)
+{
+}
+
+void log_printk(uint8_t level, const char *module, const char *format, ...)
+{
+	va_list args;
+
+	va_start(args, format);
+	vprintf(format, args);
+	va_end(args);
+	printf("\n");
+}
+
+void log_flush(void)
+{
+}
+
+/* Scenarios */
+static uint64_t notified;
+
+static void led_notify(uint8_t led, uint8_t state)
+{
+	if (!notified)
+		notified = now;
+}
+
+struct scenario {
+	const char *name;
+	enum led_type type;
+	uint8_t repetition;
+	uint16_t on, off;
+};
+
+static const struct scenario scenarios[] = {
+	{ "blink x1 5/5 ms once", LED_BLINK_X1, 0, 5, 5 },
+	{ "blink x1 100/100 ms once", LED_BLINK_X1, 0, 100, 100 },
+	{ "blink x1 100/100 ms x5", LED_BLINK_X1, 4, 100, 100 },
+	{ "blink x3 300/200 ms once", LED_BLINK_X3, 0, 300, 200 },
+	{ "wave x1 1000/500 ms once", LED_WAVE_X1, 0, 1000, 500 },
+	{ "wave x2 500/500 ms x3", LED_WAVE_X2, 2, 500, 500 },
+	{ "blink x1 100/100 ms continuous", LED_BLINK_X1,
+	  LED_REPETITION_CONTINUOUS, 100, 100 },
+	{ "blink x2 100/100 ms continuous", LED_BLINK_X2,
+	  LED_REPETITION_CONTINUOUS, 100, 100 },
+	{ "blink x3 100/100 ms continuous", LED_BLINK_X3,
+	  LED_REPETITION_CONTINUOUS, 100, 100 },
+	{ "wave x1 1000/500 ms continuous", LED_WAVE_X1,
+	  LED_REPETITION_CONTINUOUS, 1000, 500 },
+};
+
+struct result {
+	uint32_t config_i2c;
+	uint32_t i2c;
+	uint32_t status;
+	uint64_t notified;      /* 0: not notified */
+	uint64_t end;           /* Last end of the engines, 0: still running */
+};
+
+static void play(const struct scenario *s, struct result *r)
+{
+	led_s pattern;
+	uint64_t start;
+	int i;
+
+	memset(&pattern, 0, sizeof(pattern));
+	pattern.repetition_count = s->repetition;
+	for (i = 0; i < 3; i++) {
+		pattern.duration[i].duration_on = s->on;
+		pattern.duration[i].duration_off = s->off;
+		pattern.rgb[i].r = 255;
+		pattern.rgb[i].g = 40 * i;
+		pattern.rgb[i].b = 10;
+	}
+
+	i2c_nb = 0;
+	led_pattern_handler_config(s->type, &pattern, 0);
+	r->config_i2c = i2c_nb;
+	start = now;
+	i2c_nb = status_nb = 0;
+	notified = 0;
+	r->end = 0;
+	while (timer.active && timer.expiry <= start + HORIZON_US) {
+		now = timer.expiry;
+		timer.active = false;
+		chip_update();
+		if (!chip.running && chip.end)
+			r->end = chip.end - start;
+		timer.callback(timer.data);
+	}
+	now = start + HORIZON_US;
+	chip_update();
+	if (!chip.running && chip.end)
+		r->end = chip.end - start;
+	r->i2c = i2c_nb;
+	r->status = status_nb;
+	r->notified = notified ? notified - start : 0;
+	/* Continuous patterns are notified at once */
+	if (s->repetition == LED_REPETITION_CONTINUOUS)
+		r->notified = 0;
+
+	led_pattern_handler_config(LED_NONE, &pattern, 0);
+	now += 1000000;
+}
+
+void led_end_test(void)
+{
+	struct result r;
+	unsigned i;
+
+	led_set_pattern_callback(led_notify, 1, NULL);
+	for (i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+		if (scenarios[i].repetition == LED_REPETITION_CONTINUOUS)
+			continue;
+		play(&scenarios[i], &r);
+		CU_ASSERT("pattern not notified", r.notified);
+		CU_ASSERT("pattern notified before the end of the engines",
+			  r.end && r.notified >= r.end);
+	}
+}
+
+static void print_ms(uint64_t us)
+{
+	if (us)
+		printf(" %9.1f", us / 1000.0);
+	else
+		printf(" %9s", "-");
+}
+
+static void report(void)
+{
+	struct result r;
+	unsigned i;
+
+	printf("\nLP5562 model, oscillator %+d %%, %llu s after the "
+	       "configuration\n", clock_dev_pct, HORIZON_US / 1000000);
+	printf("%-32s %6s %6s %6s %9s %9s\n", "pattern", "config", "i2c",
+	       "checks", "end ms", "notif ms");
+	for (i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+		play(&scenarios[i], &r);
+		printf("%-32s %6u %6u %6u", scenarios[i].name, r.config_i2c,
+		       r.i2c, r.status);
+		print_ms(r.end);
+		print_ms(r.notified);
+		printf("\n");
+	}
+}
+
+static void usage(const char *name)
+{
+	printf("usage: %s [-c clock_deviation_pct] [-n]\n"
+	       "  -n  no unit tests, report only\n", name);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	bool tests = true;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "c:nh")) != -1) {
+		switch (opt) {
+		case 'c':
+			clock_dev_pct = atoi(optarg);
+			break;
+		case 'n':
+			tests = false;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	led_set_pattern_callback(led_notify, 1, NULL);
+	report();
+	if (tests) {
+		CU_RUN_TEST(lp5562_pattern_test);
+		CU_RUN_TEST(led_end_test);
+		cu_print_report_final();
+	}
+	return 0;
+}
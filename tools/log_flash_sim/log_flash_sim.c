@@ -0,0 +1,382 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Host simulation of the flash log backend.
+ *
+ * The SPI flash is a RAM array shared with the child processes: programming
+ * only clears bits, erasing sets a 4 kB sector to 0xff. Each boot of the
+ * logger runs in a child process, so that the backend starts from its
+ * initial state and mounts the log area again. The simulation counts the
+ * page programs and the sector erases for lines of 55 to 125 bytes, flushed
+ * after each line (idle logger), after bursts of 10 lines, or only when a
+ * page is full (continuous logging), and the bytes read to find the write
+ * head on boot.
+ *
+ * With -p, each boot is cut by a power loss at a random point of the flash
+ * operations, a program being cut after a part of its bytes and an erase
+ * leaving half of the sector erased. The log area is then decoded like
+ * tools/scripts/log/DecodeFlashLog.py does: the records must be numbered
+ * without gap, the lines must come in order, and each cut may leave at most
+ * one torn record.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "drivers/spi_flash.h"
+#include "machine/soc/intel/quark_se/soc_config.h"
+#include "machine/soc/intel/quark_se/quark/log_backend_flash.h"
+#include "project_mapping.h"
+
+#define SECTOR_SIZE SERIAL_FLASH_BLOCK_SIZE
+#define FLASH_SIZE (SPI_LOG_NB_BLOCKS * SECTOR_SIZE)
+#define PAGE_SIZE 256
+
+struct sba_device pf_sba_device_flash_spi0;
+
+/* Shared with the boots of the logger */
+static struct shared {
+	uint8_t flash[FLASH_SIZE];
+	uint32_t programs;      /* Pages programmed */
+	uint32_t erases;
+	uint32_t read_bytes;
+	uint32_t next_line;     /* Number of the next line to log */
+} *sh;
+
+/* Bytes programmed or erased before the power cut, -1 for none */
+static long cut_budget = -1;
+
+static void spend(long bytes)
+{
+	if (cut_budget < 0)
+		return;
+	if (cut_budget <= bytes)
+		_exit(0);
+	cut_budget -= bytes;
+}
+
+DRIVER_API_RC spi_flash_read_byte(struct td_device *dev, uint32_t address,
+				  unsigned int len, unsigned int *retlen,
+				  uint8_t *data)
+{
+	if (address + len > FLASH_SIZE)
+		return DRV_RC_INVALID_OPERATION;
+	memcpy(data, &sh->flash[address], len);
+	sh->read_bytes += len;
+	*retlen = len;
+	return DRV_RC_OK;
+}
+
+/* Used by the previous backend */
+DRIVER_API_RC spi_flash_read(struct td_device *dev, uint32_t address,
+			     unsigned int len, unsigned int *retlen,
+			     uint32_t *data)
+{
+	DRIVER_API_RC ret;
+
+	ret = spi_flash_read_byte(dev, address, len * 4, retlen,
+				  (uint8_t *)data);
+	*retlen = len;
+	return ret;
+}
+
+DRIVER_API_RC spi_flash_write_byte(struct td_device *dev, uint32_t address,
+				   unsigned int len, unsigned int *retlen,
+				   uint8_t *data)
+{
+	unsigned int n = len;
+	unsigned int i;
+
+	if (address + len > FLASH_SIZE)
+		return DRV_RC_INVALID_OPERATION;
+	if (cut_budget >= 0 && cut_budget <= len)
+		n = cut_budget;
+	for (i = 0; i < n; i++)
+		sh->flash[address + i] &= data[i];
+	spend(len);
+	/* The driver programs each page separately */
+	sh->programs += (address + len - 1) / PAGE_SIZE - address / PAGE_SIZE +
+			1;
+	*retlen = len;
+	return DRV_RC_OK;
+}
+
+DRIVER_API_RC spi_flash_sector_erase(struct td_device *dev,
+				     uint32_t start_block, uint32_t nb_blocks)
+{
+	uint32_t addr = start_block * SECTOR_SIZE;
+	uint32_t size = nb_blocks * SECTOR_SIZE;
+
+	if (addr + size > FLASH_SIZE)
+		return DRV_RC_INVALID_OPERATION;
+	if (cut_budget >= 0 && cut_budget <= size)
+		/* Half erased, either end first */
+		memset(&sh->flash[addr + (rand() & 1) * size / 2], 0xff,
+		       size / 2);
+	else
+		memset(&sh->flash[addr], 0xff, size);
+	spend(size);
+	sh->erases += nb_blocks;
+	return DRV_RC_OK;
+}
+
+enum flush_mode {
+	FLUSH_LINE,     /* Idle logger: flushed after each line */
+	FLUSH_BURST,    /* Bursts of 10 lines */
+	FLUSH_PAGE,     /* Continuous logging: flushed when a page is full */
+};
+
+static void log_line(void)
+{
+	char line[128];
+	int len = 55 + rand() % 71;
+	int n;
+
+	n = snprintf(line, sizeof(line), "L%06u ", sh->next_line++);
+	memset(&line[n], 'a' + rand() % 26, len - 2 - n);
+	memcpy(&line[len - 2], "\r\n", 2);
+	log_backend_flash.put_one_msg(line, len);
+}
+
+/* One boot of the logger in a child process, cut after budget bytes */
+static void boot(uint32_t lines, enum flush_mode mode, long budget,
+		 unsigned int seed)
+{
+	uint32_t i;
+	pid_t pid;
+
+	fflush(stdout);
+	pid = fork();
+	if (pid < 0) {
+		perror("fork");
+		exit(1);
+	}
+	if (pid) {
+		waitpid(pid, NULL, 0);
+		return;
+	}
+
+	srand(seed);
+	cut_budget = budget;
+	log_backend_flash_init();
+	for (i = 0; i < lines; i++) {
+		log_line();
+		if (log_backend_flash.flush &&
+		    (mode == FLUSH_LINE ||
+		     (mode == FLUSH_BURST && i % 10 == 9)))
+			log_backend_flash.flush();
+	}
+	if (log_backend_flash.flush)
+		log_backend_flash.flush();
+	_exit(0);
+}
+
+static void run_counts(const char *name, enum flush_mode mode, uint32_t lines)
+{
+	uint32_t read_bytes;
+
+	memset(sh, 0xff, sizeof(sh->flash));
+	sh->next_line = 0;
+	/* Fill a part of the ring, then count a boot and the lines */
+	boot(lines, mode, -1, 1);
+	sh->read_bytes = 0;
+	sh->programs = 0;
+	sh->erases = 0;
+	boot(0, mode, -1, 2);
+	read_bytes = sh->read_bytes;
+	sh->programs = 0;
+	sh->erases = 0;
+	boot(lines, mode, -1, 3);
+	printf("  %-10s %10.0f %10.1f %12u\n", name,
+	       sh->programs * 1000.0 / lines, sh->erases * 1000.0 / lines,
+	       read_bytes);
+}
+
+static uint16_t crc16(uint16_t crc, const uint8_t *buf, uint32_t len)
+{
+	int i;
+
+	while (len--) {
+		crc ^= (uint16_t)*buf++ << 8;
+		for (i = 0; i < 8; i++)
+			crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+	}
+	return crc;
+}
+
+/* Decode the log area, returns the number of errors */
+static int decode(uint32_t nb_cuts, uint32_t *records)
+{
+	uint32_t seqs[SPI_LOG_NB_BLOCKS];
+	uint32_t hdr[4];
+	uint32_t expected = 0, line, last_line = 0;
+	uint32_t torn = 0, lost = 0, out_of_order = 0;
+	bool first = true;
+	uint32_t nb = 0;
+	uint32_t i, j, s, off;
+	uint16_t len, crc;
+	uint32_t seq;
+	const uint8_t *d;
+
+	for (i = 0; i < SPI_LOG_NB_BLOCKS; i++) {
+		memcpy(hdr, &sh->flash[i * SECTOR_SIZE], sizeof(hdr));
+		if (hdr[0] != 0x53474f4c || hdr[3] != ~(hdr[0] ^ hdr[1] ^ hdr[2]) ||
+		    hdr[1] % SPI_LOG_NB_BLOCKS != i)
+			continue;
+		/* Insertion in sequence order */
+		for (j = nb; j > 0 && (int32_t)(seqs[j - 1] - hdr[1]) > 0; j--)
+			seqs[j] = seqs[j - 1];
+		seqs[j] = hdr[1];
+		nb++;
+	}
+
+	*records = 0;
+	for (i = 0; i < nb; i++) {
+		s = seqs[i] % SPI_LOG_NB_BLOCKS;
+		d = &sh->flash[s * SECTOR_SIZE];
+		off = sizeof(hdr);
+		while (off + 8 <= SECTOR_SIZE) {
+			memcpy(&len, d + off, 2);
+			memcpy(&crc, d + off + 2, 2);
+			memcpy(&seq, d + off + 4, 4);
+			if (len == 0xffff)
+				break;
+			if (off + 8 + len > SECTOR_SIZE ||
+			    crc != crc16(crc16(0xffff, d + off + 4, 4),
+					 d + off + 8, len)) {
+				torn++;
+				break;
+			}
+			if (!first && seq != expected)
+				lost += seq - expected;
+			if (sscanf((const char *)d + off + 8, "L%u", &line) !=
+			    1 || (!first && line <= last_line))
+				out_of_order++;
+			first = false;
+			expected = seq + 1;
+			last_line = line;
+			(*records)++;
+			off += 8 + len;
+		}
+	}
+	printf("  %u sectors, %u records, %u lost, %u torn, %u out of order\n",
+	       nb, *records, lost, torn, out_of_order);
+	return lost + out_of_order + (torn > nb_cuts);
+}
+
+static void usage(const char *name)
+{
+	printf("usage: %s [-n lines] [-p cuts] [-s seed] [-o dump]\n"
+	       "  -n lines  lines logged per boot (1000)\n"
+	       "  -p cuts   boots cut by a power loss instead of the counts\n"
+	       "  -o dump   write the log area to a file\n", name);
+}
+
+int main(int argc, char **argv)
+{
+	const char *dump = NULL;
+	uint32_t lines = 1000;
+	uint32_t nb_cuts = 0;
+	unsigned int seed = 1;
+	uint32_t records;
+	uint32_t i;
+	FILE *f;
+	int opt;
+	int errors = 0;
+
+	while ((opt = getopt(argc, argv, "n:p:s:o:h")) != -1) {
+		switch (opt) {
+		case 'n':
+			lines = atoi(optarg);
+			break;
+		case 'p':
+			nb_cuts = atoi(optarg);
+			break;
+		case 's':
+			seed = atoi(optarg);
+			break;
+		case 'o':
+			dump = optarg;
+			break;
+		default:
+			usage(argv[0]);
+			return opt != 'h';
+		}
+	}
+	if (!lines)
+		lines = 1000;
+
+	sh = mmap(NULL, sizeof(*sh), PROT_READ | PROT_WRITE,
+		  MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (sh == MAP_FAILED) {
+		perror("mmap");
+		return 1;
+	}
+	printf("Log area of %u sectors, %u lines of 55 to 125 bytes per boot\n",
+	       SPI_LOG_NB_BLOCKS, lines);
+
+	if (!nb_cuts) {
+		printf("  %-10s %10s %10s %12s\n", "flush", "programs",
+		       "erases", "boot reads");
+		printf("  %-10s %10s %10s %12s\n", "", "/1000", "/1000",
+		       "(bytes)");
+		run_counts("line", FLUSH_LINE, lines);
+		run_counts("burst", FLUSH_BURST, lines);
+		run_counts("page", FLUSH_PAGE, lines);
+	} else {
+		memset(sh, 0xff, sizeof(sh->flash));
+		sh->next_line = 0;
+		srand(seed);
+		/* Up to 2 sectors programmed per boot, the ring keeps the
+		 * last cuts */
+		for (i = 0; i < nb_cuts; i++)
+			boot(lines, FLUSH_BURST, rand() % (2 * SECTOR_SIZE),
+			     rand());
+		boot(10, FLUSH_BURST, -1, rand());
+		printf("  %u power cuts, %u lines logged\n", nb_cuts,
+		       sh->next_line);
+		errors = decode(nb_cuts, &records);
+	}
+
+	if (dump) {
+		f = fopen(dump, "wb");
+		if (!f || fwrite(sh->flash, FLASH_SIZE, 1, f) != 1) {
+			perror(dump);
+			return 1;
+		}
+		fclose(f);
+	}
+	return errors != 0;
+}
@@ -0,0 +1,325 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Host simulation of the UART log backend.
+ *
+ * The backend runs in virtual time against a model of the NS16550 TX FIFO:
+ * 16 bytes, one byte sent every 10 bits at 115200 baud. uart_poll_out()
+ * busy-waits until the FIFO is empty, like the Zephyr driver waits for
+ * THRE, and the TX interrupt fires when the FIFO is empty while enabled.
+ * The CPU time of the logger is the busy-wait time, plus fixed costs per
+ * line, per byte copied or written to the FIFO, and per interrupt. These
+ * costs are assumptions, set with the options: the results are estimates
+ * of the CPU time, not target measurements.
+ *
+ * The log task writes numbered lines, early ones before the UART interrupt
+ * is connected. The output of the UART is checked: the lines come in order
+ * and the dropped ones are all reported by the drop notices, and the
+ * wakelock of the backend is released once all the lines are sent.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <uart.h>
+#include "infra/pm.h"
+#include "util/misc.h"
+#include "machine/soc/intel/quark_se/quark/log_backend_uart.h"
+
+#define FIFO_SIZE 16
+#define RX_SIZE (4 * 1024 * 1024)
+
+struct device __device_uart_ns16550_1 = { "UART_1" };
+
+static struct {
+	uint32_t baud;
+	uint32_t line_ns;       /* Per uart_puts() call */
+	uint32_t byte_ns;       /* Per byte copied or written to the FIFO */
+	uint32_t irq_ns;        /* Interrupt entry, exit and dispatch */
+	uint32_t line_len;
+} cfg = { 115200, 2000, 100, 5000, 100 };
+
+static uint64_t now;            /* ns */
+static uint64_t char_ns;
+static uint64_t fifo_empty_at;
+static bool tx_irq_enabled;
+static bool irq_connected;
+static uint64_t cpu_ns;
+static uint32_t tx_irqs;
+static bool wl_held;
+
+static char *rx;
+static uint32_t rx_len;
+
+static void rx_put(const uint8_t *data, int len)
+{
+	if (rx_len + len > RX_SIZE)
+		len = RX_SIZE - rx_len;
+	memcpy(&rx[rx_len], data, len);
+	rx_len += len;
+}
+
+static uint32_t fifo_level(void)
+{
+	if (fifo_empty_at <= now)
+		return 0;
+	return (fifo_empty_at - now + char_ns - 1) / char_ns;
+}
+
+void uart_poll_out(struct device *dev, unsigned char c)
+{
+	/* Busy-wait for THRE */
+	if (fifo_empty_at > now) {
+		cpu_ns += fifo_empty_at - now;
+		now = fifo_empty_at;
+	}
+	fifo_empty_at = now + char_ns;
+	cpu_ns += cfg.byte_ns;
+	now += cfg.byte_ns;
+	rx_put(&c, 1);
+}
+
+int uart_fifo_fill(struct device *dev, const uint8_t *tx_data, int size)
+{
+	int n = MIN(size, (int)(FIFO_SIZE - fifo_level()));
+
+	fifo_empty_at = MAX(now, fifo_empty_at) + n * char_ns;
+	cpu_ns += n * cfg.byte_ns;
+	rx_put(tx_data, n);
+	return n;
+}
+
+void uart_irq_tx_enable(struct device *dev)
+{
+	tx_irq_enabled = true;
+}
+
+void uart_irq_tx_disable(struct device *dev)
+{
+	tx_irq_enabled = false;
+}
+
+void pm_wakelock_init(struct pm_wakelock *wl)
+{
+	wl->lock = 0;
+}
+
+int pm_wakelock_acquire(struct pm_wakelock *wl)
+{
+	wl_held = true;
+	wl->lock = 1;
+	return 0;
+}
+
+int pm_wakelock_release(struct pm_wakelock *wl)
+{
+	wl_held = false;
+	wl->lock = 0;
+	return 0;
+}
+
+/* Run the TX interrupts due until a given time */
+static void run_irqs(uint64_t until)
+{
+	while (irq_connected && tx_irq_enabled && fifo_empty_at <= until) {
+		if (fifo_empty_at > now)
+			now = fifo_empty_at;
+		tx_irqs++;
+		cpu_ns += cfg.irq_ns;
+		now += cfg.irq_ns;
+#ifdef CONFIG_QUARK_SE_QUARK_LOG_BACKEND_UART_IRQ
+		log_backend_uart_tx_isr(true);
+#endif
+	}
+	if (now < until)
+		now = until;
+}
+
+static uint32_t line_nb;
+
+static void log_line(void)
+{
+	char line[256];
+	int len;
+
+	len = snprintf(line, sizeof(line), "line %06u ", line_nb++);
+	memset(&line[len], 'x', cfg.line_len - 2 - len);
+	memcpy(&line[cfg.line_len - 2], "\r\n", 2);
+	cpu_ns += cfg.line_ns;
+	now += cfg.line_ns;
+#ifdef CONFIG_QUARK_SE_QUARK_LOG_BACKEND_UART_IRQ
+	/* Copy to the ring */
+	cpu_ns += cfg.line_len * cfg.byte_ns;
+	now += cfg.line_len * cfg.byte_ns;
+#endif
+	log_backend_uart.put_one_msg(line, cfg.line_len);
+}
+
+/*
+ * Check the output: numbered lines in order, and drop notices which account
+ * for all the missing lines. Returns the number of errors.
+ */
+static int check_output(uint32_t *dropped)
+{
+	uint32_t expected = 0;
+	uint32_t reported = 0;
+	unsigned int n;
+	char *p = rx;
+	char *end = rx + rx_len;
+	char *eol;
+	int errors = 0;
+
+	*dropped = 0;
+	while (p < end) {
+		eol = memchr(p, '\n', end - p);
+		if (!eol)
+			break;
+		*eol = '\0';
+		if (sscanf(p, "line %u", &n) == 1) {
+			if (n < expected) {
+				errors++;
+			} else {
+				*dropped += n - expected;
+				expected = n + 1;
+			}
+		} else if (sscanf(p, "-- %u log lines dropped", &n) == 1) {
+			reported += n;
+		} else {
+			errors++;
+		}
+		p = eol + 1;
+	}
+	*dropped += line_nb - expected;
+	/* The last drops may not have been reported yet */
+	if (reported > *dropped)
+		errors++;
+	return errors;
+}
+
+static void run(const char *name, uint32_t lines, uint32_t burst,
+		uint64_t period_ns)
+{
+	uint64_t start;
+	uint32_t dropped;
+	uint32_t i;
+	int errors;
+	double kb;
+
+	cpu_ns = 0;
+	tx_irqs = 0;
+	rx_len = 0;
+	line_nb = 0;
+
+	if (!irq_connected) {
+		/* Boot: the UART interrupt is not connected yet */
+		for (i = 0; i < 12; i++)
+			log_line();
+		log_backend_uart_init();
+		irq_connected = true;
+		errors = check_output(&dropped);
+		printf("  %-10s %8u %8u %10s %10s %8s\n", "boot", line_nb,
+		       dropped, "", "", errors ? "errors" : "ok");
+		cpu_ns = 0;
+		line_nb = 0;
+		rx_len = 0;
+	}
+	start = now;
+
+	for (i = 0; i < lines; i++) {
+		run_irqs(MAX(now, start + i / burst * period_ns));
+		log_line();
+	}
+	run_irqs(now + 10 * 1000000000ULL);
+
+	/* The wakelock must be released once the ring is drained */
+	errors = check_output(&dropped) + wl_held;
+	kb = lines * cfg.line_len / 1024.0;
+	printf("  %-10s %8u %8u %10.2f %10.1f %8s\n", name, lines, dropped,
+	       cpu_ns / 1e6 / kb, tx_irqs / kb, errors ? "errors" : "ok");
+}
+
+static void usage(const char *name)
+{
+	printf("usage: %s [-b baud] [-c line_ns] [-y byte_ns] [-i irq_ns] "
+	       "[-l line_len]\n", name);
+}
+
+int main(int argc, char **argv)
+{
+	int opt;
+
+	while ((opt = getopt(argc, argv, "b:c:y:i:l:h")) != -1) {
+		switch (opt) {
+		case 'b':
+			cfg.baud = atoi(optarg);
+			break;
+		case 'c':
+			cfg.line_ns = atoi(optarg);
+			break;
+		case 'y':
+			cfg.byte_ns = atoi(optarg);
+			break;
+		case 'i':
+			cfg.irq_ns = atoi(optarg);
+			break;
+		case 'l':
+			cfg.line_len = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+			return opt != 'h';
+		}
+	}
+	if (cfg.line_len < 16 || cfg.line_len > 256)
+		cfg.line_len = 100;
+	char_ns = 10 * 1000000000ULL / cfg.baud;
+	rx = malloc(RX_SIZE);
+	if (!rx)
+		return 1;
+
+#ifdef CONFIG_QUARK_SE_QUARK_LOG_BACKEND_UART_IRQ
+	printf("TX ring of %d bytes", CONFIG_QUARK_SE_QUARK_LOG_BACKEND_UART_BUF_SIZE);
+#else
+	printf("Polled");
+#endif
+	printf(", %u baud, lines of %u bytes, %u ns per line, %u ns per byte, "
+	       "%u ns per interrupt\n", cfg.baud, cfg.line_len, cfg.line_ns,
+	       cfg.byte_ns, cfg.irq_ns);
+	printf("  %-10s %8s %8s %10s %10s %8s\n", "scenario", "lines",
+	       "dropped", "CPU ms/kB", "irqs/kB", "output");
+	/* 8 lines every second, 1 line every 20 ms, 1 line every 5 ms */
+	run("burst", 240, 8, 1000000000ULL);
+	run("steady", 500, 1, 20000000ULL);
+	run("overload", 500, 1, 5000000ULL);
+	return 0;
+}
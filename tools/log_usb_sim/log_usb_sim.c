@@ -0,0 +1,293 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Host simulation of the USB log backend.
+ *
+ * The backend runs in virtual time, in microseconds. acm_write() schedules
+ * the completion of a bulk transfer after a fixed latency plus a time per
+ * 64-byte packet, transfers being sent one after the other by the host. The
+ * workqueue runs a work shortly after it is queued. A log task writes lines
+ * at a given period, each usb_puts() call taking a fixed CPU time, and
+ * blocks in semaphore_take() until a transfer completes or the timeout
+ * expires. Each scenario reports the lines received by the host per second
+ * and the lines dropped. In the stalled scenario the host never completes a
+ * transfer: a backend which waits forever is reported as blocked.
+ */
+
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "infra/log.h"
+#include "infra/panic.h"
+#include "os/os.h"
+#include "util/misc.h"
+#include "util/workqueue.h"
+#include "drivers/usb_acm.h"
+#include "machine/soc/intel/quark_se/quark/log_backend_usb.h"
+
+#define NB_EVENTS 64
+
+struct event {
+	uint64_t time;
+	void (*xfer_done)(int actual, void *data);
+	void (*work)(void *data);
+	void *data;
+	int actual;
+};
+
+static struct {
+	uint32_t xfer_us;       /* Latency of a bulk transfer */
+	uint32_t packet_us;     /* Time per 64-byte packet */
+	uint32_t work_us;       /* Delay before a queued work runs */
+	uint32_t puts_us;       /* CPU time of a usb_puts() call */
+	uint32_t line_len;
+	uint32_t nb_lines;
+} cfg = { 1000, 50, 20, 30, 112, 10000 };
+
+static uint64_t now;
+static uint64_t usb_busy_until;
+static bool host_stalled;
+static struct event events[NB_EVENTS];
+static int nb_events;
+static uint32_t sem_count;
+static jmp_buf blocked;
+
+static uint32_t lines_received;
+static uint64_t bytes_received;
+static uint64_t last_rx;
+static uint32_t xfers;
+
+static void schedule(const struct event *ev)
+{
+	int i = nb_events++;
+
+	if (nb_events > NB_EVENTS) {
+		printf("event queue overflow\n");
+		exit(1);
+	}
+	/* Kept sorted by time, in order of scheduling for the same time */
+	while (i > 0 && events[i - 1].time > ev->time) {
+		events[i] = events[i - 1];
+		i--;
+	}
+	events[i] = *ev;
+}
+
+/* Run the next event if it is due before the deadline */
+static bool run_event(uint64_t deadline)
+{
+	struct event ev;
+
+	if (!nb_events || events[0].time > deadline)
+		return false;
+	ev = events[0];
+	memmove(&events[0], &events[1], --nb_events * sizeof(ev));
+	if (ev.time > now)
+		now = ev.time;
+	if (ev.xfer_done)
+		ev.xfer_done(ev.actual, ev.data);
+	else
+		ev.work(ev.data);
+	return true;
+}
+
+int acm_write(int idx, uint8_t *buffer, int len,
+	      void (*xfer_done)(int, void *), void *data)
+{
+	struct event ev = { 0 };
+	uint32_t i;
+
+	xfers++;
+	if (host_stalled)
+		return 0;
+
+	for (i = 0; i + 1 < len; i++)
+		if (buffer[i] == '\r' && buffer[i + 1] == '\n')
+			lines_received++;
+	bytes_received += len;
+
+	usb_busy_until = (usb_busy_until > now ? usb_busy_until : now) +
+			 cfg.xfer_us + (len + 63) / 64 * cfg.packet_us;
+	last_rx = usb_busy_until;
+	ev.time = usb_busy_until;
+	ev.xfer_done = xfer_done;
+	ev.data = data;
+	ev.actual = len;
+	schedule(&ev);
+	return 0;
+}
+
+OS_ERR_TYPE workqueue_queue_work(void (*cb)(void *data), void *cb_data)
+{
+	struct event ev = { 0 };
+
+	ev.time = now + cfg.work_us;
+	ev.work = cb;
+	ev.data = cb_data;
+	schedule(&ev);
+	return E_OS_OK;
+}
+
+/* The backend uses a single semaphore */
+T_SEMAPHORE semaphore_create(uint32_t initial_count)
+{
+	sem_count = initial_count;
+	return &sem_count;
+}
+
+void semaphore_give(T_SEMAPHORE semaphore, OS_ERR_TYPE *err)
+{
+	sem_count++;
+	if (err)
+		*err = E_OS_OK;
+}
+
+OS_ERR_TYPE semaphore_take(T_SEMAPHORE semaphore, int timeout)
+{
+	uint64_t deadline = timeout == OS_WAIT_FOREVER ? UINT64_MAX :
+			    now + timeout * 1000ULL;
+
+	while (!sem_count && run_event(deadline))
+		;
+	if (sem_count) {
+		sem_count--;
+		return E_OS_OK;
+	}
+	if (timeout == OS_WAIT_FOREVER)
+		longjmp(blocked, 1);
+	now = deadline;
+	return E_OS_ERR_TIMEOUT;
+}
+
+void panic(int err)
+{
+	printf("panic %d\n", err);
+	exit(1);
+}
+
+bool is_console_backend_usb_acm_ready(void)
+{
+	return true;
+}
+
+static void run(const char *name, uint32_t period_us, bool stalled)
+{
+	char line[256];
+	uint32_t i;
+
+	now = 0;
+	usb_busy_until = 0;
+	host_stalled = stalled;
+	nb_events = 0;
+	lines_received = 0;
+	bytes_received = 0;
+	last_rx = 0;
+	xfers = 0;
+
+	memset(line, 'x', cfg.line_len - 2);
+	memcpy(&line[cfg.line_len - 2], "\r\n", 2);
+
+	i = 0;
+	if (!setjmp(blocked)) {
+		for (; i < cfg.nb_lines; i++) {
+			/* Interrupts and works due before the next line */
+			while (run_event(MAX(now, (uint64_t)i * period_us)))
+				;
+			if (now < (uint64_t)i * period_us)
+				now = (uint64_t)i * period_us;
+			log_backend_usb.put_one_msg(line, cfg.line_len);
+			now += cfg.puts_us;
+		}
+		while (run_event(UINT64_MAX))
+			;
+	}
+
+	if (i < cfg.nb_lines) {
+		printf("  %-10s blocked forever after %u lines, at %.3f s\n",
+		       name, i, now / 1e6);
+		return;
+	}
+	printf("  %-10s %8.0f %8.1f %8u %8u %8.3f\n", name,
+	       last_rx ? lines_received * 1e6 / last_rx : 0,
+	       last_rx ? bytes_received * 1e3 / last_rx : 0,
+	       xfers, cfg.nb_lines - lines_received,
+	       (stalled ? now : MAX(now, last_rx)) / 1e6);
+}
+
+static void usage(const char *name)
+{
+	printf("usage: %s [-x xfer_us] [-p packet_us] [-c puts_us] "
+	       "[-l line_len] [-n lines]\n", name);
+}
+
+int main(int argc, char **argv)
+{
+	int opt;
+
+	while ((opt = getopt(argc, argv, "x:p:c:l:n:h")) != -1) {
+		switch (opt) {
+		case 'x':
+			cfg.xfer_us = atoi(optarg);
+			break;
+		case 'p':
+			cfg.packet_us = atoi(optarg);
+			break;
+		case 'c':
+			cfg.puts_us = atoi(optarg);
+			break;
+		case 'l':
+			cfg.line_len = atoi(optarg);
+			break;
+		case 'n':
+			cfg.nb_lines = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+			return opt != 'h';
+		}
+	}
+	if (cfg.line_len < 2 || cfg.line_len > 256)
+		cfg.line_len = 112;
+
+	printf("%u lines of %u bytes, transfers of %u us + %u us per packet, "
+	       "%u us per line\n", cfg.nb_lines, cfg.line_len, cfg.xfer_us,
+	       cfg.packet_us, cfg.puts_us);
+	printf("  %-10s %8s %8s %8s %8s %8s\n", "scenario", "lines/s",
+	       "kB/s", "xfers", "dropped", "time (s)");
+	run("burst", 0, false);
+	run("200us", 200, false);
+	run("2ms", 2000, false);
+	run("stalled", 0, true);
+	return 0;
+}
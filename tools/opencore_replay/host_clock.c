@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <time.h>
+
+#include "host_os.h"
+
+/* Kept apart from host_os.c: <time.h> conflicts with infra/time.h */
+
+static uint64_t now_us;
+static uint64_t last_32k_us = UINT64_MAX;
+
+uint64_t host_clock_us(void)
+{
+	return now_us;
+}
+
+void host_clock_advance_ms(uint32_t ms)
+{
+	now_us += (uint64_t)ms * 1000;
+}
+
+uint32_t get_uptime_ms(void)
+{
+	return (uint32_t)(now_us / 1000);
+}
+
+uint64_t get_uptime64_ms(void)
+{
+	return now_us / 1000;
+}
+
+/*
+ * The core busy waits on this counter when its next poll is less than 1 ms
+ * away. The clock does not move while the core runs, so a second read at
+ * the same instant is taken as a wait and lets the counter reach its next
+ * tick, as the hardware one would.
+ */
+uint32_t get_uptime_32k(void)
+{
+	uint64_t ticks = now_us * 32768 / 1000000;
+
+	if (now_us == last_32k_us) {
+		ticks++;
+		now_us = (ticks * 1000000 + 32767) / 32768;
+	}
+	last_32k_us = now_us;
+	return (uint32_t)ticks;
+}
+
+uint64_t host_cpu_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
@@ -0,0 +1,312 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <nanokernel.h>
+#include "os/os.h"
+#include "infra/log.h"
+#include "infra/message.h"
+#include "infra/panic.h"
+#include "infra/pm.h"
+#include "infra/port.h"
+#include "infra/time.h"
+
+#include "host_os.h"
+
+#define HOST_PENDING_MSG 256
+
+struct host_queue {
+	uint32_t size;
+	uint32_t head;
+	uint32_t count;
+	T_QUEUE_MESSAGE msg[];
+};
+
+struct host_port {
+	void (*handler)(struct message *, void *);
+	void *priv;
+};
+
+/* balloc'ed blocks carry their size for the pool statistics */
+struct host_block {
+	uint32_t size;
+	uint32_t pad[3];
+	uint8_t data[];
+};
+
+int host_verbose;
+
+static struct host_mem_stat mem_stat;
+
+static struct host_port ports[MAX_PORTS];
+static uint16_t port_count;
+static struct message *pending[HOST_PENDING_MSG];
+static uint32_t pending_head;
+static uint32_t pending_count;
+
+static nano_fiber_entry_t fiber_entry;
+static jmp_buf run_end;
+static uint32_t run_end_ms;
+
+static const char *const level_names[LOG_LEVEL_NUM] = {
+	"ERROR", "WARN", "INFO", "DEBUG"
+};
+
+void *balloc(uint32_t size, OS_ERR_TYPE *err)
+{
+	struct host_block *blk = malloc(sizeof(*blk) + size);
+
+	if (blk == NULL) {
+		if (err)
+			*err = E_OS_ERR_NO_MEMORY;
+		return NULL;
+	}
+	/* Not zeroed on target either: make reads of uninitialized fields
+	 * reproducible */
+	memset(blk->data, 0xa5, size);
+	blk->size = size;
+	mem_stat.in_use += size;
+	mem_stat.allocs++;
+	if (mem_stat.in_use > mem_stat.peak)
+		mem_stat.peak = mem_stat.in_use;
+	if (err)
+		*err = E_OS_OK;
+	return blk->data;
+}
+
+OS_ERR_TYPE bfree(void *buffer)
+{
+	struct host_block *blk;
+
+	if (buffer == NULL)
+		return E_OS_ERR;
+	blk = (struct host_block *)((uint8_t *)buffer -
+				    offsetof(struct host_block, data));
+	mem_stat.in_use -= blk->size;
+	free(blk);
+	return E_OS_OK;
+}
+
+void host_get_mem_stat(struct host_mem_stat *stat)
+{
+	*stat = mem_stat;
+}
+
+T_MUTEX mutex_create(void)
+{
+	/* Any non NULL handle, there is a single thread */
+	return (T_MUTEX)&mem_stat;
+}
+
+void mutex_delete(T_MUTEX mutex)
+{
+}
+
+OS_ERR_TYPE mutex_lock(T_MUTEX mutex, int timeout)
+{
+	return E_OS_OK;
+}
+
+void mutex_unlock(T_MUTEX mutex)
+{
+}
+
+void pm_wakelock_init(struct pm_wakelock *wli)
+{
+	memset(wli, 0, sizeof(*wli));
+}
+
+int pm_wakelock_acquire(struct pm_wakelock *wl)
+{
+	wl->lock = 1;
+	return 0;
+}
+
+int pm_wakelock_release(struct pm_wakelock *wl)
+{
+	wl->lock = 0;
+	return 0;
+}
+
+void log_vprintk(uint8_t level, const char *module_short_name,
+		 const char *format, va_list args)
+{
+	if (!host_verbose && level > LOG_LEVEL_ERROR)
+		return;
+	fprintf(stderr, "%8u %-5s %s: ", get_uptime_ms(),
+		level < LOG_LEVEL_NUM ? level_names[level] : "?",
+		module_short_name);
+	vfprintf(stderr, format, args);
+	fputc('\n', stderr);
+}
+
+void log_printk(uint8_t level, const char *module_short_name,
+		const char *format, ...)
+{
+	va_list args;
+
+	va_start(args, format);
+	log_vprintk(level, module_short_name, format, args);
+	va_end(args);
+}
+
+void panic(int err)
+{
+	fprintf(stderr, "panic %d at %u ms\n", err, get_uptime_ms());
+	abort();
+}
+
+T_QUEUE queue_create(uint32_t maxSize)
+{
+	struct host_queue *q = calloc(1, sizeof(*q) +
+				      maxSize * sizeof(T_QUEUE_MESSAGE));
+
+	if (q)
+		q->size = maxSize;
+	return (T_QUEUE)q;
+}
+
+void queue_send_message(T_QUEUE queue, T_QUEUE_MESSAGE message,
+			OS_ERR_TYPE *err)
+{
+	struct host_queue *q = queue;
+
+	if (q->count == q->size) {
+		*err = E_OS_ERR_OVERFLOW;
+		return;
+	}
+	q->msg[(q->head + q->count++) % q->size] = message;
+	*err = E_OS_OK;
+}
+
+/*
+ * The core fiber is the only caller: this is where the replay schedules.
+ * Port messages posted so far are dispatched first, as the service manager
+ * task would while the fiber waits. If nothing arrived, the virtual clock
+ * is moved by the timeout, as if the fiber had slept that long.
+ */
+void queue_get_message(T_QUEUE queue, T_QUEUE_MESSAGE *message, int timeout,
+		       OS_ERR_TYPE *err)
+{
+	struct host_queue *q = queue;
+
+	host_process_ports();
+	if (q->count) {
+		*message = q->msg[q->head];
+		q->head = (q->head + 1) % q->size;
+		q->count--;
+		*err = E_OS_OK;
+		return;
+	}
+	if (timeout == OS_NO_WAIT) {
+		*err = E_OS_ERR_EMPTY;
+		return;
+	}
+	if (timeout == OS_WAIT_FOREVER ||
+	    get_uptime_ms() + (uint32_t)timeout >= run_end_ms)
+		longjmp(run_end, 1);
+	host_clock_advance_ms(timeout);
+	*err = E_OS_ERR_TIMEOUT;
+}
+
+struct message *message_alloc(int size, OS_ERR_TYPE *err)
+{
+	struct message *msg = balloc(size, err);
+
+	if (msg) {
+		memset(msg, 0, size);
+		MESSAGE_LEN(msg) = size;
+	}
+	return msg;
+}
+
+void message_free(struct message *message)
+{
+	bfree(message);
+}
+
+uint16_t port_alloc(void *queue)
+{
+	if (port_count + 1 >= MAX_PORTS)
+		panic(E_OS_ERR_NO_MEMORY);
+	return ++port_count;
+}
+
+void port_set_handler(uint16_t port_id, void (*handler)(struct message *,
+							void *), void *param)
+{
+	ports[port_id].handler = handler;
+	ports[port_id].priv = param;
+}
+
+int port_send_message(struct message *msg)
+{
+	if (pending_count == HOST_PENDING_MSG)
+		panic(E_OS_ERR_OVERFLOW);
+	pending[(pending_head + pending_count++) % HOST_PENDING_MSG] = msg;
+	return E_OS_OK;
+}
+
+void host_process_ports(void)
+{
+	while (pending_count) {
+		struct message *msg = pending[pending_head];
+		struct host_port *port = &ports[MESSAGE_DST(msg)];
+
+		pending_head = (pending_head + 1) % HOST_PENDING_MSG;
+		pending_count--;
+		if (port->handler)
+			port->handler(msg, port->priv);
+		else
+			message_free(msg);
+	}
+}
+
+void task_fiber_start(char *stack, unsigned stack_size,
+		      nano_fiber_entry_t entry, int parameter1,
+		      int parameter2, unsigned priority, unsigned options)
+{
+	fiber_entry = entry;
+}
+
+void host_run(uint32_t end_ms)
+{
+	run_end_ms = end_ms;
+	if (fiber_entry == NULL || setjmp(run_end) != 0) {
+		host_process_ports();
+		return;
+	}
+	fiber_entry(0, 0);
+}
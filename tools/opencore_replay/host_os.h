@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __HOST_OS_H__
+#define __HOST_OS_H__
+
+#include <stdint.h>
+
+/**
+ * Host environment of the open sensor core replay.
+ *
+ * The firmware services used by open sensor core (memory pool, ports, IPC
+ * queue, uptime) are implemented on a virtual clock: the clock only moves
+ * when the core fiber blocks on its command queue, by the timeout it asked
+ * for. A replay is therefore deterministic and runs as fast as the host can
+ * execute the engine.
+ */
+
+struct host_mem_stat {
+	uint32_t in_use;        /* bytes currently allocated with balloc */
+	uint32_t peak;          /* high-water mark of in_use */
+	uint32_t allocs;        /* number of successful balloc calls */
+};
+
+extern int host_verbose;
+
+/** Current virtual time, in microseconds */
+uint64_t host_clock_us(void);
+
+/** Move the virtual clock forward */
+void host_clock_advance_ms(uint32_t ms);
+
+/** CPU time consumed by the calling thread, in nanoseconds */
+uint64_t host_cpu_ns(void);
+
+/** Run the core fiber until the virtual clock reaches end_ms */
+void host_run(uint32_t end_ms);
+
+/** Dispatch all the port messages waiting for their handler */
+void host_process_ports(void);
+
+void host_get_mem_stat(struct host_mem_stat *stat);
+
+#endif
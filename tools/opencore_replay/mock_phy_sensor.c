@@ -0,0 +1,334 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "infra/time.h"
+#include "sensors/phy_sensor_api/phy_sensor_drv_api.h"
+
+#include "mock_phy_sensor.h"
+
+#define MOCK_SENSOR_CNT 3
+
+struct mock_sample {
+	uint32_t t_ms;
+	int32_t v[3];
+};
+
+struct mock_phy_sensor {
+	/* Must stay first, the driver callbacks cast it back */
+	struct phy_sensor_t sensor;
+	struct mock_sample *samples;
+	uint32_t cap;
+	uint32_t last;          /* index of the sample last returned + 1 */
+	int32_t range;
+	uint16_t odr_min_x10;
+	uint16_t odr_x10;
+	uint8_t fifo_on;
+	uint64_t fifo_next_us;  /* time of the next frame pushed to the FIFO */
+	struct mock_phy_sensor_stat stat;
+};
+
+static void (*read_hook)(uint8_t type, uint32_t sample_ms);
+
+static int mock_open(struct phy_sensor_t *sensor)
+{
+	return DRV_RC_OK;
+}
+
+static void mock_close(struct phy_sensor_t *sensor)
+{
+}
+
+static int mock_activate(struct phy_sensor_t *sensor, bool enable)
+{
+	return DRV_RC_OK;
+}
+
+/*
+ * Register reads return the latest sample whatever the rate, the rate only
+ * clocks the FIFO
+ */
+static int mock_set_odr(struct phy_sensor_t *sensor, uint16_t odr_hz_x10)
+{
+	struct mock_phy_sensor *mock = (struct mock_phy_sensor *)sensor;
+
+	mock->odr_x10 = odr_hz_x10;
+	return DRV_RC_OK;
+}
+
+/* Same power of two rate ladder as the BMI160 */
+static int mock_query_odr(struct phy_sensor_t *sensor, uint16_t odr_target,
+			  uint16_t *odr_support)
+{
+	struct mock_phy_sensor *mock = (struct mock_phy_sensor *)sensor;
+	uint16_t odr = mock->odr_min_x10;
+
+	if (odr_target == 0) {
+		*odr_support = 0;
+		return DRV_RC_OK;
+	}
+	while (odr < odr_target && odr < 16000)
+		odr <<= 1;
+	*odr_support = odr;
+	return DRV_RC_OK;
+}
+
+static void mock_encode(struct mock_phy_sensor *mock,
+			const struct mock_sample *s, uint8_t *buffer)
+{
+	if (mock->sensor.type == SENSOR_ACCELEROMETER) {
+		phy_accel_data_t *accel = (phy_accel_data_t *)buffer;
+
+		accel->x = s->v[0];
+		accel->y = s->v[1];
+		accel->z = s->v[2];
+	} else {
+		phy_gyro_data_t *axes = (phy_gyro_data_t *)buffer;
+
+		axes->x = s->v[0];
+		axes->y = s->v[1];
+		axes->z = s->v[2];
+	}
+}
+
+/*
+ * Return the last sample recorded at t_ms, NULL if none yet, and account
+ * for the samples never returned
+ */
+static const struct mock_sample *mock_take(struct mock_phy_sensor *mock,
+					   uint32_t t_ms)
+{
+	uint32_t cur = mock->last;
+
+	while (cur < mock->stat.samples && mock->samples[cur].t_ms <= t_ms)
+		cur++;
+	/* Nothing recorded yet at this time */
+	if (cur == 0)
+		return NULL;
+
+	mock->stat.reads++;
+	if (cur != mock->last) {
+		mock->stat.skipped += cur - mock->last - 1;
+		mock->stat.fresh++;
+		mock->last = cur;
+		if (read_hook)
+			read_hook(mock->sensor.type, mock->samples[cur - 1].t_ms);
+	}
+	return &mock->samples[cur - 1];
+}
+
+static int mock_read(struct phy_sensor_t *sensor, uint8_t *buffer,
+		     uint16_t buff_len)
+{
+	struct mock_phy_sensor *mock = (struct mock_phy_sensor *)sensor;
+	const struct mock_sample *s;
+
+	if (buff_len < sensor->raw_data_len)
+		return 0;
+	s = mock_take(mock, get_uptime_ms());
+	if (s == NULL)
+		return 0;
+	mock_encode(mock, s, buffer);
+	return sensor->raw_data_len;
+}
+
+static int mock_enable_fifo(struct phy_sensor_t *sensor, uint8_t *buffer,
+			    uint16_t len, bool enable)
+{
+	struct mock_phy_sensor *mock = (struct mock_phy_sensor *)sensor;
+
+	mock->fifo_on = enable;
+	mock->fifo_next_us = (uint64_t)get_uptime_ms() * 1000;
+	return DRV_RC_OK;
+}
+
+/*
+ * The FIFO gets a frame every ODR period since it was enabled, resampled
+ * from the trace. Like the BMI160 in stream mode, the oldest frames are
+ * lost when it overflows.
+ */
+static int mock_fifo_read(struct phy_sensor_t *sensor, uint8_t *buffer,
+			  uint16_t buff_len)
+{
+	struct mock_phy_sensor *mock = (struct mock_phy_sensor *)sensor;
+	uint64_t now_us = (uint64_t)get_uptime_ms() * 1000;
+	uint32_t depth = sensor->hw_fifo_len / sensor->hw_raw_data_len;
+	uint32_t period_us, pending;
+	int len = 0;
+
+	if (!mock->fifo_on || mock->odr_x10 == 0 || now_us < mock->fifo_next_us)
+		return 0;
+	period_us = 10000000 / mock->odr_x10;
+	pending = (now_us - mock->fifo_next_us) / period_us + 1;
+	if (pending > depth)
+		mock->fifo_next_us += (uint64_t)(pending - depth) * period_us;
+
+	while (mock->fifo_next_us <= now_us &&
+	       len + sensor->raw_data_len <= buff_len) {
+		const struct mock_sample *s =
+			mock_take(mock, mock->fifo_next_us / 1000);
+
+		mock->fifo_next_us += period_us;
+		if (s == NULL)
+			continue;
+		mock_encode(mock, s, buffer + len);
+		len += sensor->raw_data_len;
+	}
+	return len;
+}
+
+static int mock_get_property(struct phy_sensor_t *sensor, uint8_t type,
+			     void *value)
+{
+	struct mock_phy_sensor *mock = (struct mock_phy_sensor *)sensor;
+
+	if (type == SENSOR_PROP_SENSING_RANGE) {
+		phy_sensor_range_property_t *range = value;
+
+		range->low = -mock->range;
+		range->high = mock->range;
+		return DRV_RC_OK;
+	}
+	if (type == SENSOR_PROP_FIFO_SHARE_BITMAP) {
+		phy_sensor_fifo_share_property_t *share = value;
+
+		share->bitmap = 0;
+		return DRV_RC_OK;
+	}
+	return DRV_RC_INVALID_OPERATION;
+}
+
+#define MOCK_SENSOR(_type, _data_t, _range, _odr_min, _fifo_len) \
+	{ \
+		.sensor = { \
+			.type = _type, \
+			.raw_data_len = sizeof(_data_t), \
+			.hw_raw_data_len = sizeof(_data_t), \
+			.hw_fifo_len = _fifo_len, \
+			.report_mode_mask = PHY_SENSOR_REPORT_MODE_POLL_REG_MASK | \
+					    (_fifo_len ? \
+					     PHY_SENSOR_REPORT_MODE_POLL_FIFO_MASK : 0), \
+			.api = { \
+				.open = mock_open, \
+				.close = mock_close, \
+				.activate = mock_activate, \
+				.set_odr = mock_set_odr, \
+				.query_odr = mock_query_odr, \
+				.read = mock_read, \
+				.enable_fifo = mock_enable_fifo, \
+				.fifo_read = mock_fifo_read, \
+				.get_property = mock_get_property, \
+			}, \
+		}, \
+		.range = _range, \
+		.odr_min_x10 = _odr_min, \
+		.stat = { .type = _type }, \
+	}
+
+static struct mock_phy_sensor mocks[MOCK_SENSOR_CNT] = {
+	/* 1 KB FIFOs like the BMI160, none on the magnetometer */
+	MOCK_SENSOR(SENSOR_ACCELEROMETER, phy_accel_data_t, 8, 125, 1024),
+	MOCK_SENSOR(SENSOR_GYROSCOPE, phy_gyro_data_t, 2000, 250, 1024),
+	MOCK_SENSOR(SENSOR_MAGNETOMETER, phy_mag_data_t, 1300, 125, 0),
+};
+
+static struct mock_phy_sensor *mock_get(uint8_t type)
+{
+	for (int i = 0; i < MOCK_SENSOR_CNT; i++)
+		if (mocks[i].sensor.type == type)
+			return &mocks[i];
+	return NULL;
+}
+
+int mock_phy_sensor_add_sample(uint8_t type, uint32_t t_ms,
+			       const int32_t v[3])
+{
+	struct mock_phy_sensor *mock = mock_get(type);
+	struct mock_sample *s;
+
+	if (mock == NULL)
+		return -1;
+	if (mock->stat.samples == mock->cap) {
+		uint32_t cap = mock->cap ? mock->cap * 2 : 1024;
+
+		s = realloc(mock->samples, cap * sizeof(*s));
+		if (s == NULL)
+			return -1;
+		mock->samples = s;
+		mock->cap = cap;
+	}
+	s = &mock->samples[mock->stat.samples++];
+	s->t_ms = t_ms;
+	memcpy(s->v, v, sizeof(s->v));
+	return 0;
+}
+
+int mock_phy_sensor_register(void)
+{
+	int count = 0;
+
+	for (int i = 0; i < MOCK_SENSOR_CNT; i++) {
+		if (mocks[i].stat.samples == 0)
+			continue;
+		if (sensor_register(&mocks[i].sensor) == 0)
+			count++;
+		mocks[i].stat.dev_id = mocks[i].sensor.dev_id;
+	}
+	return count;
+}
+
+uint32_t mock_phy_sensor_duration(void)
+{
+	uint32_t end = 0;
+
+	for (int i = 0; i < MOCK_SENSOR_CNT; i++) {
+		uint32_t n = mocks[i].stat.samples;
+
+		if (n && mocks[i].samples[n - 1].t_ms > end)
+			end = mocks[i].samples[n - 1].t_ms;
+	}
+	return end;
+}
+
+void mock_phy_sensor_set_read_hook(void (*hook)(uint8_t type,
+						uint32_t sample_ms))
+{
+	read_hook = hook;
+}
+
+int mock_phy_sensor_get_stat(int idx, struct mock_phy_sensor_stat *stat)
+{
+	if (idx < 0 || idx >= MOCK_SENSOR_CNT)
+		return -1;
+	*stat = mocks[idx].stat;
+	return 0;
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __MOCK_PHY_SENSOR_H__
+#define __MOCK_PHY_SENSOR_H__
+
+#include <stdint.h>
+
+#include "sensors/phy_sensor_api/phy_sensor_common.h"
+
+/**
+ * Trace backed physical sensors for the open sensor core replay.
+ *
+ * Accelerometer, gyroscope and magnetometer drivers are registered to the
+ * physical sensor layer like the real ones, in polling mode. A register read
+ * returns the last trace sample whose timestamp is not after the current
+ * uptime, so the core may poll at any rate: samples are repeated when it
+ * polls faster than the trace and skipped when it polls slower.
+ *
+ * The accelerometer and the gyroscope also have a 1 KB FIFO, filled at the
+ * rate set by the core with the trace resampled the same way, so the core
+ * batches their reads as on the board.
+ */
+
+struct mock_phy_sensor_stat {
+	uint8_t type;
+	dev_id_t dev_id;
+	uint32_t samples;       /* samples in the trace */
+	uint32_t reads;         /* frames returned to the core */
+	uint32_t fresh;         /* reads returning a sample never returned */
+	uint32_t skipped;       /* samples never returned */
+};
+
+/**
+ * Append a sample to the trace of a sensor, timestamps must not decrease.
+ *
+ * @return 0 on success, -1 if the type is not simulated or out of memory
+ */
+int mock_phy_sensor_add_sample(uint8_t type, uint32_t t_ms,
+			       const int32_t v[3]);
+
+/** Register the sensors having a trace, return how many were registered */
+int mock_phy_sensor_register(void);
+
+/** Time of the last sample of all traces, in ms */
+uint32_t mock_phy_sensor_duration(void);
+
+/** Called for each sample read for the first time, with its trace time */
+void mock_phy_sensor_set_read_hook(void (*hook)(uint8_t type,
+						uint32_t sample_ms));
+
+/** Statistics of the idx-th simulated sensor, return -1 past the last */
+int mock_phy_sensor_get_stat(int idx, struct mock_phy_sensor_stat *stat);
+
+#endif
@@ -0,0 +1,575 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Replay of sensor traces through open sensor core on the host.
+ *
+ * The engine, the physical sensor layer and the algorithms are the firmware
+ * sources; only the OS services (host_os.c) and the sensor drivers
+ * (mock_phy_sensor.c) are simulated. See usage() for the options.
+ */
+
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "opencore_main.h"
+#include "opencore_method.h"
+#include "sensors/sensor_core/open_core/sc_exposed.h"
+
+#include "host_os.h"
+#include "mock_phy_sensor.h"
+
+#define MAX_SUBSCRIPTIONS 8
+#define MAX_TRACKED 16
+#define MAX_FEEDS 8
+#define DEFAULT_SAMPLING_HZ 100
+#define DEFAULT_REPORTING_MS 1000
+
+struct sensor_name {
+	const char *name;
+	uint8_t type;
+};
+
+struct exposed_track {
+	exposed_sensor_t *exposed;
+	uint32_t phy_mask;      /* bitmap of the physical types it depends on */
+	uint32_t reports;
+	uint32_t pending_ms;    /* oldest sample not covered by a report */
+	uint8_t pending;
+	uint32_t lat_count;     /* reports with a latency measured */
+	uint32_t lat_min;
+	uint32_t lat_max;
+	uint64_t lat_sum;
+};
+
+struct feed_prof {
+	feed_general_t *feed;
+	int (*exec)(void **, struct feed_general_t *);
+	int (*exec_block)(feed_block_t *, struct feed_general_t *);
+	uint32_t calls;
+	uint32_t frames;
+	uint64_t cpu_ns;
+};
+
+int ss_svc_port_id;
+
+static const struct sensor_name sensor_names[] = {
+	{ "accel", SENSOR_ACCELEROMETER },
+	{ "gyro", SENSOR_GYROSCOPE },
+	{ "mag", SENSOR_MAGNETOMETER },
+	{ "cadence", SENSOR_ABS_CADENCE },
+	{ "demo", SENSOR_ALGO_DEMO },
+};
+
+static const char *const feed_names[] = {
+	[BASIC_ALGO_GESTURE] = "gesture",
+	[BASIC_ALGO_STEPCOUNTER] = "stepcounter",
+	[BASIC_ALGO_TAPPING] = "tapping",
+	[BASIC_ALGO_SIMPLEGES] = "simpleges",
+	[BASIC_ALGO_RAWDATA] = "rawdata",
+	[BASIC_ALGO_OHRM] = "ohrm",
+	[BASIC_ALGO_ALTITUDE] = "altitude",
+	[BASIC_ALGO_KB] = "kb",
+	[BASIC_ALGO_DEMO] = "demo",
+};
+
+static struct subscription subs[MAX_SUBSCRIPTIONS];
+static int sub_count;
+static struct exposed_track tracks[MAX_TRACKED];
+static int track_count;
+static struct feed_prof profs[MAX_FEEDS];
+static int prof_count;
+static int print_reports;
+static int sub_resp_count;
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [options]\n"
+		"  -t FILE      replay a trace: 'time_ms,sensor,x,y,z' per line,\n"
+		"               sensor is accel (mg), gyro (mdeg/s) or mag\n"
+		"  -g walk|still  generate a synthetic trace instead\n"
+		"  -r HZ        sample rate of the generated trace (default 100)\n"
+		"  -l MS        length of the generated trace (default 60000)\n"
+		"  -d MS        replay duration (default: end of the trace)\n"
+		"  -S SENSOR[:ID][@HZ[,MS]]\n"
+		"               subscribe to an exposed sensor, several allowed;\n"
+		"               default: all the algorithm sensors\n"
+		"  -p           print every report\n"
+		"  -v           print open sensor core logs\n",
+		prog);
+}
+
+static int parse_sensor(const char *name, uint8_t *type)
+{
+	char *end;
+	long v;
+
+	for (unsigned i = 0; i < sizeof(sensor_names) / sizeof(sensor_names[0]);
+	     i++) {
+		if (strcmp(name, sensor_names[i].name) == 0) {
+			*type = sensor_names[i].type;
+			return 0;
+		}
+	}
+	v = strtol(name, &end, 0);
+	if (*name == '\0' || *end != '\0' || v < 0 || v > 255)
+		return -1;
+	*type = v;
+	return 0;
+}
+
+static const char *sensor_name(uint8_t type)
+{
+	static char buf[8];
+
+	for (unsigned i = 0; i < sizeof(sensor_names) / sizeof(sensor_names[0]);
+	     i++)
+		if (sensor_names[i].type == type)
+			return sensor_names[i].name;
+	snprintf(buf, sizeof(buf), "%u", type);
+	return buf;
+}
+
+static const char *feed_name(basic_algo_type_t type)
+{
+	if (type < sizeof(feed_names) / sizeof(feed_names[0]) &&
+	    feed_names[type])
+		return feed_names[type];
+	return "?";
+}
+
+/* SENSOR[:ID][@HZ[,MS]] */
+static int parse_subscription(char *arg)
+{
+	struct subscription *sub;
+	char *rate = strchr(arg, '@');
+	char *id = strchr(arg, ':');
+	uint8_t type;
+
+	if (sub_count == MAX_SUBSCRIPTIONS)
+		return -1;
+	sub = &subs[sub_count];
+	sub->sensor.dev_id = DEFAULT_ID;
+	sub->sampling_interval = DEFAULT_SAMPLING_HZ;
+	sub->reporting_interval = DEFAULT_REPORTING_MS;
+	if (rate) {
+		char *ms = strchr(rate, ',');
+
+		*rate++ = '\0';
+		sub->sampling_interval = atoi(rate);
+		if (ms)
+			sub->reporting_interval = atoi(ms + 1);
+	}
+	if (id) {
+		*id++ = '\0';
+		sub->sensor.dev_id = atoi(id);
+	}
+	if (parse_sensor(arg, &type))
+		return -1;
+	sub->sensor.sensor_type = type;
+	sub_count++;
+	return 0;
+}
+
+static int load_trace(const char *path)
+{
+	char line[128];
+	char name[16];
+	int count = 0;
+	int lineno = 0;
+	FILE *f = fopen(path, "r");
+
+	if (f == NULL) {
+		perror(path);
+		return -1;
+	}
+	while (fgets(line, sizeof(line), f)) {
+		unsigned long t;
+		int32_t v[3];
+		uint8_t type;
+
+		lineno++;
+		if (line[0] == '#' || line[0] == '\n')
+			continue;
+		if (sscanf(line, "%lu,%15[^,],%d,%d,%d", &t, name, &v[0], &v[1],
+			   &v[2]) != 5 || parse_sensor(name, &type) ||
+		    mock_phy_sensor_add_sample(type, t, v)) {
+			fprintf(stderr, "%s:%d: invalid sample\n", path, lineno);
+			fclose(f);
+			return -1;
+		}
+		count++;
+	}
+	fclose(f);
+	return count;
+}
+
+/*
+ * Walk: 2 steps per second, vertical acceleration swinging by 400 mg around
+ * 1 g and the forearm rotating with the arm swing. Still: device on a table.
+ */
+static int generate_trace(const char *kind, unsigned rate_hz,
+			  uint32_t length_ms)
+{
+	int walk = strcmp(kind, "walk") == 0;
+	uint32_t n = (uint64_t)length_ms * rate_hz / 1000;
+
+	if (!walk && strcmp(kind, "still") != 0)
+		return -1;
+	for (uint32_t i = 0; i < n; i++) {
+		uint32_t t = (uint64_t)i * 1000 / rate_hz;
+		double ph = 2 * M_PI * 2.0 * t / 1000;
+		int32_t a[3] = { 0, 0, 1000 };
+		int32_t g[3] = { 0, 0, 0 };
+
+		if (walk) {
+			a[0] = 150 * sin(ph / 2);
+			a[2] = 1000 + 400 * sin(ph);
+			g[1] = 60000 * sin(ph / 2);
+		}
+		mock_phy_sensor_add_sample(SENSOR_ACCELEROMETER, t, a);
+		mock_phy_sensor_add_sample(SENSOR_GYROSCOPE, t, g);
+	}
+	return n * 2;
+}
+
+static struct feed_prof *prof_get(feed_general_t *feed)
+{
+	for (int i = 0; i < prof_count; i++)
+		if (profs[i].feed == feed)
+			return &profs[i];
+	return NULL;
+}
+
+static int prof_exec(void **data, struct feed_general_t *feed)
+{
+	struct feed_prof *p = prof_get(feed);
+	uint64_t start = host_cpu_ns();
+	int ret = p->exec(data, feed);
+
+	p->cpu_ns += host_cpu_ns() - start;
+	p->calls++;
+	p->frames++;
+	return ret;
+}
+
+static int prof_exec_block(feed_block_t *blocks, struct feed_general_t *feed)
+{
+	struct feed_prof *p = prof_get(feed);
+	uint64_t start = host_cpu_ns();
+	int ret = p->exec_block(blocks, feed);
+
+	p->cpu_ns += host_cpu_ns() - start;
+	p->calls++;
+	for (int i = 0; i < feed->demand_length; i++)
+		p->frames += blocks[i].count;
+	return ret;
+}
+
+/* Interpose the algorithm entry points to account for their CPU time */
+static void wrap_feeds(void)
+{
+	for (list_t *next = feed_list.head; next != NULL && prof_count < MAX_FEEDS;
+	     next = next->next) {
+		feed_general_t *feed = (feed_general_t *)next;
+		struct feed_prof *p = &profs[prof_count++];
+
+		p->feed = feed;
+		p->exec = feed->ctl_api.exec;
+		p->exec_block = feed->ctl_api.exec_block;
+		if (p->exec)
+			feed->ctl_api.exec = prof_exec;
+		if (p->exec_block)
+			feed->ctl_api.exec_block = prof_exec_block;
+	}
+}
+
+static void track_exposed(void)
+{
+	for (list_t *next = exposed_sensor_list.head;
+	     next != NULL && track_count < MAX_TRACKED; next = next->next) {
+		exposed_sensor_t *exposed = (exposed_sensor_t *)next;
+		struct exposed_track *tr = &tracks[track_count++];
+
+		tr->exposed = exposed;
+		tr->lat_min = UINT32_MAX;
+		if (exposed->stat_flag & DIRECT_RAW) {
+			tr->phy_mask = 1 << exposed->type;
+			continue;
+		}
+		for (list_t *f = feed_list.head; f != NULL; f = f->next) {
+			feed_general_t *feed = (feed_general_t *)f;
+
+			if (((1 << feed->type) & exposed->depend_flag) == 0)
+				continue;
+			for (int i = 0; i < feed->demand_length; i++)
+				tr->phy_mask |= 1 << feed->demand[i].type;
+		}
+	}
+}
+
+static struct exposed_track *track_get(uint8_t type, uint8_t id)
+{
+	for (int i = 0; i < track_count; i++)
+		if (tracks[i].exposed->type == type &&
+		    tracks[i].exposed->id == id)
+			return &tracks[i];
+	return NULL;
+}
+
+static void on_sample(uint8_t type, uint32_t sample_ms)
+{
+	for (int i = 0; i < track_count; i++) {
+		struct exposed_track *tr = &tracks[i];
+
+		if ((tr->phy_mask & (1 << type)) && !tr->pending) {
+			tr->pending = 1;
+			tr->pending_ms = sample_ms;
+		}
+	}
+}
+
+static void on_report(struct sensor_data *data)
+{
+	struct exposed_track *tr = track_get(data->sensor.sensor_type,
+					     data->sensor.dev_id);
+	uint32_t now = get_uptime_ms();
+
+	if (print_reports) {
+		printf("%8u %s:%u", now, sensor_name(data->sensor.sensor_type),
+		       data->sensor.dev_id);
+		for (int i = 0; i < data->data_length; i++)
+			printf(" %02x", data->data[i]);
+		printf("\n");
+	}
+	if (tr == NULL)
+		return;
+	tr->reports++;
+	if (tr->pending) {
+		uint32_t lat = now - tr->pending_ms;
+
+		tr->pending = 0;
+		tr->lat_count++;
+		tr->lat_sum += lat;
+		if (lat < tr->lat_min)
+			tr->lat_min = lat;
+		if (lat > tr->lat_max)
+			tr->lat_max = lat;
+	}
+}
+
+/* Plays the sensor service: receives the messages sent by ipc_2svc_send */
+static void svc_handler(struct message *msg, void *priv)
+{
+	sc_rsp_t *rsp = (sc_rsp_t *)msg;
+	struct ia_cmd *cmd = (struct ia_cmd *)rsp->param;
+
+	if (rsp->msg_id == SENSOR_DATA) {
+		on_report((struct sensor_data *)cmd->param);
+	} else if (rsp->msg_id == RESP_SUBSCRIBE_SENSOR_DATA) {
+		struct return_value *rv = (struct return_value *)cmd->param;
+
+		sub_resp_count++;
+		if (rv->ret != RESP_SUCCESS)
+			fprintf(stderr, "subscription to %s:%u failed: %u\n",
+				sensor_name(rv->sensor.sensor_type),
+				rv->sensor.dev_id, rv->ret);
+	}
+	bfree(msg);
+}
+
+static void subscribe(const struct subscription *sub)
+{
+	struct ia_cmd *cmd = balloc(sizeof(*cmd) + sizeof(*sub), NULL);
+
+	memset(cmd, 0, sizeof(*cmd));
+	cmd->cmd_id = CMD_SUBSCRIBE_SENSOR_DATA;
+	cmd->length = sizeof(*cmd) + sizeof(*sub);
+	memcpy(cmd->param, sub, sizeof(*sub));
+	ipc_2core_send(cmd);
+}
+
+static void subscribe_default(void)
+{
+	for (int i = 0; i < track_count && sub_count < MAX_SUBSCRIPTIONS; i++) {
+		exposed_sensor_t *exposed = tracks[i].exposed;
+
+		if (exposed->stat_flag & DIRECT_RAW)
+			continue;
+		subs[sub_count].sensor.sensor_type = exposed->type;
+		subs[sub_count].sensor.dev_id = exposed->id;
+		subs[sub_count].sampling_interval = DEFAULT_SAMPLING_HZ;
+		subs[sub_count].reporting_interval = DEFAULT_REPORTING_MS;
+		sub_count++;
+	}
+}
+
+static void print_summary(uint32_t duration_ms, uint64_t total_ns)
+{
+	struct mock_phy_sensor_stat ps;
+	dss_pool_stat_t dss[DSS_POOL_CLASSES];
+	struct host_mem_stat mem;
+	int n;
+
+	printf("replayed %u ms, engine and algorithms: %llu us CPU\n",
+	       duration_ms, (unsigned long long)(total_ns / 1000));
+
+	printf("\n%-8s %3s %8s %8s %8s %8s %8s\n", "physical", "id",
+	       "samples", "reads", "reads/s", "fresh", "skipped");
+	for (int i = 0; mock_phy_sensor_get_stat(i, &ps) == 0; i++) {
+		if (ps.samples == 0)
+			continue;
+		printf("%-8s %3u %8u %8u %8u %8u %8u\n", sensor_name(ps.type),
+		       ps.dev_id, ps.samples, ps.reads,
+		       (uint32_t)((uint64_t)ps.reads * 1000 / duration_ms),
+		       ps.fresh, ps.skipped);
+	}
+
+	printf("\n%-12s %8s %8s %10s %10s\n", "feed", "calls", "frames",
+	       "cpu_us", "ns/frame");
+	for (int i = 0; i < prof_count; i++) {
+		struct feed_prof *p = &profs[i];
+
+		printf("%-12s %8u %8u %10llu %10llu\n", feed_name(p->feed->type),
+		       p->calls, p->frames,
+		       (unsigned long long)(p->cpu_ns / 1000),
+		       (unsigned long long)(p->frames ? p->cpu_ns / p->frames : 0));
+	}
+
+	printf("\n%-8s %3s %8s %24s\n", "exposed", "id", "reports",
+	       "latency_ms min/avg/max");
+	for (int i = 0; i < track_count; i++) {
+		struct exposed_track *tr = &tracks[i];
+		if (!(tr->exposed->stat_flag & SUBSCRIBED) && tr->reports == 0)
+			continue;
+		printf("%-8s %3u %8u %10u/%u/%u\n", sensor_name(tr->exposed->type),
+		       tr->exposed->id, tr->reports,
+		       tr->lat_count ? tr->lat_min : 0,
+		       tr->lat_count ?
+		       (uint32_t)(tr->lat_sum / tr->lat_count) : 0,
+		       tr->lat_max);
+	}
+
+	n = GetDssPoolStat(dss, DSS_POOL_CLASSES);
+	printf("\n%-8s %6s %6s %6s\n", "dss_slot", "count", "peak", "fail");
+	for (int i = 0; i < n; i++)
+		printf("%-8u %6u %6u %6u\n", dss[i].size, dss[i].count,
+		       dss[i].peak, dss[i].fail);
+
+	host_get_mem_stat(&mem);
+	printf("\nballoc: peak %u bytes, %u in use, %u allocations\n",
+	       mem.peak, mem.in_use, mem.allocs);
+}
+
+int main(int argc, char **argv)
+{
+	const char *trace = NULL;
+	const char *synthetic = NULL;
+	unsigned rate_hz = 100;
+	uint32_t length_ms = 60000;
+	uint32_t duration_ms = 0;
+	uint64_t start;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "t:g:r:l:d:S:pvh")) != -1) {
+		switch (opt) {
+		case 't':
+			trace = optarg;
+			break;
+		case 'g':
+			synthetic = optarg;
+			break;
+		case 'r':
+			rate_hz = atoi(optarg);
+			break;
+		case 'l':
+			length_ms = atoi(optarg);
+			break;
+		case 'd':
+			duration_ms = atoi(optarg);
+			break;
+		case 'S':
+			if (parse_subscription(optarg)) {
+				fprintf(stderr, "invalid subscription\n");
+				return 2;
+			}
+			break;
+		case 'p':
+			print_reports = 1;
+			break;
+		case 'v':
+			host_verbose = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 2;
+		}
+	}
+	if ((trace == NULL) == (synthetic == NULL) || rate_hz == 0) {
+		usage(argv[0]);
+		return 2;
+	}
+	if (trace ? load_trace(trace) <= 0 :
+	    generate_trace(synthetic, rate_hz, length_ms) <= 0) {
+		fprintf(stderr, "no sample to replay\n");
+		return 1;
+	}
+	if (duration_ms == 0)
+		duration_ms = mock_phy_sensor_duration() + 1;
+
+	mock_phy_sensor_register();
+	sensor_core_create(NULL);
+	ss_svc_port_id = port_alloc(NULL);
+	port_set_handler(ss_svc_port_id, svc_handler, NULL);
+
+	wrap_feeds();
+	track_exposed();
+	mock_phy_sensor_set_read_hook(on_sample);
+	if (sub_count == 0)
+		subscribe_default();
+	for (int i = 0; i < sub_count; i++)
+		subscribe(&subs[i]);
+
+	start = host_cpu_ns();
+	host_run(duration_ms);
+	print_summary(duration_ms, host_cpu_ns() - start);
+
+	/* The core defers its commands while it polls more often than every
+	 * 15 ms: once a fast sensor is on, later subscriptions may never be
+	 * served. */
+	if (sub_resp_count < sub_count)
+		fprintf(stderr, "warning: %d of %d subscriptions not processed "
+			"by the core\n", sub_count - sub_resp_count, sub_count);
+	return 0;
+}
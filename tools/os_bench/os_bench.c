@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Host run of the wakelock unit test and of the OS abstraction and wakelock
+ * micro benchmarks.
+ *
+ * wakelock_test, bench_os and bench_wakelock are built with the Linux OS
+ * port, on a single host thread. The hardware timer, the 32kHz clock, the
+ * shared memory block, the logger, the IPC and panic are stubbed here.
+ *
+ * Usage: os_bench [-t]    -t runs the unit test only
+ */
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "infra/log.h"
+#include "util/cunit_test.h"
+#include "util/cunit_bench.h"
+#include "soc_config.h"
+
+void os_init(void);
+
+int timer_hal_get_ms(void)
+{
+	return 0;
+}
+
+void timer_hal_init(void (*cb)(void *param), void *param)
+{
+}
+
+void timer_hal_trigger(int delay)
+{
+}
+
+uint32_t get_uptime_32k(void)
+{
+	return 0;
+}
+
+static struct platform_shared_block_ shared_block;
+volatile struct platform_shared_block_ *const shared_data = &shared_block;
+
+void pm_wakelock_set_any_wakelock_taken_on_cpu(bool wl_status)
+{
+	shared_data->any_lmt_wakelock_taken = wl_status;
+}
+
+void local_task_sleep_ms(int time)
+{
+}
+
+void panic(int err)
+{
+	fprintf(stderr, "panic %d\n", err);
+	abort();
+}
+
+void log_printk(uint8_t level, const char *module, const char *format, ...)
+{
+	va_list args;
+
+	va_start(args, format);
+	vprintf(format, args);
+	va_end(args);
+	printf("\n");
+}
+
+int ipc_request_sync_int(int request_id, int param1, int param2, void *ptr)
+{
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	os_init();
+	CU_RUN_TEST(wakelock_test);
+	if (argc < 2 || strcmp(argv[1], "-t")) {
+		CU_RUN_BENCH(bench_os);
+		CU_RUN_BENCH(bench_wakelock);
+	}
+	cu_print_report_final();
+	return 0;
+}
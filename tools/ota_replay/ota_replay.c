@@ -0,0 +1,400 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Host round trip of the OTA patch applier.
+ *
+ * A package generated by tools/scripts/build_utils/bsdiff_chunk.py between
+ * two firmware images is fed to util/ota_patch.c in BLE sized pieces, on a
+ * model of the flash holding the installed image and the image being built.
+ * The rebuilt image is compared with the target one, and the package size is
+ * reported against the size of the full image, with the apply time and the
+ * peak RAM of the applier.
+ *
+ * The update is then replayed with a power loss in the middle of a chunk
+ * write, and resumed from the progress reported by the last chunk_done
+ * call, then applied once more on the completed image, which must not write
+ * anything.
+ *
+ * The apply time is the host CPU time and the stack size is the one of the
+ * host build, they are estimates and not target measurements.
+ */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "util/ota_patch.h"
+
+#define STACK_SIZE      (256 * 1024)
+#define STACK_PAINT     0xa5
+#define LZG_HEADER_SIZE 16
+
+struct image {
+	uint8_t *data;
+	uint32_t len;
+};
+
+static struct image from, to, package;
+static uint8_t *flash_new;
+static uint32_t flash_new_len;
+static uint8_t *work;
+static uint32_t work_size;
+static uint32_t chunk_size = OTA_CHUNK_SIZE;
+static uint32_t mtu = 20;
+
+/* Flash counters and power loss injection */
+static uint32_t nb_writes;
+static int32_t writes_before_cut = -1;
+static uint32_t done_offset;
+static int16_t done_id = -1;
+
+/* Result of the last apply, filled by the apply thread */
+static struct ota_patch_ctx ctx;
+static uint32_t apply_from;
+static int apply_rc;
+static double apply_ms;
+static uint32_t stack_used;
+
+static int load(const char *name, struct image *img)
+{
+	FILE *f = fopen(name, "rb");
+	long len;
+
+	if (!f) {
+		perror(name);
+		return -1;
+	}
+	fseek(f, 0, SEEK_END);
+	len = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	img->data = malloc(len ? len : 1);
+	img->len = len;
+	if (!img->data || fread(img->data, 1, len, f) != (size_t)len) {
+		fprintf(stderr, "%s: read error\n", name);
+		fclose(f);
+		return -1;
+	}
+	fclose(f);
+	return 0;
+}
+
+static int flash_read_old(void *priv, uint32_t offset, uint8_t *buf,
+			  uint32_t len)
+{
+	if (offset > from.len || len > from.len - offset)
+		return -1;
+	memcpy(buf, &from.data[offset], len);
+	return 0;
+}
+
+static int flash_read_new(void *priv, uint32_t offset, uint8_t *buf,
+			  uint32_t len)
+{
+	if (offset > flash_new_len || len > flash_new_len - offset)
+		return -1;
+	memcpy(buf, &flash_new[offset], len);
+	return 0;
+}
+
+static int flash_write_new(void *priv, uint32_t offset, const uint8_t *buf,
+			   uint32_t len)
+{
+	if (offset % chunk_size || offset > flash_new_len ||
+	    len > flash_new_len - offset)
+		return -1;
+
+	/* Erase, then power loss half way through the program */
+	memset(&flash_new[offset], 0xff, chunk_size);
+	if (writes_before_cut == 0) {
+		memcpy(&flash_new[offset], buf, len / 2);
+		return -1;
+	}
+	if (writes_before_cut > 0)
+		writes_before_cut--;
+	memcpy(&flash_new[offset], buf, len);
+	nb_writes++;
+	return 0;
+}
+
+static void chunk_done(void *priv, uint32_t in_offset, int16_t id)
+{
+	done_offset = in_offset;
+	done_id = id;
+}
+
+static const struct ota_patch_ops flash_ops = {
+	.read_old = flash_read_old,
+	.read_new = flash_read_new,
+	.write_new = flash_write_new,
+	.chunk_done = chunk_done,
+};
+
+/*
+ * The work buffer holds one chunk and the largest decoded patch, read from
+ * the LZG header following each COMPRESSED_PATCH chunk header.
+ */
+static int scan_package(uint32_t *nb_chunks, uint32_t *max_patch)
+{
+	const struct ota_chunk_header *hdr;
+	const uint8_t *lzg;
+	uint32_t offset = 0;
+	uint32_t len;
+
+	*nb_chunks = 0;
+	*max_patch = 0;
+	while (offset < package.len) {
+		if (package.len - offset < sizeof(*hdr))
+			return -1;
+		hdr = (const struct ota_chunk_header *)&package.data[offset];
+		offset += sizeof(*hdr);
+		if (hdr->magic != OTA_CHUNK_HEADER_MAGIC || hdr->size < 0 ||
+		    (uint32_t)hdr->size > package.len - offset)
+			return -1;
+		if (hdr->type == OTA_CHUNK_TYPE_COMPRESSED_PATCH) {
+			if (hdr->size < LZG_HEADER_SIZE)
+				return -1;
+			lzg = &package.data[offset];
+			len = ((uint32_t)lzg[3] << 24) | (lzg[4] << 16) |
+			      (lzg[5] << 8) | lzg[6];
+			if (len > *max_patch)
+				*max_patch = len;
+		}
+		offset += hdr->size;
+		(*nb_chunks)++;
+	}
+	return 0;
+}
+
+static double cpu_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static void *idle_thread(void *arg)
+{
+	return NULL;
+}
+
+static void *apply_thread(void *arg)
+{
+	uint32_t i;
+	double start;
+
+	ota_patch_init(&ctx, &flash_ops, work, work_size, chunk_size);
+	if (apply_from)
+		ota_patch_resume(&ctx, done_offset, done_id);
+
+	start = cpu_ms();
+	apply_rc = OTA_PATCH_OK;
+	for (i = apply_from; i < package.len && apply_rc == OTA_PATCH_OK;
+	     i += mtu)
+		apply_rc = ota_patch_feed(&ctx, &package.data[i],
+					  package.len - i < mtu ?
+					  package.len - i : mtu);
+	if (apply_rc == OTA_PATCH_OK)
+		apply_rc = ota_patch_finish(&ctx, to.len);
+	apply_ms = cpu_ms() - start;
+	return NULL;
+}
+
+/*
+ * Run fn on a painted stack and return the number of stack bytes touched,
+ * including the thread descriptor the C library keeps at the top of it.
+ */
+static int32_t run_on_stack(void *(*fn)(void *))
+{
+	pthread_attr_t attr;
+	pthread_t thread;
+	uint8_t *stack;
+	uint32_t i;
+	int rc;
+
+	stack = aligned_alloc(4096, STACK_SIZE);
+	if (!stack)
+		return -1;
+	memset(stack, STACK_PAINT, STACK_SIZE);
+	pthread_attr_init(&attr);
+	pthread_attr_setstack(&attr, stack, STACK_SIZE);
+	rc = pthread_create(&thread, &attr, fn, NULL) ||
+	     pthread_join(thread, NULL);
+	pthread_attr_destroy(&attr);
+
+	for (i = 0; i < STACK_SIZE && stack[i] == STACK_PAINT; i++)
+		;
+	free(stack);
+	return rc ? -1 : (int32_t)(STACK_SIZE - i);
+}
+
+/* Apply the package from offset, return the status */
+static int apply(uint32_t offset)
+{
+	static int32_t thread_base = -1;
+	int32_t used;
+
+	if (thread_base < 0)
+		thread_base = run_on_stack(idle_thread);
+
+	apply_from = offset;
+	nb_writes = 0;
+	used = run_on_stack(apply_thread);
+	if (thread_base < 0 || used < 0)
+		return -1;
+	stack_used = used - thread_base;
+	return apply_rc;
+}
+
+static int check_image(const char *step)
+{
+	if (apply_rc != OTA_PATCH_OK) {
+		printf("%s: failed with %d\n", step, apply_rc);
+		return -1;
+	}
+	if (memcmp(flash_new, to.data, to.len)) {
+		printf("%s: rebuilt image differs from the target\n", step);
+		return -1;
+	}
+	return 0;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr,
+		"usage: %s [-s chunk_size] [-m mtu] [-c write] from.bin to.bin "
+		"package.bin\n"
+		"Applies package.bin, generated by bsdiff_chunk.py from from.bin\n"
+		"to to.bin, on a copy of from.bin, feeding mtu bytes at a time.\n"
+		"The power loss test cuts the given flash write, counted from 0,\n"
+		"the middle one by default.\n"
+		"Defaults: %u bytes chunks, %u bytes mtu.\n",
+		name, OTA_CHUNK_SIZE, mtu);
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t nb_chunks, max_patch, nb_packets, total_writes, resume_from;
+	int32_t cut = -1;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "s:m:c:h")) != -1) {
+		switch (opt) {
+		case 's':
+			chunk_size = atoi(optarg);
+			break;
+		case 'm':
+			mtu = atoi(optarg);
+			break;
+		case 'c':
+			cut = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+			return opt != 'h';
+		}
+	}
+	if (argc - optind != 3 || !chunk_size || !mtu) {
+		usage(argv[0]);
+		return 1;
+	}
+	if (load(argv[optind], &from) || load(argv[optind + 1], &to) ||
+	    load(argv[optind + 2], &package))
+		return 1;
+
+	if (scan_package(&nb_chunks, &max_patch)) {
+		fprintf(stderr, "%s: not a chunked patch package\n",
+			argv[optind + 2]);
+		return 1;
+	}
+	work_size = chunk_size + (max_patch ? max_patch : 1);
+	work = malloc(work_size);
+	flash_new_len = (to.len > from.len ? to.len : from.len) + chunk_size;
+	flash_new_len -= flash_new_len % chunk_size;
+	flash_new = malloc(flash_new_len);
+	if (!work || !flash_new)
+		return 1;
+
+	/* Full update, the new image slot holding an erased partition */
+	memset(flash_new, 0xff, flash_new_len);
+	apply(0);
+	if (check_image("update"))
+		return 1;
+	total_writes = nb_writes;
+	nb_packets = (package.len + mtu - 1) / mtu;
+	printf("image         %8u bytes, %u chunks of %u bytes\n", to.len,
+	       (to.len + chunk_size - 1) / chunk_size, chunk_size);
+	printf("package       %8u bytes, %u chunks, %.1f%% of the image, "
+	       "%u packets of %u bytes\n", package.len, nb_chunks,
+	       100.0 * package.len / to.len, nb_packets, mtu);
+	printf("chunks        %8u patched or compressed, %u kept, "
+	       "%u flash writes\n", ctx.nb_applied, ctx.nb_kept, nb_writes);
+	printf("apply time    %8.2f ms host CPU (estimate)\n", apply_ms);
+	printf("peak RAM      %8zu bytes: context %zu, work buffer %u "
+	       "(largest patch %u), stack %u (host estimate)\n",
+	       sizeof(ctx) + work_size + stack_used, sizeof(ctx), work_size,
+	       max_patch, stack_used);
+
+	/* Power loss while writing a chunk of the package, then resume */
+	if (cut < 0 || cut >= (int32_t)total_writes)
+		cut = total_writes / 2;
+	memset(flash_new, 0xff, flash_new_len);
+	done_offset = 0;
+	done_id = -1;
+	writes_before_cut = cut;
+	if (apply(0) != OTA_PATCH_ERR_FLASH) {
+		printf("power loss: not reached\n");
+		return 1;
+	}
+	writes_before_cut = -1;
+	resume_from = done_offset;
+	apply(resume_from);
+	if (check_image("resume"))
+		return 1;
+	printf("power loss    %8u bytes fed again after the cut, "
+	       "%u flash writes\n", package.len - resume_from, nb_writes);
+
+	/* Applying again on the completed image only checks the chunks */
+	apply(0);
+	if (check_image("reapply"))
+		return 1;
+	if (nb_writes) {
+		printf("reapply: %u chunks written again\n", nb_writes);
+		return 1;
+	}
+	printf("reapply       %8u chunks skipped, no flash write\n",
+	       ctx.nb_skipped);
+	return 0;
+}
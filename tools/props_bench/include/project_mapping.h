@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __HOST_PROJECT_MAPPING_H__
+#define __HOST_PROJECT_MAPPING_H__
+
+/* Flash layout of the host benchmark: both properties partitions get
+ * PROPS_BENCH_NB_BLOCKS blocks of the embedded flash, enough for the store to
+ * hold PROPERTIES_STORAGE_MAX_NB_PROPERTIES entries and still compact. */
+
+#define EMBEDDED_FLASH_BLOCK_SIZE                       2048
+
+#ifndef PROPS_BENCH_NB_BLOCKS
+#define PROPS_BENCH_NB_BLOCKS                           ( \
+		PROPERTIES_STORAGE_MAX_NB_PROPERTIES / 32 + 4)
+#endif
+
+#define FACTORY_RESET_NON_PERSISTENT_START_BLOCK        0
+#define FACTORY_RESET_NON_PERSISTENT_END_BLOCK          ( \
+		FACTORY_RESET_NON_PERSISTENT_START_BLOCK + \
+		PROPS_BENCH_NB_BLOCKS - 1)
+
+#define FACTORY_RESET_PERSISTENT_START_BLOCK            ( \
+		FACTORY_RESET_NON_PERSISTENT_END_BLOCK + 1)
+#define FACTORY_RESET_PERSISTENT_END_BLOCK              ( \
+		FACTORY_RESET_PERSISTENT_START_BLOCK + \
+		PROPS_BENCH_NB_BLOCKS - 1)
+
+#define EMBEDDED_FLASH_NB_BLOCKS                        ( \
+		FACTORY_RESET_PERSISTENT_END_BLOCK + 1)
+
+#endif
@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Host benchmark of the properties storage
+ * (properties_storage_soc_flash.c) on a RAM model of the embedded flash.
+ *
+ * The store is built once per maximum number of properties. The benchmark
+ * fills it the way properties_storage_test does: all properties but one are
+ * set, one more is rewritten until two blocks are closed, then half of the
+ * properties are deleted. It then reports the flash accesses and the host
+ * time of the boot time index rebuild, and the host time of the RAM index
+ * lookups. The flash access counts do not depend on the host; the times are
+ * host figures, only their scaling carries over to the target.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "infra/properties_storage.h"
+#include "drivers/soc_flash.h"
+#include "project_mapping.h"
+
+#define NB_LOOKUPS      1000000
+#define NB_INIT_RUNS    100
+#define REWRITTEN_KEY   999999
+
+static uint8_t flash[EMBEDDED_FLASH_NB_BLOCKS * EMBEDDED_FLASH_BLOCK_SIZE];
+
+static struct {
+	uint32_t reads;
+	uint32_t read_words;
+	uint32_t writes;
+	uint32_t erases;
+} stats;
+
+static int flash_range_ok(uint32_t address, unsigned int len)
+{
+	return address % 4 == 0 && address + len * 4 <= sizeof(flash);
+}
+
+DRIVER_API_RC soc_flash_read(uint32_t address, unsigned int len,
+			     unsigned int *retlen, uint32_t *data)
+{
+	*retlen = 0;
+	if (!flash_range_ok(address, len))
+		return DRV_RC_INVALID_OPERATION;
+	memcpy(data, &flash[address], len * 4);
+	stats.reads++;
+	stats.read_words += len;
+	*retlen = len;
+	return DRV_RC_OK;
+}
+
+/* Programming only clears bits, as on the embedded flash */
+DRIVER_API_RC soc_flash_write(uint32_t address, unsigned int len,
+			      unsigned int *retlen, uint32_t *data)
+{
+	const uint8_t *src = (const uint8_t *)data;
+
+	*retlen = 0;
+	if (!flash_range_ok(address, len))
+		return DRV_RC_INVALID_OPERATION;
+	for (unsigned int i = 0; i < len * 4; i++)
+		flash[address + i] &= src[i];
+	stats.writes++;
+	*retlen = len;
+	return DRV_RC_OK;
+}
+
+DRIVER_API_RC soc_flash_block_erase(unsigned int start_block,
+				    unsigned int block_count)
+{
+	if (start_block + block_count > EMBEDDED_FLASH_NB_BLOCKS)
+		return DRV_RC_INVALID_OPERATION;
+	memset(&flash[start_block * EMBEDDED_FLASH_BLOCK_SIZE], 0xff,
+	       block_count * EMBEDDED_FLASH_BLOCK_SIZE);
+	stats.erases += block_count;
+	return DRV_RC_OK;
+}
+
+void panic(int err)
+{
+	fprintf(stderr, "panic %d\n", err);
+	abort();
+}
+
+void log_printk(uint8_t level, const char *module_short_name,
+		const char *format, ...)
+{
+	(void)level;
+	(void)module_short_name;
+	(void)format;
+}
+
+static double now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void check(const char *what, int ok)
+{
+	if (!ok) {
+		fprintf(stderr, "%d properties: %s failed\n",
+			PROPERTIES_STORAGE_MAX_NB_PROPERTIES, what);
+		exit(1);
+	}
+}
+
+int main(void)
+{
+	const uint8_t *data = (const uint8_t *)"Random Test Data";
+	const uint8_t *data2 = (const uint8_t *)"132456789";
+	uint8_t rdata[PROPERTIES_STORAGE_MAX_VALUE_LEN];
+	uint16_t readlen;
+	bool persistent;
+	properties_storage_status_t ret;
+
+	memset(flash, 0xff, sizeof(flash));
+	properties_storage_format_all();
+
+	for (int i = 0; i < PROPERTIES_STORAGE_MAX_NB_PROPERTIES - 1; ++i) {
+		ret = properties_storage_set(i, data, 13, false);
+		check("set", ret == PROPERTIES_STORAGE_SUCCESS);
+	}
+	for (int i = 0; i < 2 * EMBEDDED_FLASH_BLOCK_SIZE / 24; ++i) {
+		ret = properties_storage_set(REWRITTEN_KEY, data2, 9, false);
+		check("rewrite", ret == PROPERTIES_STORAGE_SUCCESS);
+	}
+	for (int i = 0; i < PROPERTIES_STORAGE_MAX_NB_PROPERTIES - 1; i += 2) {
+		ret = properties_storage_delete(i);
+		check("delete", ret == PROPERTIES_STORAGE_SUCCESS);
+	}
+
+	memset(&stats, 0, sizeof(stats));
+	properties_storage_init();
+	uint32_t init_reads = stats.reads;
+	uint32_t init_words = stats.read_words;
+
+	double start = now_us();
+	for (int i = 0; i < NB_INIT_RUNS; ++i)
+		properties_storage_init();
+	double init_us = (now_us() - start) / NB_INIT_RUNS;
+
+	for (int i = 0; i < PROPERTIES_STORAGE_MAX_NB_PROPERTIES - 1; ++i) {
+		ret = properties_storage_get(i, rdata, sizeof(rdata), &readlen);
+		if (i & 1)
+			check("get", ret == PROPERTIES_STORAGE_SUCCESS &&
+			      readlen == 13 && !memcmp(data, rdata, 13));
+		else
+			check("get deleted",
+			      ret == PROPERTIES_STORAGE_KEY_NOT_FOUND_ERROR);
+	}
+	ret = properties_storage_get(REWRITTEN_KEY, rdata, sizeof(rdata),
+				     &readlen);
+	check("get rewritten", ret == PROPERTIES_STORAGE_SUCCESS &&
+	      readlen == 9 && !memcmp(data2, rdata, 9));
+
+	start = now_us();
+	for (int i = 0; i < NB_LOOKUPS; ++i)
+		properties_storage_get_info(
+			i % PROPERTIES_STORAGE_MAX_NB_PROPERTIES, &readlen,
+			&persistent);
+	double lookup_ns = (now_us() - start) * 1000 / NB_LOOKUPS;
+
+	printf("%4d properties %3d blocks: init %5u reads %6u words "
+	       "%8.1f us, lookup %5.1f ns\n",
+	       PROPERTIES_STORAGE_MAX_NB_PROPERTIES, PROPS_BENCH_NB_BLOCKS,
+	       init_reads, init_words, init_us, lookup_ns);
+	return 0;
+}
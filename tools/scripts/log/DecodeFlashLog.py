@@ -0,0 +1,129 @@
+#!/usr/bin/env python
+
+# Copyright (c) 2016, Intel Corporation. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#
+# 1. Redistributions of source code must retain the above copyright notice,
+# this list of conditions and the following disclaimer.
+#
+# 2. Redistributions in binary form must reproduce the above copyright notice,
+# this list of conditions and the following disclaimer in the documentation
+# and/or other materials provided with the distribution.
+#
+# 3. Neither the name of the copyright holder nor the names of its contributors
+# may be used to endorse or promote products derived from this software without
+# specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+# AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+# ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+# LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+# SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+# INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+# CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+# ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+# POSSIBILITY OF SUCH DAMAGE.
+
+"""
+Extract the logs written by the Quark SE flash log backend from a dump of the
+SPI flash log area.
+
+The area is a ring of sectors. Each sector starts with a header:
+    magic ("LOGS"), sector sequence number, first record number, check
+followed by records:
+    len (16 bits), crc (16 bits), record sequence number (32 bits), text
+The crc is a CRC16-CCITT (initial value 0xffff) over the sequence number and
+the text. An erased length (0xffff) ends a sector, and so does a record torn
+by a power loss.
+"""
+
+import argparse
+import binascii
+import struct
+import sys
+
+SECTOR_MAGIC = 0x53474f4c
+SECTOR_HDR = struct.Struct("<IIII")
+RECORD_HDR = struct.Struct("<HHI")
+ERASED_LEN = 0xffff
+
+
+def read_sectors(dump, nb_sectors, sector_size):
+    """Return the valid sectors as (sequence number, data), oldest first"""
+    sectors = []
+    for idx in range(nb_sectors):
+        data = dump[idx * sector_size:(idx + 1) * sector_size]
+        if len(data) < SECTOR_HDR.size:
+            break
+        magic, seq, first, check = SECTOR_HDR.unpack_from(data)
+        if magic != SECTOR_MAGIC or \
+                check != (~(magic ^ seq ^ first)) & 0xffffffff or \
+                seq % nb_sectors != idx:
+            continue
+        sectors.append((seq, data))
+    sectors.sort(key=lambda s: s[0])
+    return sectors
+
+
+def read_records(data):
+    """Yield the (sequence number, text, crc ok) records of a sector"""
+    offset = SECTOR_HDR.size
+    while offset + RECORD_HDR.size <= len(data):
+        length, crc, seq = RECORD_HDR.unpack_from(data, offset)
+        if length == ERASED_LEN:
+            return
+        offset += RECORD_HDR.size
+        if offset + length > len(data):
+            return
+        text = data[offset:offset + length]
+        offset += length
+        ok = binascii.crc_hqx(struct.pack("<I", seq) + text, 0xffff) == crc
+        yield seq, text, ok
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Extract logs from a "
+                                     "dump of the SPI flash log area")
+    parser.add_argument("dump", help="binary dump of the flash")
+    parser.add_argument("--offset", type=lambda x: int(x, 0), default=0,
+                        help="offset of the log area in the dump")
+    parser.add_argument("--sectors", type=int, default=253,
+                        help="number of sectors of the log area")
+    parser.add_argument("--sector-size", type=int, default=4096)
+    parser.add_argument("--stats", action="store_true",
+                        help="print statistics on stderr")
+    args = parser.parse_args()
+
+    with open(args.dump, "rb") as f:
+        f.seek(args.offset)
+        dump = f.read(args.sectors * args.sector_size)
+
+    out = getattr(sys.stdout, "buffer", sys.stdout)
+    expected = None
+    nb_records = nb_lost = nb_corrupted = 0
+    sectors = read_sectors(dump, args.sectors, args.sector_size)
+    for _, data in sectors:
+        for seq, text, ok in read_records(data):
+            if not ok:
+                # Torn by a power loss: the logger went on in a new sector
+                nb_corrupted += 1
+                break
+            if expected is not None and seq != expected:
+                lost = (seq - expected) & 0xffffffff
+                nb_lost += lost
+                out.write(("-- %d log records lost --\r\n" % lost).encode())
+            out.write(text)
+            expected = (seq + 1) & 0xffffffff
+            nb_records += 1
+
+    if args.stats:
+        sys.stderr.write("%d sectors, %d records, %d lost, %d corrupted\n" %
+                         (len(sectors), nb_records, nb_lost, nb_corrupted))
+
+
+if __name__ == "__main__":
+    main()
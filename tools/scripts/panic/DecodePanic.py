@@ -11,6 +11,10 @@ import linecache
 import traceback
 import DecodeRegister
 
+# "arch" of the records holding system events saved at panic, not core dumps
+# (PANIC_DATA_ARCH_EVENTS)
+ARCH_EVENTS = 0xe5
+
 
 class DecodePanic(object):
     """
@@ -257,7 +261,8 @@ def SplitPanics(data):
             except:
                 length = 1
             else:
-                panics.append({"index":index, "memory":data[index:index+length]})
+                if len(data) <= index + 16 or ord(data[index+16]) != ARCH_EVENTS:
+                    panics.append({"index":index, "memory":data[index:index+length]})
             index += length
         else:
             index += 4
@@ -0,0 +1,462 @@
+/*
+ * Copyright (c) 2016, Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ * may be used to endorse or promote products derived from this software without
+ * specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Host evaluation of the step detector on labeled accelerometer traces.
+ *
+ * Each trace is resampled at the evaluated rates, the way the sensor
+ * averages its samples at a lower output data rate, and fed to the
+ * detector. The steps counted and the cadence reported every second are
+ * compared with the labels.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "lib/step_detector/step_detector.h"
+
+/* Traces are built at 1kHz, or loaded at their own rate */
+#define BASE_RATE       1000
+#define MAX_RATES       8
+
+struct trace {
+	char name[32];
+	uint32_t count;         /* samples */
+	uint32_t rate;          /* Hz */
+	int16_t (*acc)[3];
+	uint16_t *cadence;      /* labeled cadence of each second, 0 if none */
+	uint32_t seconds;
+	uint32_t steps;         /* labeled steps */
+};
+
+struct result {
+	uint32_t steps;
+	uint32_t cadence_count; /* seconds with a labeled cadence */
+	uint32_t cadence_missed;        /* of them without cadence */
+	double cadence_err;     /* sum of absolute errors */
+	uint32_t cadence_err_max;
+	uint32_t false_seconds; /* cadence reported without walking */
+	uint32_t samples;
+	uint64_t ns;
+	uint64_t cycles;
+};
+
+static unsigned seed = 1;
+
+static double noise(double sigma)
+{
+	/* Box-Muller */
+	double u = (rand_r(&seed) + 1.0) / (RAND_MAX + 2.0);
+	double v = (rand_r(&seed) + 1.0) / (RAND_MAX + 2.0);
+
+	return sigma * sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static uint64_t now_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+static int16_t sat16(double v)
+{
+	if (v > 32767)
+		return 32767;
+	if (v < -32768)
+		return -32768;
+	return lrint(v);
+}
+
+static void trace_alloc(struct trace *tr, const char *name, uint32_t count,
+			uint32_t rate)
+{
+	snprintf(tr->name, sizeof(tr->name), "%s", name);
+	tr->count = count;
+	tr->rate = rate;
+	tr->seconds = (count + rate - 1) / rate;
+	tr->acc = calloc(count, sizeof(*tr->acc));
+	tr->cadence = calloc(tr->seconds, sizeof(*tr->cadence));
+	tr->steps = 0;
+}
+
+/*
+ * Segment of a synthetic trace: cadence in steps/min (0 to stand still),
+ * vertical swing and heel strike amplitudes in mg.
+ */
+struct segment {
+	uint32_t ms;
+	double cadence;
+	double swing;
+	double strike;
+};
+
+/*
+ * Wrist worn device: the magnitude swings once per step with a sharp heel
+ * strike, the gravity turns with the arm swinging once every two steps,
+ * the cadence drifts by a few % and the sensor adds its noise.
+ */
+static void trace_gen(struct trace *tr, const char *name,
+		      const struct segment *seg, int segs, double sigma)
+{
+	uint32_t count = 0;
+	double phase = 0;
+	double drift = 0;
+	uint32_t i = 0;
+	uint32_t sec_steps = 0;
+	double sec_cadence = 0;
+
+	for (int s = 0; s < segs; s++)
+		count += seg[s].ms;
+	trace_alloc(tr, name, count, BASE_RATE);
+
+	for (int s = 0; s < segs; s++) {
+		for (uint32_t k = 0; k < seg[s].ms; k++, i++) {
+			double f = seg[s].cadence / 60 *
+				   (1 + 0.04 * sin(drift));
+			double step_ph;
+			double angle;
+			double mag;
+
+			drift += 2 * M_PI / 20000;
+			if (f > 0) {
+				double prev = phase;
+
+				phase += f / BASE_RATE;
+				if (floor(phase) != floor(prev))
+					tr->steps++;
+				sec_cadence += f * 60;
+				sec_steps++;
+			}
+			step_ph = phase - floor(phase);
+			mag = 1000;
+			angle = 0.3;
+			if (f > 0) {
+				mag += seg[s].swing * sin(2 * M_PI * phase) +
+				       seg[s].strike *
+				       exp(-pow((step_ph - 0.2) / 0.04, 2));
+				angle += 0.5 * sin(M_PI * phase);
+			}
+			tr->acc[i][0] = sat16(mag * sin(angle) + noise(sigma));
+			tr->acc[i][1] = sat16(noise(sigma));
+			tr->acc[i][2] = sat16(mag * cos(angle) + noise(sigma));
+			if ((i + 1) % BASE_RATE == 0 || i + 1 == count) {
+				/* Label the seconds walked all along */
+				if (sec_steps == (i % BASE_RATE) + 1)
+					tr->cadence[i / BASE_RATE] =
+						lrint(sec_cadence / sec_steps);
+				sec_steps = 0;
+				sec_cadence = 0;
+			}
+		}
+	}
+}
+
+/* Arm gestures: random moves of 300-1500 mg lasting 0.2-1.5s, no step */
+static void trace_gen_gestures(struct trace *tr, uint32_t ms, double sigma)
+{
+	uint32_t i = 0;
+
+	trace_alloc(tr, "gestures", ms, BASE_RATE);
+	while (i < ms) {
+		uint32_t len = 200 + rand_r(&seed) % 1300;
+		uint32_t pause = rand_r(&seed) % 1500;
+		double amp = 300 + rand_r(&seed) % 1200;
+		int axis = rand_r(&seed) % 3;
+
+		for (uint32_t k = 0; k < len + pause && i < ms; k++, i++) {
+			double v[3] = { 300, 0, 950 };
+
+			if (k < len)
+				v[axis] += amp * sin(M_PI * k / len) *
+					   sin(2 * M_PI * k / len);
+			for (int a = 0; a < 3; a++)
+				tr->acc[i][a] = sat16(v[a] + noise(sigma));
+		}
+	}
+}
+
+/*
+ * Trace file: "t,ax,ay,az" lines in ms and mg at a constant rate, the
+ * labels in comments: "# steps N" for the steps of the whole trace and
+ * "# cadence FROM_S TO_S SPM" for the cadence during a period.
+ */
+static int trace_load(struct trace *tr, const char *path)
+{
+	char line[128];
+	uint32_t n = 0;
+	uint32_t t0 = 0, t1 = 0;
+	int pass;
+	FILE *f = fopen(path, "r");
+
+	if (f == NULL) {
+		perror(path);
+		return -1;
+	}
+	for (pass = 0; pass < 2; pass++) {
+		uint32_t i = 0;
+
+		rewind(f);
+		while (fgets(line, sizeof(line), f)) {
+			unsigned t, from, to, spm;
+			int v[3];
+
+			if (line[0] == '#') {
+				if (pass == 0)
+					continue;
+				if (sscanf(line, "# steps %u", &spm) == 1)
+					tr->steps = spm;
+				if (sscanf(line, "# cadence %u %u %u", &from,
+					   &to, &spm) == 3)
+					for (; from < to && from < tr->seconds;
+					     from++)
+						tr->cadence[from] = spm;
+				continue;
+			}
+			if (sscanf(line, "%u,%d,%d,%d", &t, &v[0], &v[1],
+				   &v[2]) != 4)
+				continue;
+			if (pass == 0) {
+				if (n++ == 0)
+					t0 = t;
+				t1 = t;
+				continue;
+			}
+			for (int a = 0; a < 3; a++)
+				tr->acc[i][a] = sat16(v[a]);
+			i++;
+		}
+		if (pass == 0) {
+			if (n < 2 || t1 == t0) {
+				fprintf(stderr, "%s: no sample\n", path);
+				fclose(f);
+				return -1;
+			}
+			trace_alloc(tr, path, n,
+				    lrint((n - 1) * 1000.0 / (t1 - t0)));
+		}
+	}
+	fclose(f);
+	return 0;
+}
+
+/* Feed the detector with the trace averaged at rate */
+static void evaluate(const struct trace *tr, uint32_t rate, struct result *r)
+{
+	struct step_detector sd;
+	uint32_t out = (uint64_t)tr->count * rate / tr->rate;
+	int16_t (*acc)[3] = calloc(out, sizeof(*acc));
+	uint32_t next_second = 1000;
+	uint32_t from = 0;
+	uint64_t ns, cycles;
+
+	memset(r, 0, sizeof(*r));
+	for (uint32_t o = 0; o < out; o++) {
+		uint32_t to = (uint64_t)(o + 1) * tr->rate / rate;
+		int32_t sum[3] = { 0, 0, 0 };
+
+		for (uint32_t i = from; i < to; i++)
+			for (int a = 0; a < 3; a++)
+				sum[a] += tr->acc[i][a];
+		for (int a = 0; a < 3; a++)
+			acc[o][a] = sum[a] / (int32_t)(to - from);
+		from = to;
+	}
+
+	/* Time the detector alone, without the cadence checks */
+	step_detector_init(&sd);
+	ns = now_ns();
+	cycles = now_cycles();
+	for (uint32_t o = 0; o < out; o++)
+		step_detector_process(&sd, acc[o], (uint64_t)o * 1000 / rate);
+	r->cycles = now_cycles() - cycles;
+	r->ns = now_ns() - ns;
+	r->samples = out;
+
+	step_detector_init(&sd);
+	for (uint32_t o = 0; o < out; o++) {
+		uint32_t t = (uint64_t)o * 1000 / rate;
+		uint32_t sec, label, cadence, err;
+
+		r->steps += step_detector_process(&sd, acc[o], t);
+		if (t + 1000 / rate < next_second)
+			continue;
+
+		sec = next_second / 1000 - 1;
+		label = sec < tr->seconds ? tr->cadence[sec] : 0;
+		cadence = step_detector_cadence(&sd, t);
+		next_second += 1000;
+		if (label == 0) {
+			if (cadence)
+				r->false_seconds++;
+			continue;
+		}
+		r->cadence_count++;
+		if (cadence == 0) {
+			r->cadence_missed++;
+			continue;
+		}
+		err = abs((int)cadence - (int)label);
+		r->cadence_err += err;
+		if (err > r->cadence_err_max)
+			r->cadence_err_max = err;
+	}
+	free(acc);
+}
+
+static void report(const struct trace *tr, uint32_t rate,
+		   const struct result *r)
+{
+	uint32_t hit = r->cadence_count - r->cadence_missed;
+
+	printf("%-12s %4u %6u %6u %+7.1f%% %5u/%-5u %6.2f %4u %5u %7.0f %7.0f\n",
+	       tr->name, rate, tr->steps, r->steps,
+	       tr->steps ? 100.0 * ((double)r->steps - tr->steps) / tr->steps :
+	       0.0, hit, r->cadence_count,
+	       hit ? r->cadence_err / hit : 0.0, r->cadence_err_max,
+	       r->false_seconds, (double)r->ns / r->samples,
+	       (double)r->cycles / r->samples);
+}
+
+static void build_suite(struct trace *tr, int *n, double sigma)
+{
+	static const struct segment slow[] = { { 120000, 85, 180, 150 } };
+	static const struct segment walk[] = { { 120000, 110, 300, 400 } };
+	static const struct segment brisk[] = { { 120000, 130, 450, 600 } };
+	static const struct segment run[] = { { 120000, 165, 900, 1500 } };
+	static const struct segment sprint[] = { { 60000, 190, 1200, 2500 } };
+	static const struct segment mixed[] = {
+		{ 60000, 105, 300, 400 }, { 20000, 0, 0, 0 },
+		{ 60000, 160, 900, 1400 }, { 10000, 0, 0, 0 },
+		{ 30000, 120, 400, 500 }, { 5000, 0, 0, 0 },
+		{ 4000, 110, 300, 400 }, { 20000, 0, 0, 0 },
+	};
+	static const struct segment still[] = { { 120000, 0, 0, 0 } };
+
+	trace_gen(&tr[(*n)++], "walk_slow", slow, 1, sigma);
+	trace_gen(&tr[(*n)++], "walk", walk, 1, sigma);
+	trace_gen(&tr[(*n)++], "walk_brisk", brisk, 1, sigma);
+	trace_gen(&tr[(*n)++], "run", run, 1, sigma);
+	trace_gen(&tr[(*n)++], "sprint", sprint, 1, sigma);
+	trace_gen(&tr[(*n)++], "mixed", mixed,
+		  sizeof(mixed) / sizeof(mixed[0]), sigma);
+	trace_gen(&tr[(*n)++], "still", still, 1, sigma);
+	trace_gen_gestures(&tr[(*n)++], 120000, sigma);
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-t trace.csv]... [-r HZ]... [-n MG] [-s SEED]\n"
+		"  -t FILE  labeled trace, instead of the synthetic suite:\n"
+		"           \"t,ax,ay,az\" lines (ms, mg), \"# steps N\" and\n"
+		"           \"# cadence FROM_S TO_S SPM\" labels\n"
+		"  -r HZ    evaluated rate, default 100, 50 and 25\n"
+		"  -n MG    sensor noise of the synthetic traces, default 15\n"
+		"  -s SEED  seed of the synthetic traces\n", prog);
+}
+
+int main(int argc, char **argv)
+{
+	struct trace traces[16];
+	uint32_t rates[MAX_RATES];
+	int rate_count = 0;
+	int n = 0;
+	double sigma = 15;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "t:r:n:s:h")) != -1) {
+		switch (opt) {
+		case 't':
+			if (n == sizeof(traces) / sizeof(traces[0]) ||
+			    trace_load(&traces[n], optarg))
+				return 1;
+			n++;
+			break;
+		case 'r':
+			if (rate_count == MAX_RATES || atoi(optarg) <= 0) {
+				usage(argv[0]);
+				return 2;
+			}
+			rates[rate_count++] = atoi(optarg);
+			break;
+		case 'n':
+			sigma = atof(optarg);
+			break;
+		case 's':
+			seed = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 2;
+		}
+	}
+	if (rate_count == 0) {
+		rates[rate_count++] = 100;
+		rates[rate_count++] = 50;
+		rates[rate_count++] = 25;
+	}
+	if (n == 0)
+		build_suite(traces, &n, sigma);
+
+	printf("%-12s %4s %6s %6s %8s %11s %6s %4s %5s %7s %7s\n", "trace",
+	       "Hz", "steps", "found", "error", "cadence_s", "mae", "max",
+	       "false", "ns/smp", "cyc/smp");
+	for (int i = 0; i < n; i++) {
+		for (int k = 0; k < rate_count; k++) {
+			struct result r;
+
+			if (rates[k] > traces[i].rate)
+				continue;
+			evaluate(&traces[i], rates[k], &r);
+			report(&traces[i], rates[k], &r);
+		}
+		free(traces[i].acc);
+		free(traces[i].cadence);
+	}
+	return 0;
+}